@@ -0,0 +1,231 @@
+/*
+ * bench.c
+ *
+ * The program runs the benchmarks of the tick pipeline: the decoders of
+ * every md_type, the ring between cores, the bar engine of every bar_type,
+ * the scans of the columnar store and the snapshot table of the bus.
+ *
+ *	bench
+ *	bench -s ring -p 2:3,2:10 -n 10000000
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "bench.h"
+#include "decode.h"
+
+#define OPS		1000000
+#define INSTRUMENTS	200
+
+volatile uint64_t bench_sink;
+
+static int csv, header_done;
+
+static void
+header(void)
+{
+	if (header_done) {
+		return;
+	}
+	header_done = 1;
+
+	if (csv) {
+		printf("suite,case,ops,ns_op,mops_s,mb_s,p50,p90,p99,p999,max\n");
+	} else {
+		printf("%-8s %-18s %10s %9s %9s %9s %8s %8s %8s %8s %8s\n", "suite", "case", "ops", "ns/op",
+		       "Mops/s", "MB/s", "p50", "p90", "p99", "p99.9", "max");
+	}
+}
+
+void
+bench_report(const char *suite, const char *name, uint64_t ops, uint64_t ns, uint64_t bytes)
+{
+	double sec = (double)ns / 1e9, per = ops != 0 ? (double)ns / (double)ops : 0;
+
+	header();
+	if (csv) {
+		printf("%s,%s,%lu,%.2f,%.3f,%.1f,,,,,\n", suite, name, (unsigned long)ops, per,
+		       sec > 0 ? (double)ops / sec / 1e6 : 0, sec > 0 ? (double)bytes / sec / 1e6 : 0);
+	} else {
+		printf("%-8s %-18s %10lu %9.2f %9.3f %9.1f %8s %8s %8s %8s %8s\n", suite, name, (unsigned long)ops, per,
+		       sec > 0 ? (double)ops / sec / 1e6 : 0, sec > 0 ? (double)bytes / sec / 1e6 : 0,
+		       "-", "-", "-", "-", "-");
+	}
+	fflush(stdout);
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t
+pct(const uint64_t *v, size_t n, double q)
+{
+	size_t i = (size_t)(q * (double)n);
+
+	return v[i < n ? i : n - 1];
+}
+
+void
+bench_report_lat(const char *suite, const char *name, uint64_t *samples, size_t n)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	if (n == 0) {
+		return;
+	}
+	qsort(samples, n, sizeof(*samples), cmp_u64);
+	for (i = 0; i < n; i++) {
+		sum += samples[i];
+	}
+
+	header();
+	printf(csv ? "%s,%s,%lu,%.2f,,," : "%-8s %-18s %10lu %9.2f %9s %9s ", suite, name, (unsigned long)n,
+	       (double)sum / (double)n, "-", "-");
+	printf(csv ? "%lu,%lu,%lu,%lu,%lu\n" : "%8lu %8lu %8lu %8lu %8lu\n", (unsigned long)pct(samples, n, 0.5),
+	       (unsigned long)pct(samples, n, 0.9), (unsigned long)pct(samples, n, 0.99),
+	       (unsigned long)pct(samples, n, 0.999), (unsigned long)samples[n - 1]);
+	fflush(stdout);
+}
+
+static const struct {
+	const char *name;
+	int (*run)(const struct bench_opts *o);
+} suites[] = {
+	{ "decode", bench_decode },
+	{ "ring", bench_ring },
+	{ "bar", bench_bar },
+	{ "store", bench_store },
+	{ "snap", bench_snap },
+};
+
+#define NSUITES	(sizeof(suites) / sizeof(suites[0]))
+
+/*
+ * parse_pairs - "p:c,p:c..." of the cores of the producer and the consumer.
+ */
+static int
+parse_pairs(struct bench_opts *o, char *s)
+{
+	char *tok, *save = NULL;
+
+	o->npairs = 0;
+	for (tok = strtok_r(s, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+		if (o->npairs == BENCH_PAIRS_MAX ||
+		    sscanf(tok, "%d:%d", &o->pairs[o->npairs][0], &o->pairs[o->npairs][1]) != 2) {
+			return -1;
+		}
+		o->npairs++;
+	}
+
+	return o->npairs > 0 ? 0 : -1;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-s suite[,suite]] [-n ops] [-i instruments] [-p cpu:cpu[,...]] [-d dir] [-S seed] [-C]\n"
+		"  -s suites    decode, ring, bar, store, snap (default all of them)\n"
+		"  -n ops       operations of a case, about (default %d)\n"
+		"  -i count     instruments of the synthetic ticks (default %d)\n"
+		"  -p pairs     producer:consumer cores of the ring cases (default 0:1 and 0:<last>)\n"
+		"  -d dir       directory of the store files (default a temporary one in /tmp)\n"
+		"  -S seed      of the synthetic ticks\n"
+		"  -C           CSV\n",
+		prog, OPS, INSTRUMENTS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench_opts o;
+	char *list = NULL, *tok, *save = NULL;
+	int run[NSUITES], opt, rc = 0;
+	long ncpu;
+	size_t i;
+
+	memset(&o, 0, sizeof(o));
+	o.ops = OPS;
+	o.instruments = INSTRUMENTS;
+	o.seed = 20250303;
+
+	while ((opt = getopt(argc, argv, "s:n:i:p:d:S:C")) != -1) {
+		switch (opt) {
+		case 's':
+			list = optarg;
+			break;
+		case 'n':
+			o.ops = strtoull(optarg, NULL, 10);
+			break;
+		case 'i':
+			o.instruments = (uint32_t)atoi(optarg);
+			break;
+		case 'p':
+			if (parse_pairs(&o, optarg) != 0) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'd':
+			o.dir = optarg;
+			break;
+		case 'S':
+			o.seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'C':
+			o.csv = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (o.ops == 0 || o.instruments == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	csv = o.csv;
+
+	/* the next core, usually the other thread of the core or a neighbour, and the farthest */
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (o.npairs == 0 && ncpu > 1) {
+		o.pairs[o.npairs][0] = 0;
+		o.pairs[o.npairs++][1] = 1;
+		if (ncpu > 2) {
+			o.pairs[o.npairs][0] = 0;
+			o.pairs[o.npairs++][1] = (int)ncpu - 1;
+		}
+	}
+
+	for (i = 0; i < NSUITES; i++) {
+		run[i] = list == NULL;
+	}
+	for (tok = list != NULL ? strtok_r(list, ",", &save) : NULL; tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < NSUITES && strcmp(suites[i].name, tok) != 0; i++)
+			;
+		if (i == NSUITES) {
+			fprintf(stderr, "unknown suite %s\n", tok);
+			return 1;
+		}
+		run[i] = 1;
+	}
+
+	for (i = 0; i < NSUITES; i++) {
+		if (run[i] && suites[i].run(&o) != 0) {
+			rc = 1;
+		}
+	}
+
+	return rc;
+}
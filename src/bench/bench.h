@@ -0,0 +1,70 @@
+/*
+ * bench.h
+ *
+ * The file contains the definition of the options and the results of the
+ * benchmarks of the tick pipeline and the functions' prototype of their
+ * suites.
+ *
+ * Every case prints one line of the operations it timed, ns of an
+ * operation, millions of them a second and MB/s of the data they went
+ * through, and for the latency cases the percentiles of the samples in ns;
+ * with -C it is CSV, for keeping the runs and comparing them:
+ *
+ *	bench -C >> bench.csv
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "tick.h"
+
+#define BENCH_PAIRS_MAX	16
+
+struct bench_opts
+{
+	uint64_t ops;			/* operations of a case, about */
+	uint32_t instruments;		/* of the synthetic ticks */
+	uint64_t seed;
+	int csv;
+	const char *dir;		/* of the files of the store suite, NULL for /tmp */
+	int pairs[BENCH_PAIRS_MAX][2];	/* producer and consumer cores of the ring suite */
+	int npairs;
+};
+
+/* bench_now - the monotonic clock in ns, the same on every core */
+static inline uint64_t
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* bench_sink - the results the compiler must not optimize away go here */
+extern volatile uint64_t bench_sink;
+
+/*
+ * bench_report - the line of a case: ops operations in ns, over bytes of
+ * data, 0 if it has none. bench_report_lat() the line of the latencies of
+ * n samples, sorted in place.
+ */
+void bench_report(const char *suite, const char *name, uint64_t ops, uint64_t ns, uint64_t bytes);
+void bench_report_lat(const char *suite, const char *name, uint64_t *samples, size_t n);
+
+/*
+ * The suites return 0, -1 when a case could not run; the others still do.
+ */
+int bench_decode(const struct bench_opts *o);
+int bench_ring(const struct bench_opts *o);
+int bench_bar(const struct bench_opts *o);
+int bench_store(const struct bench_opts *o);
+int bench_snap(const struct bench_opts *o);
+
+#endif		/* __BENCH_H__ */
@@ -0,0 +1,99 @@
+/*
+ * bench_bar.c
+ *
+ * The functions are used to benchmark the bar engine building one bar_type
+ * and all of them from synthetic ticks of a morning session, timing
+ * bar_engine_tick() alone.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "bar.h"
+#include "parse.h"
+#include "synth.h"
+
+#define CHUNK		4096		/* ticks made between the timed runs */
+#define SESSION_NS	(75 * 60 * 1000000000ULL)	/* 09:00 to 10:15 */
+
+static void
+on_bar(const bar_rec_t *bar, void *arg)
+{
+	(void)bar;
+	(*(uint64_t *)arg)++;
+}
+
+static int
+run(const struct bench_opts *o, uint32_t types, const char *name)
+{
+	static tick_rec_t chunk[CHUNK] __attribute__((aligned(TICK_CACHELINE)));
+	struct bar_conf conf;
+	struct bar_stats st;
+	bar_engine_t *eng;
+	synth_t *s;
+	uint64_t start, ts, ns = 0, bars = 0, i = 0, k, n;
+
+	if ((s = synth_create(MD_T_SHFE, o->instruments, o->seed)) == NULL) {
+		return -1;
+	}
+	memset(&conf, 0, sizeof(conf));
+	conf.types = types;
+	conf.on_bar = on_bar;
+	conf.arg = &bars;
+	conf.instruments = (uint32_t)o->instruments;
+	if ((eng = bar_engine_create(&conf)) == NULL) {
+		synth_free(s);
+		return -1;
+	}
+
+	/* the ticks spread over the segment, however many there are */
+	ts = cn_timestamp(20250303, 9 * 3600, 0);
+	while (i < o->ops) {
+		n = o->ops - i < CHUNK ? o->ops - i : CHUNK;
+		for (k = 0; k < n; k++) {
+			synth_tick(s, ts + (i + k) * (SESSION_NS / o->ops), &chunk[k]);
+			chunk[k].md_type = MD_T_SHFE;
+		}
+
+		start = bench_now();
+		for (k = 0; k < n; k++) {
+			bar_engine_tick(eng, &chunk[k]);
+		}
+		ns += bench_now() - start;
+		i += n;
+	}
+	bar_engine_flush(eng, ts + SESSION_NS);
+	bar_engine_stats(eng, &st);
+	bench_sink += bars;
+
+	if (st.late != 0 || st.off_session != 0) {
+		fprintf(stderr, "bar %s: %lu late and %lu off-session ticks\n", name, (unsigned long)st.late,
+			(unsigned long)st.off_session);
+	}
+	bench_report("bar", name, i, ns, i * sizeof(tick_rec_t));
+
+	bar_engine_destroy(eng);
+	synth_free(s);
+
+	return 0;
+}
+
+int
+bench_bar(const struct bench_opts *o)
+{
+	int t, rc = 0;
+
+	for (t = 0; t < BAR_T_MAX; t++) {
+		if (run(o, BAR_MASK(t), bar_type_names[t]) != 0) {
+			rc = -1;
+		}
+	}
+	if (run(o, BAR_MASK_ALL, "all") != 0) {
+		rc = -1;
+	}
+
+	return rc;
+}
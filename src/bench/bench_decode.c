@@ -0,0 +1,197 @@
+/*
+ * bench_decode.c
+ *
+ * The functions are used to benchmark the decoders of every md_type with
+ * packets of synthetic ticks in the layout of the feed, through
+ * tick_decode() as the receiver calls it and through read_tick().
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "decode.h"
+#include "parse.h"
+#include "synth.h"
+
+#define RECS		16384		/* ticks encoded once, decoded over and over */
+#define PKT_LEN		1472		/* UDP payload of an Ethernet frame */
+#define TICK_STEP_NS	1000000ULL
+
+struct packets
+{
+	uint8_t *buf;
+	size_t len;
+	size_t cap;
+	size_t *off;		/* off[i] to off[i + 1] is packet i */
+	size_t n;
+	size_t recs;
+};
+
+static void
+packets_free(struct packets *p)
+{
+	free(p->buf);
+	free(p->off);
+}
+
+/*
+ * encode - RECS ticks of the morning, one packet of the feed after another.
+ */
+static int
+encode(int md_type, const struct bench_opts *o, struct packets *p, tick_rec_t *recs)
+{
+	uint64_t ts = cn_timestamp(20250303, 9 * 3600, 0);
+	size_t i, done, n;
+	synth_t *s;
+	void *q;
+
+	if ((s = synth_create(md_type, o->instruments, o->seed)) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < RECS; i++) {
+		synth_tick(s, ts + i * TICK_STEP_NS, &recs[i]);
+	}
+	synth_free(s);
+
+	memset(p, 0, sizeof(*p));
+	p->cap = RECS * sizeof(tick_rec_t);
+	if ((p->buf = malloc(p->cap)) == NULL || (p->off = malloc((RECS + 1) * sizeof(size_t))) == NULL) {
+		packets_free(p);
+		return -1;
+	}
+
+	for (i = 0; i < RECS; i += done) {
+		if (p->cap - p->len < PKT_LEN) {
+			if ((q = realloc(p->buf, p->cap * 2)) == NULL) {
+				packets_free(p);
+				return -1;
+			}
+			p->buf = q;
+			p->cap *= 2;
+		}
+		n = tick_encode(md_type, recs + i, RECS - i, (uint32_t)p->n + 1, p->buf + p->len, PKT_LEN, &done);
+		if (n == 0) {
+			fprintf(stderr, "%s: cannot encode the ticks\n", synth_md_name(md_type));
+			packets_free(p);
+			return -1;
+		}
+		p->off[p->n++] = p->len;
+		p->len += n;
+	}
+	p->off[p->n] = p->len;
+	p->recs = RECS;
+
+	return 0;
+}
+
+/*
+ * check - decode the packets once and compare the fields every feed carries
+ * with the ticks they were encoded from.
+ */
+static int
+check(int md_type, const struct packets *p, const tick_rec_t *recs)
+{
+	tick_rec_t out[DECODE_MSGS_MAX];
+	size_t i, k, n, used, j = 0, bad = 0;
+
+	for (i = 0; i < p->n; i++) {
+		n = tick_decode(md_type, p->buf + p->off[i], p->off[i + 1] - p->off[i], out, DECODE_MSGS_MAX, &used, 0);
+		for (k = 0; k < n && j < p->recs; k++, j++) {
+			const tick_rec_t *a = &recs[j], *b = &out[k];
+
+			bad += a->instrument != b->instrument || a->timestamp != b->timestamp || a->last != b->last ||
+			       a->volume != b->volume || a->open_interest != b->open_interest ||
+			       a->bid[0] != b->bid[0] || a->ask[0] != b->ask[0] ||
+			       a->bid_vol[0] != b->bid_vol[0] || a->ask_vol[0] != b->ask_vol[0];
+		}
+	}
+	if (j != p->recs || bad != 0) {
+		fprintf(stderr, "%s: %lu of %lu ticks decoded, %lu differ\n", synth_md_name(md_type),
+			(unsigned long)j, (unsigned long)p->recs, (unsigned long)bad);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+run_decode(int md_type, const struct bench_opts *o, const struct packets *p)
+{
+	tick_rec_t out[DECODE_MSGS_MAX];
+	uint64_t start, recs = 0, bytes = 0, sum = 0;
+	size_t i, used;
+
+	start = bench_now();
+	while (recs < o->ops) {
+		for (i = 0; i < p->n; i++) {
+			recs += tick_decode(md_type, p->buf + p->off[i], p->off[i + 1] - p->off[i], out, DECODE_MSGS_MAX,
+					    &used, start);
+			sum += (uint64_t)out[0].last;
+		}
+		bytes += p->len;
+	}
+	bench_sink += sum;
+
+	bench_report("decode", synth_md_name(md_type), recs, bench_now() - start, bytes);
+}
+
+static void
+run_read_tick(int md_type, const struct bench_opts *o, const struct packets *p)
+{
+	uint64_t start, recs = 0, bytes = 0;
+	tick_data_t *t;
+	double sum = 0;
+	size_t i;
+	char name[32];
+
+	start = bench_now();
+	while (recs < o->ops) {
+		for (i = 0; i < p->n; i++) {
+			for (t = read_tick(md_type, p->buf + p->off[i], p->off[i + 1] - p->off[i]); t != NULL;
+			     t = read_next(t)) {
+				sum += t->last.price;
+				recs++;
+			}
+		}
+		bytes += p->len;
+	}
+	bench_sink += (uint64_t)sum;
+
+	snprintf(name, sizeof(name), "%s read_tick", synth_md_name(md_type));
+	bench_report("decode", name, recs, bench_now() - start, bytes);
+}
+
+int
+bench_decode(const struct bench_opts *o)
+{
+	struct packets p;
+	tick_rec_t *recs;
+	int md, rc = 0;
+
+	if ((recs = aligned_alloc(TICK_CACHELINE, RECS * sizeof(tick_rec_t))) == NULL) {
+		return -1;
+	}
+
+	for (md = 0; md < MD_T_MAX; md++) {
+		if (tick_decoders[md] == NULL || tick_decoders[md]->encode == NULL) {
+			continue;
+		}
+		if (encode(md, o, &p, recs) != 0) {
+			rc = -1;
+			continue;
+		}
+		if (check(md, &p, recs) != 0) {
+			rc = -1;
+		} else {
+			run_decode(md, o, &p);
+			run_read_tick(md, o, &p);
+		}
+		packets_free(&p);
+	}
+	free(recs);
+
+	return rc;
+}
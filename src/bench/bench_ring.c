@@ -0,0 +1,220 @@
+/*
+ * bench_ring.c
+ *
+ * The functions are used to benchmark the tick ring between a producer and
+ * a gating reader pinned to a pair of cores: the records a second through
+ * it in batches, as the decoder publishes them, and the latency of one
+ * record from the publish to the reader, with nothing queued before it.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "bench.h"
+#include "ring.h"
+#include "raw.h"
+
+#define CAPACITY	4096
+#define BATCH		32
+#define SAMPLES_MAX	1000000
+#define GAP_NS		2000		/* between the records of the latency case */
+
+enum { MODE_THROUGHPUT = 0, MODE_LATENCY };
+
+struct pair
+{
+	ring_t *ring;
+	ring_reader_t rd;
+	int mode;
+	int pcpu;			/* core of the producer */
+	int ccpu;			/* core of the reader */
+	uint64_t ops;
+	uint64_t *samples;		/* latency of every record, by the reader */
+	_Atomic uint64_t done;		/* records the reader consumed */
+	_Atomic int ready;
+	_Atomic int failed;
+	uint64_t end;
+};
+
+static void *
+consumer(void *arg)
+{
+	struct pair *s = arg;
+	const tick_rec_t *t;
+	uint64_t first, got = 0, sum = 0;
+	size_t n, i;
+
+	if (raw_pin_cpu(s->ccpu) != 0) {
+		s->failed = 1;
+	}
+	atomic_store_explicit(&s->ready, 1, memory_order_release);
+
+	while (got < s->ops && !s->failed) {
+		if ((n = ring_peek(&s->rd, BATCH, &first)) == 0) {
+			ring_cpu_relax();
+			continue;
+		}
+		for (i = 0; i < n; i++) {
+			t = ring_slot(s->ring, first + i);
+			if (s->mode == MODE_LATENCY) {
+				s->samples[got + i] = bench_now() - t->recv_ts;
+			}
+			sum += (uint64_t)t->last;
+		}
+		ring_release(&s->rd, n);
+		got += n;
+		atomic_store_explicit(&s->done, got, memory_order_release);
+	}
+	s->end = bench_now();
+	bench_sink += sum;
+
+	return NULL;
+}
+
+static void
+produce(struct pair *s)
+{
+	tick_rec_t *t;
+	uint64_t first, i = 0, next;
+	size_t n, k;
+
+	if (s->mode == MODE_THROUGHPUT) {
+		while (i < s->ops) {
+			if ((n = ring_claim(s->ring, s->ops - i < BATCH ? s->ops - i : BATCH, &first)) == 0) {
+				ring_cpu_relax();
+				continue;
+			}
+			for (k = 0; k < n; k++) {
+				t = ring_slot(s->ring, first + k);
+				t->last = (int64_t)(i + k);
+				t->recv_ts = 0;
+			}
+			ring_publish(s->ring, first, n);
+			i += n;
+		}
+		return;
+	}
+
+	/* one record at a time, the next once the reader has it and the gap passed */
+	for (next = bench_now(); i < s->ops; i++) {
+		while (atomic_load_explicit(&s->done, memory_order_acquire) < i || bench_now() < next) {
+			ring_cpu_relax();
+		}
+		if (ring_claim(s->ring, 1, &first) != 1) {
+			i--;
+			continue;
+		}
+		t = ring_slot(s->ring, first);
+		t->last = (int64_t)i;
+		t->recv_ts = bench_now();
+		ring_publish(s->ring, first, 1);
+		next = t->recv_ts + GAP_NS;
+	}
+}
+
+static void *
+producer(void *arg)
+{
+	struct pair *s = arg;
+
+	if (raw_pin_cpu(s->pcpu) != 0) {
+		s->failed = 1;
+		return NULL;
+	}
+	while (!atomic_load_explicit(&s->ready, memory_order_acquire)) {
+		ring_cpu_relax();
+	}
+	produce(s);
+
+	return NULL;
+}
+
+static int
+run(int mode, int pcpu, int ccpu, uint64_t ops)
+{
+	struct pair pr;
+	pthread_t pt, ct;
+	uint64_t start;
+	char name[32];
+
+	memset(&pr, 0, sizeof(pr));
+	if ((pr.ring = ring_create(CAPACITY, sizeof(tick_rec_t), 0)) == NULL) {
+		return -1;
+	}
+	if (ring_reader_init(&pr.rd, pr.ring, RING_R_GATING) != 0) {
+		ring_destroy(pr.ring);
+		return -1;
+	}
+	pr.mode = mode;
+	pr.pcpu = pcpu;
+	pr.ccpu = ccpu;
+	pr.ops = mode == MODE_LATENCY && ops > SAMPLES_MAX ? SAMPLES_MAX : ops;
+	if (mode == MODE_LATENCY && (pr.samples = malloc(pr.ops * sizeof(uint64_t))) == NULL) {
+		ring_reader_fini(&pr.rd);
+		ring_destroy(pr.ring);
+		return -1;
+	}
+
+	if (pthread_create(&ct, NULL, consumer, &pr) != 0) {
+		free(pr.samples);
+		ring_reader_fini(&pr.rd);
+		ring_destroy(pr.ring);
+		return -1;
+	}
+	while (!atomic_load_explicit(&pr.ready, memory_order_acquire)) {
+		ring_cpu_relax();
+	}
+
+	start = bench_now();
+	if (pr.failed || pthread_create(&pt, NULL, producer, &pr) != 0) {
+		pr.failed = 1;
+	} else {
+		pthread_join(pt, NULL);
+	}
+	pthread_join(ct, NULL);
+
+	if (!pr.failed) {
+		if (mode == MODE_THROUGHPUT) {
+			snprintf(name, sizeof(name), "spsc %d>%d", pcpu, ccpu);
+			bench_report("ring", name, pr.ops, pr.end - start, pr.ops * sizeof(tick_rec_t));
+		} else {
+			snprintf(name, sizeof(name), "latency %d>%d", pcpu, ccpu);
+			bench_report_lat("ring", name, pr.samples, pr.ops);
+		}
+	}
+
+	free(pr.samples);
+	ring_reader_fini(&pr.rd);
+	ring_destroy(pr.ring);
+
+	return pr.failed ? -1 : 0;
+}
+
+int
+bench_ring(const struct bench_opts *o)
+{
+	int i, rc = 0;
+
+	if (o->npairs == 0) {
+		fprintf(stderr, "ring: one core only, no pair to run on\n");
+	}
+	for (i = 0; i < o->npairs; i++) {
+		/* spinning on one core measures the scheduler, not the ring */
+		if (o->pairs[i][0] == o->pairs[i][1]) {
+			fprintf(stderr, "ring: the producer and the reader need cores of their own, not %d and %d\n",
+				o->pairs[i][0], o->pairs[i][1]);
+			rc = -1;
+			continue;
+		}
+		if (run(MODE_THROUGHPUT, o->pairs[i][0], o->pairs[i][1], o->ops * 10) != 0 ||
+		    run(MODE_LATENCY, o->pairs[i][0], o->pairs[i][1], o->ops / 10) != 0) {
+			fprintf(stderr, "ring: cores %d and %d failed\n", o->pairs[i][0], o->pairs[i][1]);
+			rc = -1;
+		}
+	}
+
+	return rc;
+}
@@ -0,0 +1,281 @@
+/*
+ * bench_snap.c
+ *
+ * The functions are used to benchmark the snapshot table of the bus: the
+ * writes of the decoder, the sample of the universe a strategy takes every
+ * bar, scan and reads of the instruments changed, and the reads of a slot
+ * on another core while its writer keeps rewriting it, checking no record
+ * read is torn.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "bench.h"
+#include "snap.h"
+#include "ring.h"
+#include "raw.h"
+#include "synth.h"
+
+#define CHUNK		4096		/* ticks made between the timed runs */
+#define SAMPLES		10000		/* of the universe */
+#define HOT		4		/* instruments of the contended case */
+
+struct contend
+{
+	snap_t *snap;
+	int wcpu;			/* core of the writer */
+	int rcpu;			/* core of the reader */
+	uint64_t ops;			/* reads */
+	uint64_t torn;			/* records read half old, half new */
+	uint64_t retries;
+	uint64_t start;
+	uint64_t end;
+	_Atomic int ready;
+	_Atomic int stop;
+	_Atomic int failed;
+};
+
+static snap_t *
+table(void)
+{
+	size_t size = snap_mem_size(TICK_INSTRUMENT_MAX + 1);
+	void *mem = aligned_alloc(TICK_CACHELINE, (size + TICK_CACHELINE - 1) & ~(size_t)(TICK_CACHELINE - 1));
+	snap_t *snap;
+
+	if (mem == NULL) {
+		return NULL;
+	}
+	if ((snap = snap_init(mem, TICK_INSTRUMENT_MAX + 1)) == NULL) {
+		free(mem);
+	}
+
+	return snap;
+}
+
+static int
+bench_put(const struct bench_opts *o, snap_t *snap, synth_t *s)
+{
+	static tick_rec_t chunk[CHUNK] __attribute__((aligned(TICK_CACHELINE)));
+	uint64_t start, ns = 0, i = 0, k, n;
+
+	while (i < o->ops) {
+		n = o->ops - i < CHUNK ? o->ops - i : CHUNK;
+		for (k = 0; k < n; k++) {
+			synth_tick(s, i + k, &chunk[k]);
+		}
+		start = bench_now();
+		snap_put(snap, chunk, n);
+		ns += bench_now() - start;
+		i += n;
+	}
+	bench_report("snap", "put", o->ops, ns, o->ops * sizeof(tick_rec_t));
+
+	return 0;
+}
+
+/*
+ * bench_sample - a tenth of the universe ticks between two samples, the
+ * latency of a sample is the scan and the reads of the ones changed.
+ */
+static int
+bench_sample(const struct bench_opts *o, snap_t *snap, synth_t *s)
+{
+	uint64_t *samples, *dirty, start, bits, sum = 0;
+	size_t nw = SNAP_WORDS(snap->capacity), i, k, w, n, ticks = o->instruments / 10 + 1;
+	snap_reader_t rd;
+	tick_rec_t t;
+
+	samples = malloc(SAMPLES * sizeof(*samples));
+	dirty = malloc(nw * sizeof(*dirty));
+	if (samples == NULL || dirty == NULL) {
+		free(samples);
+		free(dirty);
+		return -1;
+	}
+
+	for (i = 0; i < synth_count(s); i++) {
+		synth_snap(s, (uint32_t)i, 0, 0, &t);
+		snap_put(snap, &t, 1);
+	}
+	snap_reader_init(&rd, snap, SNAP_R_ALL);
+	for (i = 0; i < SAMPLES; i++) {
+		for (k = 0; i > 0 && k < ticks; k++) {
+			synth_tick(s, i, &t);
+			snap_put(snap, &t, 1);
+		}
+
+		start = bench_now();
+		n = snap_scan(&rd, dirty);
+		for (w = 0; w < nw && n > 0; w++) {
+			for (bits = dirty[w]; bits != 0; bits &= bits - 1) {
+				if (snap_get(&rd, (uint32_t)(w * SNAP_GROUP + (size_t)__builtin_ctzll(bits)), &t) == 0) {
+					sum += (uint64_t)t.last;
+				}
+			}
+		}
+		samples[i] = bench_now() - start;
+	}
+	bench_sink += sum;
+
+	/* the first is of the whole universe, the rest of the ticks between */
+	bench_report_lat("snap", "sample all", samples, 1);
+	bench_report_lat("snap", "sample changed", samples + 1, SAMPLES - 1);
+
+	free(samples);
+	free(dirty);
+
+	return 0;
+}
+
+/* every field of a record of the writer is its count, so a torn one shows */
+static int
+torn(const tick_rec_t *t)
+{
+	int i;
+
+	for (i = 0; i < TICK_DEPTH; i++) {
+		if (t->bid[i] != t->last || t->ask[i] != t->last) {
+			return 1;
+		}
+	}
+
+	return t->volume != t->last || t->low != t->last;
+}
+
+static void *
+writer(void *arg)
+{
+	struct contend *c = arg;
+	tick_rec_t t __attribute__((aligned(TICK_CACHELINE)));
+	int64_t i;
+	int k;
+
+	if (raw_pin_cpu(c->wcpu) != 0) {
+		c->failed = 1;
+		atomic_store_explicit(&c->ready, 1, memory_order_release);
+		return NULL;
+	}
+	memset(&t, 0, sizeof(t));
+	for (i = 1; !atomic_load_explicit(&c->stop, memory_order_relaxed); i++) {
+		t.instrument = (uint32_t)(i % HOT) + 1;
+		t.last = t.volume = t.low = i;
+		for (k = 0; k < TICK_DEPTH; k++) {
+			t.bid[k] = t.ask[k] = i;
+		}
+		snap_put(c->snap, &t, 1);
+		if (i == HOT) {
+			atomic_store_explicit(&c->ready, 1, memory_order_release);
+		}
+	}
+
+	return NULL;
+}
+
+static void *
+reader(void *arg)
+{
+	struct contend *c = arg;
+	snap_reader_t rd;
+	tick_rec_t t;
+	uint64_t i;
+
+	if (raw_pin_cpu(c->rcpu) != 0) {
+		c->failed = 1;
+	}
+	while (!atomic_load_explicit(&c->ready, memory_order_acquire) && !c->failed) {
+		ring_cpu_relax();
+	}
+
+	snap_reader_init(&rd, c->snap, 0);
+	c->start = bench_now();
+	for (i = 0; i < c->ops && !c->failed; i++) {
+		if (snap_get(&rd, (uint32_t)(i % HOT) + 1, &t) == 0) {
+			c->torn += torn(&t);
+		}
+	}
+	c->end = bench_now();
+	c->retries = rd.retries;
+	atomic_store_explicit(&c->stop, 1, memory_order_relaxed);
+
+	return NULL;
+}
+
+static int
+bench_contend(struct contend *c)
+{
+	pthread_t wt, rt;
+	char name[32];
+
+	if (pthread_create(&wt, NULL, writer, c) != 0) {
+		return -1;
+	}
+	if (pthread_create(&rt, NULL, reader, c) != 0) {
+		c->failed = 1;
+		atomic_store_explicit(&c->stop, 1, memory_order_relaxed);
+		pthread_join(wt, NULL);
+		return -1;
+	}
+	pthread_join(rt, NULL);
+	pthread_join(wt, NULL);
+
+	if (c->failed) {
+		return -1;
+	}
+	snprintf(name, sizeof(name), "get %d>%d", c->wcpu, c->rcpu);
+	bench_report("snap", name, c->ops, c->end - c->start, c->ops * sizeof(tick_rec_t));
+	if (c->torn != 0) {
+		fprintf(stderr, "snap: %lu torn records of %lu, %lu retries\n", (unsigned long)c->torn,
+			(unsigned long)c->ops, (unsigned long)c->retries);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+bench_snap(const struct bench_opts *o)
+{
+	struct contend c;
+	snap_t *snap;
+	synth_t *s;
+	int rc = 0, i;
+
+	if ((snap = table()) == NULL) {
+		return -1;
+	}
+	if ((s = synth_create(MD_T_SHFE, o->instruments, o->seed)) == NULL) {
+		free(snap);
+		return -1;
+	}
+
+	if (bench_put(o, snap, s) != 0 || bench_sample(o, snap, s) != 0) {
+		rc = -1;
+	}
+	synth_free(s);
+
+	for (i = 0; i < o->npairs; i++) {
+		if (o->pairs[i][0] == o->pairs[i][1]) {
+			continue;
+		}
+		memset(&c, 0, sizeof(c));
+		if ((c.snap = table()) == NULL) {
+			rc = -1;
+			break;
+		}
+		c.wcpu = o->pairs[i][0];
+		c.rcpu = o->pairs[i][1];
+		c.ops = o->ops * 10;
+		if (bench_contend(&c) != 0) {
+			fprintf(stderr, "snap: cores %d and %d failed\n", c.wcpu, c.rcpu);
+			rc = -1;
+		}
+		free(c.snap);
+	}
+	free(snap);
+
+	return rc;
+}
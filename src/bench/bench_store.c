@@ -0,0 +1,165 @@
+/*
+ * bench_store.c
+ *
+ * The functions are used to benchmark the columnar store: writing a file of
+ * 1min bars, and the scans the backtests make of it once it is mapped, of
+ * one column, of the whole bars, of one instrument and of time ranges.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "colstore.h"
+#include "parse.h"
+#include "synth.h"
+
+#define CONTRACTS	12		/* of the product, every one a bar a minute */
+#define RANGES		10000
+#define DAY_NS		(86400 * 1000000000ULL)
+
+static int
+write_file(const struct bench_opts *o, const char *path, uint64_t rows)
+{
+	char symbols[CONTRACTS][COL_SYMBOL_LEN];
+	struct col_row row;
+	col_writer_t *w;
+	struct stat st;
+	uint64_t start, ts, i;
+	int64_t px[CONTRACTS];
+	synth_t *s;
+	int rc = 0;
+
+	if ((w = col_writer_create("SHFE", "rb", BAR_T_MIN)) == NULL || (s = synth_create(MD_T_SHFE, 1, o->seed)) == NULL) {
+		col_writer_free(w);
+		return -1;
+	}
+	for (i = 0; i < CONTRACTS; i++) {
+		snprintf(symbols[i], sizeof(symbols[i]), "rb%04u", (unsigned int)(2501 + i));
+		px[i] = 3500;
+	}
+
+	/* the bars of every minute of the days, the contracts side by side */
+	start = bench_now();
+	ts = cn_timestamp(20250303, 9 * 3600, 0);
+	memset(&row, 0, sizeof(row));
+	for (i = 0; i < rows && rc == 0; i++) {
+		uint64_t r = synth_rand(s), c = i % CONTRACTS;
+
+		if (c == 0) {
+			ts += 60 * 1000000000ULL;
+		}
+		px[c] += (int64_t)(r % 5) - 2;
+		row.timestamp = (int64_t)ts;
+		row.trading_day = (int32_t)bar_calendar_day(ts);
+		row.symbol = symbols[c];
+		row.open = (double)px[c];
+		row.high = (double)px[c] + (double)(r >> 8 & 3);
+		row.low = (double)px[c] - (double)(r >> 10 & 3);
+		row.close = (double)px[c] + (double)(r >> 12 & 1);
+		row.volume = 1 + (int64_t)(r >> 16 & 1023);
+		row.oi = 100000 + (int64_t)(r >> 32 & 4095);
+		row.amount = row.close * (double)row.volume;
+		rc = col_writer_add(w, &row);
+	}
+	if (rc == 0) {
+		rc = col_writer_write(w, path);
+	}
+	if (rc == 0 && stat(path, &st) == 0) {
+		bench_report("store", "write", rows, bench_now() - start, (uint64_t)st.st_size);
+	}
+	col_writer_free(w);
+	synth_free(s);
+
+	return rc;
+}
+
+static void
+scans(const struct bench_opts *o, const col_file_t *f)
+{
+	uint64_t start, i, n, ns, passes, q, first, last, rows = f->nrows, found = 0;
+	double sum = 0;
+	int64_t vol = 0, span, from;
+	uint32_t code;
+
+	/* enough passes of a column for the ops, four at least */
+	passes = o->ops / rows;
+	passes = passes < 4 ? 4 : passes;
+
+	start = bench_now();
+	for (n = 0; n < passes; n++) {
+		for (i = 0; i < rows; i++) {
+			sum += f->close[i];
+		}
+	}
+	bench_report("store", "scan close", rows * passes, bench_now() - start, rows * passes * sizeof(double));
+
+	start = bench_now();
+	for (n = 0; n < passes; n++) {
+		for (i = 0; i < rows; i++) {
+			sum += f->open[i] + f->high[i] + f->low[i] + f->close[i];
+			vol += f->volume[i];
+		}
+	}
+	bench_report("store", "scan ohlcv", rows * passes, bench_now() - start,
+		     rows * passes * (4 * sizeof(double) + sizeof(int64_t)));
+
+	code = (uint32_t)col_lookup(f, "rb2501");
+	start = bench_now();
+	for (n = 0; n < passes; n++) {
+		for (i = 0; i < rows; i++) {
+			sum += f->instrument[i] == code ? f->close[i] : 0;
+		}
+	}
+	bench_report("store", "scan instrument", rows * passes, bench_now() - start,
+		     rows * passes * (sizeof(uint32_t) + sizeof(double)));
+
+	/* a day of random starts, through the footer */
+	span = f->hdr->max_ts - f->hdr->min_ts;
+	start = bench_now();
+	for (q = 0; q < RANGES; q++) {
+		from = f->hdr->min_ts + (int64_t)((q * 2654435761ULL) % (uint64_t)(span > 0 ? span : 1));
+		found += col_range(f, from, from + (int64_t)DAY_NS, &first, &last);
+	}
+	ns = bench_now() - start;
+	bench_report("store", "range day", RANGES, ns, 0);
+
+	bench_sink += (uint64_t)sum + (uint64_t)vol + found;
+}
+
+int
+bench_store(const struct bench_opts *o)
+{
+	char dir[256], path[320];
+	col_file_t f;
+	int made = 0, rc = -1;
+
+	if (o->dir != NULL) {
+		snprintf(dir, sizeof(dir), "%s", o->dir);
+	} else {
+		snprintf(dir, sizeof(dir), "/tmp/bench.XXXXXX");
+		if (mkdtemp(dir) == NULL) {
+			fprintf(stderr, "mkdtemp(%s) failed\n", dir);
+			return -1;
+		}
+		made = 1;
+	}
+	snprintf(path, sizeof(path), "%s/rb.1min%s", dir, COL_SUFFIX);
+
+	if (write_file(o, path, o->ops) == 0 && col_open(&f, path) == 0) {
+		scans(o, &f);
+		col_close(&f);
+		rc = 0;
+	}
+
+	unlink(path);
+	if (made) {
+		rmdir(dir);
+	}
+
+	return rc;
+}
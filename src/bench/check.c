@@ -0,0 +1,149 @@
+/*
+ * check.c
+ *
+ * The program runs the round-trip checks of the file formats of the store
+ * and the checks of the stages of the pipeline, the ones ctest runs, in a
+ * temporary directory or the one given. It exits with 1 if any of them
+ * failed.
+ *
+ *	check
+ *	check -s record -d /data/tmp
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include "check.h"
+
+#define RECORDS		300000
+#define INSTRUMENTS	200
+
+static const struct {
+	const char *name;
+	int (*run)(const struct check_opts *o);
+} checks[] = {
+	{ "record", check_record },
+	{ "colstore", check_colstore },
+	{ "colseg", check_colseg },
+	{ "instrument", check_instrument },
+	{ "decode", check_decode },
+	{ "bar", check_bar },
+	{ "rank", check_rank },
+	{ "ring", check_ring },
+	{ "bus", check_bus },
+	{ "udp", check_udp },
+};
+
+#define NCHECKS	(sizeof(checks) / sizeof(checks[0]))
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-s check[,check]] [-n records] [-i instruments] [-d dir] [-S seed]\n"
+		"  -s checks    record, colstore, colseg, instrument, decode, bar, rank, ring, bus, udp (default all)\n"
+		"  -n records   of a file, about (default %d)\n"
+		"  -i count     instruments of the synthetic data (default %d)\n"
+		"  -d dir       directory of the files (default a temporary one in /tmp)\n"
+		"  -S seed      of the synthetic data\n",
+		prog, RECORDS, INSTRUMENTS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct check_opts o, co;
+	char base[4096], dir[4096 + 64], *list = NULL, *tok, *save = NULL;
+	int run[NCHECKS], made = 0, opt, rc = 0;
+	size_t i;
+
+	memset(&o, 0, sizeof(o));
+	o.n = RECORDS;
+	o.instruments = INSTRUMENTS;
+	o.seed = 20250303;
+
+	while ((opt = getopt(argc, argv, "s:n:i:d:S:")) != -1) {
+		switch (opt) {
+		case 's':
+			list = optarg;
+			break;
+		case 'n':
+			o.n = strtoull(optarg, NULL, 10);
+			break;
+		case 'i':
+			o.instruments = (uint32_t)atoi(optarg);
+			break;
+		case 'd':
+			o.dir = optarg;
+			break;
+		case 'S':
+			o.seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (o.n == 0 || o.instruments == 0 || optind != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < NCHECKS; i++) {
+		run[i] = list == NULL;
+	}
+	for (tok = list != NULL ? strtok_r(list, ",", &save) : NULL; tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < NCHECKS && strcmp(checks[i].name, tok) != 0; i++)
+			;
+		if (i == NCHECKS) {
+			fprintf(stderr, "unknown check %s\n", tok);
+			return 1;
+		}
+		run[i] = 1;
+	}
+
+	if (o.dir != NULL) {
+		snprintf(base, sizeof(base), "%s", o.dir);
+	} else {
+		snprintf(base, sizeof(base), "/tmp/check.XXXXXX");
+		if (mkdtemp(base) == NULL) {
+			fprintf(stderr, "mkdtemp(%s) failed\n", base);
+			return 1;
+		}
+		made = 1;
+	}
+
+	/* every check in a directory of its own, it removes its files */
+	for (i = 0; i < NCHECKS; i++) {
+		if (!run[i]) {
+			continue;
+		}
+		snprintf(dir, sizeof(dir), "%s/%s", base, checks[i].name);
+		if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+			fprintf(stderr, "cannot make %s: %s\n", dir, strerror(errno));
+			rc = 1;
+			continue;
+		}
+		co = o;
+		co.dir = dir;
+		if (checks[i].run(&co) != 0) {
+			printf("%-12s FAILED\n", checks[i].name);
+			rc = 1;
+		} else {
+			printf("%-12s ok\n", checks[i].name);
+		}
+		fflush(stdout);
+		rmdir(dir);
+	}
+	if (made) {
+		rmdir(base);
+	}
+
+	return rc;
+}
@@ -0,0 +1,50 @@
+/*
+ * check.h
+ *
+ * The file contains the definition of the options of the round-trip checks
+ * of the file formats and of the checks of the stages of the pipeline, and
+ * the functions' prototype of the checks.
+ *
+ * A check writes a file of the format from synthetic data with its writer,
+ * reads it back with its reader and compares what it wrote with what it
+ * read, or feeds a stage and compares what comes out with what it should,
+ * printing the first difference. ctest runs every one of them:
+ *
+ *	check
+ *	check -s record -n 100000
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+struct check_opts
+{
+	uint64_t n;			/* records of a file, about */
+	uint32_t instruments;		/* of the synthetic data */
+	uint64_t seed;
+	const char *dir;		/* of the files, a directory of its own for every check */
+};
+
+/*
+ * The checks return 0, -1 when what was read back is not what was written,
+ * a stage did not give what it should, or a file could not be written or
+ * read.
+ */
+int check_record(const struct check_opts *o);
+int check_colstore(const struct check_opts *o);
+int check_colseg(const struct check_opts *o);
+int check_instrument(const struct check_opts *o);
+int check_decode(const struct check_opts *o);
+int check_bar(const struct check_opts *o);
+int check_rank(const struct check_opts *o);
+int check_ring(const struct check_opts *o);
+int check_bus(const struct check_opts *o);
+int check_udp(const struct check_opts *o);
+
+#endif		/* __CHECK_H__ */
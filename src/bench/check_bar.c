@@ -0,0 +1,245 @@
+/*
+ * check_bar.c
+ *
+ * The functions are used to check the bucketing of the bar engine with the
+ * ticks of two instruments over a week: a tick before the open goes to the
+ * first bar of the segment and one in the grace after the close to the
+ * last, a bar never spans a break, the night session across midnight and
+ * the one of the evening before a weekend belong to the next trading day,
+ * a tick between the segments or of a day already rolled is counted and
+ * dropped, and the day and week bars close with their trading day and
+ * week, the ones still open flushed as partial.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "bar.h"
+#include "parse.h"
+
+#define BARS_MAX	64
+#define TYPES		(BAR_MASK(BAR_T_MIN) | BAR_MASK(BAR_T_HOUR) | BAR_MASK(BAR_T_DAY) | BAR_MASK(BAR_T_WEEK))
+
+/* China Standard Time of a calendar day, AT() the day and seconds of an initializer */
+#define T(day, h, m, s)	cn_timestamp(day, (h) * 3600 + (m) * 60 + (s), 0)
+#define AT(day, h, m)	day, (h) * 3600 + (m) * 60
+#define PX(p)		((int64_t)(p) * TICK_PX_SCALE)
+
+enum { RB, AU, NSYMBOLS };
+
+static const char *const symbols[NSYMBOLS] = { "rb2505", "au2506" };	/* 21:00-23:00, and to 02:30 */
+
+struct bars
+{
+	bar_rec_t bar[BARS_MAX];
+	size_t n;
+};
+
+static const struct tick
+{
+	int sym;
+	uint32_t day, h, m, s;
+	int last;
+	int64_t volume;
+} ticks[] = {
+	/* trading day 20250303, a Monday, from the Friday night */
+	{ RB, 20250228, 20, 58, 0, 100, 1 },	/* before the open, to the first bar */
+	{ RB, 20250228, 21, 0, 30, 102, 3 },
+	{ RB, 20250228, 21, 1, 10, 99, 4 },
+	{ RB, 20250228, 22, 59, 59, 101, 6 },
+	{ RB, 20250228, 23, 0, 2, 103, 7 },	/* in the grace, to the last bar */
+	{ RB, 20250228, 23, 30, 0, 500, 8 },	/* after the night session */
+	{ AU, 20250228, 23, 59, 30, 500, 1 },
+	{ AU, 20250301, 0, 0, 10, 501, 3 },	/* past midnight, still of the night */
+	{ -1, 20250301, 0, 5, 0, 0, 0 },	/* bar_engine_advance() */
+	{ RB, 20250303, 10, 14, 30, 104, 9 },
+	{ RB, 20250303, 10, 30, 5, 98, 10 },	/* after the break, the hour bar starts at it */
+
+	/* trading day 20250304, the volume of the exchange restarts */
+	{ RB, 20250303, 21, 0, 0, 105, 2 },
+	{ RB, 20250303, 10, 31, 0, 97, 11 },	/* of the day rolled */
+
+	/* trading day 20250307, the last of the week */
+	{ RB, 20250306, 21, 10, 0, 110, 5 },
+
+	/* trading day 20250310, from the Friday night */
+	{ RB, 20250307, 21, 0, 0, 90, 1 },
+};
+
+#define NTICKS		(sizeof(ticks) / sizeof(ticks[0]))
+#define ADVANCED	8		/* bars emitted once the clock is advanced */
+
+static const struct expected
+{
+	int sym;
+	int type;
+	uint32_t start_day, start_sec;	/* AT() */
+	uint32_t end_day, end_sec;
+	uint32_t trading_day;
+	int open, high, low, close;
+	int64_t volume;
+	uint32_t ticks;
+	uint16_t flags;
+} expected[] = {
+	{ RB, BAR_T_MIN, AT(20250228, 21, 0), AT(20250228, 21, 1), 20250303, 100, 102, 100, 102, 2, 2, 0 },
+	{ RB, BAR_T_MIN, AT(20250228, 21, 1), AT(20250228, 21, 2), 20250303, 99, 99, 99, 99, 1, 1, 0 },
+	{ RB, BAR_T_MIN, AT(20250228, 22, 59), AT(20250228, 23, 0), 20250303, 101, 103, 101, 103, 3, 2, 0 },
+	{ RB, BAR_T_MIN, AT(20250303, 10, 14), AT(20250303, 10, 15), 20250303, 104, 104, 104, 104, 2, 1, 0 },
+	{ RB, BAR_T_MIN, AT(20250303, 10, 30), AT(20250303, 10, 31), 20250303, 98, 98, 98, 98, 1, 1, 0 },
+	{ RB, BAR_T_MIN, AT(20250303, 21, 0), AT(20250303, 21, 1), 20250304, 105, 105, 105, 105, 2, 1, 0 },
+	{ RB, BAR_T_MIN, AT(20250306, 21, 10), AT(20250306, 21, 11), 20250307, 110, 110, 110, 110, 5, 1, 0 },
+	{ RB, BAR_T_MIN, AT(20250307, 21, 0), AT(20250307, 21, 1), 20250310, 90, 90, 90, 90, 1, 1,
+	  BAR_F_PARTIAL },
+
+	{ RB, BAR_T_HOUR, AT(20250228, 21, 0), AT(20250228, 22, 0), 20250303, 100, 102, 99, 99, 3, 3, 0 },
+	{ RB, BAR_T_HOUR, AT(20250228, 22, 0), AT(20250228, 23, 0), 20250303, 101, 103, 101, 103, 3, 2, 0 },
+	{ RB, BAR_T_HOUR, AT(20250303, 10, 0), AT(20250303, 10, 15), 20250303, 104, 104, 104, 104, 2, 1, 0 },
+	{ RB, BAR_T_HOUR, AT(20250303, 10, 30), AT(20250303, 11, 0), 20250303, 98, 98, 98, 98, 1, 1, 0 },
+	{ RB, BAR_T_HOUR, AT(20250303, 21, 0), AT(20250303, 22, 0), 20250304, 105, 105, 105, 105, 2, 1, 0 },
+	{ RB, BAR_T_HOUR, AT(20250306, 21, 0), AT(20250306, 22, 0), 20250307, 110, 110, 110, 110, 5, 1, 0 },
+	{ RB, BAR_T_HOUR, AT(20250307, 21, 0), AT(20250307, 22, 0), 20250310, 90, 90, 90, 90, 1, 1,
+	  BAR_F_PARTIAL },
+
+	{ RB, BAR_T_DAY, AT(20250228, 21, 0), AT(20250303, 15, 0), 20250303, 100, 104, 98, 98, 10, 7, 0 },
+	{ RB, BAR_T_DAY, AT(20250303, 21, 0), AT(20250304, 15, 0), 20250304, 105, 105, 105, 105, 2, 1, 0 },
+	{ RB, BAR_T_DAY, AT(20250306, 21, 0), AT(20250307, 15, 0), 20250307, 110, 110, 110, 110, 5, 1, 0 },
+	{ RB, BAR_T_DAY, AT(20250307, 21, 0), AT(20250310, 15, 0), 20250310, 90, 90, 90, 90, 1, 1,
+	  BAR_F_PARTIAL },
+
+	{ RB, BAR_T_WEEK, AT(20250228, 21, 0), AT(20250307, 15, 0), 20250307, 100, 110, 98, 110, 17, 9, 0 },
+	{ RB, BAR_T_WEEK, AT(20250307, 21, 0), AT(20250310, 15, 0), 20250310, 90, 90, 90, 90, 1, 1,
+	  BAR_F_PARTIAL },
+
+	{ AU, BAR_T_MIN, AT(20250228, 23, 59), AT(20250301, 0, 0), 20250303, 500, 500, 500, 500, 0, 1, 0 },
+	{ AU, BAR_T_MIN, AT(20250301, 0, 0), AT(20250301, 0, 1), 20250303, 501, 501, 501, 501, 2, 1, 0 },
+	{ AU, BAR_T_HOUR, AT(20250228, 23, 0), AT(20250301, 0, 0), 20250303, 500, 500, 500, 500, 0, 1, 0 },
+	{ AU, BAR_T_HOUR, AT(20250301, 0, 0), AT(20250301, 1, 0), 20250303, 501, 501, 501, 501, 2, 1, 0 },
+	{ AU, BAR_T_DAY, AT(20250228, 21, 0), AT(20250303, 15, 0), 20250303, 500, 501, 500, 501, 3, 2, 0 },
+	{ AU, BAR_T_WEEK, AT(20250228, 21, 0), AT(20250303, 15, 0), 20250303, 500, 501, 500, 501, 3, 2,
+	  BAR_F_PARTIAL },
+};
+
+#define NEXPECTED	(sizeof(expected) / sizeof(expected[0]))
+
+static void
+on_bar(const bar_rec_t *bar, void *arg)
+{
+	struct bars *b = (struct bars *)arg;
+
+	if (b->n < BARS_MAX) {
+		b->bar[b->n] = *bar;
+	}
+	b->n++;
+}
+
+static void
+make_tick(tick_rec_t *t, const struct tick *k, const uint32_t *ids)
+{
+	memset(t, 0, sizeof(*t));
+	t->timestamp = T(k->day, k->h, k->m, k->s);
+	t->instrument = ids[k->sym];
+	t->md_type = MD_T_SHFE;
+	t->last = PX(k->last);
+	t->volume = k->volume;
+	t->open_interest = 1000;
+}
+
+/* the bar emitted of the expected one, all of its fields */
+static int
+match(const struct bars *b, const struct expected *e, const uint32_t *ids)
+{
+	uint64_t start = cn_timestamp(e->start_day, e->start_sec, 0), end = cn_timestamp(e->end_day, e->end_sec, 0);
+	const bar_rec_t *r;
+	size_t i;
+
+	for (i = 0; i < b->n; i++) {
+		r = &b->bar[i];
+		if (r->instrument == ids[e->sym] && r->type == e->type && r->start == start) {
+			break;
+		}
+	}
+	if (i == b->n) {
+		fprintf(stderr, "bar: the %s bar of %s of %u is not emitted\n", bar_type_names[e->type],
+			symbols[e->sym], e->trading_day);
+		return -1;
+	}
+	if (r->end != end || r->trading_day != e->trading_day || r->md_type != MD_T_SHFE ||
+	    r->open != PX(e->open) || r->high != PX(e->high) || r->low != PX(e->low) || r->close != PX(e->close) ||
+	    r->volume != e->volume || r->ticks != e->ticks || r->flags != e->flags || r->open_interest != 1000) {
+		fprintf(stderr, "bar: the %s bar of %s of %u, bar %lu, is not the one expected\n",
+			bar_type_names[e->type], symbols[e->sym], e->trading_day, (unsigned long)i);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+check_bar(const struct check_opts *o)
+{
+	struct bar_conf conf;
+	struct bar_stats st;
+	struct bars *b;
+	bar_engine_t *eng;
+	uint32_t ids[NSYMBOLS];
+	tick_rec_t t;
+	size_t i;
+	int rc = -1;
+
+	(void)o;
+	for (i = 0; i < NSYMBOLS; i++) {
+		ids[i] = tick_intern(symbols[i], strlen(symbols[i]));
+	}
+	if ((b = calloc(1, sizeof(*b))) == NULL) {
+		return -1;
+	}
+	memset(&conf, 0, sizeof(conf));
+	conf.types = TYPES;
+	conf.on_bar = on_bar;
+	conf.arg = b;
+	conf.instruments = NSYMBOLS;
+	if ((eng = bar_engine_create(&conf)) == NULL) {
+		free(b);
+		return -1;
+	}
+
+	for (i = 0; i < NTICKS; i++) {
+		if (ticks[i].sym >= 0) {
+			make_tick(&t, &ticks[i], ids);
+			bar_engine_tick(eng, &t);
+			continue;
+		}
+
+		/* the bars ended and no tick to close them */
+		bar_engine_advance(eng, T(ticks[i].day, ticks[i].h, ticks[i].m, ticks[i].s));
+		if (b->n != ADVANCED) {
+			fprintf(stderr, "bar: %lu bars emitted on advance, not %d\n", (unsigned long)b->n, ADVANCED);
+			goto out;
+		}
+	}
+	bar_engine_flush(eng, T(20250307, 21, 0, 30));
+
+	bar_engine_stats(eng, &st);
+	if (b->n != NEXPECTED || st.bars != NEXPECTED || st.ticks != NTICKS - 1 || st.late != 1 ||
+	    st.off_session != 1) {
+		fprintf(stderr, "bar: %lu bars of %lu ticks, %lu late and %lu off the session, not %lu, %lu, 1 and 1\n",
+			(unsigned long)b->n, (unsigned long)st.ticks, (unsigned long)st.late,
+			(unsigned long)st.off_session, (unsigned long)NEXPECTED, (unsigned long)(NTICKS - 1));
+		goto out;
+	}
+	for (i = 0; i < NEXPECTED; i++) {
+		if (match(b, &expected[i], ids) != 0) {
+			goto out;
+		}
+	}
+	rc = 0;
+
+out:
+	bar_engine_destroy(eng);
+	free(b);
+
+	return rc;
+}
@@ -0,0 +1,200 @@
+/*
+ * check_bus.c
+ *
+ * The functions are used to check the tick bus between a writer and the
+ * readers mapping it: the symbols interned by the writer resolved by a
+ * read-only mapping, a replay reader given the records retained in order
+ * and a reader at the head only the ones after it, and a gating reader of
+ * a writable mapping holding the writer back with every record refused
+ * counted once, and a claim cut short at the gate published as it wraps.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+#include "bus.h"
+
+#define CAPACITY	256
+#define SYMBOLS		16
+
+static void
+make_tick(tick_rec_t *t, const uint32_t *ids, uint32_t seq)
+{
+	memset(t, 0, sizeof(*t));
+	t->instrument = ids[seq % SYMBOLS];
+	t->seq = seq;
+	t->md_type = MD_T_JUPITER;
+	t->last = (int64_t)seq * 100;
+}
+
+static int
+push(tick_bus_t *bus, const uint32_t *ids, uint32_t from, uint32_t n)
+{
+	tick_rec_t t;
+	uint32_t i;
+
+	for (i = from; i < from + n; i++) {
+		make_tick(&t, ids, i);
+		if (bus_push(bus, &t) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* the next n records of the reader are from on, and the last if all */
+static int
+read_in_order(ring_reader_t *rd, const uint32_t *ids, uint32_t from, uint32_t n, int all, const char *what)
+{
+	tick_rec_t t;
+	uint32_t i;
+
+	for (i = from; i < from + n; i++) {
+		if (ring_read(rd, &t, 1) != 1 || t.seq != i || t.instrument != ids[i % SYMBOLS] ||
+		    t.last != (int64_t)i * 100) {
+			fprintf(stderr, "bus: %s: record %u of %u to %u is not the one pushed\n", what, i, from,
+				from + n - 1);
+			return -1;
+		}
+	}
+	if (all && ring_read(rd, &t, 1) != 0) {
+		fprintf(stderr, "bus: %s: more than %u records\n", what, n);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+check_readers(tick_bus_t *w, const char *name, const uint32_t *ids)
+{
+	ring_reader_t replay, head;
+	char symbol[TICK_SYMBOL_LEN];
+	tick_bus_t r;
+	uint32_t i;
+	int rc = -1;
+
+	if (bus_open(&r, name, 0) != 0) {
+		fprintf(stderr, "bus: cannot open %s\n", name);
+		return -1;
+	}
+	for (i = 0; i < SYMBOLS; i++) {
+		snprintf(symbol, sizeof(symbol), "bus%02u", i);
+		if (bus_find(&r, symbol) != ids[i] || bus_symbol(&r, ids[i]) == NULL ||
+		    strcmp(bus_symbol(&r, ids[i]), symbol) != 0) {
+			fprintf(stderr, "bus: %s is not id %u of the reader\n", symbol, ids[i]);
+			goto out;
+		}
+	}
+	if (bus_find(&r, "nosuch") != 0) {
+		fprintf(stderr, "bus: a symbol not interned is found\n");
+		goto out;
+	}
+
+	/* a read-only mapping holds nobody back, the oldest are overwritten */
+	if (push(w, ids, 0, 2 * CAPACITY + 10) != 0 || bus_reader(&r, &replay, BUS_R_REPLAY) != 0 ||
+	    bus_reader(&r, &head, 0) != 0) {
+		goto out;
+	}
+	if (read_in_order(&replay, ids, CAPACITY + 10, CAPACITY, 1, "replayed") != 0 ||
+	    read_in_order(&head, ids, 0, 0, 1, "at the head") != 0 || push(w, ids, 2 * CAPACITY + 10, 5) != 0 ||
+	    read_in_order(&head, ids, 2 * CAPACITY + 10, 5, 1, "at the head") != 0) {
+		goto out;
+	}
+	rc = 0;
+
+out:
+	bus_close(&r);
+
+	return rc;
+}
+
+static int
+check_gating(tick_bus_t *w, const char *name, const uint32_t *ids, uint32_t from)
+{
+	uint64_t drops = atomic_load(&w->ring->full_drops), first;
+	uint32_t pad = (uint32_t)(3 * CAPACITY / 4 - atomic_load(&w->ring->claim) % CAPACITY) % CAPACITY;
+	ring_reader_t rd;
+	tick_bus_t r;
+	tick_rec_t t;
+	size_t got, i;
+	int rc = -1;
+
+	/* the reader joins three quarters into the ring, so the claim below wraps */
+	if (push(w, ids, from - pad, pad) != 0) {
+		return -1;
+	}
+	if (bus_open(&r, name, BUS_O_RDWR) != 0 || bus_reader(&r, &rd, BUS_R_GATING) != 0) {
+		fprintf(stderr, "bus: cannot open %s with a gating reader\n", name);
+		bus_close(&r);
+		return -1;
+	}
+
+	/* full behind the reader, a push refused is counted once */
+	make_tick(&t, ids, from + CAPACITY);
+	if (push(w, ids, from, CAPACITY) != 0 || bus_push(w, &t) == 0 ||
+	    atomic_load(&w->ring->full_drops) != drops + 1) {
+		fprintf(stderr, "bus: a full bus took a record or did not count it\n");
+		goto out;
+	}
+	if (read_in_order(&rd, ids, from, CAPACITY / 2, 0, "gating") != 0) {
+		goto out;
+	}
+
+	/* a claim of a whole ring gets the half read, wraps and is published as one */
+	if ((got = ring_claim(w->ring, CAPACITY, &first)) != CAPACITY / 2) {
+		fprintf(stderr, "bus: a claim of %d with %d free got %lu\n", CAPACITY, CAPACITY / 2, (unsigned long)got);
+		goto out;
+	}
+	ring_drop(w->ring, CAPACITY - got);
+	for (i = 0; i < got; i++) {
+		make_tick(ring_slot(w->ring, first + i), ids, from + CAPACITY + (uint32_t)i);
+	}
+	bus_publish(w, first, got);
+	if (atomic_load(&w->ring->full_drops) != drops + 1 + CAPACITY - got ||
+	    read_in_order(&rd, ids, from + CAPACITY / 2, CAPACITY, 1, "claimed short") != 0) {
+		goto out;
+	}
+	rc = 0;
+
+out:
+	ring_reader_fini(&rd);
+	bus_close(&r);
+
+	return rc;
+}
+
+int
+check_bus(const struct check_opts *o)
+{
+	char name[BUS_NAME_MAX], symbol[TICK_SYMBOL_LEN];
+	uint32_t ids[SYMBOLS], i;
+	tick_bus_t w;
+	int rc;
+
+	(void)o;
+	snprintf(name, sizeof(name), "check_%d", (int)getpid());
+	if (bus_create(&w, name, CAPACITY, MD_T_JUPITER) != 0) {
+		fprintf(stderr, "bus: cannot create %s\n", name);
+		return -1;
+	}
+	for (i = 0; i < SYMBOLS; i++) {
+		snprintf(symbol, sizeof(symbol), "bus%02u", i);
+		ids[i] = tick_intern(symbol, strlen(symbol));
+	}
+
+	rc = check_readers(&w, name, ids);
+	if (rc == 0) {
+		rc = check_gating(&w, name, ids, 4 * CAPACITY);
+	}
+
+	/* the symbols of the process live in the mapping of the writer now, it stays */
+	bus_unlink(name);
+
+	return rc;
+}
@@ -0,0 +1,252 @@
+/*
+ * check_colseg.c
+ *
+ * The functions are used to check the round trip of the segment files of a
+ * continuous series: the segments of the rolls written by a first create
+ * and appends of a few at a time, read back as written, and written anew
+ * with truncate. The rows of the majors col_seg_rows() picks of a file of
+ * the daily bars of the contracts are the major of every day in turn, and
+ * col_adjust() of their closes is what the formulas of colstore.h give.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include "check.h"
+#include "colstore.h"
+#include "parse.h"
+#include "synth.h"
+
+#define CONTRACTS	12
+#define DAYS		1000		/* of the daily bars */
+#define ROLL_DAYS	20		/* the major rolls to the next contract every so many days */
+#define SEGMENTS	(DAYS / ROLL_DAYS)
+#define APPEND		7		/* segments of an append */
+#define DAY_NS		(86400 * 1000000000ULL)
+
+struct series
+{
+	char symbols[CONTRACTS][COL_SYMBOL_LEN];
+	int32_t days[DAYS];
+	double close[DAYS][CONTRACTS];
+	struct col_segment segs[SEGMENTS];
+};
+
+static void
+make_series(synth_t *s, struct series *sr)
+{
+	uint64_t ts = cn_timestamp(20250102, 15 * 3600, 0), r;
+	struct col_segment *g;
+	int d, c, k;
+
+	for (c = 0; c < CONTRACTS; c++) {
+		snprintf(sr->symbols[c], COL_SYMBOL_LEN, "rb%04u", (unsigned int)(2501 + c));
+	}
+	for (d = 0; d < DAYS; d++, ts += DAY_NS) {
+		sr->days[d] = (int32_t)bar_calendar_day(ts);
+		for (c = 0; c < CONTRACTS; c++) {
+			r = synth_rand(s);
+			sr->close[d][c] = (d > 0 ? sr->close[d - 1][c] : 3500 + 10 * c) + (double)(r % 9) - 4;
+		}
+	}
+
+	/* the gap and ratio of the close of the new major to the old one on its first day */
+	memset(sr->segs, 0, sizeof(sr->segs));
+	for (k = 0; k < SEGMENTS; k++) {
+		g = &sr->segs[k];
+		d = k * ROLL_DAYS;
+		c = k % CONTRACTS;
+		g->trading_day = sr->days[d];
+		snprintf(g->symbol, sizeof(g->symbol), "%s", sr->symbols[c]);
+		if (k == 0) {
+			g->ratio = g->cum_ratio = 1;
+			continue;
+		}
+		g->gap = sr->close[d][c] - sr->close[d][(k - 1) % CONTRACTS];
+		g->ratio = sr->close[d][c] / sr->close[d][(k - 1) % CONTRACTS];
+		g->cum_gap = g[-1].cum_gap + g->gap;
+		g->cum_ratio = g[-1].cum_ratio * g->ratio;
+	}
+}
+
+static int
+compare_segs(const char *path, const struct col_segment *segs, uint64_t n, const char *what)
+{
+	col_seg_file_t f;
+	int rc = 0;
+
+	if (col_seg_open(&f, path) != 0) {
+		fprintf(stderr, "colseg: %s: cannot open %s\n", what, path);
+		return -1;
+	}
+	if (f.nsegments != n || memcmp(f.segments, segs, n * sizeof(*segs)) != 0) {
+		fprintf(stderr, "colseg: %s: %lu segments read, not the %lu written\n", what,
+			(unsigned long)f.nsegments, (unsigned long)n);
+		rc = -1;
+	}
+	col_seg_close(&f);
+
+	return rc;
+}
+
+static int
+write_bars(const struct series *sr, const char *path)
+{
+	struct col_row row;
+	col_writer_t *w;
+	int d, c, rc = 0;
+
+	if ((w = col_writer_create("SHFE", "rb", BAR_T_DAY)) == NULL) {
+		return -1;
+	}
+	memset(&row, 0, sizeof(row));
+	for (d = 0; d < DAYS && rc == 0; d++) {
+		for (c = 0; c < CONTRACTS && rc == 0; c++) {
+			row.timestamp = (int64_t)cn_timestamp((uint32_t)sr->days[d], 15 * 3600, 0);
+			row.trading_day = sr->days[d];
+			row.symbol = sr->symbols[c];
+			row.open = row.high = row.low = row.close = sr->close[d][c];
+			row.volume = 1000;
+			row.oi = 100000;
+			rc = col_writer_add(w, &row);
+		}
+	}
+	if (rc == 0) {
+		rc = col_writer_write(w, path);
+	}
+	col_writer_free(w);
+
+	return rc;
+}
+
+/* the formulas of colstore.h, the segment of a day the last begun by it */
+static double
+adjusted(const struct col_segment *segs, int method, int32_t day, double px)
+{
+	const struct col_segment *g = segs, *last = &segs[SEGMENTS - 1];
+	int k;
+
+	for (k = 1; k < SEGMENTS && segs[k].trading_day <= day; k++) {
+		g = &segs[k];
+	}
+	switch (method) {
+	case COL_ADJ_FORWARD:
+		return px - g->cum_gap;
+	case COL_ADJ_FORWARD_RATIO:
+		return px / g->cum_ratio;
+	case COL_ADJ_BACKWARD:
+		return px + last->cum_gap - g->cum_gap;
+	case COL_ADJ_BACKWARD_RATIO:
+		return px * last->cum_ratio / g->cum_ratio;
+	default:
+		return px;
+	}
+}
+
+static int
+check_majors(const struct series *sr, const char *path)
+{
+	static uint64_t rows[DAYS * CONTRACTS];
+	static double px[DAYS], out[DAYS];
+	static int32_t day[DAYS];
+	col_file_t f;
+	uint64_t m, i;
+	int method, rc = 0, k;
+	double want;
+
+	if (col_open(&f, path) != 0) {
+		fprintf(stderr, "colseg: cannot open %s\n", path);
+		return -1;
+	}
+	if ((m = col_seg_rows(&f, sr->segs, SEGMENTS, rows)) != DAYS) {
+		fprintf(stderr, "colseg: %lu rows of majors of %d days\n", (unsigned long)m, DAYS);
+		col_close(&f);
+		return -1;
+	}
+	for (i = 0; i < m; i++) {
+		k = (int)i / ROLL_DAYS;
+		if (f.trading_day[rows[i]] != sr->days[i] ||
+		    strncmp(f.symbols[f.instrument[rows[i]]], sr->segs[k].symbol, COL_SYMBOL_LEN) != 0) {
+			fprintf(stderr, "colseg: the row of day %d is not of its major %s\n", sr->days[i],
+				sr->segs[k].symbol);
+			rc = -1;
+			break;
+		}
+		day[i] = f.trading_day[rows[i]];
+		px[i] = f.close[rows[i]];
+	}
+	col_close(&f);
+
+	for (method = 0; method < COL_ADJ_MAX && rc == 0; method++) {
+		col_adjust(sr->segs, SEGMENTS, method, day, px, out, m);
+		for (i = 0; i < m; i++) {
+			want = adjusted(sr->segs, method, day[i], px[i]);
+			if (fabs(out[i] - want) > 1e-9 * fabs(want)) {
+				fprintf(stderr, "colseg: %s of day %d is %.10f, not %.10f\n", col_adjust_names[method],
+					day[i], out[i], want);
+				rc = -1;
+				break;
+			}
+		}
+	}
+
+	return rc;
+}
+
+int
+check_colseg(const struct check_opts *o)
+{
+	char path[PATH_MAX], bars[PATH_MAX];
+	struct series *sr;
+	uint64_t k, n;
+	synth_t *s;
+	int rc = -1;
+
+	if ((sr = malloc(sizeof(*sr))) == NULL) {
+		return -1;
+	}
+	if ((s = synth_create(MD_T_SHFE, 1, o->seed)) == NULL) {
+		free(sr);
+		return -1;
+	}
+	make_series(s, sr);
+	synth_free(s);
+	snprintf(path, sizeof(path), "%s/rb%s", o->dir, COL_SEG_SUFFIX);
+	snprintf(bars, sizeof(bars), "%s/rb.1d%s", o->dir, COL_SUFFIX);
+
+	/* made by the first roll, then a few at a time, an empty append among them */
+	if (col_seg_append(path, sr->segs, 1, 0) != 0 || col_seg_append(path, sr->segs + 1, 0, 0) != 0) {
+		goto out;
+	}
+	for (k = 1; k < SEGMENTS; k += n) {
+		n = SEGMENTS - k < APPEND ? SEGMENTS - k : APPEND;
+		if (col_seg_append(path, sr->segs + k, n, 0) != 0) {
+			goto out;
+		}
+	}
+	if (compare_segs(path, sr->segs, SEGMENTS, "appended") != 0) {
+		goto out;
+	}
+
+	if (write_bars(sr, bars) != 0 || check_majors(sr, bars) != 0) {
+		goto out;
+	}
+
+	/* a rebuild writes the file anew */
+	if (col_seg_append(path, sr->segs, 3, 1) != 0 || compare_segs(path, sr->segs, 3, "truncated") != 0) {
+		goto out;
+	}
+	rc = 0;
+
+out:
+	unlink(path);
+	unlink(bars);
+	free(sr);
+
+	return rc;
+}
@@ -0,0 +1,217 @@
+/*
+ * check_colstore.c
+ *
+ * The functions are used to check the round trip of the columnar bar
+ * files: the bars of the contracts of a product written in two goes, the
+ * second loading the file of the first, appending the rest and rewriting
+ * some bars of the first, added out of order, then every row of the file
+ * compared with the bars sorted and the last of a (timestamp, instrument)
+ * kept. A copy with an instrument code out of its dict is a bad file.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "check.h"
+#include "colstore.h"
+#include "parse.h"
+#include "synth.h"
+
+#define CONTRACTS	12		/* of the product, every one a bar a minute */
+#define REWRITE		7		/* every REWRITE-th bar of the first go is rewritten */
+
+/* the bars of the file, i / CONTRACTS the minute and i % CONTRACTS the contract */
+static void
+make_rows(synth_t *s, struct col_row *rows, uint64_t n, char (*symbols)[COL_SYMBOL_LEN])
+{
+	uint64_t ts = cn_timestamp(20250303, 9 * 3600, 0), i, r, c;
+	int64_t px[CONTRACTS];
+
+	for (c = 0; c < CONTRACTS; c++) {
+		snprintf(symbols[c], COL_SYMBOL_LEN, "rb%04u", (unsigned int)(2501 + c));
+		px[c] = 3500;
+	}
+	for (i = 0; i < n; i++) {
+		r = synth_rand(s);
+		c = i % CONTRACTS;
+		if (c == 0) {
+			ts += 60 * 1000000000ULL;
+		}
+		px[c] += (int64_t)(r % 5) - 2;
+		rows[i].timestamp = (int64_t)ts;
+		rows[i].trading_day = (int32_t)bar_calendar_day(ts);
+		rows[i].symbol = symbols[c];
+		rows[i].open = (double)px[c];
+		rows[i].high = (double)px[c] + (double)(r >> 8 & 3);
+		rows[i].low = (double)px[c] - (double)(r >> 10 & 3);
+		rows[i].close = (double)px[c] + (double)(r >> 12 & 1);
+		rows[i].volume = 1 + (int64_t)(r >> 16 & 1023);
+		rows[i].oi = 100000 + (int64_t)(r >> 32 & 4095);
+		rows[i].amount = rows[i].close * (double)rows[i].volume;
+	}
+}
+
+/* the rows [from, to) into the writer, backwards so the writer sorts them */
+static int
+add_rows(col_writer_t *w, const struct col_row *rows, uint64_t from, uint64_t to)
+{
+	uint64_t i;
+
+	for (i = to; i > from; i--) {
+		if (col_writer_add(w, &rows[i - 1]) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+compare(const col_file_t *f, const struct col_row *rows, uint64_t n)
+{
+	const struct col_row *r;
+	uint64_t i, first, last, blocked = 0;
+
+	if (f->nrows != n || f->hdr->ninstruments != CONTRACTS || f->hdr->bar_type != BAR_T_MIN ||
+	    f->hdr->min_ts != rows[0].timestamp || f->hdr->max_ts != rows[n - 1].timestamp) {
+		fprintf(stderr, "colstore: %lu rows of %lu, %u instruments, from %ld to %ld\n",
+			(unsigned long)f->nrows, (unsigned long)n, f->hdr->ninstruments, (long)f->hdr->min_ts,
+			(long)f->hdr->max_ts);
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		r = &rows[i];
+		if (f->timestamp[i] != r->timestamp || f->trading_day[i] != r->trading_day ||
+		    f->instrument[i] >= f->hdr->ninstruments ||
+		    strncmp(f->symbols[f->instrument[i]], r->symbol, COL_SYMBOL_LEN) != 0 ||
+		    f->open[i] != r->open || f->high[i] != r->high || f->low[i] != r->low || f->close[i] != r->close ||
+		    f->volume[i] != r->volume || f->oi[i] != r->oi || f->amount[i] != r->amount) {
+			fprintf(stderr, "colstore: row %lu of %lu is not the bar written\n", (unsigned long)i,
+				(unsigned long)n);
+			return -1;
+		}
+	}
+
+	/* the footer covers the rows, and a range of all of them is all of them */
+	for (i = 0; i < f->hdr->nblocks; i++) {
+		if (f->blocks[i].first != blocked) {
+			break;
+		}
+		blocked += f->blocks[i].rows;
+	}
+	if (blocked != n || col_range(f, f->hdr->min_ts, f->hdr->max_ts, &first, &last) != n ||
+	    col_lookup(f, rows[0].symbol) < 0) {
+		fprintf(stderr, "colstore: the footer has %lu rows of %lu\n", (unsigned long)blocked, (unsigned long)n);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* a copy of the file with the code of its first row out of the dict */
+static int
+corrupt(const char *path, const char *bad)
+{
+	col_file_t f;
+	uint32_t code;
+	FILE *fp;
+	int rc = -1;
+
+	if (col_open(&f, path) != 0) {
+		return -1;
+	}
+	if ((fp = fopen(bad, "wb")) != NULL) {
+		code = f.hdr->ninstruments;
+		if (fwrite(f.hdr, 1, f.size, fp) == f.size &&
+		    fseek(fp, (long)f.hdr->col_off[COL_INSTRUMENT], SEEK_SET) == 0 &&
+		    fwrite(&code, sizeof(code), 1, fp) == 1) {
+			rc = 0;
+		}
+		if (fclose(fp) != 0) {
+			rc = -1;
+		}
+	}
+	col_close(&f);
+
+	return rc;
+}
+
+int
+check_colstore(const struct check_opts *o)
+{
+	char symbols[CONTRACTS][COL_SYMBOL_LEN], path[PATH_MAX], bad[PATH_MAX];
+	struct col_row *rows;
+	col_writer_t *w = NULL;
+	col_file_t f;
+	uint64_t n = o->n < 2 * CONTRACTS ? 2 * CONTRACTS : o->n / CONTRACTS * CONTRACTS, i;
+	uint64_t half = n / CONTRACTS / 2 * CONTRACTS;
+	synth_t *s;
+	int rc = -1;
+
+	if ((rows = malloc(n * sizeof(*rows))) == NULL) {
+		return -1;
+	}
+	if ((s = synth_create(MD_T_SHFE, 1, o->seed)) == NULL) {
+		free(rows);
+		return -1;
+	}
+	make_rows(s, rows, n, symbols);
+	synth_free(s);
+	snprintf(path, sizeof(path), "%s/rb.1min%s", o->dir, COL_SUFFIX);
+	snprintf(bad, sizeof(bad), "%s/bad%s", o->dir, COL_SUFFIX);
+
+	/* the first go */
+	if ((w = col_writer_create("SHFE", "rb", BAR_T_MIN)) == NULL || add_rows(w, rows, 0, half) != 0 ||
+	    col_writer_write(w, path) != 0) {
+		fprintf(stderr, "colstore: cannot write %s\n", path);
+		goto out;
+	}
+	col_writer_free(w);
+
+	/* the second appends the rest and rewrites some bars, the later wins */
+	if ((w = col_writer_create("SHFE", "rb", BAR_T_MIN)) == NULL || col_writer_load(w, path) != 0) {
+		fprintf(stderr, "colstore: cannot load %s\n", path);
+		goto out;
+	}
+	for (i = 0; i < half; i += REWRITE) {
+		rows[i].close += 0.5;
+		rows[i].amount = rows[i].close * (double)rows[i].volume;
+		if (col_writer_add(w, &rows[i]) != 0) {
+			goto out;
+		}
+	}
+	if (add_rows(w, rows, half, n) != 0 || col_writer_write(w, path) != 0) {
+		fprintf(stderr, "colstore: cannot write %s\n", path);
+		goto out;
+	}
+
+	if (col_open(&f, path) != 0) {
+		fprintf(stderr, "colstore: cannot open %s\n", path);
+		goto out;
+	}
+	rc = compare(&f, rows, n);
+	col_close(&f);
+
+	if (rc == 0) {
+		col_writer_free(w);
+		if ((w = col_writer_create("SHFE", "rb", BAR_T_MIN)) == NULL || corrupt(path, bad) != 0) {
+			rc = -1;
+		} else if (col_writer_load(w, bad) != -3) {
+			/* refused for the file, before a symbol is read past the dict */
+			fprintf(stderr, "colstore: %s with an instrument out of its dict is not refused as bad\n", bad);
+			rc = -1;
+		}
+	}
+
+out:
+	col_writer_free(w);
+	unlink(path);
+	unlink(bad);
+	free(rows);
+
+	return rc;
+}
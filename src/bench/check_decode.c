@@ -0,0 +1,222 @@
+/*
+ * check_decode.c
+ *
+ * The functions are used to check the decoder table: every md_type with an
+ * encoder decodes the packets of synthetic ticks back into the very records
+ * they were encoded from, stamped with md_type and the receive time, with
+ * the sequence number of the packet in the header and in the records, two
+ * packets of one buffer both, a packet cut short not at all and garbage
+ * consumed without records. read_tick() walks the same ticks, and the types
+ * without a decoder give nothing.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "decode.h"
+#include "parse.h"
+#include "synth.h"
+
+#define PKT_LEN		1400
+#define TICKS_MIN	1000
+#define TICK_STEP_NS	500000000ULL
+#define RECV_TS		123456789ULL
+#define GARBAGE		300
+
+/* the record decoded from in, sent in the packet seq, 0 of a feed without one */
+static void
+expected(int md, const tick_rec_t *in, uint32_t seq, tick_rec_t *out)
+{
+	*out = *in;
+	if (md != MD_T_JUPITER) {
+		out->seq = tick_decoders[md]->seq != NULL ? seq : 0;
+		out->md_type = (uint8_t)md;
+		out->recv_ts = RECV_TS;
+	}
+}
+
+/* every packet of the ticks decoded on its own and its records read_tick() */
+static int
+check_packets(int md, const tick_rec_t *recs, size_t n)
+{
+	const struct tick_decoder *dec = tick_decoders[md];
+	tick_rec_t out[DECODE_MSGS_MAX], want;
+	uint8_t buf[PKT_LEN];
+	size_t i, k, len, done, got, used;
+	uint32_t seq, pseq;
+	uint16_t channel;
+	tick_data_t *t;
+
+	for (i = 0, seq = 1; i < n; i += done, seq++) {
+		if ((len = tick_encode(md, recs + i, n - i, seq, buf, sizeof(buf), &done)) == 0) {
+			fprintf(stderr, "decode: %s: tick %lu is not encoded\n", dec->name, (unsigned long)i);
+			return -1;
+		}
+		if (dec->seq != NULL && (tick_seq(md, buf, len, &channel, &pseq) != 0 || pseq != seq)) {
+			fprintf(stderr, "decode: %s: packet %u has no sequence number of its own\n", dec->name, seq);
+			return -1;
+		}
+		got = tick_decode(md, buf, len, out, DECODE_MSGS_MAX, &used, RECV_TS);
+		if (got != done || used != len) {
+			fprintf(stderr, "decode: %s: packet %u of %lu ticks and %lu bytes decoded into %lu of %lu\n",
+				dec->name, seq, (unsigned long)done, (unsigned long)len, (unsigned long)got,
+				(unsigned long)used);
+			return -1;
+		}
+		for (k = 0; k < got; k++) {
+			expected(md, &recs[i + k], seq, &want);
+			if (memcmp(&want, &out[k], sizeof(want)) != 0) {
+				fprintf(stderr, "decode: %s: tick %lu is not the one encoded\n", dec->name,
+					(unsigned long)(i + k));
+				return -1;
+			}
+		}
+
+		for (k = 0, t = read_tick(md, buf, len); t != NULL; k++, t = read_next(t)) {
+			if (k >= got || t->symbol == NULL ||
+			    strcmp(t->symbol, tick_symbol(recs[i + k].instrument)) != 0 ||
+			    t->last.price != tick_px_double(recs[i + k].last)) {
+				fprintf(stderr, "decode: %s: read_tick of tick %lu is not the one encoded\n", dec->name,
+					(unsigned long)(i + k));
+				return -1;
+			}
+		}
+		if (k != got) {
+			fprintf(stderr, "decode: %s: read_tick read %lu of %lu ticks\n", dec->name, (unsigned long)k,
+				(unsigned long)got);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* two packets in one buffer, one cut short and garbage of the framed feeds */
+static int
+check_buffers(int md, const tick_rec_t *recs, size_t n)
+{
+	const struct tick_decoder *dec = tick_decoders[md];
+	tick_rec_t out[2 * DECODE_MSGS_MAX];
+	uint8_t buf[2 * PKT_LEN];
+	size_t len, len2, done, done2, got, used;
+
+	len = tick_encode(md, recs, n, 1, buf, PKT_LEN, &done);
+	len2 = tick_encode(md, recs + done, n - done, 2, buf + len, PKT_LEN, &done2);
+	got = tick_decode(md, buf, len + len2, out, 2 * DECODE_MSGS_MAX, &used, RECV_TS);
+	if (len == 0 || len2 == 0 || got != done + done2 || used != len + len2) {
+		fprintf(stderr, "decode: %s: two packets of %lu ticks decoded into %lu\n", dec->name,
+			(unsigned long)(done + done2), (unsigned long)got);
+		return -1;
+	}
+
+	/* the ctp feed is a stream of messages, no header to tell a packet from garbage */
+	if (dec->seq == NULL) {
+		return 0;
+	}
+	got = tick_decode(md, buf, len - 1, out, DECODE_MSGS_MAX, &used, RECV_TS);
+	if (got != 0 || used != 0) {
+		fprintf(stderr, "decode: %s: a packet cut short decoded into %lu ticks of %lu bytes\n", dec->name,
+			(unsigned long)got, (unsigned long)used);
+		return -1;
+	}
+	memset(buf, 0xa5, GARBAGE);
+	got = tick_decode(md, buf, GARBAGE, out, DECODE_MSGS_MAX, &used, RECV_TS);
+	if (got != 0 || used != GARBAGE) {
+		fprintf(stderr, "decode: %s: garbage decoded into %lu ticks, %lu of %d bytes consumed\n", dec->name,
+			(unsigned long)got, (unsigned long)used, GARBAGE);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* more depth than a record carries is cut to TICK_DEPTH */
+static int
+check_depth(const tick_rec_t *rec)
+{
+	tick_rec_t in = *rec, out[DECODE_MSGS_MAX];
+	uint8_t buf[PKT_LEN];
+	size_t len, done, got, used;
+
+	in.level = 200;
+	len = tick_encode(MD_T_JUPITER, &in, 1, 1, buf, sizeof(buf), &done);
+	got = tick_decode(MD_T_JUPITER, buf, len, out, DECODE_MSGS_MAX, &used, RECV_TS);
+	if (got != 1 || out[0].level != TICK_DEPTH) {
+		fprintf(stderr, "decode: a record of %u levels decoded into %lu of %u\n", in.level, (unsigned long)got,
+			got == 1 ? out[0].level : 0);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* the types without a decoder and out of the table give nothing */
+static int
+check_none(void)
+{
+	tick_rec_t out[DECODE_MSGS_MAX];
+	uint8_t buf[PKT_LEN];
+	uint16_t channel;
+	uint32_t seq;
+	size_t used;
+	int md;
+
+	memset(buf, 0, sizeof(buf));
+	for (md = 0; md <= MD_T_MAX; md++) {
+		if (md < MD_T_MAX && tick_decoders[md] != NULL) {
+			continue;
+		}
+		used = 1;
+		if (tick_decode(md, buf, sizeof(buf), out, DECODE_MSGS_MAX, &used, RECV_TS) != 0 || used != 0 ||
+		    tick_seq(md, buf, sizeof(buf), &channel, &seq) != -1 || read_tick(md, buf, sizeof(buf)) != NULL) {
+			fprintf(stderr, "decode: md_type %d without a decoder decoded\n", md);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+check_decode(const struct check_opts *o)
+{
+	uint64_t ts = cn_timestamp(20250303, 9 * 3600, 0);
+	size_t n = o->n / 16 < TICKS_MIN ? TICKS_MIN : o->n / 16, i;
+	tick_rec_t *recs;
+	synth_t *s;
+	int md, rc = 0;
+
+	if ((recs = aligned_alloc(TICK_CACHELINE, n * sizeof(tick_rec_t))) == NULL) {
+		return -1;
+	}
+	for (md = 0; md < MD_T_MAX && rc == 0; md++) {
+		if (tick_decoders[md] == NULL || tick_decoders[md]->encode == NULL) {
+			continue;
+		}
+		if ((s = synth_create(md, o->instruments, o->seed)) == NULL) {
+			rc = -1;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			synth_tick(s, ts + i * TICK_STEP_NS, &recs[i]);
+		}
+		synth_free(s);
+
+		rc = check_packets(md, recs, n);
+		if (rc == 0) {
+			rc = check_buffers(md, recs, n);
+		}
+		if (rc == 0 && md == MD_T_JUPITER) {
+			rc = check_depth(recs);
+		}
+	}
+	if (rc == 0) {
+		rc = check_none();
+	}
+	free(recs);
+
+	return rc;
+}
@@ -0,0 +1,180 @@
+/*
+ * check_instrument.c
+ *
+ * The functions are used to check the round trip of the instrument master:
+ * the contracts of products of every exchange added with their fields and
+ * the product parsed from the symbol, then every id looked up by symbol
+ * and its record and product read back as added. A rebuild loading the
+ * master keeps every id, gives the new contracts the next ones, and takes
+ * the new fields of an old contract but not another exchange.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "check.h"
+#include "instrument.h"
+
+#define CHANGED		5		/* every CHANGED-th contract of the first build gets new fields */
+#define MONTHS		120		/* of a product, a czce symbol has one digit of the year */
+
+static const struct {
+	const char *product;
+	int exchange;
+	double multiplier;
+	double tick_size;
+} products[] = {
+	{ "cu", INS_EX_SHFE, 5, 10 },
+	{ "rb", INS_EX_SHFE, 10, 1 },
+	{ "sc", INS_EX_INE, 1000, 0.1 },
+	{ "m", INS_EX_DCE, 10, 1 },
+	{ "SR", INS_EX_CZCE, 10, 1 },
+	{ "IF", INS_EX_CFFEX, 300, 0.2 },
+	{ "si", INS_EX_GFEX, 5, 5 },
+};
+
+#define NPRODUCTS	(sizeof(products) / sizeof(products[0]))
+
+struct contract
+{
+	char symbol[INS_SYMBOL_LEN];
+	struct ins_spec spec;
+	uint32_t id;
+};
+
+/* the i-th contract, the products in turn and a month later every round */
+static void
+make_contract(struct contract *c, uint32_t i)
+{
+	uint32_t p = i % NPRODUCTS, m = i / NPRODUCTS, year = 2025 + m / 12, month = m % 12 + 1;
+
+	/* czce drops the decade of the year */
+	if (products[p].exchange == INS_EX_CZCE) {
+		snprintf(c->symbol, sizeof(c->symbol), "%s%u%02u", products[p].product, year % 10, month);
+	} else {
+		snprintf(c->symbol, sizeof(c->symbol), "%s%02u%02u", products[p].product, year % 100, month);
+	}
+	memset(&c->spec, 0, sizeof(c->spec));
+	c->spec.symbol = c->symbol;
+	c->spec.exchange = products[p].exchange;
+	c->spec.multiplier = products[p].multiplier;
+	c->spec.tick_size = products[p].tick_size;
+	c->spec.expiry = (int32_t)(year * 10000 + month * 100 + 15);
+	c->id = 0;
+}
+
+static int
+build(const char *path, struct contract *cs, uint32_t from, uint32_t to, int load)
+{
+	ins_builder_t *b;
+	uint32_t i, id;
+	int rc = -1;
+
+	if ((b = ins_builder_create()) == NULL) {
+		return -1;
+	}
+	if (load && ins_builder_load(b, path) != 0) {
+		fprintf(stderr, "instrument: cannot load %s\n", path);
+		goto out;
+	}
+	for (i = from; i < to; i++) {
+		if ((id = ins_builder_add(b, &cs[i].spec)) == 0 || (cs[i].id != 0 && id != cs[i].id)) {
+			fprintf(stderr, "instrument: %s added as %u, not %u\n", cs[i].symbol, id, cs[i].id);
+			goto out;
+		}
+		cs[i].id = id;
+	}
+	rc = ins_builder_write(b, path);
+
+out:
+	ins_builder_free(b);
+
+	return rc;
+}
+
+static int
+compare(const char *path, const struct contract *cs, uint32_t n, const char *what)
+{
+	const struct ins_rec *r;
+	const struct contract *c;
+	char product[INS_PRODUCT_LEN];
+	ins_table_t t;
+	uint32_t i;
+	int rc = 0;
+
+	if (ins_open(&t, path) != 0) {
+		fprintf(stderr, "instrument: %s: cannot open %s\n", what, path);
+		return -1;
+	}
+	if (t.ninstruments != n || t.nproducts != (n < NPRODUCTS ? n : NPRODUCTS)) {
+		fprintf(stderr, "instrument: %s: %u instruments and %u products, not %u\n", what, t.ninstruments,
+			t.nproducts, n);
+		ins_close(&t);
+		return -1;
+	}
+	for (i = 0; i < n && rc == 0; i++) {
+		c = &cs[i];
+		ins_product_code(product, sizeof(product), c->symbol);
+		if (c->id != i + 1 || ins_lookup(&t, c->symbol) != c->id || (r = ins_get(&t, c->id)) == NULL ||
+		    strcmp(r->symbol, c->symbol) != 0 || r->id != c->id ||
+		    r->exchange != products[i % NPRODUCTS].exchange ||
+		    r->multiplier != c->spec.multiplier || r->tick_size != c->spec.tick_size ||
+		    r->expiry != c->spec.expiry || strcmp(ins_product_name(&t, r->product), product) != 0 ||
+		    ins_product_lookup(&t, product) != r->product ||
+		    t.products[r->product - 1].exchange != products[i % NPRODUCTS].exchange) {
+			fprintf(stderr, "instrument: %s: %s is not the contract added\n", what, c->symbol);
+			rc = -1;
+		}
+	}
+	if (rc == 0 && (ins_lookup(&t, "xx9999") != 0 || ins_product_lookup(&t, "xx") != 0)) {
+		fprintf(stderr, "instrument: %s: a symbol not added is found\n", what);
+		rc = -1;
+	}
+	ins_close(&t);
+
+	return rc;
+}
+
+int
+check_instrument(const struct check_opts *o)
+{
+	uint32_t n = o->instruments < 2 * NPRODUCTS ? 2 * NPRODUCTS : o->instruments, half, i;
+	char path[PATH_MAX];
+	struct contract *cs;
+	int rc = -1;
+
+	n = n < NPRODUCTS * MONTHS ? n : NPRODUCTS * MONTHS;
+	half = n / 2;
+	if ((cs = malloc(n * sizeof(*cs))) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		make_contract(&cs[i], i);
+	}
+	snprintf(path, sizeof(path), "%s/instruments%s", o->dir, INS_SUFFIX);
+
+	if (build(path, cs, 0, half, 0) != 0 || compare(path, cs, half, "built") != 0) {
+		goto out;
+	}
+
+	/* the rebuild: new fields of old contracts, an exchange they keep, and the new contracts */
+	for (i = 0; i < half; i += CHANGED) {
+		cs[i].spec.multiplier *= 2;
+		cs[i].spec.tick_size /= 2;
+		cs[i].spec.expiry += 1;
+		cs[i].spec.exchange = products[i % NPRODUCTS].exchange % (INS_EX_MAX - 1) + 1;
+	}
+	if (build(path, cs, 0, n, 1) == 0) {
+		rc = compare(path, cs, n, "rebuilt");
+	}
+
+out:
+	unlink(path);
+	free(cs);
+
+	return rc;
+}
@@ -0,0 +1,188 @@
+/*
+ * check_rank.c
+ *
+ * The functions are used to check the cross-sectional ranking against a
+ * full sort of the universe: the returns of many ties and some NaN and the
+ * threshold masks of random universes, the lowest and the highest of every
+ * fraction selected by quickselect the same products in the same order as
+ * head(n) and tail(n) of the products sorted by return and then by index.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "check.h"
+#include "rank.h"
+#include "synth.h"
+
+#define ROUNDS		200
+#define TIES		8		/* distinct returns of a round of ties */
+#define PRODUCTS_MAX	4099
+
+static const uint32_t sizes[] = { 0, 1, 2, 15, 16, 17, 63, 64, 65, 200, 1000, PRODUCTS_MAX };
+static const double pcts[] = { 0, 0.01, 0.1, 0.25, 0.5, 0.99, 1, 1.5 };
+
+#define NSIZES		(sizeof(sizes) / sizeof(sizes[0]))
+#define NPCTS		(sizeof(pcts) / sizeof(pcts[0]))
+
+static const double *sort_value;
+
+static int
+cmp_rank(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	double u = sort_value[x], v = sort_value[y];
+
+	return u < v ? -1 : u > v ? 1 : x < y ? -1 : x > y;
+}
+
+/* the returns of a round, one in TIES NaN, of TIES values only in a round of ties */
+static void
+make_values(synth_t *s, double *value, double *volume, uint32_t n, int ties)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t r = synth_rand(s);
+
+		if (r % TIES == 0) {
+			value[i] = NAN;
+		} else if (ties) {
+			value[i] = (double)((r >> 8) % TIES) - TIES / 2;
+		} else {
+			value[i] = ((double)(r >> 11) / (double)(1ULL << 53) - 0.5) / 10;
+		}
+		volume[i] = (double)(synth_rand(s) % 1000);
+	}
+}
+
+/* the mask of the universe of a threshold as a loop of compares would give it */
+static int
+check_mask(const uint64_t *mask, const double *value, double threshold, uint32_t n, int ge)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		int in = ge ? value[i] >= threshold : value[i] > threshold;
+
+		if (((mask[i >> 6] >> (i & 63)) & 1) != (uint64_t)in) {
+			fprintf(stderr, "rank: product %u of %u is %s the mask of %g\n", i, n, in ? "not in" : "in",
+				threshold);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* the selection of every fraction is head(k) and tail(k) of the sort of the universe */
+static int
+check_select(xs_rank_t *r, const uint64_t *mask, const double *value, uint32_t n, uint32_t *sorted,
+	     uint32_t *lo, uint32_t *hi)
+{
+	uint32_t i, m = 0, k, want, got;
+	size_t p;
+	double x;
+
+	for (i = 0; i < n; i++) {
+		if (value[i] == value[i] && (mask == NULL || ((mask[i >> 6] >> (i & 63)) & 1))) {
+			sorted[m++] = i;
+		}
+	}
+	sort_value = value;
+	qsort(sorted, m, sizeof(*sorted), cmp_rank);
+
+	for (p = 0; p < NPCTS; p++) {
+		x = m * pcts[p];
+		want = m == 0 ? 0 : x < 1 ? 1 : x >= m ? m : (uint32_t)x;
+		k = xs_rank_select(r, mask, pcts[p], lo, hi, &got);
+		if (got != m || k != want) {
+			fprintf(stderr, "rank: %u of %u products ranked, %u selected of %g, not %u and %u\n", got, n, k,
+				pcts[p], m, want);
+			return -1;
+		}
+		for (i = 0; i < k; i++) {
+			if (lo[i] != sorted[i] || hi[i] != sorted[m - k + i]) {
+				fprintf(stderr, "rank: product %u of %u selected of %u of %g is not the sorted one\n",
+					i, k, m, pcts[p]);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+check_round(synth_t *s, uint32_t n, int ties, double *value, double *volume, uint32_t *scratch)
+{
+	uint64_t mask[XS_WORDS(PRODUCTS_MAX)], gt[XS_WORDS(PRODUCTS_MAX)];
+	uint32_t *lo = scratch + n, *hi = scratch + 2 * n, i;
+	xs_rank_t *r;
+	int rc = -1;
+
+	if ((r = xs_rank_create(n)) == NULL) {
+		return -1;
+	}
+	make_values(s, value, volume, n, ties);
+
+	/* a panel loaded at once and the same returns set one by one rank alike */
+	if (ties) {
+		xs_rank_load(r, value);
+	} else {
+		for (i = 0; i < n; i++) {
+			xs_rank_set(r, i, NAN);
+			xs_rank_set(r, i, value[i]);
+		}
+	}
+
+	xs_mask_ge(mask, volume, 250, n);
+	xs_mask_gt(gt, value, 0, n);
+	if (check_mask(mask, volume, 250, n, 1) != 0 || check_mask(gt, value, 0, n, 0) != 0 ||
+	    check_select(r, NULL, value, n, scratch, lo, hi) != 0 ||
+	    check_select(r, mask, value, n, scratch, lo, hi) != 0) {
+		goto out;
+	}
+	xs_mask_and(mask, gt, XS_WORDS(n));
+	rc = check_select(r, mask, value, n, scratch, lo, hi);
+
+out:
+	xs_rank_free(r);
+
+	return rc;
+}
+
+int
+check_rank(const struct check_opts *o)
+{
+	uint32_t max = PRODUCTS_MAX, *scratch;
+	double *value, *volume;
+	synth_t *s;
+	size_t i, j;
+	int rc = 0;
+
+	value = malloc(max * sizeof(*value));
+	volume = malloc(max * sizeof(*volume));
+	scratch = malloc(3 * max * sizeof(*scratch));
+	if (value == NULL || volume == NULL || scratch == NULL || (s = synth_create(MD_T_SHFE, 1, o->seed)) == NULL) {
+		free(value);
+		free(volume);
+		free(scratch);
+		return -1;
+	}
+
+	for (j = 0; j < ROUNDS && rc == 0; j++) {
+		for (i = 0; i < NSIZES && rc == 0; i++) {
+			rc = check_round(s, sizes[i], j & 1, value, volume, scratch);
+		}
+	}
+	synth_free(s);
+	free(value);
+	free(volume);
+	free(scratch);
+
+	return rc;
+}
@@ -0,0 +1,257 @@
+/*
+ * check_record.c
+ *
+ * The functions are used to check the round trip of the tick files of the
+ * recorder. The first half of the synthetic ticks go into small blocks cut
+ * early every so often, as the age flush does; the second half is never
+ * flushed, as with flush_ns 0: a tick of every instrument, leaving their
+ * blocks open, then the first instrument alone, filling more blocks than
+ * the open list holds ids, so an id listed again for every block would
+ * push the open ones off it. Every tick is then replayed back in order with
+ * all its fields; the blocks of the seek index hold every tick, and a
+ * replay without it, rebuilding it, gives the same ticks.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "check.h"
+#include "record.h"
+#include "synth.h"
+
+#define EXCHANGE	"SHFE"
+#define BLOCK_TICKS	2
+#define FLUSH_EVERY	1000		/* ticks between the flushes of every open block */
+#define FILES_MAX	8		/* of the days the ticks fall on */
+#define START_NS	1741000000000000000ULL
+#define STEP_NS		1000000ULL	/* the exchanges stamp in ms */
+#define BATCH		512
+
+struct files
+{
+	const char *dir;		/* of the exchange */
+	char paths[FILES_MAX][PATH_MAX + NAME_MAX + 2];
+	const char *ptrs[FILES_MAX];
+	size_t n;
+};
+
+/* the files of the exchange with the suffix, at most FILES_MAX */
+static int
+list_files(struct files *fs, const char *suffix)
+{
+	size_t len = strlen(suffix), nl;
+	struct dirent *de;
+	DIR *d;
+
+	fs->n = 0;
+	if ((d = opendir(fs->dir)) == NULL) {
+		fprintf(stderr, "record: cannot open %s\n", fs->dir);
+		return -1;
+	}
+	while ((de = readdir(d)) != NULL) {
+		nl = strlen(de->d_name);
+		if (nl <= len || strcmp(de->d_name + nl - len, suffix) != 0) {
+			continue;
+		}
+		if (fs->n == FILES_MAX) {
+			closedir(d);
+			fprintf(stderr, "record: more than %d files in %s\n", FILES_MAX, fs->dir);
+			return -1;
+		}
+		snprintf(fs->paths[fs->n], sizeof(fs->paths[0]), "%s/%s", fs->dir, de->d_name);
+		fs->ptrs[fs->n] = fs->paths[fs->n];
+		fs->n++;
+	}
+	closedir(d);
+
+	return 0;
+}
+
+static void
+remove_files(struct files *fs)
+{
+	struct dirent *de;
+	char path[sizeof(fs->paths[0])];
+	DIR *d;
+
+	if ((d = opendir(fs->dir)) != NULL) {
+		while ((de = readdir(d)) != NULL) {
+			if (de->d_name[0] != '.') {
+				snprintf(path, sizeof(path), "%s/%s", fs->dir, de->d_name);
+				unlink(path);
+			}
+		}
+		closedir(d);
+	}
+	rmdir(fs->dir);
+}
+
+/* the fields the file keeps, the latency stamps of this process aside */
+static int
+same(const tick_rec_t *a, const tick_rec_t *b)
+{
+	return a->timestamp == b->timestamp && a->recv_ts == b->recv_ts && a->instrument == b->instrument &&
+	       a->seq == b->seq && a->channel == b->channel && a->md_type == b->md_type &&
+	       a->level == b->level && a->flags == b->flags &&
+	       memcmp(&a->last, &b->last, offsetof(tick_rec_t, lat_picked) - offsetof(tick_rec_t, last)) == 0;
+}
+
+/* replay the files, every tick must be the one written in its place */
+static int
+replay(const struct files *fs, const tick_rec_t *ticks, uint64_t n, const char *what)
+{
+	static tick_rec_t out[BATCH];
+	struct rec_replay_conf conf;
+	struct rec_replay_stats st;
+	rec_replay_t *rp;
+	uint64_t i = 0;
+	size_t got, k;
+	int rc = 0;
+
+	memset(&conf, 0, sizeof(conf));
+	if ((rp = rec_replay_open(fs->ptrs, fs->n, &conf)) == NULL) {
+		fprintf(stderr, "record: cannot replay %s\n", fs->dir);
+		return -1;
+	}
+	while (rc == 0 && (got = rec_replay_next(rp, out, BATCH)) > 0) {
+		for (k = 0; k < got; k++, i++) {
+			if (i >= n || !same(&out[k], &ticks[i])) {
+				fprintf(stderr, "record: %s: tick %lu of %lu is not the one written\n", what,
+					(unsigned long)i, (unsigned long)n);
+				rc = -1;
+				break;
+			}
+		}
+	}
+	rec_replay_stats(rp, &st);
+	rec_replay_close(rp);
+
+	if (rc == 0 && (i != n || st.bad != 0)) {
+		fprintf(stderr, "record: %s: %lu ticks of %lu replayed, %lu bad blocks\n", what, (unsigned long)i,
+			(unsigned long)n, (unsigned long)st.bad);
+		rc = -1;
+	}
+
+	return rc;
+}
+
+/* the ticks of the blocks of the seek index are all the ticks written */
+static int
+check_index(struct files *fs, uint64_t n)
+{
+	struct rec_index ix;
+	uint64_t ticks = 0;
+	size_t i;
+	FILE *fp;
+
+	if (list_files(fs, REC_INDEX_SUFFIX) != 0) {
+		return -1;
+	}
+	for (i = 0; i < fs->n; i++) {
+		if ((fp = fopen(fs->paths[i], "rb")) == NULL) {
+			fprintf(stderr, "record: cannot open %s\n", fs->paths[i]);
+			return -1;
+		}
+		while (fread(&ix, sizeof(ix), 1, fp) == 1) {
+			ticks += ix.count;
+		}
+		fclose(fp);
+	}
+	if (ticks != n) {
+		fprintf(stderr, "record: the index has %lu ticks of %lu\n", (unsigned long)ticks, (unsigned long)n);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+check_record(const struct check_opts *o)
+{
+	struct rec_conf conf;
+	struct rec_stats rs;
+	char dir[PATH_MAX];
+	struct files fs;
+	tick_rec_t *ticks;
+	rec_writer_t *w;
+	synth_t *s;
+	uint64_t i;
+	size_t k;
+	int rc = -1;
+
+	if ((ticks = aligned_alloc(TICK_CACHELINE, o->n * sizeof(*ticks))) == NULL) {
+		return -1;
+	}
+	if ((s = synth_create(MD_T_SHFE, o->instruments, o->seed)) == NULL) {
+		free(ticks);
+		return -1;
+	}
+	for (i = 0; i < o->n; i++) {
+		if (i < o->n / 2) {
+			synth_tick(s, START_NS + i * STEP_NS, &ticks[i]);
+		} else {
+			k = i - o->n / 2 < synth_count(s) ? i - o->n / 2 : 0;
+			synth_snap(s, (uint32_t)k, START_NS + i * STEP_NS, 0, &ticks[i]);
+		}
+		ticks[i].recv_ts = ticks[i].timestamp + 20000 + i % 1000;
+		ticks[i].lat_picked = ticks[i].lat_published = 0;
+	}
+	synth_free(s);
+
+	memset(&conf, 0, sizeof(conf));
+	conf.dir = o->dir;
+	conf.exchange = EXCHANGE;
+	conf.block_ticks = BLOCK_TICKS;
+	snprintf(dir, sizeof(dir), "%s/%s", o->dir, EXCHANGE);
+	fs.dir = dir;
+	if ((w = rec_open(&conf)) == NULL) {
+		fprintf(stderr, "record: cannot open the recorder in %s\n", o->dir);
+		free(ticks);
+		return -1;
+	}
+	for (i = 0; i < o->n; i++) {
+		if (rec_write(w, &ticks[i]) != 0) {
+			break;
+		}
+		/* the partial blocks written, the instruments ticking again open new ones */
+		if (i < o->n / 2 && (i + 1) % FLUSH_EVERY == 0 && rec_flush(w, UINT64_MAX) != 0) {
+			break;
+		}
+	}
+	rec_stats(w, &rs);
+	rec_close(w);
+	if (i != o->n || rs.errors != 0) {
+		fprintf(stderr, "record: %lu ticks of %lu written, %lu errors\n", (unsigned long)i,
+			(unsigned long)o->n, (unsigned long)rs.errors);
+		goto out;
+	}
+
+	if (check_index(&fs, o->n) != 0 ||
+	    list_files(&fs, REC_SUFFIX) != 0 || fs.n == 0 || replay(&fs, ticks, o->n, "indexed") != 0) {
+		goto out;
+	}
+
+	/* without the seek index the replay builds it from the blocks again */
+	if (list_files(&fs, REC_INDEX_SUFFIX) != 0) {
+		goto out;
+	}
+	for (k = 0; k < fs.n; k++) {
+		unlink(fs.paths[k]);
+	}
+	if (list_files(&fs, REC_SUFFIX) != 0 || replay(&fs, ticks, o->n, "rebuilt") != 0) {
+		goto out;
+	}
+	rc = 0;
+
+out:
+	remove_files(&fs);
+	free(ticks);
+
+	return rc;
+}
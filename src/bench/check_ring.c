@@ -0,0 +1,356 @@
+/*
+ * check_ring.c
+ *
+ * The functions are used to check the readers of the ring: a gating reader
+ * holds the producer back with every record refused counted once, a claim
+ * is cut short at the gate and the slots not used are given back, a lossy
+ * reader lapped counts what it lost and goes on in order. Then a producer
+ * thread laps a small ring while gating readers join it one after another,
+ * none of them ever lapped, and a lossy one reads along, never a torn
+ * record.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "check.h"
+#include "ring.h"
+
+#define CAPACITY	64
+#define REC_WORDS	(RING_CACHELINE / sizeof(uint64_t))
+#define RUN_CAPACITY	64		/* of the ring of the threads, lapped quickly */
+#define JOIN_READS	(2 * RUN_CAPACITY)	/* records a gating reader reads before it leaves */
+#define JOINS_MIN	100
+
+struct rec
+{
+	uint64_t w[REC_WORDS];		/* the id of the record in every word */
+};
+
+struct run
+{
+	ring_t *ring;
+	uint64_t n;			/* records pushed */
+	uint64_t refused;		/* pushes the gating readers held back */
+	int bad;			/* of the lossy reader */
+	_Atomic int stop;
+	_Atomic int done;
+};
+
+static void
+make_rec(struct rec *r, uint64_t id)
+{
+	size_t i;
+
+	for (i = 0; i < REC_WORDS; i++) {
+		r->w[i] = id;
+	}
+}
+
+static int
+whole(const struct rec *r)
+{
+	size_t i;
+
+	for (i = 1; i < REC_WORDS; i++) {
+		if (r->w[i] != r->w[0]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* n records from id, every one a record of its own */
+static int
+push(ring_t *ring, uint64_t id, uint64_t n)
+{
+	struct rec r;
+	uint64_t i;
+
+	for (i = 0; i < n; i++) {
+		make_rec(&r, id + i);
+		if (ring_push(ring, &r) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* the next n records of the reader are id on, and the last if all */
+static int
+read_in_order(ring_reader_t *rd, uint64_t id, uint64_t n, int all, const char *what)
+{
+	struct rec r;
+	uint64_t i;
+
+	for (i = 0; i < n; i++) {
+		if (ring_read(rd, &r, 1) != 1 || !whole(&r) || r.w[0] != id + i) {
+			fprintf(stderr, "ring: %s: record %lu of %lu is not %lu\n", what, (unsigned long)i,
+				(unsigned long)n, (unsigned long)(id + i));
+			return -1;
+		}
+	}
+	if (all && ring_read(rd, &r, 1) != 0) {
+		fprintf(stderr, "ring: %s: more than %lu records\n", what, (unsigned long)n);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+check_gating(void)
+{
+	ring_reader_t rd;
+	struct rec r;
+	uint64_t first;
+	ring_t *ring;
+	size_t got;
+	int rc = -1;
+
+	if ((ring = ring_create(CAPACITY, sizeof(struct rec), 0)) == NULL ||
+	    ring_reader_init(&rd, ring, RING_R_GATING) != 0) {
+		ring_destroy(ring);
+		return -1;
+	}
+
+	/* full, the records after are refused and counted */
+	make_rec(&r, CAPACITY);
+	if (push(ring, 0, CAPACITY) != 0 || ring_push(ring, &r) == 0 || ring_push(ring, &r) == 0 ||
+	    atomic_load(&ring->full_drops) != 2) {
+		fprintf(stderr, "ring: a full ring took a record or counted %lu refused, not 2\n",
+			(unsigned long)atomic_load(&ring->full_drops));
+		goto out;
+	}
+	if (read_in_order(&rd, 0, CAPACITY / 4, 0, "gating") != 0) {
+		goto out;
+	}
+
+	/* a claim of more than is free is cut at the gate, the producer counts the rest */
+	if ((got = ring_claim(ring, CAPACITY, &first)) != CAPACITY / 4 || first != CAPACITY ||
+	    atomic_load(&ring->full_drops) != 2) {
+		fprintf(stderr, "ring: a claim of %d with %d free got %lu\n", CAPACITY, CAPACITY / 4, (unsigned long)got);
+		goto out;
+	}
+	ring_drop(ring, CAPACITY - got);
+
+	/* two used, the others given back for the next claim */
+	make_rec(ring_slot(ring, first), first);
+	make_rec(ring_slot(ring, first + 1), first + 1);
+	ring_unclaim(ring, first, 2);
+	ring_publish(ring, first, 2);
+	if (push(ring, first + 2, got - 2) != 0 || atomic_load(&ring->full_drops) != 2 + CAPACITY - got) {
+		fprintf(stderr, "ring: the slots given back are not claimed again\n");
+		goto out;
+	}
+	rc = read_in_order(&rd, CAPACITY / 4, CAPACITY, 1, "claimed short");
+	if (rc == 0 && rd.drops != 0) {
+		fprintf(stderr, "ring: a gating reader lost %lu records\n", (unsigned long)rd.drops);
+		rc = -1;
+	}
+
+out:
+	ring_reader_fini(&rd);
+	ring_destroy(ring);
+
+	return rc;
+}
+
+static int
+check_lossy(void)
+{
+	ring_reader_t rd, old;
+	struct rec r;
+	uint64_t n = 3 * CAPACITY, from, got = 0;
+	ring_t *ring;
+	int rc = -1;
+
+	if ((ring = ring_create(CAPACITY, sizeof(struct rec), 0)) == NULL || ring_reader_init(&rd, ring, 0) != 0) {
+		ring_destroy(ring);
+		return -1;
+	}
+
+	/* never holds the producer back, lapped it loses the oldest records */
+	if (push(ring, 0, n) != 0 || atomic_load(&ring->full_drops) != 0) {
+		fprintf(stderr, "ring: a lossy reader held the producer back\n");
+		goto out;
+	}
+	if (ring_read(&rd, &r, 1) != 1 || !whole(&r) || rd.drops == 0 || r.w[0] != rd.drops) {
+		fprintf(stderr, "ring: a lapped reader read %lu after losing %lu\n", (unsigned long)r.w[0],
+			(unsigned long)rd.drops);
+		goto out;
+	}
+	from = r.w[0] + 1;
+	if (read_in_order(&rd, from, n - from, 1, "lapped") != 0) {
+		goto out;
+	}
+
+	/* a reader of the oldest retained gets the last lap */
+	if (ring_reader_init(&old, ring, RING_R_OLDEST | RING_R_PRIVATE) != 0) {
+		goto out;
+	}
+	while (ring_read(&old, &r, 1) == 1 && whole(&r) && r.w[0] == n - CAPACITY + got) {
+		got++;
+	}
+	if (got != CAPACITY || old.drops != 0) {
+		fprintf(stderr, "ring: %lu of the %d retained records replayed\n", (unsigned long)got, CAPACITY);
+		goto out;
+	}
+	rc = 0;
+
+out:
+	ring_reader_fini(&rd);
+	ring_destroy(ring);
+
+	return rc;
+}
+
+static void *
+producer(void *arg)
+{
+	struct run *run = (struct run *)arg;
+	struct rec r;
+	uint64_t id;
+
+	for (id = 0; !atomic_load_explicit(&run->stop, memory_order_relaxed); id++) {
+		make_rec(&r, id);
+		while (ring_push(run->ring, &r) != 0) {
+			run->refused++;
+			sched_yield();
+		}
+	}
+	run->n = id;
+	atomic_store(&run->done, 1);
+
+	return NULL;
+}
+
+/* in order and never torn, whatever it lost */
+static void *
+lossy(void *arg)
+{
+	struct run *run = (struct run *)arg;
+	ring_reader_t rd;
+	struct rec r[16];
+	uint64_t next = 0;
+	size_t n, i;
+	int done;
+
+	if (ring_reader_init(&rd, run->ring, RING_R_OLDEST) != 0) {
+		run->bad = 1;
+		return NULL;
+	}
+	for (;;) {
+		done = atomic_load(&run->done);
+		if ((n = ring_read(&rd, r, 16)) == 0) {
+			if (done) {
+				break;
+			}
+			sched_yield();
+		}
+		for (i = 0; i < n; i++) {
+			if (!whole(&r[i]) || r[i].w[0] < next) {
+				run->bad = 1;
+			}
+			next = r[i].w[0] + 1;
+		}
+	}
+	if (next != run->n) {
+		run->bad = 1;
+	}
+	ring_reader_fini(&rd);
+
+	return NULL;
+}
+
+/* a gating reader joining the running producer is never lapped from its first record */
+static int
+join(ring_t *ring)
+{
+	ring_reader_t rd;
+	struct rec r;
+	uint64_t next = 0, got = 0;
+	int rc = 0;
+
+	if (ring_reader_init(&rd, ring, RING_R_GATING) != 0) {
+		return -1;
+	}
+	while (got < JOIN_READS) {
+		if (ring_read(&rd, &r, 1) == 0) {
+			sched_yield();
+			continue;
+		}
+		if (!whole(&r) || (got > 0 && r.w[0] != next) || rd.drops != 0) {
+			fprintf(stderr, "ring: a gating reader read %lu after %lu, %lu lost\n", (unsigned long)r.w[0],
+				(unsigned long)next, (unsigned long)rd.drops);
+			rc = -1;
+			break;
+		}
+		next = r.w[0] + 1;
+		got++;
+	}
+	ring_reader_fini(&rd);
+
+	return rc;
+}
+
+static int
+check_run(uint64_t n)
+{
+	uint64_t joins = n / JOIN_READS < JOINS_MIN ? JOINS_MIN : n / JOIN_READS, j;
+	pthread_t prod, lthread;
+	struct run run;
+	int rc = 0;
+
+	memset(&run, 0, sizeof(run));
+	if ((run.ring = ring_create(RUN_CAPACITY, sizeof(struct rec), 0)) == NULL) {
+		return -1;
+	}
+	if (pthread_create(&lthread, NULL, lossy, &run) != 0) {
+		ring_destroy(run.ring);
+		return -1;
+	}
+	if (pthread_create(&prod, NULL, producer, &run) != 0) {
+		atomic_store(&run.done, 1);
+		pthread_join(lthread, NULL);
+		ring_destroy(run.ring);
+		return -1;
+	}
+
+	/* every join while the producer laps the ring on its fast path of no gating reader */
+	for (j = 0; j < joins && rc == 0; j++) {
+		while (atomic_load(&run.ring->published) < (j + 1) * RUN_CAPACITY) {
+			sched_yield();
+		}
+		rc = join(run.ring);
+	}
+	atomic_store(&run.stop, 1);
+	pthread_join(prod, NULL);
+	pthread_join(lthread, NULL);
+
+	if (rc == 0 && (run.bad || atomic_load(&run.ring->full_drops) != run.refused ||
+			atomic_load(&run.ring->published) != run.n)) {
+		fprintf(stderr, "ring: the lossy reader read a torn record or out of order, or %lu refused counted %lu\n",
+			(unsigned long)run.refused, (unsigned long)atomic_load(&run.ring->full_drops));
+		rc = -1;
+	}
+	ring_destroy(run.ring);
+
+	return rc;
+}
+
+int
+check_ring(const struct check_opts *o)
+{
+	if (check_gating() != 0 || check_lossy() != 0) {
+		return -1;
+	}
+
+	return check_run(o->n);
+}
@@ -0,0 +1,179 @@
+/*
+ * check_udp.c
+ *
+ * The functions are used to check the sequencer of the packets of a feed:
+ * a channel in sequence with the copies of the other line dropped, a gap
+ * filled by the packet missing, a gap given up after hold_ms, and a short
+ * session restarted from its first packet with every packet of it passed
+ * on, the copy of the other line of the first one still dropped.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+#include "raw.h"
+#include "decode.h"
+
+#define SESSION		50		/* packets of a session, fewer than any reset distance */
+#define HOLD_MS		5
+#define WINDOW		64
+#define OTHER		7		/* a second channel, in sequence all along */
+
+struct emitted
+{
+	uint32_t seqs[4 * SESSION];
+	size_t n;
+	int bad;			/* a packet of the other channel out of sequence */
+	uint32_t other;			/* next of the other channel */
+};
+
+static void
+on_pkt(const raw_pkt_t *pkt, void *arg)
+{
+	struct emitted *e = (struct emitted *)arg;
+	uint16_t channel;
+	uint32_t seq;
+
+	if (tick_seq(MD_T_JUPITER, pkt->data, pkt->len, &channel, &seq) != 0) {
+		e->bad = 1;
+	} else if (channel == OTHER) {
+		e->bad |= seq != e->other++;
+	} else if (e->n < sizeof(e->seqs) / sizeof(e->seqs[0])) {
+		e->seqs[e->n++] = seq;
+	}
+}
+
+static void
+feed(struct udp_rx *rx, struct emitted *e, uint16_t channel, uint32_t seq)
+{
+	static raw_pkt_t pkt;
+	tick_frame_t fr;
+
+	memset(&fr, 0, sizeof(fr));
+	fr.magic = TICK_MAGIC;
+	fr.version = TICK_VERSION;
+	fr.seq = seq;
+	fr.channel = channel;
+	memcpy(pkt.data, &fr, sizeof(fr));
+	pkt.len = sizeof(fr);
+	udp_input(rx, &pkt, on_pkt, e);
+}
+
+/* the packets passed on since the last call are [from, to) */
+static int
+expect(struct emitted *e, uint32_t from, uint32_t to, const char *what)
+{
+	size_t i;
+
+	for (i = 0; i < e->n && from + i < to && e->seqs[i] == from + i; i++)
+		;
+	if (i != e->n || from + i != to || e->bad) {
+		fprintf(stderr, "udp: %s: %lu packets passed on, not %u to %u\n", what, (unsigned long)e->n, from,
+			to - 1);
+		return -1;
+	}
+	e->n = 0;
+
+	return 0;
+}
+
+static int
+stats(struct udp_rx *rx, uint64_t duplicates, uint64_t lost, uint64_t resets, const char *what)
+{
+	struct udp_stats st;
+
+	udp_get_stats(rx, &st);
+	if (st.duplicates != duplicates || st.lost != lost || st.resets != resets) {
+		fprintf(stderr, "udp: %s: %lu duplicates, %lu lost and %lu resets, not %lu, %lu and %lu\n", what,
+			(unsigned long)st.duplicates, (unsigned long)st.lost, (unsigned long)st.resets,
+			(unsigned long)duplicates, (unsigned long)lost, (unsigned long)resets);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+check_udp(const struct check_opts *o)
+{
+	struct udp_conf conf;
+	struct udp_rx *rx;
+	struct emitted *e;
+	uint32_t seq;
+	int rc = -1;
+
+	(void)o;
+	memset(&conf, 0, sizeof(conf));
+	conf.md_type = MD_T_JUPITER;
+	conf.window = WINDOW;
+	conf.hold_ms = HOLD_MS;
+	conf.nslots = 64;
+	if ((e = calloc(1, sizeof(*e))) == NULL) {
+		return -1;
+	}
+	if (udp_open(&rx, &conf) != 0) {
+		free(e);
+		return -1;
+	}
+	e->other = 1;
+
+	/* in sequence, every packet after the copy of line B of the one before */
+	for (seq = 1; seq <= SESSION; seq++) {
+		feed(rx, e, 1, seq);
+		feed(rx, e, OTHER, seq);
+		if (seq > 1) {
+			feed(rx, e, 1, seq - 1);
+		}
+	}
+	if (expect(e, 1, SESSION + 1, "in sequence") != 0 || stats(rx, SESSION - 1, 0, 0, "in sequence") != 0) {
+		goto out;
+	}
+
+	/* a gap, held until the packet missing comes */
+	for (seq = SESSION + 2; seq <= SESSION + 10; seq++) {
+		feed(rx, e, 1, seq);
+	}
+	if (expect(e, 0, 0, "held") != 0) {
+		goto out;
+	}
+	feed(rx, e, 1, SESSION + 1);
+	if (expect(e, SESSION + 1, SESSION + 11, "filled") != 0) {
+		goto out;
+	}
+
+	/* a gap given up after hold_ms */
+	for (seq = SESSION + 12; seq <= SESSION + 20; seq++) {
+		feed(rx, e, 1, seq);
+	}
+	udp_poll(rx, on_pkt, e);
+	if (expect(e, 0, 0, "held") != 0) {
+		goto out;
+	}
+	usleep(2 * HOLD_MS * 1000);
+	udp_poll(rx, on_pkt, e);
+	if (expect(e, SESSION + 12, SESSION + 21, "given up") != 0 ||
+	    stats(rx, SESSION - 1, 1, 0, "given up") != 0) {
+		goto out;
+	}
+
+	/* the next session from 1, far short of the old one, its copies dropped */
+	for (seq = 1; seq <= SESSION; seq++) {
+		feed(rx, e, 1, seq);
+		feed(rx, e, 1, seq);
+		feed(rx, e, OTHER, SESSION + seq);
+	}
+	if (expect(e, 1, SESSION + 1, "restarted") != 0 || stats(rx, 2 * SESSION - 1, 1, 1, "restarted") != 0) {
+		goto out;
+	}
+	rc = 0;
+
+out:
+	udp_close(rx);
+	free(e);
+
+	return rc;
+}
@@ -0,0 +1,465 @@
+/*
+ * gen_feed.c
+ *
+ * The program sends a synthetic market data feed of md_type to multicast
+ * groups, on the loopback interface by default, so the whole pipeline runs
+ * on one box: recv_tick receives it like the feed of the exchange.
+ *
+ *	ip link set lo multicast on
+ *	ip route add 239.0.0.0/8 dev lo
+ *	gen_feed -t shfe -g 239.1.1.1:20001 -g 239.1.1.2:20001 -c 08:59:55
+ *	recv_tick -t shfe -b shfe -i 127.0.0.1 -g 239.1.1.1:20001 -g 239.1.1.2:20001 -A
+ *
+ * The rate follows the open of a session: a trickle before it, the result of
+ * the call auction of every instrument at once a second before it, then a
+ * burst of peak ticks a second at the open decaying to the base rate. A
+ * profile file replaces it, lines of "seconds rate" the rate goes through
+ * linearly and of "seconds auction" for the results of an auction. The ticks
+ * due are packed as many into a packet as fit, so the packets fill up in
+ * the burst as they do at the exchange. Every group gets every packet, the A
+ * and the B lines, each losing packets at random with -x.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "bench.h"
+#include "decode.h"
+#include "parse.h"
+#include "synth.h"
+
+#define GROUPS_MAX	4
+#define PROFILE_MAX	256
+#define PKT_LEN		1472
+#define PENDING_MAX	4096		/* ticks made at once */
+#define IDLE_NS		50000		/* sleep when nothing is due */
+
+struct point
+{
+	double t;			/* seconds from the start */
+	double rate;			/* ticks a second, < 0 for an auction */
+};
+
+struct feed
+{
+	int md_type;
+	synth_t *synth;
+	int fd;
+	struct sockaddr_in groups[GROUPS_MAX];
+	int ngroups;
+	double loss;			/* of a packet on a line, 0 to 1 */
+	size_t pkt_len;
+	uint32_t seq;
+	uint64_t clock;			/* exchange time of the start, 0 for the wall clock */
+	uint64_t start_real;
+
+	uint64_t ticks;
+	uint64_t packets;
+	uint64_t lost;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+real_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * open_profile - the built-in profile: the open at open seconds, its
+ * auction a second before.
+ */
+static int
+open_profile(struct point *p, double base, double peak, double open, double decay, double duration)
+{
+	double t;
+	int n = 0;
+
+	p[n].t = 0;
+	p[n++].rate = base / 20;
+	if (open >= 1) {
+		p[n].t = open - 1;
+		p[n++].rate = -1;
+	}
+	p[n].t = open;
+	p[n++].rate = base / 20;
+
+	/* the exponential decay in steps of a tenth of it */
+	for (t = open; t <= duration && n < PROFILE_MAX; t += decay / 10) {
+		p[n].t = t;
+		p[n++].rate = base + peak * exp(-(t - open) / decay);
+	}
+
+	return n;
+}
+
+static int
+load_profile(struct point *p, const char *path)
+{
+	char line[256], word[32];
+	FILE *fp;
+	int n = 0, k;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL && n < PROFILE_MAX) {
+		if (line[0] == '#' || (k = sscanf(line, "%lf %31s", &p[n].t, word)) < 2) {
+			continue;
+		}
+		p[n].rate = strcmp(word, "auction") == 0 ? -1 : atof(word);
+		if (n > 0 && p[n].t < p[n - 1].t) {
+			fprintf(stderr, "%s: the times of the profile must ascend\n", path);
+			fclose(fp);
+			return -1;
+		}
+		n++;
+	}
+	fclose(fp);
+
+	return n;
+}
+
+/*
+ * rate - ticks a second of the profile at t, linear between its points; the
+ * auctions are not rates, they are skipped.
+ */
+static double
+rate(const struct point *p, int n, double t)
+{
+	int i, prev = -1;
+
+	for (i = 0; i < n; i++) {
+		if (p[i].rate < 0) {
+			continue;
+		}
+		if (p[i].t > t) {
+			if (prev < 0 || p[i].t <= p[prev].t) {
+				return p[i].rate;
+			}
+			return p[prev].rate + (p[i].rate - p[prev].rate) * (t - p[prev].t) / (p[i].t - p[prev].t);
+		}
+		prev = i;
+	}
+
+	return prev >= 0 ? p[prev].rate : 0;
+}
+
+static void
+send_pkt(struct feed *f, const uint8_t *pkt, size_t len)
+{
+	int g;
+
+	for (g = 0; g < f->ngroups; g++) {
+		if (f->loss > 0 && (double)(synth_rand(f->synth) >> 11) / 9007199254740992.0 < f->loss) {
+			f->lost++;
+			continue;
+		}
+		if (sendto(f->fd, pkt, len, 0, (const struct sockaddr *)&f->groups[g], sizeof(f->groups[g])) < 0 &&
+		    errno != ENOBUFS && errno != EAGAIN) {
+			fprintf(stderr, "sendto failed: %s\n", strerror(errno));
+			running = 0;
+			return;
+		}
+	}
+	f->packets++;
+}
+
+/*
+ * put - send the ticks in packets of the feed, as many in one as fit.
+ */
+static void
+put(struct feed *f, const tick_rec_t *t, size_t n)
+{
+	uint8_t pkt[PKT_LEN] __attribute__((aligned(TICK_CACHELINE)));
+	size_t i, len, done;
+
+	for (i = 0; i < n && running; i += done) {
+		if ((len = tick_encode(f->md_type, t + i, n - i, ++f->seq, pkt, f->pkt_len, &done)) == 0) {
+			fprintf(stderr, "cannot encode the ticks in %lu bytes\n", (unsigned long)f->pkt_len);
+			running = 0;
+			return;
+		}
+		send_pkt(f, pkt, len);
+		f->ticks += done;
+	}
+}
+
+static uint64_t
+exchange_now(const struct feed *f)
+{
+	uint64_t now = real_now();
+
+	return f->clock != 0 ? f->clock + (now - f->start_real) : now;
+}
+
+static void
+auction(struct feed *f, tick_rec_t *buf)
+{
+	uint32_t i, k, n = synth_count(f->synth);
+	uint64_t ts = exchange_now(f);
+
+	for (i = 0; i < n; i += k) {
+		for (k = 0; k < PENDING_MAX && i + k < n; k++) {
+			synth_snap(f->synth, i + k, ts, TICK_F_AUCTION, &buf[k]);
+		}
+		put(f, buf, k);
+	}
+}
+
+/*
+ * parse_clock - HH:MM:SS of today in China Standard Time, as ns since epoch.
+ */
+static uint64_t
+parse_clock(const char *s)
+{
+	uint32_t day, sec, ms, h, m, x = 0;
+
+	if (sscanf(s, "%u:%u:%u", &h, &m, &x) < 2 || h > 23 || m > 59 || x > 59) {
+		return 0;
+	}
+	cn_time(real_now(), &day, &sec, &ms);
+
+	return cn_timestamp(day, h * 3600 + m * 60 + x, 0);
+}
+
+static int
+add_group(struct feed *f, char *s)
+{
+	char *port;
+
+	if (f->ngroups == GROUPS_MAX || (port = strrchr(s, ':')) == NULL) {
+		return -1;
+	}
+	*port++ = '\0';
+	memset(&f->groups[f->ngroups], 0, sizeof(f->groups[0]));
+	f->groups[f->ngroups].sin_family = AF_INET;
+	f->groups[f->ngroups].sin_port = htons((uint16_t)atoi(port));
+	if (inet_pton(AF_INET, s, &f->groups[f->ngroups].sin_addr) != 1 || atoi(port) <= 0) {
+		return -1;
+	}
+	f->ngroups++;
+
+	return 0;
+}
+
+static int
+open_socket(const char *ifaddr, int ttl)
+{
+	struct in_addr in;
+	unsigned char loop = 1, t = (unsigned char)ttl;
+	int fd, sndbuf = 8 << 20;
+
+	if (inet_pton(AF_INET, ifaddr, &in) != 1) {
+		fprintf(stderr, "bad interface address %s\n", ifaddr);
+		return -1;
+	}
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+		return -1;
+	}
+	if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &in, sizeof(in)) != 0 ||
+	    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+	    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &t, sizeof(t)) != 0) {
+		fprintf(stderr, "setsockopt() of %s failed: %s\n", ifaddr, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+	return fd;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -t type -g group:port [-g ...] [options]\n"
+		"  -t type      market data type: shfe, ine, cffex, czce, dce, jupiter, ctp\n"
+		"  -g group     multicast group and port, repeatable for the A and B lines\n"
+		"  -i ifaddr    local address of the send interface (default 127.0.0.1)\n"
+		"  -L ttl       multicast ttl (default 1)\n"
+		"  -n count     instruments (default 200)\n"
+		"  -r rate      ticks a second after the open (default 20000)\n"
+		"  -P peak      ticks a second more at the open (default 400000)\n"
+		"  -O sec       the open, seconds from the start (default 5)\n"
+		"  -D sec       decay of the burst of the open (default 2)\n"
+		"  -T sec       seconds to run (default 30)\n"
+		"  -f file      profile of \"seconds rate\" and \"seconds auction\" lines instead\n"
+		"  -c HH:MM:SS  exchange time of the start, today (default the wall clock)\n"
+		"  -m bytes     largest packet (default %d)\n"
+		"  -x loss      packets lost on every line, 0 to 1\n"
+		"  -s seed      of the ticks\n",
+		prog, PKT_LEN);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static tick_rec_t pending[PENDING_MAX] __attribute__((aligned(TICK_CACHELINE)));
+	static struct point prof[PROFILE_MAX];
+	struct feed f;
+	const char *ifaddr = "127.0.0.1", *profile = NULL;
+	double base = 20000, peak = 400000, open = 5, decay = 2, duration = 30, owed = 0, t, last_print = 0;
+	uint64_t start, now, prev, seed = 20250303, ts, last_ticks = 0;
+	uint32_t ninstruments = 200;
+	int nprof, next_auction = 0, ttl = 1, opt;
+	size_t n, k;
+
+	memset(&f, 0, sizeof(f));
+	f.md_type = -1;
+	f.fd = -1;
+	f.pkt_len = PKT_LEN;
+
+	while ((opt = getopt(argc, argv, "t:g:i:L:n:r:P:O:D:T:f:c:m:x:s:")) != -1) {
+		switch (opt) {
+		case 't':
+			f.md_type = synth_md_type(optarg);
+			break;
+		case 'g':
+			if (add_group(&f, optarg) != 0) {
+				fprintf(stderr, "bad group %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'i':
+			ifaddr = optarg;
+			break;
+		case 'L':
+			ttl = atoi(optarg);
+			break;
+		case 'n':
+			ninstruments = (uint32_t)atoi(optarg);
+			break;
+		case 'r':
+			base = atof(optarg);
+			break;
+		case 'P':
+			peak = atof(optarg);
+			break;
+		case 'O':
+			open = atof(optarg);
+			break;
+		case 'D':
+			decay = atof(optarg);
+			break;
+		case 'T':
+			duration = atof(optarg);
+			break;
+		case 'f':
+			profile = optarg;
+			break;
+		case 'c':
+			if ((f.clock = parse_clock(optarg)) == 0) {
+				fprintf(stderr, "bad clock %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'm':
+			f.pkt_len = (size_t)atoi(optarg);
+			break;
+		case 'x':
+			f.loss = atof(optarg);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (f.md_type < 0 || tick_decoders[f.md_type]->encode == NULL || f.ngroups == 0 || ninstruments == 0 ||
+	    decay <= 0 || f.pkt_len == 0 || f.pkt_len > PKT_LEN) {
+		usage(argv[0]);
+		return 1;
+	}
+	nprof = profile != NULL ? load_profile(prof, profile) : open_profile(prof, base, peak, open, decay, duration);
+	if (nprof <= 0) {
+		return 1;
+	}
+	if ((f.synth = synth_create(f.md_type, ninstruments, seed)) == NULL) {
+		fprintf(stderr, "cannot make %u instruments\n", ninstruments);
+		return 1;
+	}
+	if ((f.fd = open_socket(ifaddr, ttl)) < 0) {
+		synth_free(f.synth);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	f.start_real = real_now();
+	start = prev = bench_now();
+	while (running) {
+		now = bench_now();
+		t = (double)(now - start) / 1e9;
+		if (t >= duration) {
+			break;
+		}
+
+		while (next_auction < nprof && prof[next_auction].t <= t) {
+			if (prof[next_auction++].rate < 0) {
+				auction(&f, pending);
+			}
+		}
+
+		/* the ticks due since the last round, in one go */
+		owed += rate(prof, nprof, t) * (double)(now - prev) / 1e9;
+		prev = now;
+		if (owed < 1) {
+			struct timespec idle = { 0, IDLE_NS };
+
+			nanosleep(&idle, NULL);
+			continue;
+		}
+		n = owed < PENDING_MAX ? (size_t)owed : PENDING_MAX;
+		owed -= (double)n;
+		ts = exchange_now(&f);
+		for (k = 0; k < n; k++) {
+			synth_tick(f.synth, ts, &pending[k]);
+		}
+		put(&f, pending, n);
+
+		if (t - last_print >= 1) {
+			printf("%6.1fs %10lu ticks %9lu packets %8lu lost %9.0f ticks/s\n", t, (unsigned long)f.ticks,
+			       (unsigned long)f.packets, (unsigned long)f.lost,
+			       (double)(f.ticks - last_ticks) / (t - last_print));
+			fflush(stdout);
+			last_print = t;
+			last_ticks = f.ticks;
+		}
+	}
+
+	printf("%lu ticks in %lu packets, %lu lost\n", (unsigned long)f.ticks, (unsigned long)f.packets,
+	       (unsigned long)f.lost);
+	close(f.fd);
+	synth_free(f.synth);
+
+	return 0;
+}
@@ -0,0 +1,244 @@
+/*
+ * synth.c
+ *
+ * The functions are used to make synthetic ticks of the instruments of an
+ * exchange, for the benchmarks and the synthetic feeds.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "synth.h"
+#include "decode.h"
+
+struct product
+{
+	const char *name;
+	double price;		/* price of the day before */
+	double tick;		/* price tick */
+};
+
+static const struct product shfe_products[] = {
+	{ "rb", 3500, 1 }, { "cu", 76000, 10 }, { "al", 20000, 5 }, { "zn", 23000, 5 },
+	{ "au", 620, 0.02 }, { "ag", 7800, 1 }, { "ru", 15000, 5 }, { "ni", 125000, 10 },
+	{ "hc", 3600, 1 }, { "fu", 3100, 1 }, { "bu", 3500, 1 }, { "sp", 6000, 2 },
+};
+
+static const struct product ine_products[] = {
+	{ "sc", 560, 0.1 }, { "lu", 4000, 1 }, { "nr", 13000, 5 }, { "bc", 68000, 10 },
+};
+
+static const struct product cffex_products[] = {
+	{ "IF", 3900, 0.2 }, { "IH", 2700, 0.2 }, { "IC", 5800, 0.2 }, { "IM", 6200, 0.2 },
+	{ "T", 108, 0.005 }, { "TF", 106, 0.005 }, { "TS", 102, 0.002 }, { "TL", 118, 0.01 },
+};
+
+static const struct product czce_products[] = {
+	{ "SR", 6000, 1 }, { "CF", 13500, 5 }, { "TA", 4800, 2 }, { "MA", 2500, 1 },
+	{ "RM", 2400, 1 }, { "OI", 9000, 1 }, { "FG", 1300, 1 }, { "SA", 1500, 1 },
+};
+
+static const struct product dce_products[] = {
+	{ "m", 2900, 1 }, { "y", 7800, 2 }, { "p", 8500, 2 }, { "c", 2300, 1 },
+	{ "i", 800, 0.5 }, { "j", 2000, 0.5 }, { "jm", 1300, 0.5 }, { "pp", 7400, 1 },
+};
+
+#define PRODUCTS(p)	{ p, sizeof(p) / sizeof(p[0]) }
+
+static const struct {
+	const struct product *p;
+	size_t n;
+} products[MD_T_MAX] = {
+	[MD_T_SHFE] = PRODUCTS(shfe_products),
+	[MD_T_INE] = PRODUCTS(ine_products),
+	[MD_T_CFFEX] = PRODUCTS(cffex_products),
+	[MD_T_CZCE] = PRODUCTS(czce_products),
+	[MD_T_DCE] = PRODUCTS(dce_products),
+};
+
+/* the feeds of all the exchanges */
+static const int all_md[] = { MD_T_SHFE, MD_T_DCE, MD_T_CZCE, MD_T_CFFEX, MD_T_INE };
+
+struct instrument
+{
+	uint32_t id;
+	int64_t tick;		/* fixed-point */
+	int64_t pre;		/* fixed-point */
+	int64_t last;
+	int64_t high;
+	int64_t low;
+	int64_t volume;
+	int64_t turnover;
+	int64_t oi;
+	int64_t pre_oi;
+};
+
+static const int8_t steps[16] = { -1, 1, -1, 1, -1, 1, -2, 2 };
+
+struct synth
+{
+	uint64_t state;
+	uint32_t n;
+	struct instrument ins[];
+};
+
+uint64_t
+synth_rand(synth_t *s)
+{
+	/* splitmix64 */
+	uint64_t z = (s->state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+synth_t *
+synth_create(int md_type, uint32_t n, uint64_t seed)
+{
+	const struct product *list[64], *p;
+	int md_of[64];
+	struct instrument *in;
+	char symbol[TICK_SYMBOL_LEN];
+	synth_t *s;
+	uint32_t i, np = 0, month;
+	size_t k, j;
+
+	if (n == 0 || (unsigned int)md_type >= MD_T_MAX) {
+		return NULL;
+	}
+
+	/* a feed of all the exchanges takes their products in turn */
+	for (j = 0; j < sizeof(all_md) / sizeof(all_md[0]); j++) {
+		int md = products[md_type].n != 0 ? md_type : all_md[j];
+
+		for (k = 0; k < products[md].n; k++) {
+			list[np] = &products[md].p[k];
+			md_of[np++] = md;
+		}
+		if (md == md_type) {
+			break;
+		}
+	}
+
+	if ((s = calloc(1, sizeof(*s) + n * sizeof(struct instrument))) == NULL) {
+		return NULL;
+	}
+	s->state = seed;
+	s->n = n;
+
+	/* the front months of every product first, the far ones after them */
+	for (i = 0; i < n; i++) {
+		p = list[i % np];
+		month = i / np;
+		month = 2501 + month / SYNTH_MONTHS * 100 + month % SYNTH_MONTHS;
+		if (md_of[i % np] == MD_T_CZCE) {
+			snprintf(symbol, sizeof(symbol), "%s%03u", p->name, month % 1000);
+		} else {
+			snprintf(symbol, sizeof(symbol), "%s%04u", p->name, month);
+		}
+
+		in = &s->ins[i];
+		if ((in->id = tick_intern(symbol, strlen(symbol))) == 0) {
+			free(s);
+			return NULL;
+		}
+		in->tick = tick_px(p->tick);
+		in->pre = in->tick * (tick_px(p->price) / in->tick);
+		in->last = in->high = in->low = in->pre;
+		in->pre_oi = in->oi = 100000 + (int64_t)(synth_rand(s) % 200000);
+	}
+
+	return s;
+}
+
+void
+synth_free(synth_t *s)
+{
+	free(s);
+}
+
+uint32_t
+synth_count(const synth_t *s)
+{
+	return s->n;
+}
+
+void
+synth_snap(synth_t *s, uint32_t i, uint64_t ts, uint32_t flags, tick_rec_t *out)
+{
+	struct instrument *in = &s->ins[i % s->n];
+	uint64_t r = synth_rand(s);
+	int64_t dv, limit;
+	int k;
+
+	/* a step of -2 to 2 ticks, most often none, within the limits of the day */
+	limit = in->pre / 100 * 7;
+	in->last += in->tick * steps[r & 15];
+	if (in->last > in->pre + limit || in->last < in->pre - limit) {
+		in->last = in->pre;
+	}
+	in->high = in->last > in->high ? in->last : in->high;
+	in->low = in->last < in->low ? in->last : in->low;
+	dv = 1 + (int64_t)((r >> 8) % 20);
+	in->volume += dv;
+	in->turnover += dv * in->last;
+	in->oi += (int64_t)((r >> 16) % 5) - 2;
+
+	memset(out, 0, sizeof(*out));
+	out->timestamp = ts / 1000000ULL * 1000000ULL;
+	out->instrument = in->id;
+	out->flags = flags;
+	out->last = in->last;
+	out->volume = in->volume;
+	out->turnover = in->turnover;
+	out->open_interest = in->oi;
+	out->open = in->pre;
+	out->high = in->high;
+	out->low = in->low;
+	out->pre_close = in->pre;
+	out->pre_settle = in->pre;
+	out->pre_oi = in->pre_oi;
+	out->upper_limit = in->pre + limit;
+	out->lower_limit = in->pre - limit;
+	out->level = TICK_DEPTH;
+	for (k = 0; k < TICK_DEPTH; k++) {
+		out->bid[k] = in->last - in->tick * k;
+		out->ask[k] = in->last + in->tick * (k + 1);
+		out->bid_vol[k] = 1 + (int32_t)((r >> (24 + 4 * k)) % 200);
+		out->ask_vol[k] = 1 + (int32_t)((r >> (26 + 4 * k)) % 200);
+	}
+}
+
+void
+synth_tick(synth_t *s, uint64_t ts, tick_rec_t *out)
+{
+	uint64_t u = synth_rand(s) >> 32;
+
+	/* u^2 of a uniform u, a quarter of the ticks in the first 1/16 */
+	synth_snap(s, (uint32_t)((u * u >> 32) * s->n >> 32), ts, 0, out);
+}
+
+const char *
+synth_md_name(int md_type)
+{
+	return (unsigned int)md_type < MD_T_MAX && tick_decoders[md_type] != NULL ? tick_decoders[md_type]->name : "?";
+}
+
+int
+synth_md_type(const char *name)
+{
+	int i;
+
+	for (i = 0; i < MD_T_MAX; i++) {
+		if (tick_decoders[i] != NULL && strcasecmp(tick_decoders[i]->name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
@@ -0,0 +1,56 @@
+/*
+ * synth.h
+ *
+ * The file contains the definition of the synthetic tick source and the
+ * functions' prototype for making ticks with it, for the benchmarks and the
+ * synthetic feeds.
+ *
+ * The instruments are the front months of the products of the exchange of
+ * md_type, every one with a random walk of its price in ticks of the
+ * product, and the book, the volume and the open interest following it.
+ * The activity is skewed to the first instruments, as it is to the major
+ * contracts of a real feed.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __SYNTH_H__
+#define __SYNTH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "tick.h"
+
+#define SYNTH_MONTHS	12		/* contracts of a product */
+
+typedef struct synth synth_t;
+
+/*
+ * synth_create - a source of n instruments of the exchange of md_type,
+ * interned with tick_intern(), and the sequence of its random numbers from
+ * seed, so the same seed gives the same ticks.
+ */
+synth_t *synth_create(int md_type, uint32_t n, uint64_t seed);
+void synth_free(synth_t *s);
+uint32_t synth_count(const synth_t *s);
+
+/*
+ * synth_tick - the next tick of a random instrument at ts, in ms, as the
+ * exchanges stamp them; synth_snap() the tick of the instrument i, e.g. of
+ * all of them for the result of the call auction with TICK_F_AUCTION.
+ */
+void synth_tick(synth_t *s, uint64_t ts, tick_rec_t *out);
+void synth_snap(synth_t *s, uint32_t i, uint64_t ts, uint32_t flags, tick_rec_t *out);
+
+/*
+ * synth_md_name/synth_md_type - the name of the decoder of md_type, "SHFE"
+ * ..., and md_type of a name in any letter case, -1 if it has no decoder.
+ */
+const char *synth_md_name(int md_type);
+int synth_md_type(const char *name);
+
+/* synth_rand - the next random number of the source, uniform */
+uint64_t synth_rand(synth_t *s);
+
+#endif		/* __SYNTH_H__ */
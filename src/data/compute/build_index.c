@@ -0,0 +1,286 @@
+/*
+ * build_index.c
+ *
+ * The program builds the index files of compute_product_index.py from the
+ * column store, <exchange>_<product>_index.csv of every product with the
+ * total volume and open interest and the eight weighted prices of every
+ * trading day, in one pass over the daily bars of the product.
+ *
+ *	build_index -r store -e shfe -o index
+ *	build_index -r store -e shfe -p cu,al -o index -a
+ *
+ * With -a the days after the last one of an existing file are appended to
+ * it and the history is left as it is; without it, or with no file yet,
+ * the file is written anew.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "pindex.h"
+
+#define NAME_LEN	16
+
+static const char header[] =
+	"date,exchange,product,total_volume,total_oi,"
+	"volume_open_index,oi_open_index,volume_high_index,oi_high_index,"
+	"volume_low_index,oi_low_index,volume_close_index,oi_close_index\n";
+
+struct out
+{
+	FILE *fp;
+	const char *exchange;
+	const char *product;
+	int64_t min_volume, max_volume;
+	int64_t min_oi, max_oi;
+};
+
+static void
+write_bar(const struct pidx_bar *bar, void *arg)
+{
+	struct out *o = arg;
+	int32_t d = bar->trading_day;
+	int p, w;
+
+	fprintf(o->fp, "%04d-%02d-%02d,%s,%s,%ld,%ld", d / 10000, d / 100 % 100, d % 100,
+		o->exchange, o->product, (long)bar->total_volume, (long)bar->total_oi);
+	for (p = 0; p < PIDX_NPRICE; p++) {
+		for (w = 0; w < PIDX_NWEIGHT; w++) {
+			if (isnan(bar->index[p][w])) {
+				fputs(",", o->fp);
+			} else {
+				fprintf(o->fp, ",%.2f", bar->index[p][w]);
+			}
+		}
+	}
+	fputc('\n', o->fp);
+
+	if (bar->total_volume < o->min_volume) {
+		o->min_volume = bar->total_volume;
+	}
+	if (bar->total_volume > o->max_volume) {
+		o->max_volume = bar->total_volume;
+	}
+	if (bar->total_oi < o->min_oi) {
+		o->min_oi = bar->total_oi;
+	}
+	if (bar->total_oi > o->max_oi) {
+		o->max_oi = bar->total_oi;
+	}
+}
+
+/*
+ * last_day - the trading day of the last line of the index file, 0 if it
+ * has none, -1 if there is no file.
+ */
+static int32_t
+last_day(const char *path)
+{
+	char buf[1024], *line;
+	int y, m, d;
+	long size, off;
+	size_t n;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		return -1;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	off = size > (long)sizeof(buf) - 1 ? size - (long)sizeof(buf) + 1 : 0;
+	fseek(fp, off, SEEK_SET);
+	n = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+
+	while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) {
+		n--;
+	}
+	buf[n] = '\0';
+	line = (line = strrchr(buf, '\n')) != NULL ? line + 1 : buf;
+
+	if (sscanf(line, "%4d-%2d-%2d", &y, &m, &d) != 3) {
+		return 0;
+	}
+
+	return y * 10000 + m * 100 + d;
+}
+
+/*
+ * build - the index file of the product, the days after the last one if
+ * append; returns 0 on success.
+ */
+static int
+build(const char *root, const char *exchange, const char *product, const char *outdir, int append)
+{
+	char src[4096], dst[4096 + 256], tmp[4096 + 260];
+	struct out o = { NULL, exchange, product, INT64_MAX, INT64_MIN, INT64_MAX, INT64_MIN };
+	uint64_t first = 0, nbars;
+	int32_t last = -1;
+	col_file_t f;
+
+	if (col_path(src, sizeof(src), root, exchange, product, BAR_T_DAY) != 0 ||
+	    col_open(&f, src) != 0) {
+		fprintf(stderr, "cannot map %s\n", src);
+		return -1;
+	}
+
+	snprintf(dst, sizeof(dst), "%s/%s_%s_index.csv", outdir, exchange, product);
+	if (append && (last = last_day(dst)) > 0) {
+		first = col_day_after(&f, last);
+		if ((o.fp = fopen(dst, "a")) == NULL) {
+			fprintf(stderr, "cannot open %s: %s\n", dst, strerror(errno));
+			col_close(&f);
+			return -1;
+		}
+	} else {
+		snprintf(tmp, sizeof(tmp), "%s.tmp", dst);
+		if ((o.fp = fopen(tmp, "w")) == NULL) {
+			fprintf(stderr, "cannot create %s: %s\n", tmp, strerror(errno));
+			col_close(&f);
+			return -1;
+		}
+		fputs(header, o.fp);
+		last = -1;
+	}
+
+	nbars = pidx_fold(&f, first, f.nrows, write_bar, &o);
+	col_close(&f);
+
+	if (fclose(o.fp) != 0) {
+		fprintf(stderr, "cannot write %s\n", last > 0 ? dst : tmp);
+		return -1;
+	}
+	if (last <= 0 && rename(tmp, dst) != 0) {
+		fprintf(stderr, "cannot rename %s: %s\n", tmp, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	if (nbars == 0) {
+		fprintf(stderr, "%s: up to date\n", dst);
+	} else {
+		fprintf(stderr, "%s: %s %lu dates, volume %ld to %ld, oi %ld to %ld\n", dst,
+			last > 0 ? "appended" : "created", (unsigned long)nbars,
+			(long)o.min_volume, (long)o.max_volume, (long)o.min_oi, (long)o.max_oi);
+	}
+
+	return 0;
+}
+
+/*
+ * build_list - the products of the comma list, all of the exchange if NULL.
+ */
+static int
+build_list(const char *root, const char *exchange, const char *products, const char *outdir,
+	   int append)
+{
+	char dir[4096], suffix[64], product[NAME_LEN];
+	struct dirent *de;
+	const char *p, *q;
+	size_t len, slen;
+	int rc = 0;
+	DIR *dp;
+
+	if (products != NULL) {
+		for (p = products; *p != '\0'; p = *q ? q + 1 : q) {
+			q = p + strcspn(p, ",");
+			len = (size_t)(q - p);
+			if (len == 0 || len >= NAME_LEN) {
+				continue;
+			}
+			memcpy(product, p, len);
+			product[len] = '\0';
+			if (build(root, exchange, product, outdir, append) != 0) {
+				rc = -1;
+			}
+		}
+		return rc;
+	}
+
+	snprintf(dir, sizeof(dir), "%s/%s", root, exchange);
+	slen = (size_t)snprintf(suffix, sizeof(suffix), ".%s%s", bar_type_names[BAR_T_DAY], COL_SUFFIX);
+	if ((dp = opendir(dir)) == NULL) {
+		fprintf(stderr, "cannot open %s\n", dir);
+		return -1;
+	}
+
+	while ((de = readdir(dp)) != NULL) {
+		len = strlen(de->d_name);
+		if (len <= slen || len - slen >= NAME_LEN ||
+		    strcmp(de->d_name + len - slen, suffix) != 0) {
+			continue;
+		}
+		memcpy(product, de->d_name, len - slen);
+		product[len - slen] = '\0';
+		if (build(root, exchange, product, outdir, append) != 0) {
+			rc = -1;
+		}
+	}
+	closedir(dp);
+
+	return rc;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root -e exchange [-p products] -o outdir [-a]\n"
+		"  -r root      directory of the store\n"
+		"  -e exchange  exchange of the products, e.g. shfe\n"
+		"  -p products  comma separated products (default all of the exchange)\n"
+		"  -o outdir    directory of the index files\n"
+		"  -a           append the new days to the existing files\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *root = NULL, *exchange = NULL, *products = NULL, *outdir = NULL;
+	int append = 0, opt;
+
+	while ((opt = getopt(argc, argv, "r:e:p:o:a")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'e':
+			exchange = optarg;
+			break;
+		case 'p':
+			products = optarg;
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
+		case 'a':
+			append = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || exchange == NULL || outdir == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (mkdir(outdir, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "cannot make %s: %s\n", outdir, strerror(errno));
+		return 1;
+	}
+
+	return build_list(root, exchange, products, outdir, append) == 0 ? 0 : 1;
+}
@@ -2,14 +2,17 @@ import os
 import pandas as pd
 import numpy as np
 import glob
-import re
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'store'))
+import instrument
+
+# the instrument master of $JUPITER_INSTRUMENTS, None without one
+INSTRUMENTS = instrument.load()
 
 def extract_product_code(contract_name):
-    """Extract product code from contract name (e.g., 'IC' from 'IC2101')"""
-    match = re.match(r'^[A-Za-z]+', contract_name)
-    if match:
-        return match.group(0)
-    return None
+    """Product code of a contract name (e.g., 'IC' from 'IC2101'), from the instrument master if it has it"""
+    return instrument.products([contract_name], INSTRUMENTS)[0]
 
 def calculate_weighted_index(group, price_column, weight_column):
     """
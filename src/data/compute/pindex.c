@@ -0,0 +1,76 @@
+/*
+ * pindex.c
+ *
+ * The functions are used to fold the contracts of a product into its
+ * index bars in one pass over the rows of the column store, all the eight
+ * weighted prices together.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pindex.h"
+
+uint64_t
+pidx_fold(const col_file_t *f, uint64_t first, uint64_t last, pidx_cb_t cb, void *arg)
+{
+	const double *px[PIDX_NPRICE] = { f->open, f->high, f->low, f->close };
+	uint64_t row = first, end, nbars = 0;
+	int daily = f->hdr->bar_type >= BAR_T_DAY;
+	struct pidx_bar bar;
+	int p, w;
+
+	if (last > f->nrows) {
+		last = f->nrows;
+	}
+
+	while (row < last) {
+		double sum[PIDX_NPRICE][PIDX_NWEIGHT] = { { 0 } };
+		double weight[PIDX_NPRICE][PIDX_NWEIGHT] = { { 0 } };
+
+		bar.timestamp = f->timestamp[row];
+		bar.trading_day = f->trading_day[row];
+		bar.total_volume = 0;
+		bar.total_oi = 0;
+
+		for (end = row; end < last; end++) {
+			double wt[PIDX_NWEIGHT] = { (double)f->volume[end], (double)f->oi[end] };
+
+			if (daily ? f->trading_day[end] != bar.trading_day : f->timestamp[end] != bar.timestamp) {
+				break;
+			}
+			if (f->timestamp[end] > bar.timestamp) {
+				bar.timestamp = f->timestamp[end];
+			}
+			bar.total_volume += f->volume[end];
+			bar.total_oi += f->oi[end];
+
+			for (p = 0; p < PIDX_NPRICE; p++) {
+				double price = px[p][end];
+
+				if (isnan(price)) {
+					continue;
+				}
+				for (w = 0; w < PIDX_NWEIGHT; w++) {
+					sum[p][w] += price * wt[w];
+					weight[p][w] += wt[w];
+				}
+			}
+		}
+
+		for (p = 0; p < PIDX_NPRICE; p++) {
+			for (w = 0; w < PIDX_NWEIGHT; w++) {
+				bar.index[p][w] = weight[p][w] != 0 ? sum[p][w] / weight[p][w] : NAN;
+			}
+		}
+
+		cb(&bar, arg);
+		nbars++;
+		row = end;
+	}
+
+	return nbars;
+}
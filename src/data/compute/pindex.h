@@ -0,0 +1,47 @@
+/*
+ * pindex.h
+ *
+ * The header file contains the definition of the product index and the
+ * functions' prototype for building it from the column store.
+ *
+ * The index of a product on a bar is the weighted price of all of its
+ * contracts, as compute_product_index.py computes it:
+ *
+ *	index = Σ(price_i * weight_i) / Σweight_i
+ *
+ * for the open, high, low and close prices, each weighted by the volume
+ * and by the open interest, over the contracts whose price is known; with
+ * the weights adding up to nothing the index is unknown (NaN). The totals
+ * of the volume and the open interest come with it.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __PINDEX_H__
+#define __PINDEX_H__
+
+#include <stdint.h>
+#include "colstore.h"
+
+enum pidx_price { PIDX_OPEN = 0, PIDX_HIGH, PIDX_LOW, PIDX_CLOSE, PIDX_NPRICE };
+enum pidx_weight { PIDX_VOLUME = 0, PIDX_OI, PIDX_NWEIGHT };
+
+struct pidx_bar
+{
+	int64_t timestamp;		/* ns since epoch of the end of the bar */
+	int32_t trading_day;		/* YYYYMMDD */
+	int64_t total_volume;
+	int64_t total_oi;
+	double index[PIDX_NPRICE][PIDX_NWEIGHT];
+};
+
+typedef void (*pidx_cb_t)(const struct pidx_bar *bar, void *arg);
+
+/*
+ * pidx_fold - the index bars of the rows [first, last) of the file in one
+ * pass, a bar for the contracts of every timestamp, of every trading day
+ * for the daily and longer bars. Returns the bars.
+ */
+uint64_t pidx_fold(const col_file_t *f, uint64_t first, uint64_t last, pidx_cb_t cb, void *arg);
+
+#endif		/* __PINDEX_H__ */
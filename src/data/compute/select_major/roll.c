@@ -0,0 +1,290 @@
+/*
+ * roll.c
+ *
+ * The functions are used to step the roll engine over the trading days of
+ * the column store and to save its state between the runs.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include "parse.h"
+#include "roll.h"
+
+#define NONE	UINT64_MAX
+
+const char *const roll_strategy_names[ROLL_NSTRATEGY] = {
+	[ROLL_VOLUME] = "volume",
+	[ROLL_OI] = "oi",
+	[ROLL_TIME] = "time",
+	[ROLL_FIXED] = "fixed",
+};
+
+int
+roll_strategy_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ROLL_NSTRATEGY; i++) {
+		if (strcmp(name, roll_strategy_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int32_t
+roll_delivery(const char *symbol, int32_t day)
+{
+	const char *p = symbol;
+	int32_t v = 0, y, m, n = 0, dy = day / 10000;
+
+	while (isalpha((unsigned char)*p)) {
+		p++;
+	}
+	for (; isdigit((unsigned char)*p) && n < 7; p++, n++) {
+		v = v * 10 + (*p - '0');
+	}
+
+	m = v % 100;
+	switch (n) {
+	case 3:
+		/* YMM, the decade is the one of the day */
+		y = dy - dy % 10 + v / 100;
+		if (y > dy + 5) {
+			y -= 10;
+		} else if (y < dy - 4) {
+			y += 10;
+		}
+		break;
+	case 4:
+		y = 2000 + v / 100;
+		break;
+	case 6:
+		y = v / 100;
+		break;
+	default:
+		return 0;
+	}
+
+	return m >= 1 && m <= 12 ? y * 100 + m : 0;
+}
+
+/* the last day a delivery is held by the calendar strategies, as a day number */
+static int64_t
+roll_date(int32_t delivery, int32_t days)
+{
+	int32_t y = delivery / 100, m = delivery % 100;
+
+	return days_from_civil(m == 12 ? y + 1 : y, m == 12 ? 1 : (uint32_t)m + 1, 1) - 1 - days;
+}
+
+void
+roll_init(struct roll_state *s, const struct roll_conf *conf)
+{
+	memset(s, 0, sizeof(*s));
+	s->magic = ROLL_MAGIC;
+	s->version = ROLL_VERSION;
+	s->conf = *conf;
+	s->cum_ratio = 1;
+}
+
+int
+roll_load(struct roll_state *s, const struct roll_conf *conf, const char *path)
+{
+	FILE *fp;
+	size_t n;
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		return -1;
+	}
+	n = fread(s, sizeof(*s), 1, fp);
+	fclose(fp);
+
+	if (n != 1 || s->magic != ROLL_MAGIC || s->version != ROLL_VERSION ||
+	    memcmp(&s->conf, conf, sizeof(*conf)) != 0) {
+		roll_init(s, conf);
+		return -1;
+	}
+	s->major[COL_SYMBOL_LEN - 1] = '\0';
+
+	return 0;
+}
+
+int
+roll_save(const struct roll_state *s, const char *path)
+{
+	char tmp[4096];
+	FILE *fp;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		fprintf(stderr, "cannot create %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+	if (fwrite(s, sizeof(*s), 1, fp) != 1 || fclose(fp) != 0) {
+		fprintf(stderr, "cannot write %s\n", tmp);
+		unlink(tmp);
+		return -1;
+	}
+	if (rename(tmp, path) != 0) {
+		fprintf(stderr, "cannot rename %s: %s\n", tmp, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+static inline const char *
+symbol_of(const col_file_t *f, uint64_t row)
+{
+	return f->symbols[f->instrument[row]];
+}
+
+/*
+ * step_weight - the major of the rows [a, b) of a day by the volume or the
+ * open interest; cur is the bar of the major, NONE if it has none today.
+ */
+static uint64_t
+step_weight(const struct roll_state *s, const col_file_t *f, uint64_t a, uint64_t b,
+	    int32_t day, uint64_t cur, int32_t cur_delivery)
+{
+	const int64_t *weight = s->conf.strategy == ROLL_OI ? f->oi : f->volume;
+	uint64_t best = NONE, i;
+	int32_t d;
+
+	for (i = a; i < b; i++) {
+		if (i == cur) {
+			continue;
+		}
+		d = roll_delivery(symbol_of(f, i), day);
+		if (s->conf.months != 0 && (d == 0 || !(s->conf.months & (1U << (d % 100))))) {
+			continue;
+		}
+		if (s->conf.forward && s->major[0] != '\0' && d <= cur_delivery) {
+			continue;
+		}
+		if (cur != NONE && weight[i] <= weight[cur]) {
+			continue;
+		}
+		if (best == NONE || weight[i] > weight[best]) {
+			best = i;
+		}
+	}
+
+	return best != NONE ? best : cur;
+}
+
+/*
+ * step_calendar - the major of the rows [a, b) of a day by the delivery, the
+ * nearest one not past its roll date and not before that of the major.
+ */
+static uint64_t
+step_calendar(const struct roll_state *s, const col_file_t *f, uint64_t a, uint64_t b,
+	      int32_t day, int32_t cur_delivery)
+{
+	int64_t today = days_from_civil(day / 10000, (uint32_t)(day / 100 % 100), (uint32_t)(day % 100));
+	int32_t d, best_delivery = 0;
+	uint64_t best = NONE, i;
+
+	for (i = a; i < b; i++) {
+		d = roll_delivery(symbol_of(f, i), day);
+		if (d == 0 || (s->conf.months != 0 && !(s->conf.months & (1U << (d % 100))))) {
+			continue;
+		}
+		if (d < cur_delivery || today > roll_date(d, s->conf.days)) {
+			continue;
+		}
+		if (best == NONE || d < best_delivery) {
+			best = i;
+			best_delivery = d;
+		}
+	}
+
+	return best;
+}
+
+uint64_t
+roll_run(struct roll_state *s, const col_file_t *f, roll_cb_t cb, void *arg)
+{
+	uint64_t row = s->last_day > 0 ? col_day_after(f, s->last_day) : 0, end, cur, pick, ndays = 0;
+	int64_t code = s->major[0] != '\0' ? col_lookup(f, s->major) : -1;
+	int32_t cur_delivery = s->major[0] != '\0' ? roll_delivery(s->major, s->since) : 0;
+	char prev[COL_SYMBOL_LEN];
+	struct col_segment seg;
+	struct roll_day rd;
+	double prev_close;
+	int32_t day;
+
+	while (row < f->nrows) {
+		day = f->trading_day[row];
+		cur = NONE;
+		for (end = row; end < f->nrows && f->trading_day[end] == day; end++) {
+			if ((int64_t)f->instrument[end] == code) {
+				cur = end;
+			}
+		}
+
+		if (s->conf.strategy == ROLL_TIME || s->conf.strategy == ROLL_FIXED) {
+			pick = step_calendar(s, f, row, end, day, cur_delivery);
+		} else {
+			pick = step_weight(s, f, row, end, day, cur, cur_delivery);
+		}
+
+		s->last_day = day;
+		row = end;
+		if (pick == NONE) {
+			continue;
+		}
+
+		rd.trading_day = day;
+		rd.row = pick;
+		rd.major = symbol_of(f, pick);
+		rd.prev = NULL;
+		rd.segment = NULL;
+		if ((int64_t)f->instrument[pick] != code) {
+			memset(&seg, 0, sizeof(seg));
+			seg.trading_day = day;
+			seg.gap = 0;
+			seg.ratio = 1;
+			if (s->major[0] != '\0') {
+				memcpy(prev, s->major, sizeof(prev));
+				rd.prev = prev;
+				s->nrolls++;
+
+				prev_close = cur != NONE ? f->close[cur] : s->close;
+				if (isfinite(prev_close) && isfinite(f->close[pick]) && prev_close != 0) {
+					seg.gap = f->close[pick] - prev_close;
+					seg.ratio = f->close[pick] / prev_close;
+				}
+			}
+			s->cum_gap += seg.gap;
+			s->cum_ratio *= seg.ratio;
+			seg.cum_gap = s->cum_gap;
+			seg.cum_ratio = s->cum_ratio;
+			snprintf(seg.symbol, sizeof(seg.symbol), "%s", rd.major);
+			rd.segment = &seg;
+
+			snprintf(s->major, sizeof(s->major), "%s", rd.major);
+			s->since = day;
+			code = f->instrument[pick];
+			cur_delivery = roll_delivery(s->major, day);
+		}
+		if (isfinite(f->close[pick])) {
+			s->close = f->close[pick];
+		}
+
+		cb(&rd, arg);
+		ndays++;
+	}
+
+	return ndays;
+}
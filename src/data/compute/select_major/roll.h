@@ -0,0 +1,110 @@
+/*
+ * roll.h
+ *
+ * The header file contains the definition of the roll engine and the
+ * functions' prototype.
+ *
+ * The engine picks the major (dominant) contract of a product for every
+ * trading day in one pass over the daily bars of the column store, looking
+ * only at the contracts of the day, with the roll strategies of
+ * select_major.py and continuous_kline.py:
+ *
+ *	volume   the contract of the highest volume on the first day; later
+ *		 the highest of those above the volume of the major, from the
+ *		 same day, or the highest if the major has no bar
+ *	oi       the same by the open interest
+ *	time     the nearest delivery, held to days calendar days before the
+ *		 end of its delivery month, then the next delivery
+ *	fixed    the same as time, continuous_kline.py rolls both on the
+ *		 month end less rollover_days
+ *
+ * The state is small and saved between the runs, so a new trading day is
+ * stepped in O(contracts of the day) instead of going over the history.
+ * Every day gives the row of its major, and the roll if there was one, to
+ * the index builder and the matcher alike. A roll begins a segment of the
+ * continuous series of colstore.h, with its gap and ratio to the close of
+ * the major before on the same day, its last close if it has no bar.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __ROLL_H__
+#define __ROLL_H__
+
+#include <stdint.h>
+#include "colstore.h"
+
+#define ROLL_MAGIC	0x4c4f524aU	/* "JROL" */
+#define ROLL_VERSION	2
+
+enum roll_strategy {
+	ROLL_VOLUME = 0,
+	ROLL_OI,
+	ROLL_TIME,
+	ROLL_FIXED,
+	ROLL_NSTRATEGY
+};
+
+extern const char *const roll_strategy_names[ROLL_NSTRATEGY];
+
+int roll_strategy_parse(const char *name);
+
+struct roll_conf
+{
+	int32_t strategy;		/* enum roll_strategy */
+	int32_t days;			/* time, fixed: days before the month end */
+	uint32_t months;		/* bit m of the delivery months used, 0 for all */
+	int32_t forward;		/* volume, oi: roll to later deliveries only */
+};
+
+/*
+ * roll_state - what the next day is stepped from, saved as it is.
+ */
+struct roll_state
+{
+	uint32_t magic;
+	uint32_t version;
+	struct roll_conf conf;
+	int32_t last_day;		/* the last day stepped, 0 for none */
+	int32_t since;			/* the day the major became major */
+	uint32_t nrolls;
+	uint32_t reserved;
+	double close;			/* the last close of the major */
+	double cum_gap;			/* the factors of its segment */
+	double cum_ratio;
+	char major[COL_SYMBOL_LEN];	/* "" for none */
+};
+
+struct roll_day
+{
+	int32_t trading_day;
+	uint64_t row;			/* the bar of the major in the file */
+	const char *major;
+	const char *prev;		/* the major before it if rolled, else NULL */
+	const struct col_segment *segment;	/* the segment it begins, else NULL */
+};
+
+typedef void (*roll_cb_t)(const struct roll_day *day, void *arg);
+
+void roll_init(struct roll_state *s, const struct roll_conf *conf);
+
+/*
+ * roll_load - the state saved to path; returns -1 if there is none or it
+ * was saved with another conf.
+ */
+int roll_load(struct roll_state *s, const struct roll_conf *conf, const char *path);
+int roll_save(const struct roll_state *s, const char *path);
+
+/*
+ * roll_run - step the days of the file after the last one of the state,
+ * calling cb with the major of every day that has one. Returns the days.
+ */
+uint64_t roll_run(struct roll_state *s, const col_file_t *f, roll_cb_t cb, void *arg);
+
+/*
+ * roll_delivery - the delivery month YYYYMM of the symbol, the year of
+ * the 3-digit ones of CZCE taken near the day; 0 if it has none.
+ */
+int32_t roll_delivery(const char *symbol, int32_t day);
+
+#endif		/* __ROLL_H__ */
@@ -0,0 +1,330 @@
+/*
+ * select_major.c
+ *
+ * The program picks the major contract of every trading day of the
+ * products with the roll engine, from the daily bars of the column store:
+ *
+ *	<exchange>_<product>_major.csv    the bar of the major of every day
+ *	<exchange>_<product>_roll.csv     the rolls, day, from, to and the factors
+ *	<exchange>_<product>.jseg         the segments of colstore.h
+ *	<exchange>_<product>.roll         the state of the engine
+ *
+ *	select_major -r store -e shfe -o major
+ *	select_major -r store -e shfe -p cu -s time -d 15 -m 1,5,9 -o major -a
+ *
+ * The major bars are the raw prices stitched once; the readers adjust them
+ * by the cumulative factors of the segments, so a roll appends a segment
+ * and no history is rewritten. With -a the days after the state are
+ * appended to the files; without it, or if the state was saved with other
+ * options, the files are written anew.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "roll.h"
+
+#define NAME_LEN	16
+
+struct out
+{
+	FILE *major;
+	FILE *roll;
+	const col_file_t *f;
+	const char *exchange;
+	const char *product;
+	uint64_t nrolls;
+	struct col_segment *segs;
+	uint64_t nsegs, cap;
+};
+
+static void
+write_day(const struct roll_day *rd, void *arg)
+{
+	struct out *o = arg;
+	const col_file_t *f = o->f;
+	int32_t d = rd->trading_day;
+	uint64_t i = rd->row;
+
+	fprintf(o->major, "%04d-%02d-%02d,%s,%s,%s,%.2f,%.2f,%.2f,%.2f,%ld,%ld,%.2f\n",
+		d / 10000, d / 100 % 100, d % 100, o->exchange, o->product, rd->major,
+		f->open[i], f->high[i], f->low[i], f->close[i], (long)f->volume[i], (long)f->oi[i],
+		f->amount[i]);
+
+	if (rd->prev != NULL) {
+		fprintf(o->roll, "%04d-%02d-%02d,%s,%s,%.6f,%.8f,%.6f,%.8f\n",
+			d / 10000, d / 100 % 100, d % 100, rd->prev, rd->major, rd->segment->gap,
+			rd->segment->ratio, rd->segment->cum_gap, rd->segment->cum_ratio);
+		o->nrolls++;
+	}
+
+	if (rd->segment != NULL) {
+		if (o->nsegs == o->cap) {
+			struct col_segment *segs;
+
+			o->cap = o->cap ? o->cap * 2 : 64;
+			if ((segs = realloc(o->segs, o->cap * sizeof(*segs))) == NULL) {
+				fprintf(stderr, "out of memory for the segments\n");
+				exit(1);
+			}
+			o->segs = segs;
+		}
+		o->segs[o->nsegs++] = *rd->segment;
+	}
+}
+
+static FILE *
+open_out(const char *path, const char *tmp, int append, const char *header)
+{
+	FILE *fp;
+
+	if ((fp = fopen(append ? path : tmp, append ? "a" : "w")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", append ? path : tmp, strerror(errno));
+		return NULL;
+	}
+	if (!append) {
+		fputs(header, fp);
+	}
+
+	return fp;
+}
+
+/*
+ * select_product - the major files of the product; returns 0 on success.
+ */
+static int
+select_product(const char *root, const char *exchange, const char *product, const char *outdir,
+	       const struct roll_conf *conf, int append)
+{
+	char src[4096], major[4096 + 256], roll[4096 + 256], seg[4096 + 256], state[4096 + 256];
+	char major_tmp[4096 + 260], roll_tmp[4096 + 260];
+	struct out o = { NULL, NULL, NULL, exchange, product, 0, NULL, 0, 0 };
+	struct roll_state s;
+	uint64_t ndays;
+	col_file_t f;
+	int rc = 0;
+
+	if (col_path(src, sizeof(src), root, exchange, product, BAR_T_DAY) != 0 ||
+	    col_open(&f, src) != 0) {
+		fprintf(stderr, "cannot map %s\n", src);
+		return -1;
+	}
+	o.f = &f;
+
+	snprintf(major, sizeof(major), "%s/%s_%s_major.csv", outdir, exchange, product);
+	snprintf(roll, sizeof(roll), "%s/%s_%s_roll.csv", outdir, exchange, product);
+	snprintf(seg, sizeof(seg), "%s/%s_%s%s", outdir, exchange, product, COL_SEG_SUFFIX);
+	snprintf(state, sizeof(state), "%s/%s_%s.roll", outdir, exchange, product);
+	snprintf(major_tmp, sizeof(major_tmp), "%s.tmp", major);
+	snprintf(roll_tmp, sizeof(roll_tmp), "%s.tmp", roll);
+
+	if (!append || roll_load(&s, conf, state) != 0 || access(major, F_OK) != 0 ||
+	    access(roll, F_OK) != 0 || access(seg, F_OK) != 0) {
+		roll_init(&s, conf);
+		append = 0;
+	}
+
+	o.major = open_out(major, major_tmp, append,
+			   "date,exchange,product,contract,open,high,low,close,volume,oi,amount\n");
+	o.roll = open_out(roll, roll_tmp, append, "date,from,to,gap,ratio,cum_gap,cum_ratio\n");
+	if (o.major == NULL || o.roll == NULL) {
+		if (o.major != NULL) {
+			fclose(o.major);
+		}
+		col_close(&f);
+		return -1;
+	}
+
+	ndays = roll_run(&s, &f, write_day, &o);
+	col_close(&f);
+
+	if (fclose(o.major) != 0) {
+		fprintf(stderr, "cannot write %s\n", major);
+		rc = -1;
+	}
+	if (fclose(o.roll) != 0) {
+		fprintf(stderr, "cannot write %s\n", roll);
+		rc = -1;
+	}
+	if (rc == 0 && !append && (rename(major_tmp, major) != 0 || rename(roll_tmp, roll) != 0)) {
+		fprintf(stderr, "cannot rename the files of %s: %s\n", major, strerror(errno));
+		rc = -1;
+	}
+	if (rc == 0 && col_seg_append(seg, o.segs, o.nsegs, !append) != 0) {
+		rc = -1;
+	}
+	free(o.segs);
+	if (rc != 0) {
+		if (!append) {
+			unlink(major_tmp);
+			unlink(roll_tmp);
+		}
+		return -1;
+	}
+
+	/* the state goes last: the files are never behind it */
+	if (roll_save(&s, state) != 0) {
+		return -1;
+	}
+
+	fprintf(stderr, "%s: %s %lu days, %lu rolls, major %s since %d\n", major,
+		append ? "appended" : "created", (unsigned long)ndays, (unsigned long)o.nrolls,
+		s.major[0] != '\0' ? s.major : "none", s.since);
+
+	return 0;
+}
+
+static int
+select_list(const char *root, const char *exchange, const char *products, const char *outdir,
+	    const struct roll_conf *conf, int append)
+{
+	char dir[4096], suffix[64], product[NAME_LEN];
+	struct dirent *de;
+	const char *p, *q;
+	size_t len, slen;
+	int rc = 0;
+	DIR *dp;
+
+	if (products != NULL) {
+		for (p = products; *p != '\0'; p = *q ? q + 1 : q) {
+			q = p + strcspn(p, ",");
+			len = (size_t)(q - p);
+			if (len == 0 || len >= NAME_LEN) {
+				continue;
+			}
+			memcpy(product, p, len);
+			product[len] = '\0';
+			if (select_product(root, exchange, product, outdir, conf, append) != 0) {
+				rc = -1;
+			}
+		}
+		return rc;
+	}
+
+	snprintf(dir, sizeof(dir), "%s/%s", root, exchange);
+	slen = (size_t)snprintf(suffix, sizeof(suffix), ".%s%s", bar_type_names[BAR_T_DAY], COL_SUFFIX);
+	if ((dp = opendir(dir)) == NULL) {
+		fprintf(stderr, "cannot open %s\n", dir);
+		return -1;
+	}
+
+	while ((de = readdir(dp)) != NULL) {
+		len = strlen(de->d_name);
+		if (len <= slen || len - slen >= NAME_LEN ||
+		    strcmp(de->d_name + len - slen, suffix) != 0) {
+			continue;
+		}
+		memcpy(product, de->d_name, len - slen);
+		product[len - slen] = '\0';
+		if (select_product(root, exchange, product, outdir, conf, append) != 0) {
+			rc = -1;
+		}
+	}
+	closedir(dp);
+
+	return rc;
+}
+
+/* the comma separated delivery months as bits */
+static int
+parse_months(const char *s, uint32_t *months)
+{
+	char *end;
+	long m;
+
+	for (*months = 0; *s != '\0'; s = *end ? end + 1 : end) {
+		m = strtol(s, &end, 10);
+		if (end == s || m < 1 || m > 12 || (*end != ',' && *end != '\0')) {
+			return -1;
+		}
+		*months |= 1U << m;
+	}
+
+	return 0;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root -e exchange [-p products] -o outdir [-s strategy] [-d days]\n"
+		"          [-m months] [-F] [-a]\n"
+		"  -r root      directory of the store\n"
+		"  -e exchange  exchange of the products, e.g. shfe\n"
+		"  -p products  comma separated products (default all of the exchange)\n"
+		"  -o outdir    directory of the major files\n"
+		"  -s strategy  volume, oi, time or fixed (default volume)\n"
+		"  -d days      time, fixed: days before the end of the delivery month\n"
+		"  -m months    comma separated delivery months used, e.g. 1,5,9\n"
+		"  -F           volume, oi: roll to later deliveries only\n"
+		"  -a           append the new days to the existing files\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *root = NULL, *exchange = NULL, *products = NULL, *outdir = NULL;
+	struct roll_conf conf = { ROLL_VOLUME, 0, 0, 0 };
+	int append = 0, opt;
+
+	while ((opt = getopt(argc, argv, "r:e:p:o:s:d:m:Fa")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'e':
+			exchange = optarg;
+			break;
+		case 'p':
+			products = optarg;
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
+		case 's':
+			if ((conf.strategy = roll_strategy_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown roll strategy %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'd':
+			conf.days = atoi(optarg);
+			break;
+		case 'm':
+			if (parse_months(optarg, &conf.months) != 0) {
+				fprintf(stderr, "bad delivery months %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'F':
+			conf.forward = 1;
+			break;
+		case 'a':
+			append = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || exchange == NULL || outdir == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (mkdir(outdir, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "cannot make %s: %s\n", outdir, strerror(errno));
+		return 1;
+	}
+
+	return select_list(root, exchange, products, outdir, &conf, append) == 0 ? 0 : 1;
+}
@@ -1,12 +1,17 @@
 import pandas as pd
 import os
-import re
+import sys
 import glob
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'store'))
+import instrument
+
+# the instrument master of $JUPITER_INSTRUMENTS, None without one
+INSTRUMENTS = instrument.load()
+
 def extract_product(contract_name):
-    """Extract the product code from contract name"""
-    match = re.match(r'^([A-Za-z]+)', contract_name)
-    return match.group(1) if match else 'unknown'
+    """Product code of a contract name, from the instrument master if it has it"""
+    return instrument.products([contract_name], INSTRUMENTS)[0] or 'unknown'
 
 def identify_major_contracts(csv_file, output_dir='.'):
     """
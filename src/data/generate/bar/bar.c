@@ -0,0 +1,628 @@
+/*
+ * bar.c
+ *
+ * The functions are used to aggregate the ticks into bars of every type in
+ * one pass. Each instrument keeps the open bar of every type; a tick is
+ * checked against the end of the open bar, so the usual tick costs a compare
+ * and an update per type, and the segment of the session is only looked up
+ * when the tick leaves the cached one.
+ *
+ * The intraday bars are aligned to the clock and never span a break of the
+ * session. The day bar is of the trading day, whose night session starts on
+ * the evening before, and takes the open, high and low the exchange sends
+ * with the ticks, so it is right even if the engine starts in the middle of
+ * the day. The week, month and year bars are folded from the day bars.
+ *
+ * Copyright(C) by Jupiter Fund 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bar.h"
+#include "arena.h"
+#include "decode.h"
+#include "lat.h"
+#include "parse.h"
+
+#define NS		1000000000ULL
+#define DAY_NS		(86400 * NS)
+#define CN_OFFSET_NS	(8 * 3600 * NS)		/* China Standard Time is UTC+8 */
+#define EVENING_NS	(6 * 3600 * NS)		/* the session clock starts at 18:00 */
+#define POLL_BATCH	64
+
+#define PRE_OPEN_NS	(5 * 60 * NS)
+#define GRACE_NS	(3 * NS)
+
+static const uint64_t periods[BAR_T_INTRADAY] = {
+	[BAR_T_MIN] = 60 * NS,
+	[BAR_T_5MIN] = 300 * NS,
+	[BAR_T_15MIN] = 900 * NS,
+	[BAR_T_30MIN] = 1800 * NS,
+	[BAR_T_HOUR] = 3600 * NS,
+};
+
+const char *const bar_type_names[BAR_T_MAX] = {
+	[BAR_T_MIN] = "1min",
+	[BAR_T_5MIN] = "5min",
+	[BAR_T_15MIN] = "15min",
+	[BAR_T_30MIN] = "30min",
+	[BAR_T_HOUR] = "hour",
+	[BAR_T_DAY] = "day",
+	[BAR_T_WEEK] = "week",
+	[BAR_T_MONTH] = "month",
+	[BAR_T_YEAR] = "year",
+};
+
+struct bar_slot
+{
+	bar_rec_t bar;		/* open bar, bar.ticks is 0 if none */
+	int64_t base_volume;	/* cumulative volume before the open bar */
+	int64_t base_turnover;
+	uint64_t last_end;	/* end of the last bar emitted */
+};
+
+struct bar_inst
+{
+	uint32_t id;
+	uint32_t trading_day;	/* of the last tick */
+	uint32_t closed_day;	/* trading day whose day bar was emitted */
+	const struct bar_session *sess;
+
+	uint64_t seg_lo;	/* ticks in [seg_lo, seg_hi) fall in the cached segment */
+	uint64_t seg_hi;
+	uint64_t seg_start;	/* the cached segment */
+	uint64_t seg_end;
+	uint64_t day_end;	/* close of the trading day */
+
+	int64_t cum_volume;	/* the exchange's cumulative volume of the trading day */
+	int64_t cum_turnover;
+
+	struct bar_slot slot[BAR_T_INTRADAY];
+	bar_rec_t day;		/* open day bar */
+	bar_rec_t period[BAR_T_MAX - BAR_T_WEEK];	/* days folded into the week, month, year */
+};
+
+struct bar_engine
+{
+	struct bar_conf conf;
+	struct bar_calendar cal;
+	ring_t *ring;
+
+	arena_t arena;			/* all the memory of the instruments */
+	pool_t inst_pool;
+	struct bar_inst **insts;	/* by instrument id */
+	uint32_t *active;		/* ids of the instruments seen */
+	uint32_t nactive;
+
+	uint64_t cache_origin;		/* session clock origin of cache_day */
+	uint32_t cache_day;
+
+	struct bar_stats stats;
+};
+
+int
+bar_type_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < BAR_T_MAX; i++) {
+		if (strcmp(name, bar_type_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+bar_engine_t *
+bar_engine_create(const struct bar_conf *conf)
+{
+	bar_engine_t *eng;
+	size_t n, size;
+
+	if (conf == NULL || (conf->types & BAR_MASK_ALL) == 0) {
+		return NULL;
+	}
+
+	if ((eng = calloc(1, sizeof(*eng))) == NULL) {
+		return NULL;
+	}
+
+	eng->conf = *conf;
+	if (eng->conf.pre_open_ns == 0) {
+		eng->conf.pre_open_ns = PRE_OPEN_NS;
+	}
+	if (eng->conf.grace_ns == 0) {
+		eng->conf.grace_ns = GRACE_NS;
+	}
+
+	if ((conf->calendar != NULL && bar_calendar_load(&eng->cal, conf->calendar) != 0) ||
+	    (conf->sessions != NULL && bar_session_load(conf->sessions) != 0)) {
+		bar_engine_destroy(eng);
+		return NULL;
+	}
+
+	/* the tables and the state of the instruments expected, prefaulted now */
+	n = conf->instruments > 0 ? conf->instruments : ARENA_INSTRUMENTS;
+	n = n < TICK_INSTRUMENT_MAX ? n : TICK_INSTRUMENT_MAX;
+	size = (TICK_INSTRUMENT_MAX + 1) * sizeof(*eng->insts) + TICK_INSTRUMENT_MAX * sizeof(*eng->active) +
+	       n * sizeof(struct bar_inst) + 3 * ARENA_ALIGN;
+	if (arena_init(&eng->arena, size) != 0) {
+		bar_engine_destroy(eng);
+		return NULL;
+	}
+	eng->insts = arena_alloc(&eng->arena, (TICK_INSTRUMENT_MAX + 1) * sizeof(*eng->insts));
+	eng->active = arena_alloc(&eng->arena, TICK_INSTRUMENT_MAX * sizeof(*eng->active));
+	if (eng->insts == NULL || eng->active == NULL ||
+	    pool_init(&eng->inst_pool, &eng->arena, sizeof(struct bar_inst), n) != 0) {
+		bar_engine_destroy(eng);
+		return NULL;
+	}
+
+	if (conf->ring_capacity > 0 &&
+	    (eng->ring = ring_create(conf->ring_capacity, sizeof(bar_rec_t), 0)) == NULL) {
+		bar_engine_destroy(eng);
+		return NULL;
+	}
+
+	return eng;
+}
+
+void
+bar_engine_destroy(bar_engine_t *eng)
+{
+	if (eng == NULL) {
+		return;
+	}
+
+	arena_free(&eng->arena);
+	if (eng->ring != NULL) {
+		ring_destroy(eng->ring);
+	}
+	bar_calendar_free(&eng->cal);
+	free(eng);
+}
+
+static void
+emit(bar_engine_t *eng, const bar_rec_t *bar)
+{
+	/* a bar without a traded price carries nothing */
+	if (bar->open == 0) {
+		return;
+	}
+
+	eng->stats.bars++;
+	if (eng->ring != NULL) {
+		ring_push(eng->ring, bar);
+	}
+	if (eng->conf.on_bar != NULL) {
+		eng->conf.on_bar(bar, eng->conf.arg);
+	}
+}
+
+static inline void
+update_price(bar_rec_t *bar, int64_t px)
+{
+	if (px <= 0) {
+		return;
+	}
+
+	if (bar->open == 0) {
+		bar->open = bar->high = bar->low = px;
+	} else if (px > bar->high) {
+		bar->high = px;
+	} else if (px < bar->low) {
+		bar->low = px;
+	}
+	bar->close = px;
+}
+
+static void
+open_bar(bar_rec_t *bar, const struct bar_inst *inst, const tick_rec_t *t, int type,
+	 uint64_t start, uint64_t end)
+{
+	memset(bar, 0, sizeof(*bar));
+	bar->start = start;
+	bar->end = end;
+	bar->instrument = inst->id;
+	bar->trading_day = inst->trading_day;
+	bar->type = (uint8_t)type;
+	bar->md_type = t->md_type;
+}
+
+static void
+close_slot(bar_engine_t *eng, struct bar_slot *slot, uint16_t flags)
+{
+	slot->bar.flags |= flags;
+	emit(eng, &slot->bar);
+
+	slot->base_volume += slot->bar.volume;
+	slot->base_turnover += slot->bar.turnover;
+	slot->last_end = slot->bar.end;
+	slot->bar.ticks = 0;
+}
+
+static int64_t
+week_of(uint32_t day)
+{
+	/* weeks since the Monday before 1970-01-01, a Thursday */
+	return (days_from_civil(day / 10000, (day / 100) % 100, day % 100) + 3) / 7;
+}
+
+static void
+fold_day(bar_rec_t *p, const bar_rec_t *day, int type)
+{
+	if (p->ticks == 0) {
+		*p = *day;
+		p->type = (uint8_t)type;
+		return;
+	}
+
+	if (day->high > p->high) {
+		p->high = day->high;
+	}
+	if (day->low < p->low) {
+		p->low = day->low;
+	}
+	p->close = day->close;
+	p->volume += day->volume;
+	p->turnover += day->turnover;
+	p->open_interest = day->open_interest;
+	p->end = day->end;
+	p->trading_day = day->trading_day;
+	p->ticks += day->ticks;
+}
+
+/*
+ * close_day - emit the day bar and fold it into the longer periods, which
+ * are emitted with the last trading day of their week, month or year.
+ */
+static void
+close_day(bar_engine_t *eng, struct bar_inst *inst, uint16_t flags, int partial)
+{
+	uint32_t types = eng->conf.types, td = inst->day.trading_day, next;
+	int type, has_day = inst->day.ticks != 0 && inst->day.open != 0;
+
+	if (has_day) {
+		inst->day.flags |= flags;
+		if (types & BAR_MASK(BAR_T_DAY)) {
+			emit(eng, &inst->day);
+		}
+		inst->closed_day = td;
+	}
+
+	next = bar_calendar_next(&eng->cal, td);
+	for (type = BAR_T_WEEK; type < BAR_T_MAX; type++) {
+		bar_rec_t *p = &inst->period[type - BAR_T_WEEK];
+		int ends = 0;
+
+		if (!(types & BAR_MASK(type))) {
+			continue;
+		}
+
+		if (has_day) {
+			fold_day(p, &inst->day, type);
+			if (type == BAR_T_WEEK) {
+				ends = week_of(next) != week_of(td);
+			} else if (type == BAR_T_MONTH) {
+				ends = next / 100 != td / 100;
+			} else {
+				ends = next / 10000 != td / 10000;
+			}
+		}
+
+		if (p->ticks != 0 && (ends || partial)) {
+			p->flags = ends ? 0 : BAR_F_PARTIAL;
+			emit(eng, p);
+			p->ticks = 0;
+		}
+	}
+
+	inst->day.ticks = 0;
+}
+
+static void
+close_all(bar_engine_t *eng, struct bar_inst *inst)
+{
+	int type;
+
+	for (type = 0; type < BAR_T_INTRADAY; type++) {
+		if (inst->slot[type].bar.ticks != 0) {
+			close_slot(eng, &inst->slot[type], 0);
+		}
+	}
+	close_day(eng, inst, 0, 0);
+}
+
+/*
+ * trading_day - the trading day of the session starting at the origin, the
+ * first trading day after the calendar day of its evening.
+ */
+static uint32_t
+trading_day(bar_engine_t *eng, uint64_t origin)
+{
+	if (origin != eng->cache_origin) {
+		eng->cache_day = bar_calendar_next(&eng->cal, bar_calendar_day(origin));
+		eng->cache_origin = origin;
+	}
+
+	return eng->cache_day;
+}
+
+/*
+ * locate - find the segment of the session the tick falls in and cache it
+ * in the instrument, returns -1 if the tick is outside every segment.
+ */
+static int
+locate(bar_engine_t *eng, struct bar_inst *inst, uint64_t ts, uint32_t *td)
+{
+	const struct bar_session *s = inst->sess;
+	uint64_t origin, start = 0, end = 0, last;
+	int i;
+
+	/* 18:00 of the evening before the tick, in UTC */
+	origin = ts - (ts + CN_OFFSET_NS + EVENING_NS) % DAY_NS;
+
+	for (i = 0; i < s->nseg; i++) {
+		start = origin + (uint64_t)s->seg[i].start * NS;
+		end = origin + (uint64_t)s->seg[i].end * NS;
+		if (ts + eng->conf.pre_open_ns >= start && ts < end + eng->conf.grace_ns) {
+			break;
+		}
+	}
+	if (i == s->nseg) {
+		return -1;
+	}
+
+	*td = trading_day(eng, origin);
+
+	/* the day session of the trading day, which may be days after the night */
+	last = (uint64_t)s->seg[s->nseg - 1].end * NS;
+	inst->day_end = (uint64_t)days_from_civil(*td / 10000, (*td / 100) % 100, *td % 100) * DAY_NS
+			- CN_OFFSET_NS - EVENING_NS + last;
+
+	inst->seg_start = start;
+	inst->seg_end = end;
+	inst->seg_lo = start - eng->conf.pre_open_ns;
+	inst->seg_hi = end + eng->conf.grace_ns;
+
+	return 0;
+}
+
+static struct bar_inst *
+get_inst(bar_engine_t *eng, const tick_rec_t *t)
+{
+	struct bar_inst *inst = eng->insts[t->instrument];
+	const char *symbol;
+
+	if (inst != NULL) {
+		return inst;
+	}
+
+	/* made at create, unless there are more instruments than expected */
+	if ((inst = pool_get(&eng->inst_pool)) == NULL) {
+		return NULL;
+	}
+	memset(inst, 0, sizeof(*inst));
+
+	symbol = eng->conf.symbol != NULL ? eng->conf.symbol(t->instrument, eng->conf.arg)
+					  : tick_symbol(t->instrument);
+	inst->id = t->instrument;
+	inst->sess = bar_session_find(symbol);
+
+	eng->insts[t->instrument] = inst;
+	eng->active[eng->nactive++] = t->instrument;
+
+	return inst;
+}
+
+static void
+update_day(struct bar_inst *inst, const tick_rec_t *t)
+{
+	bar_rec_t *day = &inst->day;
+
+	if (day->ticks == 0) {
+		open_bar(day, inst, t, BAR_T_DAY, inst->seg_start, inst->day_end);
+	}
+
+	if (t->open > 0 && day->open == 0) {
+		day->open = day->high = day->low = t->open;
+	}
+	update_price(day, t->high);
+	update_price(day, t->low);
+	update_price(day, t->last);
+
+	day->volume = inst->cum_volume;
+	day->turnover = inst->cum_turnover;
+	day->open_interest = t->open_interest;
+	day->ticks++;
+}
+
+void
+bar_engine_tick(bar_engine_t *eng, const tick_rec_t *t)
+{
+	struct bar_inst *inst;
+	uint32_t types = eng->conf.types, td;
+	uint64_t ts = t->timestamp, eff;
+	int type;
+
+	if (t->instrument == 0 || t->instrument > TICK_INSTRUMENT_MAX ||
+	    (inst = get_inst(eng, t)) == NULL) {
+		return;
+	}
+	eng->stats.ticks++;
+
+	if (unlikely(ts < inst->seg_lo || ts >= inst->seg_hi)) {
+		if (locate(eng, inst, ts, &td) != 0) {
+			eng->stats.off_session++;
+			return;
+		}
+
+		if (td != inst->trading_day) {
+			if (td < inst->trading_day) {
+				/* straggler of a day already rolled */
+				inst->seg_lo = inst->seg_hi = 0;
+				eng->stats.late++;
+				return;
+			}
+
+			close_all(eng, inst);
+			for (type = 0; type < BAR_T_INTRADAY; type++) {
+				/* the exchange restarts the cumulative volume, unless we start mid-day */
+				inst->slot[type].base_volume = inst->trading_day ? 0 : t->volume;
+				inst->slot[type].base_turnover = inst->trading_day ? 0 : t->turnover;
+			}
+			inst->cum_volume = inst->cum_turnover = 0;
+			inst->trading_day = td;
+		}
+	}
+
+	if (t->volume > inst->cum_volume) {
+		inst->cum_volume = t->volume;
+		inst->cum_turnover = t->turnover;
+	}
+
+	/* pre-open and late ticks go to the first and last bar of the segment */
+	eff = ts < inst->seg_start ? inst->seg_start : ts >= inst->seg_end ? inst->seg_end - 1 : ts;
+
+	for (type = 0; type < BAR_T_INTRADAY; type++) {
+		struct bar_slot *slot = &inst->slot[type];
+		uint64_t start;
+
+		if (!(types & BAR_MASK(type))) {
+			continue;
+		}
+
+		if (unlikely(slot->bar.ticks == 0 || eff >= slot->bar.end)) {
+			if (eff < slot->last_end) {
+				/* its bar was emitted, the volume goes to the next one */
+				eng->stats.late++;
+				continue;
+			}
+			if (slot->bar.ticks != 0) {
+				close_slot(eng, slot, 0);
+			}
+
+			/* the clock is UTC+8 and every period divides the 8 hours */
+			start = eff - eff % periods[type];
+			open_bar(&slot->bar, inst, t, type,
+				 start < inst->seg_start ? inst->seg_start : start,
+				 start + periods[type] > inst->seg_end ? inst->seg_end : start + periods[type]);
+		}
+
+		update_price(&slot->bar, t->last);
+		slot->bar.volume = inst->cum_volume - slot->base_volume;
+		slot->bar.turnover = inst->cum_turnover - slot->base_turnover;
+		slot->bar.open_interest = t->open_interest;
+		slot->bar.ticks++;
+	}
+
+	if (types & ~(BAR_MASK(BAR_T_DAY) - 1)) {
+		if (inst->day.ticks == 0 && inst->closed_day == inst->trading_day) {
+			eng->stats.late++;
+		} else {
+			update_day(inst, t);
+		}
+	}
+}
+
+size_t
+bar_engine_poll(bar_engine_t *eng, ring_reader_t *rd, size_t max)
+{
+	tick_rec_t batch[POLL_BATCH];
+	size_t done = 0, n, i;
+	uint64_t t0;
+
+	while (done < max) {
+		n = ring_read(rd, batch, max - done < POLL_BATCH ? max - done : POLL_BATCH);
+		if (n == 0) {
+			break;
+		}
+		t0 = lat_now();
+		for (i = 0; i < n; i++) {
+			bar_engine_tick(eng, &batch[i]);
+		}
+		lat_consumed(batch, n, LAT_S_BAR, t0, lat_now());
+		done += n;
+	}
+
+	return done;
+}
+
+void
+bar_engine_advance(bar_engine_t *eng, uint64_t now)
+{
+	uint64_t grace = eng->conf.grace_ns;
+	uint32_t i;
+	int type;
+
+	for (i = 0; i < eng->nactive; i++) {
+		struct bar_inst *inst = eng->insts[eng->active[i]];
+
+		for (type = 0; type < BAR_T_INTRADAY; type++) {
+			struct bar_slot *slot = &inst->slot[type];
+
+			if (slot->bar.ticks != 0 && slot->bar.end + grace <= now) {
+				close_slot(eng, slot, 0);
+			}
+		}
+
+		if (inst->day.ticks != 0 && inst->day.end + grace <= now) {
+			close_day(eng, inst, 0, 0);
+		}
+	}
+}
+
+void
+bar_engine_flush(bar_engine_t *eng, uint64_t now)
+{
+	uint32_t i;
+	int type;
+
+	for (i = 0; i < eng->nactive; i++) {
+		struct bar_inst *inst = eng->insts[eng->active[i]];
+
+		for (type = 0; type < BAR_T_INTRADAY; type++) {
+			struct bar_slot *slot = &inst->slot[type];
+
+			if (slot->bar.ticks != 0) {
+				close_slot(eng, slot, slot->bar.end > now ? BAR_F_PARTIAL : 0);
+			}
+		}
+
+		close_day(eng, inst, inst->day.end > now ? BAR_F_PARTIAL : 0, 1);
+	}
+}
+
+ring_t *
+bar_engine_ring(bar_engine_t *eng)
+{
+	return eng->ring;
+}
+
+void
+bar_engine_stats(const bar_engine_t *eng, struct bar_stats *st)
+{
+	*st = eng->stats;
+	st->grows = eng->arena.stats.grows;
+}
+
+void
+bar_to_data(const bar_rec_t *bar, const char *symbol, bar_data_t *data)
+{
+	const struct tick_decoder *dec = bar->md_type < MD_T_MAX ? tick_decoders[bar->md_type] : NULL;
+
+	memset(data, 0, sizeof(*data));
+	data->timestamp = bar->end;
+	data->type = bar->type;
+	snprintf(data->symbol, sizeof(data->symbol), "%s", symbol != NULL ? symbol : "");
+	snprintf(data->exchange, sizeof(data->exchange), "%s", dec != NULL ? dec->name : "");
+	data->open = tick_px_double(bar->open);
+	data->high = tick_px_double(bar->high);
+	data->low = tick_px_double(bar->low);
+	data->close = tick_px_double(bar->close);
+	data->volume = (double)bar->volume;
+	data->open_interest = (double)bar->open_interest;
+	data->amount = tick_px_double(bar->turnover);
+}
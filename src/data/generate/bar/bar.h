@@ -1,8 +1,8 @@
 /*
  * bar.h
- * 
+ *
  * The header file contains the definition and declaration of the bar data.
- * 
+ *
  * Copyright(C) by Jupiter Fund 2025-
  */
 
@@ -13,6 +13,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "tick.h"
+#include "ring.h"
 
 enum bar_type {
 	BAR_T_MIN = 0,
@@ -27,6 +29,13 @@ enum bar_type {
 	BAR_T_MAX
 };
 
+extern const char *const bar_type_names[BAR_T_MAX];	/* "1min" ... "year" */
+int bar_type_parse(const char *name);
+
+#define BAR_T_INTRADAY	BAR_T_DAY	/* types before it are cut from the sessions */
+#define BAR_MASK(type)	(1U << (type))
+#define BAR_MASK_ALL	(BAR_MASK(BAR_T_MAX) - 1)
+
 typedef struct bar_data
 {
 	uint64_t timestamp;	/* timestamp of the bar data */
@@ -42,6 +51,147 @@ typedef struct bar_data
 	double volume;		/* volume */
 	double open_interest;	/* open interest */
 	double amount;		/* amount */
-}
+} bar_data_t;
+
+/* flags of bar_rec */
+#define BAR_F_PARTIAL	0x0001	/* flushed before the end of its period */
+
+/*
+ * bar_rec - a completed bar as the engine emits it, flat and fixed-point
+ * like tick_rec, so it goes through a ring or into a file as is.
+ */
+typedef struct bar_rec
+{
+	uint64_t start;		/* ns since epoch the period starts */
+	uint64_t end;		/* ns since epoch the period ends, exclusive */
+	uint32_t instrument;	/* interned id of the symbol */
+	uint32_t trading_day;	/* YYYYMMDD of the (last) trading day */
+	uint8_t type;		/* enum bar_type */
+	uint8_t md_type;	/* enum md_type of the ticks */
+	uint16_t flags;		/* BAR_F_* */
+	uint32_t ticks;		/* ticks aggregated */
+
+	int64_t open;		/* prices are fixed-point, TICK_PX_SCALE */
+	int64_t high;
+	int64_t low;
+	int64_t close;
+	int64_t volume;
+	int64_t turnover;	/* amount, fixed-point like the prices */
+	int64_t open_interest;
+
+	uint8_t reserved[40];
+} __attribute__((aligned(TICK_CACHELINE))) bar_rec_t;
+
+_Static_assert(sizeof(bar_rec_t) == 2 * TICK_CACHELINE, "bar_rec must be two cache lines");
+
+/*
+ * bar_calendar - the trading days of the exchanges, ascending YYYYMMDD. With
+ * no days loaded every weekday is a trading day.
+ */
+struct bar_calendar
+{
+	uint32_t *days;
+	size_t ndays;
+};
+
+int bar_calendar_load(struct bar_calendar *cal, const char *path);
+void bar_calendar_free(struct bar_calendar *cal);
+
+/*
+ * bar_calendar_next - the first trading day after the calendar day.
+ */
+uint32_t bar_calendar_next(const struct bar_calendar *cal, uint32_t day);
+
+/*
+ * bar_calendar_day - the calendar day in China Standard Time of ns since epoch.
+ */
+uint32_t bar_calendar_day(uint64_t ts);
+
+#define BAR_SEG_MAX	8
+
+/*
+ * bar_session - the trading segments of a product. A segment is in seconds
+ * from 18:00 of the evening the trading day starts, so the night session
+ * across midnight and the day session are ascending without a wrap.
+ */
+struct bar_session
+{
+	char product[8];	/* leading letters of the symbols, "" for the default */
+	int nseg;
+	struct {
+		int32_t start;
+		int32_t end;
+	} seg[BAR_SEG_MAX];
+};
+
+/*
+ * bar_session_load - replace the sessions by those of the file, one product
+ * per line: "rb 21:00-23:00 09:00-10:15 10:30-11:30 13:30-15:00".
+ */
+int bar_session_load(const char *path);
+const struct bar_session *bar_session_find(const char *symbol);
+
+typedef void (*bar_cb_t)(const bar_rec_t *bar, void *arg);
+
+struct bar_conf
+{
+	uint32_t types;		/* BAR_MASK() of the types to build */
+	uint64_t ring_capacity;	/* completed bars retained in the bar ring, 0 for none */
+	uint64_t pre_open_ns;	/* ticks this early go to the first bar of a segment */
+	uint64_t grace_ns;	/* ticks this late go to the last bar of a segment */
+	const char *calendar;	/* file of the trading days, NULL for weekdays */
+	const char *sessions;	/* file of the sessions, NULL for the built-in table */
+	bar_cb_t on_bar;	/* called for every completed bar, may be NULL */
+	void *arg;
+	uint32_t instruments;	/* expected, their state is made at create, 0 for ARENA_INSTRUMENTS */
+
+	/* symbol of an instrument id, NULL for tick_symbol(); bus readers give bus_symbol() */
+	const char *(*symbol)(uint32_t id, void *arg);
+};
+
+struct bar_stats
+{
+	uint64_t ticks;		/* ticks consumed */
+	uint64_t bars;		/* bars emitted */
+	uint64_t late;		/* ticks older than the bar of their type */
+	uint64_t off_session;	/* ticks outside every segment */
+	uint64_t grows;		/* memory added for instruments beyond the expected */
+};
+
+typedef struct bar_engine bar_engine_t;
+
+bar_engine_t *bar_engine_create(const struct bar_conf *conf);
+void bar_engine_destroy(bar_engine_t *eng);
+
+/*
+ * bar_engine_tick - fold one tick into the open bars of its instrument,
+ * emitting the bars it completes.
+ */
+void bar_engine_tick(bar_engine_t *eng, const tick_rec_t *tick);
+
+/*
+ * bar_engine_poll - consume up to max ticks of the reader, returns the
+ * number consumed.
+ */
+size_t bar_engine_poll(bar_engine_t *eng, ring_reader_t *rd, size_t max);
+
+/*
+ * bar_engine_advance - emit the bars whose period ended before now, for
+ * instruments no tick closes them; call it every second or so.
+ */
+void bar_engine_advance(bar_engine_t *eng, uint64_t now);
+
+/*
+ * bar_engine_flush - emit every open bar, those not ended as BAR_F_PARTIAL.
+ */
+void bar_engine_flush(bar_engine_t *eng, uint64_t now);
+
+ring_t *bar_engine_ring(bar_engine_t *eng);
+void bar_engine_stats(const bar_engine_t *eng, struct bar_stats *st);
+
+/*
+ * bar_to_data - the bar of the symbol as bar_data for the existing consumers.
+ */
+void bar_to_data(const bar_rec_t *bar, const char *symbol, bar_data_t *data);
 
 #endif		/* _BAR_H_ */
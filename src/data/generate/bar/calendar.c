@@ -0,0 +1,255 @@
+/*
+ * calendar.c
+ *
+ * The functions are used to load the trading calendar and the trading
+ * sessions of the products, which cut the bars of the bar engine.
+ *
+ * Copyright(C) by Jupiter Fund 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "bar.h"
+#include "parse.h"
+
+#define SESSION_MAX	256
+
+/* seconds from 18:00 of a clock time */
+#define S(h, m)		((((h) * 3600 + (m) * 60) + 6 * 3600) % 86400)
+
+#define DAY_SESSION	{ S(9, 0), S(10, 15) }, { S(10, 30), S(11, 30) }, { S(13, 30), S(15, 0) }
+
+/*
+ * The night session of the products without an entry is 21:00-23:00; a
+ * product without a night session never has ticks in it, so the default
+ * covers those as well.
+ */
+static const struct bar_session builtin[] = {
+	{ "",   4, { { S(21, 0), S(23, 0) }, DAY_SESSION } },
+	{ "au", 4, { { S(21, 0), S(2, 30) }, DAY_SESSION } },
+	{ "ag", 4, { { S(21, 0), S(2, 30) }, DAY_SESSION } },
+	{ "sc", 4, { { S(21, 0), S(2, 30) }, DAY_SESSION } },
+	{ "cu", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "bc", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "al", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "ao", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "zn", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "pb", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "ni", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "sn", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "ss", 4, { { S(21, 0), S(1, 0) }, DAY_SESSION } },
+	{ "IF", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 0) } } },
+	{ "IH", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 0) } } },
+	{ "IC", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 0) } } },
+	{ "IM", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 0) } } },
+	{ "T",  2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 15) } } },
+	{ "TF", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 15) } } },
+	{ "TS", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 15) } } },
+	{ "TL", 2, { { S(9, 30), S(11, 30) }, { S(13, 0), S(15, 15) } } },
+};
+
+static const struct bar_session *sessions = builtin;
+static size_t nsessions = sizeof(builtin) / sizeof(builtin[0]);
+static struct bar_session loaded[SESSION_MAX];
+
+static int
+cmp_day(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int
+bar_calendar_load(struct bar_calendar *cal, const char *path)
+{
+	char line[64];
+	size_t cap = 0;
+	uint32_t *days;
+	FILE *fp;
+
+	cal->days = NULL;
+	cal->ndays = 0;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open calendar %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *p = line;
+
+		while (isspace((unsigned char)*p)) {
+			p++;
+		}
+		if (!is_8digits(p)) {
+			/* comments, blank lines and headers */
+			continue;
+		}
+
+		if (cal->ndays == cap) {
+			cap = cap ? cap * 2 : 4096;
+			if ((days = realloc(cal->days, cap * sizeof(*days))) == NULL) {
+				fclose(fp);
+				bar_calendar_free(cal);
+				return -1;
+			}
+			cal->days = days;
+		}
+		cal->days[cal->ndays++] = parse_8digits(p);
+	}
+	fclose(fp);
+
+	qsort(cal->days, cal->ndays, sizeof(*cal->days), cmp_day);
+
+	return 0;
+}
+
+void
+bar_calendar_free(struct bar_calendar *cal)
+{
+	free(cal->days);
+	cal->days = NULL;
+	cal->ndays = 0;
+}
+
+uint32_t
+bar_calendar_day(uint64_t ts)
+{
+	return civil_from_days((int64_t)((ts + 8 * 3600 * 1000000000ULL) / (86400 * 1000000000ULL)));
+}
+
+static int64_t
+day_number(uint32_t day)
+{
+	return days_from_civil(day / 10000, (day / 100) % 100, day % 100);
+}
+
+uint32_t
+bar_calendar_next(const struct bar_calendar *cal, uint32_t day)
+{
+	size_t lo = 0, hi;
+	int64_t n;
+
+	if (cal == NULL || cal->ndays == 0 || day >= cal->days[cal->ndays - 1]) {
+		/* weekdays, also past the end of the loaded calendar */
+		n = day_number(day) + 1;
+		/* 1970-01-01 is a Thursday: (n + 3) % 7 is 5 on Saturday, 6 on Sunday */
+		while ((n + 3) % 7 >= 5) {
+			n++;
+		}
+		return civil_from_days(n);
+	}
+
+	hi = cal->ndays;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (cal->days[mid] <= day) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return cal->days[lo];
+}
+
+/*
+ * parse_hhmm - seconds from 18:00 of "HH:MM", -1 if malformed.
+ */
+static int32_t
+parse_hhmm(const char *p)
+{
+	int h, m;
+
+	if (!isdigit((unsigned char)p[0]) || !isdigit((unsigned char)p[1]) || p[2] != ':' ||
+	    !isdigit((unsigned char)p[3]) || !isdigit((unsigned char)p[4])) {
+		return -1;
+	}
+
+	h = (p[0] - '0') * 10 + p[1] - '0';
+	m = (p[3] - '0') * 10 + p[4] - '0';
+	if (h > 24 || m > 59) {
+		return -1;
+	}
+
+	return S(h, m);
+}
+
+int
+bar_session_load(const char *path)
+{
+	struct bar_session *s;
+	char line[256];
+	size_t n = 0;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open sessions %s\n", path);
+		return -1;
+	}
+
+	/* the default is kept first, a "*" line of the file replaces it */
+	loaded[n++] = builtin[0];
+
+	while (fgets(line, sizeof(line), fp) != NULL && n < SESSION_MAX) {
+		char *save = NULL, *tok;
+
+		if ((tok = strtok_r(line, " \t\r\n", &save)) == NULL || tok[0] == '#') {
+			continue;
+		}
+
+		s = strcmp(tok, "*") == 0 ? &loaded[0] : &loaded[n];
+		memset(s, 0, sizeof(*s));
+		if (s != &loaded[0]) {
+			snprintf(s->product, sizeof(s->product), "%s", tok);
+		}
+
+		while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL && s->nseg < BAR_SEG_MAX) {
+			int32_t start = parse_hhmm(tok), end = tok[5] == '-' ? parse_hhmm(tok + 6) : -1;
+
+			if (start < 0 || end <= start || (s->nseg > 0 && start < s->seg[s->nseg - 1].end)) {
+				fprintf(stderr, "bad session %s of %s\n", tok, s->product);
+				fclose(fp);
+				return -1;
+			}
+			s->seg[s->nseg].start = start;
+			s->seg[s->nseg].end = end;
+			s->nseg++;
+		}
+
+		if (s != &loaded[0] && s->nseg > 0) {
+			n++;
+		}
+	}
+	fclose(fp);
+
+	sessions = loaded;
+	nsessions = n;
+
+	return 0;
+}
+
+const struct bar_session *
+bar_session_find(const char *symbol)
+{
+	char product[sizeof(builtin[0].product)];
+	size_t n = 0, i;
+
+	while (symbol != NULL && isalpha((unsigned char)symbol[n]) && n < sizeof(product) - 1) {
+		product[n] = symbol[n];
+		n++;
+	}
+	product[n] = '\0';
+
+	for (i = 1; i < nsessions; i++) {
+		if (strcmp(sessions[i].product, product) == 0) {
+			return &sessions[i];
+		}
+	}
+
+	return &sessions[0];
+}
@@ -0,0 +1,207 @@
+/*
+ * gen_bar.c
+ *
+ * The program reads the ticks of a tick bus and writes the bars of the
+ * chosen types as CSV while the market trades.
+ *
+ *	gen_bar -b shfe -T 1min,5min,day -C calendar.txt >> bars.csv
+ *
+ * Copyright(C) by Jupiter Fund 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "bar.h"
+#include "arena.h"
+#include "bus.h"
+#include "lat.h"
+
+#define POLL_MAX	4096
+#define ADVANCE_NS	1000000000ULL
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+wall_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t
+parse_types(char *s)
+{
+	char *save = NULL, *tok;
+	uint32_t mask = 0;
+	int type;
+
+	for (tok = strtok_r(s, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+		if ((type = bar_type_parse(tok)) < 0) {
+			fprintf(stderr, "unknown bar type %s\n", tok);
+			return 0;
+		}
+		mask |= BAR_MASK(type);
+	}
+
+	return mask;
+}
+
+static const char *
+symbol_of(uint32_t id, void *arg)
+{
+	return bus_symbol((const tick_bus_t *)arg, id);
+}
+
+static void
+print_bar(const bar_rec_t *bar, void *arg)
+{
+	tick_bus_t *bus = arg;
+	const char *symbol = bus_symbol(bus, bar->instrument);
+
+	printf("%s,%s,%u,%lu,%lu,%.4f,%.4f,%.4f,%.4f,%ld,%.4f,%ld,%d\n",
+	       symbol != NULL ? symbol : "", bar_type_names[bar->type], bar->trading_day,
+	       bar->start, bar->end, tick_px_double(bar->open), tick_px_double(bar->high),
+	       tick_px_double(bar->low), tick_px_double(bar->close), bar->volume,
+	       tick_px_double(bar->turnover), bar->open_interest, bar->flags & BAR_F_PARTIAL ? 1 : 0);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -b bus [-T types] [-C calendar] [-S sessions] [-N count] [-w wait] [-r]\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -T types     bar types, e.g. 1min,5min,15min,30min,hour,day,week,month,year\n"
+		"  -C calendar  file of the trading days, one YYYYMMDD per line\n"
+		"  -S sessions  file of the trading sessions of the products\n"
+		"  -N count     instruments to make room for at startup, the symbols of the bus by default\n"
+		"  -w wait      for the ticks: spin, yield, futex or sleep (default sleep)\n"
+		"  -r           replay the ticks retained by the bus first\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bar_conf conf;
+	struct bar_stats st;
+	ring_reader_t rd;
+	bar_engine_t *eng;
+	tick_bus_t bus;
+	lat_page_t lat;
+	const char *bus_name = NULL;
+	uint64_t now, last = 0;
+	int replay = 0, wait = BUS_WAIT_SLEEP, opt;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.types = BAR_MASK_ALL;
+
+	while ((opt = getopt(argc, argv, "b:T:C:S:N:w:r")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'T':
+			if ((conf.types = parse_types(optarg)) == 0) {
+				return 1;
+			}
+			break;
+		case 'C':
+			conf.calendar = optarg;
+			break;
+		case 'S':
+			conf.sessions = optarg;
+			break;
+		case 'N':
+			conf.instruments = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			replay = 1;
+			break;
+		case 'w':
+			if ((wait = bus_wait_parse(optarg)) < BUS_WAIT_SLEEP) {
+				fprintf(stderr, "unknown wait %s\n", optarg);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (bus_name == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (bus_open(&bus, bus_name, wait == RING_WAIT_FUTEX ? BUS_O_RDWR : 0) != 0) {
+		fprintf(stderr, "cannot open tick bus %s\n", bus_name);
+		return 1;
+	}
+
+	/* the symbols the receiver has seen so far, a day of them when it restarts */
+	if (conf.instruments == 0) {
+		conf.instruments = atomic_load(&bus.hdr->nsymbols);
+		conf.instruments = conf.instruments > ARENA_INSTRUMENTS ? conf.instruments : ARENA_INSTRUMENTS;
+	}
+
+	conf.on_bar = print_bar;
+	conf.symbol = symbol_of;
+	conf.arg = &bus;
+	if ((eng = bar_engine_create(&conf)) == NULL ||
+	    bus_reader(&bus, &rd, replay ? BUS_R_REPLAY : 0) != 0) {
+		bar_engine_destroy(eng);
+		bus_close(&bus);
+		return 1;
+	}
+
+	/* the latencies of the bar engine go with those of the receiver */
+	memset(&lat, 0, sizeof(lat));
+	if (lat_open(&lat, bus_name) == 0) {
+		lat_attach(&lat, "gen_bar");
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	printf("symbol,type,trading_day,start,end,open,high,low,close,volume,amount,open_interest,partial\n");
+	while (running) {
+		if (bar_engine_poll(eng, &rd, POLL_MAX) == 0) {
+			bus_idle(&rd, wait);
+		}
+
+		now = wall_ns();
+		if (now - last >= ADVANCE_NS) {
+			bar_engine_advance(eng, now);
+			fflush(stdout);
+			last = now;
+		}
+	}
+
+	bar_engine_flush(eng, wall_ns());
+	bar_engine_stats(eng, &st);
+	fprintf(stderr, "ticks %lu bars %lu late %lu off_session %lu grows %lu\n",
+		st.ticks, st.bars, st.late, st.off_session, st.grows);
+
+	ring_reader_fini(&rd);
+	lat_close(&lat);
+	bar_engine_destroy(eng);
+	bus_close(&bus);
+
+	return 0;
+}
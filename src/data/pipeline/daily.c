@@ -0,0 +1,455 @@
+/*
+ * daily.c
+ *
+ * The functions are used to load the file of the nightly update, and to
+ * read and write the state of an exchange with the watermarks of its stages
+ * and the raw files it has normalized.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "daily.h"
+
+#define LINE_MAX_LEN	4096
+#define FNV_OFFSET	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+
+const char *const daily_stage_names[DAILY_NSTAGE] = {
+	[DAILY_CRAWL] = "crawl",
+	[DAILY_NORM] = "norm",
+	[DAILY_ROLL] = "roll",
+	[DAILY_INDEX] = "index",
+};
+
+const char *const daily_programs[DAILY_NSTAGE] = {
+	[DAILY_CRAWL] = "crawl_daily",
+	[DAILY_NORM] = "norm_daily",
+	[DAILY_ROLL] = "select_major",
+	[DAILY_INDEX] = "build_index",
+};
+
+uint64_t
+daily_hash(const void *data, size_t len, uint64_t h)
+{
+	const uint8_t *p = data;
+	size_t i;
+
+	if (h == 0) {
+		h = FNV_OFFSET;
+	}
+	for (i = 0; i < len; i++) {
+		h = (h ^ p[i]) * FNV_PRIME;
+	}
+
+	return h;
+}
+
+int
+daily_hash_file(const char *path, uint64_t *hash)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	*hash = 0;
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		*hash = daily_hash(NULL, 0, 0);
+		return 0;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "cannot map %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	*hash = daily_hash(p, (size_t)st.st_size, 0);
+	munmap(p, (size_t)st.st_size);
+
+	return 0;
+}
+
+int
+daily_expand(char *dst, size_t len, const char *tmpl, int32_t day)
+{
+	size_t off = 0;
+	int n;
+
+	for (; *tmpl != '\0'; tmpl++) {
+		if (*tmpl != '%' || tmpl[1] == '\0') {
+			n = snprintf(dst + off, len - off, "%c", *tmpl);
+		} else {
+			switch (*++tmpl) {
+			case 'Y':
+				n = snprintf(dst + off, len - off, "%04d", day / 10000);
+				break;
+			case 'm':
+				n = snprintf(dst + off, len - off, "%02d", day / 100 % 100);
+				break;
+			case 'd':
+				n = snprintf(dst + off, len - off, "%02d", day % 100);
+				break;
+			default:
+				n = snprintf(dst + off, len - off, "%c", *tmpl);
+				break;
+			}
+		}
+		if (n < 0 || (size_t)n >= len - off) {
+			return -1;
+		}
+		off += (size_t)n;
+	}
+	if (off == 0 && len > 0) {
+		dst[0] = '\0';
+	}
+
+	return 0;
+}
+
+int32_t
+daily_file_day(const char *name)
+{
+	const char *p;
+	int32_t day;
+	int i, m, d;
+
+	for (p = name; *p != '\0'; p++) {
+		for (i = 0, day = 0; i < 8 && p[i] >= '0' && p[i] <= '9'; i++) {
+			day = day * 10 + (p[i] - '0');
+		}
+		m = day / 100 % 100;
+		d = day % 100;
+		if (i == 8 && (p[8] < '0' || p[8] > '9') && day / 10000 >= 1990 && m >= 1 && m <= 12 &&
+		    d >= 1 && d <= 31) {
+			return day;
+		}
+		p += i > 0 ? i - 1 : 0;
+	}
+
+	return 0;
+}
+
+/* key=value of an exchange, the value split in place */
+static int
+exchange_key(struct daily_exchange *ex, char *tok)
+{
+	char *val = strchr(tok, '='), *save = NULL, *a;
+
+	if (val == NULL) {
+		return -1;
+	}
+	*val++ = '\0';
+
+	if (strcmp(tok, "url") == 0) {
+		ex->url = val;
+	} else if (strcmp(tok, "file") == 0) {
+		ex->file = val;
+	} else if (strcmp(tok, "major") == 0) {
+		ex->major = val;
+	} else if (strcmp(tok, "index") == 0) {
+		ex->index = val;
+	} else if (strcmp(tok, "threads") == 0) {
+		return (ex->threads = atoi(val)) > 0 ? 0 : -1;
+	} else if (strcmp(tok, "roll") == 0) {
+		/* the options of select_major, comma separated: roll=-s,time,-d,15 */
+		for (a = strtok_r(val, ",", &save); a != NULL; a = strtok_r(NULL, ",", &save)) {
+			if (ex->nroll == DAILY_ARGS_MAX) {
+				return -1;
+			}
+			ex->roll[ex->nroll++] = a;
+		}
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+add_exchange(struct daily_conf *dc, const char *line, int lineno)
+{
+	struct daily_exchange *ex, *v;
+	char *save = NULL, *tok, name[NAME_MAX + 1];
+	size_t i;
+
+	if ((v = realloc(dc->exchanges, (dc->nexchanges + 1) * sizeof(*v))) == NULL) {
+		return -1;
+	}
+	dc->exchanges = v;
+	ex = &dc->exchanges[dc->nexchanges];
+	memset(ex, 0, sizeof(*ex));
+	ex->line = lineno;
+	ex->file = "%Y%m%d";
+	if ((ex->text = strdup(line)) == NULL) {
+		return -1;
+	}
+	dc->nexchanges++;
+
+	strtok_r(ex->text, " \t\r\n", &save);
+	if ((tok = strtok_r(NULL, " \t\r\n", &save)) == NULL || strlen(tok) >= sizeof(ex->name)) {
+		fprintf(stderr, "line %d: exchange needs a name\n", lineno);
+		return -1;
+	}
+	snprintf(ex->name, sizeof(ex->name), "%s", tok);
+
+	while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+		if (exchange_key(ex, tok) != 0) {
+			fprintf(stderr, "line %d: bad %s of %s\n", lineno, tok, ex->name);
+			return -1;
+		}
+	}
+	/* the day must come back out of the name */
+	if (daily_expand(name, sizeof(name), ex->file, 20250303) != 0 || daily_file_day(name) != 20250303) {
+		fprintf(stderr, "line %d: the file of %s has no day\n", lineno, ex->name);
+		return -1;
+	}
+	for (i = 0; i + 1 < dc->nexchanges; i++) {
+		if (strcmp(dc->exchanges[i].name, ex->name) == 0) {
+			fprintf(stderr, "line %d: %s is on line %d already\n", lineno, ex->name,
+				dc->exchanges[i].line);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+daily_load(struct daily_conf *dc, const char *path)
+{
+	char line[LINE_MAX_LEN], copy[LINE_MAX_LEN], *save, *key, *val, *dst;
+	int lineno = 0, rc = 0;
+	FILE *fp;
+
+	memset(dc, 0, sizeof(*dc));
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	while (rc == 0 && fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		line[strcspn(line, "#")] = '\0';
+		snprintf(copy, sizeof(copy), "%s", line);
+		save = NULL;
+		if ((key = strtok_r(copy, " \t\r\n", &save)) == NULL) {
+			continue;
+		}
+		val = strtok_r(NULL, " \t\r\n", &save);
+
+		dst = strcmp(key, "bin") == 0 ? dc->bin : strcmp(key, "log") == 0 ? dc->log :
+		      strcmp(key, "store") == 0 ? dc->store : strcmp(key, "raw") == 0 ? dc->raw :
+		      strcmp(key, "state") == 0 ? dc->state : strcmp(key, "calendar") == 0 ? dc->calendar :
+		      strcmp(key, "master") == 0 ? dc->master : NULL;
+		if (dst != NULL && val != NULL) {
+			snprintf(dst, PATH_MAX, "%s", val);
+		} else if (strcmp(key, "start") == 0 && val != NULL) {
+			if ((dc->start = daily_file_day(val)) == 0) {
+				fprintf(stderr, "line %d: bad day %s\n", lineno, val);
+				rc = -1;
+			}
+		} else if (strcmp(key, "exchange") == 0) {
+			rc = add_exchange(dc, line, lineno);
+		} else {
+			fprintf(stderr, "line %d: unknown %s\n", lineno, key);
+			rc = -1;
+		}
+	}
+	fclose(fp);
+
+	if (rc == 0 && (dc->store[0] == '\0' || dc->raw[0] == '\0' || dc->state[0] == '\0')) {
+		fprintf(stderr, "%s needs store, raw and state\n", path);
+		rc = -1;
+	}
+	if (rc != 0) {
+		daily_free(dc);
+	}
+
+	return rc;
+}
+
+void
+daily_free(struct daily_conf *dc)
+{
+	size_t i;
+
+	for (i = 0; i < dc->nexchanges; i++) {
+		free(dc->exchanges[i].text);
+	}
+	free(dc->exchanges);
+	memset(dc, 0, sizeof(*dc));
+}
+
+size_t
+daily_select(struct daily_conf *dc, const char *exchanges)
+{
+	size_t i, n = 0, len;
+	const char *p;
+
+	for (i = 0; i < dc->nexchanges; i++) {
+		struct daily_exchange *ex = &dc->exchanges[i];
+
+		ex->mine = exchanges == NULL;
+		len = strlen(ex->name);
+		for (p = exchanges; p != NULL && !ex->mine; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+			ex->mine = strncmp(p, ex->name, len) == 0 && (p[len] == ',' || p[len] == '\0');
+		}
+		n += (size_t)ex->mine;
+	}
+
+	return n;
+}
+
+int
+daily_state_load(struct daily_state *s, const char *path, const char *exchange)
+{
+	FILE *fp;
+	int ok;
+
+	memset(s, 0, sizeof(*s));
+	s->hdr.magic = DAILY_MAGIC;
+	s->hdr.version = DAILY_VERSION;
+	s->hdr.nstages = DAILY_NSTAGE;
+	snprintf(s->hdr.exchange, sizeof(s->hdr.exchange), "%s", exchange);
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		return errno == ENOENT ? 0 : -1;
+	}
+
+	ok = fread(&s->hdr, sizeof(s->hdr), 1, fp) == 1 && s->hdr.magic == DAILY_MAGIC &&
+	     s->hdr.version == DAILY_VERSION && s->hdr.nstages == DAILY_NSTAGE &&
+	     strncmp(s->hdr.exchange, exchange, sizeof(s->hdr.exchange)) == 0 &&
+	     fread(s->marks, sizeof(s->marks), 1, fp) == 1;
+	if (ok && s->hdr.nfiles > 0) {
+		s->cap = s->hdr.nfiles;
+		ok = (s->files = malloc(s->cap * sizeof(*s->files))) != NULL &&
+		     fread(s->files, sizeof(*s->files), s->hdr.nfiles, fp) == s->hdr.nfiles;
+	}
+	fclose(fp);
+
+	if (!ok) {
+		fprintf(stderr, "%s is not the state of %s\n", path, exchange);
+		daily_state_free(s);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+daily_state_save(const struct daily_state *s, const char *path)
+{
+	char tmp[PATH_MAX + 8];
+	FILE *fp;
+	int ok;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+
+	ok = fwrite(&s->hdr, sizeof(s->hdr), 1, fp) == 1 &&
+	     fwrite(s->marks, sizeof(s->marks), 1, fp) == 1 &&
+	     fwrite(s->files, sizeof(*s->files), s->hdr.nfiles, fp) == s->hdr.nfiles;
+	ok = fflush(fp) == 0 && ok && fsync(fileno(fp)) == 0;
+	if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+		fprintf(stderr, "cannot write %s\n", path);
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+daily_state_free(struct daily_state *s)
+{
+	free(s->files);
+	s->files = NULL;
+	s->cap = 0;
+	s->hdr.nfiles = 0;
+}
+
+/* the first file whose name is not below the hash */
+static size_t
+lower_bound(const struct daily_state *s, uint64_t name)
+{
+	size_t lo = 0, hi = s->hdr.nfiles;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (s->files[mid].name < name) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+struct daily_file *
+daily_state_find(struct daily_state *s, uint64_t name)
+{
+	size_t i = lower_bound(s, name);
+
+	return i < s->hdr.nfiles && s->files[i].name == name ? &s->files[i] : NULL;
+}
+
+int
+daily_state_put(struct daily_state *s, const struct daily_file *f)
+{
+	size_t i = lower_bound(s, f->name);
+	struct daily_file *v;
+
+	if (i < s->hdr.nfiles && s->files[i].name == f->name) {
+		s->files[i] = *f;
+		return 0;
+	}
+
+	if (s->hdr.nfiles == s->cap) {
+		s->cap = s->cap ? s->cap * 2 : 1024;
+		if ((v = realloc(s->files, s->cap * sizeof(*v))) == NULL) {
+			return -1;
+		}
+		s->files = v;
+	}
+	memmove(&s->files[i + 1], &s->files[i], (s->hdr.nfiles - i) * sizeof(*s->files));
+	s->files[i] = *f;
+	s->hdr.nfiles++;
+
+	return 0;
+}
+
+uint64_t
+daily_digest(const struct daily_state *s)
+{
+	uint64_t h = 0;
+	uint32_t i;
+
+	for (i = 0; i < s->hdr.nfiles; i++) {
+		h = daily_hash(&s->files[i].name, sizeof(s->files[i].name), h);
+		h = daily_hash(&s->files[i].hash, sizeof(s->files[i].hash), h);
+	}
+
+	return h;
+}
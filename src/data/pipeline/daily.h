@@ -0,0 +1,196 @@
+/*
+ * daily.h
+ *
+ * The file contains the definition of the nightly update of the daily bars,
+ * as the file of run_daily describes it, the state it keeps between the runs
+ * and the functions' prototype.
+ *
+ * The update of an exchange is four stages, each a program of the tree run
+ * on what is new since the last run:
+ *
+ *	crawl   crawl_daily -m, the trading days after the last one fetched
+ *	norm    norm_daily -a, the raw files new or changed since normalized
+ *	roll    select_major, the days after its state, of the store
+ *	index   build_index, the days after its files, of the store
+ *
+ * roll and index depend on norm only, norm on crawl. Every stage keeps a
+ * watermark: the last trading day it is done to, the hash of its inputs and
+ * the run of norm it has seen. A raw file is known by its size and mtime,
+ * its content hashed only when either moved; a file of a day norm is past
+ * already, or one whose content changed, rewrites history, so roll and
+ * index are run over the whole store of the exchange once instead of
+ * appending. The state of an exchange is one file:
+ *
+ *	header   struct daily_hdr
+ *	marks    struct daily_mark [DAILY_NSTAGE]
+ *	files    struct daily_file [nfiles], by name
+ *
+ * written to a temporary file and renamed over it after every stage, so a
+ * run stopped halfway goes on from the stage it stopped in.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __DAILY_H__
+#define __DAILY_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define DAILY_MAGIC		0x4450554aU	/* "JUPD" */
+#define DAILY_VERSION		1
+#define DAILY_NAME_LEN		16
+#define DAILY_ARGS_MAX		32	/* options of select_major of an exchange */
+
+enum daily_stage {
+	DAILY_CRAWL = 0,
+	DAILY_NORM,
+	DAILY_ROLL,
+	DAILY_INDEX,
+	DAILY_NSTAGE
+};
+
+extern const char *const daily_stage_names[DAILY_NSTAGE];
+extern const char *const daily_programs[DAILY_NSTAGE];
+
+struct daily_exchange
+{
+	char name[DAILY_NAME_LEN];
+	int line;			/* of the file */
+	char *text;			/* the line, the strings below point into it */
+	const char *url;		/* %Y %m %d of the day, NULL for no crawl */
+	const char *file;		/* name of the raw file of a day */
+	const char *major;		/* directory of select_major, NULL for no roll */
+	const char *index;		/* directory of build_index, NULL for no index */
+	int threads;			/* of norm_daily, 0 for its default */
+	char *roll[DAILY_ARGS_MAX];	/* options of select_major */
+	int nroll;
+	int mine;			/* updated in this run */
+};
+
+struct daily_conf
+{
+	char bin[PATH_MAX];		/* directory of the programs, PATH when empty */
+	char log[PATH_MAX];		/* directory of the logs, stderr when empty */
+	char store[PATH_MAX];
+	char raw[PATH_MAX];		/* <raw>/<exchange>/ the raw files */
+	char state[PATH_MAX];		/* <state>/<exchange>.upd */
+	char calendar[PATH_MAX];	/* trading days, every weekday when empty */
+	char master[PATH_MAX];		/* instrument master of norm_daily, none when empty */
+	int32_t start;			/* first day of an exchange with no state */
+	struct daily_exchange *exchanges;
+	size_t nexchanges;
+};
+
+struct daily_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nstages;
+	uint32_t nfiles;
+	uint32_t gen;			/* runs of norm */
+	uint32_t reserved0;
+	char exchange[DAILY_NAME_LEN];
+	uint8_t reserved[24];
+};
+
+_Static_assert(sizeof(struct daily_hdr) == 64, "daily_hdr is part of the file format");
+
+/*
+ * daily_mark - the watermark of a stage.
+ */
+struct daily_mark
+{
+	int32_t last_day;		/* the last trading day done, 0 for none */
+	uint32_t gen;			/* the run of norm it is done to */
+	uint64_t input;			/* hash of what it was run on */
+	int64_t done_at;		/* ns since epoch */
+	int64_t started_at;		/* of a run not finished, 0 for none */
+};
+
+_Static_assert(sizeof(struct daily_mark) == 32, "daily_mark is part of the file format");
+
+/*
+ * daily_file - a raw file normalized.
+ */
+struct daily_file
+{
+	uint64_t name;			/* hash of the file name */
+	int32_t day;			/* trading day of its bars */
+	uint32_t gen;			/* the run of norm it was normalized in */
+	int64_t mtime;			/* ns since epoch */
+	uint64_t size;
+	uint64_t hash;			/* of the content */
+	uint64_t reserved;
+};
+
+_Static_assert(sizeof(struct daily_file) == 48, "daily_file is part of the file format");
+
+struct daily_state
+{
+	struct daily_hdr hdr;
+	struct daily_mark marks[DAILY_NSTAGE];
+	struct daily_file *files;
+	size_t cap;
+};
+
+/*
+ * daily_load - read the file; daily_free() frees what it made.
+ */
+int daily_load(struct daily_conf *dc, const char *path);
+void daily_free(struct daily_conf *dc);
+
+/*
+ * daily_select - mark the exchanges of the comma separated list, all of
+ * them for NULL. Returns how many.
+ */
+size_t daily_select(struct daily_conf *dc, const char *exchanges);
+
+/*
+ * daily_state_load - the state of the exchange, empty if it has none yet;
+ * returns -1 if the file is not a state.
+ */
+int daily_state_load(struct daily_state *s, const char *path, const char *exchange);
+int daily_state_save(const struct daily_state *s, const char *path);
+void daily_state_free(struct daily_state *s);
+
+/*
+ * daily_state_find - the file of the name hash, NULL if not normalized yet.
+ */
+struct daily_file *daily_state_find(struct daily_state *s, uint64_t name);
+
+/*
+ * daily_state_put - add or replace the file, kept by name.
+ */
+int daily_state_put(struct daily_state *s, const struct daily_file *f);
+
+/*
+ * daily_digest - the hash of all the files, what roll and index are run on.
+ */
+uint64_t daily_digest(const struct daily_state *s);
+
+/*
+ * daily_hash - FNV-1a of the bytes, from h, 0 for the start.
+ */
+uint64_t daily_hash(const void *data, size_t len, uint64_t h);
+
+/*
+ * daily_hash_file - the hash of the content of the file, 0 and -1 if it
+ * cannot be read.
+ */
+int daily_hash_file(const char *path, uint64_t *hash);
+
+/*
+ * daily_expand - the template with %Y, %m and %d of the day and %% for %.
+ * Returns -1 if it does not fit.
+ */
+int daily_expand(char *dst, size_t len, const char *tmpl, int32_t day);
+
+/*
+ * daily_file_day - the first YYYYMMDD in the name, 0 if none.
+ */
+int32_t daily_file_day(const char *name);
+
+#endif		/* __DAILY_H__ */
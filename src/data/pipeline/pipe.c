@@ -0,0 +1,534 @@
+/*
+ * pipe.c
+ *
+ * The functions are used to load the file of the tick pipeline, to choose
+ * the stages of a box and check where they run, and to make their command
+ * lines.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipe.h"
+
+#define LINE_MAX_LEN	4096
+
+const char *const pipe_kind_names[PIPE_KIND_MAX] = {
+	[PIPE_RECV] = "recv",
+	[PIPE_BAR] = "bar",
+	[PIPE_RECORD] = "record",
+	[PIPE_REDIS] = "redis",
+	[PIPE_MATCH] = "match",
+};
+
+const char *const pipe_programs[PIPE_KIND_MAX] = {
+	[PIPE_RECV] = "recv_tick",
+	[PIPE_BAR] = "gen_bar",
+	[PIPE_RECORD] = "rec_tick",
+	[PIPE_REDIS] = "pub_redis",
+	[PIPE_MATCH] = "match_tick",
+};
+
+int
+pipe_cpus_parse(const char *s, cpu_set_t *set)
+{
+	unsigned long a, b;
+	char *end;
+
+	CPU_ZERO(set);
+	while (*s != '\0') {
+		a = strtoul(s, &end, 10);
+		if (end == s) {
+			return -1;
+		}
+		b = a;
+		if (*end == '-') {
+			s = end + 1;
+			b = strtoul(s, &end, 10);
+			if (end == s) {
+				return -1;
+			}
+		}
+		if (b < a || b >= CPU_SETSIZE) {
+			return -1;
+		}
+		for (; a <= b; a++) {
+			CPU_SET(a, set);
+		}
+		if (*end != ',' && *end != '\0') {
+			return -1;
+		}
+		s = *end == ',' ? end + 1 : end;
+	}
+
+	return CPU_COUNT(set);
+}
+
+char *
+pipe_cpus_format(const cpu_set_t *set, char *dst, size_t len)
+{
+	size_t off = 0;
+	int a, b, n;
+
+	dst[0] = '\0';
+	for (a = 0; a < CPU_SETSIZE; a++) {
+		if (!CPU_ISSET(a, set)) {
+			continue;
+		}
+		for (b = a; b + 1 < CPU_SETSIZE && CPU_ISSET(b + 1, set); b++)
+			;
+		n = a == b ? snprintf(dst + off, len - off, "%s%d", off ? "," : "", a)
+			   : snprintf(dst + off, len - off, "%s%d-%d", off ? "," : "", a, b);
+		if (n < 0 || (size_t)n >= len - off) {
+			break;
+		}
+		off += (size_t)n;
+		a = b;
+	}
+
+	return dst;
+}
+
+static int
+parse_kind(const char *name)
+{
+	int i;
+
+	for (i = 0; i < PIPE_KIND_MAX; i++) {
+		if (strcmp(name, pipe_kind_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int
+parse_cpu(const char *s)
+{
+	char *end;
+	long v = strtol(s, &end, 10);
+
+	return end != s && *end == '\0' && v >= 0 && v < CPU_SETSIZE ? (int)v : -1;
+}
+
+/* key=value of a stage, the value split in place */
+static int
+stage_key(struct pipe_stage *st, char *tok)
+{
+	char *val = strchr(tok, '='), *save = NULL, *g;
+	int recv = st->kind == PIPE_RECV;
+
+	if (val == NULL) {
+		return -1;
+	}
+	*val++ = '\0';
+
+	if (strcmp(tok, "host") == 0) {
+		st->hosts = strcmp(val, "*") == 0 ? NULL : val;
+	} else if (strcmp(tok, "cpu") == 0) {
+		st->ncpus = pipe_cpus_parse(val, &st->cpus);
+		return st->ncpus > 0 ? 0 : -1;
+	} else if (strcmp(tok, "node") == 0) {
+		st->node = parse_cpu(val);
+		return st->node >= 0 ? 0 : -1;
+	} else if (strcmp(tok, "wait") == 0) {
+		/* the publisher waits on the deadline of its batches, the decoder has no futex */
+		st->wait = bus_wait_parse(val);
+		return st->wait < BUS_WAIT_SLEEP || st->kind == PIPE_REDIS ||
+		       (recv && st->wait == RING_WAIT_FUTEX) ? -1 : 0;
+	} else if (strcmp(tok, "out") == 0) {
+		st->out = val;
+	} else if (recv && strcmp(tok, "type") == 0) {
+		st->type = val;
+	} else if (recv && strcmp(tok, "ifaddr") == 0) {
+		st->ifaddr = val;
+	} else if (recv && strcmp(tok, "groups") == 0) {
+		for (g = strtok_r(val, ",", &save); g != NULL; g = strtok_r(NULL, ",", &save)) {
+			if (st->ngroups == PIPE_GROUP_MAX) {
+				return -1;
+			}
+			st->groups[st->ngroups++] = g;
+		}
+	} else if (recv && strcmp(tok, "rx") == 0) {
+		return (st->rx_cpu = parse_cpu(val)) >= 0 ? 0 : -1;
+	} else if (recv && strcmp(tok, "decode") == 0) {
+		return (st->decode_cpu = parse_cpu(val)) >= 0 ? 0 : -1;
+	} else if (recv && strcmp(tok, "poll") == 0) {
+		if (strcmp(val, "busy") != 0 && strcmp(val, "epoll") != 0) {
+			return -1;
+		}
+		st->busy_poll = strcmp(val, "busy") == 0;
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+add_stage(struct pipe_conf *pc, const char *line, int lineno)
+{
+	struct pipe_stage *st, *v;
+	char *save = NULL, *tok;
+	size_t i;
+
+	if ((v = realloc(pc->stages, (pc->nstages + 1) * sizeof(*v))) == NULL) {
+		return -1;
+	}
+	pc->stages = v;
+	st = &pc->stages[pc->nstages];
+	memset(st, 0, sizeof(*st));
+	st->line = lineno;
+	st->node = st->rx_cpu = st->decode_cpu = -1;
+	st->wait = PIPE_WAIT_NONE;
+	if ((st->text = strdup(line)) == NULL) {
+		return -1;
+	}
+	pc->nstages++;
+
+	tok = strtok_r(st->text, " \t\r\n", &save);
+	if ((st->kind = parse_kind(tok)) < 0) {
+		fprintf(stderr, "line %d: unknown stage %s\n", lineno, tok);
+		return -1;
+	}
+	if ((tok = strtok_r(NULL, " \t\r\n", &save)) == NULL || strlen(tok) >= sizeof(st->bus)) {
+		fprintf(stderr, "line %d: %s needs a bus\n", lineno, pipe_kind_names[st->kind]);
+		return -1;
+	}
+	snprintf(st->bus, sizeof(st->bus), "%s", tok);
+
+	while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL && strcmp(tok, "--") != 0) {
+		if (stage_key(st, tok) != 0) {
+			fprintf(stderr, "line %d: bad %s of %s\n", lineno, tok, pipe_kind_names[st->kind]);
+			return -1;
+		}
+	}
+	while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+		if (st->nargs == PIPE_ARGS_MAX) {
+			fprintf(stderr, "line %d: more than %d options\n", lineno, PIPE_ARGS_MAX);
+			return -1;
+		}
+		st->args[st->nargs++] = tok;
+	}
+
+	if (st->kind == PIPE_RECV && st->type == NULL) {
+		fprintf(stderr, "line %d: recv needs a type\n", lineno);
+		return -1;
+	}
+	for (i = 0; i + 1 < pc->nstages; i++) {
+		if (pc->stages[i].kind == st->kind && strcmp(pc->stages[i].bus, st->bus) == 0 &&
+		    (st->hosts == NULL || pc->stages[i].hosts == NULL || strcmp(st->hosts, pc->stages[i].hosts) == 0)) {
+			fprintf(stderr, "line %d: %s %s is on line %d already\n", lineno, pipe_kind_names[st->kind],
+				st->bus, pc->stages[i].line);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+pipe_load(struct pipe_conf *pc, const char *path)
+{
+	char line[LINE_MAX_LEN], copy[LINE_MAX_LEN], *save, *key, *val;
+	int lineno = 0, rc = 0;
+	FILE *fp;
+
+	memset(pc, 0, sizeof(*pc));
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	while (rc == 0 && fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		line[strcspn(line, "#")] = '\0';
+		snprintf(copy, sizeof(copy), "%s", line);
+		save = NULL;
+		if ((key = strtok_r(copy, " \t\r\n", &save)) == NULL) {
+			continue;
+		}
+		val = strtok_r(NULL, " \t\r\n", &save);
+
+		if (strcmp(key, "bin") == 0 && val != NULL) {
+			snprintf(pc->bin, sizeof(pc->bin), "%s", val);
+		} else if (strcmp(key, "log") == 0 && val != NULL) {
+			snprintf(pc->log, sizeof(pc->log), "%s", val);
+		} else if (strcmp(key, "critical") == 0 && val != NULL) {
+			if ((pc->ncritical = pipe_cpus_parse(val, &pc->critical)) <= 0) {
+				fprintf(stderr, "line %d: bad cores %s\n", lineno, val);
+				rc = -1;
+			}
+		} else {
+			rc = add_stage(pc, line, lineno);
+		}
+	}
+	fclose(fp);
+
+	if (rc != 0) {
+		pipe_free(pc);
+	}
+
+	return rc;
+}
+
+void
+pipe_free(struct pipe_conf *pc)
+{
+	size_t i;
+
+	for (i = 0; i < pc->nstages; i++) {
+		free(pc->stages[i].text);
+	}
+	free(pc->stages);
+	memset(pc, 0, sizeof(*pc));
+}
+
+static int
+has_host(const char *hosts, const char *host)
+{
+	size_t n = strlen(host);
+	const char *p;
+
+	if (hosts == NULL) {
+		return 1;
+	}
+	for (p = hosts; p != NULL; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+		if (strncmp(p, host, n) == 0 && (p[n] == ',' || p[n] == '\0')) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+size_t
+pipe_select(struct pipe_conf *pc, const char *host)
+{
+	size_t i, n = 0;
+
+	for (i = 0; i < pc->nstages; i++) {
+		pc->stages[i].mine = has_host(pc->stages[i].hosts, host);
+		n += (size_t)pc->stages[i].mine;
+	}
+
+	return n;
+}
+
+/* the cores of the node, -1 if it has none */
+static int
+node_cpus(int node, cpu_set_t *set)
+{
+	char path[128], line[1024];
+	FILE *fp;
+	int n = -1;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	if ((fp = fopen(path, "r")) == NULL) {
+		return -1;
+	}
+	if (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		n = pipe_cpus_parse(line, set);
+	}
+	fclose(fp);
+
+	return n;
+}
+
+/* a core a stage spins on, claimed once */
+static int
+claim(const struct pipe_stage **owner, int cpu, const struct pipe_stage *st)
+{
+	if (owner[cpu] == st) {
+		fprintf(stderr, "%s %s spins twice on core %d\n", pipe_kind_names[st->kind], st->bus, cpu);
+		return -1;
+	}
+	if (owner[cpu] != NULL) {
+		fprintf(stderr, "%s %s and %s %s both spin on core %d\n", pipe_kind_names[owner[cpu]->kind],
+			owner[cpu]->bus, pipe_kind_names[st->kind], st->bus, cpu);
+		return -1;
+	}
+	owner[cpu] = st;
+
+	return 0;
+}
+
+/* the cores of the stage are on the box, and on its node if it has one */
+static int
+check_cores(const struct pipe_stage *st, const cpu_set_t *allowed)
+{
+	cpu_set_t cores, node;
+	int c, rc = 0;
+
+	cores = st->cpus;
+	if (st->rx_cpu >= 0) {
+		CPU_SET(st->rx_cpu, &cores);
+	}
+	if (st->decode_cpu >= 0) {
+		CPU_SET(st->decode_cpu, &cores);
+	}
+	if (st->node >= 0 && node_cpus(st->node, &node) < 0) {
+		fprintf(stderr, "%s %s: no NUMA node %d\n", pipe_kind_names[st->kind], st->bus, st->node);
+		return -1;
+	}
+
+	for (c = 0; c < CPU_SETSIZE; c++) {
+		if (!CPU_ISSET(c, &cores)) {
+			continue;
+		}
+		if (!CPU_ISSET(c, allowed)) {
+			fprintf(stderr, "%s %s: no core %d on this box\n", pipe_kind_names[st->kind], st->bus, c);
+			rc = -1;
+		} else if (st->node >= 0 && !CPU_ISSET(c, &node)) {
+			fprintf(stderr, "warning: core %d of %s %s is not on node %d\n", c, pipe_kind_names[st->kind],
+				st->bus, st->node);
+		}
+	}
+
+	return rc;
+}
+
+/* the receiver of the bus on the box, if any */
+static int
+has_recv(const struct pipe_conf *pc, const char *bus)
+{
+	size_t i;
+
+	for (i = 0; i < pc->nstages; i++) {
+		if (pc->stages[i].mine && pc->stages[i].kind == PIPE_RECV && strcmp(pc->stages[i].bus, bus) == 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int
+pipe_place(struct pipe_conf *pc)
+{
+	static const struct pipe_stage *owner[CPU_SETSIZE];
+	cpu_set_t allowed, noisy, both;
+	struct pipe_stage *st;
+	char buf[256];
+	size_t i;
+	int c, rc = 0;
+
+	memset(owner, 0, sizeof(owner));
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		CPU_ZERO(&allowed);
+	}
+	CPU_XOR(&noisy, &allowed, &pc->critical);
+	CPU_AND(&noisy, &noisy, &allowed);
+
+	for (i = 0; i < pc->nstages; i++) {
+		st = &pc->stages[i];
+		if (!st->mine) {
+			continue;
+		}
+
+		if (PIPE_NOISY(st->kind) && pc->ncritical > 0) {
+			CPU_AND(&both, &st->cpus, &pc->critical);
+			if (st->ncpus > 0 && CPU_COUNT(&both) > 0) {
+				fprintf(stderr, "%s %s is on the critical cores %s\n", pipe_kind_names[st->kind], st->bus,
+					pipe_cpus_format(&both, buf, sizeof(buf)));
+				rc = -1;
+			} else if (st->ncpus == 0 && CPU_COUNT(&noisy) > 0) {
+				st->cpus = noisy;
+				st->ncpus = CPU_COUNT(&noisy);
+			}
+		}
+
+		/* the receiver spins on the sockets with busy poll, the decoder unless told to wait */
+		if (st->kind == PIPE_RECV) {
+			if (st->busy_poll && st->rx_cpu >= 0) {
+				rc |= claim(owner, st->rx_cpu, st);
+			}
+			if (st->decode_cpu >= 0 && (st->wait == PIPE_WAIT_NONE || st->wait == RING_WAIT_SPIN)) {
+				rc |= claim(owner, st->decode_cpu, st);
+			}
+		} else if (st->wait == RING_WAIT_SPIN && st->ncpus == 1) {
+			for (c = 0; !CPU_ISSET(c, &st->cpus); c++)
+				;
+			rc |= claim(owner, c, st);
+		} else if (st->wait == RING_WAIT_SPIN) {
+			fprintf(stderr, "warning: %s %s spins without a core of its own\n", pipe_kind_names[st->kind],
+				st->bus);
+		}
+
+		rc |= check_cores(st, &allowed);
+		if (st->kind != PIPE_RECV && !has_recv(pc, st->bus)) {
+			fprintf(stderr, "warning: the receiver of bus %s of %s is not run here\n", st->bus,
+				pipe_kind_names[st->kind]);
+		}
+	}
+
+	return rc;
+}
+
+static void
+push(struct pipe_cmd *cmd, const char *arg)
+{
+	if ((size_t)cmd->argc + 1 < sizeof(cmd->argv) / sizeof(cmd->argv[0])) {
+		cmd->argv[cmd->argc++] = (char *)arg;
+		cmd->argv[cmd->argc] = NULL;
+	}
+}
+
+static void
+push_cpu(struct pipe_cmd *cmd, const char *opt, int cpu, int k)
+{
+	snprintf(cmd->nums[k], sizeof(cmd->nums[k]), "%d", cpu);
+	push(cmd, opt);
+	push(cmd, cmd->nums[k]);
+}
+
+int
+pipe_command(const struct pipe_conf *pc, const struct pipe_stage *st, struct pipe_cmd *cmd)
+{
+	int i, n;
+
+	memset(cmd, 0, sizeof(*cmd));
+	n = pc->bin[0] != '\0' ? snprintf(cmd->path, sizeof(cmd->path), "%s/%s", pc->bin, pipe_programs[st->kind])
+			       : snprintf(cmd->path, sizeof(cmd->path), "%s", pipe_programs[st->kind]);
+	if (n < 0 || (size_t)n >= sizeof(cmd->path)) {
+		return -1;
+	}
+
+	push(cmd, pipe_programs[st->kind]);
+	push(cmd, "-b");
+	push(cmd, st->bus);
+	if (st->kind == PIPE_RECV) {
+		push(cmd, "-t");
+		push(cmd, st->type);
+		if (st->ifaddr != NULL) {
+			push(cmd, "-i");
+			push(cmd, st->ifaddr);
+		}
+		for (i = 0; i < st->ngroups; i++) {
+			push(cmd, "-g");
+			push(cmd, st->groups[i]);
+		}
+		if (st->rx_cpu >= 0) {
+			push_cpu(cmd, "-c", st->rx_cpu, 0);
+		}
+		if (st->decode_cpu >= 0) {
+			push_cpu(cmd, "-d", st->decode_cpu, 1);
+		}
+		if (st->busy_poll) {
+			push(cmd, "-p");
+		}
+	}
+	if (st->wait != PIPE_WAIT_NONE) {
+		push(cmd, "-w");
+		push(cmd, bus_wait_name(st->wait));
+	}
+	for (i = 0; i < st->nargs; i++) {
+		push(cmd, st->args[i]);
+	}
+
+	return 0;
+}
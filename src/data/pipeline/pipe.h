@@ -0,0 +1,124 @@
+/*
+ * pipe.h
+ *
+ * The file contains the definition of the tick pipeline of a box, as the
+ * file of run_pipe describes it, and the functions' prototype for loading
+ * and placing it.
+ *
+ * A stage is one process on a tick bus: the receiver of a feed (recv_tick,
+ * its receive and decode threads), or a reader of the bus, the bar engine
+ * (gen_bar), the recorder (rec_tick), the Redis publisher (pub_redis) or the
+ * matcher (match_tick). A line of the file is a stage, the host key says the
+ * boxes running it, so one file covers every box and a box runs its share.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __PIPE_H__
+#define __PIPE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/types.h>
+#include "bus.h"
+
+#define PIPE_GROUP_MAX		16	/* multicast groups of a receiver */
+#define PIPE_ARGS_MAX		64	/* options of a stage after "--" */
+#define PIPE_WAIT_NONE		-3	/* the wait of the program left alone */
+
+enum pipe_kind {
+	PIPE_RECV = 0,
+	PIPE_BAR,
+	PIPE_RECORD,
+	PIPE_REDIS,
+	PIPE_MATCH,
+	PIPE_KIND_MAX
+};
+
+extern const char *const pipe_kind_names[PIPE_KIND_MAX];
+extern const char *const pipe_programs[PIPE_KIND_MAX];
+
+/* the recorder and the publisher write files and sockets, never on the critical cores */
+#define PIPE_NOISY(kind)	((kind) == PIPE_RECORD || (kind) == PIPE_REDIS)
+
+struct pipe_stage
+{
+	int kind;			/* enum pipe_kind */
+	char bus[BUS_NAME_MAX];
+	int line;			/* of the file */
+	char *text;			/* the line, the strings below point into it */
+	const char *hosts;		/* comma separated, NULL for every box */
+	cpu_set_t cpus;			/* affinity of the process */
+	int ncpus;			/* 0 when not pinned */
+	int node;			/* NUMA node of its memory, -1 for any */
+	int wait;			/* bus_wait_parse() or PIPE_WAIT_NONE */
+	const char *out;		/* file the stdout is appended to */
+
+	/* the receiver */
+	const char *type;
+	const char *ifaddr;
+	const char *groups[PIPE_GROUP_MAX];
+	int ngroups;
+	int rx_cpu;			/* core of the receive thread, -1 for none */
+	int decode_cpu;			/* core of the decode thread, -1 for none */
+	int busy_poll;
+
+	char *args[PIPE_ARGS_MAX];	/* passed as they are */
+	int nargs;
+
+	int mine;			/* run on this box */
+};
+
+struct pipe_conf
+{
+	char bin[PATH_MAX];		/* directory of the programs, PATH when empty */
+	char log[PATH_MAX];		/* directory of the logs, stderr when empty */
+	cpu_set_t critical;		/* cores of the latency-critical stages only */
+	int ncritical;
+	struct pipe_stage *stages;
+	size_t nstages;
+};
+
+/*
+ * pipe_cmd - the command line of a stage.
+ */
+struct pipe_cmd
+{
+	char path[PATH_MAX];
+	char *argv[PIPE_ARGS_MAX + 2 * PIPE_GROUP_MAX + 24];
+	int argc;
+	char nums[4][16];
+};
+
+/*
+ * pipe_load - read the file; pipe_free() frees what it made.
+ */
+int pipe_load(struct pipe_conf *pc, const char *path);
+void pipe_free(struct pipe_conf *pc);
+
+/*
+ * pipe_select - mark the stages of the host. Returns how many.
+ */
+size_t pipe_select(struct pipe_conf *pc, const char *host);
+
+/*
+ * pipe_place - check the placement of the stages of the box and pin the
+ * noisy ones left unpinned off the critical cores. Returns 0, -1 if two
+ * stages spin on one core, a noisy stage is on a critical core or a node
+ * does not exist.
+ */
+int pipe_place(struct pipe_conf *pc);
+
+int pipe_command(const struct pipe_conf *pc, const struct pipe_stage *st, struct pipe_cmd *cmd);
+
+/*
+ * pipe_cpus_parse - a list like "2-5,8" into the set, returns the cores or
+ * -1; pipe_cpus_format() writes it back.
+ */
+int pipe_cpus_parse(const char *s, cpu_set_t *set);
+char *pipe_cpus_format(const cpu_set_t *set, char *dst, size_t len);
+
+#endif		/* __PIPE_H__ */
@@ -0,0 +1,723 @@
+/*
+ * run_daily.c
+ *
+ * The program runs the nightly update of the daily bars of the exchanges
+ * from one file, each stage over what is new since the last run only: the
+ * trading days not fetched yet, the raw files not normalized yet into the
+ * store, and the days of the store after the majors and the indices. The
+ * exchanges are updated at the same time, one process each.
+ *
+ *	run_daily -f daily.conf
+ *	run_daily -f daily.conf -e shfe,dce -d 20250303 -n
+ *
+ * The file has a line for the settings or an exchange:
+ *
+ *	bin      /opt/jupiter/bin	# the programs, from PATH without it
+ *	log      /var/log/jupiter	# stderr of an exchange to <log>/daily.<exchange>.log
+ *	store    /data/store		# the column store
+ *	raw      /data/raw		# the raw files, <raw>/<exchange>/
+ *	state    /data/state		# the watermarks, <state>/<exchange>.upd
+ *	calendar /data/calendar.txt	# the trading days, every weekday without it
+ *	master   /data/instruments.jins	# the instrument master norm_daily adds to
+ *	start    20100104		# first day crawled of an exchange with no state
+ *
+ *	exchange shfe  url=http://www.shfe.com.cn/data/dailydata/kx/kx%Y%m%d.dat file=%Y%m%d.dat
+ *		       major=/data/major index=/data/index roll=-s,volume
+ *	exchange cffex url=http://www.cffex.com.cn/sj/historysj/%Y%m/zip/%Y%m%d_1.zip file=%Y%m%d_1.zip
+ *	exchange dce   major=/data/major index=/data/index
+ *
+ * (an exchange is one line, split above to fit). url and file are the
+ * templates of a day; an exchange without url is not crawled, its raw
+ * files are put in its directory by the crawlers of Python. major and index
+ * are the directories of select_major and build_index, the stage is not
+ * run without; roll the options of select_major, threads those of
+ * norm_daily.
+ *
+ * A day that cannot be fetched stops the crawl watermark there, and it is
+ * fetched again the next run; past the days of the calendar, one followed by
+ * a day fetched is taken for a holiday. norm takes the raw files up to the
+ * crawl watermark, so a hole is never normalized around.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "daily.h"
+#include "bar.h"
+
+#define NORM_BATCH	512		/* raw files of one norm_daily */
+#define CMD_ARGS_MAX	(NORM_BATCH + DAILY_ARGS_MAX + 16)
+#define DIR_LEN		(PATH_MAX + DAILY_NAME_LEN + 16)	/* <raw>/<exchange> */
+#define FILE_LEN	(DIR_LEN + NAME_MAX + 2)
+
+/*
+ * update - the update of an exchange, in its process.
+ */
+struct update
+{
+	const struct daily_conf *dc;
+	const struct daily_exchange *ex;
+	const struct bar_calendar *cal;
+	int32_t end;			/* the last day updated */
+	int dry;
+	struct daily_state st;
+	char path[DIR_LEN];		/* of the state */
+	char dir[DIR_LEN];		/* of the raw files */
+};
+
+/* a raw file new or changed */
+struct rawfile
+{
+	char *path;
+	struct daily_file f;
+};
+
+static double
+mono(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -f file [-e exchanges] [-d day] [-j jobs] [-n]\n"
+		"  -f file      the update\n"
+		"  -e list      comma separated exchanges, all of the file by default\n"
+		"  -d day       the last trading day updated, YYYYMMDD, default today\n"
+		"  -j jobs      exchanges updated at the same time, default all\n"
+		"  -n           print what would be run, run nothing\n",
+		prog);
+}
+
+static int
+make_dir(const char *path)
+{
+	if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "cannot make %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * run - the program of the stage with the options, what it exits with, -1
+ * if it cannot be run.
+ */
+static int
+run(struct update *u, int stage, char **argv)
+{
+	char path[PATH_MAX + 64];
+	int i, status;
+	pid_t pid;
+
+	if (u->dc->bin[0] != '\0') {
+		snprintf(path, sizeof(path), "%s/%s", u->dc->bin, daily_programs[stage]);
+	} else {
+		snprintf(path, sizeof(path), "%s", daily_programs[stage]);
+	}
+	argv[0] = path;
+
+	fprintf(stderr, "%s %s:", u->ex->name, daily_stage_names[stage]);
+	for (i = 0; argv[i] != NULL; i++) {
+		if (stage == DAILY_NORM && i == 8 && argv[i + 1] != NULL) {
+			fprintf(stderr, " ...");
+			for (; argv[i + 1] != NULL; i++)
+				;
+		}
+		fprintf(stderr, " %s", argv[i]);
+	}
+	fprintf(stderr, "\n");
+	if (u->dry) {
+		return 0;
+	}
+
+	if ((pid = fork()) < 0) {
+		fprintf(stderr, "fork failed: %s\n", strerror(errno));
+		return -1;
+	}
+	if (pid == 0) {
+		if (u->dc->bin[0] != '\0') {
+			execv(path, argv);
+		} else {
+			execvp(path, argv);
+		}
+		fprintf(stderr, "cannot run %s: %s\n", path, strerror(errno));
+		_exit(127);
+	}
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			return -1;
+		}
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int
+save(struct update *u, int stage)
+{
+	u->st.marks[stage].done_at = now_ns();
+	return u->dry ? 0 : daily_state_save(&u->st, u->path);
+}
+
+static int
+raw_path(const struct update *u, int32_t day, char *dst, size_t len)
+{
+	char name[NAME_MAX + 1];
+
+	if (daily_expand(name, sizeof(name), u->ex->file, day) != 0 ||
+	    (size_t)snprintf(dst, len, "%s/%s", u->dir, name) >= len) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+fetched(const char *path)
+{
+	struct stat st;
+
+	return stat(path, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+}
+
+/* the day of the newest raw file, where a crawl of no state begins */
+static int32_t
+newest_raw(const struct update *u)
+{
+	struct dirent *de;
+	int32_t day, last = 0;
+	DIR *d;
+
+	if ((d = opendir(u->dir)) == NULL) {
+		return 0;
+	}
+	while ((de = readdir(d)) != NULL) {
+		if (de->d_name[0] != '.' && strstr(de->d_name, ".part.") == NULL &&
+		    (day = daily_file_day(de->d_name)) > last) {
+			last = day;
+		}
+	}
+	closedir(d);
+
+	return last;
+}
+
+/*
+ * crawl - fetch the trading days after the watermark up to the end in one
+ * crawl_daily, then move the watermark over the days fetched.
+ */
+static int
+crawl(struct update *u)
+{
+	struct daily_mark *m = &u->st.marks[DAILY_CRAWL];
+	char manifest[DIR_LEN], path[FILE_LEN], url[4096], *argv[4];
+	const struct bar_calendar *cal = u->cal;
+	int32_t from = m->last_day, day, last;
+	size_t n = 0;
+	FILE *fp;
+	int rc;
+
+	if (u->ex->url == NULL) {
+		return 0;
+	}
+	if (from == 0) {
+		from = u->dc->start > 0 ? (int32_t)bar_calendar_next(cal, (uint32_t)u->dc->start - 1) - 1 : 0;
+		day = newest_raw(u);
+		from = day > from ? day : from > 0 ? from : u->end - 1;
+	}
+
+	snprintf(manifest, sizeof(manifest), "%s/%s.manifest", u->dc->state, u->ex->name);
+	if ((fp = fopen(u->dry ? "/dev/null" : manifest, "w")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", manifest, strerror(errno));
+		return -1;
+	}
+	for (day = (int32_t)bar_calendar_next(cal, (uint32_t)from); day <= u->end;
+	     day = (int32_t)bar_calendar_next(cal, (uint32_t)day)) {
+		if (raw_path(u, day, path, sizeof(path)) != 0 || daily_expand(url, sizeof(url), u->ex->url, day) != 0) {
+			fprintf(stderr, "%s: the file or url of %d is too long\n", u->ex->name, day);
+			fclose(fp);
+			return -1;
+		}
+		if (!fetched(path)) {
+			fprintf(fp, "%s %s\n", url, path);
+			n++;
+		}
+	}
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "cannot write %s\n", manifest);
+		return -1;
+	}
+
+	if (n > 0) {
+		argv[1] = "-m";
+		argv[2] = manifest;
+		argv[3] = NULL;
+		if ((rc = run(u, DAILY_CRAWL, argv)) != 0) {
+			fprintf(stderr, "%s crawl: exited with %d, going on with the days fetched\n", u->ex->name, rc);
+		}
+	}
+	if (u->dry) {
+		fprintf(stderr, "%s crawl: %zu days to fetch after %d\n", u->ex->name, n, from);
+		return 0;
+	}
+
+	/* the watermark stops at the first day missing, a holiday past the calendar aside */
+	for (last = from, day = (int32_t)bar_calendar_next(cal, (uint32_t)from); day <= u->end;
+	     day = (int32_t)bar_calendar_next(cal, (uint32_t)day)) {
+		raw_path(u, day, path, sizeof(path));
+		if (fetched(path)) {
+			m->last_day = last = day;
+		} else if (cal->ndays > 0 && (uint32_t)day <= cal->days[cal->ndays - 1]) {
+			break;
+		}
+	}
+	if (m->last_day < from) {
+		m->last_day = from;
+	}
+	if (last < u->end) {
+		fprintf(stderr, "%s crawl: fetched to %d, %d not yet\n", u->ex->name, m->last_day, u->end);
+	}
+
+	return save(u, DAILY_CRAWL);
+}
+
+static int
+cmp_raw(const void *a, const void *b)
+{
+	const struct rawfile *x = a, *y = b;
+
+	return x->f.day != y->f.day ? (x->f.day < y->f.day ? -1 : 1) : strcmp(x->path, y->path);
+}
+
+/*
+ * changed_files - the raw files not normalized yet or changed since, up to
+ * the day; a file of the same size and mtime is taken as it was.
+ */
+static struct rawfile *
+changed_files(struct update *u, int32_t limit, size_t *count, size_t *touched)
+{
+	struct rawfile *v = NULL, *t;
+	struct dirent *de;
+	size_t n = 0, cap = 0;
+	char path[FILE_LEN];
+	struct stat st;
+	DIR *d;
+
+	*count = *touched = 0;
+	if ((d = opendir(u->dir)) == NULL) {
+		if (errno == ENOENT) {
+			return calloc(1, sizeof(*v));
+		}
+		fprintf(stderr, "cannot open %s: %s\n", u->dir, strerror(errno));
+		return NULL;
+	}
+
+	while ((de = readdir(d)) != NULL) {
+		struct daily_file f, *old;
+
+		memset(&f, 0, sizeof(f));
+		if (de->d_name[0] == '.' || strstr(de->d_name, ".part.") != NULL ||
+		    (f.day = daily_file_day(de->d_name)) == 0 || f.day > limit) {
+			continue;
+		}
+		if ((size_t)snprintf(path, sizeof(path), "%s/%s", u->dir, de->d_name) >= sizeof(path) ||
+		    stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+			continue;
+		}
+
+		f.name = daily_hash(de->d_name, strlen(de->d_name), 0);
+		f.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+		f.size = (uint64_t)st.st_size;
+		if ((old = daily_state_find(&u->st, f.name)) != NULL && old->size == f.size && old->mtime == f.mtime) {
+			continue;
+		}
+		if (daily_hash_file(path, &f.hash) != 0) {
+			goto fail;
+		}
+		if (old != NULL && old->hash == f.hash) {
+			/* touched, not changed */
+			old->mtime = f.mtime;
+			(*touched)++;
+			continue;
+		}
+
+		if (n == cap) {
+			cap = cap ? cap * 2 : 256;
+			if ((t = realloc(v, cap * sizeof(*v))) == NULL) {
+				goto fail;
+			}
+			v = t;
+		}
+		if ((v[n].path = strdup(path)) == NULL) {
+			goto fail;
+		}
+		v[n++].f = f;
+	}
+	closedir(d);
+
+	if (v == NULL && (v = calloc(1, sizeof(*v))) == NULL) {
+		return NULL;
+	}
+	qsort(v, n, sizeof(*v), cmp_raw);
+	*count = n;
+	return v;
+
+fail:
+	closedir(d);
+	while (n-- > 0) {
+		free(v[n].path);
+	}
+	free(v);
+	return NULL;
+}
+
+/*
+ * norm - the raw files changed into the store, NORM_BATCH of them a run of
+ * norm_daily, each committed to the state when it is done.
+ */
+static int
+norm(struct update *u)
+{
+	struct daily_mark *m = &u->st.marks[DAILY_NORM];
+	int32_t limit = u->ex->url != NULL ? u->st.marks[DAILY_CRAWL].last_day : u->end;
+	char *argv[CMD_ARGS_MAX], threads[16];
+	uint32_t gen = u->st.hdr.gen + 1;
+	size_t n, touched, i, k, j;
+	struct rawfile *v;
+	int a, rc = 0;
+
+	if ((v = changed_files(u, limit, &n, &touched)) == NULL) {
+		return -1;
+	}
+	if (n == 0) {
+		free(v);
+		return touched > 0 ? save(u, DAILY_NORM) : 0;
+	}
+	fprintf(stderr, "%s norm: %zu files, %d to %d%s\n", u->ex->name, n, v[0].f.day, v[n - 1].f.day,
+		v[0].f.day <= m->last_day ? ", history changed" : "");
+
+	for (i = 0; i < n && rc == 0; i += k) {
+		k = n - i < NORM_BATCH ? n - i : NORM_BATCH;
+		a = 1;
+		argv[a++] = "-e";
+		argv[a++] = (char *)u->ex->name;
+		argv[a++] = "-o";
+		argv[a++] = (char *)u->dc->store;
+		argv[a++] = "-a";
+		if (u->dc->master[0] != '\0') {
+			argv[a++] = "-I";
+			argv[a++] = (char *)u->dc->master;
+		}
+		if (u->ex->threads > 0) {
+			snprintf(threads, sizeof(threads), "%d", u->ex->threads);
+			argv[a++] = "-j";
+			argv[a++] = threads;
+		}
+		for (j = 0; j < k; j++) {
+			argv[a++] = v[i + j].path;
+		}
+		argv[a] = NULL;
+
+		if ((rc = run(u, DAILY_NORM, argv)) != 0) {
+			fprintf(stderr, "%s norm: exited with %d\n", u->ex->name, rc);
+			break;
+		}
+		for (j = 0; j < k; j++) {
+			v[i + j].f.gen = gen;
+			if (daily_state_put(&u->st, &v[i + j].f) != 0) {
+				rc = -1;
+				break;
+			}
+			if (v[i + j].f.day > m->last_day) {
+				m->last_day = v[i + j].f.day;
+			}
+		}
+		u->st.hdr.gen = gen;
+		m->gen = gen;
+		m->input = daily_digest(&u->st);
+		if (rc == 0 && save(u, DAILY_NORM) != 0) {
+			rc = -1;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		free(v[i].path);
+	}
+	free(v);
+
+	return rc == 0 ? 0 : -1;
+}
+
+/*
+ * follow - roll or index after norm: the days new are appended, a file of
+ * a day before the watermark normalized since has the stage rebuilt, and so
+ * does a run of the stage that did not finish, its output is part written.
+ */
+static int
+follow(struct update *u, int stage)
+{
+	struct daily_mark *m = &u->st.marks[stage], *nm = &u->st.marks[DAILY_NORM];
+	const char *dir = stage == DAILY_ROLL ? u->ex->major : u->ex->index;
+	char *argv[CMD_ARGS_MAX];
+	int rebuild, a, i, rc;
+	uint32_t k;
+
+	if (dir == NULL || (m->input == nm->input && m->gen == nm->gen)) {
+		return 0;
+	}
+	rebuild = m->started_at != 0;
+	for (k = 0; k < u->st.hdr.nfiles && m->last_day > 0 && !rebuild; k++) {
+		if (u->st.files[k].gen > m->gen && u->st.files[k].day <= m->last_day) {
+			rebuild = 1;
+			break;
+		}
+	}
+
+	if (!u->dry && make_dir(dir) != 0) {
+		return -1;
+	}
+	a = 1;
+	argv[a++] = "-r";
+	argv[a++] = (char *)u->dc->store;
+	argv[a++] = "-e";
+	argv[a++] = (char *)u->ex->name;
+	argv[a++] = "-o";
+	argv[a++] = (char *)dir;
+	if (!rebuild) {
+		argv[a++] = "-a";
+	}
+	for (i = 0; stage == DAILY_ROLL && i < u->ex->nroll; i++) {
+		argv[a++] = u->ex->roll[i];
+	}
+	argv[a] = NULL;
+
+	fprintf(stderr, "%s %s: %s to %d\n", u->ex->name, daily_stage_names[stage],
+		rebuild ? "rebuilt" : "appended", nm->last_day);
+	m->started_at = now_ns();
+	if (!u->dry && daily_state_save(&u->st, u->path) != 0) {
+		return -1;
+	}
+	if ((rc = run(u, stage, argv)) != 0) {
+		fprintf(stderr, "%s %s: exited with %d\n", u->ex->name, daily_stage_names[stage], rc);
+		return -1;
+	}
+
+	m->last_day = nm->last_day;
+	m->gen = nm->gen;
+	m->input = nm->input;
+	m->started_at = 0;
+
+	return save(u, stage);
+}
+
+static int
+update(const struct daily_conf *dc, const struct daily_exchange *ex, const struct bar_calendar *cal,
+       int32_t end, int dry)
+{
+	struct update u;
+	char lock[DIR_LEN];
+	int fd, rc = 0;
+
+	memset(&u, 0, sizeof(u));
+	u.dc = dc;
+	u.ex = ex;
+	u.cal = cal;
+	u.end = end;
+	u.dry = dry;
+	snprintf(u.path, sizeof(u.path), "%s/%s.upd", dc->state, ex->name);
+	snprintf(u.dir, sizeof(u.dir), "%s/%s", dc->raw, ex->name);
+
+	/* a run still going from the night before has the exchange */
+	snprintf(lock, sizeof(lock), "%s/%s.lock", dc->state, ex->name);
+	if (dry) {
+		fd = -1;
+	} else if ((fd = open(lock, O_RDWR | O_CREAT, 0644)) < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+		fprintf(stderr, "%s: is being updated by another run\n", ex->name);
+		return -1;
+	}
+	if (daily_state_load(&u.st, u.path, ex->name) != 0 || (!dry && make_dir(u.dir) != 0)) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+
+	/* the stages after a failure of theirs are left for the next run */
+	if (crawl(&u) != 0 || norm(&u) != 0) {
+		rc = -1;
+	} else {
+		rc |= follow(&u, DAILY_ROLL);
+		rc |= follow(&u, DAILY_INDEX);
+	}
+
+	fprintf(stderr, "%s: crawl %d norm %d roll %d index %d, %u files\n", ex->name,
+		u.st.marks[DAILY_CRAWL].last_day, u.st.marks[DAILY_NORM].last_day,
+		u.st.marks[DAILY_ROLL].last_day, u.st.marks[DAILY_INDEX].last_day, u.st.hdr.nfiles);
+
+	daily_state_free(&u.st);
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	return rc == 0 ? 0 : -1;
+}
+
+/* in the child: the log of the exchange, then its update */
+static void
+child(const struct daily_conf *dc, const struct daily_exchange *ex, const struct bar_calendar *cal,
+      int32_t end, int dry)
+{
+	char path[DIR_LEN];
+	int fd;
+
+	if (dc->log[0] != '\0' && !dry) {
+		snprintf(path, sizeof(path), "%s/daily.%s.log", dc->log, ex->name);
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644)) >= 0) {
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+	}
+
+	_exit(update(dc, ex, cal, end, dry) == 0 ? 0 : 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *file = NULL, *exchanges = NULL;
+	struct bar_calendar cal = { NULL, 0 };
+	struct daily_conf dc;
+	pid_t *pids = NULL, pid;
+	double t0 = mono();
+	int32_t end = 0;
+	int jobs = 0, dry = 0, opt, running = 0, status, failed = 0;
+	size_t i, k, n;
+
+	while ((opt = getopt(argc, argv, "f:e:d:j:n")) != -1) {
+		switch (opt) {
+		case 'f':
+			file = optarg;
+			break;
+		case 'e':
+			exchanges = optarg;
+			break;
+		case 'd':
+			if ((end = daily_file_day(optarg)) == 0) {
+				fprintf(stderr, "bad day %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'n':
+			dry = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (file == NULL || optind != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (daily_load(&dc, file) != 0) {
+		return 1;
+	}
+	if ((n = daily_select(&dc, exchanges)) == 0) {
+		fprintf(stderr, "no exchange of %s to update\n", exchanges != NULL ? exchanges : file);
+		daily_free(&dc);
+		return 1;
+	}
+	if (end == 0) {
+		end = (int32_t)bar_calendar_day((uint64_t)now_ns());
+	}
+	if ((dc.calendar[0] != '\0' && bar_calendar_load(&cal, dc.calendar) != 0) ||
+	    (!dry && (make_dir(dc.state) != 0 || make_dir(dc.raw) != 0 || make_dir(dc.store) != 0 ||
+		      (dc.log[0] != '\0' && make_dir(dc.log) != 0))) ||
+	    (pids = calloc(dc.nexchanges, sizeof(*pids))) == NULL) {
+		daily_free(&dc);
+		return 1;
+	}
+	if (jobs <= 0 || (size_t)jobs > n) {
+		jobs = (int)n;
+	}
+
+	/* the exchanges share nothing but the programs, jobs of them at a time */
+	for (i = 0; i < dc.nexchanges || running > 0;) {
+		if (i < dc.nexchanges && !dc.exchanges[i].mine) {
+			i++;
+			continue;
+		}
+		if (i < dc.nexchanges && running < jobs) {
+			if ((pid = fork()) < 0) {
+				fprintf(stderr, "fork failed: %s\n", strerror(errno));
+				failed++;
+				i++;
+				continue;
+			}
+			if (pid == 0) {
+				child(&dc, &dc.exchanges[i], &cal, end, dry);
+			}
+			pids[i++] = pid;
+			running++;
+			continue;
+		}
+
+		if ((pid = wait(&status)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (k = 0; k < dc.nexchanges && pids[k] != pid; k++)
+			;
+		if (k == dc.nexchanges) {
+			continue;
+		}
+		running--;
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "%s: failed\n", dc.exchanges[k].name);
+			failed++;
+		}
+	}
+
+	fprintf(stderr, "%zu exchanges updated to %d in %.1fs, %d failed\n", n, end, mono() - t0, failed);
+
+	free(pids);
+	bar_calendar_free(&cal);
+	daily_free(&dc);
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+/*
+ * run_pipe.c
+ *
+ * The program runs the tick pipeline of a box from one file: the receivers
+ * of the feeds it owns and the readers of their buses, each pinned to its
+ * cores with its memory on its NUMA node, and restarts a stage that dies.
+ *
+ *	run_pipe -f pipeline.conf
+ *	run_pipe -f pipeline.conf -H md2 -n
+ *
+ * The file has a line for the box-wide settings or a stage:
+ *
+ *	bin      /opt/jupiter/bin	# the programs, from PATH without it
+ *	log      /var/log/jupiter	# stderr of a stage to <log>/<stage>.<bus>.log
+ *	critical 2-9			# cores of the receivers, bar and match only
+ *
+ *	# stage bus  key=value ...			       [-- options of the program]
+ *	recv   shfe host=md1 type=shfe groups=233.54.1.1:30001,233.54.2.1:30001
+ *		    ifaddr=10.0.0.1 rx=2 decode=3 poll=busy node=0 -- -A -R tcp://10.0.0.5:30100
+ *	bar    shfe host=md1 cpu=4 wait=spin node=0 out=/data/bar/shfe.csv -- -C calendar.txt
+ *	record shfe host=md1 wait=futex -- -o /data/tick -e SHFE -C calendar.txt
+ *	redis  shfe host=md1 -- -H 127.0.0.1:6379
+ *	recv   dce  host=md2 type=dce groups=233.57.1.100:10001 rx=2 decode=3 poll=busy
+ *
+ * (a stage is one line, split above to fit). The stages are recv, bar,
+ * record, redis and match, a bus is named after its feed; the keys are
+ *
+ *	host	the boxes running it, comma separated, every box without it
+ *	cpu	cores of the process, e.g. 4 or 10-11,14
+ *	node	NUMA node of its memory, the rings it maps first included
+ *	wait	for the ticks, spin, yield, futex or sleep (recv: the decoder, no futex)
+ *	out	file its stdout is appended to
+ *
+ * and for recv, type, ifaddr, groups, the rx and decode cores and poll=busy
+ * or epoll of the sockets. So splitting the exchanges over more boxes is a
+ * matter of their host keys. The record and redis stages never run on the
+ * critical cores, those without cpu get the others; two stages spinning on
+ * one core, or a core off the node of its stage, are told before anything
+ * starts.
+ *
+ * The receivers start first and the readers once their bus is alive. A
+ * receiver started again makes its bus anew, so the readers of the bus are
+ * stopped and started again on the new one. On SIGINT or SIGTERM the
+ * readers stop first, so the recorders drain the bus, then the receivers.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/mempolicy.h>
+#include "pipe.h"
+
+#define BUS_ALIVE_NS	1000000000ULL	/* heartbeat a started bus is seen with */
+#define BUS_START_SEC	10		/* longest the readers wait for their bus */
+#define RESTART_MIN	1		/* seconds before a stage that died starts again */
+#define RESTART_MAX	60
+#define STOP_SEC	10		/* longest a stage takes to stop before it is killed */
+
+struct proc
+{
+	struct pipe_stage *st;
+	pid_t pid;
+	time_t started;
+	time_t restart;			/* when to start it again, 0 if running */
+	int backoff;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -f file [-H host] [-n]\n"
+		"  -f file      the pipeline\n"
+		"  -H host      the box, default the host name\n"
+		"  -n           check and print the stages of the box, start nothing\n",
+		prog);
+}
+
+static void
+print_stage(const struct pipe_stage *st, const struct pipe_cmd *cmd)
+{
+	char cpus[256];
+	int i;
+
+	fprintf(stderr, "%s %s: cpu %s node %d:", pipe_kind_names[st->kind], st->bus,
+		st->ncpus > 0 ? pipe_cpus_format(&st->cpus, cpus, sizeof(cpus)) : "any", st->node);
+	for (i = 0; i < cmd->argc; i++) {
+		fprintf(stderr, " %s", cmd->argv[i]);
+	}
+	fprintf(stderr, "%s%s\n", st->out != NULL ? " > " : "", st->out != NULL ? st->out : "");
+}
+
+/* in the child: the place of the stage, its files, then the program */
+static void
+exec_stage(const struct pipe_conf *pc, const struct pipe_stage *st, struct pipe_cmd *cmd)
+{
+	unsigned long mask[16];
+	char path[PATH_MAX + BUS_NAME_MAX + 16];
+	int fd;
+
+	if (st->ncpus > 0 && sched_setaffinity(0, sizeof(st->cpus), &st->cpus) != 0) {
+		fprintf(stderr, "%s %s: cannot set the cores: %s\n", pipe_kind_names[st->kind], st->bus, strerror(errno));
+	}
+
+	/* kept over exec: the pages the program touches first come from the node */
+	if (st->node >= 0 && (size_t)st->node < sizeof(mask) * 8) {
+		memset(mask, 0, sizeof(mask));
+		mask[st->node / (8 * sizeof(mask[0]))] |= 1UL << (st->node % (8 * sizeof(mask[0])));
+		if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8) != 0) {
+			fprintf(stderr, "%s %s: cannot prefer node %d: %s\n", pipe_kind_names[st->kind], st->bus, st->node,
+				strerror(errno));
+		}
+	}
+
+	if (st->out != NULL) {
+		if ((fd = open(st->out, O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0) {
+			fprintf(stderr, "cannot open %s: %s\n", st->out, strerror(errno));
+			_exit(127);
+		}
+		dup2(fd, STDOUT_FILENO);
+		close(fd);
+	}
+	if (pc->log[0] != '\0') {
+		snprintf(path, sizeof(path), "%s/%s.%s.log", pc->log, pipe_kind_names[st->kind], st->bus);
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644)) >= 0) {
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+	}
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	if (pc->bin[0] != '\0') {
+		execv(cmd->path, cmd->argv);
+	} else {
+		execvp(cmd->path, cmd->argv);
+	}
+	fprintf(stderr, "cannot run %s: %s\n", cmd->path, strerror(errno));
+	_exit(127);
+}
+
+static int
+start(const struct pipe_conf *pc, struct proc *p)
+{
+	struct pipe_cmd cmd;
+	pid_t pid;
+
+	if (pipe_command(pc, p->st, &cmd) != 0) {
+		return -1;
+	}
+	if ((pid = fork()) < 0) {
+		fprintf(stderr, "fork failed: %s\n", strerror(errno));
+		return -1;
+	}
+	if (pid == 0) {
+		exec_stage(pc, p->st, &cmd);
+	}
+
+	p->pid = pid;
+	p->started = time(NULL);
+	p->restart = 0;
+
+	return 0;
+}
+
+/* the receiver heartbeats the bus, a reader started before fails */
+static void
+wait_bus(const char *name)
+{
+	uint64_t deadline = mono_ns() + BUS_START_SEC * 1000000000ULL;
+	tick_bus_t bus;
+	int alive;
+
+	while (running && mono_ns() < deadline) {
+		if (bus_open(&bus, name, 0) == 0) {
+			alive = bus_alive(&bus, BUS_ALIVE_NS);
+			bus_close(&bus);
+			if (alive) {
+				return;
+			}
+		}
+		usleep(100000);
+	}
+	fprintf(stderr, "bus %s is not alive, its readers start anyway\n", name);
+}
+
+/* a stage of the side, readers or receivers, and of the bus, NULL for any */
+static int
+of_side(const struct proc *p, int recv, const char *bus)
+{
+	return (p->st->kind == PIPE_RECV) == recv && (bus == NULL || strcmp(p->st->bus, bus) == 0);
+}
+
+/* stop the stages of one side, killing the late ones */
+static void
+stop(struct proc *procs, size_t n, int recv, const char *bus)
+{
+	time_t deadline = time(NULL) + STOP_SEC;
+	size_t i, left;
+	int status;
+
+	for (i = 0; i < n; i++) {
+		if (procs[i].pid > 0 && of_side(&procs[i], recv, bus)) {
+			kill(procs[i].pid, SIGTERM);
+		}
+	}
+	do {
+		left = 0;
+		for (i = 0; i < n; i++) {
+			if (procs[i].pid > 0 && of_side(&procs[i], recv, bus)) {
+				if (waitpid(procs[i].pid, &status, WNOHANG) == procs[i].pid) {
+					procs[i].pid = 0;
+				} else if (time(NULL) >= deadline) {
+					kill(procs[i].pid, SIGKILL);
+					waitpid(procs[i].pid, &status, 0);
+					procs[i].pid = 0;
+				} else {
+					left++;
+				}
+			}
+		}
+		if (left > 0) {
+			usleep(100000);
+		}
+	} while (left > 0);
+}
+
+/*
+ * the readers of a bus its receiver made again still map the old one, they
+ * start again once the new one is alive
+ */
+static void
+restart_readers(const struct pipe_conf *pc, struct proc *procs, size_t n, const char *bus)
+{
+	size_t i;
+
+	stop(procs, n, 0, bus);
+	wait_bus(bus);
+	for (i = 0; i < n && running; i++) {
+		if (of_side(&procs[i], 0, bus) && start(pc, &procs[i]) != 0) {
+			procs[i].restart = time(NULL) + RESTART_MIN;
+		}
+	}
+}
+
+/* a stage that died starts again, later each time unless it ran a while */
+static void
+reap(struct proc *procs, size_t n)
+{
+	time_t now = time(NULL);
+	pid_t pid;
+	size_t i;
+	int status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for (i = 0; i < n && procs[i].pid != pid; i++)
+			;
+		if (i == n) {
+			continue;
+		}
+		procs[i].pid = 0;
+		procs[i].backoff = now - procs[i].started >= RESTART_MAX || procs[i].backoff == 0 ? RESTART_MIN
+				   : (procs[i].backoff * 2 < RESTART_MAX ? procs[i].backoff * 2 : RESTART_MAX);
+		procs[i].restart = now + procs[i].backoff;
+		fprintf(stderr, "%s %s %s %d, again in %ds\n", pipe_kind_names[procs[i].st->kind], procs[i].st->bus,
+			WIFSIGNALED(status) ? "killed by signal" : "exited with",
+			WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status), procs[i].backoff);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct pipe_conf pc;
+	struct pipe_cmd cmd;
+	struct proc *procs;
+	const char *path = NULL, *host = NULL;
+	char hostname[256];
+	size_t i, n = 0;
+	time_t now;
+	int dry = 0, opt, pass;
+
+	while ((opt = getopt(argc, argv, "f:H:n")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'H':
+			host = optarg;
+			break;
+		case 'n':
+			dry = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (path == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (host == NULL) {
+		if (gethostname(hostname, sizeof(hostname)) != 0) {
+			fprintf(stderr, "cannot get the host name\n");
+			return 1;
+		}
+		hostname[sizeof(hostname) - 1] = '\0';
+		host = hostname;
+	}
+
+	if (pipe_load(&pc, path) != 0) {
+		return 1;
+	}
+	if (pipe_select(&pc, host) == 0) {
+		fprintf(stderr, "no stage of %s in %s\n", host, path);
+		pipe_free(&pc);
+		return 1;
+	}
+	if (pipe_place(&pc) != 0 || (procs = calloc(pc.nstages, sizeof(*procs))) == NULL) {
+		pipe_free(&pc);
+		return 1;
+	}
+
+	/* the receivers first */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < pc.nstages; i++) {
+			if (pc.stages[i].mine && (pc.stages[i].kind == PIPE_RECV) == (pass == 0)) {
+				procs[n++].st = &pc.stages[i];
+			}
+		}
+	}
+
+	if (dry) {
+		for (i = 0; i < n; i++) {
+			if (pipe_command(&pc, procs[i].st, &cmd) == 0) {
+				print_stage(procs[i].st, &cmd);
+			}
+		}
+		free(procs);
+		pipe_free(&pc);
+		return 0;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	for (i = 0; i < n && running; i++) {
+		if (procs[i].st->kind != PIPE_RECV) {
+			wait_bus(procs[i].st->bus);
+		}
+		if (pipe_command(&pc, procs[i].st, &cmd) == 0) {
+			print_stage(procs[i].st, &cmd);
+		}
+		if (start(&pc, &procs[i]) != 0) {
+			procs[i].restart = time(NULL) + RESTART_MIN;
+		}
+	}
+
+	while (running) {
+		reap(procs, n);
+		now = time(NULL);
+		for (i = 0; i < n && running; i++) {
+			if (procs[i].pid != 0 || procs[i].restart == 0 || now < procs[i].restart) {
+				continue;
+			}
+			if (start(&pc, &procs[i]) != 0) {
+				procs[i].restart = now + RESTART_MAX;
+			} else if (procs[i].st->kind == PIPE_RECV) {
+				restart_readers(&pc, procs, n, procs[i].st->bus);
+			}
+		}
+		usleep(100000);
+	}
+
+	stop(procs, n, 0, NULL);
+	stop(procs, n, 1, NULL);
+
+	free(procs);
+	pipe_free(&pc);
+
+	return 0;
+}
@@ -0,0 +1,393 @@
+/*
+ * batch.c
+ *
+ * The functions are used to crawl a manifest of URL and output file pairs in
+ * one process. The transfers run concurrently on one curl multi handle, which
+ * keeps the connections to each host open and reuses them, multiplexing the
+ * requests over HTTP/2 where the server speaks it. A failed transfer is
+ * retried with exponential backoff.
+ *
+ * Copyright(C) by Jupiter Fund 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include "crawl_daily.h"
+
+#define MANIFEST_LINE	8192
+#define POLL_MS		1000
+
+enum job_state {
+	JOB_PENDING = 0,
+	JOB_RUNNING,
+	JOB_DONE,
+	JOB_FAILED,
+};
+
+struct job
+{
+	char *url;
+	char *dst;
+	char tmp[4096];
+	FILE *fp;
+	size_t size;
+	int state;
+	int tries;
+	uint64_t next_at;	/* ms, earliest start of a retry */
+};
+
+struct batch
+{
+	const struct batch_conf *conf;
+	struct job *jobs;
+	size_t njobs;
+	size_t next;		/* first job never started */
+	struct job **retry;	/* jobs waiting for their backoff */
+	size_t nretry;
+	CURL **easy;		/* idle handles, reused with their connections */
+	int nidle;
+	int active;
+	size_t done;
+	size_t failed;
+	uint64_t bytes;
+};
+
+static uint64_t
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static size_t
+write_data(void *ptr, size_t size, size_t nmemb, void *data_job)
+{
+	struct job *job = (struct job *)data_job;
+	size_t total = size * nmemb;
+
+	if (save_write(job->fp, (const uint8_t *)ptr, total) != 0) {
+		return 0;
+	}
+	job->size += total;
+
+	return total;
+}
+
+static int
+cmp_dst(const void *a, const void *b)
+{
+	return strcmp((*(const struct job *const *)a)->dst, (*(const struct job *const *)b)->dst);
+}
+
+/*
+ * unique_dst - every job writes a file of its own. Two jobs of one output
+ * would race for the temporary file and the rename, so it is refused.
+ */
+static int
+unique_dst(struct batch *b)
+{
+	struct job **by_dst;
+	size_t i;
+	int ret = 0;
+
+	if (b->njobs < 2) {
+		return 0;
+	}
+	if ((by_dst = malloc(b->njobs * sizeof(*by_dst))) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < b->njobs; i++) {
+		by_dst[i] = &b->jobs[i];
+	}
+	qsort(by_dst, b->njobs, sizeof(*by_dst), cmp_dst);
+	for (i = 1; i < b->njobs; i++) {
+		if (strcmp(by_dst[i - 1]->dst, by_dst[i]->dst) == 0) {
+			fprintf(stderr, "output file %s given twice, of %s and %s\n", by_dst[i]->dst,
+				by_dst[i - 1]->url, by_dst[i]->url);
+			ret = -1;
+		}
+	}
+	free(by_dst);
+
+	return ret;
+}
+
+/*
+ * read_manifest - one "URL out_file" pair per line, blank lines and lines
+ * starting with # are skipped. Every out_file must be given once.
+ */
+static int
+read_manifest(struct batch *b, const char *path)
+{
+	char line[MANIFEST_LINE];
+	size_t cap = 0;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open manifest %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *save = NULL, *url, *dst;
+
+		if ((url = strtok_r(line, " \t\r\n", &save)) == NULL || url[0] == '#') {
+			continue;
+		}
+		if ((dst = strtok_r(NULL, " \t\r\n", &save)) == NULL) {
+			fprintf(stderr, "no output file for %s\n", url);
+			continue;
+		}
+
+		if (b->njobs == cap) {
+			void *p;
+
+			cap = cap ? cap * 2 : 1024;
+			if ((p = realloc(b->jobs, cap * sizeof(*b->jobs))) == NULL) {
+				fclose(fp);
+				return -1;
+			}
+			b->jobs = p;
+		}
+
+		memset(&b->jobs[b->njobs], 0, sizeof(b->jobs[0]));
+		b->jobs[b->njobs].url = strdup(url);
+		b->jobs[b->njobs].dst = strdup(dst);
+		if (b->jobs[b->njobs].url == NULL || b->jobs[b->njobs].dst == NULL) {
+			fclose(fp);
+			return -1;
+		}
+		b->njobs++;
+	}
+	fclose(fp);
+
+	return unique_dst(b);
+}
+
+static CURL *
+new_easy(const struct batch_conf *conf)
+{
+	CURL *curl = curl_easy_init();
+
+	if (curl == NULL) {
+		return NULL;
+	}
+
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "fetch_daily_bar/1.0");
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)conf->timeout);
+	/* HTTP/2 over TLS if the server offers it, and wait to multiplex on a live connection */
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+	return curl;
+}
+
+static int
+start_job(struct batch *b, CURLM *multi, struct job *job)
+{
+	CURL *curl;
+
+	if ((job->fp = save_open(job->dst, job->tmp, sizeof(job->tmp))) == NULL) {
+		job->state = JOB_FAILED;
+		b->failed++;
+		return -1;
+	}
+
+	curl = b->easy[--b->nidle];
+	curl_easy_setopt(curl, CURLOPT_URL, job->url);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, job);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, job);
+
+	job->size = 0;
+	job->state = JOB_RUNNING;
+	job->tries++;
+	curl_multi_add_handle(multi, curl);
+	b->active++;
+
+	return 0;
+}
+
+/*
+ * next_job - a retry whose backoff passed, else a job never started; the
+ * retries go first so a flaky host does not wait behind the whole manifest.
+ */
+static struct job *
+next_job(struct batch *b, uint64_t now)
+{
+	size_t i;
+
+	for (i = 0; i < b->nretry; i++) {
+		struct job *job = b->retry[i];
+
+		if (job->next_at <= now) {
+			b->retry[i] = b->retry[--b->nretry];
+			return job;
+		}
+	}
+
+	return b->next < b->njobs ? &b->jobs[b->next++] : NULL;
+}
+
+static int
+retriable(CURLcode res, long status)
+{
+	if (res == CURLE_HTTP_RETURNED_ERROR) {
+		return status == 429 || status >= 500;
+	}
+
+	return res == CURLE_COULDNT_CONNECT || res == CURLE_COULDNT_RESOLVE_HOST ||
+	       res == CURLE_OPERATION_TIMEDOUT || res == CURLE_RECV_ERROR ||
+	       res == CURLE_SEND_ERROR || res == CURLE_GOT_NOTHING ||
+	       res == CURLE_PARTIAL_FILE || res == CURLE_SSL_CONNECT_ERROR ||
+	       res == CURLE_HTTP2 || res == CURLE_HTTP2_STREAM;
+}
+
+static void
+finish_job(struct batch *b, CURLM *multi, CURL *curl, CURLcode res)
+{
+	const struct batch_conf *conf = b->conf;
+	struct job *job = NULL;
+	long status = 0;
+
+	curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&job);
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+	curl_multi_remove_handle(multi, curl);
+	b->easy[b->nidle++] = curl;
+	b->active--;
+
+	/* an empty body is fetched all the same, as by crawl_one */
+	if (res == CURLE_OK) {
+		if (save_close(job->fp, job->tmp, job->dst, 1) == 0) {
+			job->state = JOB_DONE;
+			b->done++;
+			b->bytes += job->size;
+			return;
+		}
+		res = CURLE_WRITE_ERROR;
+	} else {
+		save_close(job->fp, job->tmp, job->dst, 0);
+	}
+	job->fp = NULL;
+
+	if (retriable(res, status) && job->tries <= conf->retries) {
+		/* exponential backoff with jitter, so the retries of one host spread out */
+		uint64_t delay = (uint64_t)conf->backoff_ms << (job->tries - 1);
+
+		delay += (uint64_t)rand() % (delay / 2 + 1);
+		job->next_at = now_ms() + delay;
+		job->state = JOB_PENDING;
+		b->retry[b->nretry++] = job;
+		fprintf(stderr, "%s: %s (%ld), retry %d in %lums\n", job->url,
+			curl_easy_strerror(res), status, job->tries, delay);
+		return;
+	}
+
+	fprintf(stderr, "%s: %s (%ld), given up\n", job->url, curl_easy_strerror(res), status);
+	job->state = JOB_FAILED;
+	b->failed++;
+}
+
+int
+crawl_batch(const char *manifest, const struct batch_conf *conf)
+{
+	struct batch b;
+	CURLM *multi = NULL;
+	CURLMsg *msg;
+	uint64_t start = now_ms(), now;
+	int running, left, i, ret = -1;
+	size_t k;
+
+	memset(&b, 0, sizeof(b));
+	b.conf = conf;
+
+	/* the jitter of the retries differs from one crawler to another */
+	srand((unsigned int)getpid() ^ (unsigned int)time(NULL));
+
+	if (conf->concurrency <= 0 || read_manifest(&b, manifest) != 0) {
+		goto out;
+	}
+
+	b.retry = calloc(b.njobs ? b.njobs : 1, sizeof(*b.retry));
+	b.easy = calloc((size_t)conf->concurrency, sizeof(*b.easy));
+	if (b.retry == NULL || b.easy == NULL || (multi = curl_multi_init()) == NULL) {
+		goto out;
+	}
+
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)conf->concurrency);
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)conf->host_connections);
+	curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)conf->concurrency);
+
+	for (i = 0; i < conf->concurrency; i++) {
+		if ((b.easy[i] = new_easy(conf)) == NULL) {
+			goto cleanup;
+		}
+		b.nidle++;
+	}
+
+	while (b.done + b.failed < b.njobs) {
+		struct job *job;
+		int timeout = POLL_MS;
+
+		now = now_ms();
+		while (b.nidle > 0 && (job = next_job(&b, now)) != NULL) {
+			start_job(&b, multi, job);
+		}
+
+		curl_multi_perform(multi, &running);
+		while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+			if (msg->msg == CURLMSG_DONE) {
+				finish_job(&b, multi, msg->easy_handle, msg->data.result);
+			}
+		}
+
+		if (b.done + b.failed >= b.njobs) {
+			break;
+		}
+
+		/* sleep until a transfer has data or the earliest retry is due */
+		for (k = 0; k < b.nretry; k++) {
+			int64_t wait = (int64_t)b.retry[k]->next_at - (int64_t)now_ms();
+
+			if (wait < timeout) {
+				timeout = wait > 0 ? (int)wait : 0;
+			}
+		}
+		if (b.active > 0 || timeout > 0) {
+			curl_multi_poll(multi, NULL, 0, timeout, NULL);
+		}
+	}
+
+	fprintf(stderr, "%zu fetched, %zu failed, %lu bytes in %.1fs\n", b.done, b.failed,
+		b.bytes, (double)(now_ms() - start) / 1000.0);
+	ret = b.failed == 0 ? 0 : 1;
+
+cleanup:
+	for (i = 0; i < conf->concurrency && b.easy[i] != NULL; i++) {
+		curl_easy_cleanup(b.easy[i]);
+	}
+	curl_multi_cleanup(multi);
+
+out:
+	for (k = 0; k < b.njobs; k++) {
+		free(b.jobs[k].url);
+		free(b.jobs[k].dst);
+	}
+	free(b.jobs);
+	free(b.retry);
+	free(b.easy);
+
+	return ret;
+}
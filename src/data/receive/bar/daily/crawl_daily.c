@@ -2,29 +2,98 @@
  * crawl_daily.c
  *
  * The main function is used to crawl the daily bar data from exchange.
- * 
+ *
+ *	crawl_daily <URL> <out_file>
+ *	crawl_daily -m manifest [-j concurrency] [-c per_host] [-r retries]
+ *
  * Copyright(C) by Jupiter Fund 2025-
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <getopt.h>
 #include <curl/curl.h>
 #include "crawl_daily.h"
 
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s <URL> <out_file>\n"
+		"       %s -m manifest [-j concurrency] [-c per_host] [-r retries] [-b backoff_ms] [-t timeout]\n"
+		"  -m manifest  file of \"URL out_file\" lines, fetched in one process\n"
+		"  -j N         transfers at the same time (default 16)\n"
+		"  -c N         connections to one host (default 4)\n"
+		"  -r N         retries of a failed transfer (default 5)\n"
+		"  -b ms        first retry delay, doubled every retry (default 1000)\n"
+		"  -t seconds   timeout of one transfer (default 600)\n",
+		prog, prog);
+}
+
+static int
+crawl_one(const char *url, const char *dst_fn)
+{
+	char tmp_fn[4096];
+	size_t data_sz = 0;
+	FILE *fp;
+
+	/* the response is streamed into the file, whatever its size */
+	if ((fp = save_open(dst_fn, tmp_fn, sizeof(tmp_fn))) == NULL) {
+		fprintf(stderr, "save failed\n");
+		return 4;
+	}
+
+	/* an empty body is a fetch all the same, it is up to the reader what it means */
+	if (fetch_url(url, fp, &data_sz) != 0) {
+		fprintf(stderr, "fetch_url() failed\n");
+		save_close(fp, tmp_fn, dst_fn, 0);
+		return 3;
+	}
+
+	if (save_close(fp, tmp_fn, dst_fn, 1) != 0) {
+		fprintf(stderr, "save failed\n");
+		return 4;
+	}
+
+	return 0;
+}
+
 int
 main(int argc, char *argv[])
 {
-	size_t data_sz = 0;
-	if (argc != 3) {
-		fprintf(stderr, "Usage: %s <URL> <out_file>\n", argv[0]);
-		return 1;
+	struct batch_conf conf = { 16, 4, 5, 1000, 600 };
+	const char *manifest = NULL;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "m:j:c:r:b:t:")) != -1) {
+		switch (opt) {
+		case 'm':
+			manifest = optarg;
+			break;
+		case 'j':
+			conf.concurrency = atoi(optarg);
+			break;
+		case 'c':
+			conf.host_connections = atoi(optarg);
+			break;
+		case 'r':
+			conf.retries = atoi(optarg);
+			break;
+		case 'b':
+			conf.backoff_ms = atoi(optarg);
+			break;
+		case 't':
+			conf.timeout = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
 	}
 
-	/* allocate 8MB data. */
-	uint8_t *data = (uint8_t *)malloc(8 * 1024 * 1024);
-	if (data == NULL) {
-		fprintf(stderr, "malloc() failed\n");
+	if ((manifest == NULL && argc - optind != 2) || (manifest != NULL && optind != argc)) {
+		usage(argv[0]);
 		return 1;
 	}
 
@@ -33,21 +102,13 @@ main(int argc, char *argv[])
 		return 2;
 	}
 
-	if ((data_sz = fetch_url(argv[1], data, 1024 * 1024)) == 0) {
-		fprintf(stderr, "fetch_url() failed\n");
-		destroy();
-
-		return 3;
-	}
-
-	if (save(data, data_sz, argv[2]) != 0) {
-		fprintf(stderr, "save failed\n");
-		destroy();
-
-		return 4;
+	if (manifest != NULL) {
+		ret = crawl_batch(manifest, &conf) == 0 ? 0 : 5;
+	} else {
+		ret = crawl_one(argv[optind], argv[optind + 1]);
 	}
 
 	destroy();
 
-	return 0;
+	return ret;
 }
@@ -16,9 +16,36 @@
 int initialize(void);
 void destroy(void);
 
-size_t fetch_url(const char *url, uint8_t *data, size_t len);
+/*
+ * fetch_url - stream the body of the URL into the file as it arrives, so the
+ * memory stays flat whatever the size; the bytes written are in *size.
+ */
+int fetch_url(const char *url, FILE *fp, size_t *size);
+
+/*
+ * save_open/save_close - the output is written to a temporary file next to
+ * dst_fn and renamed over it only when complete, so a failed fetch never
+ * leaves a truncated file behind. tmp_fn holds the temporary name.
+ */
+FILE *save_open(const char *dst_fn, char *tmp_fn, size_t len);
+int save_write(FILE *fp, const uint8_t *data, size_t size);
+int save_close(FILE *fp, const char *tmp_fn, const char *dst_fn, int commit);
 
 int save(uint8_t *data, size_t size, const char *dst_fn);
 
-#endif		/* __CRAWL_DAILY_H__ */
+struct batch_conf
+{
+	int concurrency;	/* transfers at the same time */
+	int host_connections;	/* connections to one host, 0 for no limit */
+	int retries;		/* retries of a failed transfer */
+	int backoff_ms;		/* first retry delay, doubled for every retry */
+	int timeout;		/* seconds of one transfer, 0 for none */
+};
 
+/*
+ * crawl_batch - fetch every "URL out_file" pair of the manifest in one
+ * process; returns 0 if all were fetched.
+ */
+int crawl_batch(const char *manifest, const struct batch_conf *conf);
+
+#endif		/* __CRAWL_DAILY_H__ */
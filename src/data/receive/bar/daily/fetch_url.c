@@ -2,7 +2,10 @@
  * fetch_url.c
  *
  * The function is used to fetch the specific URL with libcurl. It is called by the main function.
- * 
+ *
+ * The body is written through to the output file chunk by chunk as libcurl
+ * hands it over, nothing is buffered but the chunk libcurl already holds.
+ *
  * Copyright(C) by Jupiter Fund 2025-
  */
 
@@ -11,58 +14,65 @@
 #include <string.h>
 #include <curl/curl.h>
 #include <assert.h>
+#include "crawl_daily.h"
 
-struct memory_chunk {
-	uint8_t *data;
-	size_t size;
+struct write_sink {
+	FILE *fp;
+	size_t size;		/* bytes written so far */
 };
 
-static size_t 
-write_data(void *ptr, size_t size, size_t nmemb, void *data_chunk)
+static size_t
+write_data(void *ptr, size_t size, size_t nmemb, void *data_sink)
 {
 	size_t total = size * nmemb;
-	struct memory_chunk *chunk = (struct memory_chunk *)data_chunk;
-
-	if (chunk->size < total) {
-		fprintf(stderr, "data buffer is too small\n");
+	struct write_sink *sink = (struct write_sink *)data_sink;
 
-		chunk->size = 0;
+	/* returning less than total makes libcurl abort with CURLE_WRITE_ERROR */
+	if (save_write(sink->fp, (const uint8_t *)ptr, total) != 0) {
 		return 0;
 	}
 
-	memcpy(chunk->data, ptr, total);
-	chunk->size = total;
+	sink->size += total;
 
 	return total;
 }
 
-size_t
-fetch_url(const char *url, uint8_t *data, size_t size)
+int
+fetch_url(const char *url, FILE *fp, size_t *size)
 {
 	CURL *curl;
 	CURLcode res;
-	struct memory_chunk chunk;
+	struct write_sink sink;
 
 	assert(url != NULL);
-	assert(data != NULL);
+	assert(fp != NULL);
+
+	sink.fp = fp;
+	sink.size = 0;
+	*size = 0;
 
-	chunk.data = data;
-	chunk.size = size;
-	
 	curl = curl_easy_init();
-	if (curl) {
-		curl_easy_setopt(curl, CURLOPT_URL, url);
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, &chunk);
-		curl_easy_setopt(curl, CURLOPT_USERAGENT, "fetch_daily_bar/1.0");
-		res = curl_easy_perform(curl);
+	if (curl == NULL) {
+		fprintf(stderr, "curl_easy_init() failed\n");
+		return -1;
+	}
 
-		if (res != CURLE_OK) {
-			fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-			return 0;
-		}
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "fetch_daily_bar/1.0");
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	/* an error page of the exchange is not data */
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	res = curl_easy_perform(curl);
+	curl_easy_cleanup(curl);
+
+	if (res != CURLE_OK) {
+		fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+		return -2;
 	}
-	
-	return chunk.size;
-}
 
+	*size = sink.size;
+
+	return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * norm_daily.c
+ *
+ * The program normalizes the daily bar files of an exchange, as crawl_daily
+ * saves them, straight into the columnar bar store: one file per product,
+ * sorted, merged with the history already there with -a. It replaces the
+ * chain of the *2csv.py scripts, sort_data.py and merge_year.py, each of
+ * which read all of the data again.
+ *
+ *	norm_daily -e shfe -o store -a -j 8 raw/shfe/2025.xls
+ *	norm_daily -e cffex -o store -a -I instruments.jins raw/cffex/202503.zip
+ *
+ * The files are parsed in parallel, then the products are written in
+ * parallel.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "norm_daily.h"
+#include "colstore.h"
+#include "instrument.h"
+#include "parse.h"
+
+#define THREADS_MAX	64
+#define DAY_CLOSE_SEC	(15 * 3600)
+
+struct worker
+{
+	pthread_t tid;
+	const struct norm_exchange *ex;
+	struct norm_bar *bars;
+	size_t nbars;
+	size_t cap;
+	uint64_t files;
+	uint64_t failed;
+};
+
+/* a bar of a product, to group the bars of all the workers by product */
+struct item
+{
+	char product[COL_NAME_LEN];
+	const struct norm_bar *bar;
+};
+
+struct job
+{
+	const char *exchange;
+	const char *root;
+	int append;
+	struct item *items;
+	size_t *first;			/* items of product k are [first[k], first[k + 1]) */
+	size_t nproducts;
+	_Atomic size_t next;
+	_Atomic int failed;
+};
+
+static char **files;
+static size_t nfiles;
+static _Atomic size_t next_file;
+
+static int
+on_row(const struct norm_field *f, int n, struct norm_ctx *ctx, void *arg)
+{
+	struct worker *w = arg;
+	struct norm_bar *bar;
+
+	if (w->nbars == w->cap) {
+		void *p;
+
+		w->cap = w->cap ? w->cap * 2 : 65536;
+		if ((p = realloc(w->bars, w->cap * sizeof(*w->bars))) == NULL) {
+			return -1;
+		}
+		w->bars = p;
+	}
+
+	bar = &w->bars[w->nbars];
+	memset(bar, 0, sizeof(*bar));
+	if (w->ex->bar(f, n, ctx, bar) == 1) {
+		w->nbars++;
+	}
+
+	return 0;
+}
+
+static int
+parse_file(struct worker *w, const char *path)
+{
+	struct norm_ctx ctx;
+	struct stat st;
+	const uint8_t *buf;
+	void *p;
+	int fd, ret;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "cannot map %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.name = path;
+	ctx.file_day = norm_file_day(path);
+
+	buf = p;
+	if (st.st_size >= 8 && memcmp(buf, "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1", 8) == 0) {
+		ret = norm_xls(buf, (size_t)st.st_size, &ctx, on_row, w);
+	} else if (st.st_size >= 4 && memcmp(buf, "PK\x03\x04", 4) == 0) {
+		ret = norm_zip(buf, (size_t)st.st_size, w->ex->delim, &ctx, on_row, w);
+	} else {
+		ret = norm_text((const char *)buf, (size_t)st.st_size, w->ex->delim, &ctx, on_row, w);
+	}
+	munmap(p, (size_t)st.st_size);
+
+	return ret;
+}
+
+static void *
+parse_files(void *arg)
+{
+	struct worker *w = arg;
+	size_t i;
+
+	while ((i = atomic_fetch_add(&next_file, 1)) < nfiles) {
+		if (parse_file(w, files[i]) != 0) {
+			fprintf(stderr, "%s: failed\n", files[i]);
+			w->failed++;
+		}
+		w->files++;
+	}
+
+	return NULL;
+}
+
+static int
+cmp_item(const void *a, const void *b)
+{
+	/* the writer sorts the rows of a product */
+	return strcmp(((const struct item *)a)->product, ((const struct item *)b)->product);
+}
+
+static int
+write_product(struct job *job, size_t k)
+{
+	const struct item *it = &job->items[job->first[k]];
+	size_t n = job->first[k + 1] - job->first[k], i;
+	char path[4096];
+	struct col_row row;
+	col_writer_t *w;
+	int ret = -1;
+
+	if (col_path(path, sizeof(path), job->root, job->exchange, it->product, BAR_T_DAY) != 0 ||
+	    (w = col_writer_create(job->exchange, it->product, BAR_T_DAY)) == NULL) {
+		return -1;
+	}
+
+	/* the history there already, the bars of the same day replaced by the new */
+	if (job->append && access(path, F_OK) == 0 && col_writer_load(w, path) != 0) {
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		const struct norm_bar *b = it[i].bar;
+
+		memset(&row, 0, sizeof(row));
+		row.timestamp = (int64_t)cn_timestamp((uint32_t)b->day, DAY_CLOSE_SEC, 0);
+		row.trading_day = b->day;
+		row.symbol = b->symbol;
+		row.open = b->open;
+		row.high = b->high;
+		row.low = b->low;
+		row.close = b->close;
+		row.volume = b->volume;
+		row.oi = b->oi;
+		row.amount = b->amount;
+		if (col_writer_add(w, &row) != 0) {
+			goto out;
+		}
+	}
+
+	ret = col_writer_write(w, path);
+
+out:
+	col_writer_free(w);
+	if (ret != 0) {
+		fprintf(stderr, "cannot write %s\n", path);
+	}
+
+	return ret;
+}
+
+static void *
+write_products(void *arg)
+{
+	struct job *job = arg;
+	size_t k;
+
+	while ((k = atomic_fetch_add(&job->next, 1)) < job->nproducts) {
+		if (write_product(job, k) != 0) {
+			atomic_store(&job->failed, 1);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * add_instruments - the contracts of the bars to the instrument master; the
+ * product is parsed once, here. The runs of the exchanges share the master,
+ * each takes the lock of <master>.lock, the file itself is replaced.
+ */
+static int
+add_instruments(const char *path, const char *exchange, const struct item *items, size_t n)
+{
+	char lock[4096];
+	struct ins_spec spec;
+	ins_builder_t *b;
+	size_t i;
+	int ret = -1, fd;
+
+	snprintf(lock, sizeof(lock), "%s.lock", path);
+	if ((fd = open(lock, O_RDWR | O_CREAT, 0644)) < 0 || flock(fd, LOCK_EX) != 0) {
+		fprintf(stderr, "cannot lock %s: %s\n", lock, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	if ((b = ins_builder_create()) == NULL) {
+		close(fd);
+		return -1;
+	}
+	if (ins_builder_load(b, path) < -1) {
+		fprintf(stderr, "cannot load %s\n", path);
+		goto out;
+	}
+
+	memset(&spec, 0, sizeof(spec));
+	spec.exchange = ins_exchange_parse(exchange);
+	for (i = 0; i < n; i++) {
+		spec.symbol = items[i].bar->symbol;
+		spec.product = items[i].product;
+		if (ins_builder_add(b, &spec) == 0) {
+			goto out;
+		}
+	}
+	ret = ins_builder_write(b, path);
+
+out:
+	ins_builder_free(b);
+	close(fd);
+
+	return ret;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -e exchange -o root [-a] [-j threads] [-I master] file ...\n"
+		"  -e exchange  shfe, ine, dce, czce, cffex or gfex\n"
+		"  -o root      directory of the store\n"
+		"  -a           merge into the files of the store instead of replacing them\n"
+		"  -j threads   files parsed at the same time (default the cores)\n"
+		"  -I master    add the contracts to the instrument master\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static struct worker workers[THREADS_MAX];
+	const struct norm_exchange *ex = NULL;
+	const char *root = NULL, *master = NULL;
+	char dir[4096];
+	struct item *items = NULL;
+	struct job job;
+	size_t nitems = 0, i, k;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	int nthreads = ncpu > 0 ? (int)ncpu : 1, append = 0, opt, t, ret = 1;
+	uint64_t failed = 0;
+
+	while ((opt = getopt(argc, argv, "e:o:aj:I:")) != -1) {
+		switch (opt) {
+		case 'e':
+			if ((ex = norm_exchange(optarg)) == NULL) {
+				fprintf(stderr, "unknown exchange %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			root = optarg;
+			break;
+		case 'a':
+			append = 1;
+			break;
+		case 'j':
+			nthreads = atoi(optarg);
+			break;
+		case 'I':
+			master = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (ex == NULL || root == NULL || optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (nthreads < 1) {
+		nthreads = 1;
+	}
+	if (nthreads > THREADS_MAX) {
+		nthreads = THREADS_MAX;
+	}
+
+	snprintf(dir, sizeof(dir), "%s/%s", root, ex->name);
+	if ((mkdir(root, 0755) != 0 && errno != EEXIST) || (mkdir(dir, 0755) != 0 && errno != EEXIST)) {
+		fprintf(stderr, "cannot make the store directory %s\n", dir);
+		return 1;
+	}
+
+	files = argv + optind;
+	nfiles = (size_t)(argc - optind);
+	if ((size_t)nthreads > nfiles) {
+		nthreads = (int)nfiles;
+	}
+
+	for (t = 0; t < nthreads; t++) {
+		workers[t].ex = ex;
+		if (pthread_create(&workers[t].tid, NULL, parse_files, &workers[t]) != 0) {
+			fprintf(stderr, "cannot start a parser\n");
+			nthreads = t;
+			break;
+		}
+	}
+	for (t = 0; t < nthreads; t++) {
+		pthread_join(workers[t].tid, NULL);
+		nitems += workers[t].nbars;
+		failed += workers[t].failed;
+	}
+	if (failed > 0 || nthreads == 0) {
+		goto out;
+	}
+
+	if ((items = malloc((nitems ? nitems : 1) * sizeof(*items))) == NULL) {
+		goto out;
+	}
+	for (t = 0, k = 0; t < nthreads; t++) {
+		for (i = 0; i < workers[t].nbars; i++, k++) {
+			ins_product_code(items[k].product, sizeof(items[k].product), workers[t].bars[i].symbol);
+			items[k].bar = &workers[t].bars[i];
+		}
+	}
+	qsort(items, nitems, sizeof(*items), cmp_item);
+
+	memset(&job, 0, sizeof(job));
+	job.exchange = ex->name;
+	job.root = root;
+	job.append = append;
+	job.items = items;
+	if ((job.first = malloc((nitems + 1) * sizeof(*job.first))) == NULL) {
+		goto out;
+	}
+	for (i = 0; i < nitems; i++) {
+		if (i == 0 || strcmp(items[i].product, items[i - 1].product) != 0) {
+			job.first[job.nproducts++] = i;
+		}
+	}
+	job.first[job.nproducts] = nitems;
+
+	for (t = 0; t < nthreads && (size_t)t < job.nproducts; t++) {
+		if (pthread_create(&workers[t].tid, NULL, write_products, &job) != 0) {
+			break;
+		}
+	}
+	while (t-- > 0) {
+		pthread_join(workers[t].tid, NULL);
+	}
+	if (job.failed || atomic_load(&job.next) < job.nproducts) {
+		free(job.first);
+		goto out;
+	}
+	free(job.first);
+
+	if (master != NULL && add_instruments(master, ex->name, items, nitems) != 0) {
+		goto out;
+	}
+
+	fprintf(stderr, "%zu files, %zu bars, %zu products\n", nfiles, nitems, job.nproducts);
+	ret = 0;
+
+out:
+	free(items);
+	for (t = 0; t < THREADS_MAX; t++) {
+		free(workers[t].bars);
+	}
+
+	return ret;
+}
@@ -0,0 +1,132 @@
+/*
+ * norm_daily.h
+ *
+ * The file contains the definitions and the functions' prototype for
+ * normalizing the daily bar files of the exchanges, as the crawler saves
+ * them, into the columnar bar store.
+ *
+ * Every format is read into rows of fields by one reader, the xls workbooks
+ * of SHFE and DCE, the text files of CZCE, CFFEX and GFEX, and the zip files
+ * CFFEX publishes them in. The parser of an exchange maps the fields of a
+ * row to a bar with the number and date tokenizer all of them share.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __NORM_DAILY_H__
+#define __NORM_DAILY_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define NORM_FIELDS_MAX	64
+#define NORM_SYMBOL_LEN	32
+
+enum norm_type {
+	NORM_EMPTY = 0,
+	NORM_STR,
+	NORM_NUM,
+};
+
+/*
+ * norm_field - a field of a row; a string points into the file or into the
+ * strings of the workbook and is not NUL terminated.
+ */
+struct norm_field
+{
+	int type;
+	uint32_t len;
+	const char *s;
+	double num;
+};
+
+/*
+ * norm_bar - a daily bar of a contract as the parsers give it.
+ */
+struct norm_bar
+{
+	char symbol[NORM_SYMBOL_LEN];
+	int32_t day;			/* trading day, YYYYMMDD */
+	double open;
+	double high;
+	double low;
+	double close;
+	int64_t volume;
+	int64_t oi;
+	double amount;
+};
+
+/*
+ * norm_ctx - the state of the file being parsed.
+ */
+struct norm_ctx
+{
+	const char *name;		/* file, or entry of a zip file */
+	int32_t file_day;		/* day of the file name, 0 if none */
+	uint64_t row;			/* row in the file, from 0 */
+	char last[NORM_SYMBOL_LEN];	/* contract of the row before */
+};
+
+/*
+ * norm_row_fn - called for every row of a file, returns -1 to stop.
+ */
+typedef int (*norm_row_fn)(const struct norm_field *f, int n, struct norm_ctx *ctx, void *arg);
+
+/*
+ * norm_exchange - the parser of an exchange; the reader of a file is chosen
+ * by its content, xls, zip or text.
+ */
+struct norm_exchange
+{
+	const char *name;
+	char delim;			/* of the text files */
+
+	/* the bar of a row, 1 if it is one, 0 if the row is not a bar */
+	int (*bar)(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar);
+};
+
+/*
+ * norm_exchange - the parser of the exchange, NULL if there is none.
+ */
+const struct norm_exchange *norm_exchange(const char *name);
+
+/*
+ * norm_num - the number of a field, with blanks and thousands separators;
+ * *ok is 0 for an empty field or one that is not a number.
+ */
+double norm_num(const struct norm_field *f, int *ok);
+
+/*
+ * norm_day - the YYYYMMDD day of a field, of 20250303, 2025-03-03 or
+ * 2025/03/03, or of an Excel date serial; 0 if none.
+ */
+int32_t norm_day(const struct norm_field *f);
+
+/*
+ * norm_str - copy a text field without the blanks; returns the length.
+ */
+size_t norm_str(const struct norm_field *f, char *dst, size_t len);
+
+/*
+ * norm_file_day - the day the file name starts with, e.g. 20250303_1.csv.
+ */
+int32_t norm_file_day(const char *name);
+
+/*
+ * norm_text - split the lines of a text into rows.
+ */
+int norm_text(const char *buf, size_t len, char delim, struct norm_ctx *ctx, norm_row_fn fn, void *arg);
+
+/*
+ * norm_xls - the rows of the first sheet of an xls (BIFF8) workbook.
+ */
+int norm_xls(const uint8_t *buf, size_t len, struct norm_ctx *ctx, norm_row_fn fn, void *arg);
+
+/*
+ * norm_zip - the rows of every text entry of a zip file; the name and the
+ * day of ctx are those of the entry.
+ */
+int norm_zip(const uint8_t *buf, size_t len, char delim, struct norm_ctx *ctx, norm_row_fn fn, void *arg);
+
+#endif		/* __NORM_DAILY_H__ */
@@ -0,0 +1,207 @@
+/*
+ * norm_exchange.c
+ *
+ * The functions are used to map the rows of the daily bar files of every
+ * exchange to bars, in the columns the *2csv.py scripts of data/clean read.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "norm_daily.h"
+
+/* columns of a bar in a row, -1 if the file has none; the store keeps no settlement */
+struct layout
+{
+	int day;
+	int contract;
+	int open;
+	int high;
+	int low;
+	int close;
+	int volume;
+	int oi;
+	int amount;
+};
+
+/*
+ * SHFE and INE (xls): contract, day, pre_close, pre_settlement, open, high,
+ * low, close, settlement, change1, change2, volume, amount, open_interest;
+ * the contract is only in the first row of its rows.
+ */
+static const struct layout shfe = { 1, 0, 4, 5, 6, 7, 11, 13, 12 };
+
+/*
+ * DCE (xls): no1, no2, contract, day, pre_close, pre_settlement, open, high,
+ * low, close, settlement, change1, change2, volume, amount, open_interest.
+ */
+static const struct layout dce = { 3, 2, 6, 7, 8, 9, 13, 15, 14 };
+
+/*
+ * CZCE (|): day, contract, pre_settlement, open, high, low, close,
+ * settlement, change1, change2, volume, open_interest, delta, amount,
+ * delivery; the year of the contract has one digit.
+ */
+static const struct layout czce = { 0, 1, 3, 4, 5, 6, 10, 11, 13 };
+
+/*
+ * CFFEX (,): contract, open, high, low, volume, amount, open_interest,
+ * oi_change, close, settlement, pre_settlement, change1, change2, delta;
+ * the day is that of the file name.
+ */
+static const struct layout cffex = { -1, 0, 1, 2, 3, 8, 4, 6, 5 };
+
+/*
+ * GFEX (,): day, product_cn, delivery_month, contract, pre_settlement,
+ * open, high, low, close, settlement, change1, change2, volume,
+ * open_interest, oi_change, amount.
+ */
+static const struct layout gfex = { 0, 3, 5, 6, 7, 8, 12, 13, 15 };
+
+static double
+num(const struct norm_field *f, int n, int i)
+{
+	int ok;
+
+	return i >= 0 && i < n ? norm_num(&f[i], &ok) : 0;
+}
+
+/*
+ * contract - the contract of the field, letters then digits, with the
+ * options' dashes; the subtotal rows have none.
+ */
+static int
+contract(const struct norm_field *f, char *dst, size_t len)
+{
+	size_t n = norm_str(f, dst, len), i;
+
+	if (n == 0 || !isalpha((unsigned char)dst[0])) {
+		return 0;
+	}
+	for (i = 1; i < n; i++) {
+		if (!isalnum((unsigned char)dst[i]) && dst[i] != '-') {
+			return 0;
+		}
+	}
+
+	return isdigit((unsigned char)dst[n - 1]) ? 1 : 0;
+}
+
+static int
+map(const struct layout *l, const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	if (l->contract >= n || !contract(&f[l->contract], bar->symbol, sizeof(bar->symbol))) {
+		return 0;
+	}
+
+	bar->day = l->day >= 0 ? (l->day < n ? norm_day(&f[l->day]) : 0) : ctx->file_day;
+	if (bar->day == 0) {
+		return 0;
+	}
+
+	bar->open = num(f, n, l->open);
+	bar->high = num(f, n, l->high);
+	bar->low = num(f, n, l->low);
+	bar->close = num(f, n, l->close);
+	bar->volume = (int64_t)num(f, n, l->volume);
+	bar->oi = (int64_t)num(f, n, l->oi);
+	bar->amount = num(f, n, l->amount);
+
+	return 1;
+}
+
+static int
+shfe_bar(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	struct norm_field g[NORM_FIELDS_MAX];
+
+	if (n > 0 && f[0].type != NORM_EMPTY) {
+		norm_str(&f[0], ctx->last, sizeof(ctx->last));
+		return map(&shfe, f, n, ctx, bar);
+	}
+
+	/* the rows after the first of a contract leave it blank */
+	if (n == 0 || ctx->last[0] == '\0') {
+		return 0;
+	}
+	memcpy(g, f, (size_t)n * sizeof(*f));
+	g[0].type = NORM_STR;
+	g[0].s = ctx->last;
+	g[0].len = (uint32_t)strlen(ctx->last);
+
+	return map(&shfe, g, n, ctx, bar);
+}
+
+static int
+dce_bar(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	return map(&dce, f, n, ctx, bar);
+}
+
+/*
+ * czce_bar - SR505 of 2025 is SR2505: the tens of the year go before the
+ * digits, and one more when the contract would then be before the day.
+ */
+static int
+czce_bar(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	size_t i, len;
+	int y;
+
+	if (!map(&czce, f, n, ctx, bar)) {
+		return 0;
+	}
+
+	len = strlen(bar->symbol);
+	for (i = 0; i < len && isalpha((unsigned char)bar->symbol[i]); i++)
+		;
+	if (len - i != 3 || len + 2 > sizeof(bar->symbol) || !isdigit((unsigned char)bar->symbol[i + 2])) {
+		return 1;
+	}
+
+	y = (bar->day / 100000) % 10;
+	if ((bar->day / 100) % 10000 > y * 1000 + atoi(bar->symbol + i)) {
+		y = (y + 1) % 10;
+	}
+	memmove(bar->symbol + i + 1, bar->symbol + i, len - i + 1);
+	bar->symbol[i] = (char)('0' + y);
+
+	return 1;
+}
+
+static int
+cffex_bar(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	return map(&cffex, f, n, ctx, bar);
+}
+
+static int
+gfex_bar(const struct norm_field *f, int n, struct norm_ctx *ctx, struct norm_bar *bar)
+{
+	return map(&gfex, f, n, ctx, bar);
+}
+
+static const struct norm_exchange exchanges[] = {
+	{ "shfe", ',', shfe_bar },
+	{ "ine", ',', shfe_bar },
+	{ "dce", ',', dce_bar },
+	{ "czce", '|', czce_bar },
+	{ "cffex", ',', cffex_bar },
+	{ "gfex", ',', gfex_bar },
+};
+
+const struct norm_exchange *
+norm_exchange(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(exchanges) / sizeof(exchanges[0]); i++) {
+		if (strcasecmp(name, exchanges[i].name) == 0) {
+			return &exchanges[i];
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,217 @@
+/*
+ * norm_token.c
+ *
+ * The functions are used to tokenize the numbers and the dates of the daily
+ * bar files and to split their text into rows, for the parsers of all the
+ * exchanges.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include "norm_daily.h"
+#include "parse.h"
+
+#define EXCEL_EPOCH	(-25569)	/* days from 1970-01-01 to 1899-12-30 */
+#define EXCEL_MAX	2958465		/* 9999-12-31 */
+
+static inline int
+is_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '"' || c == '\r';
+}
+
+static inline int32_t
+valid_day(int64_t v)
+{
+	uint32_t m = (uint32_t)(v / 100) % 100, d = (uint32_t)v % 100;
+
+	return v >= 19000101 && v <= 99991231 && m >= 1 && m <= 12 && d >= 1 && d <= 31 ? (int32_t)v : 0;
+}
+
+double
+norm_num(const struct norm_field *f, int *ok)
+{
+	const char *p = f->s, *end = f->s + f->len;
+	int64_t v = 0;
+	int neg = 0, frac = -1, ndigits = 0;
+
+	*ok = 0;
+	if (f->type == NORM_NUM) {
+		*ok = 1;
+		return f->num;
+	}
+	if (f->type != NORM_STR) {
+		return 0;
+	}
+
+	while (p < end && is_blank(*p)) {
+		p++;
+	}
+	if (p < end && (*p == '-' || *p == '+')) {
+		neg = *p++ == '-';
+	}
+
+	/* the digits with the separators of thousands skipped, in one integer */
+	for (; p < end; p++) {
+		if (*p >= '0' && *p <= '9') {
+			if (ndigits++ == 18) {
+				break;
+			}
+			v = v * 10 + (*p - '0');
+			if (frac >= 0) {
+				frac++;
+			}
+		} else if (*p == '.' && frac < 0) {
+			frac = 0;
+		} else if (*p != ',') {
+			break;
+		}
+	}
+	while (p < end && is_blank(*p)) {
+		p++;
+	}
+
+	/* too many digits or an exponent, strtod() sorts them out */
+	if (p < end && ndigits > 0) {
+		char buf[64], *e;
+		size_t n = 0;
+		double d;
+
+		for (p = f->s; p < end && n + 1 < sizeof(buf); p++) {
+			if (!is_blank(*p) && *p != ',') {
+				buf[n++] = *p;
+			}
+		}
+		buf[n] = '\0';
+		d = strtod(buf, &e);
+		*ok = e != buf && *e == '\0';
+		return *ok ? d : 0;
+	}
+
+	if (ndigits == 0) {
+		return 0;
+	}
+
+	*ok = 1;
+	return (neg ? -1.0 : 1.0) * (frac > 0 ? (double)v / (double)pow10_tab[frac] : (double)v);
+}
+
+int32_t
+norm_day(const struct norm_field *f)
+{
+	char digits[8];
+	const char *p, *end;
+	int64_t v;
+	int n = 0;
+
+	if (f->type == NORM_NUM) {
+		v = (int64_t)f->num;
+		if (v >= 19000101) {
+			return valid_day(v);
+		}
+		return v > 0 && v <= EXCEL_MAX ? (int32_t)civil_from_days(v + EXCEL_EPOCH) : 0;
+	}
+	if (f->type != NORM_STR) {
+		return 0;
+	}
+
+	for (p = f->s, end = f->s + f->len; p < end && is_blank(*p); p++)
+		;
+	for (; p < end && n < 8; p++) {
+		if (*p >= '0' && *p <= '9') {
+			digits[n++] = *p;
+		} else if (*p != '-' && *p != '/') {
+			break;
+		}
+	}
+	if (n != 8 || (p < end && *p >= '0' && *p <= '9')) {
+		return 0;
+	}
+
+	return valid_day(parse_8digits(digits));
+}
+
+size_t
+norm_str(const struct norm_field *f, char *dst, size_t len)
+{
+	size_t n = 0;
+	uint32_t i;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	if (f->type == NORM_STR) {
+		for (i = 0; i < f->len && n + 1 < len; i++) {
+			if (!is_blank(f->s[i])) {
+				dst[n++] = f->s[i];
+			}
+		}
+	} else if (f->type == NORM_NUM) {
+		n = (size_t)snprintf(dst, len, "%.15g", f->num);
+		n = n < len ? n : len - 1;
+	}
+	dst[n] = '\0';
+
+	return n;
+}
+
+int32_t
+norm_file_day(const char *name)
+{
+	struct norm_field f;
+	const char *base = strrchr(name, '/');
+
+	base = base != NULL ? base + 1 : name;
+	f.type = NORM_STR;
+	f.s = base;
+	f.len = (uint32_t)strcspn(base, "_.");
+	f.num = 0;
+
+	return norm_day(&f);
+}
+
+int
+norm_text(const char *buf, size_t len, char delim, struct norm_ctx *ctx, norm_row_fn fn, void *arg)
+{
+	struct norm_field fields[NORM_FIELDS_MAX];
+	const char *p = buf, *end = buf + len, *eol, *q, *next;
+	int n;
+
+	/* a BOM of UTF-8 before the first line */
+	if (len >= 3 && memcmp(p, "\xef\xbb\xbf", 3) == 0) {
+		p += 3;
+	}
+
+	for (; p < end; p = eol + 1, ctx->row++) {
+		if ((eol = memchr(p, '\n', (size_t)(end - p))) == NULL) {
+			eol = end;
+		}
+
+		n = 0;
+		for (q = p; n < NORM_FIELDS_MAX; q = next + 1) {
+			if ((next = memchr(q, delim, (size_t)(eol - q))) == NULL) {
+				next = eol;
+			}
+			fields[n].type = next > q ? NORM_STR : NORM_EMPTY;
+			fields[n].s = q;
+			fields[n].len = (uint32_t)(next - q);
+			fields[n].num = 0;
+			n++;
+			if (next == eol) {
+				break;
+			}
+		}
+
+		if (fn(fields, n, ctx, arg) != 0) {
+			return -1;
+		}
+		if (eol == end) {
+			break;
+		}
+	}
+
+	return 0;
+}
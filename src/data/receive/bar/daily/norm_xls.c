@@ -0,0 +1,751 @@
+/*
+ * norm_xls.c
+ *
+ * The functions are used to read the cells of the first sheet of an xls
+ * workbook, the format SHFE and DCE publish the daily bars in, without a
+ * spreadsheet library.
+ *
+ * An xls file is a compound file (CFB), a FAT file system in sectors, and
+ * the Workbook stream in it is a sequence of BIFF8 records: the globals with
+ * the shared strings (SST), then a substream of cell records per sheet. Only
+ * the cells holding values are read, the formatting is ignored.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <string.h>
+#include "norm_daily.h"
+
+#define CFB_SIGNATURE	"\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1"
+#define CFB_HDR_LEN	512
+#define CFB_DIFAT_HDR	109
+#define CFB_ENDOFCHAIN	0xfffffffeU
+#define CFB_DIR_LEN	128
+#define CFB_MINI_SHIFT	6
+#define CFB_STREAM	2
+
+#define BIFF_FORMULA	0x0006
+#define BIFF_EOF	0x000a
+#define BIFF_FILEPASS	0x002f
+#define BIFF_CONTINUE	0x003c
+#define BIFF_BOUNDSHEET	0x0085
+#define BIFF_MULRK	0x00bd
+#define BIFF_RSTRING	0x00d6
+#define BIFF_SST	0x00fc
+#define BIFF_LABELSST	0x00fd
+#define BIFF_NUMBER	0x0203
+#define BIFF_LABEL	0x0204
+#define BIFF_STRING	0x0207
+#define BIFF_RK		0x027e
+#define BIFF_BOF	0x0809
+
+#define SCRATCH_LEN	16384
+
+struct cfb
+{
+	const uint8_t *buf;
+	size_t len;
+	uint32_t shift;			/* of the sector size */
+	uint32_t *fat;
+	uint32_t nfat;			/* entries of the FAT */
+};
+
+/* the shared strings of the workbook, as UTF-8 in one pool */
+struct sst
+{
+	char *pool;
+	size_t len;
+	size_t cap;
+	uint32_t *off;
+	uint32_t *slen;
+	uint32_t n;
+};
+
+/* a reader of a record and the CONTINUE records after it */
+struct cont
+{
+	const uint8_t *wb;
+	size_t len;
+	size_t pos;
+	size_t end;			/* of the data of the record read */
+};
+
+/* the row of cells being read */
+struct row
+{
+	struct norm_field fields[NORM_FIELDS_MAX];
+	int n;				/* last column set + 1 */
+	uint32_t row;
+	char scratch[SCRATCH_LEN];	/* strings of LABEL and STRING cells */
+	size_t used;
+};
+
+static inline uint16_t
+rd16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t
+rd32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline double
+rd_double(const uint8_t *p)
+{
+	uint64_t v = (uint64_t)rd32(p) | (uint64_t)rd32(p + 4) << 32;
+	double d;
+
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+/*
+ * rk_double - the number of an RK value: an integer or the high 30 bits of
+ * a double, either divided by 100 if the low bit is set.
+ */
+static double
+rk_double(uint32_t rk)
+{
+	double d;
+
+	if (rk & 2) {
+		d = (double)((int32_t)rk >> 2);
+	} else {
+		uint64_t v = (uint64_t)(rk & 0xfffffffcU) << 32;
+
+		memcpy(&d, &v, sizeof(d));
+	}
+
+	return rk & 1 ? d / 100 : d;
+}
+
+static const uint8_t *
+sector(const struct cfb *c, uint32_t s)
+{
+	uint64_t off = ((uint64_t)s + 1) << c->shift;
+
+	return off + (1U << c->shift) <= c->len ? c->buf + off : NULL;
+}
+
+static int
+cfb_open(struct cfb *c, const uint8_t *buf, size_t len)
+{
+	uint32_t nfat_sectors, difat, ndifat, per, i, j, k = 0, di = 0;
+	const uint8_t *p, *dp = NULL;
+
+	memset(c, 0, sizeof(*c));
+	if (len < CFB_HDR_LEN || memcmp(buf, CFB_SIGNATURE, 8) != 0) {
+		return -1;
+	}
+
+	c->buf = buf;
+	c->len = len;
+	c->shift = rd16(buf + 0x1e);
+	if (c->shift != 9 && c->shift != 12) {
+		return -1;
+	}
+
+	nfat_sectors = rd32(buf + 0x2c);
+	difat = rd32(buf + 0x44);
+	ndifat = rd32(buf + 0x48);
+	per = (1U << c->shift) / 4;
+	if (nfat_sectors == 0 || nfat_sectors > (len >> c->shift)) {
+		return -1;
+	}
+	if ((c->fat = malloc((size_t)nfat_sectors * per * sizeof(*c->fat))) == NULL) {
+		return -1;
+	}
+
+	/* the FAT sectors are listed in the header, then in a chain of DIFAT sectors */
+	for (i = 0; i < nfat_sectors; i++) {
+		uint32_t s;
+
+		if (i < CFB_DIFAT_HDR) {
+			s = rd32(buf + 0x4c + i * 4);
+		} else {
+			if (dp == NULL || di == per - 1) {
+				if (k++ >= ndifat || (dp = sector(c, difat)) == NULL) {
+					goto fail;
+				}
+				difat = rd32(dp + (per - 1) * 4);
+				di = 0;
+			}
+			s = rd32(dp + di++ * 4);
+		}
+
+		if ((p = sector(c, s)) == NULL) {
+			goto fail;
+		}
+		for (j = 0; j < per; j++) {
+			c->fat[c->nfat++] = rd32(p + j * 4);
+		}
+	}
+
+	return 0;
+
+fail:
+	free(c->fat);
+	c->fat = NULL;
+	return -1;
+}
+
+/*
+ * chain_len - the sectors of the chain from s, 0 if it is broken.
+ */
+static uint32_t
+chain_len(const uint32_t *fat, uint32_t nfat, uint32_t s)
+{
+	uint32_t n = 0;
+
+	while (s != CFB_ENDOFCHAIN) {
+		if (s >= nfat || n++ > nfat) {
+			return 0;
+		}
+		s = fat[s];
+	}
+
+	return n;
+}
+
+/*
+ * chain_read - copy size bytes of the chain from s of the sectors of 1 <<
+ * shift bytes at base; the sector n is at base + (n << shift).
+ */
+static uint8_t *
+chain_read(const uint32_t *fat, uint32_t nfat, uint32_t s, uint64_t size,
+	   const uint8_t *base, uint64_t base_len, uint32_t shift)
+{
+	uint64_t got = 0, n, steps = 0;
+	uint8_t *out;
+
+	if ((out = malloc(size ? size : 1)) == NULL) {
+		return NULL;
+	}
+
+	while (got < size) {
+		uint64_t off = (uint64_t)s << shift;
+
+		if (s >= nfat || steps++ > nfat || off + (1U << shift) > base_len) {
+			/* the last sector of a stream may be cut at the end of the container */
+			if (s < nfat && off < base_len && off + (size - got) <= base_len) {
+				memcpy(out + got, base + off, size - got);
+				return out;
+			}
+			free(out);
+			return NULL;
+		}
+		n = size - got < (1U << shift) ? size - got : (1U << shift);
+		memcpy(out + got, base + off, n);
+		got += n;
+		s = fat[s];
+	}
+
+	return out;
+}
+
+static int
+name_is(const uint8_t *e, const char *name)
+{
+	size_t i, n = strlen(name);
+
+	if (rd16(e + 0x40) != (n + 1) * 2) {
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		if (rd16(e + i * 2) != (uint8_t)name[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * workbook - the Workbook stream of the compound file, copied; its length is
+ * in *len.
+ */
+static uint8_t *
+workbook(const uint8_t *buf, size_t blen, size_t *len)
+{
+	uint8_t *dir = NULL, *wb = NULL, *mini = NULL, *minifat = NULL;
+	uint32_t ndir, i, start, cutoff;
+	const uint8_t *e;
+	struct cfb c;
+	uint64_t size;
+
+	if (cfb_open(&c, buf, blen) != 0) {
+		return NULL;
+	}
+
+	/* the sectors are counted from the one after the header */
+	ndir = chain_len(c.fat, c.nfat, rd32(buf + 0x30));
+	if (ndir == 0 || (dir = chain_read(c.fat, c.nfat, rd32(buf + 0x30), (uint64_t)ndir << c.shift,
+					   buf + (1U << c.shift), blen - (1U << c.shift), c.shift)) == NULL) {
+		goto out;
+	}
+
+	for (i = 0; i < ((uint64_t)ndir << c.shift) / CFB_DIR_LEN; i++) {
+		e = dir + (size_t)i * CFB_DIR_LEN;
+		if (e[0x42] == CFB_STREAM && (name_is(e, "Workbook") || name_is(e, "Book"))) {
+			break;
+		}
+	}
+	if (i == ((uint64_t)ndir << c.shift) / CFB_DIR_LEN) {
+		goto out;
+	}
+
+	start = rd32(e + 0x74);
+	size = rd32(e + 0x78);
+	cutoff = rd32(buf + 0x38);
+
+	if (size >= cutoff) {
+		wb = chain_read(c.fat, c.nfat, start, size, buf + (1U << c.shift), blen - (1U << c.shift), c.shift);
+	} else {
+		/* a small stream is in mini sectors of the stream of the root entry */
+		uint32_t nminifat = chain_len(c.fat, c.nfat, rd32(buf + 0x3c));
+		uint64_t mini_len = rd32(dir + 0x78);
+
+		if (nminifat == 0 ||
+		    (minifat = chain_read(c.fat, c.nfat, rd32(buf + 0x3c), (uint64_t)nminifat << c.shift,
+					  buf + (1U << c.shift), blen - (1U << c.shift), c.shift)) == NULL ||
+		    (mini = chain_read(c.fat, c.nfat, rd32(dir + 0x74), mini_len,
+				       buf + (1U << c.shift), blen - (1U << c.shift), c.shift)) == NULL) {
+			goto out;
+		}
+		for (i = 0; i < ((uint64_t)nminifat << c.shift) / 4; i++) {
+			((uint32_t *)(void *)minifat)[i] = rd32(minifat + (size_t)i * 4);
+		}
+		wb = chain_read((const uint32_t *)(void *)minifat, (uint32_t)(((uint64_t)nminifat << c.shift) / 4),
+				start, size, mini, mini_len, CFB_MINI_SHIFT);
+	}
+	*len = (size_t)size;
+
+out:
+	free(minifat);
+	free(mini);
+	free(dir);
+	free(c.fat);
+
+	return wb;
+}
+
+static int
+sst_reserve(struct sst *t, size_t n)
+{
+	void *p;
+
+	if (t->len + n <= t->cap) {
+		return 0;
+	}
+	while (t->cap < t->len + n) {
+		t->cap = t->cap ? t->cap * 2 : 65536;
+	}
+	if ((p = realloc(t->pool, t->cap)) == NULL) {
+		return -1;
+	}
+	t->pool = p;
+
+	return 0;
+}
+
+/*
+ * put_utf8 - append a code unit of UTF-16 as UTF-8; a high surrogate waits
+ * in *hs for the low one.
+ */
+static size_t
+put_utf8(char *dst, uint32_t u, uint32_t *hs)
+{
+	if (u >= 0xd800 && u < 0xdc00) {
+		*hs = u;
+		return 0;
+	}
+	if (u >= 0xdc00 && u < 0xe000) {
+		if (*hs == 0) {
+			return 0;
+		}
+		u = 0x10000 + ((*hs - 0xd800) << 10) + (u - 0xdc00);
+	}
+	*hs = 0;
+
+	if (u < 0x80) {
+		dst[0] = (char)u;
+		return 1;
+	}
+	if (u < 0x800) {
+		dst[0] = (char)(0xc0 | u >> 6);
+		dst[1] = (char)(0x80 | (u & 0x3f));
+		return 2;
+	}
+	if (u < 0x10000) {
+		dst[0] = (char)(0xe0 | u >> 12);
+		dst[1] = (char)(0x80 | ((u >> 6) & 0x3f));
+		dst[2] = (char)(0x80 | (u & 0x3f));
+		return 3;
+	}
+	dst[0] = (char)(0xf0 | u >> 18);
+	dst[1] = (char)(0x80 | ((u >> 12) & 0x3f));
+	dst[2] = (char)(0x80 | ((u >> 6) & 0x3f));
+	dst[3] = (char)(0x80 | (u & 0x3f));
+	return 4;
+}
+
+static int
+cont_next(struct cont *r)
+{
+	if (r->end + 4 > r->len || rd16(r->wb + r->end) != BIFF_CONTINUE) {
+		return -1;
+	}
+	r->pos = r->end + 4;
+	r->end = r->pos + rd16(r->wb + r->end + 2);
+
+	return r->end <= r->len ? 0 : -1;
+}
+
+/*
+ * cont_bytes - read n bytes over the record boundaries, skip them if dst is
+ * NULL.
+ */
+static int
+cont_bytes(struct cont *r, uint8_t *dst, size_t n)
+{
+	size_t k;
+
+	while (n > 0) {
+		if (r->pos == r->end && cont_next(r) != 0) {
+			return -1;
+		}
+		k = n < r->end - r->pos ? n : r->end - r->pos;
+		if (dst != NULL) {
+			memcpy(dst, r->wb + r->pos, k);
+			dst += k;
+		}
+		r->pos += k;
+		n -= k;
+	}
+
+	return 0;
+}
+
+/*
+ * cont_chars - the characters of a string as UTF-8 into the pool; where a
+ * string goes on in a CONTINUE record, a byte of flags starts it and tells
+ * the width of the rest.
+ */
+static int
+cont_chars(struct cont *r, struct sst *t, uint32_t cch, int hi)
+{
+	uint32_t hs = 0, u;
+
+	if (sst_reserve(t, (size_t)cch * 3 + 4) != 0) {
+		return -1;
+	}
+
+	while (cch > 0) {
+		if (r->pos == r->end) {
+			if (cont_next(r) != 0 || r->pos == r->end) {
+				return -1;
+			}
+			hi = r->wb[r->pos++] & 1;
+			continue;
+		}
+		if (hi) {
+			if (r->end - r->pos < 2) {
+				return -1;
+			}
+			u = rd16(r->wb + r->pos);
+			r->pos += 2;
+		} else {
+			u = r->wb[r->pos++];
+		}
+		t->len += put_utf8(t->pool + t->len, u, &hs);
+		cch--;
+	}
+
+	return 0;
+}
+
+static int
+read_sst(struct sst *t, const uint8_t *wb, size_t len, size_t pos)
+{
+	struct cont r = { wb, len, pos + 4, pos + 4 + rd16(wb + pos + 2) };
+	uint8_t hdr[8], b[4];
+	uint32_t i, n, runs, ext;
+
+	if (cont_bytes(&r, hdr, 8) != 0) {
+		return -1;
+	}
+	n = rd32(hdr + 4);
+	if (n > len || (t->off = malloc((n ? n : 1) * sizeof(*t->off))) == NULL ||
+	    (t->slen = malloc((n ? n : 1) * sizeof(*t->slen))) == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		size_t start = t->len;
+		uint32_t cch;
+		uint8_t flags;
+
+		if (cont_bytes(&r, b, 3) != 0) {
+			return -1;
+		}
+		cch = rd16(b);
+		flags = b[2];
+		runs = 0;
+		ext = 0;
+		if (flags & 0x08) {
+			if (cont_bytes(&r, b, 2) != 0) {
+				return -1;
+			}
+			runs = rd16(b);
+		}
+		if (flags & 0x04) {
+			if (cont_bytes(&r, b, 4) != 0) {
+				return -1;
+			}
+			ext = rd32(b);
+		}
+		if (cont_chars(&r, t, cch, flags & 1) != 0 || cont_bytes(&r, NULL, (size_t)runs * 4 + ext) != 0) {
+			return -1;
+		}
+
+		t->off[i] = (uint32_t)start;
+		t->slen[i] = (uint32_t)(t->len - start);
+		t->n++;
+	}
+
+	return 0;
+}
+
+static int
+flush_row(struct row *rw, struct norm_ctx *ctx, norm_row_fn fn, void *arg)
+{
+	int i, ret = 0;
+
+	if (rw->n > 0) {
+		ctx->row = rw->row;
+		ret = fn(rw->fields, rw->n, ctx, arg);
+	}
+
+	for (i = 0; i < rw->n; i++) {
+		rw->fields[i].type = NORM_EMPTY;
+	}
+	rw->n = 0;
+	rw->used = 0;
+
+	return ret;
+}
+
+static struct norm_field *
+cell(struct row *rw, uint32_t row, uint32_t col, struct norm_ctx *ctx, norm_row_fn fn, void *arg, int *stop)
+{
+	if (row != rw->row) {
+		if (flush_row(rw, ctx, fn, arg) != 0) {
+			*stop = 1;
+		}
+		rw->row = row;
+	}
+	if (col >= NORM_FIELDS_MAX) {
+		return NULL;
+	}
+	if ((int)col >= rw->n) {
+		rw->n = (int)col + 1;
+	}
+
+	return &rw->fields[col];
+}
+
+/*
+ * label - a string of a LABEL or STRING record, cch, flags and characters,
+ * as UTF-8 into the scratch of the row.
+ */
+static void
+label(struct row *rw, struct norm_field *f, const uint8_t *p, size_t len)
+{
+	uint32_t cch, i, hs = 0;
+	size_t start = rw->used;
+	int hi;
+
+	if (len < 3) {
+		return;
+	}
+	cch = rd16(p);
+	hi = p[2] & 1;
+	p += 3;
+	len -= 3;
+	if ((size_t)cch * (hi ? 2 : 1) > len || rw->used + (size_t)cch * 3 + 4 > SCRATCH_LEN) {
+		return;
+	}
+
+	for (i = 0; i < cch; i++) {
+		uint32_t u = hi ? rd16(p + i * 2) : p[i];
+
+		rw->used += put_utf8(rw->scratch + rw->used, u, &hs);
+	}
+
+	f->type = NORM_STR;
+	f->s = rw->scratch + start;
+	f->len = (uint32_t)(rw->used - start);
+}
+
+static int
+read_sheet(const uint8_t *wb, size_t len, size_t pos, const struct sst *t,
+	   struct norm_ctx *ctx, norm_row_fn fn, void *arg)
+{
+	struct norm_field *f, *pending = NULL;
+	struct row *rw;
+	int depth = 0, stop = 0, ret = 0;
+	uint32_t i, n;
+
+	if ((rw = calloc(1, sizeof(*rw))) == NULL) {
+		return -1;
+	}
+
+	while (pos + 4 <= len && !stop) {
+		uint16_t type = rd16(wb + pos), rlen = rd16(wb + pos + 2);
+		const uint8_t *p = wb + pos + 4;
+
+		if (pos + 4 + rlen > len) {
+			break;
+		}
+		pos += 4 + (size_t)rlen;
+
+		if (type == BIFF_BOF) {
+			depth++;
+			continue;
+		}
+		if (type == BIFF_EOF) {
+			if (--depth <= 0) {
+				break;
+			}
+			continue;
+		}
+		if (depth != 1 || rlen < 6) {
+			continue;
+		}
+
+		switch (type) {
+		case BIFF_LABELSST:
+			if (rlen >= 10 && (f = cell(rw, rd16(p), rd16(p + 2), ctx, fn, arg, &stop)) != NULL &&
+			    (i = rd32(p + 6)) < t->n) {
+				f->type = NORM_STR;
+				f->s = t->pool + t->off[i];
+				f->len = t->slen[i];
+			}
+			break;
+		case BIFF_NUMBER:
+			if (rlen >= 14 && (f = cell(rw, rd16(p), rd16(p + 2), ctx, fn, arg, &stop)) != NULL) {
+				f->type = NORM_NUM;
+				f->num = rd_double(p + 6);
+			}
+			break;
+		case BIFF_RK:
+			if (rlen >= 10 && (f = cell(rw, rd16(p), rd16(p + 2), ctx, fn, arg, &stop)) != NULL) {
+				f->type = NORM_NUM;
+				f->num = rk_double(rd32(p + 6));
+			}
+			break;
+		case BIFF_MULRK:
+			n = (uint32_t)(rlen - 6) / 6;
+			for (i = 0; i < n; i++) {
+				if ((f = cell(rw, rd16(p), rd16(p + 2) + i, ctx, fn, arg, &stop)) != NULL) {
+					f->type = NORM_NUM;
+					f->num = rk_double(rd32(p + 4 + i * 6 + 2));
+				}
+			}
+			break;
+		case BIFF_LABEL:
+		case BIFF_RSTRING:
+			if ((f = cell(rw, rd16(p), rd16(p + 2), ctx, fn, arg, &stop)) != NULL) {
+				label(rw, f, p + 6, rlen - 6);
+			}
+			break;
+		case BIFF_FORMULA:
+			/* the cached result, a number unless its top bytes are all set */
+			if (rlen >= 14 && (f = cell(rw, rd16(p), rd16(p + 2), ctx, fn, arg, &stop)) != NULL) {
+				if (rd16(p + 12) != 0xffff) {
+					f->type = NORM_NUM;
+					f->num = rd_double(p + 6);
+				} else if (p[6] == 0) {
+					pending = f;
+				}
+			}
+			break;
+		case BIFF_STRING:
+			if (pending != NULL) {
+				label(rw, pending, p, rlen);
+			}
+			break;
+		}
+		if (type != BIFF_FORMULA) {
+			pending = NULL;
+		}
+	}
+
+	if (stop || flush_row(rw, ctx, fn, arg) != 0) {
+		ret = -1;
+	}
+	free(rw);
+
+	return ret;
+}
+
+int
+norm_xls(const uint8_t *buf, size_t len, struct norm_ctx *ctx, norm_row_fn fn, void *arg)
+{
+	struct sst t;
+	size_t wlen = 0, pos = 0, sheet = 0;
+	uint8_t *wb;
+	int ret = -1;
+
+	memset(&t, 0, sizeof(t));
+
+	if ((wb = workbook(buf, len, &wlen)) == NULL) {
+		fprintf(stderr, "%s is not an xls workbook\n", ctx->name);
+		return -1;
+	}
+
+	/* the globals: the strings and where the first worksheet is */
+	while (pos + 4 <= wlen) {
+		uint16_t type = rd16(wb + pos), rlen = rd16(wb + pos + 2);
+
+		if (pos + 4 + rlen > wlen) {
+			break;
+		}
+		if (type == BIFF_FILEPASS) {
+			fprintf(stderr, "%s is encrypted\n", ctx->name);
+			goto out;
+		}
+		if (type == BIFF_SST && t.n == 0 && read_sst(&t, wb, wlen, pos) != 0) {
+			fprintf(stderr, "%s has broken shared strings\n", ctx->name);
+			goto out;
+		}
+		if (type == BIFF_BOUNDSHEET && sheet == 0 && rlen >= 6 && wb[pos + 4 + 5] == 0) {
+			sheet = rd32(wb + pos + 4);
+		}
+		pos += 4 + (size_t)rlen;
+		if (type == BIFF_EOF) {
+			break;
+		}
+	}
+
+	if (sheet == 0) {
+		sheet = pos;
+	}
+	if (sheet + 4 > wlen || rd16(wb + sheet) != BIFF_BOF) {
+		fprintf(stderr, "%s has no worksheet\n", ctx->name);
+		goto out;
+	}
+
+	ret = read_sheet(wb, wlen, sheet, &t, ctx, fn, arg);
+
+out:
+	free(t.slen);
+	free(t.off);
+	free(t.pool);
+	free(wb);
+
+	return ret;
+}
@@ -0,0 +1,158 @@
+/*
+ * norm_zip.c
+ *
+ * The function is used to read the text entries of a zip file, as CFFEX
+ * publishes its daily bars, inflating one entry at a time.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include "norm_daily.h"
+
+#define ZIP_EOCD	0x06054b50U
+#define ZIP_CENTRAL	0x02014b50U
+#define ZIP_LOCAL	0x04034b50U
+#define ZIP_EOCD_LEN	22
+#define ZIP_COMMENT_MAX	65535
+#define ZIP_STORED	0
+#define ZIP_DEFLATED	8
+
+static inline uint16_t
+rd16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t
+rd32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int
+is_text(const char *name, size_t len)
+{
+	return len > 4 && (strncasecmp(name + len - 4, ".csv", 4) == 0 || strncasecmp(name + len - 4, ".txt", 4) == 0);
+}
+
+static uint8_t *
+inflate_entry(const uint8_t *src, size_t clen, size_t ulen)
+{
+	z_stream z;
+	uint8_t *out;
+	int rc;
+
+	if ((out = malloc(ulen ? ulen : 1)) == NULL) {
+		return NULL;
+	}
+
+	memset(&z, 0, sizeof(z));
+	if (inflateInit2(&z, -MAX_WBITS) != Z_OK) {
+		free(out);
+		return NULL;
+	}
+	z.next_in = (Bytef *)(uintptr_t)src;
+	z.avail_in = (uInt)clen;
+	z.next_out = out;
+	z.avail_out = (uInt)ulen;
+	rc = inflate(&z, Z_FINISH);
+	inflateEnd(&z);
+
+	if (rc != Z_STREAM_END || z.total_out != ulen) {
+		free(out);
+		return NULL;
+	}
+
+	return out;
+}
+
+int
+norm_zip(const uint8_t *buf, size_t len, char delim, struct norm_ctx *ctx, norm_row_fn fn, void *arg)
+{
+	const char *zip_name = ctx->name;
+	int32_t zip_day = ctx->file_day;
+	char name[256];
+	size_t pos, eocd, cd, n, i;
+	int ret = 0;
+
+	if (len < ZIP_EOCD_LEN) {
+		return -1;
+	}
+
+	/* the end of the central directory is before the comment of the file */
+	for (eocd = len - ZIP_EOCD_LEN;; eocd--) {
+		if (rd32(buf + eocd) == ZIP_EOCD) {
+			break;
+		}
+		if (eocd == 0 || len - eocd > ZIP_EOCD_LEN + ZIP_COMMENT_MAX) {
+			fprintf(stderr, "%s is not a zip file\n", zip_name);
+			return -1;
+		}
+	}
+
+	n = rd16(buf + eocd + 10);
+	cd = rd32(buf + eocd + 16);
+
+	for (i = 0, pos = cd; i < n && ret == 0; i++) {
+		uint32_t method, clen, ulen, off, nlen, data_off;
+		const uint8_t *data;
+		uint8_t *text;
+
+		if (pos + 46 > len || rd32(buf + pos) != ZIP_CENTRAL) {
+			fprintf(stderr, "%s has a broken central directory\n", zip_name);
+			return -1;
+		}
+		method = rd16(buf + pos + 10);
+		clen = rd32(buf + pos + 20);
+		ulen = rd32(buf + pos + 24);
+		nlen = rd16(buf + pos + 28);
+		off = rd32(buf + pos + 42);
+		if (pos + 46 + nlen > len) {
+			return -1;
+		}
+		snprintf(name, sizeof(name), "%.*s", (int)nlen, (const char *)buf + pos + 46);
+		pos += 46 + nlen + rd16(buf + pos + 30) + rd16(buf + pos + 32);
+
+		if (!is_text(name, strlen(name))) {
+			continue;
+		}
+
+		if ((uint64_t)off + 30 > len || rd32(buf + off) != ZIP_LOCAL) {
+			fprintf(stderr, "%s: broken entry %s\n", zip_name, name);
+			ret = -1;
+			break;
+		}
+		data_off = off + 30 + rd16(buf + off + 26) + rd16(buf + off + 28);
+		if ((uint64_t)data_off + clen > len) {
+			ret = -1;
+			break;
+		}
+		data = buf + data_off;
+
+		if (method == ZIP_STORED && clen == ulen) {
+			text = NULL;
+		} else if (method != ZIP_DEFLATED || (text = inflate_entry(data, clen, ulen)) == NULL) {
+			fprintf(stderr, "%s: cannot inflate %s\n", zip_name, name);
+			ret = -1;
+			break;
+		}
+
+		ctx->name = name;
+		ctx->file_day = norm_file_day(name);
+		if (ctx->file_day == 0) {
+			ctx->file_day = zip_day;
+		}
+		ctx->row = 0;
+		ctx->last[0] = '\0';
+		ret = norm_text(text != NULL ? (const char *)text : (const char *)data, ulen, delim, ctx, fn, arg);
+		free(text);
+	}
+
+	ctx->name = zip_name;
+	ctx->file_day = zip_day;
+
+	return ret;
+}
@@ -5,33 +5,87 @@
  *
  * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
  */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include "crawl_daily.h"
 
+FILE *
+save_open(const char *dst_fn, char *tmp_fn, size_t len)
+{
+	FILE *fp;
+
+	if (dst_fn == NULL || tmp_fn == NULL) {
+		return NULL;
+	}
+
+	if (snprintf(tmp_fn, len, "%s.part.%d", dst_fn, (int)getpid()) >= (int)len) {
+		return NULL;
+	}
+
+	if ((fp = fopen(tmp_fn, "wb")) == NULL) {
+		fprintf(stderr, "fopen(%s) failed: %s\n", tmp_fn, strerror(errno));
+	}
+
+	return fp;
+}
+
+int
+save_write(FILE *fp, const uint8_t *data, size_t size)
+{
+	/* fwrite() counts items, one item per byte so a short write is seen */
+	if (size > 0 && fwrite(data, 1, size, fp) != size) {
+		fprintf(stderr, "fwrite() failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+save_close(FILE *fp, const char *tmp_fn, const char *dst_fn, int commit)
+{
+	int ret = 0;
+
+	if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+		ret = -1;
+	}
+	if (fclose(fp) != 0) {
+		ret = -1;
+	}
+
+	if (commit && ret == 0 && rename(tmp_fn, dst_fn) != 0) {
+		fprintf(stderr, "rename(%s, %s) failed: %s\n", tmp_fn, dst_fn, strerror(errno));
+		ret = -2;
+	}
+
+	if (!commit || ret != 0) {
+		unlink(tmp_fn);
+	}
+
+	return ret;
+}
+
 int
 save(uint8_t *s_data, size_t s_len, const char *dst_fn)
 {
+	char tmp_fn[4096];
 	FILE *dst_fp = NULL;
-	int len = 0;
-	size_t out_len = 0;
 
 	if (dst_fn == NULL || s_data == NULL) {
 		return -1;
 	}
 
-	dst_fp = fopen(dst_fn, "w");
+	dst_fp = save_open(dst_fn, tmp_fn, sizeof(tmp_fn));
 	if (dst_fp == NULL) {
 		return -2;
 	}
 
-	while (out_len < s_len) {
-		len = fwrite(s_data + out_len, s_len - out_len, 1, dst_fp);
-		if (len < 0) {
-			break;
-		}
-
-		out_len += len;
+	if (save_write(dst_fp, s_data, s_len) != 0) {
+		save_close(dst_fp, tmp_fn, dst_fn, 0);
+		return -3;
 	}
 
-	return 0;
+	return save_close(dst_fp, tmp_fn, dst_fn, 1) == 0 ? 0 : -3;
 }
-
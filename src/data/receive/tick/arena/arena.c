@@ -0,0 +1,178 @@
+/*
+ * arena.c
+ *
+ * The functions are used to map the blocks of the arenas, to grow and reset
+ * them, and to carve the pools out of them.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+#define HDR_SIZE	((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+static struct arena_block *
+map_block(size_t size)
+{
+	struct arena_block *b;
+	int huge = 1;
+	void *p;
+
+	size = ALIGN_UP(size + HDR_SIZE, ARENA_BLOCK_MIN);
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p == MAP_FAILED) {
+		huge = 0;
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			fprintf(stderr, "cannot map an arena block of %lu bytes\n", (unsigned long)size);
+			return NULL;
+		}
+		madvise(p, size, MADV_HUGEPAGE);
+	}
+
+	/* prefault, and keep it in memory if the limits let us */
+	memset(p, 0, size);
+	mlock(p, size);
+
+	b = p;
+	b->size = size;
+	b->huge = huge;
+
+	return b;
+}
+
+static void
+use_block(arena_t *a, struct arena_block *b)
+{
+	b->next = a->blocks;
+	a->blocks = b;
+	a->cur = (uint8_t *)b + HDR_SIZE;
+	a->end = (uint8_t *)b + b->size;
+	a->stats.reserved += b->size;
+	a->stats.blocks++;
+	a->stats.huge += b->huge != 0;
+}
+
+int
+arena_init(arena_t *a, size_t size)
+{
+	struct arena_block *b;
+
+	memset(a, 0, sizeof(*a));
+	a->block_size = size > ARENA_BLOCK_MIN ? size : ARENA_BLOCK_MIN;
+	if ((b = map_block(a->block_size)) == NULL) {
+		return -1;
+	}
+	use_block(a, b);
+
+	return 0;
+}
+
+void
+arena_free(arena_t *a)
+{
+	struct arena_block *b, *next;
+
+	for (b = a->blocks; b != NULL; b = next) {
+		next = b->next;
+		munlock(b, b->size);
+		munmap(b, b->size);
+	}
+	memset(a, 0, sizeof(*a));
+}
+
+void *
+arena_grow(arena_t *a, size_t size)
+{
+	struct arena_block *b;
+	uint8_t *p;
+
+	/* the rest of the full block is left over until the reset */
+	size = ALIGN_UP(size, ARENA_ALIGN);
+	if ((b = map_block(size > a->block_size ? size : a->block_size)) == NULL) {
+		return NULL;
+	}
+	use_block(a, b);
+	a->stats.grows++;
+
+	p = a->cur;
+	a->cur += size;
+	a->stats.used += size;
+
+	return p;
+}
+
+int
+arena_reset(arena_t *a)
+{
+	struct arena_block *b, *old, *next;
+	size_t total;
+	uint64_t grows = a->stats.grows;
+
+	if (a->blocks == NULL) {
+		return 0;
+	}
+
+	/* one block of all of them, mapped now rather than in the next session */
+	if (a->blocks->next != NULL) {
+		total = a->stats.reserved;
+		if ((b = map_block(total)) == NULL) {
+			/* the blocks stay as they are, only the current one is used again */
+			a->cur = (uint8_t *)a->blocks + HDR_SIZE;
+			a->stats.used = 0;
+			return -1;
+		}
+		for (old = a->blocks; old != NULL; old = next) {
+			next = old->next;
+			munlock(old, old->size);
+			munmap(old, old->size);
+		}
+		memset(a, 0, sizeof(*a));
+		a->block_size = total;
+		use_block(a, b);
+		a->stats.grows = grows;
+		return 0;
+	}
+
+	b = a->blocks;
+	a->cur = (uint8_t *)b + HDR_SIZE;
+	a->stats.used = 0;
+
+	return 0;
+}
+
+int
+pool_init(pool_t *p, arena_t *a, size_t size, size_t count)
+{
+	uint8_t *objs;
+	size_t i;
+
+	memset(p, 0, sizeof(*p));
+	p->arena = a;
+	p->size = ALIGN_UP(size > sizeof(void *) ? size : sizeof(void *), ARENA_ALIGN);
+	if (count == 0) {
+		return 0;
+	}
+	if ((objs = arena_alloc(a, p->size * count)) == NULL) {
+		return -1;
+	}
+
+	/* in the order of the memory, the first object handed out first */
+	for (i = count; i-- > 0;) {
+		*(void **)(objs + i * p->size) = p->free;
+		p->free = objs + i * p->size;
+	}
+
+	return 0;
+}
+
+void
+arena_get_stats(const arena_t *a, struct arena_stats *st)
+{
+	*st = a->stats;
+}
@@ -0,0 +1,142 @@
+/*
+ * arena.h
+ *
+ * The file contains the definition of the arenas and the slab pools of the
+ * tick pipeline and the functions' prototype for taking memory from them.
+ *
+ * An arena is a few big blocks of memory on hugepages where the system has
+ * them, prefaulted and locked when it is made: objects are taken from it by
+ * moving a pointer, never freed one by one, and all of them go at once when
+ * the arena is reset, at the end of a session, or freed. A pool hands out
+ * objects of one size from an arena and takes them back on a free list, for
+ * the per-instrument state of the engines. So the engines get all their
+ * memory at startup, sized by the instruments they expect, and the data path
+ * neither calls malloc() nor takes page faults at the open.
+ *
+ * An arena and its pools belong to one thread, the one of the engine using
+ * them, so they have no locks.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARENA_ALIGN		64		/* every object is on its own cache lines */
+#define ARENA_BLOCK_MIN		(2UL << 20)	/* a hugepage */
+#define ARENA_INSTRUMENTS	1024		/* expected instruments of an engine by default */
+
+struct arena_block
+{
+	struct arena_block *next;
+	size_t size;			/* bytes of the mapping, this header included */
+	int huge;			/* on hugepages */
+};
+
+struct arena_stats
+{
+	uint64_t reserved;		/* bytes of the blocks */
+	uint64_t used;			/* bytes handed out since the last reset */
+	uint64_t blocks;
+	uint64_t grows;			/* blocks added after the first, i.e. on the data path */
+	uint64_t huge;			/* blocks on hugepages */
+};
+
+typedef struct arena
+{
+	uint8_t *cur;			/* next free byte of the current block */
+	uint8_t *end;
+	struct arena_block *blocks;	/* the current one first */
+	size_t block_size;		/* of the blocks added when one is full */
+	struct arena_stats stats;
+} arena_t;
+
+/*
+ * arena_init - an arena with a first block of size bytes at least.
+ */
+int arena_init(arena_t *a, size_t size);
+
+/*
+ * arena_free - unmap all the blocks; arena_reset() forgets every object and
+ * keeps the memory, the blocks added since the last reset merged into one
+ * big enough for all of them, so the next session needs no new block. It
+ * returns 0, -1 if the merged block cannot be mapped: the blocks are kept
+ * then and the objects forgotten all the same, the arena grows again.
+ */
+void arena_free(arena_t *a);
+int arena_reset(arena_t *a);
+
+/*
+ * arena_grow - the slow path of arena_alloc(), size bytes aligned the same in
+ * a new block.
+ */
+void *arena_grow(arena_t *a, size_t size);
+
+/*
+ * arena_alloc - size bytes, cache-line aligned; the memory is zero until
+ * the first reset, not after it. NULL only if a new block cannot be mapped.
+ */
+static inline void *
+arena_alloc(arena_t *a, size_t size)
+{
+	uint8_t *p = a->cur;
+
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if ((size_t)(a->end - p) < size) {
+		return arena_grow(a, size);
+	}
+	a->cur = p + size;
+	a->stats.used += size;
+
+	return p;
+}
+
+/*
+ * pool - objects of one size; pool_get() takes one back from the free list
+ * first, pool_put() returns it there.
+ */
+typedef struct pool
+{
+	arena_t *arena;
+	size_t size;			/* of an object, aligned */
+	void *free;			/* the first free object holds the next */
+	uint64_t live;			/* objects handed out */
+} pool_t;
+
+/*
+ * pool_init - a pool of objects of size bytes from the arena, count of them
+ * carved out now. After arena_reset() of the arena its pools are made again.
+ */
+int pool_init(pool_t *p, arena_t *a, size_t size, size_t count);
+
+static inline void *
+pool_get(pool_t *p)
+{
+	void *obj = p->free;
+
+	if (obj != NULL) {
+		p->free = *(void **)obj;
+	} else if ((obj = arena_alloc(p->arena, p->size)) == NULL) {
+		return NULL;
+	}
+	p->live++;
+
+	return obj;
+}
+
+static inline void
+pool_put(pool_t *p, void *obj)
+{
+	*(void **)obj = p->free;
+	p->free = obj;
+	p->live--;
+}
+
+void arena_get_stats(const arena_t *a, struct arena_stats *st);
+
+#endif		/* __ARENA_H__ */
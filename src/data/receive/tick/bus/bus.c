@@ -0,0 +1,328 @@
+/*
+ * bus.c
+ *
+ * The functions are used to create, map and read the shared memory tick bus.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bus.h"
+
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+#define PAGE_ALIGN	4096
+
+static uint64_t
+wall_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+shm_name(char *dst, size_t len, const char *name)
+{
+	if (name == NULL || strchr(name, '/') != NULL) {
+		return -1;
+	}
+
+	return snprintf(dst, len, "/jupiter_tick_%s", name) < (int)len ? 0 : -1;
+}
+
+int
+bus_create(tick_bus_t *bus, const char *name, uint64_t capacity, int md_type)
+{
+	struct bus_hdr *hdr;
+	uint64_t symbols_off, ring_off, snap_off, size;
+	char path[BUS_NAME_MAX + 16];
+	void *p;
+	int fd;
+
+	if (bus == NULL || shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+
+	symbols_off = ALIGN_UP(sizeof(struct bus_hdr), PAGE_ALIGN);
+	ring_off = ALIGN_UP(symbols_off + (uint64_t)TICK_INSTRUMENT_MAX * TICK_SYMBOL_LEN, PAGE_ALIGN);
+	snap_off = ALIGN_UP(ring_off + ring_mem_size(capacity, sizeof(tick_rec_t)), PAGE_ALIGN);
+	size = ALIGN_UP(snap_off + snap_mem_size(TICK_INSTRUMENT_MAX + 1), PAGE_ALIGN);
+
+	/* readers still mapping an old bus keep it until they reopen */
+	shm_unlink(path);
+	fd = shm_open(path, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "shm_open(%s) failed: %s\n", path, strerror(errno));
+		return -2;
+	}
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		fprintf(stderr, "ftruncate(%s) failed: %s\n", path, strerror(errno));
+		close(fd);
+		shm_unlink(path);
+		return -2;
+	}
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(path);
+		return -2;
+	}
+
+	hdr = (struct bus_hdr *)p;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version = BUS_VERSION;
+	hdr->size = size;
+	hdr->symbols_off = symbols_off;
+	hdr->ring_off = ring_off;
+	hdr->snap_off = snap_off;
+	hdr->created = wall_ns();
+	hdr->writer_pid = (uint32_t)getpid();
+	hdr->md_type = (uint32_t)md_type;
+
+	bus->ring = ring_init((uint8_t *)p + ring_off, capacity, sizeof(tick_rec_t), 0);
+	bus->snap = snap_init((uint8_t *)p + snap_off, TICK_INSTRUMENT_MAX + 1);
+	if (bus->ring == NULL || bus->snap == NULL) {
+		munmap(p, size);
+		shm_unlink(path);
+		return -1;
+	}
+
+	bus->hdr = hdr;
+	bus->size = size;
+	bus->writable = 1;
+	snprintf(bus->name, sizeof(bus->name), "%s", name);
+
+	tick_intern_share((char (*)[TICK_SYMBOL_LEN])((uint8_t *)p + symbols_off), &hdr->nsymbols);
+	bus_heartbeat(bus);
+
+	atomic_store_explicit((_Atomic uint32_t *)&hdr->magic, BUS_MAGIC, memory_order_release);
+
+	return 0;
+}
+
+int
+bus_open(tick_bus_t *bus, const char *name, int flags)
+{
+	char path[BUS_NAME_MAX + 16];
+	struct bus_hdr *hdr;
+	struct stat st;
+	int fd, rw = flags & BUS_O_RDWR;
+	void *p;
+
+	if (bus == NULL || shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+
+	fd = shm_open(path, rw ? O_RDWR : O_RDONLY, 0);
+	if (fd < 0) {
+		return -2;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct bus_hdr)) {
+		close(fd);
+		return -2;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, rw ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return -2;
+	}
+
+	hdr = (struct bus_hdr *)p;
+	if (atomic_load_explicit((_Atomic uint32_t *)&hdr->magic, memory_order_acquire) != BUS_MAGIC ||
+	    hdr->version != BUS_VERSION || hdr->size > (uint64_t)st.st_size) {
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	bus->ring = ring_attach((uint8_t *)p + hdr->ring_off, hdr->snap_off - hdr->ring_off);
+	bus->snap = snap_attach((uint8_t *)p + hdr->snap_off, hdr->size - hdr->snap_off);
+	if (bus->ring == NULL || bus->snap == NULL) {
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	bus->hdr = hdr;
+	bus->size = (size_t)st.st_size;
+	bus->writable = rw;
+	snprintf(bus->name, sizeof(bus->name), "%s", name);
+
+	return 0;
+}
+
+void
+bus_close(tick_bus_t *bus)
+{
+	if (bus == NULL || bus->hdr == NULL) {
+		return;
+	}
+
+	munmap(bus->hdr, bus->size);
+	bus->hdr = NULL;
+	bus->ring = NULL;
+	bus->snap = NULL;
+}
+
+int
+bus_unlink(const char *name)
+{
+	char path[BUS_NAME_MAX + 16];
+
+	if (shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+
+	return shm_unlink(path);
+}
+
+int
+bus_reader(tick_bus_t *bus, ring_reader_t *rd, int flags)
+{
+	int rflags = 0;
+
+	if (flags & BUS_R_GATING) {
+		if (!bus->writable) {
+			fprintf(stderr, "gating reader of bus %s needs BUS_O_RDWR\n", bus->name);
+			return -1;
+		}
+		rflags |= RING_R_GATING;
+	}
+
+	if (flags & BUS_R_REPLAY) {
+		rflags |= RING_R_OLDEST;
+	}
+
+	/* a read-only mapping cannot register its cursor in the ring */
+	if (!bus->writable) {
+		rflags |= RING_R_PRIVATE;
+	}
+
+	return ring_reader_init(rd, bus->ring, rflags);
+}
+
+const char *
+bus_symbol(const tick_bus_t *bus, uint32_t id)
+{
+	const struct bus_hdr *hdr = bus->hdr;
+
+	if (id == 0 || id > atomic_load_explicit(&hdr->nsymbols, memory_order_acquire)) {
+		return NULL;
+	}
+
+	return (const char *)hdr + hdr->symbols_off + (size_t)(id - 1) * TICK_SYMBOL_LEN;
+}
+
+uint32_t
+bus_find(const tick_bus_t *bus, const char *symbol)
+{
+	uint32_t id, n = atomic_load_explicit(&bus->hdr->nsymbols, memory_order_acquire);
+
+	for (id = 1; id <= n; id++) {
+		if (strcmp(bus_symbol(bus, id), symbol) == 0) {
+			return id;
+		}
+	}
+
+	return 0;
+}
+
+void
+bus_publish(tick_bus_t *bus, uint64_t first, size_t n)
+{
+	ring_t *ring = bus->ring;
+	uint64_t i, end = first + n;
+
+	ring_publish(ring, first, n);
+
+	/* the claim may wrap the ring, the table takes the slots a run at a time */
+	for (i = first; i < end;) {
+		size_t run = (size_t)(ring->capacity - (i & ring->mask));
+
+		if (run > end - i) {
+			run = (size_t)(end - i);
+		}
+		snap_put(bus->snap, ring_slot(ring, i), run);
+		i += run;
+	}
+}
+
+int
+bus_push(tick_bus_t *bus, const tick_rec_t *rec)
+{
+	uint64_t seq;
+
+	if (ring_claim(bus->ring, 1, &seq) == 0) {
+		ring_drop(bus->ring, 1);
+		return -1;
+	}
+	memcpy(ring_slot(bus->ring, seq), rec, sizeof(*rec));
+	bus_publish(bus, seq, 1);
+
+	return 0;
+}
+
+void
+bus_heartbeat(tick_bus_t *bus)
+{
+	atomic_store_explicit(&bus->hdr->heartbeat, wall_ns(), memory_order_relaxed);
+}
+
+int
+bus_alive(const tick_bus_t *bus, uint64_t timeout_ns)
+{
+	uint64_t hb = atomic_load_explicit(&bus->hdr->heartbeat, memory_order_relaxed);
+
+	return wall_ns() - hb <= timeout_ns;
+}
+
+static const char *const wait_names[] = {
+	[RING_WAIT_SPIN] = "spin",
+	[RING_WAIT_YIELD] = "yield",
+	[RING_WAIT_FUTEX] = "futex",
+};
+
+int
+bus_wait_parse(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(wait_names) / sizeof(wait_names[0]); i++) {
+		if (strcmp(name, wait_names[i]) == 0) {
+			return (int)i;
+		}
+	}
+
+	return strcmp(name, "sleep") == 0 ? BUS_WAIT_SLEEP : -2;
+}
+
+const char *
+bus_wait_name(int wait)
+{
+	if (wait >= 0 && (size_t)wait < sizeof(wait_names) / sizeof(wait_names[0])) {
+		return wait_names[wait];
+	}
+
+	return wait == BUS_WAIT_SLEEP ? "sleep" : "?";
+}
+
+void
+bus_idle(ring_reader_t *rd, int wait)
+{
+	if (wait == BUS_WAIT_SLEEP) {
+		usleep(BUS_IDLE_NS / 1000);
+	} else {
+		ring_wait(rd, wait, BUS_IDLE_NS);
+	}
+}
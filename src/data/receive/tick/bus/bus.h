@@ -0,0 +1,124 @@
+/*
+ * bus.h
+ *
+ * The file contains the definition of the shared memory tick bus and the
+ * functions' prototype for writing and reading it.
+ *
+ * The bus is one POSIX shared memory segment (/dev/shm/jupiter_tick_<name>)
+ * holding a header, the symbols of the interned instrument ids, a ring of
+ * tick_rec records and the snapshot table of the last record of every id
+ * (snap.h). One receiver process decodes the feed into it; any number
+ * of strategy, recorder and monitoring processes map it, read-only unless
+ * they need a gating reader or futex waits, and read the same records, so
+ * the feed is decoded once and survives the restart of any consumer.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __BUS_H__
+#define __BUS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "tick.h"
+#include "ring.h"
+#include "snap.h"
+
+#define BUS_MAGIC	0x5355424aU	/* "JBUS" */
+#define BUS_VERSION	2
+#define BUS_NAME_MAX	64
+
+/* flags of bus_open() */
+#define BUS_O_RDWR	0x0001		/* map writable: gating readers and futex waits */
+
+/* flags of bus_reader() */
+#define BUS_R_REPLAY	0x0001		/* start from the oldest retained record */
+#define BUS_R_GATING	0x0002		/* hold the writer back, needs BUS_O_RDWR */
+
+/* wait of bus_idle() besides the enum ring_wait, the futex one needs BUS_O_RDWR */
+#define BUS_WAIT_SLEEP	-1		/* poll every 1ms */
+#define BUS_IDLE_NS	1000000ULL	/* longest a reader waits in bus_idle() */
+
+struct bus_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;			/* bytes of the segment */
+	uint64_t symbols_off;		/* offset of the symbols */
+	uint64_t ring_off;		/* offset of the ring */
+	uint64_t snap_off;		/* offset of the snapshot table */
+	uint64_t created;		/* ns since epoch the writer created the bus */
+	uint32_t writer_pid;
+	uint32_t md_type;		/* enum md_type of the feed, MD_T_MAX if mixed */
+
+	_Atomic uint64_t heartbeat __attribute__((aligned(64)));	/* ns since epoch, by the writer */
+	_Atomic uint32_t nsymbols;
+};
+
+typedef struct tick_bus
+{
+	struct bus_hdr *hdr;
+	ring_t *ring;
+	snap_t *snap;
+	size_t size;
+	int writable;
+	char name[BUS_NAME_MAX];
+} tick_bus_t;
+
+/*
+ * bus_create - create (or replace) the bus of the name for the writer; the
+ * symbols interned by this process are shared through it from now on.
+ */
+int bus_create(tick_bus_t *bus, const char *name, uint64_t capacity, int md_type);
+
+/*
+ * bus_open - map an existing bus for reading.
+ */
+int bus_open(tick_bus_t *bus, const char *name, int flags);
+void bus_close(tick_bus_t *bus);
+
+/*
+ * bus_unlink - remove the bus from /dev/shm; processes mapping it keep it.
+ */
+int bus_unlink(const char *name);
+
+/*
+ * bus_reader - attach a reader at the head, or replay from the oldest record
+ * still retained with BUS_R_REPLAY.
+ */
+int bus_reader(tick_bus_t *bus, ring_reader_t *rd, int flags);
+
+const char *bus_symbol(const tick_bus_t *bus, uint32_t id);
+
+/*
+ * bus_find - the id of the symbol among those of the bus, 0 if none.
+ */
+uint32_t bus_find(const tick_bus_t *bus, const char *symbol);
+
+/*
+ * bus_publish - publish the records of the claimed slots from first, and
+ * put them in the snapshot table; bus_push() copies one record in first.
+ * The writer only.
+ */
+void bus_publish(tick_bus_t *bus, uint64_t first, size_t n);
+int bus_push(tick_bus_t *bus, const tick_rec_t *rec);
+
+/*
+ * bus_heartbeat - the writer tells the readers it is alive; bus_alive()
+ * checks it was seen in the last timeout_ns.
+ */
+void bus_heartbeat(tick_bus_t *bus);
+int bus_alive(const tick_bus_t *bus, uint64_t timeout_ns);
+
+/*
+ * bus_wait_parse - "spin", "yield", "futex" or "sleep", -2 if none of them;
+ * bus_idle() waits that way for the next record of the reader, BUS_IDLE_NS
+ * at most so the caller keeps its timers.
+ */
+int bus_wait_parse(const char *name);
+const char *bus_wait_name(int wait);
+void bus_idle(ring_reader_t *rd, int wait);
+
+#endif		/* __BUS_H__ */
@@ -0,0 +1,183 @@
+/*
+ * intern.c
+ *
+ * The functions are used to intern the symbols of instruments into dense
+ * integer ids, so the tick records carry an id instead of a string and the
+ * hot paths compare integers.
+ *
+ * Lookups are lock-free: a slot of the hash table is published with one
+ * atomic store after its symbol is written. Adding a symbol takes a mutex,
+ * which only happens when an instrument is seen for the first time.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "tick.h"
+
+#define HASH_SIZE	(TICK_INSTRUMENT_MAX * 2)	/* load factor stays below 0.5 */
+
+static _Atomic uint32_t slots[HASH_SIZE];	/* id of the symbol, 0 if empty */
+static char local_symbols[TICK_INSTRUMENT_MAX][TICK_SYMBOL_LEN];
+static _Atomic uint32_t local_nsymbols;
+
+/* the symbols live in local_symbols until tick_intern_share() moves them */
+static char (*symbols)[TICK_SYMBOL_LEN] = local_symbols;
+static _Atomic uint32_t *nsymbols = &local_nsymbols;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint32_t
+hash_symbol(const char *s, size_t len)
+{
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (uint8_t)s[i];
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+/*
+ * symbol_len - the length of the symbol up to the first NUL or blank, as the
+ * exchanges pad fixed-width symbol fields with either.
+ */
+static inline size_t
+symbol_len(const char *s, size_t len)
+{
+	size_t i;
+
+	if (len >= TICK_SYMBOL_LEN) {
+		len = TICK_SYMBOL_LEN - 1;
+	}
+
+	for (i = 0; i < len; i++) {
+		if (s[i] == '\0' || s[i] == ' ') {
+			break;
+		}
+	}
+
+	return i;
+}
+
+static inline int
+symbol_eq(uint32_t id, const char *s, size_t len)
+{
+	const char *sym = symbols[id - 1];
+
+	return memcmp(sym, s, len) == 0 && sym[len] == '\0';
+}
+
+static uint32_t
+find(const char *s, size_t len, uint32_t h, uint32_t *pos)
+{
+	uint32_t i = h & (HASH_SIZE - 1);
+	uint32_t id;
+
+	while ((id = atomic_load_explicit(&slots[i], memory_order_acquire)) != 0) {
+		if (symbol_eq(id, s, len)) {
+			return id;
+		}
+		i = (i + 1) & (HASH_SIZE - 1);
+	}
+
+	if (pos != NULL) {
+		*pos = i;
+	}
+
+	return 0;
+}
+
+uint32_t
+tick_lookup(const char *symbol, size_t len)
+{
+	if (symbol == NULL) {
+		return 0;
+	}
+
+	len = symbol_len(symbol, len);
+
+	return find(symbol, len, hash_symbol(symbol, len), NULL);
+}
+
+uint32_t
+tick_intern(const char *symbol, size_t len)
+{
+	uint32_t h, id, pos = 0;
+
+	if (symbol == NULL) {
+		return 0;
+	}
+
+	len = symbol_len(symbol, len);
+	if (len == 0) {
+		return 0;
+	}
+
+	h = hash_symbol(symbol, len);
+	if ((id = find(symbol, len, h, NULL)) != 0) {
+		return id;
+	}
+
+	pthread_mutex_lock(&intern_lock);
+
+	/* another thread may have added it since the lock-free lookup */
+	if ((id = find(symbol, len, h, &pos)) == 0) {
+		id = atomic_load_explicit(nsymbols, memory_order_relaxed);
+		if (id >= TICK_INSTRUMENT_MAX) {
+			pthread_mutex_unlock(&intern_lock);
+			fprintf(stderr, "instrument table is full, %.*s not interned\n", (int)len, symbol);
+			return 0;
+		}
+
+		id++;
+		memcpy(symbols[id - 1], symbol, len);
+		symbols[id - 1][len] = '\0';
+		atomic_store_explicit(nsymbols, id, memory_order_release);
+		atomic_store_explicit(&slots[pos], id, memory_order_release);
+	}
+
+	pthread_mutex_unlock(&intern_lock);
+
+	return id;
+}
+
+const char *
+tick_symbol(uint32_t id)
+{
+	if (id == 0 || id > atomic_load_explicit(nsymbols, memory_order_acquire)) {
+		return NULL;
+	}
+
+	return symbols[id - 1];
+}
+
+uint32_t
+tick_instruments(void)
+{
+	return atomic_load_explicit(nsymbols, memory_order_acquire);
+}
+
+void
+tick_intern_share(char (*names)[TICK_SYMBOL_LEN], _Atomic uint32_t *count)
+{
+	uint32_t n;
+
+	pthread_mutex_lock(&intern_lock);
+
+	n = atomic_load_explicit(nsymbols, memory_order_relaxed);
+	if (names != symbols) {
+		memcpy(names, symbols, (size_t)n * TICK_SYMBOL_LEN);
+	}
+	atomic_store_explicit(count, n, memory_order_release);
+	symbols = names;
+	nsymbols = count;
+
+	pthread_mutex_unlock(&intern_lock);
+}
@@ -0,0 +1,302 @@
+/*
+ * lat.c
+ *
+ * The functions are used to map the latency stats page, to give its slots
+ * to the recording threads and to read the histograms of all of them.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "lat.h"
+
+#define OPEN_WAIT_US	1000
+#define OPEN_TRIES	1000		/* 1s for the creator to initialize the page */
+
+const char *const lat_stage_names[LAT_S_MAX] = {
+	[LAT_S_WIRE] = "wire",
+	[LAT_S_DECODE] = "decode",
+	[LAT_S_BUS] = "bus",
+	[LAT_S_BAR] = "bar",
+	[LAT_S_STRATEGY] = "strategy",
+	[LAT_S_TOTAL] = "total",
+};
+
+__thread struct lat_slot *lat_self;
+
+static int
+shm_name(char *dst, size_t len, const char *name)
+{
+	if (name == NULL || strchr(name, '/') != NULL) {
+		return -1;
+	}
+
+	return snprintf(dst, len, "/jupiter_lat_%s", name) < (int)len ? 0 : -1;
+}
+
+static int
+map_page(lat_page_t *pg, const char *name, int fd, int rw)
+{
+	struct stat st;
+	void *p;
+	int i;
+
+	/* the creator may not have sized or initialized it yet */
+	for (i = 0;; i++) {
+		if (fstat(fd, &st) != 0) {
+			return -2;
+		}
+		if ((size_t)st.st_size >= sizeof(struct lat_hdr)) {
+			break;
+		}
+		if (i == OPEN_TRIES) {
+			return -2;
+		}
+		usleep(OPEN_WAIT_US);
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, rw ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		return -2;
+	}
+
+	pg->hdr = p;
+	for (i = 0; atomic_load_explicit(&pg->hdr->magic, memory_order_acquire) != LAT_MAGIC; i++) {
+		if (i == OPEN_TRIES) {
+			munmap(p, (size_t)st.st_size);
+			return -2;
+		}
+		usleep(OPEN_WAIT_US);
+	}
+	if (pg->hdr->version != LAT_VERSION || pg->hdr->size != (uint64_t)st.st_size) {
+		fprintf(stderr, "latency page %s has another layout, remove it\n", name);
+		munmap(p, (size_t)st.st_size);
+		return -1;
+	}
+
+	pg->size = (size_t)st.st_size;
+	snprintf(pg->name, sizeof(pg->name), "%s", name);
+
+	return 0;
+}
+
+int
+lat_open(lat_page_t *pg, const char *name)
+{
+	char path[LAT_NAME_MAX + 16];
+	struct lat_hdr *hdr;
+	size_t size = sizeof(struct lat_hdr);
+	void *p;
+	int fd, rc;
+
+	if (pg == NULL || shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+
+	/* the first process creates it, the others of the pipeline map it */
+	if ((fd = shm_open(path, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0) {
+		if (errno != EEXIST || (fd = shm_open(path, O_RDWR, 0)) < 0) {
+			fprintf(stderr, "shm_open(%s) failed: %s\n", path, strerror(errno));
+			return -2;
+		}
+		rc = map_page(pg, name, fd, 1);
+		close(fd);
+		return rc;
+	}
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		fprintf(stderr, "ftruncate(%s) failed: %s\n", path, strerror(errno));
+		close(fd);
+		shm_unlink(path);
+		return -2;
+	}
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(path);
+		return -2;
+	}
+
+	/* the histograms are zero pages until a thread records into them */
+	hdr = p;
+	hdr->version = LAT_VERSION;
+	hdr->size = size;
+	hdr->created = lat_now();
+	atomic_store_explicit(&hdr->magic, LAT_MAGIC, memory_order_release);
+
+	pg->hdr = hdr;
+	pg->size = size;
+	snprintf(pg->name, sizeof(pg->name), "%s", name);
+
+	return 0;
+}
+
+int
+lat_open_read(lat_page_t *pg, const char *name)
+{
+	char path[LAT_NAME_MAX + 16];
+	int fd, rc;
+
+	if (pg == NULL || shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+	if ((fd = shm_open(path, O_RDONLY, 0)) < 0) {
+		return -2;
+	}
+	rc = map_page(pg, name, fd, 0);
+	close(fd);
+
+	return rc;
+}
+
+void
+lat_close(lat_page_t *pg)
+{
+	if (pg == NULL || pg->hdr == NULL) {
+		return;
+	}
+	if (lat_self != NULL && (uint8_t *)lat_self >= (uint8_t *)pg->hdr &&
+	    (uint8_t *)lat_self < (uint8_t *)pg->hdr + pg->size) {
+		lat_detach();
+	}
+	munmap(pg->hdr, pg->size);
+	pg->hdr = NULL;
+}
+
+int
+lat_unlink(const char *name)
+{
+	char path[LAT_NAME_MAX + 16];
+
+	if (shm_name(path, sizeof(path), name) != 0) {
+		return -1;
+	}
+
+	return shm_unlink(path);
+}
+
+/* a slot is free when its thread is gone; kill() takes the tid on Linux */
+static int
+slot_dead(uint32_t owner)
+{
+	return owner == 0 || (kill((pid_t)owner, 0) != 0 && errno == ESRCH);
+}
+
+int
+lat_attach(lat_page_t *pg, const char *role)
+{
+	uint32_t tid = (uint32_t)syscall(SYS_gettid), owner;
+	struct lat_slot *s;
+	int i;
+
+	if (pg == NULL || pg->hdr == NULL) {
+		return -1;
+	}
+	if (lat_self != NULL) {
+		lat_detach();
+	}
+
+	for (i = 0; i < LAT_SLOTS_MAX; i++) {
+		s = &pg->hdr->slots[i];
+		owner = atomic_load_explicit(&s->owner, memory_order_relaxed);
+		if (!slot_dead(owner) ||
+		    !atomic_compare_exchange_strong(&s->owner, &owner, tid)) {
+			continue;
+		}
+
+		/* a reader summing the slot meanwhile is one interval off at most */
+		memset(s->hist, 0, sizeof(s->hist));
+		s->pid = (uint32_t)getpid();
+		s->attached = lat_now();
+		snprintf(s->role, sizeof(s->role), "%s", role != NULL ? role : "");
+		atomic_thread_fence(memory_order_release);
+		lat_self = s;
+		return 0;
+	}
+
+	fprintf(stderr, "latency page %s has no free slot\n", pg->name);
+	return -1;
+}
+
+void
+lat_detach(void)
+{
+	struct lat_slot *s = lat_self;
+
+	if (s == NULL) {
+		return;
+	}
+	lat_self = NULL;
+	atomic_store_explicit(&s->owner, 0, memory_order_release);
+}
+
+void
+lat_merge(const lat_page_t *pg, struct lat_hist *out)
+{
+	const struct lat_hist *h;
+	struct lat_hist *o;
+	uint64_t v;
+	int i, m, s;
+	uint32_t b;
+
+	memset(out, 0, sizeof(struct lat_hist) * MD_T_MAX * LAT_S_MAX);
+
+	/* the slots of exited threads still count until they are taken over */
+	for (i = 0; i < LAT_SLOTS_MAX; i++) {
+		if (pg->hdr->slots[i].attached == 0) {
+			continue;
+		}
+		for (m = 0; m < MD_T_MAX; m++) {
+			for (s = 0; s < LAT_S_MAX; s++) {
+				h = &pg->hdr->slots[i].hist[m][s];
+				o = &out[m * LAT_S_MAX + s];
+				if (atomic_load_explicit(&h->count, memory_order_relaxed) == 0) {
+					continue;
+				}
+				for (b = 0; b < LAT_BUCKETS; b++) {
+					o->buckets[b] += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+				}
+				o->count += atomic_load_explicit(&h->count, memory_order_relaxed);
+				o->sum += atomic_load_explicit(&h->sum, memory_order_relaxed);
+				v = atomic_load_explicit(&h->max, memory_order_relaxed);
+				if (v > o->max) {
+					o->max = v;
+				}
+			}
+		}
+	}
+}
+
+uint64_t
+lat_percentile(const struct lat_hist *h, double q)
+{
+	uint64_t total = 0, rank, seen = 0;
+	uint32_t b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		total += h->buckets[b];
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	rank = (uint64_t)(q * (double)total + 0.5);
+	rank = rank < 1 ? 1 : rank > total ? total : rank;
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		if ((seen += h->buckets[b]) >= rank) {
+			break;
+		}
+	}
+
+	/* a bucket reports its highest value, never above the max seen */
+	return b == LAT_BUCKETS || lat_bucket_value(b) > h->max ? h->max : lat_bucket_value(b);
+}
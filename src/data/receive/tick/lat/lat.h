@@ -0,0 +1,276 @@
+/*
+ * lat.h
+ *
+ * The file contains the definition of the latency histograms of the tick
+ * pipeline and the functions' prototype for recording and reading them.
+ *
+ * The receiver stamps every record with the time its packet was picked up
+ * for decoding and the time it was published, as offsets from recv_ts, so
+ * the consumers in other processes see when the record left the receiver.
+ * Every thread recording latencies owns a slot of a shared memory stats
+ * page (/dev/shm/jupiter_lat_<name>, the name of the bus usually), holding
+ * one log-linear histogram per stage and md_type; only that thread writes
+ * the slot, without locks, atomic read-modify-writes or allocation, and
+ * lat_stat reads all the slots of the page while they are written.
+ *
+ * Built without TICK_LATENCY, the functions are empty and the stamps are
+ * never written, so the pipeline has no trace of it.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __LAT_H__
+#define __LAT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "tick.h"
+
+#define LAT_MAGIC	0x54414c4aU	/* "JLAT" */
+#define LAT_VERSION	1
+#define LAT_NAME_MAX	64
+#define LAT_ROLE_LEN	24
+#define LAT_SLOTS_MAX	32		/* threads recording into a page */
+
+/*
+ * The histograms are HDR-style: values below 2^LAT_SUB_BITS ns have a
+ * bucket each, every power of 2 above is split in 2^LAT_SUB_BITS buckets,
+ * so a bucket is within 1/16 of its values; from 2^LAT_RANGE_BITS ns (68s)
+ * on everything is in the last bucket.
+ */
+#define LAT_SUB_BITS	4
+#define LAT_SUB		(1U << LAT_SUB_BITS)
+#define LAT_RANGE_BITS	36
+#define LAT_BUCKETS	((LAT_RANGE_BITS - LAT_SUB_BITS + 1) * LAT_SUB)
+
+enum lat_stage {
+	LAT_S_WIRE = 0,		/* receive timestamp to the decoder picking the packet up */
+	LAT_S_DECODE,		/* decoding the packet and publishing its records */
+	LAT_S_BUS,		/* publish to a consumer reading the record */
+	LAT_S_BAR,		/* the bar engine updating the bars of the record */
+	LAT_S_STRATEGY,		/* the strategy (the matcher) handling the record */
+	LAT_S_TOTAL,		/* receive timestamp to the consumer done with the record */
+	LAT_S_MAX
+};
+
+extern const char *const lat_stage_names[LAT_S_MAX];
+
+struct lat_hist
+{
+	_Atomic uint64_t count;
+	_Atomic uint64_t sum;		/* ns */
+	_Atomic uint64_t max;		/* ns */
+	uint64_t reserved;
+	_Atomic uint64_t buckets[LAT_BUCKETS];
+} __attribute__((aligned(64)));
+
+/*
+ * lat_slot - the histograms of one thread; owner is its tid while the
+ * thread records, a slot of an exited thread is taken over by the next.
+ */
+struct lat_slot
+{
+	_Atomic uint32_t owner;
+	uint32_t pid;
+	uint64_t attached;		/* ns since epoch */
+	char role[LAT_ROLE_LEN];	/* e.g. "decode", "gen_bar" */
+	struct lat_hist hist[MD_T_MAX][LAT_S_MAX] __attribute__((aligned(64)));
+};
+
+struct lat_hdr
+{
+	_Atomic uint32_t magic;
+	uint32_t version;
+	uint64_t size;			/* bytes of the page */
+	uint64_t created;		/* ns since epoch */
+	struct lat_slot slots[LAT_SLOTS_MAX] __attribute__((aligned(64)));
+};
+
+typedef struct lat_page
+{
+	struct lat_hdr *hdr;
+	size_t size;
+	char name[LAT_NAME_MAX];
+} lat_page_t;
+
+/*
+ * lat_bucket - the bucket of a value; lat_bucket_value() the highest value
+ * of a bucket, what the percentiles report.
+ */
+static inline uint32_t
+lat_bucket(uint64_t ns)
+{
+	uint32_t e;
+
+	if (ns < LAT_SUB) {
+		return (uint32_t)ns;
+	}
+	e = 63 - (uint32_t)__builtin_clzll(ns);
+	if (e >= LAT_RANGE_BITS) {
+		return LAT_BUCKETS - 1;
+	}
+
+	return (e - LAT_SUB_BITS + 1) * LAT_SUB + (uint32_t)((ns >> (e - LAT_SUB_BITS)) & (LAT_SUB - 1));
+}
+
+static inline uint64_t
+lat_bucket_value(uint32_t b)
+{
+	uint32_t shift;
+
+	if (b < LAT_SUB) {
+		return b;
+	}
+	shift = b / LAT_SUB - 1;
+
+	return ((uint64_t)(LAT_SUB + b % LAT_SUB + 1) << shift) - 1;
+}
+
+/* lat_since - ns from then to now, 0 if the clocks disagree */
+static inline uint64_t
+lat_since(uint64_t now, uint64_t then)
+{
+	return now > then ? now - then : 0;
+}
+
+#ifdef TICK_LATENCY
+
+extern __thread struct lat_slot *lat_self;
+
+/*
+ * lat_now - the wall clock in ns, the clock of the receive timestamps of
+ * the kernel and of recv_ts; clock_gettime() is a vDSO call.
+ */
+static inline uint64_t
+lat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * lat_record - add a latency of the stage to the histograms of the thread.
+ * Nothing happens until the thread attached to a page; the stores are
+ * relaxed and plain, the slot has no other writer.
+ */
+static inline void
+lat_record(int stage, int md_type, uint64_t ns)
+{
+	struct lat_hist *h;
+	_Atomic uint64_t *b;
+
+	if (lat_self == NULL || (unsigned int)md_type >= MD_T_MAX) {
+		return;
+	}
+
+	h = &lat_self->hist[md_type][stage];
+	b = &h->buckets[lat_bucket(ns)];
+	atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_store_explicit(&h->sum, atomic_load_explicit(&h->sum, memory_order_relaxed) + ns,
+			      memory_order_relaxed);
+	if (ns > atomic_load_explicit(&h->max, memory_order_relaxed)) {
+		atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+	}
+	atomic_store_explicit(&h->count, atomic_load_explicit(&h->count, memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+}
+
+static inline uint32_t
+lat_offset(uint64_t t, uint64_t recv_ts)
+{
+	uint64_t d = lat_since(t, recv_ts);
+
+	/* 0 is no stamp */
+	return d == 0 ? 1 : d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+}
+
+/*
+ * lat_stamp - the times the packet of the record was picked up and the
+ * record was published, by the receiver.
+ */
+static inline void
+lat_stamp(tick_rec_t *t, uint64_t picked, uint64_t published)
+{
+	t->lat_picked = lat_offset(picked, t->recv_ts);
+	t->lat_published = lat_offset(published, t->recv_ts);
+}
+
+/*
+ * lat_published - the time the receiver published the record, 0 if it has
+ * no stamp, e.g. a record replayed from a file.
+ */
+static inline uint64_t
+lat_published(const tick_rec_t *t)
+{
+	return t->lat_published != 0 ? t->recv_ts + t->lat_published : 0;
+}
+
+/*
+ * lat_consumed - a consumer read the records at read and was done with them
+ * at done: the bus, stage and total latencies of every stamped record.
+ */
+static inline void
+lat_consumed(const tick_rec_t *t, size_t n, int stage, uint64_t read, uint64_t done)
+{
+	uint64_t pub;
+	size_t i;
+
+	if (lat_self == NULL) {
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		if ((pub = lat_published(&t[i])) != 0) {
+			lat_record(LAT_S_BUS, t[i].md_type, lat_since(read, pub));
+			lat_record(stage, t[i].md_type, lat_since(done, read));
+			lat_record(LAT_S_TOTAL, t[i].md_type, lat_since(done, t[i].recv_ts));
+		}
+	}
+}
+
+/*
+ * lat_open - map the stats page of the name, creating it if it is not
+ * there; lat_open_read() maps an existing one read-only.
+ */
+int lat_open(lat_page_t *pg, const char *name);
+int lat_open_read(lat_page_t *pg, const char *name);
+void lat_close(lat_page_t *pg);
+int lat_unlink(const char *name);
+
+/*
+ * lat_attach - take a slot of the page for the calling thread; its
+ * histograms start empty. lat_detach() frees it.
+ */
+int lat_attach(lat_page_t *pg, const char *role);
+void lat_detach(void);
+
+#else		/* TICK_LATENCY */
+
+static inline uint64_t lat_now(void) { return 0; }
+static inline void lat_record(int stage, int md_type, uint64_t ns) { (void)stage; (void)md_type; (void)ns; }
+static inline void lat_stamp(tick_rec_t *t, uint64_t picked, uint64_t published) { (void)t; (void)picked; (void)published; }
+static inline uint64_t lat_published(const tick_rec_t *t) { (void)t; return 0; }
+static inline void lat_consumed(const tick_rec_t *t, size_t n, int stage, uint64_t read, uint64_t done)
+{
+	(void)t; (void)n; (void)stage; (void)read; (void)done;
+}
+static inline int lat_open(lat_page_t *pg, const char *name) { (void)pg; (void)name; return -1; }
+static inline void lat_close(lat_page_t *pg) { (void)pg; }
+static inline int lat_attach(lat_page_t *pg, const char *role) { (void)pg; (void)role; return -1; }
+static inline void lat_detach(void) {}
+
+#endif		/* TICK_LATENCY */
+
+/*
+ * lat_merge - add the histograms of every slot of the page into
+ * out[MD_T_MAX][LAT_S_MAX]; lat_percentile() the value q (0 to 1) of the
+ * values of a histogram is at most.
+ */
+void lat_merge(const lat_page_t *pg, struct lat_hist *out);
+uint64_t lat_percentile(const struct lat_hist *h, double q);
+
+#endif		/* __LAT_H__ */
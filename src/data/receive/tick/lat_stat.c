@@ -0,0 +1,276 @@
+/*
+ * lat_stat.c
+ *
+ * The program prints the latencies of the stages of the tick pipeline from
+ * the stats page the receiver and the consumers of a bus record into, the
+ * whole day or every interval, and sets them in Redis for the dashboards.
+ *
+ *	lat_stat -n shfe
+ *	lat_stat -n shfe -i 1 -H 127.0.0.1:6379 -k lat:
+ *
+ * Every interval prints the latencies of the records of that interval
+ * only, so the tail at the open is not averaged away by the rest of the
+ * day. The values are in us, a percentile is the highest value of its
+ * bucket, within 1/16.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tick.h"
+#include "decode.h"
+#include "lat.h"
+#include "redis_client.h"
+
+#define HIST_N		(MD_T_MAX * LAT_S_MAX)
+#define FLUSH_TRIES	100
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static const char *
+md_name(int md_type)
+{
+	static const char *const extra[MD_T_MAX] = { [MD_T_SSE] = "sse", [MD_T_SZSE] = "szse" };
+
+	return tick_decoders[md_type] != NULL ? tick_decoders[md_type]->name :
+	       extra[md_type] != NULL ? extra[md_type] : "?";
+}
+
+/* a slot taken over by another thread starts from 0 again */
+#define SUB(a, b)	((a) >= (b) ? (a) - (b) : (a))
+
+/*
+ * diff - the records of cur not in prev; the max of the interval is the top
+ * of its highest bucket, unless the max of the day moved within it.
+ */
+static void
+diff(const struct lat_hist *cur, const struct lat_hist *prev, struct lat_hist *out)
+{
+	uint64_t v;
+	uint32_t b;
+	int i;
+
+	for (i = 0; i < HIST_N; i++) {
+		out[i].count = SUB(cur[i].count, prev[i].count);
+		out[i].sum = SUB(cur[i].sum, prev[i].sum);
+		out[i].max = 0;
+		for (b = 0; b < LAT_BUCKETS; b++) {
+			v = SUB(cur[i].buckets[b], prev[i].buckets[b]);
+			out[i].buckets[b] = v;
+			if (v != 0) {
+				out[i].max = lat_bucket_value(b);
+			}
+		}
+		if (cur[i].max != prev[i].max || out[i].max > cur[i].max) {
+			out[i].max = cur[i].max;
+		}
+	}
+}
+
+static void
+print_hist(const struct lat_hist *h, const char *when)
+{
+	int m, s, rows = 0;
+
+	for (m = 0; m < MD_T_MAX; m++) {
+		for (s = 0; s < LAT_S_MAX; s++) {
+			const struct lat_hist *x = &h[m * LAT_S_MAX + s];
+
+			if (x->count == 0) {
+				continue;
+			}
+			if (rows++ == 0) {
+				printf("%-8s %-6s %-8s %10s %9s %9s %9s %9s %9s %9s\n", when, "md", "stage", "count",
+				       "mean", "p50", "p90", "p99", "p99.9", "max");
+			}
+			printf("%-8s %-6s %-8s %10lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", when, md_name(m),
+			       lat_stage_names[s], (unsigned long)x->count, (double)x->sum / (double)x->count / 1e3,
+			       (double)lat_percentile(x, 0.5) / 1e3, (double)lat_percentile(x, 0.9) / 1e3,
+			       (double)lat_percentile(x, 0.99) / 1e3, (double)lat_percentile(x, 0.999) / 1e3,
+			       (double)x->max / 1e3);
+		}
+	}
+	fflush(stdout);
+}
+
+/*
+ * set_redis - HSET <prefix><md>:<stage> count .. mean .. p50 .. p90 .. p99
+ * .. p999 .. max .., in ns, one batch for all of them.
+ */
+static int
+set_redis(redis_client_t *c, const struct lat_hist *h, const char *prefix)
+{
+	static const char *const names[] = { "count", "mean", "p50", "p90", "p99", "p999", "max" };
+	char key[128], vals[7][24];
+	const char *argv[16];
+	size_t lens[16];
+	uint64_t v[7];
+	int m, s, i, n, tries;
+
+	for (m = 0; m < MD_T_MAX; m++) {
+		for (s = 0; s < LAT_S_MAX; s++) {
+			const struct lat_hist *x = &h[m * LAT_S_MAX + s];
+
+			if (x->count == 0) {
+				continue;
+			}
+			v[0] = x->count;
+			v[1] = x->sum / x->count;
+			v[2] = lat_percentile(x, 0.5);
+			v[3] = lat_percentile(x, 0.9);
+			v[4] = lat_percentile(x, 0.99);
+			v[5] = lat_percentile(x, 0.999);
+			v[6] = x->max;
+
+			snprintf(key, sizeof(key), "%s%s:%s", prefix, md_name(m), lat_stage_names[s]);
+			argv[0] = "HSET";
+			argv[1] = key;
+			for (i = 0, n = 2; i < 7; i++) {
+				snprintf(vals[i], sizeof(vals[i]), "%lu", (unsigned long)v[i]);
+				argv[n++] = names[i];
+				argv[n++] = vals[i];
+			}
+			for (i = 0; i < n; i++) {
+				lens[i] = strlen(argv[i]);
+			}
+			if (redis_append(c, n, argv, lens) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	/* a few hundred bytes once an interval, the socket takes them at once */
+	for (tries = 0; tries < FLUSH_TRIES; tries++) {
+		ssize_t left = redis_flush(c);
+
+		if (left < 0) {
+			return -1;
+		}
+		if (left == 0) {
+			break;
+		}
+		usleep(1000);
+	}
+
+	return redis_drain(c) < 0 ? -1 : 0;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -n name [-i sec] [-H host:port [-k prefix]] [-u]\n"
+		"  -n name      name of the stats page, the bus of the pipeline\n"
+		"  -i sec       print the latencies of every interval, not of the day once\n"
+		"  -H addr      also set them in redis, host:port\n"
+		"  -k prefix    of the redis keys (default lat:)\n"
+		"  -u           remove the stats page, e.g. to start a new day\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static struct lat_hist cur[HIST_N], prev[HIST_N], delta[HIST_N];
+	const char *name = NULL, *prefix = "lat:";
+	char host[REDIS_HOST_MAX] = "", *colon, when[16];
+	redis_client_t rc;
+	lat_page_t pg;
+	struct tm tm;
+	time_t now;
+	int interval = 0, port = 6379, unlink_page = 0, opt;
+
+	while ((opt = getopt(argc, argv, "n:i:H:k:u")) != -1) {
+		switch (opt) {
+		case 'n':
+			name = optarg;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'H':
+			snprintf(host, sizeof(host), "%s", optarg);
+			if ((colon = strrchr(host, ':')) != NULL) {
+				*colon = '\0';
+				port = atoi(colon + 1);
+			}
+			break;
+		case 'k':
+			prefix = optarg;
+			break;
+		case 'u':
+			unlink_page = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (name == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (unlink_page) {
+		return lat_unlink(name) == 0 ? 0 : 1;
+	}
+
+	if (lat_open_read(&pg, name) != 0) {
+		fprintf(stderr, "cannot open latency page %s\n", name);
+		return 1;
+	}
+	memset(&rc, 0, sizeof(rc));
+	rc.fd = -1;
+	if (host[0] != '\0' && redis_connect(&rc, host, port) != 0) {
+		lat_close(&pg);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	lat_merge(&pg, cur);
+	if (interval <= 0) {
+		print_hist(cur, "day");
+		if (rc.fd >= 0 && set_redis(&rc, cur, prefix) != 0) {
+			fprintf(stderr, "cannot set the latencies in redis\n");
+		}
+	}
+
+	while (interval > 0 && running) {
+		memcpy(prev, cur, sizeof(cur));
+		sleep((unsigned int)interval);
+		lat_merge(&pg, cur);
+		diff(cur, prev, delta);
+
+		now = time(NULL);
+		localtime_r(&now, &tm);
+		strftime(when, sizeof(when), "%H:%M:%S", &tm);
+		print_hist(delta, when);
+		/* a lost connection is made again the next interval */
+		if (host[0] != '\0' && (rc.fd >= 0 || redis_connect(&rc, host, port) == 0) &&
+		    set_redis(&rc, delta, prefix) != 0) {
+			redis_close(&rc);
+		}
+	}
+
+	if (rc.fd >= 0) {
+		redis_close(&rc);
+	}
+	lat_close(&pg);
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * pub_redis.c
+ *
+ * The program publishes the ticks of a tick bus to Redis for the dashboards
+ * and the research jobs, in its own process so the receiver never waits on
+ * Redis; a lagging publisher only conflates, or is lapped by the bus.
+ *
+ *	pub_redis -b shfe -H 127.0.0.1:6379 -m stream -k tick: -l 100000
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tick.h"
+#include "ring.h"
+#include "bus.h"
+#include "redis_client.h"
+
+#define POLL_MAX	4096
+#define STATS_SEC	10
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static const char *
+symbol_of(uint32_t id, void *arg)
+{
+	return bus_symbol((const tick_bus_t *)arg, id);
+}
+
+static void
+print_stats(const redis_pub_t *pub)
+{
+	struct redis_pub_stats st;
+
+	redis_pub_stats(pub, &st);
+	fprintf(stderr, "ticks %lu published %lu conflated %lu snapshots %lu batches %lu "
+		"errors %lu reconnects %lu drops %lu\n", st.ticks, st.published, st.conflated,
+		st.snapshots, st.batches, st.errors, st.reconnects, st.drops);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -b bus [-H host:port] [options]\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -H addr      redis host:port (default 127.0.0.1:6379)\n"
+		"  -m mode      stream (XADD) or pubsub (PUBLISH) (default stream)\n"
+		"  -k prefix    of the stream keys or channels (default tick:)\n"
+		"  -l len       approximate entries a stream keeps, 0 unbounded (default 100000)\n"
+		"  -n cmds      commands of a batch (default 512)\n"
+		"  -d us        deadline of a batch (default 1000)\n"
+		"  -p replies   pending replies before conflating (default 100000)\n"
+		"  -r           replay the ticks retained by the bus first\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct redis_pub_conf conf;
+	const char *bus_name = NULL;
+	uint64_t last = 0, now;
+	ring_reader_t rd;
+	redis_pub_t *pub;
+	tick_bus_t bus;
+	int replay = 0, opt;
+	char *colon;
+
+	memset(&conf, 0, sizeof(conf));
+	snprintf(conf.host, sizeof(conf.host), "127.0.0.1");
+	conf.port = 6379;
+	conf.mode = REDIS_STREAM;
+	snprintf(conf.prefix, sizeof(conf.prefix), "tick:");
+	conf.maxlen = 100000;
+	conf.batch = 512;
+	conf.deadline_us = 1000;
+	conf.max_pending = 100000;
+	conf.max_out = 64 << 20;
+
+	while ((opt = getopt(argc, argv, "b:H:m:k:l:n:d:p:r")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'H':
+			if ((colon = strrchr(optarg, ':')) != NULL) {
+				*colon = '\0';
+				conf.port = atoi(colon + 1);
+			}
+			snprintf(conf.host, sizeof(conf.host), "%s", optarg);
+			break;
+		case 'm':
+			if ((conf.mode = redis_mode_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown mode %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'k':
+			snprintf(conf.prefix, sizeof(conf.prefix), "%s", optarg);
+			break;
+		case 'l':
+			conf.maxlen = strtoull(optarg, NULL, 10);
+			break;
+		case 'n':
+			conf.batch = (uint32_t)atoi(optarg);
+			break;
+		case 'd':
+			conf.deadline_us = strtoull(optarg, NULL, 10);
+			break;
+		case 'p':
+			conf.max_pending = strtoull(optarg, NULL, 10);
+			break;
+		case 'r':
+			replay = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (bus_name == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (bus_open(&bus, bus_name, 0) != 0) {
+		fprintf(stderr, "cannot open tick bus %s\n", bus_name);
+		return 1;
+	}
+	conf.symbol = symbol_of;
+	conf.arg = &bus;
+	if ((pub = redis_pub_create(&conf)) == NULL || bus_reader(&bus, &rd, replay ? BUS_R_REPLAY : 0) != 0) {
+		redis_pub_destroy(pub);
+		bus_close(&bus);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	while (running) {
+		if (redis_pub_poll(pub, &rd, POLL_MAX) == 0) {
+			usleep(conf.deadline_us < 1000 ? (useconds_t)(conf.deadline_us / 2 + 1) : 500);
+		}
+
+		now = (uint64_t)time(NULL);
+		if (now - last >= STATS_SEC) {
+			if (last != 0) {
+				print_stats(pub);
+			}
+			last = now;
+		}
+	}
+
+	print_stats(pub);
+	ring_reader_fini(&rd);
+	redis_pub_destroy(pub);
+	bus_close(&bus);
+
+	return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * ctp.c
+ *
+ * The functions are used to receive the depth market data of the CTP MdApi.
+ * The SPI thread of the API only copies every depth struct into the next
+ * preallocated slot of the receive ring, in constant time and without a
+ * lock or an allocation, so a slow consumer can never delay the ticks after
+ * it; the decode thread turns the slots into tick records with ctp_decoder.
+ *
+ * A manager thread drives the session: it logs in when a front connects,
+ * subscribes all instruments in chunks, and moves to the next front when
+ * the current one is not logged in within failover_ms, after a refused
+ * login or a disconnect the API does not recover from in time.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "raw.h"
+#include "ctp_api.h"
+#include "tick.h"
+
+#define SUBSCRIBE_CHUNK		500	/* instruments of a SubscribeMarketData() */
+#define MANAGE_US		10000
+#define FAILOVER_MS		5000
+
+/* events of the SPI thread for the manager */
+#define EV_CONNECTED		0x0001
+#define EV_DISCONNECTED		0x0002
+#define EV_LOGIN		0x0004
+#define EV_LOGIN_FAIL		0x0008
+
+enum ctp_state {
+	CTP_S_CONNECTING = 0,
+	CTP_S_LOGIN,
+	CTP_S_LIVE,
+};
+
+struct ctp_rx
+{
+	struct ctp_conf conf;
+	raw_ring_t ring;
+
+	void *api;
+	int front;		/* index of the current front */
+	int state;		/* enum ctp_state, of the manager */
+	uint64_t deadline;	/* to be live on the front, ns */
+	int request_id;
+	_Atomic uint32_t events;	/* EV_*, set by the SPI thread */
+
+	pthread_t thread;
+	_Atomic int running;
+
+	/* written by the SPI thread, or by the manager for the session */
+	_Atomic uint64_t packets;
+	_Atomic uint64_t ring_full;
+	_Atomic uint64_t subscribed;
+	_Atomic uint64_t sub_errors;
+	struct ctp_stats stats;
+};
+
+static inline uint64_t
+wall_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void
+ctp_on_depth(struct ctp_rx *rx, const void *md, size_t len)
+{
+	raw_pkt_t *pkt;
+
+	if (__builtin_expect(raw_ring_claim(&rx->ring, &pkt, 1) == 0 || len > RAW_PKT_MAX, 0)) {
+		atomic_fetch_add_explicit(&rx->ring_full, 1, memory_order_relaxed);
+		return;
+	}
+
+	pkt->hw_ts = 0;
+	pkt->sw_ts = wall_ns();
+	pkt->len = (uint32_t)len;
+	pkt->group = (uint16_t)rx->front;
+	pkt->flags = 0;
+	pkt->drops = 0;
+	memcpy(pkt->data, md, len);
+	raw_ring_publish(&rx->ring, 1);
+
+	atomic_store_explicit(&rx->packets, atomic_load_explicit(&rx->packets, memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+}
+
+void
+ctp_on_connected(struct ctp_rx *rx)
+{
+	/* every MdApi runs a new SPI thread */
+	raw_pin_cpu(rx->conf.cpu);
+	atomic_fetch_or(&rx->events, EV_CONNECTED);
+}
+
+void
+ctp_on_disconnected(struct ctp_rx *rx, int reason)
+{
+	fprintf(stderr, "ctp front %s disconnected: 0x%x\n", rx->conf.fronts[rx->front], reason);
+	atomic_fetch_or(&rx->events, EV_DISCONNECTED);
+}
+
+void
+ctp_on_login(struct ctp_rx *rx, int error, const char *msg)
+{
+	if (error != 0) {
+		fprintf(stderr, "ctp login to %s refused: %d %s\n", rx->conf.fronts[rx->front], error,
+			msg != NULL ? msg : "");
+		atomic_fetch_or(&rx->events, EV_LOGIN_FAIL);
+		return;
+	}
+	atomic_fetch_or(&rx->events, EV_LOGIN);
+}
+
+void
+ctp_on_subscribed(struct ctp_rx *rx, const char *instrument, int error)
+{
+	if (error != 0) {
+		fprintf(stderr, "ctp subscription of %s refused: %d\n", instrument != NULL ? instrument : "?",
+			error);
+		atomic_fetch_add_explicit(&rx->sub_errors, 1, memory_order_relaxed);
+		return;
+	}
+	atomic_fetch_add_explicit(&rx->subscribed, 1, memory_order_relaxed);
+}
+
+int
+ctp_open(struct ctp_rx **rx, const struct ctp_conf *conf)
+{
+	struct ctp_rx *r;
+	size_t i;
+
+	*rx = NULL;
+	if (conf->nfronts <= 0 || conf->nfronts > CTP_FRONT_MAX || conf->ninstruments == 0) {
+		fprintf(stderr, "ctp needs 1 to %d fronts and instruments\n", CTP_FRONT_MAX);
+		return -1;
+	}
+
+	if ((r = calloc(1, sizeof(*r))) == NULL) {
+		return -1;
+	}
+	r->conf = *conf;
+	if (r->conf.failover_ms == 0) {
+		r->conf.failover_ms = FAILOVER_MS;
+	}
+	if (r->conf.flow_dir == NULL) {
+		r->conf.flow_dir = "";
+	}
+	if (raw_ring_init(&r->ring, conf->nslots ? conf->nslots : 65536) != 0) {
+		fprintf(stderr, "cannot allocate the ctp receive ring\n");
+		free(r);
+		return -1;
+	}
+
+	/* the ids exist before the first tick, tick_intern() of the decoder finds them without the lock */
+	for (i = 0; i < conf->ninstruments; i++) {
+		if (tick_intern(conf->instruments[i], strlen(conf->instruments[i])) == 0) {
+			fprintf(stderr, "too many instruments, %s not interned\n", conf->instruments[i]);
+		}
+	}
+
+	*rx = r;
+
+	return 0;
+}
+
+static int
+connect_front(struct ctp_rx *rx)
+{
+	atomic_store(&rx->events, 0);
+	rx->state = CTP_S_CONNECTING;
+	rx->deadline = mono_ns() + rx->conf.failover_ms * 1000000ULL;
+	rx->api = ctp_api_create(rx, rx->conf.flow_dir, rx->conf.fronts[rx->front]);
+
+	return rx->api != NULL ? 0 : -1;
+}
+
+static void
+failover(struct ctp_rx *rx)
+{
+	fprintf(stderr, "ctp front %s not live, trying the next\n", rx->conf.fronts[rx->front]);
+	ctp_api_release(rx->api);
+	rx->api = NULL;
+	rx->front = (rx->front + 1) % rx->conf.nfronts;
+	rx->stats.failovers++;
+	connect_front(rx);
+}
+
+static void
+subscribe(struct ctp_rx *rx)
+{
+	size_t i, n;
+
+	for (i = 0; i < rx->conf.ninstruments; i += n) {
+		n = rx->conf.ninstruments - i < SUBSCRIBE_CHUNK ? rx->conf.ninstruments - i : SUBSCRIBE_CHUNK;
+		if (ctp_api_subscribe(rx->api, rx->conf.instruments + i, (int)n) != 0) {
+			fprintf(stderr, "ctp subscription of %zu instruments failed\n", n);
+		}
+	}
+}
+
+static void *
+manage_thread(void *arg)
+{
+	struct ctp_rx *rx = arg;
+	uint32_t ev;
+
+	while (atomic_load_explicit(&rx->running, memory_order_relaxed)) {
+		ev = atomic_exchange(&rx->events, 0);
+
+		if (ev & EV_DISCONNECTED) {
+			/* the API reconnects to the same front, it gets failover_ms for it */
+			rx->stats.disconnects++;
+			if (rx->state == CTP_S_LIVE || rx->state == CTP_S_LOGIN) {
+				rx->deadline = mono_ns() + rx->conf.failover_ms * 1000000ULL;
+			}
+			rx->state = CTP_S_CONNECTING;
+		}
+		if (ev & EV_CONNECTED) {
+			rx->stats.connects++;
+			rx->state = CTP_S_LOGIN;
+			if (ctp_api_login(rx->api, rx->conf.broker, rx->conf.user, rx->conf.password,
+					  ++rx->request_id) != 0) {
+				ev |= EV_LOGIN_FAIL;
+			}
+		}
+		if (ev & EV_LOGIN_FAIL) {
+			failover(rx);
+			continue;
+		}
+		if ((ev & EV_LOGIN) && rx->state == CTP_S_LOGIN) {
+			rx->stats.logins++;
+			subscribe(rx);
+			rx->state = CTP_S_LIVE;
+		}
+
+		if (rx->state != CTP_S_LIVE && mono_ns() >= rx->deadline) {
+			failover(rx);
+		}
+
+		usleep(MANAGE_US);
+	}
+
+	return NULL;
+}
+
+int
+ctp_start(struct ctp_rx *rx)
+{
+	if (rx == NULL || connect_front(rx) != 0) {
+		return -1;
+	}
+
+	atomic_store(&rx->running, 1);
+	if (pthread_create(&rx->thread, NULL, manage_thread, rx) != 0) {
+		atomic_store(&rx->running, 0);
+		ctp_api_release(rx->api);
+		rx->api = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+ctp_stop(struct ctp_rx *rx)
+{
+	if (rx == NULL || !atomic_load(&rx->running)) {
+		return;
+	}
+
+	atomic_store(&rx->running, 0);
+	pthread_join(rx->thread, NULL);
+
+	/* the SPI thread is joined by the release, nothing writes the ring after it */
+	ctp_api_release(rx->api);
+	rx->api = NULL;
+}
+
+void
+ctp_close(struct ctp_rx *rx)
+{
+	if (rx == NULL) {
+		return;
+	}
+
+	ctp_stop(rx);
+	raw_ring_destroy(&rx->ring);
+	free(rx);
+}
+
+raw_ring_t *
+ctp_ring(struct ctp_rx *rx)
+{
+	return &rx->ring;
+}
+
+/*
+ * ctp_get_stats - copy the counters of the source. The session counters are
+ * written by the manager thread without locking, so they are approximate
+ * while it runs.
+ */
+void
+ctp_get_stats(struct ctp_rx *rx, struct ctp_stats *stats)
+{
+	*stats = rx->stats;
+	stats->packets = atomic_load_explicit(&rx->packets, memory_order_relaxed);
+	stats->ring_full = atomic_load_explicit(&rx->ring_full, memory_order_relaxed);
+	stats->subscribed = atomic_load_explicit(&rx->subscribed, memory_order_relaxed);
+	stats->sub_errors = atomic_load_explicit(&rx->sub_errors, memory_order_relaxed);
+}
+
+#ifndef TICK_CTP_SDK
+
+/* built without the CTP SDK, see CTP_SDK_DIR */
+
+void *
+ctp_api_create(struct ctp_rx *rx, const char *flow_dir, const char *front)
+{
+	(void)rx;
+	(void)flow_dir;
+	(void)front;
+	fprintf(stderr, "built without the CTP SDK, set CTP_SDK_DIR\n");
+
+	return NULL;
+}
+
+void
+ctp_api_release(void *api)
+{
+	(void)api;
+}
+
+int
+ctp_api_login(void *api, const char *broker, const char *user, const char *password, int request_id)
+{
+	(void)api;
+	(void)broker;
+	(void)user;
+	(void)password;
+	(void)request_id;
+
+	return -1;
+}
+
+int
+ctp_api_subscribe(void *api, char **instruments, int n)
+{
+	(void)api;
+	(void)instruments;
+	(void)n;
+
+	return -1;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * ctp_api.h
+ *
+ * The file contains the boundary between the CTP source in C and the C++
+ * shim over the MdApi of the CTP SDK (ctp_spi.cpp): the calls into the API
+ * and the events its SPI gives back. Without the SDK the calls fail.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __CTP_API_H__
+#define __CTP_API_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ctp_rx;
+
+/*
+ * ctp_api_create - a new MdApi connecting to the front, its SPI reporting
+ * to rx. Returns NULL on failure.
+ */
+void *ctp_api_create(struct ctp_rx *rx, const char *flow_dir, const char *front);
+void ctp_api_release(void *api);
+
+int ctp_api_login(void *api, const char *broker, const char *user, const char *password,
+		  int request_id);
+int ctp_api_subscribe(void *api, char **instruments, int n);
+
+/* the events of the SPI, on the SPI thread */
+void ctp_on_connected(struct ctp_rx *rx);
+void ctp_on_disconnected(struct ctp_rx *rx, int reason);
+void ctp_on_login(struct ctp_rx *rx, int error, const char *msg);
+void ctp_on_subscribed(struct ctp_rx *rx, const char *instrument, int error);
+
+/*
+ * ctp_on_depth - the hot path: copy the CThostFtdcDepthMarketDataField into
+ * a slot of the receive ring, nothing else.
+ */
+void ctp_on_depth(struct ctp_rx *rx, const void *md, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* __CTP_API_H__ */
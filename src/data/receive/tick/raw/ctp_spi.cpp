@@ -0,0 +1,137 @@
+/*
+ * ctp_spi.cpp
+ *
+ * The shim over the MdApi of the CTP SDK: the SPI hands its events to the
+ * CTP source of ctp.c and the depth market data straight to its ring. It
+ * is built only with CTP_SDK_DIR, the directory of ThostFtdcMdApi.h and
+ * the thostmduserapi_se library.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "ThostFtdcMdApi.h"
+#include "ctp_api.h"
+
+class ctp_spi : public CThostFtdcMdSpi
+{
+public:
+	explicit ctp_spi(struct ctp_rx *rx) : rx(rx) {}
+
+	void OnFrontConnected() override
+	{
+		ctp_on_connected(rx);
+	}
+
+	void OnFrontDisconnected(int nReason) override
+	{
+		ctp_on_disconnected(rx, nReason);
+	}
+
+	void OnRspUserLogin(CThostFtdcRspUserLoginField *, CThostFtdcRspInfoField *pRspInfo,
+			    int, bool) override
+	{
+		ctp_on_login(rx, pRspInfo != NULL ? pRspInfo->ErrorID : 0,
+			     pRspInfo != NULL ? pRspInfo->ErrorMsg : NULL);
+	}
+
+	void OnRspSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument,
+				CThostFtdcRspInfoField *pRspInfo, int, bool) override
+	{
+		ctp_on_subscribed(rx, pSpecificInstrument != NULL ? pSpecificInstrument->InstrumentID : NULL,
+				  pRspInfo != NULL ? pRspInfo->ErrorID : 0);
+	}
+
+	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData) override
+	{
+		if (pDepthMarketData != NULL) {
+			ctp_on_depth(rx, pDepthMarketData, sizeof(*pDepthMarketData));
+		}
+	}
+
+private:
+	struct ctp_rx *rx;
+};
+
+struct ctp_api
+{
+	CThostFtdcMdApi *api;
+	ctp_spi *spi;
+	char front[256];
+};
+
+void *
+ctp_api_create(struct ctp_rx *rx, const char *flow_dir, const char *front)
+{
+	ctp_api *a = new (std::nothrow) ctp_api;
+
+	if (a == NULL) {
+		return NULL;
+	}
+	if ((a->api = CThostFtdcMdApi::CreateFtdcMdApi(flow_dir)) == NULL) {
+		fprintf(stderr, "cannot create the ctp md api\n");
+		delete a;
+		return NULL;
+	}
+	if ((a->spi = new (std::nothrow) ctp_spi(rx)) == NULL) {
+		fprintf(stderr, "cannot allocate the ctp spi\n");
+		a->api->Release();
+		delete a;
+		return NULL;
+	}
+	snprintf(a->front, sizeof(a->front), "%s", front);
+
+	a->api->RegisterSpi(a->spi);
+	a->api->RegisterFront(a->front);
+	a->api->Init();
+
+	return a;
+}
+
+void
+ctp_api_release(void *p)
+{
+	ctp_api *a = static_cast<ctp_api *>(p);
+
+	if (a == NULL) {
+		return;
+	}
+
+	/* Release() joins the threads of the api, no event comes after it */
+	a->api->RegisterSpi(NULL);
+	a->api->Release();
+	delete a->spi;
+	delete a;
+}
+
+int
+ctp_api_login(void *p, const char *broker, const char *user, const char *password, int request_id)
+{
+	ctp_api *a = static_cast<ctp_api *>(p);
+	CThostFtdcReqUserLoginField req;
+
+	if (a == NULL) {
+		return -1;
+	}
+
+	memset(&req, 0, sizeof(req));
+	snprintf(req.BrokerID, sizeof(req.BrokerID), "%s", broker != NULL ? broker : "");
+	snprintf(req.UserID, sizeof(req.UserID), "%s", user != NULL ? user : "");
+	snprintf(req.Password, sizeof(req.Password), "%s", password != NULL ? password : "");
+
+	return a->api->ReqUserLogin(&req, request_id) == 0 ? 0 : -1;
+}
+
+int
+ctp_api_subscribe(void *p, char **instruments, int n)
+{
+	ctp_api *a = static_cast<ctp_api *>(p);
+
+	if (a == NULL) {
+		return -1;
+	}
+
+	return a->api->SubscribeMarketData(instruments, n) == 0 ? 0 : -1;
+}
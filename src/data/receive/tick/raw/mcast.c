@@ -0,0 +1,544 @@
+/*
+ * mcast.c
+ *
+ * The functions are used to receive the market data that exchange fronts
+ * (SHFE/INE, DCE, CZCE, CFFEX) publish as UDP multicast. The receive thread
+ * joins all groups, drains the sockets with batched recvmmsg() straight into
+ * the preallocated slots of the receive ring, and stamps every datagram with
+ * the hardware or kernel receive time from SO_TIMESTAMPING.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <linux/errqueue.h>
+#include "raw.h"
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL	46
+#endif
+
+#define CMSG_SPACE_SZ	(CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t)))
+
+struct mcast_sock
+{
+	int fd;
+	uint32_t drops;		/* last SO_RXQ_OVFL value of the socket */
+};
+
+struct mcast_rx
+{
+	struct mcast_conf conf;
+	const struct raw_backend *backend;
+	raw_ring_t ring;
+
+	struct mcast_sock socks[RAW_GROUP_MAX];
+	int nsocks;
+	int next_sock;		/* socket to drain first, for fairness between groups */
+	int epfd;
+
+	/* recvmmsg() arguments, set up once and reused for every batch */
+	struct mmsghdr msgs[RAW_BATCH];
+	struct iovec iovs[RAW_BATCH];
+	uint8_t cmsgs[RAW_BATCH][CMSG_SPACE_SZ] __attribute__((aligned(8)));
+
+	void *priv;		/* private state of a kernel-bypass backend */
+
+	pthread_t thread;
+	_Atomic int running;
+	_Atomic int failed;	/* the receive thread stopped on a backend error */
+
+	struct mcast_stats stats;
+};
+
+static int sock_open(struct mcast_rx *rx);
+static int sock_recv(struct mcast_rx *rx, raw_pkt_t **pkts, int n);
+static int sock_wait(struct mcast_rx *rx, int timeout_ms);
+static void sock_close(struct mcast_rx *rx);
+
+/*
+ * The receive backends. An ef_vi or DPDK path adds its entry here and fills
+ * the claimed slots from its own rings.
+ */
+static const struct raw_backend backends[] = {
+	{ "socket", sock_open, sock_recv, sock_wait, sock_close },
+};
+
+static const struct raw_backend *
+find_backend(const char *name)
+{
+	size_t i;
+
+	if (name == NULL) {
+		return &backends[0];
+	}
+
+	for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+		if (strcmp(backends[i].name, name) == 0) {
+			return &backends[i];
+		}
+	}
+
+	return NULL;
+}
+
+static inline uint64_t
+ts2ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+/*
+ * enable_hw_timestamp - switch on receive timestamping of all packets in the
+ * NIC. It needs CAP_NET_ADMIN; without it we fall back to kernel timestamps.
+ */
+static int
+enable_hw_timestamp(int fd, const char *ifname)
+{
+	struct hwtstamp_config cfg;
+	struct ifreq ifr;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_type = HWTSTAMP_TX_OFF;
+	cfg.rx_filter = HWTSTAMP_FILTER_ALL;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name) - 1);
+	ifr.ifr_data = (void *)&cfg;
+
+	if (ioctl(fd, SIOCSHWTSTAMP, &ifr) < 0) {
+		fprintf(stderr, "SIOCSHWTSTAMP on %s failed: %s, using kernel timestamps\n",
+			ifname, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+join_group(int fd, const struct mcast_group *g, struct in_addr ifaddr)
+{
+	if (g->source != NULL) {
+		struct ip_mreq_source mreq;
+
+		memset(&mreq, 0, sizeof(mreq));
+		if (inet_pton(AF_INET, g->addr, &mreq.imr_multiaddr) != 1 ||
+		    inet_pton(AF_INET, g->source, &mreq.imr_sourceaddr) != 1) {
+			return -1;
+		}
+		mreq.imr_interface = ifaddr;
+
+		return setsockopt(fd, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP, &mreq, sizeof(mreq));
+	} else {
+		struct ip_mreq mreq;
+
+		memset(&mreq, 0, sizeof(mreq));
+		if (inet_pton(AF_INET, g->addr, &mreq.imr_multiaddr) != 1) {
+			return -1;
+		}
+		mreq.imr_interface = ifaddr;
+
+		return setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+	}
+}
+
+/*
+ * sock_open - open one socket per group. Each socket is bound to the group
+ * address, so the kernel only delivers datagrams of that group to it and the
+ * slot knows which group (channel) a datagram came from.
+ */
+static int
+sock_open(struct mcast_rx *rx)
+{
+	const struct mcast_conf *conf = &rx->conf;
+	struct in_addr ifaddr;
+	struct epoll_event ev;
+	int i, one = 1, hwts = 0;
+
+	ifaddr.s_addr = htonl(INADDR_ANY);
+	if (conf->ifaddr != NULL && inet_pton(AF_INET, conf->ifaddr, &ifaddr) != 1) {
+		fprintf(stderr, "invalid interface address %s\n", conf->ifaddr);
+		return -1;
+	}
+
+	rx->epfd = epoll_create1(0);
+	if (rx->epfd < 0) {
+		return -1;
+	}
+
+	for (i = 0; i < conf->ngroups; i++) {
+		const struct mcast_group *g = &conf->groups[i];
+		struct sockaddr_in sa;
+		int flags, fd;
+
+		fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+		if (fd < 0) {
+			return -1;
+		}
+		rx->socks[rx->nsocks].fd = fd;
+		rx->socks[rx->nsocks].drops = 0;
+		rx->nsocks++;
+
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+		if (conf->rcvbuf > 0 &&
+		    setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &conf->rcvbuf, sizeof(conf->rcvbuf)) < 0) {
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &conf->rcvbuf, sizeof(conf->rcvbuf));
+		}
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(g->port);
+		if (inet_pton(AF_INET, g->addr, &sa.sin_addr) != 1) {
+			fprintf(stderr, "invalid group address %s\n", g->addr);
+			return -1;
+		}
+
+		if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+			fprintf(stderr, "bind(%s:%u) failed: %s\n", g->addr, g->port, strerror(errno));
+			return -1;
+		}
+
+		if (join_group(fd, g, ifaddr) < 0) {
+			fprintf(stderr, "join %s failed: %s\n", g->addr, strerror(errno));
+			return -1;
+		}
+
+		if (conf->hw_timestamp && conf->ifname != NULL && i == 0) {
+			hwts = enable_hw_timestamp(fd, conf->ifname) == 0;
+		}
+
+		flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+		if (hwts) {
+			flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+		}
+		if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+			fprintf(stderr, "SO_TIMESTAMPING failed: %s\n", strerror(errno));
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+
+		if (conf->busy_poll) {
+			int usec = 50;
+
+			setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+		}
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.u32 = (uint32_t)i;
+		if (epoll_ctl(rx->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+parse_cmsg(struct mcast_rx *rx, struct mcast_sock *s, struct msghdr *mh, raw_pkt_t *pkt)
+{
+	struct cmsghdr *cm;
+
+	pkt->hw_ts = 0;
+	pkt->sw_ts = 0;
+	pkt->flags = 0;
+
+	for (cm = CMSG_FIRSTHDR(mh); cm != NULL; cm = CMSG_NXTHDR(mh, cm)) {
+		if (cm->cmsg_level != SOL_SOCKET) {
+			continue;
+		}
+
+		if (cm->cmsg_type == SCM_TIMESTAMPING) {
+			struct scm_timestamping tss;
+
+			memcpy(&tss, CMSG_DATA(cm), sizeof(tss));
+			pkt->sw_ts = ts2ns(&tss.ts[0]);
+			if (tss.ts[2].tv_sec != 0 || tss.ts[2].tv_nsec != 0) {
+				pkt->hw_ts = ts2ns(&tss.ts[2]);
+				pkt->flags |= RAW_F_HWTS;
+			}
+		} else if (cm->cmsg_type == SO_RXQ_OVFL) {
+			uint32_t drops;
+
+			memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+			if (drops != s->drops) {
+				rx->stats.kernel_drops += (uint32_t)(drops - s->drops);
+				s->drops = drops;
+			}
+		}
+	}
+
+	pkt->drops = s->drops;
+}
+
+/*
+ * sock_recv - drain the sockets round-robin into the claimed slots with one
+ * recvmmsg() per socket, until the slots are used up or every socket is
+ * empty.
+ */
+static int
+sock_recv(struct mcast_rx *rx, raw_pkt_t **pkts, int n)
+{
+	int filled = 0, tried, i, got;
+
+	for (tried = 0; tried < rx->nsocks && filled < n; tried++) {
+		int idx = rx->next_sock;
+		struct mcast_sock *s = &rx->socks[idx];
+		int want = n - filled;
+
+		rx->next_sock = idx + 1 == rx->nsocks ? 0 : idx + 1;
+
+		for (i = 0; i < want; i++) {
+			struct msghdr *mh = &rx->msgs[i].msg_hdr;
+
+			rx->iovs[i].iov_base = pkts[filled + i]->data;
+			rx->iovs[i].iov_len = RAW_PKT_MAX;
+			mh->msg_name = NULL;
+			mh->msg_namelen = 0;
+			mh->msg_iov = &rx->iovs[i];
+			mh->msg_iovlen = 1;
+			mh->msg_control = rx->cmsgs[i];
+			mh->msg_controllen = CMSG_SPACE_SZ;
+			mh->msg_flags = 0;
+		}
+
+		got = recvmmsg(s->fd, rx->msgs, (unsigned int)want, MSG_DONTWAIT, NULL);
+		if (got <= 0) {
+			if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				return -1;
+			}
+			continue;
+		}
+
+		for (i = 0; i < got; i++) {
+			raw_pkt_t *pkt = pkts[filled + i];
+			struct msghdr *mh = &rx->msgs[i].msg_hdr;
+
+			parse_cmsg(rx, s, mh, pkt);
+			pkt->len = rx->msgs[i].msg_len;
+			pkt->group = (uint16_t)idx;
+			if (mh->msg_flags & MSG_TRUNC) {
+				pkt->flags |= RAW_F_TRUNC;
+				pkt->len = RAW_PKT_MAX;
+				rx->stats.truncated++;
+			}
+			rx->stats.bytes += pkt->len;
+		}
+
+		rx->stats.batches++;
+		filled += got;
+	}
+
+	return filled;
+}
+
+static int
+sock_wait(struct mcast_rx *rx, int timeout_ms)
+{
+	struct epoll_event evs[RAW_GROUP_MAX];
+
+	return epoll_wait(rx->epfd, evs, RAW_GROUP_MAX, timeout_ms);
+}
+
+static void
+sock_close(struct mcast_rx *rx)
+{
+	int i;
+
+	for (i = 0; i < rx->nsocks; i++) {
+		close(rx->socks[i].fd);
+	}
+	rx->nsocks = 0;
+
+	if (rx->epfd >= 0) {
+		close(rx->epfd);
+		rx->epfd = -1;
+	}
+}
+
+/*
+ * mcast_open - create a multicast receiver, allocate its receive ring and
+ * join all the configured groups. No memory is allocated after this call.
+ */
+int
+mcast_open(struct mcast_rx **prx, const struct mcast_conf *conf)
+{
+	struct mcast_rx *rx;
+	const struct raw_backend *be;
+
+	if (prx == NULL || conf == NULL || conf->ngroups <= 0 || conf->ngroups > RAW_GROUP_MAX) {
+		return -1;
+	}
+
+	be = find_backend(conf->backend);
+	if (be == NULL) {
+		fprintf(stderr, "unknown receive backend %s\n", conf->backend);
+		return -1;
+	}
+
+	rx = (struct mcast_rx *)aligned_alloc(RAW_CACHELINE,
+		(sizeof(*rx) + RAW_CACHELINE - 1) & ~(size_t)(RAW_CACHELINE - 1));
+	if (rx == NULL) {
+		return -2;
+	}
+
+	memset(rx, 0, sizeof(*rx));
+	rx->conf = *conf;
+	rx->backend = be;
+	rx->epfd = -1;
+	atomic_init(&rx->running, 0);
+	atomic_init(&rx->failed, 0);
+
+	if (raw_ring_init(&rx->ring, conf->nslots ? conf->nslots : 65536) != 0) {
+		free(rx);
+		return -2;
+	}
+
+	if (be->open(rx) != 0) {
+		be->close(rx);
+		raw_ring_destroy(&rx->ring);
+		free(rx);
+		return -3;
+	}
+
+	*prx = rx;
+
+	return 0;
+}
+
+/*
+ * mcast_poll - claim free slots and fill them from the backend once. It
+ * returns the number of datagrams published, and is called either by the
+ * receive thread or by a caller that owns the thread itself.
+ */
+int
+mcast_poll(struct mcast_rx *rx)
+{
+	raw_pkt_t *pkts[RAW_BATCH];
+	size_t n;
+	int got;
+
+	n = raw_ring_claim(&rx->ring, pkts, RAW_BATCH);
+	if (n == 0) {
+		rx->stats.ring_full++;
+		return 0;
+	}
+
+	got = rx->backend->recv(rx, pkts, (int)n);
+	if (got > 0) {
+		raw_ring_publish(&rx->ring, (size_t)got);
+		rx->stats.packets += (uint64_t)got;
+	}
+
+	return got;
+}
+
+static void *
+rx_thread(void *arg)
+{
+	struct mcast_rx *rx = (struct mcast_rx *)arg;
+
+	raw_pin_cpu(rx->conf.cpu);
+
+	while (atomic_load_explicit(&rx->running, memory_order_relaxed)) {
+		int got = mcast_poll(rx);
+
+		if (got < 0) {
+			fprintf(stderr, "receive backend %s failed: %s\n", rx->backend->name, strerror(errno));
+			atomic_store_explicit(&rx->failed, 1, memory_order_release);
+			break;
+		}
+
+		if (got == 0 && !rx->conf.busy_poll) {
+			rx->backend->wait(rx, 100);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * mcast_start - start the receive thread pinned to the configured core.
+ */
+int
+mcast_start(struct mcast_rx *rx)
+{
+	if (rx == NULL) {
+		return -1;
+	}
+
+	atomic_store(&rx->running, 1);
+	if (pthread_create(&rx->thread, NULL, rx_thread, rx) != 0) {
+		atomic_store(&rx->running, 0);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+mcast_stop(struct mcast_rx *rx)
+{
+	if (rx == NULL || !atomic_load(&rx->running)) {
+		return;
+	}
+
+	atomic_store(&rx->running, 0);
+	pthread_join(rx->thread, NULL);
+}
+
+void
+mcast_close(struct mcast_rx *rx)
+{
+	if (rx == NULL) {
+		return;
+	}
+
+	mcast_stop(rx);
+	rx->backend->close(rx);
+	raw_ring_destroy(&rx->ring);
+	free(rx);
+}
+
+/*
+ * mcast_failed - whether the receive thread stopped on an error of its
+ * backend, no more packets come then.
+ */
+int
+mcast_failed(struct mcast_rx *rx)
+{
+	return atomic_load_explicit(&rx->failed, memory_order_acquire);
+}
+
+raw_ring_t *
+mcast_ring(struct mcast_rx *rx)
+{
+	return &rx->ring;
+}
+
+/*
+ * mcast_get_stats - copy the counters of the receiver. They are written by the
+ * receive thread only and read here without locking, so they are approximate
+ * while the receiver runs.
+ */
+void
+mcast_get_stats(struct mcast_rx *rx, struct mcast_stats *stats)
+{
+	memcpy(stats, &rx->stats, sizeof(*stats));
+}
@@ -0,0 +1,172 @@
+/*
+ * raw.c
+ *
+ * The functions are used to manage the receive ring of packet slots shared by
+ * the raw sources, and to pin the receive threads to their cores.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "raw.h"
+
+#define HUGEPAGE_SIZE	(2UL * 1024 * 1024)
+
+static size_t
+round_pow2(size_t n)
+{
+	size_t p = 1;
+
+	while (p < n) {
+		p <<= 1;
+	}
+
+	return p;
+}
+
+/*
+ * raw_ring_init - allocate the slots of the ring up front. The memory is
+ * backed by huge pages when the system has them, prefaulted and locked, so
+ * no page fault ever happens on the receive path.
+ */
+int
+raw_ring_init(raw_ring_t *ring, size_t nslots)
+{
+	size_t size;
+	void *p;
+
+	if (ring == NULL || nslots == 0) {
+		return -1;
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	nslots = round_pow2(nslots);
+	size = nslots * sizeof(raw_pkt_t);
+	size = (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p == MAP_FAILED) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			return -2;
+		}
+		madvise(p, size, MADV_HUGEPAGE);
+	}
+
+	memset(p, 0, size);
+	mlock(p, size);
+
+	ring->slots = (raw_pkt_t *)p;
+	ring->map_size = size;
+	ring->mask = nslots - 1;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+
+	return 0;
+}
+
+void
+raw_ring_destroy(raw_ring_t *ring)
+{
+	if (ring == NULL || ring->slots == NULL) {
+		return;
+	}
+
+	munlock(ring->slots, ring->map_size);
+	munmap(ring->slots, ring->map_size);
+	ring->slots = NULL;
+}
+
+size_t
+raw_ring_claim(raw_ring_t *ring, raw_pkt_t **pkts, size_t n)
+{
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint64_t size = ring->mask + 1;
+	size_t i, avail;
+
+	avail = size - (head - ring->tail_cache);
+	if (avail < n) {
+		ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		avail = size - (head - ring->tail_cache);
+	}
+
+	if (n > avail) {
+		n = avail;
+	}
+
+	for (i = 0; i < n; i++) {
+		pkts[i] = &ring->slots[(head + i) & ring->mask];
+	}
+
+	return n;
+}
+
+void
+raw_ring_publish(raw_ring_t *ring, size_t n)
+{
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	atomic_store_explicit(&ring->head, head + n, memory_order_release);
+}
+
+size_t
+raw_ring_peek(raw_ring_t *ring, raw_pkt_t **pkts, size_t n)
+{
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t i, avail;
+
+	avail = ring->head_cache - tail;
+	if (avail < n) {
+		ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+		avail = ring->head_cache - tail;
+	}
+
+	if (n > avail) {
+		n = avail;
+	}
+
+	for (i = 0; i < n; i++) {
+		pkts[i] = &ring->slots[(tail + i) & ring->mask];
+	}
+
+	return n;
+}
+
+void
+raw_ring_release(raw_ring_t *ring, size_t n)
+{
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+}
+
+/*
+ * raw_pin_cpu - pin the calling thread to the specific core. The core is
+ * expected to be isolated (isolcpus/nohz_full) so nothing else runs there.
+ */
+int
+raw_pin_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	if (cpu < 0) {
+		return 0;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		fprintf(stderr, "pthread_setaffinity_np(%d) failed\n", cpu);
+		return -1;
+	}
+
+	return 0;
+}
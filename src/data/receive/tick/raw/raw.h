@@ -0,0 +1,281 @@
+/*
+ * raw.h
+ *
+ * The file contains the definition of the raw packet slots and the receive
+ * ring shared by the raw sources (multicast, udp, ctp), and the functions'
+ * prototype of the multicast receiver, of the sequencer recovering its gaps
+ * and of the CTP source.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __RAW_H__
+#define __RAW_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define RAW_CACHELINE		64
+
+#define RAW_SLOT_SIZE		2048	/* one slot holds one datagram, fits a 1500 MTU */
+#define RAW_SLOT_HDR		32
+#define RAW_PKT_MAX		(RAW_SLOT_SIZE - RAW_SLOT_HDR)
+
+#define RAW_BATCH		64	/* datagrams per recvmmsg() call */
+#define RAW_GROUP_MAX		32	/* multicast groups per receiver */
+
+/* flags of raw_pkt */
+#define RAW_F_HWTS		0x0001	/* hw_ts is a NIC hardware timestamp */
+#define RAW_F_TRUNC		0x0002	/* datagram was larger than RAW_PKT_MAX */
+#define RAW_F_RECOVERED		0x0004	/* retransmitted by the recovery service */
+
+/*
+ * raw_pkt - one fixed-size slot of the receive ring. recvmmsg() writes the
+ * datagram straight into data[], so the hot path never copies or allocates.
+ */
+typedef struct raw_pkt
+{
+	uint64_t hw_ts;		/* hardware receive timestamp in ns, 0 if unavailable */
+	uint64_t sw_ts;		/* kernel receive timestamp in ns */
+	uint32_t len;		/* length of the datagram in data[] */
+	uint16_t group;		/* index of the group in mcast_conf */
+	uint16_t flags;		/* RAW_F_* */
+	uint32_t drops;		/* kernel drops seen on the socket so far (SO_RXQ_OVFL) */
+	uint32_t reserved;
+	uint8_t data[RAW_PKT_MAX];
+} __attribute__((aligned(RAW_CACHELINE))) raw_pkt_t;
+
+/*
+ * raw_ring - single producer (receive thread), single consumer (decoder)
+ * ring of preallocated packet slots. head and tail live on their own cache
+ * lines so the two threads never false-share.
+ */
+typedef struct raw_ring
+{
+	_Atomic uint64_t head __attribute__((aligned(RAW_CACHELINE)));	/* next slot to fill */
+	uint64_t tail_cache;	/* producer's last view of tail */
+
+	_Atomic uint64_t tail __attribute__((aligned(RAW_CACHELINE)));	/* next slot to consume */
+	uint64_t head_cache;	/* consumer's last view of head */
+
+	uint64_t mask __attribute__((aligned(RAW_CACHELINE)));
+	raw_pkt_t *slots;
+	size_t map_size;
+} raw_ring_t;
+
+int raw_ring_init(raw_ring_t *ring, size_t nslots);
+void raw_ring_destroy(raw_ring_t *ring);
+
+/*
+ * raw_ring_peek - get up to n filled slots without consuming them, returns
+ * the number of slots stored in pkts.
+ */
+size_t raw_ring_peek(raw_ring_t *ring, raw_pkt_t **pkts, size_t n);
+
+/*
+ * raw_ring_release - give n slots returned by raw_ring_peek() back to the
+ * producer.
+ */
+void raw_ring_release(raw_ring_t *ring, size_t n);
+
+/*
+ * raw_ring_claim - reserve up to n free slots for the producer, returns the
+ * number of slots stored in pkts. raw_ring_publish() makes them visible.
+ */
+size_t raw_ring_claim(raw_ring_t *ring, raw_pkt_t **pkts, size_t n);
+void raw_ring_publish(raw_ring_t *ring, size_t n);
+
+struct mcast_group
+{
+	const char *addr;	/* multicast group, e.g. "233.54.1.1" */
+	uint16_t port;		/* destination port */
+	const char *source;	/* source for SSM joins, NULL for any-source */
+};
+
+struct mcast_conf
+{
+	const char *backend;	/* receive backend, NULL or "socket" for the kernel path */
+	const char *ifaddr;	/* local address of the receive interface */
+	const char *ifname;	/* interface name, required for hardware timestamps */
+
+	struct mcast_group groups[RAW_GROUP_MAX];
+	int ngroups;
+
+	size_t nslots;		/* slots in the receive ring, rounded up to power of 2 */
+	int rcvbuf;		/* SO_RCVBUF in bytes, 0 to keep the system default */
+	int cpu;		/* core the receive thread is pinned to, -1 for none */
+	int busy_poll;		/* spin on the sockets instead of sleeping in epoll */
+	int hw_timestamp;	/* ask the NIC for hardware receive timestamps */
+};
+
+struct mcast_stats
+{
+	uint64_t packets;	/* datagrams stored in the ring */
+	uint64_t bytes;		/* bytes stored in the ring */
+	uint64_t batches;	/* recvmmsg() calls returning data */
+	uint64_t ring_full;	/* times the receiver found no free slot */
+	uint64_t truncated;	/* datagrams larger than RAW_PKT_MAX */
+	uint64_t kernel_drops;	/* SO_RXQ_OVFL counter summed over sockets */
+};
+
+struct mcast_rx;
+
+/*
+ * raw_backend - the receive path of a multicast receiver. The kernel
+ * socket backend is built in; kernel-bypass paths (ef_vi, DPDK) plug in
+ * by adding an entry to the backend table in mcast.c.
+ */
+struct raw_backend
+{
+	const char *name;
+	int (*open)(struct mcast_rx *rx);
+	/* fill up to n claimed slots, returns the number filled or -1 */
+	int (*recv)(struct mcast_rx *rx, raw_pkt_t **pkts, int n);
+	/* block until data may be ready, for the non busy-poll mode */
+	int (*wait)(struct mcast_rx *rx, int timeout_ms);
+	void (*close)(struct mcast_rx *rx);
+};
+
+int mcast_open(struct mcast_rx **rx, const struct mcast_conf *conf);
+int mcast_start(struct mcast_rx *rx);
+int mcast_poll(struct mcast_rx *rx);
+void mcast_stop(struct mcast_rx *rx);
+void mcast_close(struct mcast_rx *rx);
+int mcast_failed(struct mcast_rx *rx);
+
+raw_ring_t *mcast_ring(struct mcast_rx *rx);
+void mcast_get_stats(struct mcast_rx *rx, struct mcast_stats *stats);
+
+#define UDP_CHANNEL_MAX		64	/* channels of the feed sequenced */
+#define UDP_WINDOW		4096	/* packets held behind a gap per channel, 8MB */
+#define UDP_HOLD_MS		50
+
+struct udp_conf
+{
+	int md_type;		/* enum md_type, the decoder reads the sequence numbers */
+
+	/*
+	 * The recovery service, "tcp://host:port" or "udp://host:port", NULL for
+	 * none: the gaps are then only filled by the other line.
+	 */
+	const char *recovery;
+	size_t window;		/* packets held per channel, power of 2, 0 for UDP_WINDOW */
+	uint64_t hold_ms;	/* longest a packet is held behind a gap, 0 for UDP_HOLD_MS */
+	size_t nslots;		/* slots of the ring of recovered packets */
+};
+
+/*
+ * udp_req - a retransmission request to the recovery service, in network
+ * byte order. Over TCP every packet comes back as a 4-byte big-endian length
+ * and the datagram, over UDP as the datagram, both as the lines publish it.
+ */
+struct udp_req
+{
+	uint32_t magic;		/* UDP_REQ_MAGIC */
+	uint16_t channel;
+	uint16_t reserved;
+	uint32_t seq;		/* first packet */
+	uint32_t count;		/* packets from seq */
+};
+
+#define UDP_REQ_MAGIC		0x5152524aU	/* "JRRQ" */
+
+struct udp_stats
+{
+	uint64_t packets;	/* passed on in sequence */
+	uint64_t unsequenced;	/* without a sequence number, passed on as they came */
+	uint64_t duplicates;	/* seen already, the copy of the other line mostly */
+	uint64_t gaps;		/* opened by a missing packet */
+	uint64_t held;		/* packets held */
+	uint64_t recovered;	/* gaps filled by the recovery service */
+	uint64_t lost;		/* packets given up on */
+	uint64_t resets;	/* sequences restarted */
+	uint64_t requests;	/* sent to the recovery service */
+	uint64_t req_drops;	/* requests the queue had no room for */
+	uint64_t connects;	/* to the recovery service */
+};
+
+struct udp_rx;
+
+/* udp_emit - the packets in sequence order, on the thread of udp_input() */
+typedef void (*udp_emit_t)(const raw_pkt_t *pkt, void *arg);
+
+/*
+ * The sequencer between the receive ring and the decoder. It passes every
+ * packet on whose channel is in sequence right away, drops the copies of
+ * the other line (A/B arbitration: the first copy wins), holds the packets
+ * after a gap while a thread asks the recovery service for the missing
+ * ones, and passes the held packets on in order once the gap is filled or
+ * hold_ms has passed.
+ */
+int udp_open(struct udp_rx **rx, const struct udp_conf *conf);
+int udp_start(struct udp_rx *rx);
+void udp_stop(struct udp_rx *rx);
+void udp_close(struct udp_rx *rx);
+
+/*
+ * udp_input - sequence one packet of the lines, emitting it and the held
+ * packets it releases.
+ */
+void udp_input(struct udp_rx *rx, const raw_pkt_t *pkt, udp_emit_t emit, void *arg);
+
+/*
+ * udp_poll - sequence the recovered packets and give up on the gaps older
+ * than hold_ms. Returns the packets emitted.
+ */
+size_t udp_poll(struct udp_rx *rx, udp_emit_t emit, void *arg);
+
+void udp_get_stats(struct udp_rx *rx, struct udp_stats *stats);
+
+#define CTP_FRONT_MAX		8
+
+struct ctp_conf
+{
+	const char *fronts[CTP_FRONT_MAX];	/* e.g. "tcp://180.168.146.187:10131", in failover order */
+	int nfronts;
+	const char *broker;
+	const char *user;
+	const char *password;
+	const char *flow_dir;	/* directory of the .con files of the MdApi */
+
+	char **instruments;	/* subscribed on every login, owned by the caller */
+	size_t ninstruments;
+
+	size_t nslots;		/* slots in the receive ring, rounded up to power of 2 */
+	int cpu;		/* core the SPI thread is pinned to, -1 for none */
+	uint64_t failover_ms;	/* time a front gets to log in before the next one */
+};
+
+struct ctp_stats
+{
+	uint64_t packets;	/* depth market data stored in the ring */
+	uint64_t ring_full;	/* depth market data dropped, no free slot */
+	uint64_t connects;
+	uint64_t disconnects;
+	uint64_t failovers;	/* switches to the next front */
+	uint64_t logins;
+	uint64_t subscribed;	/* instruments acknowledged */
+	uint64_t sub_errors;	/* instruments refused */
+};
+
+struct ctp_rx;
+
+/*
+ * The CTP source. The SPI thread of the MdApi only copies every
+ * CThostFtdcDepthMarketDataField into a slot of the receive ring, the
+ * slots are decoded by ctp_decoder like the datagrams of mcast. A manager
+ * thread logs in, subscribes and moves to the next front on failure.
+ */
+int ctp_open(struct ctp_rx **rx, const struct ctp_conf *conf);
+int ctp_start(struct ctp_rx *rx);
+void ctp_stop(struct ctp_rx *rx);
+void ctp_close(struct ctp_rx *rx);
+
+raw_ring_t *ctp_ring(struct ctp_rx *rx);
+void ctp_get_stats(struct ctp_rx *rx, struct ctp_stats *stats);
+
+int raw_pin_cpu(int cpu);
+
+#endif		/* __RAW_H__ */
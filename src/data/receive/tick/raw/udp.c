@@ -0,0 +1,712 @@
+/*
+ * udp.c
+ *
+ * The functions are used to keep the packets of a feed in sequence between
+ * the receive ring and the decoder. The exchanges publish every channel on
+ * two lines (A and B), and a packet lost on both at a peak is a wrong bar
+ * downstream, so the packets of each channel go through a sequencer:
+ *
+ *	in sequence	passed on at once, the hot path is one header read and
+ *			one compare
+ *	behind		a copy of the other line or a late retransmission,
+ *			dropped
+ *	ahead		held in the window of the channel while the recovery
+ *			thread asks the unicast service for the missing ones
+ *
+ * A recovered packet goes through the sequencer like any other, so whichever
+ * copy of a packet comes first, line A, line B or the recovery, fills the
+ * gap, and the held packets follow it in order. A packet is held at most
+ * hold_ms: then the gap before it is given up and counted lost.
+ *
+ * The feeds count the packets of a session from 1. A channel restarted its
+ * sequence when its first packet comes again after hold_ms, by then no copy
+ * of the line or recovery is that late, or when a packet is far behind.
+ *
+ * The sequencer is driven by the decode thread alone; the recovery thread
+ * only takes the requests of a queue and gives the packets back through a
+ * ring of its own, both single producer and single consumer.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "raw.h"
+#include "decode.h"
+
+#define REQ_MAX		1024		/* requests queued for the recovery thread */
+#define RESET_BEHIND	100000		/* a sequence this far behind restarted */
+#define SEQ_FIRST	1		/* of a session */
+#define RECOVER_SLOTS	4096
+#define STREAM_BUF	(1 << 16)
+#define CONNECT_MS	1000
+#define RETRY_MS	1000
+#define POLL_MS		1
+
+struct udp_chan
+{
+	uint16_t channel;
+	int live;			/* a packet was seen */
+	uint32_t next;			/* sequence number expected */
+	uint32_t high;			/* after the last packet held */
+	uint32_t asked;			/* the packets before it are requested */
+	uint32_t nheld;
+	int gap;			/* packets are held */
+	uint64_t start_ns;		/* monotonic ns the sequence began or restarted */
+
+	uint32_t *seqs;			/* of the slots held */
+	uint8_t *valid;
+	uint64_t *at;			/* monotonic ns the slots were held */
+	raw_pkt_t *slots;		/* window, by sequence number */
+};
+
+struct udp_rx
+{
+	struct udp_conf conf;
+	uint32_t mask;			/* of the window */
+	uint64_t hold_ns;
+
+	struct udp_chan chans[UDP_CHANNEL_MAX];
+	int nchans;
+	int last;			/* channel of the last packet */
+	int ngaps;			/* channels with a gap open */
+
+	/* decode thread to recovery thread */
+	struct udp_req reqs[REQ_MAX];
+	_Atomic uint64_t req_head __attribute__((aligned(RAW_CACHELINE)));
+	_Atomic uint64_t req_tail __attribute__((aligned(RAW_CACHELINE)));
+
+	/* recovery thread to decode thread */
+	raw_ring_t ring;
+
+	int stream;			/* tcp, else udp */
+	char host[256];
+	char port[16];
+	int fd;
+	uint8_t *buf;			/* of the tcp stream */
+	size_t blen;
+
+	pthread_t thread;
+	_Atomic int running;
+
+	_Atomic uint64_t requests;
+	_Atomic uint64_t connects;
+	struct udp_stats stats;
+};
+
+static inline uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t
+wall_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * parse_service - "tcp://host:port", "udp://host:port" or "host:port" for
+ * tcp.
+ */
+static int
+parse_service(struct udp_rx *rx, const char *s)
+{
+	const char *colon;
+
+	rx->stream = 1;
+	if (strncmp(s, "udp://", 6) == 0) {
+		rx->stream = 0;
+		s += 6;
+	} else if (strncmp(s, "tcp://", 6) == 0) {
+		s += 6;
+	}
+
+	if ((colon = strrchr(s, ':')) == NULL || colon == s || (size_t)(colon - s) >= sizeof(rx->host) ||
+	    strlen(colon + 1) == 0 || strlen(colon + 1) >= sizeof(rx->port)) {
+		return -1;
+	}
+	memcpy(rx->host, s, (size_t)(colon - s));
+	rx->host[colon - s] = '\0';
+	snprintf(rx->port, sizeof(rx->port), "%s", colon + 1);
+
+	return 0;
+}
+
+int
+udp_open(struct udp_rx **prx, const struct udp_conf *conf)
+{
+	struct udp_rx *rx;
+	size_t window = conf->window ? conf->window : UDP_WINDOW;
+
+	*prx = NULL;
+	if ((window & (window - 1)) != 0 || (unsigned int)conf->md_type >= MD_T_MAX ||
+	    tick_decoders[conf->md_type] == NULL || tick_decoders[conf->md_type]->seq == NULL) {
+		fprintf(stderr, "the sequencer needs a power of 2 window and a feed with sequence numbers\n");
+		return -1;
+	}
+
+	rx = (struct udp_rx *)aligned_alloc(RAW_CACHELINE,
+		(sizeof(*rx) + RAW_CACHELINE - 1) & ~(size_t)(RAW_CACHELINE - 1));
+	if (rx == NULL) {
+		return -2;
+	}
+	memset(rx, 0, sizeof(*rx));
+	rx->conf = *conf;
+	rx->mask = (uint32_t)window - 1;
+	rx->hold_ns = (conf->hold_ms ? conf->hold_ms : UDP_HOLD_MS) * 1000000ULL;
+	rx->fd = -1;
+	atomic_init(&rx->running, 0);
+
+	if (conf->recovery != NULL && parse_service(rx, conf->recovery) != 0) {
+		fprintf(stderr, "bad recovery service %s\n", conf->recovery);
+		free(rx);
+		return -1;
+	}
+	if (raw_ring_init(&rx->ring, conf->nslots ? conf->nslots : RECOVER_SLOTS) != 0 ||
+	    (rx->buf = malloc(STREAM_BUF)) == NULL) {
+		raw_ring_destroy(&rx->ring);
+		free(rx);
+		return -2;
+	}
+
+	*prx = rx;
+
+	return 0;
+}
+
+/*
+ * find_chan - the state of the channel, its window allocated on its first
+ * packet. NULL when there are too many channels.
+ */
+static struct udp_chan *
+find_chan(struct udp_rx *rx, uint16_t channel)
+{
+	struct udp_chan *ch;
+	size_t window = (size_t)rx->mask + 1;
+	int i;
+
+	if (rx->nchans > 0 && rx->chans[rx->last].channel == channel) {
+		return &rx->chans[rx->last];
+	}
+	for (i = 0; i < rx->nchans; i++) {
+		if (rx->chans[i].channel == channel) {
+			rx->last = i;
+			return &rx->chans[i];
+		}
+	}
+
+	if (rx->nchans == UDP_CHANNEL_MAX) {
+		return NULL;
+	}
+	ch = &rx->chans[rx->nchans];
+	ch->seqs = calloc(window, sizeof(*ch->seqs));
+	ch->valid = calloc(window, 1);
+	ch->at = calloc(window, sizeof(*ch->at));
+	ch->slots = aligned_alloc(RAW_CACHELINE, window * sizeof(raw_pkt_t));
+	if (ch->seqs == NULL || ch->valid == NULL || ch->at == NULL || ch->slots == NULL) {
+		free(ch->seqs);
+		free(ch->valid);
+		free(ch->at);
+		free(ch->slots);
+		memset(ch, 0, sizeof(*ch));
+		return NULL;
+	}
+	ch->channel = channel;
+	rx->last = rx->nchans++;
+
+	return ch;
+}
+
+static inline void
+emit_pkt(struct udp_rx *rx, const raw_pkt_t *pkt, udp_emit_t emit, void *arg)
+{
+	emit(pkt, arg);
+	rx->stats.packets++;
+	if (pkt->flags & RAW_F_RECOVERED) {
+		rx->stats.recovered++;
+	}
+}
+
+/*
+ * drain - pass on the held packets that are in sequence now, up to the next
+ * hole.
+ */
+static void
+drain(struct udp_rx *rx, struct udp_chan *ch, udp_emit_t emit, void *arg)
+{
+	uint32_t i;
+
+	while (ch->nheld > 0) {
+		i = ch->next & rx->mask;
+		if (!ch->valid[i] || ch->seqs[i] != ch->next) {
+			return;
+		}
+		emit_pkt(rx, &ch->slots[i], emit, arg);
+		ch->valid[i] = 0;
+		ch->nheld--;
+		ch->next++;
+	}
+	if (ch->gap) {
+		ch->gap = 0;
+		rx->ngaps--;
+	}
+}
+
+/*
+ * skip_to - give up the packets missing before seq, passing on the ones
+ * held, and continue from seq.
+ */
+static void
+skip_to(struct udp_rx *rx, struct udp_chan *ch, uint32_t seq, udp_emit_t emit, void *arg)
+{
+	uint32_t i;
+
+	while ((int32_t)(seq - ch->next) > 0) {
+		if (ch->nheld == 0) {
+			rx->stats.lost += seq - ch->next;
+			ch->next = seq;
+			break;
+		}
+		i = ch->next & rx->mask;
+		if (ch->valid[i] && ch->seqs[i] == ch->next) {
+			emit_pkt(rx, &ch->slots[i], emit, arg);
+			ch->valid[i] = 0;
+			ch->nheld--;
+		} else {
+			rx->stats.lost++;
+		}
+		ch->next++;
+	}
+	if ((int32_t)(ch->asked - ch->next) < 0) {
+		ch->asked = ch->next;
+	}
+	drain(rx, ch, emit, arg);
+}
+
+static void
+request(struct udp_rx *rx, uint16_t channel, uint32_t seq, uint32_t count)
+{
+	uint64_t head = atomic_load_explicit(&rx->req_head, memory_order_relaxed);
+	struct udp_req *r;
+
+	if (head - atomic_load_explicit(&rx->req_tail, memory_order_acquire) >= REQ_MAX) {
+		rx->stats.req_drops++;
+		return;
+	}
+	r = &rx->reqs[head % REQ_MAX];
+	r->magic = htonl(UDP_REQ_MAGIC);
+	r->channel = htons(channel);
+	r->reserved = 0;
+	r->seq = htonl(seq);
+	r->count = htonl(count);
+	atomic_store_explicit(&rx->req_head, head + 1, memory_order_release);
+}
+
+/* hold the packet ahead of the sequence and ask for the ones before it */
+static void
+hold(struct udp_rx *rx, struct udp_chan *ch, const raw_pkt_t *pkt, uint32_t seq)
+{
+	uint32_t i = seq & rx->mask, from;
+
+	if (ch->valid[i] && ch->seqs[i] == seq) {
+		rx->stats.duplicates++;
+		return;
+	}
+	memcpy(&ch->slots[i], pkt, RAW_SLOT_HDR + pkt->len);
+	ch->seqs[i] = seq;
+	ch->valid[i] = 1;
+	ch->at[i] = mono_ns();
+	if (ch->nheld++ == 0 || (int32_t)(seq + 1 - ch->high) > 0) {
+		ch->high = seq + 1;
+	}
+	rx->stats.held++;
+
+	if (!ch->gap) {
+		ch->gap = 1;
+		rx->ngaps++;
+		rx->stats.gaps++;
+	}
+
+	from = (int32_t)(ch->asked - ch->next) > 0 ? ch->asked : ch->next;
+	if ((int32_t)(seq - from) > 0) {
+		if (rx->conf.recovery != NULL) {
+			request(rx, ch->channel, from, seq - from);
+		}
+		ch->asked = seq + 1;
+	} else if ((int32_t)(seq + 1 - ch->asked) > 0) {
+		ch->asked = seq + 1;
+	}
+}
+
+void
+udp_input(struct udp_rx *rx, const raw_pkt_t *pkt, udp_emit_t emit, void *arg)
+{
+	struct udp_chan *ch;
+	uint16_t channel;
+	uint32_t seq;
+	int32_t d;
+
+	if (tick_seq(rx->conf.md_type, pkt->data, pkt->len, &channel, &seq) != 0 ||
+	    (ch = find_chan(rx, channel)) == NULL) {
+		rx->stats.unsequenced++;
+		emit(pkt, arg);
+		return;
+	}
+
+	if (__builtin_expect(!ch->live, 0)) {
+		ch->live = 1;
+		ch->next = ch->asked = seq;
+		ch->start_ns = mono_ns();
+	}
+
+	d = (int32_t)(seq - ch->next);
+	if (__builtin_expect(d == 0, 1)) {
+		emit_pkt(rx, pkt, emit, arg);
+		ch->next++;
+		if (ch->nheld > 0) {
+			drain(rx, ch, emit, arg);
+		}
+		return;
+	}
+
+	if (d < 0) {
+		if (d > -RESET_BEHIND && (seq != SEQ_FIRST || mono_ns() - ch->start_ns < rx->hold_ns)) {
+			rx->stats.duplicates++;
+			return;
+		}
+		/* the exchange restarted the sequence: the held packets first */
+		skip_to(rx, ch, ch->nheld > 0 ? ch->high : ch->next, emit, arg);
+		ch->next = ch->asked = seq;
+		ch->start_ns = mono_ns();
+		rx->stats.resets++;
+		emit_pkt(rx, pkt, emit, arg);
+		ch->next++;
+		return;
+	}
+
+	if ((uint32_t)d > rx->mask) {
+		/* too far ahead for the window, the oldest part of the gap is lost */
+		skip_to(rx, ch, seq - rx->mask, emit, arg);
+		if (ch->next == seq) {
+			emit_pkt(rx, pkt, emit, arg);
+			ch->next++;
+			drain(rx, ch, emit, arg);
+			return;
+		}
+	}
+	hold(rx, ch, pkt, seq);
+}
+
+/* the oldest packet held, the end of the gap at next */
+static uint32_t
+first_held(const struct udp_rx *rx, const struct udp_chan *ch)
+{
+	uint32_t seq, i;
+
+	for (seq = ch->next; seq != ch->high; seq++) {
+		i = seq & rx->mask;
+		if (ch->valid[i] && ch->seqs[i] == seq) {
+			break;
+		}
+	}
+
+	return seq;
+}
+
+size_t
+udp_poll(struct udp_rx *rx, udp_emit_t emit, void *arg)
+{
+	raw_pkt_t *pkts[RAW_BATCH];
+	uint64_t before = rx->stats.packets, now;
+	size_t n, i;
+	int c;
+
+	if ((n = raw_ring_peek(&rx->ring, pkts, RAW_BATCH)) > 0) {
+		for (i = 0; i < n; i++) {
+			udp_input(rx, pkts[i], emit, arg);
+		}
+		raw_ring_release(&rx->ring, n);
+	}
+
+	if (rx->ngaps > 0) {
+		now = mono_ns();
+		for (c = 0; c < rx->nchans; c++) {
+			struct udp_chan *ch = &rx->chans[c];
+
+			uint32_t seq;
+
+			/* the held packets behind every hole given up are as old */
+			while (ch->gap && now - ch->at[(seq = first_held(rx, ch)) & rx->mask] >= rx->hold_ns) {
+				skip_to(rx, ch, seq, emit, arg);
+			}
+		}
+	}
+
+	return (size_t)(rx->stats.packets - before);
+}
+
+static void
+disconnect(struct udp_rx *rx)
+{
+	if (rx->fd >= 0) {
+		close(rx->fd);
+		rx->fd = -1;
+	}
+	rx->blen = 0;
+}
+
+/*
+ * service_connect - connect to the recovery service, within CONNECT_MS for
+ * tcp. Returns 0 or -1.
+ */
+static int
+service_connect(struct udp_rx *rx)
+{
+	struct addrinfo hints, *res, *ai;
+	struct pollfd pfd;
+	socklen_t len;
+	int fd = -1, err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = rx->stream ? SOCK_STREAM : SOCK_DGRAM;
+	if (getaddrinfo(rx->host, rx->port, &hints, &res) != 0) {
+		return -1;
+	}
+
+	for (ai = res; ai != NULL; ai = ai->ai_next) {
+		if ((fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK, ai->ai_protocol)) < 0) {
+			continue;
+		}
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			break;
+		}
+		if (errno == EINPROGRESS) {
+			pfd.fd = fd;
+			pfd.events = POLLOUT;
+			len = sizeof(err);
+			if (poll(&pfd, 1, CONNECT_MS) == 1 &&
+			    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+				break;
+			}
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0) {
+		return -1;
+	}
+	rx->fd = fd;
+	rx->blen = 0;
+	atomic_fetch_add_explicit(&rx->connects, 1, memory_order_relaxed);
+
+	return 0;
+}
+
+static int
+send_requests(struct udp_rx *rx)
+{
+	uint64_t tail = atomic_load_explicit(&rx->req_tail, memory_order_relaxed);
+	uint64_t head = atomic_load_explicit(&rx->req_head, memory_order_acquire);
+
+	for (; tail != head; tail++) {
+		if (send(rx->fd, &rx->reqs[tail % REQ_MAX], sizeof(struct udp_req), MSG_NOSIGNAL) !=
+		    (ssize_t)sizeof(struct udp_req)) {
+			/* the requests not sent are asked for again after the reconnect */
+			return -1;
+		}
+		atomic_store_explicit(&rx->req_tail, tail + 1, memory_order_release);
+		atomic_fetch_add_explicit(&rx->requests, 1, memory_order_relaxed);
+	}
+
+	return 0;
+}
+
+static void
+deliver(struct udp_rx *rx, const uint8_t *data, size_t len)
+{
+	raw_pkt_t *pkt;
+
+	/* a full ring drops the packet, the gap times out */
+	if (len > RAW_PKT_MAX || raw_ring_claim(&rx->ring, &pkt, 1) == 0) {
+		return;
+	}
+	pkt->hw_ts = 0;
+	pkt->sw_ts = wall_ns();
+	pkt->len = (uint32_t)len;
+	pkt->group = UINT16_MAX;
+	pkt->flags = RAW_F_RECOVERED;
+	pkt->drops = 0;
+	memcpy(pkt->data, data, len);
+	raw_ring_publish(&rx->ring, 1);
+}
+
+/* the length-prefixed packets of the tcp stream */
+static int
+read_stream(struct udp_rx *rx)
+{
+	size_t off = 0;
+	uint32_t len;
+	ssize_t got;
+
+	got = recv(rx->fd, rx->buf + rx->blen, STREAM_BUF - rx->blen, MSG_DONTWAIT);
+	if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		return -1;
+	}
+	if (got < 0) {
+		return 0;
+	}
+	rx->blen += (size_t)got;
+
+	while (rx->blen - off >= 4) {
+		memcpy(&len, rx->buf + off, 4);
+		len = ntohl(len);
+		if (len > RAW_PKT_MAX) {
+			fprintf(stderr, "recovery service %s:%s sent a packet of %u bytes\n", rx->host, rx->port, len);
+			return -1;
+		}
+		if (rx->blen - off - 4 < len) {
+			break;
+		}
+		deliver(rx, rx->buf + off + 4, len);
+		off += 4 + len;
+	}
+	memmove(rx->buf, rx->buf + off, rx->blen - off);
+	rx->blen -= off;
+
+	return 0;
+}
+
+/* the datagrams of the udp service */
+static int
+read_datagrams(struct udp_rx *rx)
+{
+	ssize_t got;
+
+	while ((got = recv(rx->fd, rx->buf, STREAM_BUF, MSG_DONTWAIT)) > 0) {
+		deliver(rx, rx->buf, (size_t)got);
+	}
+
+	return got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+	       errno != ECONNREFUSED ? -1 : 0;
+}
+
+static void *
+recover_thread(void *arg)
+{
+	struct udp_rx *rx = (struct udp_rx *)arg;
+	struct pollfd pfd;
+	int waited;
+
+	while (atomic_load_explicit(&rx->running, memory_order_relaxed)) {
+		if (rx->fd < 0 && service_connect(rx) != 0) {
+			for (waited = 0; waited < RETRY_MS && atomic_load(&rx->running); waited += 10) {
+				usleep(10000);
+			}
+			continue;
+		}
+
+		if (send_requests(rx) != 0) {
+			disconnect(rx);
+			continue;
+		}
+
+		pfd.fd = rx->fd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, POLL_MS) > 0 &&
+		    (pfd.revents & (POLLERR | POLLHUP) || (rx->stream ? read_stream(rx) : read_datagrams(rx)) != 0)) {
+			fprintf(stderr, "recovery service %s:%s lost, reconnecting\n", rx->host, rx->port);
+			disconnect(rx);
+		}
+	}
+	disconnect(rx);
+
+	return NULL;
+}
+
+/*
+ * udp_start - start the recovery thread, nothing to start without a
+ * recovery service.
+ */
+int
+udp_start(struct udp_rx *rx)
+{
+	if (rx == NULL) {
+		return -1;
+	}
+	if (rx->conf.recovery == NULL) {
+		return 0;
+	}
+
+	atomic_store(&rx->running, 1);
+	if (pthread_create(&rx->thread, NULL, recover_thread, rx) != 0) {
+		atomic_store(&rx->running, 0);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+udp_stop(struct udp_rx *rx)
+{
+	if (rx == NULL || !atomic_load(&rx->running)) {
+		return;
+	}
+
+	atomic_store(&rx->running, 0);
+	pthread_join(rx->thread, NULL);
+}
+
+void
+udp_close(struct udp_rx *rx)
+{
+	int i;
+
+	if (rx == NULL) {
+		return;
+	}
+
+	udp_stop(rx);
+	for (i = 0; i < rx->nchans; i++) {
+		free(rx->chans[i].seqs);
+		free(rx->chans[i].valid);
+		free(rx->chans[i].at);
+		free(rx->chans[i].slots);
+	}
+	raw_ring_destroy(&rx->ring);
+	free(rx->buf);
+	free(rx);
+}
+
+/*
+ * udp_get_stats - copy the counters of the sequencer, written by the decode
+ * thread without locking, and those of the recovery thread.
+ */
+void
+udp_get_stats(struct udp_rx *rx, struct udp_stats *stats)
+{
+	*stats = rx->stats;
+	stats->requests = atomic_load_explicit(&rx->requests, memory_order_relaxed);
+	stats->connects = atomic_load_explicit(&rx->connects, memory_order_relaxed);
+}
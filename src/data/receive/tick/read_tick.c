@@ -0,0 +1,194 @@
+/*
+ * read_tick.c
+ *
+ * The functions are used to decode the tick data of the buffer. The decoder
+ * of each market data type is found in a static table by md_type, and a whole
+ * batch of messages is decoded into flat records in one call, so the hot loop
+ * has no branch on the exchange and no allocation.
+ *
+ * read_tick() and read_next() walk the records of a buffer one by one as
+ * tick_data_t. The tick_data_t and its depth arrays live in a per-thread
+ * cursor, so they are valid until the next read_tick() in the same thread.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "tick.h"
+#include "decode.h"
+
+#define TICK_BATCH	DECODE_MSGS_MAX
+
+const struct tick_decoder *const tick_decoders[MD_T_MAX] = {
+	[MD_T_CTP] = &ctp_decoder,
+	[MD_T_SHFE] = &shfe_decoder,
+	[MD_T_CFFEX] = &cffex_decoder,
+	[MD_T_CZCE] = &czce_decoder,
+	[MD_T_DCE] = &dce_decoder,
+	[MD_T_INE] = &ine_decoder,
+	[MD_T_JUPITER] = &jupiter_decoder,
+};
+
+struct tick_cursor
+{
+	tick_data_t tick;	/* must be the first, read_next() gets the cursor from it */
+	pv_data_t bid[TICK_DEPTH];
+	pv_data_t ask[TICK_DEPTH];
+
+	int md_type;
+	const uint8_t *data;	/* the buffer given to read_tick() */
+	size_t size;
+	size_t off;		/* bytes of the buffer decoded so far */
+
+	size_t n;		/* records decoded from the buffer */
+	size_t i;		/* record the tick refers to */
+	tick_rec_t recs[TICK_BATCH];
+};
+
+static __thread struct tick_cursor cursor;
+
+size_t
+tick_decode(int md_type, const uint8_t *buf, size_t len, tick_rec_t *out, size_t n,
+	    size_t *used, uint64_t recv_ts)
+{
+	const struct tick_decoder *dec;
+	size_t cnt, i;
+
+	*used = 0;
+	if ((unsigned int)md_type >= MD_T_MAX || (dec = tick_decoders[md_type]) == NULL) {
+		return 0;
+	}
+
+	cnt = dec->decode(buf, len, out, n, used);
+
+	/* our own records keep the source type and receive time they carry */
+	if (md_type != MD_T_JUPITER) {
+		for (i = 0; i < cnt; i++) {
+			out[i].md_type = (uint8_t)md_type;
+			out[i].recv_ts = recv_ts;
+		}
+	}
+
+	return cnt;
+}
+
+int
+tick_seq(int md_type, const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	const struct tick_decoder *dec;
+
+	if ((unsigned int)md_type >= MD_T_MAX || (dec = tick_decoders[md_type]) == NULL || dec->seq == NULL) {
+		return -1;
+	}
+
+	return dec->seq(buf, len, channel, seq);
+}
+
+size_t
+tick_encode(int md_type, const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len,
+	    size_t *done)
+{
+	const struct tick_decoder *dec;
+
+	*done = 0;
+	if ((unsigned int)md_type >= MD_T_MAX || (dec = tick_decoders[md_type]) == NULL || dec->encode == NULL) {
+		return 0;
+	}
+
+	return dec->encode(in, n, seq, buf, len, done);
+}
+
+/*
+ * fill_tick - present the current record of the cursor as tick_data_t.
+ */
+static tick_data_t *
+fill_tick(struct tick_cursor *c)
+{
+	const tick_rec_t *r = &c->recs[c->i];
+	tick_data_t *t = &c->tick;
+	int k, level = r->level < TICK_DEPTH ? r->level : TICK_DEPTH;
+
+	t->timestamp = r->timestamp;
+	t->symbol = (char *)tick_symbol(r->instrument);
+	t->exchange = (char *)tick_decoders[c->md_type]->name;
+	t->basic_data = (void *)r;
+	t->last.price = tick_px_double(r->last);
+	t->last.volume = (double)r->volume;
+	t->level = level;
+
+	for (k = 0; k < level; k++) {
+		c->bid[k].price = tick_px_double(r->bid[k]);
+		c->bid[k].volume = r->bid_vol[k];
+		c->ask[k].price = tick_px_double(r->ask[k]);
+		c->ask[k].volume = r->ask_vol[k];
+	}
+	t->all_pvs.normal.bid = c->bid;
+	t->all_pvs.normal.ask = c->ask;
+
+	return t;
+}
+
+/*
+ * decode_more - decode the next batch of the buffer into the cursor, skipping
+ * data that yields no record. Returns the number of records decoded.
+ */
+static size_t
+decode_more(struct tick_cursor *c)
+{
+	size_t used;
+
+	c->i = 0;
+	c->n = 0;
+	while (c->n == 0 && c->off < c->size) {
+		c->n = tick_decode(c->md_type, c->data + c->off, c->size - c->off,
+				   c->recs, TICK_BATCH, &used, 0);
+		if (used == 0) {
+			/* incomplete packet at the end of the buffer */
+			c->off = c->size;
+			break;
+		}
+		c->off += used;
+	}
+
+	return c->n;
+}
+
+tick_data_t *
+read_tick(int md_type, uint8_t *data, size_t size)
+{
+	struct tick_cursor *c = &cursor;
+
+	if (data == NULL || (unsigned int)md_type >= MD_T_MAX || tick_decoders[md_type] == NULL) {
+		return NULL;
+	}
+
+	c->md_type = md_type;
+	c->data = data;
+	c->size = size;
+	c->off = 0;
+
+	if (decode_more(c) == 0) {
+		return NULL;
+	}
+
+	return fill_tick(c);
+}
+
+tick_data_t *
+read_next(tick_data_t *tick)
+{
+	struct tick_cursor *c = &cursor;
+
+	if (tick != &c->tick) {
+		return NULL;
+	}
+
+	if (++c->i >= c->n && decode_more(c) == 0) {
+		return NULL;
+	}
+
+	return fill_tick(c);
+}
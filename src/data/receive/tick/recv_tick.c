@@ -0,0 +1,513 @@
+/*
+ * recv_tick.c
+ *
+ * The receiver process of the tick bus: it joins the multicast groups of one
+ * feed, decodes the packets straight into the slots of the bus and publishes
+ * them, so any number of processes read the feed without a socket or a
+ * decoder of their own; the last tick of every instrument is kept in the
+ * snapshot table of the bus too, for those that sample it (snap_tick).
+ *
+ *	recv_tick -t shfe -b shfe -i 10.0.0.1 -g 233.54.1.1:30001 -c 2 -d 3
+ *	recv_tick -t shfe -b shfe -g 233.54.1.1:30001 -g 233.54.2.1:30001 \
+ *		  -R tcp://10.0.0.5:30100 -c 2 -d 3
+ *	recv_tick -t ctp -b ctp -F tcp://10.0.0.2:41213 -F tcp://10.0.0.3:41213 \
+ *		  -B 9999 -U user -P password -I instruments.txt -c 2 -d 3
+ *
+ * CTP is not multicast: the MdApi of the fronts is the source, in failover
+ * order, and the instruments of the file (one a line) are subscribed.
+ *
+ * With -A or -R the packets go through the sequencer of udp.c before the
+ * decoder: the groups of the A and B lines of a channel are arbitrated, the
+ * first copy of a packet wins, and the gaps are asked of the recovery
+ * service of -R and filled in sequence order.
+ *
+ * The records are stamped with the times their packet was picked up and
+ * they were published, and the wire and decode latencies go to the stats
+ * page of the bus (lat.h), which lat_stat prints. The hardware timestamps
+ * of -H are only comparable when the clock of the NIC is synchronized to
+ * the system clock.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sched.h>
+#include "tick.h"
+#include "decode.h"
+#include "raw.h"
+#include "ring.h"
+#include "bus.h"
+#include "lat.h"
+
+#define BUS_CAPACITY	(1 << 20)	/* tick records retained, 256MB */
+#define PKT_BATCH	RAW_BATCH
+#define HEARTBEAT_NS	100000000ULL	/* 100ms */
+#define STATS_SEC	10
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -t type -b bus -g group:port[@source] [-g ...] [options]\n"
+		"       %s -t ctp -b bus -F front [-F ...] -B broker -U user -P password -I file [options]\n"
+		"  -t type      market data type: ctp, shfe, ine, cffex, czce, dce, jupiter\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -i ifaddr    local address of the receive interface\n"
+		"  -n ifname    interface name, for hardware timestamps\n"
+		"  -g group     multicast group and port to join, repeatable\n"
+		"  -s slots     records retained by the bus (default %d)\n"
+		"  -c cpu       core of the receive thread\n"
+		"  -d cpu       core of the decode thread\n"
+		"  -p           busy-poll the sockets\n"
+		"  -w wait      of the decode thread for packets: spin, yield or sleep (default spin)\n"
+		"  -H           hardware receive timestamps\n"
+		"  -F front     ctp front address, repeatable, in failover order\n"
+		"  -B broker    ctp broker id\n"
+		"  -U user      ctp user id\n"
+		"  -P password  ctp password\n"
+		"  -I file      ctp instruments to subscribe, one a line\n"
+		"  -f dir       directory of the ctp flow files\n"
+		"  -A           sequence the packets, arbitrating the A and B lines\n"
+		"  -R service   recovery service of the gaps, tcp://host:port or udp://host:port\n"
+		"  -W ms        longest a packet is held behind a gap (default %d)\n",
+		prog, prog, BUS_CAPACITY, UDP_HOLD_MS);
+}
+
+static int
+find_md_type(const char *name)
+{
+	int i;
+
+	for (i = 0; i < MD_T_MAX; i++) {
+		if (tick_decoders[i] != NULL && strcasecmp(tick_decoders[i]->name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * parse_group - "addr:port" or "addr:port@source"; the string is split in place.
+ */
+static int
+parse_group(char *s, struct mcast_group *g)
+{
+	char *port, *src;
+
+	if ((src = strchr(s, '@')) != NULL) {
+		*src++ = '\0';
+	}
+
+	if ((port = strrchr(s, ':')) == NULL) {
+		return -1;
+	}
+	*port++ = '\0';
+
+	g->addr = s;
+	g->port = (uint16_t)atoi(port);
+	g->source = src;
+
+	return g->port == 0 ? -1 : 0;
+}
+
+/*
+ * load_instruments - the lines of the file, the array and strings owned by
+ * the caller.
+ */
+static char **
+load_instruments(const char *path, size_t *n)
+{
+	char line[256], **v = NULL, **p;
+	size_t cap = 0;
+	FILE *fp;
+
+	*n = 0;
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return NULL;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, " \t\r\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		if (*n == cap) {
+			cap = cap ? cap * 2 : 1024;
+			if ((p = realloc(v, cap * sizeof(*v))) == NULL) {
+				break;
+			}
+			v = p;
+		}
+		if ((v[*n] = strdup(line)) == NULL) {
+			break;
+		}
+		(*n)++;
+	}
+	fclose(fp);
+
+	return v;
+}
+
+/*
+ * publish_pkt - decode one datagram into the bus. The records are decoded
+ * in place in the claimed slots when the ring gave a whole batch that does
+ * not wrap; otherwise through a local batch, copied into the slots there
+ * are, and the records without one are the drops.
+ */
+static void
+publish_pkt(tick_bus_t *bus, int md_type, const raw_pkt_t *pkt)
+{
+	ring_t *ring = bus->ring;
+	static tick_rec_t batch[DECODE_MSGS_MAX];
+	uint64_t recv_ts = pkt->hw_ts ? pkt->hw_ts : pkt->sw_ts, picked = lat_now(), published = 0;
+	size_t off = 0, used, got, cnt, done, k, i;
+	uint64_t first;
+	tick_rec_t *out;
+	int direct;
+
+	while (off < pkt->len) {
+		got = ring_claim(ring, DECODE_MSGS_MAX, &first);
+		direct = got == DECODE_MSGS_MAX && (first & ring->mask) + got <= ring->capacity;
+		out = direct ? ring_slot(ring, first) : batch;
+
+		cnt = tick_decode(md_type, pkt->data + off, pkt->len - off, out, DECODE_MSGS_MAX, &used, recv_ts);
+		if (cnt > 0) {
+			published = lat_now();
+			for (i = 0; i < cnt; i++) {
+				lat_stamp(&out[i], picked, published);
+			}
+		}
+
+		if (direct) {
+			ring_unclaim(ring, first, cnt);
+			if (cnt > 0) {
+				bus_publish(bus, first, cnt);
+			}
+		} else {
+			/* what the claim holds, then claims for the rest while the readers let them */
+			for (done = 0;;) {
+				k = cnt - done < got ? cnt - done : got;
+				for (i = 0; i < k; i++) {
+					memcpy(ring_slot(ring, first + i), &batch[done + i], sizeof(tick_rec_t));
+				}
+				ring_unclaim(ring, first, k);
+				if (k > 0) {
+					bus_publish(bus, first, k);
+				}
+				done += k;
+				if (done == cnt || (got = ring_claim(ring, cnt - done, &first)) == 0) {
+					break;
+				}
+			}
+			if (done < cnt) {
+				/* gating readers are behind */
+				ring_drop(ring, cnt - done);
+			}
+		}
+
+		if (used == 0) {
+			/* incomplete, or more records than a batch */
+			break;
+		}
+		off += used;
+	}
+
+	if (published != 0) {
+		lat_record(LAT_S_WIRE, md_type, lat_since(picked, recv_ts));
+		lat_record(LAT_S_DECODE, md_type, lat_since(published, picked));
+	}
+}
+
+struct emit_arg
+{
+	tick_bus_t *bus;
+	int md_type;
+};
+
+static void
+emit_pkt(const raw_pkt_t *pkt, void *arg)
+{
+	struct emit_arg *ea = arg;
+
+	publish_pkt(ea->bus, ea->md_type, pkt);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct mcast_conf conf;
+	struct ctp_conf cconf;
+	struct mcast_rx *rx = NULL;
+	struct ctp_rx *crx = NULL;
+	struct mcast_stats ms;
+	struct ctp_stats cs;
+	struct udp_conf uconf;
+	struct udp_rx *urx = NULL;
+	struct udp_stats us;
+	struct emit_arg ea;
+	struct ring_stats rs;
+	ring_reader_t self;
+	lat_page_t lat;
+	raw_pkt_t *pkts[PKT_BATCH];
+	raw_ring_t *raw;
+	tick_bus_t bus;
+	const char *bus_name = NULL, *instruments = NULL;
+	uint64_t capacity = BUS_CAPACITY, now, last_hb = 0, last_stats = 0;
+	int md_type = -1, decode_cpu = -1, decode_wait = RING_WAIT_SPIN, sequence = 0, opt, rc;
+	size_t n, i;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.cpu = -1;
+	memset(&cconf, 0, sizeof(cconf));
+	memset(&uconf, 0, sizeof(uconf));
+
+	while ((opt = getopt(argc, argv, "t:b:i:n:g:s:c:d:pw:HF:B:U:P:I:f:AR:W:")) != -1) {
+		switch (opt) {
+		case 't':
+			if ((md_type = find_md_type(optarg)) < 0) {
+				fprintf(stderr, "unknown market data type %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'i':
+			conf.ifaddr = optarg;
+			break;
+		case 'n':
+			conf.ifname = optarg;
+			break;
+		case 'g':
+			if (conf.ngroups >= RAW_GROUP_MAX || parse_group(optarg, &conf.groups[conf.ngroups]) != 0) {
+				fprintf(stderr, "bad or too many groups: %s\n", optarg);
+				return 1;
+			}
+			conf.ngroups++;
+			break;
+		case 's':
+			capacity = strtoull(optarg, NULL, 0);
+			break;
+		case 'c':
+			conf.cpu = atoi(optarg);
+			break;
+		case 'd':
+			decode_cpu = atoi(optarg);
+			break;
+		case 'p':
+			conf.busy_poll = 1;
+			break;
+		case 'w':
+			/* the raw ring has no futex to sleep on */
+			if ((decode_wait = bus_wait_parse(optarg)) < BUS_WAIT_SLEEP || decode_wait == RING_WAIT_FUTEX) {
+				fprintf(stderr, "unknown wait %s of the decoder\n", optarg);
+				return 1;
+			}
+			break;
+		case 'H':
+			conf.hw_timestamp = 1;
+			break;
+		case 'F':
+			if (cconf.nfronts >= CTP_FRONT_MAX) {
+				fprintf(stderr, "more than %d fronts\n", CTP_FRONT_MAX);
+				return 1;
+			}
+			cconf.fronts[cconf.nfronts++] = optarg;
+			break;
+		case 'B':
+			cconf.broker = optarg;
+			break;
+		case 'U':
+			cconf.user = optarg;
+			break;
+		case 'P':
+			cconf.password = optarg;
+			break;
+		case 'I':
+			instruments = optarg;
+			break;
+		case 'f':
+			cconf.flow_dir = optarg;
+			break;
+		case 'A':
+			sequence = 1;
+			break;
+		case 'R':
+			uconf.recovery = optarg;
+			sequence = 1;
+			break;
+		case 'W':
+			uconf.hold_ms = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (md_type < 0 || bus_name == NULL ||
+	    (md_type == MD_T_CTP ? cconf.nfronts == 0 || instruments == NULL : conf.ngroups == 0)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (bus_create(&bus, bus_name, capacity, md_type) != 0) {
+		fprintf(stderr, "cannot create tick bus %s\n", bus_name);
+		return 1;
+	}
+
+	/* the symbols interned from here on go to the bus, the instruments too */
+	if (md_type == MD_T_CTP) {
+		cconf.cpu = conf.cpu;
+		if ((cconf.instruments = load_instruments(instruments, &cconf.ninstruments)) == NULL) {
+			rc = -1;
+		} else {
+			rc = ctp_open(&crx, &cconf);
+		}
+	} else {
+		rc = mcast_open(&rx, &conf);
+		if (rc == 0 && sequence) {
+			uconf.md_type = md_type;
+			rc = udp_open(&urx, &uconf);
+		}
+	}
+	if (rc != 0) {
+		mcast_close(rx);
+		bus_close(&bus);
+		bus_unlink(bus_name);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	if (decode_cpu >= 0) {
+		raw_pin_cpu(decode_cpu);
+	}
+
+	/* the decoder records into the stats page of the bus, the consumers too */
+	memset(&lat, 0, sizeof(lat));
+	if (lat_open(&lat, bus_name) == 0) {
+		lat_attach(&lat, "decode");
+	}
+
+	if ((crx != NULL ? ctp_start(crx) : mcast_start(rx)) != 0 || (urx != NULL && udp_start(urx) != 0)) {
+		ctp_close(crx);
+		mcast_close(rx);
+		udp_close(urx);
+		bus_close(&bus);
+		bus_unlink(bus_name);
+		return 1;
+	}
+
+	/* a private reader at the head only to report the published records */
+	ring_reader_init(&self, bus.ring, RING_R_PRIVATE);
+	raw = crx != NULL ? ctp_ring(crx) : mcast_ring(rx);
+	ea.bus = &bus;
+	ea.md_type = md_type;
+
+	while (running) {
+		n = raw_ring_peek(raw, pkts, PKT_BATCH);
+		for (i = 0; i < n; i++) {
+			if (urx != NULL) {
+				udp_input(urx, pkts[i], emit_pkt, &ea);
+			} else {
+				publish_pkt(&bus, md_type, pkts[i]);
+			}
+		}
+		if (n > 0) {
+			raw_ring_release(raw, n);
+		}
+		if (urx != NULL) {
+			n += udp_poll(urx, emit_pkt, &ea);
+		}
+		if (n == 0) {
+			if (rx != NULL && mcast_failed(rx)) {
+				/* no packet comes any more, the bus is left for a receiver started again */
+				fprintf(stderr, "the receive thread stopped, exiting\n");
+				rc = 1;
+				break;
+			}
+			if (decode_wait == RING_WAIT_SPIN) {
+				ring_cpu_relax();
+			} else if (decode_wait == RING_WAIT_YIELD) {
+				sched_yield();
+			} else {
+				usleep(BUS_IDLE_NS / 1000);
+			}
+		}
+
+		now = mono_ns();
+		if (now - last_hb >= HEARTBEAT_NS) {
+			bus_heartbeat(&bus);
+			last_hb = now;
+
+			if (now - last_stats >= STATS_SEC * 1000000000ULL) {
+				ring_reader_stats(&self, &rs);
+				if (crx != NULL) {
+					ctp_get_stats(crx, &cs);
+					fprintf(stderr, "depth %lu raw_full %lu ticks %lu bus_full %lu connects %lu "
+						"failovers %lu subscribed %lu refused %lu\n", cs.packets, cs.ring_full,
+						rs.published, rs.full_drops, cs.connects, cs.failovers, cs.subscribed,
+						cs.sub_errors);
+				} else {
+					mcast_get_stats(rx, &ms);
+					fprintf(stderr, "packets %lu kernel_drops %lu raw_full %lu ticks %lu bus_full %lu\n",
+						ms.packets, ms.kernel_drops, ms.ring_full, rs.published, rs.full_drops);
+				}
+				if (urx != NULL) {
+					udp_get_stats(urx, &us);
+					fprintf(stderr, "sequenced %lu duplicates %lu gaps %lu held %lu recovered %lu "
+						"lost %lu resets %lu requests %lu\n", us.packets, us.duplicates, us.gaps,
+						us.held, us.recovered, us.lost, us.resets, us.requests);
+				}
+				last_stats = now;
+			}
+		}
+	}
+
+	if (crx != NULL) {
+		ctp_close(crx);
+		for (i = 0; i < cconf.ninstruments; i++) {
+			free(cconf.instruments[i]);
+		}
+		free(cconf.instruments);
+	} else {
+		mcast_stop(rx);
+		mcast_close(rx);
+		udp_close(urx);
+	}
+	ring_reader_fini(&self);
+	lat_close(&lat);
+
+	/* the bus stays in /dev/shm so readers can drain it; the next run replaces it */
+	bus_close(&bus);
+
+	return rc;
+}
@@ -0,0 +1,659 @@
+/*
+ * redis_client.c
+ *
+ * The functions are used to pipeline commands to Redis over RESP and to
+ * publish the ticks of a ring to it in batches, conflated to the latest
+ * tick of every instrument while Redis is behind.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "redis_client.h"
+
+#define IN_CHUNK		65536
+#define PUB_BATCH		256
+#define RETRY_NS		1000000000ULL	/* reconnect once a second */
+#define CONNECT_NS		1000000000ULL	/* a connect in progress is given up after */
+
+/* state of an instrument in the publisher */
+#define SEEN			1
+#define DIRTY			2
+
+const char *const redis_mode_names[REDIS_MODE_MAX] = {
+	[REDIS_STREAM] = "stream",
+	[REDIS_PUBSUB] = "pubsub",
+};
+
+int
+redis_mode_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < REDIS_MODE_MAX; i++) {
+		if (strcmp(name, redis_mode_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int
+redis_resolve(struct redis_addr *a, const char *host, int port)
+{
+	struct addrinfo hints, *res, *ai;
+	char service[16];
+	int rc;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if ((rc = getaddrinfo(host, service, &hints, &res)) != 0) {
+		fprintf(stderr, "cannot resolve %s: %s\n", host, gai_strerror(rc));
+		return -1;
+	}
+	for (ai = res, a->n = 0; ai != NULL && a->n < REDIS_ADDR_MAX; ai = ai->ai_next) {
+		if (ai->ai_addrlen <= sizeof(a->sa[0])) {
+			memcpy(&a->sa[a->n], ai->ai_addr, ai->ai_addrlen);
+			a->len[a->n++] = ai->ai_addrlen;
+		}
+	}
+	freeaddrinfo(res);
+
+	if (a->n == 0) {
+		fprintf(stderr, "cannot resolve %s: no address\n", host);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+redis_connect_start(redis_client_t *c, const struct redis_addr *a)
+{
+	int fd = -1, one = 1, connecting = 0, i;
+
+	/* the first address whose connect did not fail at once */
+	for (i = 0; i < a->n; i++) {
+		if ((fd = socket(a->sa[i].ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
+			continue;
+		}
+		if (connect(fd, (const struct sockaddr *)&a->sa[i], a->len[i]) == 0) {
+			break;
+		}
+		if (errno == EINPROGRESS) {
+			connecting = 1;
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+
+	if (fd < 0) {
+		fprintf(stderr, "cannot connect to redis: %s\n", strerror(errno));
+		return -1;
+	}
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	c->fd = fd;
+	c->connecting = connecting;
+	c->out_len = c->out_off = 0;
+	c->in_len = 0;
+	c->pending = 0;
+
+	return connecting;
+}
+
+int
+redis_connect_wait(redis_client_t *c, int timeout_ms)
+{
+	struct pollfd pfd;
+	socklen_t len = sizeof(int);
+	int rc, err = 0;
+
+	if (c->fd < 0) {
+		return -1;
+	}
+	if (!c->connecting) {
+		return 0;
+	}
+	pfd.fd = c->fd;
+	pfd.events = POLLOUT;
+	while ((rc = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR)
+		;
+	if (rc == 0) {
+		return 1;
+	}
+	if (rc < 0 || getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+		fprintf(stderr, "cannot connect to redis: %s\n", strerror(rc < 0 || err == 0 ? errno : err));
+		redis_close(c);
+		return -1;
+	}
+	c->connecting = 0;
+
+	return 0;
+}
+
+int
+redis_connect(redis_client_t *c, const char *host, int port)
+{
+	struct redis_addr a;
+	int rc;
+
+	if (redis_resolve(&a, host, port) != 0) {
+		return -1;
+	}
+	if ((rc = redis_connect_start(c, &a)) == 1 && (rc = redis_connect_wait(c, REDIS_CONNECT_MS)) == 1) {
+		fprintf(stderr, "cannot connect to redis %s:%d: timed out\n", host, port);
+		redis_close(c);
+		rc = -1;
+	}
+
+	return rc;
+}
+
+void
+redis_close(redis_client_t *c)
+{
+	if (c->fd >= 0) {
+		close(c->fd);
+	}
+	c->fd = -1;
+	c->connecting = 0;
+	c->out_len = c->out_off = 0;
+	c->in_len = 0;
+	c->pending = 0;
+}
+
+static int
+out_reserve(redis_client_t *c, size_t n)
+{
+	size_t cap;
+	char *p;
+
+	/* the written bytes are reclaimed before growing */
+	if (c->out_off > 0 && c->out_len + n > c->out_cap) {
+		memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+		c->out_len -= c->out_off;
+		c->out_off = 0;
+	}
+	if (c->out_len + n <= c->out_cap) {
+		return 0;
+	}
+
+	for (cap = c->out_cap ? c->out_cap : IN_CHUNK; cap < c->out_len + n; cap *= 2) {
+	}
+	if ((p = realloc(c->out, cap)) == NULL) {
+		return -1;
+	}
+	c->out = p;
+	c->out_cap = cap;
+
+	return 0;
+}
+
+int
+redis_append(redis_client_t *c, int argc, const char *const *argv, const size_t *lens)
+{
+	size_t need = 16;
+	char *p;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		need += lens[i] + 32;
+	}
+	if (out_reserve(c, need) != 0) {
+		return -1;
+	}
+
+	p = c->out + c->out_len;
+	p += sprintf(p, "*%d\r\n", argc);
+	for (i = 0; i < argc; i++) {
+		p += sprintf(p, "$%zu\r\n", lens[i]);
+		memcpy(p, argv[i], lens[i]);
+		p += lens[i];
+		*p++ = '\r';
+		*p++ = '\n';
+	}
+	c->out_len = (size_t)(p - c->out);
+	c->pending++;
+
+	return 0;
+}
+
+ssize_t
+redis_flush(redis_client_t *c)
+{
+	ssize_t n;
+
+	if (c->fd < 0) {
+		return -1;
+	}
+	while (c->out_off < c->out_len) {
+		n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -1;
+		}
+		c->out_off += (size_t)n;
+	}
+	if (c->out_off == c->out_len) {
+		c->out_off = c->out_len = 0;
+	}
+
+	return (ssize_t)(c->out_len - c->out_off);
+}
+
+/* the bytes of the reply at p, 0 if it is not complete yet, -1 if malformed */
+static ssize_t
+reply_len(const char *p, size_t n)
+{
+	const char *eol = memchr(p, '\n', n);
+	size_t line, off;
+	ssize_t sub;
+	long len, i;
+
+	if (eol == NULL) {
+		return 0;
+	}
+	line = (size_t)(eol - p) + 1;
+
+	switch (p[0]) {
+	case '+':
+	case '-':
+	case ':':
+		return (ssize_t)line;
+	case '$':
+		len = strtol(p + 1, NULL, 10);
+		if (len < 0) {
+			return (ssize_t)line;
+		}
+		return line + (size_t)len + 2 <= n ? (ssize_t)(line + (size_t)len + 2) : 0;
+	case '*':
+		len = strtol(p + 1, NULL, 10);
+		for (i = 0, off = line; i < len; i++, off += (size_t)sub) {
+			if (off >= n || (sub = reply_len(p + off, n - off)) <= 0) {
+				return off >= n ? 0 : sub;
+			}
+		}
+		return (ssize_t)off;
+	default:
+		return -1;
+	}
+}
+
+ssize_t
+redis_drain(redis_client_t *c)
+{
+	ssize_t n, len, replies = 0;
+	size_t off;
+	char *p;
+
+	if (c->fd < 0) {
+		return -1;
+	}
+
+	for (;;) {
+		if (c->in_cap - c->in_len < IN_CHUNK) {
+			if ((p = realloc(c->in, c->in_cap + IN_CHUNK)) == NULL) {
+				return -1;
+			}
+			c->in = p;
+			c->in_cap += IN_CHUNK;
+		}
+		n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+		if (n == 0) {
+			return -1;
+		}
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -1;
+		}
+		c->in_len += (size_t)n;
+
+		for (off = 0; off < c->in_len; off += (size_t)len) {
+			if ((len = reply_len(c->in + off, c->in_len - off)) < 0) {
+				fprintf(stderr, "malformed redis reply\n");
+				return -1;
+			}
+			if (len == 0) {
+				break;
+			}
+			if (c->in[off] == '-') {
+				if (c->errors++ == 0) {
+					fprintf(stderr, "redis: %.*s\n", (int)len - 2, c->in + off);
+				}
+			}
+			if (c->pending > 0) {
+				c->pending--;
+			}
+			replies++;
+		}
+		memmove(c->in, c->in + off, c->in_len - off);
+		c->in_len -= off;
+	}
+
+	return replies;
+}
+
+struct redis_pub
+{
+	struct redis_pub_conf conf;
+	redis_client_t c;
+	struct redis_pub_stats stats;
+	uint32_t ncmds;			/* commands of the batch */
+	int flushing;			/* a batch the socket did not take at once */
+	uint64_t first_ns;		/* when the first one was appended */
+	uint64_t retry_ns;		/* next connection attempt */
+	uint64_t connect_ns;		/* the connect in progress is given up */
+	struct redis_addr addr;		/* of the conf, resolved by redis_pub_create() */
+	char maxlen[24];
+
+	/* the latest tick of every instrument, and those to snapshot */
+	tick_rec_t *latest;
+	uint8_t *state;
+	uint32_t *dirty;
+	uint32_t ndirty;
+	uint32_t max_id;
+};
+
+redis_pub_t *
+redis_pub_create(const struct redis_pub_conf *conf)
+{
+	redis_pub_t *pub;
+
+	if ((unsigned int)conf->mode >= REDIS_MODE_MAX || conf->port <= 0) {
+		fprintf(stderr, "bad redis publisher conf\n");
+		return NULL;
+	}
+	if ((pub = calloc(1, sizeof(*pub))) == NULL) {
+		return NULL;
+	}
+	pub->conf = *conf;
+	if (pub->conf.batch == 0) {
+		pub->conf.batch = 1;
+	}
+	if (pub->conf.max_pending == 0) {
+		pub->conf.max_pending = UINT64_MAX;
+	}
+	if (pub->conf.max_out == 0) {
+		pub->conf.max_out = SIZE_MAX;
+	}
+	pub->c.fd = -1;
+	/* once, the reconnects of the publisher loop never wait for a resolver */
+	if (redis_resolve(&pub->addr, conf->host, conf->port) != 0) {
+		free(pub);
+		return NULL;
+	}
+	snprintf(pub->maxlen, sizeof(pub->maxlen), "%lu", (unsigned long)conf->maxlen);
+
+	pub->latest = aligned_alloc(TICK_CACHELINE, (size_t)TICK_INSTRUMENT_MAX * sizeof(tick_rec_t));
+	pub->state = calloc(TICK_INSTRUMENT_MAX, sizeof(*pub->state));
+	pub->dirty = malloc(TICK_INSTRUMENT_MAX * sizeof(*pub->dirty));
+	if (pub->latest == NULL || pub->state == NULL || pub->dirty == NULL) {
+		redis_pub_destroy(pub);
+		return NULL;
+	}
+
+	return pub;
+}
+
+static int
+connected(const redis_pub_t *pub)
+{
+	return pub->c.fd >= 0 && !pub->c.connecting;
+}
+
+void
+redis_pub_destroy(redis_pub_t *pub)
+{
+	if (pub == NULL) {
+		return;
+	}
+	if (connected(pub)) {
+		redis_flush(&pub->c);
+	}
+	redis_close(&pub->c);
+	free(pub->c.out);
+	free(pub->c.in);
+	free(pub->latest);
+	free(pub->state);
+	free(pub->dirty);
+	free(pub);
+}
+
+static int
+behind(const redis_pub_t *pub)
+{
+	return !connected(pub) || pub->c.pending > pub->conf.max_pending ||
+	       pub->c.out_len - pub->c.out_off > pub->conf.max_out;
+}
+
+static void
+mark_dirty(redis_pub_t *pub, uint32_t id)
+{
+	if (pub->state[id] != DIRTY) {
+		pub->state[id] = DIRTY;
+		pub->dirty[pub->ndirty++] = id;
+	}
+}
+
+/* the ticks in flight are lost with the connection, their latest are sent again */
+static void
+disconnect(redis_pub_t *pub)
+{
+	uint32_t id;
+
+	if (connected(pub)) {
+		fprintf(stderr, "redis connection lost\n");
+	}
+	redis_close(&pub->c);
+	pub->ncmds = 0;
+	pub->flushing = 0;
+	pub->retry_ns = mono_ns() + RETRY_NS;
+	for (id = 1, pub->ndirty = 0; id <= pub->max_id; id++) {
+		if (pub->state[id] != 0) {
+			pub->state[id] = DIRTY;
+			pub->dirty[pub->ndirty++] = id;
+		}
+	}
+}
+
+static void
+send_tick(redis_pub_t *pub, const tick_rec_t *t)
+{
+	const char *argv[8], *symbol;
+	char key[REDIS_PREFIX_MAX + TICK_SYMBOL_LEN + 16];
+	size_t lens[8];
+	int argc = 0, i;
+
+	symbol = pub->conf.symbol != NULL ? pub->conf.symbol(t->instrument, pub->conf.arg) :
+		 tick_symbol(t->instrument);
+	if (symbol != NULL) {
+		snprintf(key, sizeof(key), "%s%s", pub->conf.prefix, symbol);
+	} else {
+		snprintf(key, sizeof(key), "%s#%u", pub->conf.prefix, t->instrument);
+	}
+
+	if (pub->conf.mode == REDIS_STREAM) {
+		argv[argc++] = "XADD";
+		argv[argc++] = key;
+		if (pub->conf.maxlen > 0) {
+			argv[argc++] = "MAXLEN";
+			argv[argc++] = "~";
+			argv[argc++] = pub->maxlen;
+		}
+		argv[argc++] = "*";
+		argv[argc++] = "d";
+	} else {
+		argv[argc++] = "PUBLISH";
+		argv[argc++] = key;
+	}
+	argv[argc++] = (const char *)t;
+	for (i = 0; i < argc - 1; i++) {
+		lens[i] = strlen(argv[i]);
+	}
+	lens[argc - 1] = sizeof(*t);
+
+	if (redis_append(&pub->c, argc, argv, lens) != 0) {
+		disconnect(pub);
+		return;
+	}
+	if (pub->ncmds++ == 0) {
+		pub->first_ns = mono_ns();
+	}
+}
+
+void
+redis_pub_tick(redis_pub_t *pub, const tick_rec_t *tick)
+{
+	uint32_t id = tick->instrument;
+
+	pub->stats.ticks++;
+	if (id == 0 || id >= TICK_INSTRUMENT_MAX) {
+		return;
+	}
+
+	pub->latest[id] = *tick;
+	if (id > pub->max_id) {
+		pub->max_id = id;
+	}
+
+	if (behind(pub)) {
+		if (pub->state[id] == DIRTY) {
+			pub->stats.conflated++;
+		}
+		mark_dirty(pub, id);
+		return;
+	}
+
+	pub->state[id] = pub->state[id] == DIRTY ? DIRTY : SEEN;
+	send_tick(pub, tick);
+	pub->stats.published++;
+}
+
+/* the latest ticks of the instruments conflated, once Redis caught up */
+static void
+send_snapshots(redis_pub_t *pub)
+{
+	uint32_t i, id;
+
+	for (i = 0; i < pub->ndirty && pub->c.fd >= 0; i++) {
+		id = pub->dirty[i];
+		if (pub->state[id] == DIRTY) {
+			pub->state[id] = SEEN;
+			send_tick(pub, &pub->latest[id]);
+			pub->stats.snapshots++;
+		}
+	}
+	if (pub->c.fd >= 0) {
+		pub->ndirty = 0;
+	}
+}
+
+size_t
+redis_pub_poll(redis_pub_t *pub, ring_reader_t *rd, size_t max)
+{
+	static __thread tick_rec_t batch[PUB_BATCH];
+	size_t n, i, total = 0;
+	uint64_t now = mono_ns();
+	ssize_t rc;
+
+	if (pub->c.fd < 0 && now >= pub->retry_ns) {
+		if ((rc = redis_connect_start(&pub->c, &pub->addr)) == 0) {
+			pub->stats.reconnects++;
+		} else if (rc > 0) {
+			pub->connect_ns = now + CONNECT_NS;
+		} else {
+			pub->retry_ns = now + RETRY_NS;
+		}
+	}
+	/* the ticks are conflated while the connect is in progress, it is never waited for */
+	if (pub->c.connecting) {
+		if ((rc = redis_connect_wait(&pub->c, 0)) == 0) {
+			pub->stats.reconnects++;
+		} else if (rc < 0 || now >= pub->connect_ns) {
+			if (rc > 0) {
+				fprintf(stderr, "cannot connect to redis %s:%d: timed out\n", pub->conf.host,
+					pub->conf.port);
+				redis_close(&pub->c);
+			}
+			pub->retry_ns = now + RETRY_NS;
+		}
+	}
+	if (pub->ndirty > 0 && !behind(pub)) {
+		send_snapshots(pub);
+	}
+
+	while (total < max) {
+		n = ring_read(rd, batch, max - total < PUB_BATCH ? max - total : PUB_BATCH);
+		for (i = 0; i < n; i++) {
+			redis_pub_tick(pub, &batch[i]);
+		}
+		total += n;
+		if (n < PUB_BATCH) {
+			break;
+		}
+	}
+
+	if (connected(pub)) {
+		now = mono_ns();
+		if (pub->ncmds >= pub->conf.batch ||
+		    (pub->ncmds > 0 && now - pub->first_ns >= pub->conf.deadline_us * 1000)) {
+			pub->ncmds = 0;
+			pub->stats.batches++;
+			pub->flushing = 1;
+		}
+		if (pub->flushing && (rc = redis_flush(&pub->c)) <= 0) {
+			pub->flushing = 0;
+			if (rc < 0) {
+				disconnect(pub);
+			}
+		}
+	}
+	if (connected(pub) && pub->c.pending > 0 && redis_drain(&pub->c) < 0) {
+		disconnect(pub);
+	}
+	pub->stats.errors = pub->c.errors;
+	pub->stats.drops = rd->drops;
+
+	return total;
+}
+
+void
+redis_pub_stats(const redis_pub_t *pub, struct redis_pub_stats *st)
+{
+	*st = pub->stats;
+}
@@ -0,0 +1,173 @@
+/*
+ * redis_client.h
+ *
+ * The header file contains the definition of the Redis client and of the
+ * tick publisher on top of it, and the functions' prototype.
+ *
+ * The client speaks RESP over a non-blocking TCP socket: commands are
+ * appended to an output buffer and written in one go, the replies are read
+ * back later and only counted, so a batch costs one round trip however many
+ * commands it has.
+ *
+ * The publisher drains a ring reader of tick records into Redis, one stream
+ * entry (XADD <prefix><symbol> MAXLEN ~ maxlen * d <tick>) or one message
+ * (PUBLISH <prefix><symbol> <tick>) per tick. The value is the tick_rec as
+ * it is, the same 256 bytes as in the rings and the tick files. A batch is
+ * flushed when it has batch commands or when its first one is deadline_us
+ * old.
+ *
+ * When Redis falls behind (too many replies pending, the output buffer too
+ * big, or the connection lost or being made again, a connect is never
+ * waited for), the publisher keeps only the latest tick of every instrument
+ * and publishes those snapshots once Redis caught up, so it never stalls or
+ * grows, and the reader keeps the pace of the ring.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __REDIS_CLIENT_H__
+#define __REDIS_CLIENT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "tick.h"
+#include "ring.h"
+
+#define REDIS_HOST_MAX		256
+#define REDIS_PREFIX_MAX	64
+#define REDIS_CONNECT_MS	1000		/* redis_connect() gives up after */
+#define REDIS_ADDR_MAX		4		/* addresses of a host kept */
+
+typedef struct redis_client
+{
+	int fd;				/* -1 when not connected */
+	int connecting;			/* the connect of fd is in progress */
+	char *out;			/* commands not yet written */
+	size_t out_len;
+	size_t out_off;			/* bytes of out already written */
+	size_t out_cap;
+	char *in;			/* replies not yet parsed */
+	size_t in_len;
+	size_t in_cap;
+	uint64_t pending;		/* replies expected */
+	uint64_t errors;		/* error replies */
+} redis_client_t;
+
+/* redis_addr - the addresses of host:port, resolved once */
+struct redis_addr
+{
+	struct sockaddr_storage sa[REDIS_ADDR_MAX];
+	socklen_t len[REDIS_ADDR_MAX];
+	int n;
+};
+
+/*
+ * redis_resolve - the addresses of host:port, with a blocking lookup.
+ * Returns 0, -1 if none.
+ */
+int redis_resolve(struct redis_addr *a, const char *host, int port);
+
+/*
+ * redis_connect_start - start a non-blocking connect to the first address
+ * that does not fail at once, nothing blocks. Returns 0 when connected at
+ * once, 1 when in progress, -1 if it failed.
+ */
+int redis_connect_start(redis_client_t *c, const struct redis_addr *a);
+
+/*
+ * redis_connect_wait - wait up to timeout_ms, 0 not to wait, for the connect
+ * in progress. Returns 0 when connected, 1 when still in progress, -1 if it
+ * failed and the socket is closed.
+ */
+int redis_connect_wait(redis_client_t *c, int timeout_ms);
+
+/*
+ * redis_connect - resolve and connect to host:port, waiting REDIS_CONNECT_MS
+ * at most for the connect. Returns 0, -1 if it failed or timed out.
+ */
+int redis_connect(redis_client_t *c, const char *host, int port);
+void redis_close(redis_client_t *c);
+
+/*
+ * redis_append - append a command of argc binary safe arguments to the
+ * output buffer. Returns 0, -1 if out of memory.
+ */
+int redis_append(redis_client_t *c, int argc, const char *const *argv, const size_t *lens);
+
+/*
+ * redis_flush - write what the socket takes of the output buffer without
+ * blocking. Returns the bytes left, -1 if the connection failed.
+ */
+ssize_t redis_flush(redis_client_t *c);
+
+/*
+ * redis_drain - read and count the replies available without blocking.
+ * Returns the replies read, -1 if the connection failed.
+ */
+ssize_t redis_drain(redis_client_t *c);
+
+enum redis_mode {
+	REDIS_STREAM = 0,		/* XADD */
+	REDIS_PUBSUB,			/* PUBLISH */
+	REDIS_MODE_MAX
+};
+
+extern const char *const redis_mode_names[REDIS_MODE_MAX];
+
+int redis_mode_parse(const char *name);
+
+struct redis_pub_conf
+{
+	char host[REDIS_HOST_MAX];
+	int port;
+	int mode;			/* enum redis_mode */
+	char prefix[REDIS_PREFIX_MAX];	/* of the keys or channels */
+	uint64_t maxlen;		/* stream: approximate length kept, 0 unbounded */
+	uint32_t batch;			/* commands of a batch */
+	uint64_t deadline_us;		/* age of a batch */
+	uint64_t max_pending;		/* replies pending before conflating */
+	size_t max_out;			/* bytes buffered before conflating */
+
+	/* symbol of an instrument id, NULL for tick_symbol(); bus readers give bus_symbol() */
+	const char *(*symbol)(uint32_t id, void *arg);
+	void *arg;
+};
+
+struct redis_pub_stats
+{
+	uint64_t ticks;			/* read from the ring */
+	uint64_t published;		/* ticks sent as they came */
+	uint64_t conflated;		/* ticks replaced by a later one */
+	uint64_t snapshots;		/* latest ticks sent after catching up */
+	uint64_t batches;
+	uint64_t errors;		/* error replies */
+	uint64_t reconnects;
+	uint64_t drops;			/* records the reader lost in the ring */
+};
+
+typedef struct redis_pub redis_pub_t;
+
+/*
+ * redis_pub_create - a publisher of the conf, the host resolved here once.
+ * Returns NULL if the conf is bad or the host has no address.
+ */
+redis_pub_t *redis_pub_create(const struct redis_pub_conf *conf);
+void redis_pub_destroy(redis_pub_t *pub);
+
+/*
+ * redis_pub_poll - read up to max ticks of the reader, flush the batch if
+ * it is due, and read the replies. Call it in a loop also when there are
+ * no ticks, it keeps the deadline and reconnects. Returns the ticks read.
+ */
+size_t redis_pub_poll(redis_pub_t *pub, ring_reader_t *rd, size_t max);
+
+/*
+ * redis_pub_tick - publish or conflate one tick.
+ */
+void redis_pub_tick(redis_pub_t *pub, const tick_rec_t *tick);
+
+void redis_pub_stats(const redis_pub_t *pub, struct redis_pub_stats *st);
+
+#endif		/* __REDIS_CLIENT_H__ */
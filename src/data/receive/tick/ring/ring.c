@@ -0,0 +1,531 @@
+/*
+ * ring.c
+ *
+ * The functions are used to produce records into and read records from the
+ * lock-free ring. See ring.h for how the producer and the readers meet.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "ring.h"
+
+#define HUGEPAGE_SIZE	(2UL * 1024 * 1024)
+#define SUB_USED	0x8000U		/* set in ring_sub.flags of a used entry */
+
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+size_t
+ring_mem_size(uint64_t capacity, uint32_t rec_size)
+{
+	return ALIGN_UP(sizeof(ring_t), RING_CACHELINE) +
+	       ALIGN_UP(capacity * sizeof(uint64_t), RING_CACHELINE) +
+	       capacity * rec_size;
+}
+
+/*
+ * ring_init - lay a ring out in the memory of ring_mem_size() bytes. The
+ * capacity must be a power of 2 and rec_size a multiple of the cache line.
+ */
+ring_t *
+ring_init(void *mem, uint64_t capacity, uint32_t rec_size, int flags)
+{
+	ring_t *ring = (ring_t *)mem;
+
+	if (mem == NULL || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+	    rec_size == 0 || rec_size % RING_CACHELINE != 0) {
+		return NULL;
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	ring->rec_size = rec_size;
+	ring->flags = (uint32_t)flags;
+	ring->capacity = capacity;
+	ring->mask = capacity - 1;
+	ring->seqs_off = ALIGN_UP(sizeof(ring_t), RING_CACHELINE);
+	ring->slots_off = ring->seqs_off + ALIGN_UP(capacity * sizeof(uint64_t), RING_CACHELINE);
+	ring->mem_size = ring_mem_size(capacity, rec_size);
+
+	/* 0 in a sequence word means never published */
+	memset((uint8_t *)ring + ring->seqs_off, 0, capacity * sizeof(uint64_t));
+
+	ring->version = RING_VERSION;
+	atomic_store_explicit((_Atomic uint32_t *)&ring->magic, RING_MAGIC, memory_order_release);
+
+	return ring;
+}
+
+ring_t *
+ring_attach(void *mem, size_t size)
+{
+	ring_t *ring = (ring_t *)mem;
+
+	if (mem == NULL || size < sizeof(ring_t) ||
+	    atomic_load_explicit((_Atomic uint32_t *)&ring->magic, memory_order_acquire) != RING_MAGIC ||
+	    ring->version != RING_VERSION || ring->mem_size > size) {
+		return NULL;
+	}
+
+	return ring;
+}
+
+ring_t *
+ring_create(uint64_t capacity, uint32_t rec_size, int flags)
+{
+	size_t size = ALIGN_UP(ring_mem_size(capacity, rec_size), HUGEPAGE_SIZE);
+	ring_t *ring;
+	void *p;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p == MAP_FAILED) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			return NULL;
+		}
+		madvise(p, size, MADV_HUGEPAGE);
+	}
+
+	/* prefault, so the first lap does not take page faults */
+	memset(p, 0, size);
+
+	ring = ring_init(p, capacity, rec_size, flags);
+	if (ring == NULL) {
+		munmap(p, size);
+	}
+
+	return ring;
+}
+
+/*
+ * ring_destroy - free a ring made by ring_create().
+ */
+void
+ring_destroy(ring_t *ring)
+{
+	if (ring != NULL) {
+		munmap(ring, ALIGN_UP(ring->mem_size, HUGEPAGE_SIZE));
+	}
+}
+
+static uint64_t
+min_gating(ring_t *ring, uint64_t head)
+{
+	uint64_t min = head;
+	int i;
+
+	for (i = 0; i < RING_READERS_MAX; i++) {
+		struct ring_sub *s = &ring->subs[i];
+		uint32_t flags = atomic_load_explicit(&s->flags, memory_order_acquire);
+
+		if ((flags & (SUB_USED | RING_R_GATING)) == (SUB_USED | RING_R_GATING)) {
+			uint64_t c = atomic_load_explicit(&s->cursor, memory_order_acquire);
+
+			if (c < min) {
+				min = c;
+			}
+		}
+	}
+
+	return min;
+}
+
+/* the number of slots free for the producer at head, at most n */
+static inline size_t
+free_slots(ring_t *ring, uint64_t head, size_t n)
+{
+	uint64_t gate, used;
+
+	if (atomic_load_explicit(&ring->ngating, memory_order_relaxed) == 0) {
+		return n;
+	}
+
+	gate = atomic_load_explicit(&ring->gate, memory_order_relaxed);
+	if (head - gate + n > ring->capacity) {
+		gate = min_gating(ring, head);
+		atomic_store_explicit(&ring->gate, gate, memory_order_relaxed);
+	}
+
+	used = head - gate;
+	if (used >= ring->capacity) {
+		return 0;
+	}
+
+	return ring->capacity - used < n ? (size_t)(ring->capacity - used) : n;
+}
+
+size_t
+ring_claim(ring_t *ring, size_t n, uint64_t *first)
+{
+	uint64_t head, i;
+	size_t got;
+
+	head = atomic_load_explicit(&ring->claim, memory_order_relaxed);
+	if (ring->flags & RING_F_MP) {
+		do {
+			got = free_slots(ring, head, n);
+			if (got == 0) {
+				break;
+			}
+		} while (!atomic_compare_exchange_weak_explicit(&ring->claim, &head, head + got,
+								memory_order_relaxed, memory_order_relaxed));
+	} else {
+		got = free_slots(ring, head, n);
+		atomic_store_explicit(&ring->claim, head + got, memory_order_relaxed);
+	}
+
+	/*
+	 * mark the slots busy before they are written, so a lossy reader still
+	 * on the old records notices it was lapped
+	 */
+	for (i = 0; i < got; i++) {
+		atomic_store_explicit(ring_seq(ring, head + i), (head + i) | RING_SEQ_BUSY, memory_order_relaxed);
+	}
+	atomic_thread_fence(memory_order_release);
+
+	*first = head;
+
+	return got;
+}
+
+void
+ring_publish(ring_t *ring, uint64_t first, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		atomic_store_explicit(ring_seq(ring, first + i), first + i + 1, memory_order_release);
+	}
+
+	if (ring->flags & RING_F_MP) {
+		atomic_fetch_add_explicit(&ring->published, n, memory_order_relaxed);
+	} else {
+		atomic_store_explicit(&ring->published,
+			atomic_load_explicit(&ring->published, memory_order_relaxed) + n, memory_order_relaxed);
+	}
+
+	/* pairs with the waiter registering itself before checking again */
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&ring->waiters, memory_order_relaxed) != 0) {
+		atomic_fetch_add_explicit(&ring->futex, 1, memory_order_release);
+		syscall(SYS_futex, &ring->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	}
+}
+
+void
+ring_unclaim(ring_t *ring, uint64_t first, size_t used)
+{
+	if (ring->flags & RING_F_MP) {
+		return;
+	}
+
+	atomic_store_explicit(&ring->claim, first + used, memory_order_relaxed);
+}
+
+void
+ring_drop(ring_t *ring, size_t n)
+{
+	atomic_fetch_add_explicit(&ring->full_drops, n, memory_order_relaxed);
+}
+
+int
+ring_push(ring_t *ring, const void *rec)
+{
+	uint64_t seq;
+
+	if (ring_claim(ring, 1, &seq) == 0) {
+		ring_drop(ring, 1);
+		return -1;
+	}
+
+	memcpy(ring_slot(ring, seq), rec, ring->rec_size);
+	ring_publish(ring, seq, 1);
+
+	return 0;
+}
+
+/*
+ * ring_reader_init - register a reader. A gating reader always starts at
+ * the head; RING_R_OLDEST is for lossy readers replaying what is retained.
+ */
+int
+ring_reader_init(ring_reader_t *rd, ring_t *ring, int flags)
+{
+	uint64_t head;
+	int i;
+
+	if (rd == NULL || ring == NULL || ((flags & RING_R_PRIVATE) && (flags & RING_R_GATING))) {
+		return -1;
+	}
+
+	memset(rd, 0, sizeof(*rd));
+	rd->ring = ring;
+	rd->flags = flags;
+	rd->sub = -1;
+
+	head = atomic_load_explicit(&ring->claim, memory_order_acquire);
+	if ((flags & RING_R_OLDEST) && !(flags & RING_R_GATING)) {
+		rd->cursor = head > ring->capacity ? head - ring->capacity : 0;
+	} else {
+		rd->cursor = head;
+	}
+
+	if (flags & RING_R_PRIVATE) {
+		return 0;
+	}
+
+	for (i = 0; i < RING_READERS_MAX; i++) {
+		struct ring_sub *s = &ring->subs[i];
+		uint32_t expected = 0;
+
+		if (atomic_compare_exchange_strong(&s->flags, &expected, SUB_USED)) {
+			atomic_store(&s->drops, 0);
+			s->pid = (uint32_t)getpid();
+			if (flags & RING_R_GATING) {
+				/*
+				 * counted first, so the producer leaves its fast path of
+				 * no gating reader before the cursor is published; the
+				 * head taken after is one it cannot have lapped
+				 */
+				atomic_fetch_add(&ring->ngating, 1);
+				rd->cursor = atomic_load(&ring->claim);
+			}
+			atomic_store(&s->cursor, rd->cursor);
+			atomic_store(&s->flags, SUB_USED | (uint32_t)flags);
+			rd->sub = i;
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "ring has no free reader entry\n");
+
+	return -1;
+}
+
+void
+ring_reader_fini(ring_reader_t *rd)
+{
+	struct ring_sub *s;
+
+	if (rd == NULL || rd->sub < 0) {
+		return;
+	}
+
+	s = &rd->ring->subs[rd->sub];
+	if (rd->flags & RING_R_GATING) {
+		atomic_fetch_sub(&rd->ring->ngating, 1);
+	}
+	atomic_store(&s->flags, 0);
+	rd->sub = -1;
+}
+
+static inline void
+set_cursor(ring_reader_t *rd, uint64_t cursor)
+{
+	rd->cursor = cursor;
+	if (rd->sub >= 0) {
+		atomic_store_explicit(&rd->ring->subs[rd->sub].cursor, cursor, memory_order_release);
+	}
+}
+
+static inline int
+lapped(uint64_t v, uint64_t c)
+{
+	if (v & RING_SEQ_BUSY) {
+		return (v & ~RING_SEQ_BUSY) > c;
+	}
+
+	return v > c + 1;
+}
+
+/*
+ * skip_lost - move a lapped reader to the oldest record safe to read,
+ * leaving a quarter of the ring as margin against the producer.
+ */
+static void
+skip_lost(ring_reader_t *rd)
+{
+	ring_t *ring = rd->ring;
+	uint64_t head = atomic_load_explicit(&ring->claim, memory_order_acquire);
+	uint64_t next = head > ring->capacity ? head - ring->capacity + ring->capacity / 4 : 0;
+	uint64_t lost;
+
+	if (next <= rd->cursor) {
+		next = rd->cursor + 1;
+	}
+
+	lost = next - rd->cursor;
+	rd->drops += lost;
+	if (rd->sub >= 0) {
+		atomic_fetch_add_explicit(&ring->subs[rd->sub].drops, lost, memory_order_relaxed);
+	}
+	set_cursor(rd, next);
+}
+
+size_t
+ring_peek(ring_reader_t *rd, size_t n, uint64_t *first)
+{
+	ring_t *ring = rd->ring;
+	uint64_t c, v;
+	size_t i;
+
+again:
+	c = rd->cursor;
+	for (i = 0; i < n; i++) {
+		v = atomic_load_explicit(ring_seq(ring, c + i), memory_order_acquire);
+		if (v == c + i + 1) {
+			continue;
+		}
+
+		if (i == 0 && lapped(v, c)) {
+			skip_lost(rd);
+			goto again;
+		}
+		break;
+	}
+
+	*first = c;
+
+	return i;
+}
+
+/* the number of the n records from the cursor still intact after reading */
+static inline size_t
+intact(ring_reader_t *rd, size_t n)
+{
+	ring_t *ring = rd->ring;
+	uint64_t c = rd->cursor;
+	size_t i;
+
+	if (rd->flags & RING_R_GATING) {
+		return n;
+	}
+
+	atomic_thread_fence(memory_order_acquire);
+	for (i = 0; i < n; i++) {
+		if (atomic_load_explicit(ring_seq(ring, c + i), memory_order_relaxed) != c + i + 1) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+int
+ring_release(ring_reader_t *rd, size_t n)
+{
+	if (intact(rd, n) != n) {
+		skip_lost(rd);
+		return -1;
+	}
+
+	set_cursor(rd, rd->cursor + n);
+
+	return 0;
+}
+
+size_t
+ring_read(ring_reader_t *rd, void *out, size_t n)
+{
+	ring_t *ring = rd->ring;
+	uint64_t first;
+	size_t i, got, ok;
+
+	got = ring_peek(rd, n, &first);
+	for (i = 0; i < got; i++) {
+		memcpy((uint8_t *)out + i * ring->rec_size, ring_slot(ring, first + i), ring->rec_size);
+	}
+
+	ok = intact(rd, got);
+	if (ok < got) {
+		/* keep the intact prefix, the rest was torn by the producer */
+		set_cursor(rd, rd->cursor + ok);
+		skip_lost(rd);
+		return ok;
+	}
+
+	set_cursor(rd, rd->cursor + got);
+
+	return got;
+}
+
+int
+ring_wait(ring_reader_t *rd, int strategy, uint64_t timeout_ns)
+{
+	ring_t *ring = rd->ring;
+	uint64_t deadline = 0, first, now;
+	unsigned int spins;
+
+	if (timeout_ns != 0) {
+		deadline = now_ns() + timeout_ns;
+	}
+
+	for (spins = 0;; spins++) {
+		if (ring_peek(rd, 1, &first) != 0) {
+			return 1;
+		}
+
+		if (deadline != 0 && (spins & 63) == 63 && now_ns() >= deadline) {
+			return 0;
+		}
+
+		if (strategy == RING_WAIT_SPIN) {
+			ring_cpu_relax();
+		} else if (strategy == RING_WAIT_YIELD) {
+			sched_yield();
+		} else {
+			struct timespec ts = { 1, 0 };
+			uint32_t val = atomic_load_explicit(&ring->futex, memory_order_acquire);
+
+			atomic_fetch_add(&ring->waiters, 1);
+			if (ring_peek(rd, 1, &first) != 0) {
+				atomic_fetch_sub(&ring->waiters, 1);
+				return 1;
+			}
+
+			if (deadline != 0) {
+				now = now_ns();
+				if (now >= deadline) {
+					atomic_fetch_sub(&ring->waiters, 1);
+					return 0;
+				}
+				ts.tv_sec = (time_t)((deadline - now) / 1000000000ULL);
+				ts.tv_nsec = (long)((deadline - now) % 1000000000ULL);
+			}
+
+			syscall(SYS_futex, &ring->futex, FUTEX_WAIT, val, &ts, NULL, 0);
+			atomic_fetch_sub(&ring->waiters, 1);
+		}
+	}
+}
+
+void
+ring_reader_stats(const ring_reader_t *rd, struct ring_stats *st)
+{
+	ring_t *ring = rd->ring;
+
+	st->head = atomic_load_explicit(&ring->claim, memory_order_acquire);
+	st->published = atomic_load_explicit(&ring->published, memory_order_relaxed);
+	st->full_drops = atomic_load_explicit(&ring->full_drops, memory_order_relaxed);
+	st->cursor = rd->cursor;
+	st->lag = st->head > rd->cursor ? st->head - rd->cursor : 0;
+	st->drops = rd->drops;
+}
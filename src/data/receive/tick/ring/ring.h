@@ -0,0 +1,198 @@
+/*
+ * ring.h
+ *
+ * The file contains the definition of the lock-free ring of fixed-size
+ * records between the receivers and the consumers of the tick pipeline, and
+ * the functions' prototype of its producer and reader sides.
+ *
+ * The whole ring is one block of memory without pointers: a header, the
+ * registered readers, a sequence word per slot and the slots. So it can be
+ * placed in anonymous memory or in a shared memory segment alike.
+ *
+ * Every slot has a sequence word telling which record it holds. A reader
+ * owns its cursor and checks the sequence words to find published records,
+ * so any number of readers consume the same records independently
+ * (broadcast). A gating reader holds the producer back when the ring is
+ * full, which gives the SPSC behaviour with the drop counted at the
+ * producer; a lossy reader never stalls the producer, it is lapped instead
+ * and counts the records it lost.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define RING_CACHELINE		64
+#define RING_READERS_MAX	16
+#define RING_MAGIC		0x474e494aU	/* "JING" */
+#define RING_VERSION		1
+
+/* flags of ring_init() */
+#define RING_F_MP		0x0001	/* several producers claim concurrently */
+
+/* flags of ring_reader_init() */
+#define RING_R_GATING		0x0001	/* the producer never overwrites unread records */
+#define RING_R_OLDEST		0x0002	/* start from the oldest retained record, not the head */
+#define RING_R_PRIVATE		0x0004	/* do not register, for read-only mappings (lossy only) */
+
+enum ring_wait {
+	RING_WAIT_SPIN = 0,	/* busy-spin with pause, lowest latency, burns the core */
+	RING_WAIT_YIELD,	/* sched_yield() between polls */
+	RING_WAIT_FUTEX,	/* sleep in the kernel until the producer publishes */
+};
+
+#define RING_SEQ_BUSY		(1ULL << 63)	/* slot is being (over)written */
+
+struct ring_sub
+{
+	_Atomic uint64_t cursor;	/* next record the reader consumes */
+	_Atomic uint64_t drops;		/* records the reader lost by being lapped */
+	_Atomic uint32_t flags;		/* RING_R_* of the reader, 0 if the entry is free */
+	uint32_t pid;			/* process of the reader */
+} __attribute__((aligned(RING_CACHELINE)));
+
+typedef struct ring
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t rec_size;		/* bytes of a slot, a multiple of the cache line */
+	uint32_t flags;			/* RING_F_* */
+	uint64_t capacity;		/* slots, a power of 2 */
+	uint64_t mask;
+	uint64_t seqs_off;		/* offset of the sequence words from the header */
+	uint64_t slots_off;		/* offset of the slots from the header */
+	uint64_t mem_size;		/* bytes of the whole ring */
+
+	/* written by the producer(s) */
+	_Atomic uint64_t claim __attribute__((aligned(RING_CACHELINE)));	/* next sequence to claim */
+	_Atomic uint64_t gate;		/* producer's cached minimum of the gating cursors */
+	_Atomic uint64_t full_drops;	/* records dropped because gating readers were behind */
+	_Atomic uint64_t published;	/* records published */
+
+	_Atomic uint32_t futex __attribute__((aligned(RING_CACHELINE)));	/* bumped on publish */
+	_Atomic uint32_t waiters;	/* readers sleeping in RING_WAIT_FUTEX */
+	_Atomic uint32_t ngating;	/* registered gating readers */
+
+	struct ring_sub subs[RING_READERS_MAX];
+} ring_t;
+
+/*
+ * ring_reader - the reader side of a ring. It lives in the memory of the
+ * reader, its cursor is mirrored to the ring when the reader is registered.
+ */
+typedef struct ring_reader
+{
+	ring_t *ring;
+	uint64_t cursor;	/* next record to consume */
+	uint64_t drops;		/* records lost by being lapped */
+	int sub;		/* index in ring->subs, -1 if private */
+	int flags;
+} ring_reader_t;
+
+struct ring_stats
+{
+	uint64_t head;		/* next sequence the producer claims */
+	uint64_t published;	/* records published */
+	uint64_t full_drops;	/* records the producer dropped, ring full */
+	uint64_t cursor;	/* of the reader */
+	uint64_t lag;		/* records the reader is behind the head */
+	uint64_t drops;		/* records the reader lost */
+};
+
+size_t ring_mem_size(uint64_t capacity, uint32_t rec_size);
+ring_t *ring_init(void *mem, uint64_t capacity, uint32_t rec_size, int flags);
+ring_t *ring_attach(void *mem, size_t size);
+
+/* ring_create/ring_destroy - a ring in anonymous memory, for in-process use */
+ring_t *ring_create(uint64_t capacity, uint32_t rec_size, int flags);
+void ring_destroy(ring_t *ring);
+
+static inline void *
+ring_slot(const ring_t *ring, uint64_t seq)
+{
+	return (uint8_t *)ring + ring->slots_off + (seq & ring->mask) * ring->rec_size;
+}
+
+static inline _Atomic uint64_t *
+ring_seq(const ring_t *ring, uint64_t seq)
+{
+	return (_Atomic uint64_t *)((uint8_t *)ring + ring->seqs_off) + (seq & ring->mask);
+}
+
+static inline void
+ring_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+/*
+ * ring_claim - claim up to n slots for writing, returns the number claimed
+ * and the sequence of the first one in *first; ring_slot() gives the slots.
+ * Fewer than n (or 0) are returned when gating readers are behind; the
+ * producer tells ring_drop() the records it lost. ring_publish() makes the
+ * claimed slots visible to readers.
+ */
+size_t ring_claim(ring_t *ring, size_t n, uint64_t *first);
+void ring_publish(ring_t *ring, uint64_t first, size_t n);
+
+/*
+ * ring_unclaim - give back the claimed slots after the first used ones, e.g.
+ * when a packet decoded straight into the ring gave fewer records than
+ * claimed. Single producer only, before ring_publish() of the used slots.
+ */
+void ring_unclaim(ring_t *ring, uint64_t first, size_t used);
+
+/*
+ * ring_drop - count records the producer dropped for want of slots.
+ */
+void ring_drop(ring_t *ring, size_t n);
+
+/*
+ * ring_push - copy one record into the ring, returns 0 or -1 when dropped.
+ */
+int ring_push(ring_t *ring, const void *rec);
+
+int ring_reader_init(ring_reader_t *rd, ring_t *ring, int flags);
+void ring_reader_fini(ring_reader_t *rd);
+
+/*
+ * ring_peek - get up to n published records from the cursor without consuming
+ * them; the first is at sequence *first. They are read in place, and
+ * ring_release() tells whether a lossy reader was lapped meanwhile.
+ */
+size_t ring_peek(ring_reader_t *rd, size_t n, uint64_t *first);
+
+/*
+ * ring_release - consume n records returned by ring_peek(). Returns 0, or
+ * -1 when the records were overwritten while being read; the reader is
+ * then moved past the lost records and the results of that batch must be
+ * discarded.
+ */
+int ring_release(ring_reader_t *rd, size_t n);
+
+/*
+ * ring_read - copy up to n records into out and consume them, returns the
+ * number copied. Records torn by the producer lapping the reader are never
+ * returned.
+ */
+size_t ring_read(ring_reader_t *rd, void *out, size_t n);
+
+/*
+ * ring_wait - wait with the strategy until a record is available or
+ * timeout_ns passed (0 waits forever). Returns 1 if one is available.
+ */
+int ring_wait(ring_reader_t *rd, int strategy, uint64_t timeout_ns);
+
+void ring_reader_stats(const ring_reader_t *rd, struct ring_stats *st);
+
+#endif		/* __RING_H__ */
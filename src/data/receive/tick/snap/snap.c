@@ -0,0 +1,194 @@
+/*
+ * snap.c
+ *
+ * The functions are used to write and read the snapshot table of the tick
+ * bus. See snap.h for how the writer and the readers meet.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "snap.h"
+#include "ring.h"
+
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+static inline _Atomic uint64_t *
+gens(const snap_t *snap)
+{
+	return (_Atomic uint64_t *)((uint8_t *)snap + snap->gens_off);
+}
+
+static inline _Atomic uint64_t *
+groups(const snap_t *snap)
+{
+	return (_Atomic uint64_t *)((uint8_t *)snap + snap->groups_off);
+}
+
+size_t
+snap_mem_size(uint32_t capacity)
+{
+	uint64_t n = ALIGN_UP((uint64_t)capacity, SNAP_GROUP);
+
+	return ALIGN_UP(sizeof(snap_t), TICK_CACHELINE) +
+	       ALIGN_UP(n * sizeof(uint64_t), TICK_CACHELINE) +
+	       ALIGN_UP(n / SNAP_GROUP * sizeof(uint64_t), TICK_CACHELINE) +
+	       n * sizeof(struct snap_slot);
+}
+
+/*
+ * snap_init - lay a table of ids 0 to capacity - 1 out in the memory of
+ * snap_mem_size() bytes; the capacity is rounded up to a whole group.
+ */
+snap_t *
+snap_init(void *mem, uint32_t capacity)
+{
+	snap_t *snap = (snap_t *)mem;
+	uint64_t n = ALIGN_UP((uint64_t)capacity, SNAP_GROUP);
+
+	if (mem == NULL || capacity == 0 || n > UINT32_MAX || ((uintptr_t)mem & (TICK_CACHELINE - 1)) != 0) {
+		return NULL;
+	}
+
+	memset(snap, 0, sizeof(*snap));
+	snap->capacity = (uint32_t)n;
+	snap->gens_off = ALIGN_UP(sizeof(snap_t), TICK_CACHELINE);
+	snap->groups_off = snap->gens_off + ALIGN_UP(n * sizeof(uint64_t), TICK_CACHELINE);
+	snap->slots_off = snap->groups_off + ALIGN_UP(n / SNAP_GROUP * sizeof(uint64_t), TICK_CACHELINE);
+	snap->mem_size = snap_mem_size(capacity);
+
+	/* 0 is never written, for the gens and the sequence words alike */
+	memset((uint8_t *)snap + snap->gens_off, 0, snap->mem_size - snap->gens_off);
+
+	snap->version = SNAP_VERSION;
+	atomic_store_explicit((_Atomic uint32_t *)&snap->magic, SNAP_MAGIC, memory_order_release);
+
+	return snap;
+}
+
+snap_t *
+snap_attach(void *mem, size_t size)
+{
+	snap_t *snap = (snap_t *)mem;
+
+	if (mem == NULL || size < sizeof(snap_t) ||
+	    atomic_load_explicit((_Atomic uint32_t *)&snap->magic, memory_order_acquire) != SNAP_MAGIC ||
+	    snap->version != SNAP_VERSION || snap->mem_size > size) {
+		return NULL;
+	}
+
+	return snap;
+}
+
+void
+snap_put(snap_t *snap, const tick_rec_t *recs, size_t n)
+{
+	uint64_t gen = atomic_load_explicit(&snap->gen, memory_order_relaxed);
+	uint32_t high = atomic_load_explicit(&snap->high, memory_order_relaxed), id;
+	struct snap_slot *s;
+	uint64_t seq;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if ((id = recs[i].instrument) == 0 || id >= snap->capacity) {
+			continue;
+		}
+		s = snap_slot(snap, id);
+
+		seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+		atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		memcpy(&s->rec, &recs[i], sizeof(s->rec));
+		atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+
+		gen++;
+		atomic_store_explicit(&gens(snap)[id], gen, memory_order_relaxed);
+		atomic_store_explicit(&groups(snap)[id / SNAP_GROUP], gen, memory_order_relaxed);
+		if (id > high) {
+			high = id;
+			atomic_store_explicit(&snap->high, high, memory_order_relaxed);
+		}
+	}
+
+	/* a reader seeing the update sees the gens of all the ones before */
+	atomic_store_explicit(&snap->gen, gen, memory_order_release);
+}
+
+void
+snap_reader_init(snap_reader_t *rd, const snap_t *snap, int flags)
+{
+	rd->snap = snap;
+	rd->gen = flags & SNAP_R_ALL ? 0 : atomic_load_explicit(&((snap_t *)snap)->gen, memory_order_acquire);
+	rd->retries = 0;
+}
+
+int
+snap_get(snap_reader_t *rd, uint32_t id, tick_rec_t *out)
+{
+	const snap_t *snap = rd->snap;
+	struct snap_slot *s;
+	uint64_t s0, s1;
+	int tries;
+
+	if (id == 0 || id >= snap->capacity) {
+		return -1;
+	}
+	s = snap_slot(snap, id);
+
+	for (tries = 0; tries < SNAP_TRIES; tries++) {
+		if ((s0 = atomic_load_explicit(&s->seq, memory_order_acquire)) == 0) {
+			return -1;
+		}
+		if ((s0 & 1) == 0) {
+			memcpy(out, &s->rec, sizeof(*out));
+			atomic_thread_fence(memory_order_acquire);
+			if ((s1 = atomic_load_explicit(&s->seq, memory_order_relaxed)) == s0) {
+				return 0;
+			}
+		}
+		/* a writer sharing the core needs it to come out of the slot */
+		rd->retries++;
+		if ((s0 & 1) != 0 && (tries & 63) == 63) {
+			sched_yield();
+		} else {
+			ring_cpu_relax();
+		}
+	}
+
+	return -1;
+}
+
+size_t
+snap_scan(snap_reader_t *rd, uint64_t *dirty)
+{
+	const snap_t *snap = rd->snap;
+	uint64_t gen, last = rd->gen, bits;
+	uint32_t nw, w, b, high;
+	size_t n = 0;
+
+	memset(dirty, 0, SNAP_WORDS(snap->capacity) * sizeof(*dirty));
+	gen = atomic_load_explicit(&((snap_t *)snap)->gen, memory_order_acquire);
+	if (gen == last) {
+		return 0;
+	}
+
+	high = atomic_load_explicit(&((snap_t *)snap)->high, memory_order_relaxed);
+	nw = high / SNAP_GROUP + 1;
+	for (w = 0; w < nw; w++) {
+		if (atomic_load_explicit(&groups(snap)[w], memory_order_relaxed) <= last) {
+			continue;
+		}
+		for (bits = 0, b = 0; b < SNAP_GROUP; b++) {
+			bits |= (uint64_t)(atomic_load_explicit(&gens(snap)[w * SNAP_GROUP + b],
+								memory_order_relaxed) > last) << b;
+		}
+		dirty[w] = bits;
+		n += (size_t)__builtin_popcountll(bits);
+	}
+	rd->gen = gen;
+
+	return n;
+}
@@ -0,0 +1,120 @@
+/*
+ * snap.h
+ *
+ * The file contains the definition of the snapshot table of the tick bus,
+ * the last tick_rec of every instrument, and the functions' prototype of its
+ * writer and reader sides.
+ *
+ * A strategy sampling the book of the whole universe every bar, or a
+ * matcher wanting the book of one instrument, needs the last tick of each,
+ * not every tick; the table is what it reads then instead of the ring. Like
+ * the ring it is one block of memory without pointers, placed in the
+ * segment of the bus:
+ *
+ *	header   struct snap_table
+ *	gens     uint64_t [capacity], the update of the last write of an id
+ *	groups   uint64_t [capacity / 64], the latest of the gens of 64 ids
+ *	slots    struct snap_slot [capacity], by instrument id
+ *
+ * The one writer is the decoder of the bus. A slot is a seqlock: the
+ * sequence word is odd while the record is written, a reader copies the
+ * record and takes it if the word was even and unchanged. So reads never
+ * lock, never write and work on a read-only mapping, and a reader sees a
+ * whole record, never half of two.
+ *
+ * Every write numbers the update into the gens of its id and group and into
+ * the table. A reader keeps the update it scanned to and snap_scan() gives
+ * the bitmap of the ids written since, checking the 64 gens of a group only
+ * when the group moved; a scan with nothing written since reads one word.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __SNAP_H__
+#define __SNAP_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "tick.h"
+
+#define SNAP_MAGIC	0x50414e4aU	/* "JNAP" */
+#define SNAP_VERSION	1
+#define SNAP_GROUP	64		/* ids of a group, a word of the bitmap */
+#define SNAP_TRIES	4096		/* reads of a slot before its writer is given up on */
+
+/* the words of the bitmap of snap_scan() for a table of the capacity */
+#define SNAP_WORDS(capacity)	(((capacity) + SNAP_GROUP - 1) / SNAP_GROUP)
+
+/* flags of snap_reader_init() */
+#define SNAP_R_ALL	0x0001		/* the first scan gives every id written, not only the new */
+
+struct snap_slot
+{
+	_Atomic uint64_t seq;		/* odd while written, 0 if never */
+	uint8_t pad[TICK_CACHELINE - sizeof(uint64_t)];
+	tick_rec_t rec;
+} __attribute__((aligned(TICK_CACHELINE)));
+
+_Static_assert(sizeof(struct snap_slot) == 5 * TICK_CACHELINE, "snap_slot must be 5 cache lines");
+
+typedef struct snap_table
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;		/* ids, a multiple of SNAP_GROUP */
+	uint32_t reserved;
+	uint64_t gens_off;		/* offsets from the header */
+	uint64_t groups_off;
+	uint64_t slots_off;
+	uint64_t mem_size;		/* bytes of the whole table */
+
+	/* written by the writer */
+	_Atomic uint64_t gen __attribute__((aligned(TICK_CACHELINE)));	/* updates, the last one */
+	_Atomic uint32_t high;		/* highest id written */
+} snap_t;
+
+/*
+ * snap_reader - the reader side of a table, in the memory of the reader.
+ */
+typedef struct snap_reader
+{
+	const snap_t *snap;
+	uint64_t gen;			/* the update scanned to */
+	uint64_t retries;		/* reads of a slot done again, the writer was in it */
+} snap_reader_t;
+
+static inline struct snap_slot *
+snap_slot(const snap_t *snap, uint32_t id)
+{
+	return (struct snap_slot *)((uint8_t *)snap + snap->slots_off) + id;
+}
+
+size_t snap_mem_size(uint32_t capacity);
+snap_t *snap_init(void *mem, uint32_t capacity);
+snap_t *snap_attach(void *mem, size_t size);
+
+/*
+ * snap_put - the records into the slots of their instruments, the last of
+ * an instrument wins. The writer only, after the records are published.
+ */
+void snap_put(snap_t *snap, const tick_rec_t *recs, size_t n);
+
+void snap_reader_init(snap_reader_t *rd, const snap_t *snap, int flags);
+
+/*
+ * snap_get - copy the last record of the instrument into out. Returns 0,
+ * -1 if it has none, or if its writer stopped in the middle of it.
+ */
+int snap_get(snap_reader_t *rd, uint32_t id, tick_rec_t *out);
+
+/*
+ * snap_scan - the ids written since the last scan of the reader into the
+ * bitmap of SNAP_WORDS(capacity) words, bit id % 64 of word id / 64.
+ * Returns how many. An id written during the scan may be given by the
+ * next one again, none is missed.
+ */
+size_t snap_scan(snap_reader_t *rd, uint64_t *dirty);
+
+#endif		/* __SNAP_H__ */
@@ -0,0 +1,176 @@
+/*
+ * snap_tick.c
+ *
+ * The program reads the snapshot table of a tick bus the way a strategy
+ * samples it: every interval it scans the instruments changed since the
+ * last one, reads their last ticks and prints how many and how long it
+ * took, and the book of the symbols asked for.
+ *
+ *	snap_tick -b shfe
+ *	snap_tick -b shfe -i 1 -s rb2505,cu2505
+ *	snap_tick -b shfe -a
+ *
+ * The first sample is of every instrument the bus has a tick of.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tick.h"
+#include "bus.h"
+#include "snap.h"
+
+#define SYMBOLS_MAX	64
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -b bus [-i sec] [-s symbols] [-a]\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -i sec       sample every interval, once without\n"
+		"  -s symbols   comma separated symbols whose book is printed every sample\n"
+		"  -a           print the book of every instrument changed\n",
+		prog);
+}
+
+static void
+print_book(const tick_bus_t *bus, const tick_rec_t *t)
+{
+	const char *symbol = bus_symbol(bus, t->instrument);
+
+	printf("%s %lu last %.4f volume %ld oi %ld bid %.4f x %d ask %.4f x %d\n",
+	       symbol != NULL ? symbol : "?", (unsigned long)t->timestamp, tick_px_double(t->last),
+	       (long)t->volume, (long)t->open_interest, tick_px_double(t->bid[0]), t->bid_vol[0],
+	       tick_px_double(t->ask[0]), t->ask_vol[0]);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *bus_name = NULL, *symbols = NULL;
+	char *names[SYMBOLS_MAX], *copy = NULL, *save = NULL, *tok;
+	uint32_t ids[SYMBOLS_MAX], id;
+	uint64_t *dirty = NULL, t0, t1, t2, bits;
+	int interval = 0, all = 0, nsymbols = 0, opt, i;
+	size_t n, got, w, nw;
+	snap_reader_t rd;
+	tick_bus_t bus;
+	tick_rec_t t;
+
+	while ((opt = getopt(argc, argv, "b:i:s:a")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 's':
+			symbols = optarg;
+			break;
+		case 'a':
+			all = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (bus_name == NULL || optind != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (bus_open(&bus, bus_name, 0) != 0) {
+		fprintf(stderr, "cannot open tick bus %s\n", bus_name);
+		return 1;
+	}
+
+	nw = SNAP_WORDS(bus.snap->capacity);
+	if ((dirty = malloc(nw * sizeof(*dirty))) == NULL ||
+	    (symbols != NULL && (copy = strdup(symbols)) == NULL)) {
+		free(dirty);
+		bus_close(&bus);
+		return 1;
+	}
+	for (tok = copy != NULL ? strtok_r(copy, ",", &save) : NULL; tok != NULL && nsymbols < SYMBOLS_MAX;
+	     tok = strtok_r(NULL, ",", &save)) {
+		names[nsymbols] = tok;
+		ids[nsymbols++] = bus_find(&bus, tok);
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	snap_reader_init(&rd, bus.snap, SNAP_R_ALL);
+	while (running) {
+		t0 = mono_ns();
+		n = snap_scan(&rd, dirty);
+		t1 = mono_ns();
+
+		/* what a strategy does with the scan: the last tick of every one changed */
+		for (got = 0, w = 0; w < nw; w++) {
+			for (bits = dirty[w]; bits != 0; bits &= bits - 1) {
+				id = (uint32_t)(w * SNAP_GROUP + (size_t)__builtin_ctzll(bits));
+				if (snap_get(&rd, id, &t) == 0) {
+					got++;
+					if (all) {
+						print_book(&bus, &t);
+					}
+				}
+			}
+		}
+		t2 = mono_ns();
+
+		printf("changed %zu read %zu of %u instruments, scan %.1fus read %.1fus, retries %lu\n",
+		       n, got, atomic_load_explicit(&bus.hdr->nsymbols, memory_order_acquire),
+		       (double)(t1 - t0) / 1e3, (double)(t2 - t1) / 1e3, (unsigned long)rd.retries);
+		for (i = 0; i < nsymbols; i++) {
+			if (ids[i] == 0) {
+				ids[i] = bus_find(&bus, names[i]);
+			}
+			if (snap_get(&rd, ids[i], &t) == 0) {
+				print_book(&bus, &t);
+			} else {
+				printf("%s none\n", names[i]);
+			}
+		}
+		fflush(stdout);
+
+		if (interval <= 0) {
+			break;
+		}
+		sleep((unsigned)interval);
+	}
+
+	free(copy);
+	free(dirty);
+	bus_close(&bus);
+
+	return 0;
+}
@@ -13,6 +13,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
 
 enum md_type {
 	MD_T_CTP = 0,
@@ -23,6 +25,7 @@ enum md_type {
 	MD_T_INE,
 	MD_T_SSE,
 	MD_T_SZSE,
+	MD_T_JUPITER,		/* tick_frame of tick_rec, our own wire and file format */
 	MD_T_MAX
 };
 
@@ -54,6 +57,150 @@ typedef struct tick_data
 	} all_pvs;
 } tick_data_t;
 
+#define TICK_CACHELINE	64
+#define TICK_DEPTH	5		/* depth levels carried inline in tick_rec */
+#define TICK_PX_SCALE	10000		/* prices are int64 in units of 1/10000 */
+#define TICK_PX_MAX	9.2e14		/* under INT64_MAX / TICK_PX_SCALE, larger prices are 0 */
+
+#define TICK_SYMBOL_LEN		32
+#define TICK_INSTRUMENT_MAX	65536	/* capacity of the intern table */
+
+/* flags of tick_rec */
+#define TICK_F_AUCTION	0x0001		/* snapshot of the call auction */
+
+/*
+ * tick_rec - the flat tick record. It is plain data of a fixed size with no
+ * pointers: the symbol is an interned instrument id, the depth is inline and
+ * all prices are fixed point. The same bytes are used on the wire, in the
+ * rings and in the tick files, so it is never converted on the way.
+ */
+typedef struct tick_rec
+{
+	/* cache line 0: identity, time and trade */
+	uint64_t timestamp;	/* exchange time in ns since epoch */
+	uint64_t recv_ts;	/* local receive time in ns since epoch */
+	uint32_t instrument;	/* interned instrument id, see tick_intern() */
+	uint32_t seq;		/* sequence number of the packet in the channel */
+	uint16_t channel;	/* channel of the feed the tick came from */
+	uint8_t md_type;	/* enum md_type of the source */
+	uint8_t level;		/* number of valid depth levels */
+	uint32_t flags;		/* TICK_F_* */
+	int64_t last;		/* last price */
+	int64_t volume;		/* accumulated volume of the day */
+	int64_t turnover;	/* accumulated turnover of the day, fixed point */
+	int64_t open_interest;	/* open interest */
+
+	/* cache line 1: statistics of the session */
+	int64_t open;
+	int64_t high;
+	int64_t low;
+	int64_t pre_close;
+	int64_t pre_settle;
+	int64_t pre_oi;
+	int64_t upper_limit;
+	int64_t lower_limit;
+
+	/* cache line 2 and 3: depth, a level with zero volume is empty */
+	int64_t bid[TICK_DEPTH];
+	int64_t ask[TICK_DEPTH];
+	int32_t bid_vol[TICK_DEPTH];
+	int32_t ask_vol[TICK_DEPTH];
+	uint32_t lat_picked;	/* ns from recv_ts to the decoder, 0 if not stamped, see lat.h */
+	uint32_t lat_published;	/* ns from recv_ts to the publish */
+} __attribute__((aligned(TICK_CACHELINE))) tick_rec_t;
+
+_Static_assert(sizeof(tick_rec_t) == 4 * TICK_CACHELINE, "tick_rec must be 4 cache lines");
+
+#define TICK_MAGIC	0x4b43544aU	/* "JTCK" */
+#define TICK_VERSION	1
+
+/*
+ * tick_frame - header of a batch of tick records on the wire or in a file.
+ * It is half a cache line, so the records behind it stay cache-line aligned
+ * in a raw_pkt slot whose header is also half a cache line.
+ */
+typedef struct tick_frame
+{
+	uint32_t magic;		/* TICK_MAGIC */
+	uint16_t version;	/* TICK_VERSION */
+	uint16_t count;		/* records following the header */
+	uint32_t seq;		/* sequence number of the frame in the channel */
+	uint16_t channel;	/* channel of the frame */
+	uint16_t reserved;
+	uint64_t send_ts;	/* time the frame was sent in ns since epoch */
+	uint64_t reserved2;
+} tick_frame_t;
+
+_Static_assert(sizeof(tick_frame_t) == TICK_CACHELINE / 2, "tick_frame must be half a cache line");
+
+/*
+ * tick_px - convert a floating point price into fixed point. Exchanges send
+ * DBL_MAX or NaN for fields without value; they become 0, like any price
+ * out of the range of the fixed point.
+ */
+static inline int64_t
+tick_px(double px)
+{
+	if (!(px > -TICK_PX_MAX && px < TICK_PX_MAX)) {
+		return 0;
+	}
+
+	return (int64_t)(px * TICK_PX_SCALE + (px < 0 ? -0.5 : 0.5));
+}
+
+static inline double
+tick_px_double(int64_t px)
+{
+	return (double)px / TICK_PX_SCALE;
+}
+
+/*
+ * tick_view - overlay the records of a frame in the buffer without copying.
+ * It returns NULL if the buffer is not a complete frame, or if the records
+ * are not cache-line aligned in memory (copy the frame first then).
+ */
+static inline const tick_rec_t *
+tick_view(const void *buf, size_t len, size_t *count)
+{
+	const tick_frame_t *fr = (const tick_frame_t *)buf;
+	const uint8_t *recs = (const uint8_t *)buf + sizeof(tick_frame_t);
+
+	if (len < sizeof(tick_frame_t) || fr->magic != TICK_MAGIC || fr->version != TICK_VERSION) {
+		return NULL;
+	}
+
+	if (len < sizeof(tick_frame_t) + (size_t)fr->count * sizeof(tick_rec_t)) {
+		return NULL;
+	}
+
+	if (((uintptr_t)recs & (TICK_CACHELINE - 1)) != 0) {
+		return NULL;
+	}
+
+	if (count != NULL) {
+		*count = fr->count;
+	}
+
+	return (const tick_rec_t *)recs;
+}
+
+/*
+ * tick_intern - get the instrument id of the symbol, adding it on first use.
+ * Ids are dense and start from 1; 0 means no id (the table is full).
+ * tick_lookup() never adds, tick_symbol() maps the id back.
+ */
+uint32_t tick_intern(const char *symbol, size_t len);
+uint32_t tick_lookup(const char *symbol, size_t len);
+const char *tick_symbol(uint32_t id);
+uint32_t tick_instruments(void);
+
+/*
+ * tick_intern_share - move the symbols into names (TICK_INSTRUMENT_MAX
+ * entries) and their count into *count, e.g. in a shared memory segment,
+ * so other processes resolve the ids. Call it before decoding starts.
+ */
+void tick_intern_share(char (*names)[TICK_SYMBOL_LEN], _Atomic uint32_t *count);
+
 /*
  * read_tick - read tick data from the buffer. 
  */
@@ -0,0 +1,199 @@
+/*
+ * cffex.c
+ *
+ * The decoder of the CFFEX market data feed. A packet is a header followed by
+ * count fixed-size snapshots in little endian byte order. CFFEX has no night
+ * session, so the trading day in the header is also the calendar day.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "decode.h"
+#include "parse.h"
+
+struct cffex_hdr
+{
+	uint32_t seq;		/* sequence number of the packet */
+	uint16_t count;		/* snapshots in the packet */
+	uint16_t len;		/* bytes of the packet including the header */
+	uint32_t trading_day;	/* YYYYMMDD */
+	uint32_t reserved;
+} __attribute__((packed));
+
+struct cffex_snap
+{
+	char instrument[16];	/* instrument id, NUL padded */
+	uint32_t update_time;	/* HHMMSSmmm */
+	uint32_t depth;		/* valid depth levels */
+	double last;
+	double pre_settle;
+	double pre_close;
+	double pre_oi;
+	double open;
+	double high;
+	double low;
+	double upper_limit;
+	double lower_limit;
+	int64_t volume;
+	double turnover;
+	double open_interest;
+	double bid[TICK_DEPTH];
+	double ask[TICK_DEPTH];
+	int32_t bid_vol[TICK_DEPTH];
+	int32_t ask_vol[TICK_DEPTH];
+} __attribute__((packed));
+
+#define F(field)	(offsetof(struct cffex_snap, field))
+
+static void
+decode_snap(const uint8_t *p, uint32_t day, uint32_t seq, tick_rec_t *r)
+{
+	uint32_t t = rd_le32(p + F(update_time));
+	uint32_t sec = (t / 10000000) * 3600 + (t / 100000 % 100) * 60 + (t / 1000 % 100);
+	uint64_t volume;
+	int k;
+
+	memset(r, 0, sizeof(*r));
+	r->timestamp = cn_timestamp(day, sec, t % 1000);
+	r->instrument = tick_intern((const char *)p + F(instrument), 16);
+	r->seq = seq;
+	r->level = (uint8_t)rd_le32(p + F(depth));
+	if (r->level > TICK_DEPTH) {
+		r->level = TICK_DEPTH;
+	}
+
+	r->last = tick_px(rd_le_double(p + F(last)));
+	r->pre_settle = tick_px(rd_le_double(p + F(pre_settle)));
+	r->pre_close = tick_px(rd_le_double(p + F(pre_close)));
+	r->pre_oi = (int64_t)(rd_le_double(p + F(pre_oi)) + 0.5);
+	r->open = tick_px(rd_le_double(p + F(open)));
+	r->high = tick_px(rd_le_double(p + F(high)));
+	r->low = tick_px(rd_le_double(p + F(low)));
+	r->upper_limit = tick_px(rd_le_double(p + F(upper_limit)));
+	r->lower_limit = tick_px(rd_le_double(p + F(lower_limit)));
+	memcpy(&volume, p + F(volume), sizeof(volume));
+	r->volume = (int64_t)le64toh(volume);
+	r->turnover = tick_px(rd_le_double(p + F(turnover)));
+	r->open_interest = (int64_t)(rd_le_double(p + F(open_interest)) + 0.5);
+
+	for (k = 0; k < r->level; k++) {
+		r->bid[k] = tick_px(rd_le_double(p + F(bid) + k * 8));
+		r->ask[k] = tick_px(rd_le_double(p + F(ask) + k * 8));
+		r->bid_vol[k] = (int32_t)rd_le32(p + F(bid_vol) + k * 4);
+		r->ask_vol[k] = (int32_t)rd_le32(p + F(ask_vol) + k * 4);
+	}
+}
+
+static size_t
+cffex_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	size_t off = 0, done = 0;
+
+	while (off + sizeof(struct cffex_hdr) <= len) {
+		const uint8_t *p = buf + off;
+		uint32_t seq = rd_le32(p + offsetof(struct cffex_hdr, seq));
+		uint32_t count = rd_le16(p + offsetof(struct cffex_hdr, count));
+		uint32_t plen = rd_le16(p + offsetof(struct cffex_hdr, len));
+		uint32_t day = rd_le32(p + offsetof(struct cffex_hdr, trading_day));
+		uint32_t i;
+
+		if (count > DECODE_MSGS_MAX || plen != sizeof(struct cffex_hdr) + count * sizeof(struct cffex_snap)) {
+			off = len;
+			break;
+		}
+
+		if (off + plen > len || done + count > n) {
+			break;
+		}
+
+		p += sizeof(struct cffex_hdr);
+		for (i = 0; i < count; i++, p += sizeof(struct cffex_snap)) {
+			decode_snap(p, day, seq, &out[done++]);
+		}
+
+		off += plen;
+	}
+
+	*used = off;
+
+	return done;
+}
+
+/* one sequence for the feed, channel 0 */
+static int
+cffex_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	if (len < sizeof(struct cffex_hdr)) {
+		return -1;
+	}
+	*channel = 0;
+	*seq = rd_le32(buf + offsetof(struct cffex_hdr, seq));
+
+	return 0;
+}
+
+static void
+encode_snap(const tick_rec_t *r, uint8_t *p)
+{
+	uint32_t day, sec, ms;
+	int k;
+
+	memset(p, 0, sizeof(struct cffex_snap));
+	wr_symbol((char *)p + F(instrument), 16, r->instrument, '\0');
+	cn_time(r->timestamp, &day, &sec, &ms);
+	wr_le32(p + F(update_time), (sec / 3600 * 10000 + sec / 60 % 60 * 100 + sec % 60) * 1000 + ms);
+	wr_le32(p + F(depth), r->level);
+
+	wr_le_double(p + F(last), tick_px_double(r->last));
+	wr_le_double(p + F(pre_settle), tick_px_double(r->pre_settle));
+	wr_le_double(p + F(pre_close), tick_px_double(r->pre_close));
+	wr_le_double(p + F(pre_oi), (double)r->pre_oi);
+	wr_le_double(p + F(open), tick_px_double(r->open));
+	wr_le_double(p + F(high), tick_px_double(r->high));
+	wr_le_double(p + F(low), tick_px_double(r->low));
+	wr_le_double(p + F(upper_limit), tick_px_double(r->upper_limit));
+	wr_le_double(p + F(lower_limit), tick_px_double(r->lower_limit));
+	wr_le64(p + F(volume), (uint64_t)r->volume);
+	wr_le_double(p + F(turnover), tick_px_double(r->turnover));
+	wr_le_double(p + F(open_interest), (double)r->open_interest);
+
+	for (k = 0; k < r->level && k < TICK_DEPTH; k++) {
+		wr_le_double(p + F(bid) + k * 8, tick_px_double(r->bid[k]));
+		wr_le_double(p + F(ask) + k * 8, tick_px_double(r->ask[k]));
+		wr_le32(p + F(bid_vol) + k * 4, (uint32_t)r->bid_vol[k]);
+		wr_le32(p + F(ask_vol) + k * 4, (uint32_t)r->ask_vol[k]);
+	}
+}
+
+static size_t
+cffex_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	size_t cnt, plen, i;
+	uint32_t day;
+
+	*done = 0;
+	if ((cnt = encode_fit(in, n, len, sizeof(struct cffex_hdr), sizeof(struct cffex_snap), DECODE_MSGS_MAX,
+			      &day)) == 0) {
+		return 0;
+	}
+	plen = sizeof(struct cffex_hdr) + cnt * sizeof(struct cffex_snap);
+
+	memset(buf, 0, sizeof(struct cffex_hdr));
+	wr_le32(buf + offsetof(struct cffex_hdr, seq), seq);
+	wr_le16(buf + offsetof(struct cffex_hdr, count), (uint16_t)cnt);
+	wr_le16(buf + offsetof(struct cffex_hdr, len), (uint16_t)plen);
+	wr_le32(buf + offsetof(struct cffex_hdr, trading_day), day);
+
+	for (i = 0; i < cnt; i++) {
+		encode_snap(&in[i], buf + sizeof(struct cffex_hdr) + i * sizeof(struct cffex_snap));
+	}
+	*done = cnt;
+
+	return plen;
+}
+
+const struct tick_decoder cffex_decoder = { "CFFEX", cffex_decode, cffex_seq, cffex_encode };
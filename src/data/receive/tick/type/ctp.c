@@ -0,0 +1,240 @@
+/*
+ * ctp.c
+ *
+ * The decoder of CTP depth market data. The buffer holds consecutive
+ * CThostFtdcDepthMarketDataField structs exactly as the MdApi hands them to
+ * OnRtnDepthMarketData(), so the struct is mirrored here with the same field
+ * order and natural alignment as ThostFtdcUserApiStruct.h.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "parse.h"
+
+struct ctp_depth_md
+{
+	char trading_day[9];
+	char reserve1[31];
+	char exchange_id[9];
+	char reserve2[31];
+	double last_price;
+	double pre_settlement_price;
+	double pre_close_price;
+	double pre_open_interest;
+	double open_price;
+	double highest_price;
+	double lowest_price;
+	int volume;
+	double turnover;
+	double open_interest;
+	double close_price;
+	double settlement_price;
+	double upper_limit_price;
+	double lower_limit_price;
+	double pre_delta;
+	double curr_delta;
+	char update_time[9];
+	int update_millisec;
+	double bid_price1;
+	int bid_volume1;
+	double ask_price1;
+	int ask_volume1;
+	double bid_price2;
+	int bid_volume2;
+	double ask_price2;
+	int ask_volume2;
+	double bid_price3;
+	int bid_volume3;
+	double ask_price3;
+	int ask_volume3;
+	double bid_price4;
+	int bid_volume4;
+	double ask_price4;
+	int ask_volume4;
+	double bid_price5;
+	int bid_volume5;
+	double ask_price5;
+	int ask_volume5;
+	double average_price;
+	char action_day[9];
+	char instrument_id[81];
+	char exchange_inst_id[81];
+	double banding_upper_price;
+	double banding_lower_price;
+};
+
+/*
+ * prev_weekday - the weekday before the day, skipping the weekend. It stands
+ * in for the trading calendar for the DCE night session below.
+ */
+static int64_t
+prev_weekday(int64_t days)
+{
+	do {
+		days--;
+	} while ((days + 4) % 7 == 0 || (days + 4) % 7 == 6);
+
+	return days;
+}
+
+/*
+ * ctp_timestamp - the exchange time of the snapshot. DCE fills ActionDay with
+ * the trading day during the night session, so the calendar day is derived
+ * from the day before the trading day.
+ */
+static uint64_t
+ctp_timestamp(const struct ctp_depth_md *md)
+{
+	int32_t sec = parse_hhmmss(md->update_time);
+	uint32_t action, trading;
+	int64_t days;
+
+	if (unlikely(sec < 0 || !is_8digits(md->action_day))) {
+		return 0;
+	}
+
+	action = parse_8digits(md->action_day);
+	if (is_8digits(md->trading_day) && (trading = parse_8digits(md->trading_day)) == action &&
+	    (sec >= 18 * 3600 || sec < 3 * 3600) && memcmp(md->exchange_id, "DCE", 4) == 0) {
+		days = days_from_civil(trading / 10000, (trading / 100) % 100, trading % 100);
+		days = prev_weekday(days) + (sec < 3 * 3600 ? 1 : 0);
+
+		return (uint64_t)((days * 86400 + sec - 8 * 3600) * 1000000000LL) +
+		       (uint64_t)md->update_millisec * 1000000ULL;
+	}
+
+	return cn_timestamp(action, (uint32_t)sec, (uint32_t)md->update_millisec);
+}
+
+static size_t
+ctp_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	const size_t sz = sizeof(struct ctp_depth_md);
+	size_t i;
+
+	for (i = 0; i < n && (i + 1) * sz <= len; i++) {
+		struct ctp_depth_md md;
+		tick_rec_t *r = &out[i];
+
+		/* the buffer may be unaligned, e.g. inside a tick file block */
+		memcpy(&md, buf + i * sz, sz);
+
+		memset(r, 0, sizeof(*r));
+		r->timestamp = ctp_timestamp(&md);
+		/* adds a symbol not seen, e.g. of a tick file; the ctp source interns its own at open */
+		r->instrument = tick_intern(md.instrument_id, sizeof(md.instrument_id));
+		r->last = tick_px(md.last_price);
+		r->volume = md.volume;
+		r->turnover = tick_px(md.turnover);
+		r->open_interest = (int64_t)(md.open_interest + 0.5);
+		r->open = tick_px(md.open_price);
+		r->high = tick_px(md.highest_price);
+		r->low = tick_px(md.lowest_price);
+		r->pre_close = tick_px(md.pre_close_price);
+		r->pre_settle = tick_px(md.pre_settlement_price);
+		r->pre_oi = (int64_t)(md.pre_open_interest + 0.5);
+		r->upper_limit = tick_px(md.upper_limit_price);
+		r->lower_limit = tick_px(md.lower_limit_price);
+
+		r->bid[0] = tick_px(md.bid_price1);
+		r->bid[1] = tick_px(md.bid_price2);
+		r->bid[2] = tick_px(md.bid_price3);
+		r->bid[3] = tick_px(md.bid_price4);
+		r->bid[4] = tick_px(md.bid_price5);
+		r->ask[0] = tick_px(md.ask_price1);
+		r->ask[1] = tick_px(md.ask_price2);
+		r->ask[2] = tick_px(md.ask_price3);
+		r->ask[3] = tick_px(md.ask_price4);
+		r->ask[4] = tick_px(md.ask_price5);
+		r->bid_vol[0] = md.bid_volume1;
+		r->bid_vol[1] = md.bid_volume2;
+		r->bid_vol[2] = md.bid_volume3;
+		r->bid_vol[3] = md.bid_volume4;
+		r->bid_vol[4] = md.bid_volume5;
+		r->ask_vol[0] = md.ask_volume1;
+		r->ask_vol[1] = md.ask_volume2;
+		r->ask_vol[2] = md.ask_volume3;
+		r->ask_vol[3] = md.ask_volume4;
+		r->ask_vol[4] = md.ask_volume5;
+
+		/* only level 1 is filled by the exchanges pushing L1 through CTP */
+		r->level = (md.bid_volume2 | md.ask_volume2) ? TICK_DEPTH : 1;
+	}
+
+	*used = i * sz;
+
+	return i;
+}
+
+/* the struct of an MdApi without the DCE night: the trading day is the action day */
+static void
+encode_md(const tick_rec_t *r, struct ctp_depth_md *md)
+{
+	const char *sym = tick_symbol(r->instrument);
+	uint32_t day, sec, ms;
+
+	memset(md, 0, sizeof(*md));
+	cn_time(r->timestamp, &day, &sec, &ms);
+	snprintf(md->trading_day, sizeof(md->trading_day), "%08u", day);
+	snprintf(md->action_day, sizeof(md->action_day), "%08u", day);
+	snprintf(md->update_time, sizeof(md->update_time), "%02u:%02u:%02u", sec / 3600, sec / 60 % 60, sec % 60);
+	md->update_millisec = (int)ms;
+	snprintf(md->instrument_id, sizeof(md->instrument_id), "%s", sym != NULL ? sym : "");
+
+	md->last_price = tick_px_double(r->last);
+	md->volume = (int)r->volume;
+	md->turnover = tick_px_double(r->turnover);
+	md->open_interest = (double)r->open_interest;
+	md->open_price = tick_px_double(r->open);
+	md->highest_price = tick_px_double(r->high);
+	md->lowest_price = tick_px_double(r->low);
+	md->pre_close_price = tick_px_double(r->pre_close);
+	md->pre_settlement_price = tick_px_double(r->pre_settle);
+	md->pre_open_interest = (double)r->pre_oi;
+	md->upper_limit_price = tick_px_double(r->upper_limit);
+	md->lower_limit_price = tick_px_double(r->lower_limit);
+
+	md->bid_price1 = tick_px_double(r->bid[0]);
+	md->bid_price2 = tick_px_double(r->bid[1]);
+	md->bid_price3 = tick_px_double(r->bid[2]);
+	md->bid_price4 = tick_px_double(r->bid[3]);
+	md->bid_price5 = tick_px_double(r->bid[4]);
+	md->ask_price1 = tick_px_double(r->ask[0]);
+	md->ask_price2 = tick_px_double(r->ask[1]);
+	md->ask_price3 = tick_px_double(r->ask[2]);
+	md->ask_price4 = tick_px_double(r->ask[3]);
+	md->ask_price5 = tick_px_double(r->ask[4]);
+	md->bid_volume1 = r->bid_vol[0];
+	md->bid_volume2 = r->bid_vol[1];
+	md->bid_volume3 = r->bid_vol[2];
+	md->bid_volume4 = r->bid_vol[3];
+	md->bid_volume5 = r->bid_vol[4];
+	md->ask_volume1 = r->ask_vol[0];
+	md->ask_volume2 = r->ask_vol[1];
+	md->ask_volume3 = r->ask_vol[2];
+	md->ask_volume4 = r->ask_vol[3];
+	md->ask_volume5 = r->ask_vol[4];
+}
+
+static size_t
+ctp_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	const size_t sz = sizeof(struct ctp_depth_md);
+	struct ctp_depth_md md;
+	size_t i;
+
+	(void)seq;
+	for (i = 0; i < n && i < DECODE_MSGS_MAX && (i + 1) * sz <= len; i++) {
+		encode_md(&in[i], &md);
+		memcpy(buf + i * sz, &md, sz);
+	}
+	*done = i;
+
+	return i * sz;
+}
+
+const struct tick_decoder ctp_decoder = { "CTP", ctp_decode, NULL, ctp_encode };
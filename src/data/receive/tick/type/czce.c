@@ -0,0 +1,227 @@
+/*
+ * czce.c
+ *
+ * The decoder of the CZCE market data feed. The feed is ASCII text of fixed
+ * width: a packet is a header line followed by count snapshot lines, with all
+ * numbers right-aligned and blank padded, so every field sits at a known
+ * offset and is converted by parse_decimal() without scanning for delimiters.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "parse.h"
+
+#define W_PX	12		/* width of a price or volume field */
+#define W_VOL	8		/* width of a depth volume field */
+
+struct czce_hdr
+{
+	char tag[4];		/* "CZCE" */
+	char seq[10];		/* sequence number of the packet */
+	char count[4];		/* snapshot lines in the packet */
+	char action_day[8];	/* calendar day YYYYMMDD */
+	char pad[5];
+	char eol;		/* '\n' */
+};
+
+struct czce_snap
+{
+	char instrument[12];	/* instrument id, blank padded */
+	char update_time[12];	/* HH:MM:SS.mmm */
+	char last[W_PX];
+	char pre_settle[W_PX];
+	char pre_close[W_PX];
+	char pre_oi[W_PX];
+	char open[W_PX];
+	char high[W_PX];
+	char low[W_PX];
+	char upper_limit[W_PX];
+	char lower_limit[W_PX];
+	char volume[W_PX];
+	char open_interest[W_PX];
+	char turnover[16];
+	char bid[TICK_DEPTH][W_PX];
+	char bid_vol[TICK_DEPTH][W_VOL];
+	char ask[TICK_DEPTH][W_PX];
+	char ask_vol[TICK_DEPTH][W_VOL];
+	char eol;		/* '\n' */
+};
+
+_Static_assert(sizeof(struct czce_hdr) == 32, "czce header is 32 bytes");
+
+#define PX(field, out)	(parse_decimal(s->field, sizeof(s->field), 4, (out)))
+
+static int
+decode_snap(const struct czce_snap *s, uint32_t day, uint32_t seq, tick_rec_t *r)
+{
+	int32_t sec = parse_hhmmss(s->update_time);
+	int64_t ms, v;
+	int k, err = 0;
+
+	memset(r, 0, sizeof(*r));
+	if (sec < 0 || s->update_time[8] != '.' || parse_uint(s->update_time + 9, 3, &ms) != 0) {
+		return -1;
+	}
+
+	r->timestamp = cn_timestamp(day, (uint32_t)sec, (uint32_t)ms);
+	r->instrument = tick_intern(s->instrument, sizeof(s->instrument));
+	r->seq = seq;
+
+	err |= PX(last, &r->last);
+	err |= PX(pre_settle, &r->pre_settle);
+	err |= PX(pre_close, &r->pre_close);
+	err |= parse_uint(s->pre_oi, W_PX, &r->pre_oi);
+	err |= PX(open, &r->open);
+	err |= PX(high, &r->high);
+	err |= PX(low, &r->low);
+	err |= PX(upper_limit, &r->upper_limit);
+	err |= PX(lower_limit, &r->lower_limit);
+	err |= parse_uint(s->volume, W_PX, &r->volume);
+	err |= parse_uint(s->open_interest, W_PX, &r->open_interest);
+	err |= PX(turnover, &r->turnover);
+
+	for (k = 0; k < TICK_DEPTH; k++) {
+		err |= PX(bid[k], &r->bid[k]);
+		err |= PX(ask[k], &r->ask[k]);
+		err |= parse_uint(s->bid_vol[k], W_VOL, &v);
+		r->bid_vol[k] = (int32_t)v;
+		err |= parse_uint(s->ask_vol[k], W_VOL, &v);
+		r->ask_vol[k] = (int32_t)v;
+		if (r->bid_vol[k] != 0 || r->ask_vol[k] != 0) {
+			r->level = (uint8_t)(k + 1);
+		}
+	}
+
+	return err;
+}
+
+static size_t
+czce_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	size_t off = 0, done = 0;
+
+	while (off + sizeof(struct czce_hdr) <= len) {
+		const struct czce_hdr *h = (const struct czce_hdr *)(buf + off);
+		const struct czce_snap *s;
+		int64_t seq, count;
+		size_t plen, i;
+		uint32_t day;
+
+		if (memcmp(h->tag, "CZCE", 4) != 0 || h->eol != '\n' ||
+		    parse_uint(h->seq, sizeof(h->seq), &seq) != 0 ||
+		    parse_uint(h->count, sizeof(h->count), &count) != 0 ||
+		    count > DECODE_MSGS_MAX || !is_8digits(h->action_day)) {
+			off = len;
+			break;
+		}
+
+		plen = sizeof(struct czce_hdr) + (size_t)count * sizeof(struct czce_snap);
+		if (off + plen > len || done + (size_t)count > n) {
+			break;
+		}
+
+		day = parse_8digits(h->action_day);
+		s = (const struct czce_snap *)(buf + off + sizeof(struct czce_hdr));
+		for (i = 0; i < (size_t)count; i++, s++) {
+			/* a malformed line is dropped, the rest of the packet is kept */
+			if (s->eol == '\n' && decode_snap(s, day, (uint32_t)seq, &out[done]) == 0) {
+				done++;
+			}
+		}
+
+		off += plen;
+	}
+
+	*used = off;
+
+	return done;
+}
+
+/* one sequence for the feed, channel 0 */
+static int
+czce_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	const struct czce_hdr *h = (const struct czce_hdr *)buf;
+	int64_t v;
+
+	if (len < sizeof(*h) || memcmp(h->tag, "CZCE", 4) != 0 || parse_uint(h->seq, sizeof(h->seq), &v) != 0) {
+		return -1;
+	}
+	*channel = 0;
+	*seq = (uint32_t)v;
+
+	return 0;
+}
+
+#define WR(field, v, places)	(wr_ascii(s->field, (int)sizeof(s->field), (v), (places)))
+
+static void
+encode_snap(const tick_rec_t *r, struct czce_snap *s)
+{
+	uint32_t day, sec, ms;
+	char hms[16];
+	int k;
+
+	wr_symbol(s->instrument, sizeof(s->instrument), r->instrument, ' ');
+	cn_time(r->timestamp, &day, &sec, &ms);
+	snprintf(hms, sizeof(hms), "%02u:%02u:%02u.%03u", sec / 3600, sec / 60 % 60, sec % 60, ms);
+	memcpy(s->update_time, hms, sizeof(s->update_time));
+
+	WR(last, r->last, 4);
+	WR(pre_settle, r->pre_settle, 4);
+	WR(pre_close, r->pre_close, 4);
+	WR(pre_oi, r->pre_oi, 0);
+	WR(open, r->open, 4);
+	WR(high, r->high, 4);
+	WR(low, r->low, 4);
+	WR(upper_limit, r->upper_limit, 4);
+	WR(lower_limit, r->lower_limit, 4);
+	WR(volume, r->volume, 0);
+	WR(open_interest, r->open_interest, 0);
+	WR(turnover, r->turnover, 4);
+
+	/* the levels past the depth are zero, which is what marks them empty */
+	for (k = 0; k < TICK_DEPTH; k++) {
+		WR(bid[k], k < r->level ? r->bid[k] : 0, 4);
+		WR(ask[k], k < r->level ? r->ask[k] : 0, 4);
+		WR(bid_vol[k], k < r->level ? r->bid_vol[k] : 0, 0);
+		WR(ask_vol[k], k < r->level ? r->ask_vol[k] : 0, 0);
+	}
+	s->eol = '\n';
+}
+
+static size_t
+czce_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	struct czce_hdr *h = (struct czce_hdr *)buf;
+	size_t cnt, i;
+	uint32_t day;
+	char tmp[16];
+
+	*done = 0;
+	if ((cnt = encode_fit(in, n, len, sizeof(struct czce_hdr), sizeof(struct czce_snap), DECODE_MSGS_MAX,
+			      &day)) == 0) {
+		return 0;
+	}
+
+	memcpy(h->tag, "CZCE", 4);
+	wr_ascii(h->seq, sizeof(h->seq), seq, 0);
+	wr_ascii(h->count, sizeof(h->count), (int64_t)cnt, 0);
+	snprintf(tmp, sizeof(tmp), "%08u", day);
+	memcpy(h->action_day, tmp, 8);
+	memset(h->pad, ' ', sizeof(h->pad));
+	h->eol = '\n';
+
+	for (i = 0; i < cnt; i++) {
+		encode_snap(&in[i], (struct czce_snap *)(buf + sizeof(struct czce_hdr)) + i);
+	}
+	*done = cnt;
+
+	return sizeof(struct czce_hdr) + cnt * sizeof(struct czce_snap);
+}
+
+const struct tick_decoder czce_decoder = { "CZCE", czce_decode, czce_seq, czce_encode };
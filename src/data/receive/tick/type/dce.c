@@ -0,0 +1,202 @@
+/*
+ * dce.c
+ *
+ * The decoder of the DCE market data feed. A packet is a header followed by
+ * count fixed-size snapshots in network byte order. Prices are integers in
+ * units of 1/DCE_PX_SCALE, so no floating point is involved.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "decode.h"
+#include "parse.h"
+
+#define DCE_PX_SCALE	1000
+
+struct dce_hdr
+{
+	uint16_t len;		/* bytes of the packet including the header */
+	uint16_t count;		/* snapshots in the packet */
+	uint32_t seq;		/* sequence number of the packet */
+	uint32_t action_day;	/* calendar day YYYYMMDD */
+	uint32_t reserved;
+} __attribute__((packed));
+
+struct dce_snap
+{
+	char instrument[16];	/* instrument id, NUL padded */
+	uint32_t update_time;	/* ms since midnight */
+	uint16_t depth;		/* valid depth levels */
+	uint16_t reserved;
+	int64_t last;
+	int64_t pre_settle;
+	int64_t pre_close;
+	int64_t pre_oi;
+	int64_t open;
+	int64_t high;
+	int64_t low;
+	int64_t upper_limit;
+	int64_t lower_limit;
+	int64_t volume;
+	int64_t turnover;	/* in units of 1/DCE_PX_SCALE too */
+	int64_t open_interest;
+	int64_t bid[TICK_DEPTH];
+	int32_t bid_vol[TICK_DEPTH];
+	int64_t ask[TICK_DEPTH];
+	int32_t ask_vol[TICK_DEPTH];
+} __attribute__((packed));
+
+#define F(field)	(offsetof(struct dce_snap, field))
+#define PX(field)	((int64_t)rd_be64(p + F(field)) * (TICK_PX_SCALE / DCE_PX_SCALE))
+
+static void
+decode_snap(const uint8_t *p, uint32_t day, uint32_t seq, tick_rec_t *r)
+{
+	uint32_t ms = rd_be32(p + F(update_time));
+	int k;
+
+	memset(r, 0, sizeof(*r));
+	r->timestamp = cn_timestamp(day, ms / 1000, ms % 1000);
+	r->instrument = tick_intern((const char *)p + F(instrument), 16);
+	r->seq = seq;
+	r->level = (uint8_t)rd_be16(p + F(depth));
+	if (r->level > TICK_DEPTH) {
+		r->level = TICK_DEPTH;
+	}
+
+	r->last = PX(last);
+	r->pre_settle = PX(pre_settle);
+	r->pre_close = PX(pre_close);
+	r->pre_oi = (int64_t)rd_be64(p + F(pre_oi));
+	r->open = PX(open);
+	r->high = PX(high);
+	r->low = PX(low);
+	r->upper_limit = PX(upper_limit);
+	r->lower_limit = PX(lower_limit);
+	r->volume = (int64_t)rd_be64(p + F(volume));
+	r->turnover = PX(turnover);
+	r->open_interest = (int64_t)rd_be64(p + F(open_interest));
+
+	for (k = 0; k < r->level; k++) {
+		r->bid[k] = PX(bid[k]);
+		r->ask[k] = PX(ask[k]);
+		r->bid_vol[k] = (int32_t)rd_be32(p + F(bid_vol[k]));
+		r->ask_vol[k] = (int32_t)rd_be32(p + F(ask_vol[k]));
+	}
+}
+
+static size_t
+dce_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	size_t off = 0, done = 0;
+
+	while (off + sizeof(struct dce_hdr) <= len) {
+		const uint8_t *p = buf + off;
+		uint16_t plen = rd_be16(p + offsetof(struct dce_hdr, len));
+		uint16_t count = rd_be16(p + offsetof(struct dce_hdr, count));
+		uint32_t seq = rd_be32(p + offsetof(struct dce_hdr, seq));
+		uint32_t day = rd_be32(p + offsetof(struct dce_hdr, action_day));
+		uint32_t i;
+
+		if (count > DECODE_MSGS_MAX || plen != sizeof(struct dce_hdr) + count * sizeof(struct dce_snap)) {
+			off = len;
+			break;
+		}
+
+		if (off + plen > len || done + count > n) {
+			break;
+		}
+
+		p += sizeof(struct dce_hdr);
+		for (i = 0; i < count; i++, p += sizeof(struct dce_snap)) {
+			decode_snap(p, day, seq, &out[done++]);
+		}
+
+		off += plen;
+	}
+
+	*used = off;
+
+	return done;
+}
+
+/* one sequence for the feed, channel 0 */
+static int
+dce_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	if (len < sizeof(struct dce_hdr)) {
+		return -1;
+	}
+	*channel = 0;
+	*seq = rd_be32(buf + offsetof(struct dce_hdr, seq));
+
+	return 0;
+}
+
+#define WR_PX(field, v)	(wr_be64(p + F(field), (uint64_t)((v) / (TICK_PX_SCALE / DCE_PX_SCALE))))
+
+static void
+encode_snap(const tick_rec_t *r, uint8_t *p)
+{
+	uint32_t day, sec, ms;
+	int k;
+
+	memset(p, 0, sizeof(struct dce_snap));
+	wr_symbol((char *)p + F(instrument), 16, r->instrument, '\0');
+	cn_time(r->timestamp, &day, &sec, &ms);
+	wr_be32(p + F(update_time), sec * 1000 + ms);
+	wr_be16(p + F(depth), r->level);
+
+	WR_PX(last, r->last);
+	WR_PX(pre_settle, r->pre_settle);
+	WR_PX(pre_close, r->pre_close);
+	wr_be64(p + F(pre_oi), (uint64_t)r->pre_oi);
+	WR_PX(open, r->open);
+	WR_PX(high, r->high);
+	WR_PX(low, r->low);
+	WR_PX(upper_limit, r->upper_limit);
+	WR_PX(lower_limit, r->lower_limit);
+	wr_be64(p + F(volume), (uint64_t)r->volume);
+	WR_PX(turnover, r->turnover);
+	wr_be64(p + F(open_interest), (uint64_t)r->open_interest);
+
+	for (k = 0; k < r->level && k < TICK_DEPTH; k++) {
+		WR_PX(bid[k], r->bid[k]);
+		WR_PX(ask[k], r->ask[k]);
+		wr_be32(p + F(bid_vol[k]), (uint32_t)r->bid_vol[k]);
+		wr_be32(p + F(ask_vol[k]), (uint32_t)r->ask_vol[k]);
+	}
+}
+
+static size_t
+dce_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	size_t cnt, plen, i;
+	uint32_t day;
+
+	*done = 0;
+	if ((cnt = encode_fit(in, n, len, sizeof(struct dce_hdr), sizeof(struct dce_snap), DECODE_MSGS_MAX,
+			      &day)) == 0) {
+		return 0;
+	}
+	plen = sizeof(struct dce_hdr) + cnt * sizeof(struct dce_snap);
+
+	memset(buf, 0, sizeof(struct dce_hdr));
+	wr_be16(buf + offsetof(struct dce_hdr, len), (uint16_t)plen);
+	wr_be16(buf + offsetof(struct dce_hdr, count), (uint16_t)cnt);
+	wr_be32(buf + offsetof(struct dce_hdr, seq), seq);
+	wr_be32(buf + offsetof(struct dce_hdr, action_day), day);
+
+	for (i = 0; i < cnt; i++) {
+		encode_snap(&in[i], buf + sizeof(struct dce_hdr) + i * sizeof(struct dce_snap));
+	}
+	*done = cnt;
+
+	return plen;
+}
+
+const struct tick_decoder dce_decoder = { "DCE", dce_decode, dce_seq, dce_encode };
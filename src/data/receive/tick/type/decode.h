@@ -0,0 +1,92 @@
+/*
+ * decode.h
+ *
+ * The file contains the interface of the per market data type decoders and
+ * the functions' prototype for decoding a buffer of messages into flat tick
+ * records.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __DECODE_H__
+#define __DECODE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "tick.h"
+
+#define DECODE_MSGS_MAX	64	/* most messages one packet may carry */
+
+/*
+ * tick_decoder - decoder of one market data type. decode() converts the
+ * whole packets at the start of the buffer into at most n records, stores
+ * the bytes it consumed in *used, and returns the number of records. It
+ * never allocates and stops before a packet that is incomplete or would
+ * not fit in the remaining records; n must be at least DECODE_MSGS_MAX.
+ * Malformed data is consumed without records, so callers always progress.
+ */
+struct tick_decoder
+{
+	const char *name;	/* exchange name */
+	size_t (*decode)(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used);
+
+	/*
+	 * seq - the channel and sequence number of the packet at the start of
+	 * the buffer from its header alone, for the gap detection of the
+	 * receiver. Returns 0, -1 if the buffer has none; NULL for the feeds
+	 * without sequence numbers.
+	 */
+	int (*seq)(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq);
+
+	/*
+	 * encode - one packet of the records in the layout of the feed, for the
+	 * synthetic feeds and the benchmarks: the first records of in that fit
+	 * in len bytes, at most DECODE_MSGS_MAX and of one day, with the symbols
+	 * of tick_symbol(). Returns the bytes of the packet and the records in
+	 * *done, 0 if not one fits; NULL for the types without an encoder.
+	 */
+	size_t (*encode)(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done);
+};
+
+extern const struct tick_decoder ctp_decoder;
+extern const struct tick_decoder shfe_decoder;
+extern const struct tick_decoder cffex_decoder;
+extern const struct tick_decoder czce_decoder;
+extern const struct tick_decoder dce_decoder;
+extern const struct tick_decoder ine_decoder;
+extern const struct tick_decoder jupiter_decoder;
+
+/*
+ * tick_decoders - the decoders indexed by enum md_type, NULL for the types
+ * without a decoder.
+ */
+extern const struct tick_decoder *const tick_decoders[MD_T_MAX];
+
+/*
+ * tick_decode - decode the buffer with the decoder of md_type, stamp the
+ * records with md_type and the receive time. Returns the number of records,
+ * or 0 with *used = 0 when md_type has no decoder.
+ */
+size_t tick_decode(int md_type, const uint8_t *buf, size_t len, tick_rec_t *out, size_t n,
+		   size_t *used, uint64_t recv_ts);
+
+/*
+ * tick_seq - the channel and sequence number of the packet with the decoder of
+ * md_type. Returns 0, -1 without one.
+ */
+int tick_seq(int md_type, const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq);
+
+/*
+ * tick_encode - encode a packet of the records with the encoder of md_type.
+ * Returns the bytes of the packet, 0 with *done = 0 when md_type has none.
+ */
+size_t tick_encode(int md_type, const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len,
+		   size_t *done);
+
+/* shfe_decode - the SHFE feed layout, shared by SHFE and INE */
+size_t shfe_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used);
+int shfe_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq);
+size_t shfe_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done);
+
+#endif		/* __DECODE_H__ */
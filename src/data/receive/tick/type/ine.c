@@ -0,0 +1,12 @@
+/*
+ * ine.c
+ *
+ * The decoder of the INE market data feed. INE publishes in the layout of the
+ * SHFE feed, so the SHFE decoder is reused under the name of INE.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include "decode.h"
+
+const struct tick_decoder ine_decoder = { "INE", shfe_decode, shfe_seq, shfe_encode };
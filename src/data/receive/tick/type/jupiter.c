@@ -0,0 +1,99 @@
+/*
+ * jupiter.c
+ *
+ * The decoder of our own format: tick_frame headers each followed by count
+ * tick_rec records, the format of the tick bus and the tick files. Nothing
+ * is converted; the records are copied out so the buffer may be unaligned.
+ * Use tick_view() instead to read an aligned frame in place.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+
+static size_t
+jupiter_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	size_t off = 0, done = 0, i;
+
+	while (off + sizeof(tick_frame_t) <= len) {
+		tick_frame_t fr;
+		size_t flen;
+
+		memcpy(&fr, buf + off, sizeof(fr));
+		if (fr.magic != TICK_MAGIC || fr.version != TICK_VERSION || fr.count > DECODE_MSGS_MAX) {
+			off = len;
+			break;
+		}
+
+		flen = sizeof(fr) + (size_t)fr.count * sizeof(tick_rec_t);
+		if (off + flen > len || done + fr.count > n) {
+			break;
+		}
+
+		memcpy(&out[done], buf + off + sizeof(fr), (size_t)fr.count * sizeof(tick_rec_t));
+		/* the bytes are the wire's, the depth of a record is not trusted */
+		for (i = done; i < done + fr.count; i++) {
+			if (out[i].level > TICK_DEPTH) {
+				out[i].level = TICK_DEPTH;
+			}
+		}
+		done += fr.count;
+		off += flen;
+	}
+
+	*used = off;
+
+	return done;
+}
+
+/* the sequence of the first frame, a datagram carries one */
+static int
+jupiter_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	tick_frame_t fr;
+
+	if (len < sizeof(fr)) {
+		return -1;
+	}
+	memcpy(&fr, buf, sizeof(fr));
+	if (fr.magic != TICK_MAGIC) {
+		return -1;
+	}
+	*channel = fr.channel;
+	*seq = fr.seq;
+
+	return 0;
+}
+
+static size_t
+jupiter_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	tick_frame_t fr;
+	size_t cnt;
+
+	*done = 0;
+	if (n == 0 || len < sizeof(fr) + sizeof(tick_rec_t)) {
+		return 0;
+	}
+	cnt = (len - sizeof(fr)) / sizeof(tick_rec_t);
+	cnt = cnt < n ? cnt : n;
+	cnt = cnt < DECODE_MSGS_MAX ? cnt : DECODE_MSGS_MAX;
+
+	memset(&fr, 0, sizeof(fr));
+	fr.magic = TICK_MAGIC;
+	fr.version = TICK_VERSION;
+	fr.count = (uint16_t)cnt;
+	fr.seq = seq;
+	fr.channel = in[0].channel;
+	memcpy(buf, &fr, sizeof(fr));
+	memcpy(buf + sizeof(fr), in, cnt * sizeof(tick_rec_t));
+	*done = cnt;
+
+	return sizeof(fr) + cnt * sizeof(tick_rec_t);
+}
+
+const struct tick_decoder jupiter_decoder = { "JUPITER", jupiter_decode, jupiter_seq, jupiter_encode };
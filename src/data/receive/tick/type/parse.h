@@ -0,0 +1,518 @@
+/*
+ * parse.h
+ *
+ * The file contains the field parsers shared by the decoders of all market
+ * data types: byte order, ASCII integers, dates and times, and fixed-width
+ * ASCII decimals. The decimal parser classifies and converts the 16 bytes of
+ * a field at once with SSSE3/SSE4.1, and falls back to a scalar loop when the
+ * target has no such instructions. The writers of the byte orders and
+ * cn_time() serve the encoders of the synthetic feeds.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __PARSE_H__
+#define __PARSE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#include "tick.h"
+
+#define PARSE_FIELD_MAX	16	/* widest ASCII field parse_decimal() handles */
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+static inline uint16_t
+rd_be16(const uint8_t *p)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return be16toh(v);
+}
+
+static inline uint32_t
+rd_be32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return be32toh(v);
+}
+
+static inline uint64_t
+rd_be64(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return be64toh(v);
+}
+
+static inline double
+rd_be_double(const uint8_t *p)
+{
+	uint64_t v = rd_be64(p);
+	double d;
+
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+static inline uint16_t
+rd_le16(const uint8_t *p)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return le16toh(v);
+}
+
+static inline uint32_t
+rd_le32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return le32toh(v);
+}
+
+static inline double
+rd_le_double(const uint8_t *p)
+{
+	uint64_t v;
+	double d;
+
+	memcpy(&v, p, sizeof(v));
+	v = le64toh(v);
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+static inline void
+wr_be16(uint8_t *p, uint16_t v)
+{
+	v = htobe16(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_be32(uint8_t *p, uint32_t v)
+{
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_be64(uint8_t *p, uint64_t v)
+{
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_be_double(uint8_t *p, double d)
+{
+	uint64_t v;
+
+	memcpy(&v, &d, sizeof(v));
+	wr_be64(p, v);
+}
+
+static inline void
+wr_le16(uint8_t *p, uint16_t v)
+{
+	v = htole16(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_le32(uint8_t *p, uint32_t v)
+{
+	v = htole32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_le64(uint8_t *p, uint64_t v)
+{
+	v = htole64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+wr_le_double(uint8_t *p, double d)
+{
+	uint64_t v;
+
+	memcpy(&v, &d, sizeof(v));
+	wr_le64(p, v);
+}
+
+/*
+ * parse_8digits - convert 8 ASCII digits to an integer in three multiplies
+ * of one 64-bit word (SWAR), e.g. a YYYYMMDD date.
+ */
+static inline uint32_t
+parse_8digits(const char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	v = le64toh(v);
+	v = ((v & 0x0f0f0f0f0f0f0f0fULL) * 2561) >> 8;
+	v = ((v & 0x00ff00ff00ff00ffULL) * 6553601) >> 16;
+	v = ((v & 0x0000ffff0000ffffULL) * 42949672960001ULL) >> 32;
+
+	return (uint32_t)v;
+}
+
+static inline int
+is_8digits(const char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	/* every byte in '0'..'9': high nibble 3 and low nibble + 6 below 16 */
+	return ((v & (v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) ==
+		0x3030303030303030ULL);
+}
+
+static inline uint32_t
+parse_2digits(const char *p)
+{
+	return (uint32_t)(p[0] - '0') * 10 + (uint32_t)(p[1] - '0');
+}
+
+/*
+ * parse_hhmmss - convert "HH:MM:SS" to seconds of the day, -1 if malformed.
+ */
+static inline int32_t
+parse_hhmmss(const char *p)
+{
+	uint32_t h = parse_2digits(p), m = parse_2digits(p + 3), s = parse_2digits(p + 6);
+
+	if (unlikely(p[2] != ':' || p[5] != ':' || h > 23 || m > 59 || s > 60)) {
+		return -1;
+	}
+
+	return (int32_t)(h * 3600 + m * 60 + s);
+}
+
+/*
+ * days_from_civil - days since 1970-01-01 of the proleptic Gregorian date.
+ */
+static inline int64_t
+days_from_civil(int64_t y, uint32_t m, uint32_t d)
+{
+	int64_t era;
+	uint32_t yoe, doy, doe;
+
+	y -= m <= 2;
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = (uint32_t)(y - era * 400);
+	doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+/*
+ * cn_timestamp - ns since epoch of a China Standard Time (UTC+8) calendar
+ * day in YYYYMMDD, seconds of the day and milliseconds.
+ */
+static inline uint64_t
+cn_timestamp(uint32_t yyyymmdd, uint32_t sec, uint32_t ms)
+{
+	int64_t days = days_from_civil(yyyymmdd / 10000, (yyyymmdd / 100) % 100, yyyymmdd % 100);
+	int64_t s = days * 86400 + (int64_t)sec - 8 * 3600;
+
+	return (uint64_t)s * 1000000000ULL + (uint64_t)ms * 1000000ULL;
+}
+
+/*
+ * civil_from_days - YYYYMMDD of the days since 1970-01-01, the inverse of
+ * days_from_civil().
+ */
+static inline uint32_t
+civil_from_days(int64_t z)
+{
+	int64_t era, y;
+	uint32_t doe, yoe, doy, mp, d, m;
+
+	z += 719468;
+	era = (z >= 0 ? z : z - 146096) / 146097;
+	doe = (uint32_t)(z - era * 146097);
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	y = (int64_t)yoe + era * 400;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y += m <= 2;
+
+	return (uint32_t)(y * 10000 + m * 100 + d);
+}
+
+/*
+ * cn_time - the China Standard Time calendar day, seconds of the day and
+ * milliseconds of ns since epoch, the inverse of cn_timestamp().
+ */
+static inline void
+cn_time(uint64_t ts, uint32_t *yyyymmdd, uint32_t *sec, uint32_t *ms)
+{
+	int64_t s = (int64_t)(ts / 1000000000ULL) + 8 * 3600;
+
+	*yyyymmdd = civil_from_days(s / 86400);
+	*sec = (uint32_t)(s % 86400);
+	*ms = (uint32_t)(ts / 1000000ULL % 1000);
+}
+
+/*
+ * encode_fit - the first records of in a packet of len bytes holds, with a
+ * header of hdr bytes and snapshots of snap bytes each: at most
+ * DECODE_MSGS_MAX, all of the calendar day of the first, stored in *day.
+ */
+static inline size_t
+encode_fit(const tick_rec_t *in, size_t n, size_t len, size_t hdr, size_t snap, size_t max, uint32_t *day)
+{
+	uint32_t d, sec, ms;
+	size_t i;
+
+	if (n == 0 || len < hdr + snap) {
+		return 0;
+	}
+	n = n < max ? n : max;
+	n = n < (len - hdr) / snap ? n : (len - hdr) / snap;
+
+	cn_time(in[0].timestamp, day, &sec, &ms);
+	for (i = 1; i < n; i++) {
+		cn_time(in[i].timestamp, &d, &sec, &ms);
+		if (d != *day) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/*
+ * wr_symbol - the symbol of the instrument id in a field of width bytes,
+ * padded with pad.
+ */
+static inline void
+wr_symbol(char *dst, size_t width, uint32_t id, char pad)
+{
+	const char *s = tick_symbol(id);
+	size_t n = s != NULL ? strlen(s) : 0;
+
+	n = n < width ? n : width;
+	memcpy(dst, s != NULL ? s : "", n);
+	memset(dst + n, pad, width - n);
+}
+
+static const int64_t pow10_tab[19] = {
+	1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+	100000000LL, 1000000000LL, 10000000000LL, 100000000000LL,
+	1000000000000LL, 10000000000000LL, 100000000000000LL,
+	1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+	1000000000000000000LL
+};
+
+/*
+ * wr_ascii - v in a field of width bytes, right-aligned and blank padded
+ * with places fraction digits, the fields parse_decimal() reads.
+ */
+static inline void
+wr_ascii(char *dst, int width, int64_t v, int places)
+{
+	char buf[32];
+	int64_t a = v < 0 ? -v : v;
+	int n;
+
+	if (places > 0) {
+		n = snprintf(buf, sizeof(buf), "%s%ld.%0*ld", v < 0 ? "-" : "", (long)(a / pow10_tab[places]),
+			     places, (long)(a % pow10_tab[places]));
+	} else {
+		n = snprintf(buf, sizeof(buf), "%ld", (long)v);
+	}
+	if (n > width) {
+		n = 0;
+	}
+	memset(dst, ' ', (size_t)(width - n));
+	memcpy(dst + width - n, buf, (size_t)n);
+}
+
+/* scale the integer of all digits with frac fraction digits to places */
+static inline int64_t
+scale_decimal(int64_t v, int frac, int places)
+{
+	if (frac <= places) {
+		return v * pow10_tab[places - frac];
+	}
+
+	return v / pow10_tab[frac - places];
+}
+
+static inline int
+parse_decimal_scalar(const char *p, int width, int places, int64_t *out)
+{
+	int64_t v = 0;
+	int i = 0, neg = 0, frac = -1, ndigits = 0;
+
+	while (i < width && p[i] == ' ') {
+		i++;
+	}
+
+	if (i < width && p[i] == '-') {
+		neg = 1;
+		i++;
+	}
+
+	for (; i < width; i++) {
+		char c = p[i];
+
+		if (c >= '0' && c <= '9') {
+			v = v * 10 + (c - '0');
+			ndigits++;
+			if (frac >= 0) {
+				frac++;
+			}
+		} else if (c == '.' && frac < 0) {
+			frac = 0;
+		} else if (c == ' ' || c == '\0') {
+			break;
+		} else {
+			return -1;
+		}
+	}
+
+	if (ndigits == 0) {
+		*out = 0;
+		return 0;
+	}
+
+	v = scale_decimal(v, frac < 0 ? 0 : frac, places);
+	*out = neg ? -v : v;
+
+	return 0;
+}
+
+#if defined(__SSE4_1__)
+/*
+ * dot_shuffle - pshufb masks removing the byte at position i by moving every
+ * byte before it one place to the right and feeding a zero byte in at 0.
+ */
+static const int8_t dot_shuffle[PARSE_FIELD_MAX][PARSE_FIELD_MAX] __attribute__((aligned(16))) = {
+#define S(i)	{ \
+	-1, (i) >= 1 ? 0 : 1, (i) >= 2 ? 1 : 2, (i) >= 3 ? 2 : 3, \
+	(i) >= 4 ? 3 : 4, (i) >= 5 ? 4 : 5, (i) >= 6 ? 5 : 6, (i) >= 7 ? 6 : 7, \
+	(i) >= 8 ? 7 : 8, (i) >= 9 ? 8 : 9, (i) >= 10 ? 9 : 10, (i) >= 11 ? 10 : 11, \
+	(i) >= 12 ? 11 : 12, (i) >= 13 ? 12 : 13, (i) >= 14 ? 13 : 14, (i) >= 15 ? 14 : 15 }
+	S(0), S(1), S(2), S(3), S(4), S(5), S(6), S(7),
+	S(8), S(9), S(10), S(11), S(12), S(13), S(14), S(15)
+#undef S
+};
+
+/*
+ * digits16 - the integer of 16 ASCII digits (non-digits already zeroed) in
+ * the vector, most significant first.
+ */
+static inline uint64_t
+digits16(__m128i v)
+{
+	v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+	v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+	v = _mm_packus_epi32(v, v);
+	v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+	return (uint64_t)(uint32_t)_mm_cvtsi128_si32(v) * 100000000ULL +
+	       (uint32_t)_mm_extract_epi32(v, 1);
+}
+#endif
+
+/*
+ * parse_decimal - parse a fixed-width, space-padded ASCII decimal such as
+ * "   -3456.50" into fixed point with the given decimal places. An all blank
+ * field is 0. Returns 0 on success, -1 if the field is malformed.
+ */
+static inline int
+parse_decimal(const char *p, int width, int places, int64_t *out)
+{
+#if defined(__SSE4_1__)
+	char buf[PARSE_FIELD_MAX] __attribute__((aligned(16)));
+	__m128i v, digit, zero = _mm_set1_epi8('0');
+	uint32_t m_digit, m_dot, m_minus, m_space, m_valid, m_field;
+	int frac = 0, shift;
+	int64_t n;
+
+	if (unlikely(width > PARSE_FIELD_MAX)) {
+		return parse_decimal_scalar(p, width, places, out);
+	}
+
+	/* right-align the field in 16 bytes, blanks in front */
+	shift = PARSE_FIELD_MAX - width;
+	memset(buf, ' ', sizeof(buf));
+	memcpy(buf + shift, p, (size_t)width);
+	v = _mm_load_si128((const __m128i *)buf);
+
+	digit = _mm_sub_epi8(v, zero);
+	m_digit = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(
+			_mm_xor_si128(digit, _mm_set1_epi8((char)0x80)),
+			_mm_set1_epi8((char)(0x80 + 10))));
+	m_dot = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+	m_minus = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+	m_space = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+
+	/* trailing blanks of a left-aligned field: fall back, it is rare */
+	m_field = m_digit | m_dot | m_minus;
+	m_valid = m_field | m_space;
+	if (unlikely(m_valid != 0xffff || (m_dot & (m_dot - 1)) != 0 ||
+		     (m_space != 0 && 32 - __builtin_clz(m_space) > __builtin_ctz(m_field | 0x10000)))) {
+		return parse_decimal_scalar(p, width, places, out);
+	}
+
+	if (m_minus != 0 && (m_minus != (m_field & -m_field))) {
+		return -1;
+	}
+
+	if (m_digit == 0) {
+		*out = 0;
+		return 0;
+	}
+
+	digit = _mm_and_si128(digit, _mm_cmplt_epi8(
+			_mm_xor_si128(digit, _mm_set1_epi8((char)0x80)),
+			_mm_set1_epi8((char)(0x80 + 10))));
+
+	if (m_dot != 0) {
+		int dot = __builtin_ctz(m_dot);
+
+		frac = PARSE_FIELD_MAX - 1 - dot;
+		digit = _mm_shuffle_epi8(digit, _mm_load_si128((const __m128i *)dot_shuffle[dot]));
+	}
+
+	n = scale_decimal((int64_t)digits16(digit), frac, places);
+	*out = m_minus ? -n : n;
+
+	return 0;
+#else
+	return parse_decimal_scalar(p, width, places, out);
+#endif
+}
+
+/*
+ * parse_uint - parse a fixed-width, space-padded ASCII unsigned integer.
+ */
+static inline int
+parse_uint(const char *p, int width, int64_t *out)
+{
+	return parse_decimal(p, width, 0, out);
+}
+
+#endif		/* __PARSE_H__ */
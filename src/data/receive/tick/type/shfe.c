@@ -0,0 +1,211 @@
+/*
+ * shfe.c
+ *
+ * The decoder of the SHFE market data feed, which INE publishes in the same
+ * layout. A packet is a header followed by count fixed-size snapshots, all
+ * integers and doubles in network byte order.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "decode.h"
+#include "parse.h"
+
+struct shfe_hdr
+{
+	uint16_t len;		/* bytes of the packet including the header */
+	uint16_t count;		/* snapshots in the packet */
+	uint32_t seq;		/* sequence number of the packet in the channel */
+	uint16_t channel;	/* channel (topic) of the packet */
+	char action_day[8];	/* calendar day YYYYMMDD */
+	uint16_t reserved;
+} __attribute__((packed));
+
+struct shfe_snap
+{
+	char instrument[16];	/* instrument id, NUL padded */
+	char update_time[8];	/* HH:MM:SS */
+	uint16_t millisec;
+	uint16_t depth;		/* valid depth levels */
+	uint32_t reserved;
+	double last;
+	double pre_settle;
+	double pre_close;
+	double pre_oi;
+	double open;
+	double high;
+	double low;
+	double upper_limit;
+	double lower_limit;
+	uint64_t volume;
+	double turnover;
+	double open_interest;
+	double bid[TICK_DEPTH];
+	uint32_t bid_vol[TICK_DEPTH];
+	double ask[TICK_DEPTH];
+	uint32_t ask_vol[TICK_DEPTH];
+} __attribute__((packed));
+
+#define F(field)	(offsetof(struct shfe_snap, field))
+
+static void
+decode_snap(const uint8_t *p, uint32_t day, const struct shfe_hdr *hdr, tick_rec_t *r)
+{
+	int32_t sec = parse_hhmmss((const char *)p + F(update_time));
+	int k;
+
+	memset(r, 0, sizeof(*r));
+	r->timestamp = sec < 0 ? 0 : cn_timestamp(day, (uint32_t)sec, rd_be16(p + F(millisec)));
+	r->instrument = tick_intern((const char *)p + F(instrument), 16);
+	r->seq = hdr->seq;
+	r->channel = hdr->channel;
+	r->level = (uint8_t)rd_be16(p + F(depth));
+	if (r->level > TICK_DEPTH) {
+		r->level = TICK_DEPTH;
+	}
+
+	r->last = tick_px(rd_be_double(p + F(last)));
+	r->pre_settle = tick_px(rd_be_double(p + F(pre_settle)));
+	r->pre_close = tick_px(rd_be_double(p + F(pre_close)));
+	r->pre_oi = (int64_t)(rd_be_double(p + F(pre_oi)) + 0.5);
+	r->open = tick_px(rd_be_double(p + F(open)));
+	r->high = tick_px(rd_be_double(p + F(high)));
+	r->low = tick_px(rd_be_double(p + F(low)));
+	r->upper_limit = tick_px(rd_be_double(p + F(upper_limit)));
+	r->lower_limit = tick_px(rd_be_double(p + F(lower_limit)));
+	r->volume = (int64_t)rd_be64(p + F(volume));
+	r->turnover = tick_px(rd_be_double(p + F(turnover)));
+	r->open_interest = (int64_t)(rd_be_double(p + F(open_interest)) + 0.5);
+
+	for (k = 0; k < r->level; k++) {
+		r->bid[k] = tick_px(rd_be_double(p + F(bid) + k * 8));
+		r->ask[k] = tick_px(rd_be_double(p + F(ask) + k * 8));
+		r->bid_vol[k] = (int32_t)rd_be32(p + F(bid_vol) + k * 4);
+		r->ask_vol[k] = (int32_t)rd_be32(p + F(ask_vol) + k * 4);
+	}
+}
+
+size_t
+shfe_decode(const uint8_t *buf, size_t len, tick_rec_t *out, size_t n, size_t *used)
+{
+	size_t off = 0, done = 0;
+
+	while (off + sizeof(struct shfe_hdr) <= len) {
+		const uint8_t *p = buf + off;
+		struct shfe_hdr hdr;
+		uint32_t day, i;
+
+		hdr.len = rd_be16(p + offsetof(struct shfe_hdr, len));
+		hdr.count = rd_be16(p + offsetof(struct shfe_hdr, count));
+		hdr.seq = rd_be32(p + offsetof(struct shfe_hdr, seq));
+		hdr.channel = rd_be16(p + offsetof(struct shfe_hdr, channel));
+
+		if (hdr.count > DECODE_MSGS_MAX ||
+		    hdr.len != sizeof(struct shfe_hdr) + hdr.count * sizeof(struct shfe_snap) ||
+		    !is_8digits((const char *)p + offsetof(struct shfe_hdr, action_day))) {
+			/* malformed, drop the rest of the buffer */
+			off = len;
+			break;
+		}
+
+		if (off + hdr.len > len || done + hdr.count > n) {
+			break;
+		}
+
+		day = parse_8digits((const char *)p + offsetof(struct shfe_hdr, action_day));
+		p += sizeof(struct shfe_hdr);
+		for (i = 0; i < hdr.count; i++, p += sizeof(struct shfe_snap)) {
+			decode_snap(p, day, &hdr, &out[done++]);
+		}
+
+		off += hdr.len;
+	}
+
+	*used = off;
+
+	return done;
+}
+
+int
+shfe_seq(const uint8_t *buf, size_t len, uint16_t *channel, uint32_t *seq)
+{
+	if (len < sizeof(struct shfe_hdr)) {
+		return -1;
+	}
+	*channel = rd_be16(buf + offsetof(struct shfe_hdr, channel));
+	*seq = rd_be32(buf + offsetof(struct shfe_hdr, seq));
+
+	return 0;
+}
+
+static void
+encode_snap(const tick_rec_t *r, uint8_t *p)
+{
+	uint32_t day, sec, ms;
+	char hms[9];
+	int k;
+
+	memset(p, 0, sizeof(struct shfe_snap));
+	wr_symbol((char *)p + F(instrument), 16, r->instrument, '\0');
+	cn_time(r->timestamp, &day, &sec, &ms);
+	snprintf(hms, sizeof(hms), "%02u:%02u:%02u", sec / 3600, sec / 60 % 60, sec % 60);
+	memcpy(p + F(update_time), hms, 8);
+	wr_be16(p + F(millisec), (uint16_t)ms);
+	wr_be16(p + F(depth), r->level);
+
+	wr_be_double(p + F(last), tick_px_double(r->last));
+	wr_be_double(p + F(pre_settle), tick_px_double(r->pre_settle));
+	wr_be_double(p + F(pre_close), tick_px_double(r->pre_close));
+	wr_be_double(p + F(pre_oi), (double)r->pre_oi);
+	wr_be_double(p + F(open), tick_px_double(r->open));
+	wr_be_double(p + F(high), tick_px_double(r->high));
+	wr_be_double(p + F(low), tick_px_double(r->low));
+	wr_be_double(p + F(upper_limit), tick_px_double(r->upper_limit));
+	wr_be_double(p + F(lower_limit), tick_px_double(r->lower_limit));
+	wr_be64(p + F(volume), (uint64_t)r->volume);
+	wr_be_double(p + F(turnover), tick_px_double(r->turnover));
+	wr_be_double(p + F(open_interest), (double)r->open_interest);
+
+	for (k = 0; k < r->level && k < TICK_DEPTH; k++) {
+		wr_be_double(p + F(bid) + k * 8, tick_px_double(r->bid[k]));
+		wr_be_double(p + F(ask) + k * 8, tick_px_double(r->ask[k]));
+		wr_be32(p + F(bid_vol) + k * 4, (uint32_t)r->bid_vol[k]);
+		wr_be32(p + F(ask_vol) + k * 4, (uint32_t)r->ask_vol[k]);
+	}
+}
+
+size_t
+shfe_encode(const tick_rec_t *in, size_t n, uint32_t seq, uint8_t *buf, size_t len, size_t *done)
+{
+	size_t cnt, plen, i;
+	uint32_t day;
+	char ymd[9];
+
+	*done = 0;
+	if ((cnt = encode_fit(in, n, len, sizeof(struct shfe_hdr), sizeof(struct shfe_snap), DECODE_MSGS_MAX,
+			      &day)) == 0) {
+		return 0;
+	}
+	plen = sizeof(struct shfe_hdr) + cnt * sizeof(struct shfe_snap);
+
+	memset(buf, 0, sizeof(struct shfe_hdr));
+	wr_be16(buf + offsetof(struct shfe_hdr, len), (uint16_t)plen);
+	wr_be16(buf + offsetof(struct shfe_hdr, count), (uint16_t)cnt);
+	wr_be32(buf + offsetof(struct shfe_hdr, seq), seq);
+	wr_be16(buf + offsetof(struct shfe_hdr, channel), in[0].channel);
+	snprintf(ymd, sizeof(ymd), "%08u", day);
+	memcpy(buf + offsetof(struct shfe_hdr, action_day), ymd, 8);
+
+	for (i = 0; i < cnt; i++) {
+		encode_snap(&in[i], buf + sizeof(struct shfe_hdr) + i * sizeof(struct shfe_snap));
+	}
+	*done = cnt;
+
+	return plen;
+}
+
+const struct tick_decoder shfe_decoder = { "SHFE", shfe_decode, shfe_seq, shfe_encode };
@@ -0,0 +1,205 @@
+/*
+ * play_tick.c
+ *
+ * The program replays tick files of the recorder in timestamp order onto a
+ * tick bus for the consumers, or prints them as CSV, as fast as it can or at
+ * a multiple of the recorded time.
+ *
+ *	play_tick -b replay -x 10 -s cu2505,cu2506 /data/tick/shfe/20250303.jtz
+ *	play_tick -p -f "2025-03-03 09:00:00" -t "2025-03-03 10:15:00" 20250303.jtz
+ *
+ * Without -b or -p it only decodes through tick_frame buffers and
+ * read_tick(MD_T_JUPITER, ...) and reports the ticks per second.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "record.h"
+#include "bus.h"
+#include "parse.h"
+
+#define BATCH		256
+#define BUS_CAPACITY	(1 << 20)
+#define FRAMES_LEN	(1 << 20)
+#define SYMBOLS_MAX	1024
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ns since epoch of a number or of YYYY-MM-DD HH:MM:SS[.mmm] in China time */
+static uint64_t
+parse_ts(const char *s)
+{
+	unsigned int y, mo, d, h, mi, sec, ms = 0;
+	char frac[4] = "000";
+
+	if (sscanf(s, "%4u-%2u-%2u %2u:%2u:%2u.%3[0-9]", &y, &mo, &d, &h, &mi, &sec, frac) >= 6) {
+		ms = (unsigned int)(frac[0] - '0') * 100 + (unsigned int)((frac[1] ? frac[1] : '0') - '0') * 10 +
+		     (unsigned int)((frac[1] && frac[2] ? frac[2] : '0') - '0');
+		return cn_timestamp(y * 10000 + mo * 100 + d, h * 3600 + mi * 60 + sec, ms);
+	}
+
+	return strtoull(s, NULL, 10);
+}
+
+static size_t
+parse_symbols(char *s, const char **symbols)
+{
+	char *save = NULL, *tok;
+	size_t n = 0;
+
+	for (tok = strtok_r(s, ",", &save); tok != NULL && n < SYMBOLS_MAX; tok = strtok_r(NULL, ",", &save)) {
+		symbols[n++] = tok;
+	}
+
+	return n;
+}
+
+static void
+print_tick(const tick_rec_t *t)
+{
+	printf("%s,%lu,%lu,%u,%.4f,%ld,%.4f,%ld,%.4f,%d,%.4f,%d\n", tick_symbol(t->instrument),
+	       (unsigned long)t->timestamp, (unsigned long)t->recv_ts, t->seq, tick_px_double(t->last),
+	       (long)t->volume, tick_px_double(t->turnover), (long)t->open_interest,
+	       tick_px_double(t->bid[0]), t->bid_vol[0], tick_px_double(t->ask[0]), t->ask_vol[0]);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-b bus | -p] [-x speed] [-f from] [-t to] [-s symbols] files...\n"
+		"  -b bus       name of the tick bus in /dev/shm to create and replay onto\n"
+		"  -p           print the ticks as CSV\n"
+		"  -x speed     multiple of the recorded time, default as fast as possible\n"
+		"  -f from      first time, ns since epoch or YYYY-MM-DD HH:MM:SS[.mmm]\n"
+		"  -t to        last time\n"
+		"  -s symbols   instruments replayed, e.g. cu2505,cu2506\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const char *symbols[SYMBOLS_MAX];
+	static tick_rec_t batch[BATCH];
+	struct rec_replay_conf conf;
+	struct rec_replay_stats st;
+	rec_replay_t *rp;
+	tick_bus_t bus;
+	tick_data_t *td;
+	const char *bus_name = NULL;
+	uint8_t *frames = NULL;
+	uint64_t start, ns, dropped = 0;
+	size_t n, i;
+	int print = 0, opt, rc = 0;
+
+	memset(&conf, 0, sizeof(conf));
+
+	while ((opt = getopt(argc, argv, "b:px:f:t:s:")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'p':
+			print = 1;
+			break;
+		case 'x':
+			conf.speed = strtod(optarg, NULL);
+			break;
+		case 'f':
+			conf.from = parse_ts(optarg);
+			break;
+		case 't':
+			conf.to = parse_ts(optarg);
+			break;
+		case 's':
+			conf.symbols = symbols;
+			conf.nsymbols = parse_symbols(optarg, symbols);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc || (bus_name != NULL && print)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* the symbols the replay interns go to the bus */
+	if (bus_name != NULL && bus_create(&bus, bus_name, BUS_CAPACITY, MD_T_JUPITER) != 0) {
+		fprintf(stderr, "cannot create tick bus %s\n", bus_name);
+		return 1;
+	}
+
+	if ((rp = rec_replay_open((const char *const *)argv + optind, (size_t)(argc - optind), &conf)) == NULL) {
+		if (bus_name != NULL) {
+			bus_close(&bus);
+		}
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	start = mono_ns();
+	if (bus_name != NULL || print) {
+		while (running && (n = rec_replay_next(rp, batch, BATCH)) > 0) {
+			for (i = 0; i < n; i++) {
+				if (print) {
+					print_tick(&batch[i]);
+				} else if (bus_push(&bus, &batch[i]) != 0) {
+					dropped++;
+				}
+			}
+			if (bus_name != NULL) {
+				bus_heartbeat(&bus);
+			}
+		}
+	} else if ((frames = aligned_alloc(TICK_CACHELINE, FRAMES_LEN)) != NULL) {
+		while (running && (n = rec_replay_frames(rp, frames, FRAMES_LEN)) > 0) {
+			for (td = read_tick(MD_T_JUPITER, frames, n); td != NULL; td = read_next(td))
+				;
+		}
+		free(frames);
+	} else {
+		rc = 1;
+	}
+	ns = mono_ns() - start;
+
+	rec_replay_stats(rp, &st);
+	fprintf(stderr, "ticks %lu blocks %lu bytes %lu streams %lu bad %lu dropped %lu in %.3fs, %.0f ticks/s\n",
+		st.ticks, st.blocks, st.bytes, st.streams, st.bad, dropped, (double)ns / 1e9,
+		ns ? (double)st.ticks * 1e9 / (double)ns : 0.0);
+
+	rec_replay_close(rp);
+	if (bus_name != NULL) {
+		bus_close(&bus);
+	}
+
+	return rc;
+}
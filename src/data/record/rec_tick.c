@@ -0,0 +1,191 @@
+/*
+ * rec_tick.c
+ *
+ * The program records the ticks of a tick bus into the daily tick files of
+ * the exchange until it is stopped.
+ *
+ *	rec_tick -b shfe -o /data/tick -e shfe -C calendar.txt
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "record.h"
+#include "arena.h"
+#include "bus.h"
+
+#define POLL_MAX	4096
+#define FLUSH_MS	1000
+#define STATS_NS	(60 * 1000000000ULL)
+
+static volatile sig_atomic_t running = 1;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static const char *
+symbol_of(uint32_t id, void *arg)
+{
+	return bus_symbol((const tick_bus_t *)arg, id);
+}
+
+static void
+print_stats(const rec_writer_t *w, const ring_reader_t *rd)
+{
+	struct rec_stats st;
+
+	rec_stats(w, &st);
+	fprintf(stderr, "ticks %lu blocks %lu bytes %lu ratio %.1f files %lu errors %lu drops %lu grows %lu\n",
+		st.ticks, st.blocks, st.bytes,
+		st.bytes ? (double)(st.ticks * sizeof(tick_rec_t)) / (double)st.bytes : 0.0,
+		st.files, st.errors, rd->drops, st.grows);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -b bus -o dir -e exchange [-C calendar] [-n ticks] [-F ms] [-N count] [-w wait] [-r]\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -o dir       directory of the tick files, <dir>/<exchange>/<YYYYMMDD>.jtz\n"
+		"  -e exchange  name of the exchange in the files\n"
+		"  -C calendar  file of the trading days, one YYYYMMDD per line\n"
+		"  -n ticks     ticks of a block, default %d\n"
+		"  -F ms        age a block is written at anyway, default %d\n"
+		"  -N count     instruments to make room for at startup, the symbols of the bus by default\n"
+		"  -w wait      for the ticks: spin, yield, futex or sleep (default sleep)\n"
+		"  -r           record the ticks retained by the bus first\n",
+		prog, REC_BLOCK_TICKS, FLUSH_MS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct rec_conf conf;
+	ring_reader_t rd;
+	rec_writer_t *w;
+	tick_bus_t bus;
+	const char *bus_name = NULL;
+	uint64_t now, last_flush = 0, last_stats;
+	int replay = 0, wait = BUS_WAIT_SLEEP, opt;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.flush_ns = FLUSH_MS * 1000000ULL;
+
+	while ((opt = getopt(argc, argv, "b:o:e:C:n:F:N:w:r")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'o':
+			conf.dir = optarg;
+			break;
+		case 'e':
+			conf.exchange = optarg;
+			break;
+		case 'C':
+			conf.calendar = optarg;
+			break;
+		case 'n':
+			conf.block_ticks = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			conf.flush_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 'N':
+			conf.instruments = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			replay = 1;
+			break;
+		case 'w':
+			if ((wait = bus_wait_parse(optarg)) < BUS_WAIT_SLEEP) {
+				fprintf(stderr, "unknown wait %s\n", optarg);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (bus_name == NULL || conf.dir == NULL || conf.exchange == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (bus_open(&bus, bus_name, wait == RING_WAIT_FUTEX ? BUS_O_RDWR : 0) != 0) {
+		fprintf(stderr, "cannot open tick bus %s\n", bus_name);
+		return 1;
+	}
+
+	/* the symbols the receiver has seen so far, a day of them when it restarts */
+	if (conf.instruments == 0) {
+		conf.instruments = atomic_load(&bus.hdr->nsymbols);
+		conf.instruments = conf.instruments > ARENA_INSTRUMENTS ? conf.instruments : ARENA_INSTRUMENTS;
+	}
+
+	conf.symbol = symbol_of;
+	conf.arg = &bus;
+	if ((w = rec_open(&conf)) == NULL) {
+		bus_close(&bus);
+		return 1;
+	}
+	if (bus_reader(&bus, &rd, replay ? BUS_R_REPLAY : 0) != 0) {
+		rec_close(w);
+		bus_close(&bus);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	last_stats = mono_ns();
+	while (running) {
+		if (rec_poll(w, &rd, POLL_MAX) == 0) {
+			bus_idle(&rd, wait);
+		}
+
+		now = mono_ns();
+		if (now - last_flush >= conf.flush_ns / 4 + 1000000ULL) {
+			rec_flush(w, now);
+			last_flush = now;
+		}
+		if (now - last_stats >= STATS_NS) {
+			print_stats(w, &rd);
+			last_stats = now;
+		}
+	}
+
+	/* the ticks still in the bus go to the files before they close */
+	while (rec_poll(w, &rd, POLL_MAX) > 0)
+		;
+	rec_flush(w, UINT64_MAX);
+	print_stats(w, &rd);
+
+	ring_reader_fini(&rd);
+	rec_close(w);
+	bus_close(&bus);
+
+	return 0;
+}
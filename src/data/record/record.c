@@ -0,0 +1,569 @@
+/*
+ * record.c
+ *
+ * The functions are used to encode the ticks as deltas and to record the
+ * ticks of a ring into the daily files of blocks and their seek index.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "record.h"
+#include "arena.h"
+#include "bar.h"
+
+#define POLL_BATCH	256
+#define NIGHT_SEC	(18 * 3600)	/* the ticks from here go to the next trading day */
+
+_Static_assert(REC_NFIELDS <= 64, "the changed fields are a 64-bit mask");
+
+/*
+ * fields - the tick as int64 fields, in the order of the bits of the mask.
+ * The receive time is kept as its latency to the exchange time, which moves
+ * less than the time itself.
+ */
+static inline void
+fields(const tick_rec_t *t, int64_t *f)
+{
+	int k;
+
+	f[0] = (int64_t)t->timestamp;
+	f[1] = (int64_t)(t->recv_ts - t->timestamp);
+	f[2] = t->seq;
+	f[3] = t->channel;
+	f[4] = (int64_t)t->md_type | (int64_t)t->level << 8 | (int64_t)t->flags << 16;
+	f[5] = t->last;
+	f[6] = t->volume;
+	f[7] = t->turnover;
+	f[8] = t->open_interest;
+	f[9] = t->open;
+	f[10] = t->high;
+	f[11] = t->low;
+	f[12] = t->pre_close;
+	f[13] = t->pre_settle;
+	f[14] = t->pre_oi;
+	f[15] = t->upper_limit;
+	f[16] = t->lower_limit;
+	for (k = 0; k < TICK_DEPTH; k++) {
+		f[17 + k] = t->bid[k];
+		f[17 + TICK_DEPTH + k] = t->ask[k];
+		f[17 + 2 * TICK_DEPTH + k] = t->bid_vol[k];
+		f[17 + 3 * TICK_DEPTH + k] = t->ask_vol[k];
+	}
+}
+
+static inline void
+unfields(const int64_t *f, tick_rec_t *t)
+{
+	int k;
+
+	t->timestamp = (uint64_t)f[0];
+	t->recv_ts = (uint64_t)f[1] + t->timestamp;
+	t->seq = (uint32_t)f[2];
+	t->channel = (uint16_t)f[3];
+	t->md_type = (uint8_t)f[4];
+	t->level = (uint8_t)(f[4] >> 8);
+	t->flags = (uint32_t)(f[4] >> 16);
+	t->last = f[5];
+	t->volume = f[6];
+	t->turnover = f[7];
+	t->open_interest = f[8];
+	t->open = f[9];
+	t->high = f[10];
+	t->low = f[11];
+	t->pre_close = f[12];
+	t->pre_settle = f[13];
+	t->pre_oi = f[14];
+	t->upper_limit = f[15];
+	t->lower_limit = f[16];
+	for (k = 0; k < TICK_DEPTH; k++) {
+		t->bid[k] = f[17 + k];
+		t->ask[k] = f[17 + TICK_DEPTH + k];
+		t->bid_vol[k] = (int32_t)f[17 + 2 * TICK_DEPTH + k];
+		t->ask_vol[k] = (int32_t)f[17 + 3 * TICK_DEPTH + k];
+	}
+}
+
+static inline size_t
+put_varint(uint8_t *p, uint64_t v)
+{
+	size_t n = 0;
+
+	while (v >= 0x80) {
+		p[n++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	p[n++] = (uint8_t)v;
+
+	return n;
+}
+
+static inline size_t
+get_varint(const uint8_t *p, const uint8_t *end, uint64_t *v)
+{
+	uint64_t x = 0;
+	size_t n = 0;
+	int shift;
+
+	for (shift = 0; shift < 64 && p + n < end; shift += 7) {
+		x |= (uint64_t)(p[n] & 0x7f) << shift;
+		if (!(p[n++] & 0x80)) {
+			*v = x;
+			return n;
+		}
+	}
+
+	return 0;
+}
+
+size_t
+rec_encode(uint8_t *p, int64_t *prev, const tick_rec_t *t)
+{
+	int64_t f[REC_NFIELDS];
+	uint64_t mask = 0, d;
+	size_t n;
+	int i;
+
+	fields(t, f);
+	for (i = 0; i < REC_NFIELDS; i++) {
+		if (f[i] != prev[i]) {
+			mask |= 1ULL << i;
+		}
+	}
+
+	n = put_varint(p, mask);
+	for (i = 0; i < REC_NFIELDS; i++) {
+		if (mask & (1ULL << i)) {
+			/* zigzag of the difference, wrapping instead of overflowing */
+			d = (uint64_t)f[i] - (uint64_t)prev[i];
+			n += put_varint(p + n, (d << 1) ^ (uint64_t)((int64_t)d >> 63));
+			prev[i] = f[i];
+		}
+	}
+
+	return n;
+}
+
+size_t
+rec_decode(const uint8_t *p, const uint8_t *end, int64_t *prev, tick_rec_t *t)
+{
+	uint64_t mask, z;
+	size_t n, k;
+	int i;
+
+	if ((n = get_varint(p, end, &mask)) == 0) {
+		return 0;
+	}
+	for (i = 0; i < REC_NFIELDS; i++) {
+		if (mask & (1ULL << i)) {
+			if ((k = get_varint(p + n, end, &z)) == 0) {
+				return 0;
+			}
+			n += k;
+			prev[i] = (int64_t)((uint64_t)prev[i] + ((z >> 1) ^ (0 - (z & 1))));
+		}
+	}
+	unfields(prev, t);
+
+	return n;
+}
+
+int
+rec_path(char *dst, size_t len, const char *dir, const char *exchange, uint32_t day, const char *suffix)
+{
+	int n = snprintf(dst, len, "%s/%s/%08u%s", dir, exchange, day, suffix);
+
+	return n > 0 && (size_t)n < len ? 0 : -1;
+}
+
+/*
+ * rec_inst - the open block of an instrument.
+ */
+struct rec_inst
+{
+	uint8_t *buf;
+	size_t len;
+	size_t cap;
+	uint32_t count;
+	int listed;			/* on the open list, whatever its count */
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint64_t opened;		/* monotonic ns of the first tick */
+	int64_t prev[REC_NFIELDS];
+};
+
+struct rec_writer
+{
+	struct rec_conf conf;
+	struct bar_calendar cal;
+	uint32_t day;			/* of the open files, 0 for none */
+	int fd;
+	int ifd;
+	uint64_t offset;		/* end of the file */
+	struct rec_stats stats;
+	arena_t arena;			/* the instruments and their blocks, reset every day */
+	pool_t inst_pool;
+	uint32_t ninsts;		/* expected */
+
+	struct rec_inst *insts[TICK_INSTRUMENT_MAX];
+	uint32_t open[TICK_INSTRUMENT_MAX];	/* the ids with an open block */
+	uint32_t nopen;
+};
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * trading_day - the trading day of the tick: the next one after 18:00, else
+ * the first one from its calendar day, so the night after a Friday and the
+ * early morning of a Saturday go to the Monday.
+ */
+static uint32_t
+trading_day(const rec_writer_t *w, uint64_t ts)
+{
+	uint64_t sec = (ts / 1000000000ULL + 8 * 3600) % 86400;
+
+	if (sec >= NIGHT_SEC) {
+		return bar_calendar_next(&w->cal, bar_calendar_day(ts));
+	}
+
+	return bar_calendar_next(&w->cal, bar_calendar_day(ts - 86400ULL * 1000000000ULL));
+}
+
+/* the instruments expected with a block each, taken from the arena */
+static int
+make_insts(rec_writer_t *w)
+{
+	return pool_init(&w->inst_pool, &w->arena, sizeof(struct rec_inst) + (size_t)w->conf.block_ticks * 64,
+			 w->ninsts);
+}
+
+rec_writer_t *
+rec_open(const struct rec_conf *conf)
+{
+	rec_writer_t *w;
+	size_t n;
+
+	if (conf->dir == NULL || conf->exchange == NULL || strlen(conf->exchange) >= REC_NAME_LEN) {
+		fprintf(stderr, "bad recorder conf\n");
+		return NULL;
+	}
+	if ((w = calloc(1, sizeof(*w))) == NULL) {
+		return NULL;
+	}
+	w->conf = *conf;
+	if (w->conf.block_ticks == 0) {
+		w->conf.block_ticks = REC_BLOCK_TICKS;
+	}
+	w->fd = w->ifd = -1;
+
+	if (conf->calendar != NULL && bar_calendar_load(&w->cal, conf->calendar) != 0) {
+		free(w);
+		return NULL;
+	}
+
+	/* prefaulted now, not at the open */
+	n = conf->instruments > 0 ? conf->instruments : ARENA_INSTRUMENTS;
+	w->ninsts = n < TICK_INSTRUMENT_MAX ? (uint32_t)n : TICK_INSTRUMENT_MAX;
+	if (arena_init(&w->arena, w->ninsts * (sizeof(struct rec_inst) + (size_t)w->conf.block_ticks * 64 +
+					       2 * ARENA_ALIGN)) != 0 || make_insts(w) != 0) {
+		arena_free(&w->arena);
+		bar_calendar_free(&w->cal);
+		free(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+static int
+make_dirs(const char *path)
+{
+	char tmp[4096], *p;
+
+	snprintf(tmp, sizeof(tmp), "%s", path);
+	for (p = tmp + 1; *p != '\0'; p++) {
+		if (*p == '/') {
+			*p = '\0';
+			if (mkdir(tmp, 0755) != 0 && errno != EEXIST) {
+				return -1;
+			}
+			*p = '/';
+		}
+	}
+
+	return 0;
+}
+
+static void
+close_day(rec_writer_t *w)
+{
+	if (w->fd >= 0) {
+		fsync(w->fd);
+		close(w->fd);
+	}
+	if (w->ifd >= 0) {
+		close(w->ifd);
+	}
+	w->fd = w->ifd = -1;
+	w->day = 0;
+}
+
+/* open the files of the day to append, writing the header of a new one */
+static int
+open_day(rec_writer_t *w, uint32_t day)
+{
+	char path[4096];
+	struct rec_hdr hdr;
+	struct timespec ts;
+	struct stat st;
+
+	if (rec_path(path, sizeof(path), w->conf.dir, w->conf.exchange, day, REC_SUFFIX) != 0 ||
+	    make_dirs(path) != 0 || (w->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0 ||
+	    fstat(w->fd, &st) != 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		close_day(w);
+		return -1;
+	}
+
+	if (st.st_size == 0) {
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = REC_MAGIC;
+		hdr.version = REC_VERSION;
+		hdr.trading_day = day;
+		snprintf(hdr.exchange, sizeof(hdr.exchange), "%s", w->conf.exchange);
+		clock_gettime(CLOCK_REALTIME, &ts);
+		hdr.created = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+		if (write(w->fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+			fprintf(stderr, "cannot write %s\n", path);
+			close_day(w);
+			return -1;
+		}
+		w->offset = sizeof(hdr);
+		w->stats.files++;
+	} else if (pread(w->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || hdr.magic != REC_MAGIC ||
+		   hdr.version != REC_VERSION || hdr.trading_day != day) {
+		fprintf(stderr, "%s is not a tick file of %u\n", path, day);
+		close_day(w);
+		return -1;
+	} else {
+		w->offset = (uint64_t)st.st_size;
+	}
+
+	rec_path(path, sizeof(path), w->conf.dir, w->conf.exchange, day, REC_INDEX_SUFFIX);
+	if ((w->ifd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		close_day(w);
+		return -1;
+	}
+	w->day = day;
+
+	return 0;
+}
+
+/* write the open block of the instrument and its index entry */
+static int
+write_block(rec_writer_t *w, uint32_t id)
+{
+	struct rec_inst *in = w->insts[id];
+	const char *symbol = w->conf.symbol != NULL ? w->conf.symbol(id, w->conf.arg) : tick_symbol(id);
+	struct rec_block blk;
+	struct rec_index ix;
+	struct iovec iov[2];
+	ssize_t want;
+
+	memset(&blk, 0, sizeof(blk));
+	blk.magic = REC_BLOCK_MAGIC;
+	blk.count = in->count;
+	blk.nbytes = (uint32_t)in->len;
+	blk.first_ts = in->first_ts;
+	blk.last_ts = in->last_ts;
+	if (symbol != NULL) {
+		snprintf(blk.symbol, sizeof(blk.symbol), "%s", symbol);
+	} else {
+		snprintf(blk.symbol, sizeof(blk.symbol), "#%u", id);
+	}
+
+	iov[0].iov_base = &blk;
+	iov[0].iov_len = sizeof(blk);
+	iov[1].iov_base = in->buf;
+	iov[1].iov_len = in->len;
+	want = (ssize_t)(sizeof(blk) + in->len);
+
+	in->count = 0;
+	in->len = 0;
+	memset(in->prev, 0, sizeof(in->prev));
+
+	if (w->fd < 0 || writev(w->fd, iov, 2) != want) {
+		w->stats.errors++;
+		return -1;
+	}
+
+	memset(&ix, 0, sizeof(ix));
+	ix.offset = w->offset;
+	ix.first_ts = blk.first_ts;
+	ix.last_ts = blk.last_ts;
+	ix.count = blk.count;
+	ix.nbytes = blk.nbytes;
+	memcpy(ix.symbol, blk.symbol, sizeof(ix.symbol));
+	w->offset += (uint64_t)want;
+	if (write(w->ifd, &ix, sizeof(ix)) != (ssize_t)sizeof(ix)) {
+		/* the replay rebuilds the index from the blocks */
+		w->stats.errors++;
+	}
+
+	w->stats.blocks++;
+	w->stats.bytes += (uint64_t)want;
+
+	return 0;
+}
+
+int
+rec_flush(rec_writer_t *w, uint64_t now)
+{
+	uint32_t i, n = 0, id;
+	int rc = 0;
+
+	for (i = 0; i < w->nopen; i++) {
+		id = w->open[i];
+		if (w->insts[id]->count > 0 && (now == UINT64_MAX || (w->conf.flush_ns > 0 &&
+						now - w->insts[id]->opened >= w->conf.flush_ns))) {
+			rc |= write_block(w, id);
+		}
+		if (w->insts[id]->count > 0) {
+			w->open[n++] = id;
+		} else {
+			w->insts[id]->listed = 0;
+		}
+	}
+	w->nopen = n;
+
+	return rc;
+}
+
+int
+rec_write(rec_writer_t *w, const tick_rec_t *tick)
+{
+	uint32_t id = tick->instrument, day;
+	struct rec_inst *in;
+	size_t cap;
+	uint8_t *p;
+
+	if (id == 0 || id >= TICK_INSTRUMENT_MAX) {
+		return 0;
+	}
+	w->stats.ticks++;
+
+	/* a later trading day closes the files, a late tick stays in them */
+	day = trading_day(w, tick->timestamp);
+	if (day > w->day) {
+		rec_flush(w, UINT64_MAX);
+		close_day(w);
+
+		/* every block is written, the instruments start again in one block */
+		arena_reset(&w->arena);
+		memset(w->insts, 0, sizeof(w->insts));
+		if (make_insts(w) != 0 || open_day(w, day) != 0) {
+			w->stats.errors++;
+			return -1;
+		}
+	}
+
+	/* its first block follows it, the bigger ones are left in the arena until the reset */
+	if ((in = w->insts[id]) == NULL) {
+		if ((in = pool_get(&w->inst_pool)) == NULL) {
+			return -1;
+		}
+		memset(in, 0, sizeof(*in));
+		in->buf = (uint8_t *)(in + 1);
+		in->cap = w->inst_pool.size - sizeof(*in);
+		w->insts[id] = in;
+	}
+	if (in->len + REC_TICK_MAX > in->cap) {
+		cap = in->cap * 2;
+		while (cap < in->len + REC_TICK_MAX) {
+			cap *= 2;
+		}
+		if ((p = arena_alloc(&w->arena, cap)) == NULL) {
+			return -1;
+		}
+		memcpy(p, in->buf, in->len);
+		in->buf = p;
+		in->cap = cap;
+	}
+
+	if (in->count == 0) {
+		in->first_ts = tick->timestamp;
+		in->opened = w->conf.flush_ns > 0 ? mono_ns() : 0;
+	}
+	if (!in->listed) {
+		/* an id is listed once, a block filled and written stays listed until rec_flush() */
+		assert(w->nopen < TICK_INSTRUMENT_MAX);
+		w->open[w->nopen++] = id;
+		in->listed = 1;
+	}
+	in->len += rec_encode(in->buf + in->len, in->prev, tick);
+	in->last_ts = tick->timestamp;
+
+	if (++in->count >= w->conf.block_ticks) {
+		/* it leaves the open list at the next rec_flush() */
+		return write_block(w, id);
+	}
+
+	return 0;
+}
+
+size_t
+rec_poll(rec_writer_t *w, ring_reader_t *rd, size_t max)
+{
+	static __thread tick_rec_t batch[POLL_BATCH];
+	size_t n, i, total = 0;
+
+	while (total < max) {
+		n = ring_read(rd, batch, max - total < POLL_BATCH ? max - total : POLL_BATCH);
+		for (i = 0; i < n; i++) {
+			rec_write(w, &batch[i]);
+		}
+		total += n;
+		if (n < POLL_BATCH) {
+			break;
+		}
+	}
+
+	return total;
+}
+
+void
+rec_close(rec_writer_t *w)
+{
+	if (w == NULL) {
+		return;
+	}
+	rec_flush(w, UINT64_MAX);
+	close_day(w);
+	arena_free(&w->arena);
+	bar_calendar_free(&w->cal);
+	free(w);
+}
+
+void
+rec_stats(const rec_writer_t *w, struct rec_stats *st)
+{
+	*st = w->stats;
+	st->grows = w->arena.stats.grows;
+}
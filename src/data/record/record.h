@@ -0,0 +1,208 @@
+/*
+ * record.h
+ *
+ * The header file contains the definition of the tick files and the
+ * functions' prototype of the recorder writing them and of the replay
+ * reading them back.
+ *
+ * The recorder writes one append-only file per exchange and trading day,
+ * <dir>/<exchange>/<YYYYMMDD>.jtz, the ticks after 18:00 going to the next
+ * trading day like the night session. The ticks of every instrument are cut
+ * into blocks; a block is written whole, so a file is always readable up to
+ * its last complete block:
+ *
+ *	header     struct rec_hdr
+ *	blocks     struct rec_block and its payload, in the order completed
+ *
+ * Every tick of a block is the fields of tick_rec that changed since the
+ * tick before it in the block, a varint bitmask followed by the zigzag
+ * varint delta of every field in it, so the first tick of a block starts
+ * from zero and a block decodes on its own. Time, prices and the cumulative
+ * volume move a little from tick to tick and most fields do not move at
+ * all, which takes a tick of 256 bytes down to a few dozen.
+ *
+ * The seek index <YYYYMMDD>.jtzi is a struct rec_index per block, appended
+ * after the block; the replay picks the blocks of the instruments and the
+ * time range from it, and rebuilds it from the block headers if it is
+ * missing or short.
+ *
+ * The replay maps the files and merges the ticks of all instruments and
+ * files in timestamp order with a heap, as fast as it can or paced at a
+ * multiple of the recorded time, into tick records or tick_frame buffers
+ * for read_tick(MD_T_JUPITER, ...).
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tick.h"
+#include "ring.h"
+
+#define REC_MAGIC		0x5a4b544aU	/* "JTKZ" */
+#define REC_BLOCK_MAGIC		0x4b4c424aU	/* "JBLK" */
+#define REC_VERSION		1
+#define REC_SUFFIX		".jtz"
+#define REC_INDEX_SUFFIX	".jtzi"
+#define REC_NAME_LEN		16
+#define REC_BLOCK_TICKS		256	/* default ticks of a block */
+
+struct rec_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t trading_day;
+	uint32_t reserved;
+	char exchange[REC_NAME_LEN];
+	uint64_t created;		/* ns since epoch */
+	uint8_t reserved2[24];
+};
+
+_Static_assert(sizeof(struct rec_hdr) == 64, "rec_hdr is part of the file format");
+
+struct rec_block
+{
+	uint32_t magic;
+	uint32_t count;			/* ticks */
+	uint32_t nbytes;		/* of the payload */
+	uint32_t reserved;
+	uint64_t first_ts;
+	uint64_t last_ts;
+	char symbol[TICK_SYMBOL_LEN];
+};
+
+_Static_assert(sizeof(struct rec_block) == 64, "rec_block is part of the file format");
+
+struct rec_index
+{
+	uint64_t offset;		/* of the struct rec_block in the file */
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint32_t count;
+	uint32_t nbytes;
+	char symbol[TICK_SYMBOL_LEN];
+};
+
+_Static_assert(sizeof(struct rec_index) == 64, "rec_index is part of the file format");
+
+/* the most bytes a tick takes encoded */
+#define REC_TICK_MAX		(10 + 40 * 10)
+
+/*
+ * rec_encode - append the tick to the block at p as its delta to prev, and
+ * make prev the tick. Returns the bytes written, at most REC_TICK_MAX.
+ */
+size_t rec_encode(uint8_t *p, int64_t *prev, const tick_rec_t *t);
+
+/*
+ * rec_decode - the next tick of the block at p from prev. Returns the bytes
+ * read, 0 if the tick does not end before end.
+ */
+size_t rec_decode(const uint8_t *p, const uint8_t *end, int64_t *prev, tick_rec_t *t);
+
+#define REC_NFIELDS		37	/* the int64 fields of a tick, see rec_encode() */
+
+/*
+ * rec_path - <dir>/<exchange>/<YYYYMMDD><suffix>
+ */
+int rec_path(char *dst, size_t len, const char *dir, const char *exchange, uint32_t day,
+	     const char *suffix);
+
+struct rec_conf
+{
+	const char *dir;
+	const char *exchange;
+	const char *calendar;		/* file of the trading days, NULL for weekdays */
+	uint32_t block_ticks;		/* ticks of a block, 0 for REC_BLOCK_TICKS */
+	uint64_t flush_ns;		/* age a block is written at anyway, 0 for never */
+
+	/* symbol of an instrument id, NULL for tick_symbol(); bus readers give bus_symbol() */
+	const char *(*symbol)(uint32_t id, void *arg);
+	void *arg;
+	uint32_t instruments;		/* expected, their blocks are made at open, 0 for ARENA_INSTRUMENTS */
+};
+
+struct rec_stats
+{
+	uint64_t ticks;
+	uint64_t blocks;
+	uint64_t bytes;			/* written to the files, the index aside */
+	uint64_t files;
+	uint64_t errors;		/* failed writes */
+	uint64_t grows;			/* memory added beyond the expected instruments and blocks */
+};
+
+typedef struct rec_writer rec_writer_t;
+
+rec_writer_t *rec_open(const struct rec_conf *conf);
+
+/*
+ * rec_close - write the open blocks and close the files.
+ */
+void rec_close(rec_writer_t *w);
+
+/*
+ * rec_write - add the tick to the block of its instrument, writing the
+ * block when it is full. Returns 0, -1 if the write failed.
+ */
+int rec_write(rec_writer_t *w, const tick_rec_t *tick);
+
+/*
+ * rec_poll - rec_write() up to max ticks of the reader. Returns the ticks.
+ */
+size_t rec_poll(rec_writer_t *w, ring_reader_t *rd, size_t max);
+
+/*
+ * rec_flush - write the blocks opened flush_ns before now (monotonic), all
+ * of them with now = UINT64_MAX.
+ */
+int rec_flush(rec_writer_t *w, uint64_t now);
+
+void rec_stats(const rec_writer_t *w, struct rec_stats *st);
+
+struct rec_replay_conf
+{
+	uint64_t from;			/* ns since epoch, 0 for the start */
+	uint64_t to;			/* ns since epoch, 0 for the end */
+	const char *const *symbols;	/* the instruments replayed, NULL for all */
+	size_t nsymbols;
+	double speed;			/* multiple of the recorded time, 0 as fast as possible */
+};
+
+struct rec_replay_stats
+{
+	uint64_t ticks;			/* emitted */
+	uint64_t blocks;		/* decoded */
+	uint64_t bytes;			/* of the blocks decoded */
+	uint64_t streams;		/* instruments of the files merged */
+	uint64_t bad;			/* blocks skipped as corrupt */
+};
+
+typedef struct rec_replay rec_replay_t;
+
+/*
+ * rec_replay_open - map the files and set up the merge. The symbols are
+ * interned in this process, the instruments of the ticks are their ids.
+ */
+rec_replay_t *rec_replay_open(const char *const *paths, size_t npaths, const struct rec_replay_conf *conf);
+void rec_replay_close(rec_replay_t *rp);
+
+/*
+ * rec_replay_next - up to n ticks in timestamp order, waiting for the first
+ * of them with a speed. Returns the ticks, 0 at the end.
+ */
+size_t rec_replay_next(rec_replay_t *rp, tick_rec_t *out, size_t n);
+
+/*
+ * rec_replay_frames - rec_replay_next() into tick_frame buffers of at most
+ * len bytes, the input of read_tick(MD_T_JUPITER, ...). Returns the bytes,
+ * 0 at the end.
+ */
+size_t rec_replay_frames(rec_replay_t *rp, void *buf, size_t len);
+
+void rec_replay_stats(const rec_replay_t *rp, struct rec_replay_stats *st);
+
+#endif		/* __RECORD_H__ */
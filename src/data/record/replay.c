@@ -0,0 +1,475 @@
+/*
+ * replay.c
+ *
+ * The functions are used to replay the tick files of the recorder: every
+ * instrument of every file is a stream of its blocks, and a heap on the
+ * timestamp of the next tick of every stream merges them in order.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "record.h"
+
+#define FRAME_TICKS	64	/* records of a tick_frame, DECODE_MSGS_MAX of the decoder */
+
+struct rec_map
+{
+	const uint8_t *base;
+	size_t size;
+};
+
+struct rec_stream
+{
+	const uint8_t *base;		/* of the file */
+	const struct rec_index *blocks;	/* of the stream, in the order written */
+	size_t nblocks;
+	size_t next;			/* block decoded next */
+	uint32_t id;			/* interned */
+
+	tick_rec_t *buf;		/* the ticks of the block decoded */
+	uint32_t cap;
+	uint32_t n;
+	uint32_t pos;
+};
+
+struct rec_replay
+{
+	struct rec_replay_conf conf;
+	struct rec_map *maps;
+	size_t nmaps;
+	struct rec_index *index;	/* the blocks of all streams */
+	struct rec_stream *streams;
+	size_t nstreams;
+	uint32_t *heap;
+	size_t nheap;
+
+	int paced;
+	uint64_t wall0;
+	uint64_t ts0;
+	uint32_t seq;
+	struct rec_replay_stats stats;
+};
+
+static uint64_t
+mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+valid_block(const struct rec_map *m, uint64_t offset, struct rec_index *ix)
+{
+	struct rec_block blk;
+
+	/* the payloads are not padded, the headers are copied out */
+	if (offset < sizeof(struct rec_hdr) || offset + sizeof(blk) > m->size) {
+		return 0;
+	}
+	memcpy(&blk, m->base + offset, sizeof(blk));
+	if (blk.magic != REC_BLOCK_MAGIC || blk.nbytes > m->size - offset - sizeof(blk)) {
+		return 0;
+	}
+
+	if (ix != NULL) {
+		ix->offset = offset;
+		ix->first_ts = blk.first_ts;
+		ix->last_ts = blk.last_ts;
+		ix->count = blk.count;
+		ix->nbytes = blk.nbytes;
+		memcpy(ix->symbol, blk.symbol, sizeof(ix->symbol));
+		ix->symbol[sizeof(ix->symbol) - 1] = '\0';
+	}
+
+	return 1;
+}
+
+static int
+add_index(struct rec_replay *rp, size_t *n, size_t *cap, const struct rec_index *ix)
+{
+	struct rec_index *p;
+
+	if (*n == *cap) {
+		*cap = *cap ? *cap * 2 : 1024;
+		if ((p = realloc(rp->index, *cap * sizeof(*p))) == NULL) {
+			return -1;
+		}
+		rp->index = p;
+	}
+	rp->index[(*n)++] = *ix;
+
+	return 0;
+}
+
+/*
+ * load_index - the blocks of the file from its index, then the blocks after
+ * the last one indexed from the block headers.
+ */
+static int
+load_index(struct rec_replay *rp, size_t f, const char *path, size_t *n, size_t *cap)
+{
+	const struct rec_map *m = &rp->maps[f];
+	char ipath[4096];
+	struct rec_index ix;
+	uint64_t end = sizeof(struct rec_hdr);
+	FILE *fp;
+
+	snprintf(ipath, sizeof(ipath), "%si", path);
+	if ((fp = fopen(ipath, "rb")) != NULL) {
+		while (fread(&ix, sizeof(ix), 1, fp) == 1) {
+			ix.symbol[sizeof(ix.symbol) - 1] = '\0';
+			if (ix.offset < end || !valid_block(m, ix.offset, NULL)) {
+				rp->stats.bad++;
+				continue;
+			}
+			ix.offset += (uint64_t)f << 48;
+			if (add_index(rp, n, cap, &ix) != 0) {
+				fclose(fp);
+				return -1;
+			}
+			end = (ix.offset & ((1ULL << 48) - 1)) + sizeof(struct rec_block) + ix.nbytes;
+		}
+		fclose(fp);
+	}
+
+	while (end < m->size) {
+		if (!valid_block(m, end, &ix)) {
+			/* a block cut by a crash, the end of the file */
+			rp->stats.bad++;
+			break;
+		}
+		end += sizeof(struct rec_block) + ix.nbytes;
+		ix.offset += (uint64_t)f << 48;
+		if (add_index(rp, n, cap, &ix) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* the blocks by file, symbol and offset, a stream is a run of them */
+static int
+cmp_index(const void *a, const void *b)
+{
+	const struct rec_index *x = a, *y = b;
+	uint64_t fx = x->offset >> 48, fy = y->offset >> 48;
+	int c;
+
+	if (fx != fy) {
+		return fx < fy ? -1 : 1;
+	}
+	if ((c = strcmp(x->symbol, y->symbol)) != 0) {
+		return c;
+	}
+
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+static int
+wanted(const struct rec_replay *rp, const struct rec_index *ix)
+{
+	size_t i;
+
+	if ((rp->conf.from && ix->last_ts < rp->conf.from) || (rp->conf.to && ix->first_ts > rp->conf.to)) {
+		return 0;
+	}
+	if (rp->conf.symbols == NULL) {
+		return 1;
+	}
+	for (i = 0; i < rp->conf.nsymbols; i++) {
+		if (strcmp(rp->conf.symbols[i], ix->symbol) == 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * load_block - decode the next block of the stream with ticks from the
+ * start of the range. Returns 0, -1 at the end of the stream.
+ */
+static int
+load_block(struct rec_replay *rp, struct rec_stream *s)
+{
+	const struct rec_index *ix;
+	const uint8_t *p, *end;
+	int64_t prev[REC_NFIELDS];
+	tick_rec_t *buf;
+	uint32_t i;
+	size_t k;
+
+	while (s->next < s->nblocks) {
+		ix = &s->blocks[s->next++];
+		if (ix->count > s->cap) {
+			if ((buf = aligned_alloc(TICK_CACHELINE, (size_t)ix->count * sizeof(tick_rec_t))) == NULL) {
+				return -1;
+			}
+			free(s->buf);
+			s->buf = buf;
+			s->cap = ix->count;
+		}
+
+		p = s->base + (ix->offset & ((1ULL << 48) - 1)) + sizeof(struct rec_block);
+		end = p + ix->nbytes;
+		memset(prev, 0, sizeof(prev));
+		s->n = 0;
+		for (i = 0; i < ix->count; i++) {
+			if ((k = rec_decode(p, end, prev, &s->buf[s->n])) == 0) {
+				rp->stats.bad++;
+				break;
+			}
+			p += k;
+			if (s->buf[s->n].timestamp >= rp->conf.from) {
+				s->buf[s->n++].instrument = s->id;
+			}
+		}
+		rp->stats.blocks++;
+		rp->stats.bytes += ix->nbytes;
+
+		if (s->n > 0) {
+			s->pos = 0;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static inline int
+before(const struct rec_replay *rp, uint32_t a, uint32_t b)
+{
+	uint64_t ta = rp->streams[a].buf[rp->streams[a].pos].timestamp;
+	uint64_t tb = rp->streams[b].buf[rp->streams[b].pos].timestamp;
+
+	return ta < tb || (ta == tb && a < b);
+}
+
+static void
+sift_down(struct rec_replay *rp, size_t i)
+{
+	uint32_t *h = rp->heap, x = h[i];
+	size_t c;
+
+	while ((c = 2 * i + 1) < rp->nheap) {
+		if (c + 1 < rp->nheap && before(rp, h[c + 1], h[c])) {
+			c++;
+		}
+		if (!before(rp, h[c], x)) {
+			break;
+		}
+		h[i] = h[c];
+		i = c;
+	}
+	h[i] = x;
+}
+
+rec_replay_t *
+rec_replay_open(const char *const *paths, size_t npaths, const struct rec_replay_conf *conf)
+{
+	struct rec_replay *rp;
+	const struct rec_hdr *hdr;
+	struct rec_stream *s;
+	struct stat st;
+	size_t n = 0, cap = 0, i, j;
+	void *base;
+	int fd;
+
+	if ((rp = calloc(1, sizeof(*rp))) == NULL ||
+	    (rp->maps = calloc(npaths ? npaths : 1, sizeof(*rp->maps))) == NULL) {
+		free(rp);
+		return NULL;
+	}
+	rp->conf = *conf;
+
+	for (i = 0; i < npaths; i++) {
+		if ((fd = open(paths[i], O_RDONLY)) < 0 || fstat(fd, &st) != 0 ||
+		    (size_t)st.st_size < sizeof(*hdr) ||
+		    (base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+			fprintf(stderr, "cannot map %s\n", paths[i]);
+			if (fd >= 0) {
+				close(fd);
+			}
+			goto fail;
+		}
+		close(fd);
+		rp->maps[rp->nmaps].base = base;
+		rp->maps[rp->nmaps].size = (size_t)st.st_size;
+		rp->nmaps++;
+
+		hdr = base;
+		if (hdr->magic != REC_MAGIC || hdr->version != REC_VERSION) {
+			fprintf(stderr, "%s is not a tick file\n", paths[i]);
+			goto fail;
+		}
+		madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+		if (load_index(rp, rp->nmaps - 1, paths[i], &n, &cap) != 0) {
+			goto fail;
+		}
+	}
+
+	/* keep the blocks wanted, then cut them into streams */
+	for (i = j = 0; i < n; i++) {
+		if (wanted(rp, &rp->index[i])) {
+			rp->index[j++] = rp->index[i];
+		}
+	}
+	n = j;
+	qsort(rp->index, n, sizeof(*rp->index), cmp_index);
+
+	if ((rp->streams = calloc(n ? n : 1, sizeof(*rp->streams))) == NULL ||
+	    (rp->heap = calloc(n ? n : 1, sizeof(*rp->heap))) == NULL) {
+		goto fail;
+	}
+	for (i = 0; i < n; i = j) {
+		for (j = i + 1; j < n && rp->index[i].offset >> 48 == rp->index[j].offset >> 48 &&
+		     strcmp(rp->index[i].symbol, rp->index[j].symbol) == 0; j++)
+			;
+		s = &rp->streams[rp->nstreams];
+		s->base = rp->maps[rp->index[i].offset >> 48].base;
+		s->blocks = &rp->index[i];
+		s->nblocks = j - i;
+		if ((s->id = tick_intern(rp->index[i].symbol, strlen(rp->index[i].symbol))) == 0) {
+			fprintf(stderr, "too many instruments, %s not replayed\n", rp->index[i].symbol);
+			continue;
+		}
+		rp->nstreams++;
+		if (load_block(rp, s) == 0) {
+			rp->heap[rp->nheap++] = (uint32_t)(s - rp->streams);
+		}
+	}
+	rp->stats.streams = rp->nstreams;
+
+	for (i = rp->nheap / 2; i-- > 0;) {
+		sift_down(rp, i);
+	}
+
+	return rp;
+
+fail:
+	rec_replay_close(rp);
+	return NULL;
+}
+
+void
+rec_replay_close(rec_replay_t *rp)
+{
+	size_t i;
+
+	if (rp == NULL) {
+		return;
+	}
+	for (i = 0; i < rp->nstreams; i++) {
+		free(rp->streams[i].buf);
+	}
+	for (i = 0; i < rp->nmaps; i++) {
+		munmap((void *)rp->maps[i].base, rp->maps[i].size);
+	}
+	free(rp->streams);
+	free(rp->heap);
+	free(rp->index);
+	free(rp->maps);
+	free(rp);
+}
+
+size_t
+rec_replay_next(rec_replay_t *rp, tick_rec_t *out, size_t n)
+{
+	struct rec_stream *s;
+	const tick_rec_t *t;
+	struct timespec ts;
+	uint64_t due, now;
+	size_t emitted = 0;
+
+	while (emitted < n && rp->nheap > 0) {
+		s = &rp->streams[rp->heap[0]];
+		t = &s->buf[s->pos];
+
+		if (rp->conf.to && t->timestamp > rp->conf.to) {
+			/* the rest of the stream is after the range too */
+			rp->heap[0] = rp->heap[--rp->nheap];
+			sift_down(rp, 0);
+			continue;
+		}
+
+		if (rp->conf.speed > 0) {
+			if (!rp->paced) {
+				rp->paced = 1;
+				rp->wall0 = mono_ns();
+				rp->ts0 = t->timestamp;
+			}
+			due = rp->wall0 + (uint64_t)((double)(t->timestamp - rp->ts0) / rp->conf.speed);
+			if ((now = mono_ns()) < due) {
+				if (emitted > 0) {
+					break;
+				}
+				ts.tv_sec = (time_t)((due - now) / 1000000000ULL);
+				ts.tv_nsec = (long)((due - now) % 1000000000ULL);
+				nanosleep(&ts, NULL);
+			}
+		}
+
+		out[emitted++] = *t;
+
+		if (++s->pos == s->n && load_block(rp, s) != 0) {
+			rp->heap[0] = rp->heap[--rp->nheap];
+		}
+		sift_down(rp, 0);
+	}
+	rp->stats.ticks += emitted;
+
+	return emitted;
+}
+
+size_t
+rec_replay_frames(rec_replay_t *rp, void *buf, size_t len)
+{
+	static __thread tick_rec_t batch[FRAME_TICKS];
+	uint8_t *p = buf;
+	tick_frame_t fr;
+	size_t off = 0, want, got;
+
+	while (len - off >= sizeof(tick_frame_t) + sizeof(tick_rec_t)) {
+		want = (len - off - sizeof(tick_frame_t)) / sizeof(tick_rec_t);
+		if (want > FRAME_TICKS) {
+			want = FRAME_TICKS;
+		}
+		if ((got = rec_replay_next(rp, batch, want)) == 0) {
+			break;
+		}
+
+		memset(&fr, 0, sizeof(fr));
+		fr.magic = TICK_MAGIC;
+		fr.version = TICK_VERSION;
+		fr.count = (uint16_t)got;
+		fr.seq = ++rp->seq;
+		fr.send_ts = batch[got - 1].timestamp;
+		memcpy(p + off, &fr, sizeof(fr));
+		memcpy(p + off + sizeof(fr), batch, got * sizeof(tick_rec_t));
+		off += sizeof(fr) + got * sizeof(tick_rec_t);
+
+		if (got < want) {
+			break;
+		}
+	}
+
+	return off;
+}
+
+void
+rec_replay_stats(const rec_replay_t *rp, struct rec_replay_stats *st)
+{
+	*st = rp->stats;
+}
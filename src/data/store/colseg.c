@@ -0,0 +1,229 @@
+/*
+ * colseg.c
+ *
+ * The functions are used to append the segments of the continuous series
+ * and to adjust the raw prices of the majors by them on reading.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "colstore.h"
+
+const char *const col_adjust_names[COL_ADJ_MAX] = {
+	[COL_ADJ_NONE] = "none",
+	[COL_ADJ_FORWARD] = "forward",
+	[COL_ADJ_FORWARD_RATIO] = "forward_ratio",
+	[COL_ADJ_BACKWARD] = "backward",
+	[COL_ADJ_BACKWARD_RATIO] = "backward_ratio",
+};
+
+int
+col_adjust_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < COL_ADJ_MAX; i++) {
+		if (strcmp(name, col_adjust_names[i]) == 0) {
+			return i;
+		}
+	}
+	if (strcmp(name, "difference") == 0) {
+		return COL_ADJ_FORWARD;
+	}
+	if (strcmp(name, "ratio") == 0) {
+		return COL_ADJ_FORWARD_RATIO;
+	}
+
+	return -1;
+}
+
+int
+col_seg_open(col_seg_file_t *s, const char *path)
+{
+	const struct col_seg_hdr *hdr;
+	struct stat st;
+	void *p;
+	int fd;
+
+	memset(s, 0, sizeof(*s));
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct col_seg_hdr)) {
+		close(fd);
+		return -2;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return -2;
+	}
+
+	hdr = p;
+	if (hdr->magic != COL_SEG_MAGIC || hdr->version != COL_SEG_VERSION ||
+	    sizeof(*hdr) + hdr->nsegments * sizeof(struct col_segment) > (uint64_t)st.st_size) {
+		fprintf(stderr, "%s is not a segment file of version %d\n", path, COL_SEG_VERSION);
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	s->hdr = hdr;
+	s->size = (size_t)st.st_size;
+	s->nsegments = hdr->nsegments;
+	s->segments = (const struct col_segment *)(hdr + 1);
+
+	return 0;
+}
+
+void
+col_seg_close(col_seg_file_t *s)
+{
+	if (s->hdr != NULL) {
+		munmap((void *)s->hdr, s->size);
+	}
+	memset(s, 0, sizeof(*s));
+}
+
+int
+col_seg_append(const char *path, const struct col_segment *segs, uint64_t n, int truncate)
+{
+	struct col_seg_hdr hdr;
+	char tmp[4096];
+	size_t len = n * sizeof(*segs);
+	off_t off;
+	int fd;
+
+	if (truncate || access(path, F_OK) != 0) {
+		snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = COL_SEG_MAGIC;
+		hdr.version = COL_SEG_VERSION;
+		hdr.nsegments = n;
+
+		if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+			fprintf(stderr, "cannot create %s: %s\n", tmp, strerror(errno));
+			return -1;
+		}
+		if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr) ||
+		    (len > 0 && write(fd, segs, len) != (ssize_t)len) || close(fd) != 0) {
+			fprintf(stderr, "cannot write %s\n", tmp);
+			unlink(tmp);
+			return -1;
+		}
+		if (rename(tmp, path) != 0) {
+			fprintf(stderr, "cannot rename %s: %s\n", tmp, strerror(errno));
+			unlink(tmp);
+			return -1;
+		}
+		return 0;
+	}
+
+	if ((fd = open(path, O_RDWR)) < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+	    hdr.magic != COL_SEG_MAGIC || hdr.version != COL_SEG_VERSION) {
+		fprintf(stderr, "%s is not a segment file of version %d\n", path, COL_SEG_VERSION);
+		close(fd);
+		return -1;
+	}
+
+	/* the segments go in before the count that makes readers see them */
+	off = (off_t)(sizeof(hdr) + hdr.nsegments * sizeof(*segs));
+	hdr.nsegments += n;
+	if ((len > 0 && pwrite(fd, segs, len, off) != (ssize_t)len) ||
+	    pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+		fprintf(stderr, "cannot append to %s\n", path);
+		close(fd);
+		return -1;
+	}
+
+	return close(fd);
+}
+
+void
+col_adjust(const struct col_segment *segs, uint64_t n, int method, const int32_t *day,
+	   const double *px, double *out, uint64_t rows)
+{
+	const struct col_segment *last = n > 0 ? &segs[n - 1] : NULL;
+	uint64_t i = 0, j, k = 0;
+	double a, b;
+
+	while (i < rows) {
+		/* the segment of the day, the first for the days before it */
+		while (k + 1 < n && segs[k + 1].trading_day <= day[i]) {
+			k++;
+		}
+		j = i + 1;
+		if (k + 1 < n) {
+			while (j < rows && day[j] < segs[k + 1].trading_day) {
+				j++;
+			}
+		} else {
+			j = rows;
+		}
+
+		a = 1;
+		b = 0;
+		if (n > 0) {
+			switch (method) {
+			case COL_ADJ_FORWARD:
+				b = -segs[k].cum_gap;
+				break;
+			case COL_ADJ_FORWARD_RATIO:
+				a = 1 / segs[k].cum_ratio;
+				break;
+			case COL_ADJ_BACKWARD:
+				b = last->cum_gap - segs[k].cum_gap;
+				break;
+			case COL_ADJ_BACKWARD_RATIO:
+				a = last->cum_ratio / segs[k].cum_ratio;
+				break;
+			default:
+				break;
+			}
+		}
+
+		for (; i < j; i++) {
+			out[i] = px[i] * a + b;
+		}
+	}
+}
+
+uint64_t
+col_seg_rows(const col_file_t *f, const struct col_segment *segs, uint64_t n, uint64_t *rows)
+{
+	uint64_t i, k = 0, m = 0;
+	int64_t code;
+
+	if (n == 0) {
+		return 0;
+	}
+
+	code = col_lookup(f, segs[0].symbol);
+	for (i = col_day_after(f, segs[0].trading_day - 1); i < f->nrows; i++) {
+		if (k + 1 < n && f->trading_day[i] >= segs[k + 1].trading_day) {
+			while (k + 1 < n && f->trading_day[i] >= segs[k + 1].trading_day) {
+				k++;
+			}
+			code = col_lookup(f, segs[k].symbol);
+		}
+		if ((int64_t)f->instrument[i] == code) {
+			rows[m++] = i;
+		}
+	}
+
+	return m;
+}
@@ -0,0 +1,677 @@
+/*
+ * colstore.c
+ *
+ * The functions are used to write the columnar bar files and to map them for
+ * reading.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "colstore.h"
+
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+#define DICT_HASH_MIN	1024
+
+static const size_t col_width[COL_MAX] = {
+	[COL_TIMESTAMP] = sizeof(int64_t),
+	[COL_TRADING_DAY] = sizeof(int32_t),
+	[COL_INSTRUMENT] = sizeof(uint32_t),
+	[COL_OPEN] = sizeof(double),
+	[COL_HIGH] = sizeof(double),
+	[COL_LOW] = sizeof(double),
+	[COL_CLOSE] = sizeof(double),
+	[COL_VOLUME] = sizeof(int64_t),
+	[COL_OI] = sizeof(int64_t),
+	[COL_AMOUNT] = sizeof(double),
+};
+
+struct col_writer
+{
+	char exchange[COL_NAME_LEN];
+	char product[COL_NAME_LEN];
+	int bar_type;
+
+	uint64_t nrows;
+	uint64_t cap;
+	void *cols[COL_MAX];		/* COL_INSTRUMENT holds the codes of first sight */
+
+	char (*symbols)[COL_SYMBOL_LEN];
+	uint32_t nsymbols;
+	uint32_t symbols_cap;
+	uint32_t *hash;			/* code + 1 of the symbol, 0 if empty */
+	uint32_t hash_size;
+};
+
+int
+col_path(char *dst, size_t len, const char *root, const char *exchange,
+	 const char *product, int bar_type)
+{
+	if ((unsigned int)bar_type >= BAR_T_MAX) {
+		return -1;
+	}
+
+	return snprintf(dst, len, "%s/%s/%s.%s%s", root, exchange, product,
+			bar_type_names[bar_type], COL_SUFFIX) < (int)len ? 0 : -1;
+}
+
+int
+col_open(col_file_t *f, const char *path)
+{
+	const struct col_hdr *hdr;
+	const uint8_t *base;
+	struct stat st;
+	uint64_t end;
+	void *p;
+	int fd, i;
+
+	memset(f, 0, sizeof(*f));
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct col_hdr)) {
+		close(fd);
+		return -2;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return -2;
+	}
+
+	base = p;
+	hdr = p;
+	if (hdr->magic != COL_MAGIC || hdr->version != COL_VERSION ||
+	    hdr->file_size != (uint64_t)st.st_size) {
+		fprintf(stderr, "%s is not a column file of version %d\n", path, COL_VERSION);
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	/* every section must lie in the file */
+	for (i = 0; i < COL_MAX; i++) {
+		end = hdr->col_off[i] + hdr->nrows * col_width[i];
+		if (hdr->col_off[i] % COL_ALIGN != 0 || end > hdr->file_size) {
+			munmap(p, (size_t)st.st_size);
+			return -3;
+		}
+	}
+	if (hdr->dict_off + (uint64_t)hdr->ninstruments * COL_SYMBOL_LEN > hdr->file_size ||
+	    hdr->footer_off + hdr->nblocks * sizeof(struct col_block) > hdr->file_size) {
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	f->hdr = hdr;
+	f->size = (size_t)st.st_size;
+	f->nrows = hdr->nrows;
+	f->timestamp = (const int64_t *)(base + hdr->col_off[COL_TIMESTAMP]);
+	f->trading_day = (const int32_t *)(base + hdr->col_off[COL_TRADING_DAY]);
+	f->instrument = (const uint32_t *)(base + hdr->col_off[COL_INSTRUMENT]);
+	f->open = (const double *)(base + hdr->col_off[COL_OPEN]);
+	f->high = (const double *)(base + hdr->col_off[COL_HIGH]);
+	f->low = (const double *)(base + hdr->col_off[COL_LOW]);
+	f->close = (const double *)(base + hdr->col_off[COL_CLOSE]);
+	f->volume = (const int64_t *)(base + hdr->col_off[COL_VOLUME]);
+	f->oi = (const int64_t *)(base + hdr->col_off[COL_OI]);
+	f->amount = (const double *)(base + hdr->col_off[COL_AMOUNT]);
+	f->symbols = (const char (*)[COL_SYMBOL_LEN])(base + hdr->dict_off);
+	f->blocks = (const struct col_block *)(base + hdr->footer_off);
+
+	return 0;
+}
+
+void
+col_close(col_file_t *f)
+{
+	if (f->hdr != NULL) {
+		munmap((void *)f->hdr, f->size);
+	}
+	memset(f, 0, sizeof(*f));
+}
+
+/*
+ * lower_bound - the first row of [lo, hi) whose timestamp is not below ts.
+ */
+static uint64_t
+lower_bound(const int64_t *col, uint64_t lo, uint64_t hi, int64_t ts)
+{
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		if (col[mid] < ts) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+uint64_t
+col_range(const col_file_t *f, int64_t from, int64_t to, uint64_t *first, uint64_t *last)
+{
+	const struct col_block *b = f->blocks;
+	uint64_t nb = f->hdr->nblocks, i, j;
+
+	*first = *last = 0;
+	if (f->nrows == 0 || from > to || to < f->hdr->min_ts || from > f->hdr->max_ts) {
+		return 0;
+	}
+
+	/* the blocks are sorted, so the footer narrows the search to two blocks */
+	for (i = 0; i < nb && b[i].max_ts < from; i++)
+		;
+	for (j = i; j < nb && b[j].min_ts <= to; j++)
+		;
+	if (i == j) {
+		return 0;
+	}
+
+	*first = lower_bound(f->timestamp, b[i].first, b[i].first + b[i].rows, from);
+	*last = lower_bound(f->timestamp, b[j - 1].first, b[j - 1].first + b[j - 1].rows,
+			    to == INT64_MAX ? to : to + 1);
+
+	return *last - *first;
+}
+
+uint64_t
+col_day_after(const col_file_t *f, int32_t day)
+{
+	uint64_t lo = 0, hi = f->nrows;
+
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		if (f->trading_day[mid] <= day) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+int64_t
+col_lookup(const col_file_t *f, const char *symbol)
+{
+	uint32_t lo = 0, hi = f->hdr->ninstruments;
+
+	/* the dict is sorted by symbol */
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		int c = strncmp(f->symbols[mid], symbol, COL_SYMBOL_LEN);
+
+		if (c == 0) {
+			return mid;
+		}
+		if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return -1;
+}
+
+col_writer_t *
+col_writer_create(const char *exchange, const char *product, int bar_type)
+{
+	col_writer_t *w;
+
+	if ((unsigned int)bar_type >= BAR_T_MAX || (w = calloc(1, sizeof(*w))) == NULL) {
+		return NULL;
+	}
+
+	snprintf(w->exchange, sizeof(w->exchange), "%s", exchange != NULL ? exchange : "");
+	snprintf(w->product, sizeof(w->product), "%s", product != NULL ? product : "");
+	w->bar_type = bar_type;
+
+	return w;
+}
+
+void
+col_writer_free(col_writer_t *w)
+{
+	int i;
+
+	if (w == NULL) {
+		return;
+	}
+
+	for (i = 0; i < COL_MAX; i++) {
+		free(w->cols[i]);
+	}
+	free(w->symbols);
+	free(w->hash);
+	free(w);
+}
+
+static uint32_t
+hash_symbol(const char *s)
+{
+	uint32_t h = 2166136261U;
+
+	while (*s != '\0') {
+		h ^= (uint8_t)*s++;
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static int
+grow_dict(col_writer_t *w)
+{
+	uint32_t size = w->hash_size ? w->hash_size * 2 : DICT_HASH_MIN, i, j;
+	uint32_t *hash;
+	void *p;
+
+	if ((p = realloc(w->symbols, (size_t)(size / 2) * COL_SYMBOL_LEN)) == NULL) {
+		return -1;
+	}
+	w->symbols = p;
+	w->symbols_cap = size / 2;
+
+	if ((hash = calloc(size, sizeof(*hash))) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < w->nsymbols; i++) {
+		j = hash_symbol(w->symbols[i]) & (size - 1);
+		while (hash[j] != 0) {
+			j = (j + 1) & (size - 1);
+		}
+		hash[j] = i + 1;
+	}
+
+	free(w->hash);
+	w->hash = hash;
+	w->hash_size = size;
+
+	return 0;
+}
+
+static int64_t
+intern(col_writer_t *w, const char *symbol)
+{
+	uint32_t i, id;
+
+	if (w->nsymbols >= w->symbols_cap && grow_dict(w) != 0) {
+		return -1;
+	}
+
+	i = hash_symbol(symbol) & (w->hash_size - 1);
+	while ((id = w->hash[i]) != 0) {
+		if (strncmp(w->symbols[id - 1], symbol, COL_SYMBOL_LEN - 1) == 0) {
+			return id - 1;
+		}
+		i = (i + 1) & (w->hash_size - 1);
+	}
+
+	id = w->nsymbols++;
+	memset(w->symbols[id], 0, COL_SYMBOL_LEN);
+	strncpy(w->symbols[id], symbol, COL_SYMBOL_LEN - 1);
+	w->hash[i] = id + 1;
+
+	return id;
+}
+
+static int
+reserve(col_writer_t *w)
+{
+	uint64_t cap;
+	void *p;
+	int i;
+
+	if (w->nrows < w->cap) {
+		return 0;
+	}
+
+	cap = w->cap ? w->cap * 2 : 4096;
+	for (i = 0; i < COL_MAX; i++) {
+		if ((p = realloc(w->cols[i], cap * col_width[i])) == NULL) {
+			return -1;
+		}
+		w->cols[i] = p;
+	}
+	w->cap = cap;
+
+	return 0;
+}
+
+int
+col_writer_add(col_writer_t *w, const struct col_row *row)
+{
+	uint64_t n = w->nrows;
+	int64_t code;
+
+	if (row->symbol == NULL || row->symbol[0] == '\0') {
+		return -1;
+	}
+
+	if (reserve(w) != 0 || (code = intern(w, row->symbol)) < 0) {
+		return -2;
+	}
+
+	((int64_t *)w->cols[COL_TIMESTAMP])[n] = row->timestamp;
+	((int32_t *)w->cols[COL_TRADING_DAY])[n] = row->trading_day;
+	((uint32_t *)w->cols[COL_INSTRUMENT])[n] = (uint32_t)code;
+	((double *)w->cols[COL_OPEN])[n] = row->open;
+	((double *)w->cols[COL_HIGH])[n] = row->high;
+	((double *)w->cols[COL_LOW])[n] = row->low;
+	((double *)w->cols[COL_CLOSE])[n] = row->close;
+	((int64_t *)w->cols[COL_VOLUME])[n] = row->volume;
+	((int64_t *)w->cols[COL_OI])[n] = row->oi;
+	((double *)w->cols[COL_AMOUNT])[n] = row->amount;
+	w->nrows++;
+
+	return 0;
+}
+
+int
+col_writer_add_bar(col_writer_t *w, const bar_rec_t *bar, const char *symbol)
+{
+	struct col_row row;
+
+	if (bar->type != w->bar_type) {
+		return -1;
+	}
+
+	row.timestamp = (int64_t)bar->end;
+	row.trading_day = (int32_t)bar->trading_day;
+	row.symbol = symbol;
+	row.open = tick_px_double(bar->open);
+	row.high = tick_px_double(bar->high);
+	row.low = tick_px_double(bar->low);
+	row.close = tick_px_double(bar->close);
+	row.volume = bar->volume;
+	row.oi = bar->open_interest;
+	row.amount = tick_px_double(bar->turnover);
+
+	return col_writer_add(w, &row);
+}
+
+int
+col_writer_load(col_writer_t *w, const char *path)
+{
+	struct col_row row;
+	col_file_t f;
+	uint64_t i;
+	int ret;
+
+	if ((ret = col_open(&f, path)) != 0) {
+		/* nothing to append to */
+		return ret == -1 && errno == ENOENT ? 0 : ret;
+	}
+
+	if ((int)f.hdr->bar_type != w->bar_type) {
+		fprintf(stderr, "%s holds %s bars, not %s\n", path,
+			bar_type_names[f.hdr->bar_type % BAR_T_MAX], bar_type_names[w->bar_type]);
+		col_close(&f);
+		return -3;
+	}
+
+	for (i = 0; i < f.nrows; i++) {
+		if (f.instrument[i] >= f.hdr->ninstruments) {
+			fprintf(stderr, "%s: row %lu has instrument %u of %u\n", path, (unsigned long)i,
+				f.instrument[i], f.hdr->ninstruments);
+			col_close(&f);
+			return -3;
+		}
+		row.timestamp = f.timestamp[i];
+		row.trading_day = f.trading_day[i];
+		row.symbol = f.symbols[f.instrument[i]];
+		row.open = f.open[i];
+		row.high = f.high[i];
+		row.low = f.low[i];
+		row.close = f.close[i];
+		row.volume = f.volume[i];
+		row.oi = f.oi[i];
+		row.amount = f.amount[i];
+		if (col_writer_add(w, &row) != 0) {
+			col_close(&f);
+			return -2;
+		}
+	}
+
+	col_close(&f);
+
+	return 0;
+}
+
+struct sort_ctx
+{
+	const int64_t *ts;
+	const uint32_t *code;
+	const uint32_t *rank;
+	const char (*symbols)[COL_SYMBOL_LEN];
+};
+
+static int
+cmp_symbol(const void *a, const void *b, void *arg)
+{
+	const struct sort_ctx *c = arg;
+
+	return strncmp(c->symbols[*(const uint32_t *)a], c->symbols[*(const uint32_t *)b], COL_SYMBOL_LEN);
+}
+
+static int
+cmp_row(const void *a, const void *b, void *arg)
+{
+	const struct sort_ctx *c = arg;
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	uint32_t rx = c->rank[c->code[x]], ry = c->rank[c->code[y]];
+
+	if (c->ts[x] != c->ts[y]) {
+		return c->ts[x] < c->ts[y] ? -1 : 1;
+	}
+	if (rx != ry) {
+		return rx < ry ? -1 : 1;
+	}
+
+	/* the row added later wins, keep the added order */
+	return x < y ? -1 : x > y;
+}
+
+static int
+write_pad(FILE *fp, uint64_t *off)
+{
+	static const uint8_t zero[COL_ALIGN];
+	uint64_t pad = ALIGN_UP(*off, COL_ALIGN) - *off;
+
+	if (pad > 0 && fwrite(zero, 1, pad, fp) != pad) {
+		return -1;
+	}
+	*off += pad;
+
+	return 0;
+}
+
+/*
+ * write_column - gather the column through the permutation and write it.
+ */
+static int
+write_column(FILE *fp, const col_writer_t *w, int col, const uint64_t *perm, uint64_t n,
+	     const uint32_t *rank, uint64_t *off)
+{
+	uint8_t buf[8192];
+	size_t width = col_width[col], per = sizeof(buf) / width, k;
+	const uint8_t *src = w->cols[col];
+	uint64_t i = 0;
+
+	while (i < n) {
+		for (k = 0; k < per && i < n; k++, i++) {
+			if (col == COL_INSTRUMENT) {
+				uint32_t code = rank[((const uint32_t *)src)[perm[i]]];
+
+				memcpy(buf + k * width, &code, width);
+			} else {
+				memcpy(buf + k * width, src + perm[i] * width, width);
+			}
+		}
+		if (fwrite(buf, width, k, fp) != k) {
+			return -1;
+		}
+		*off += k * width;
+	}
+
+	return 0;
+}
+
+int
+col_writer_write(col_writer_t *w, const char *path)
+{
+	const int64_t *ts = w->cols[COL_TIMESTAMP];
+	uint32_t *rank = NULL, *order = NULL, i;
+	uint64_t *perm = NULL, n = 0, r, off, b;
+	struct col_block *blocks = NULL;
+	struct sort_ctx ctx;
+	struct col_hdr hdr;
+	char tmp[4096];
+	FILE *fp = NULL;
+	int ret = -2, col;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid()) >= (int)sizeof(tmp)) {
+		return -1;
+	}
+
+	perm = malloc((w->nrows ? w->nrows : 1) * sizeof(*perm));
+	rank = malloc((w->nsymbols ? w->nsymbols : 1) * sizeof(*rank));
+	order = malloc((w->nsymbols ? w->nsymbols : 1) * sizeof(*order));
+	if (perm == NULL || rank == NULL || order == NULL) {
+		goto out;
+	}
+
+	/* the dict is written sorted, so the codes are ranks of the symbols */
+	ctx.symbols = (const char (*)[COL_SYMBOL_LEN])w->symbols;
+	for (i = 0; i < w->nsymbols; i++) {
+		order[i] = i;
+	}
+	qsort_r(order, w->nsymbols, sizeof(*order), cmp_symbol, &ctx);
+	for (i = 0; i < w->nsymbols; i++) {
+		rank[order[i]] = i;
+	}
+
+	ctx.ts = ts;
+	ctx.code = w->cols[COL_INSTRUMENT];
+	ctx.rank = rank;
+	for (r = 0; r < w->nrows; r++) {
+		perm[r] = r;
+	}
+	qsort_r(perm, w->nrows, sizeof(*perm), cmp_row, &ctx);
+
+	/* the last of the same bar replaces the earlier ones */
+	for (r = 0; r < w->nrows; r++) {
+		if (n > 0 && ts[perm[n - 1]] == ts[perm[r]] &&
+		    ctx.code[perm[n - 1]] == ctx.code[perm[r]]) {
+			perm[n - 1] = perm[r];
+		} else {
+			perm[n++] = perm[r];
+		}
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = COL_MAGIC;
+	hdr.version = COL_VERSION;
+	hdr.bar_type = (uint32_t)w->bar_type;
+	hdr.ninstruments = w->nsymbols;
+	memcpy(hdr.exchange, w->exchange, sizeof(hdr.exchange));
+	memcpy(hdr.product, w->product, sizeof(hdr.product));
+	hdr.nrows = n;
+	hdr.block_rows = COL_BLOCK_ROWS;
+	hdr.nblocks = (n + COL_BLOCK_ROWS - 1) / COL_BLOCK_ROWS;
+	hdr.min_ts = n ? ts[perm[0]] : 0;
+	hdr.max_ts = n ? ts[perm[n - 1]] : 0;
+
+	off = ALIGN_UP(sizeof(hdr), COL_ALIGN);
+	for (col = 0; col < COL_MAX; col++) {
+		hdr.col_off[col] = off;
+		off = ALIGN_UP(off + n * col_width[col], COL_ALIGN);
+	}
+	hdr.dict_off = off;
+	off = ALIGN_UP(off + (uint64_t)w->nsymbols * COL_SYMBOL_LEN, COL_ALIGN);
+	hdr.footer_off = off;
+	hdr.file_size = off + hdr.nblocks * sizeof(struct col_block);
+
+	if ((blocks = calloc(hdr.nblocks ? hdr.nblocks : 1, sizeof(*blocks))) == NULL) {
+		goto out;
+	}
+	for (b = 0; b < hdr.nblocks; b++) {
+		blocks[b].first = b * COL_BLOCK_ROWS;
+		blocks[b].rows = n - blocks[b].first < COL_BLOCK_ROWS ? n - blocks[b].first : COL_BLOCK_ROWS;
+		blocks[b].min_ts = ts[perm[blocks[b].first]];
+		blocks[b].max_ts = ts[perm[blocks[b].first + blocks[b].rows - 1]];
+	}
+
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		fprintf(stderr, "cannot create %s: %s\n", tmp, strerror(errno));
+		goto out;
+	}
+
+	off = 0;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+		goto out;
+	}
+	off += sizeof(hdr);
+
+	for (col = 0; col < COL_MAX; col++) {
+		if (write_pad(fp, &off) != 0 || write_column(fp, w, col, perm, n, rank, &off) != 0) {
+			goto out;
+		}
+	}
+
+	if (write_pad(fp, &off) != 0) {
+		goto out;
+	}
+	for (i = 0; i < w->nsymbols; i++) {
+		if (fwrite(w->symbols[order[i]], COL_SYMBOL_LEN, 1, fp) != 1) {
+			goto out;
+		}
+	}
+	off += (uint64_t)w->nsymbols * COL_SYMBOL_LEN;
+
+	if (write_pad(fp, &off) != 0 ||
+	    fwrite(blocks, sizeof(*blocks), hdr.nblocks, fp) != hdr.nblocks ||
+	    fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+		goto out;
+	}
+
+	if (fclose(fp) != 0) {
+		fp = NULL;
+		goto out;
+	}
+	fp = NULL;
+
+	if (rename(tmp, path) != 0) {
+		fprintf(stderr, "cannot rename %s to %s: %s\n", tmp, path, strerror(errno));
+		goto out;
+	}
+	ret = 0;
+
+out:
+	if (fp != NULL) {
+		fclose(fp);
+	}
+	if (ret != 0) {
+		unlink(tmp);
+	}
+	free(blocks);
+	free(order);
+	free(rank);
+	free(perm);
+
+	return ret;
+}
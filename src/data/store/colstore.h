@@ -0,0 +1,263 @@
+/*
+ * colstore.h
+ *
+ * The file contains the definition of the columnar bar file and the
+ * functions' prototype for writing and mapping it.
+ *
+ * A file holds the bars of one (exchange, product, bar_type), all contracts
+ * of the product together, sorted by timestamp and instrument. Each column
+ * is a plain array at a 64-byte aligned offset, so a reader maps the file
+ * and uses the arrays in place, from C or as numpy arrays (colstore.py):
+ *
+ *	header     struct col_hdr, the offsets of everything below
+ *	columns    timestamp, trading_day, instrument, open ... amount
+ *	dict       the symbols of the instrument codes, char[32] each
+ *	footer     struct col_block per COL_BLOCK_ROWS rows, min/max timestamp
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __COLSTORE_H__
+#define __COLSTORE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "bar.h"
+
+#define COL_MAGIC	0x4c4f434aU	/* "JCOL" */
+#define COL_VERSION	1
+#define COL_ALIGN	64
+#define COL_BLOCK_ROWS	65536
+#define COL_SYMBOL_LEN	32
+#define COL_NAME_LEN	16
+#define COL_SUFFIX	".jcol"
+
+enum col_id {
+	COL_TIMESTAMP = 0,	/* int64, ns since epoch of the end of the bar */
+	COL_TRADING_DAY,	/* int32, YYYYMMDD */
+	COL_INSTRUMENT,		/* uint32, code of the symbol in the dict */
+	COL_OPEN,		/* double */
+	COL_HIGH,		/* double */
+	COL_LOW,		/* double */
+	COL_CLOSE,		/* double */
+	COL_VOLUME,		/* int64 */
+	COL_OI,			/* int64 */
+	COL_AMOUNT,		/* double */
+	COL_MAX
+};
+
+struct col_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t bar_type;		/* enum bar_type */
+	uint32_t ninstruments;		/* symbols in the dict */
+	char exchange[COL_NAME_LEN];
+	char product[COL_NAME_LEN];
+
+	uint64_t nrows;
+	uint64_t nblocks;
+	uint64_t block_rows;
+	int64_t min_ts;
+	int64_t max_ts;
+	uint64_t file_size;
+
+	uint64_t col_off[COL_MAX];	/* offset of every column */
+	uint64_t dict_off;
+	uint64_t footer_off;
+
+	uint8_t reserved[128];
+};
+
+_Static_assert(sizeof(struct col_hdr) == 320, "col_hdr is part of the file format");
+
+struct col_block
+{
+	int64_t min_ts;
+	int64_t max_ts;
+	uint64_t first;			/* first row of the block */
+	uint64_t rows;
+};
+
+/*
+ * col_file - a mapped file; the arrays point into the mapping.
+ */
+typedef struct col_file
+{
+	const struct col_hdr *hdr;
+	size_t size;
+	uint64_t nrows;
+
+	const int64_t *timestamp;
+	const int32_t *trading_day;
+	const uint32_t *instrument;
+	const double *open;
+	const double *high;
+	const double *low;
+	const double *close;
+	const int64_t *volume;
+	const int64_t *oi;
+	const double *amount;
+
+	const char (*symbols)[COL_SYMBOL_LEN];
+	const struct col_block *blocks;
+} col_file_t;
+
+int col_open(col_file_t *f, const char *path);
+void col_close(col_file_t *f);
+
+/*
+ * col_range - the rows [*first, *last) whose timestamp is in [from, to];
+ * the footer skips the blocks out of the range. Returns the rows.
+ */
+uint64_t col_range(const col_file_t *f, int64_t from, int64_t to, uint64_t *first, uint64_t *last);
+
+/*
+ * col_day_after - the first row of a trading day after the day; the rows
+ * are ordered by it as they are by timestamp.
+ */
+uint64_t col_day_after(const col_file_t *f, int32_t day);
+
+/*
+ * col_lookup - the code of the symbol in the dict, -1 if not in the file.
+ */
+int64_t col_lookup(const col_file_t *f, const char *symbol);
+
+/*
+ * col_path - <root>/<exchange>/<product>.<bar_type>.jcol
+ */
+int col_path(char *dst, size_t len, const char *root, const char *exchange,
+	     const char *product, int bar_type);
+
+/*
+ * col_row - one bar given to the writer.
+ */
+struct col_row
+{
+	int64_t timestamp;
+	int32_t trading_day;
+	const char *symbol;
+	double open;
+	double high;
+	double low;
+	double close;
+	int64_t volume;
+	int64_t oi;
+	double amount;
+};
+
+typedef struct col_writer col_writer_t;
+
+col_writer_t *col_writer_create(const char *exchange, const char *product, int bar_type);
+void col_writer_free(col_writer_t *w);
+int col_writer_add(col_writer_t *w, const struct col_row *row);
+
+/*
+ * col_writer_add_bar - add a bar of the bar engine.
+ */
+int col_writer_add_bar(col_writer_t *w, const bar_rec_t *bar, const char *symbol);
+
+/*
+ * col_writer_load - add the rows of an existing file, to append to it. A
+ * file of another bar type, or with a row of an instrument not in its dict,
+ * fails.
+ */
+int col_writer_load(col_writer_t *w, const char *path);
+
+/*
+ * col_writer_write - sort the rows by timestamp and instrument, keep the
+ * last of the same (timestamp, instrument) and write the file. The file is
+ * written aside and renamed, so readers mapping the old one are not hurt.
+ */
+int col_writer_write(col_writer_t *w, const char *path);
+
+/*
+ * The segments of a continuous series of a product, each the major contract
+ * from its first trading day on, with the gap and the ratio of its close to
+ * the close of the major before it on that day, and their sum and product
+ * over the segments so far. The file holds struct col_seg_hdr and then the
+ * segments; a roll appends one and changes nothing before it, the adjusted
+ * prices are computed by the readers:
+ *
+ *	forward           raw - cum_gap, the first segment as it is
+ *	forward_ratio     raw / cum_ratio
+ *	backward          raw + last cum_gap - cum_gap, the last as it is
+ *	backward_ratio    raw * last cum_ratio / cum_ratio
+ */
+#define COL_SEG_MAGIC	0x4745534aU	/* "JSEG" */
+#define COL_SEG_VERSION	1
+#define COL_SEG_SUFFIX	".jseg"
+
+struct col_seg_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t nsegments;
+	uint8_t reserved[48];
+};
+
+_Static_assert(sizeof(struct col_seg_hdr) == 64, "col_seg_hdr is part of the file format");
+
+struct col_segment
+{
+	int32_t trading_day;		/* the first day of the segment */
+	uint32_t reserved;
+	double gap;			/* close - close of the major before, 0 first */
+	double ratio;			/* close / close of the major before, 1 first */
+	double cum_gap;
+	double cum_ratio;
+	char symbol[COL_SYMBOL_LEN];
+};
+
+_Static_assert(sizeof(struct col_segment) == 72, "col_segment is part of the file format");
+
+enum col_adjust {
+	COL_ADJ_NONE = 0,
+	COL_ADJ_FORWARD,
+	COL_ADJ_FORWARD_RATIO,
+	COL_ADJ_BACKWARD,
+	COL_ADJ_BACKWARD_RATIO,
+	COL_ADJ_MAX
+};
+
+extern const char *const col_adjust_names[COL_ADJ_MAX];
+
+/*
+ * col_adjust_parse - the method of the name, also the adjust_method names of
+ * continuous_kline.py: difference is forward and ratio forward_ratio.
+ */
+int col_adjust_parse(const char *name);
+
+typedef struct col_seg_file
+{
+	const struct col_seg_hdr *hdr;
+	size_t size;
+	uint64_t nsegments;
+	const struct col_segment *segments;
+} col_seg_file_t;
+
+int col_seg_open(col_seg_file_t *s, const char *path);
+void col_seg_close(col_seg_file_t *s);
+
+/*
+ * col_seg_append - append the segments to the file, creating it; with
+ * truncate the file is written anew, aside and renamed.
+ */
+int col_seg_append(const char *path, const struct col_segment *segs, uint64_t n, int truncate);
+
+/*
+ * col_adjust - the prices of rows bars of the ascending days adjusted by the
+ * method, a multiply and an add over the run of every segment; out may be
+ * px.
+ */
+void col_adjust(const struct col_segment *segs, uint64_t n, int method, const int32_t *day,
+		const double *px, double *out, uint64_t rows);
+
+/*
+ * col_seg_rows - the rows of the file that are the bars of the majors of the
+ * segments, in order; rows has room for f->nrows. Returns the rows.
+ */
+uint64_t col_seg_rows(const col_file_t *f, const struct col_segment *segs, uint64_t n, uint64_t *rows);
+
+#endif		/* __COLSTORE_H__ */
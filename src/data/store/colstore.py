@@ -0,0 +1,187 @@
+"""
+colstore.py
+
+Map the columnar bar files written by colstore.c as numpy arrays, without
+parsing: every column is a read-only view into the mapped file.
+
+    import colstore
+    f = colstore.open_store("store", "shfe", "cu", "day")
+    f.close[f.instrument == f.code("cu2501")]
+    df = f.to_frame()
+
+    seg = colstore.SegFile("major/shfe_cu.jseg")
+    c = f.continuous(seg, "backward")
+    c.close, c.contract
+
+Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+"""
+
+import os
+import numpy as np
+
+COL_MAGIC = 0x4C4F434A
+COL_VERSION = 1
+COL_SUFFIX = ".jcol"
+COL_SEG_MAGIC = 0x4745534A
+COL_SEG_VERSION = 1
+
+COLUMNS = [
+    ("timestamp", np.int64),
+    ("trading_day", np.int32),
+    ("instrument", np.uint32),
+    ("open", np.float64),
+    ("high", np.float64),
+    ("low", np.float64),
+    ("close", np.float64),
+    ("volume", np.int64),
+    ("oi", np.int64),
+    ("amount", np.float64),
+]
+
+HDR = np.dtype([
+    ("magic", "<u4"), ("version", "<u4"), ("bar_type", "<u4"), ("ninstruments", "<u4"),
+    ("exchange", "S16"), ("product", "S16"),
+    ("nrows", "<u8"), ("nblocks", "<u8"), ("block_rows", "<u8"),
+    ("min_ts", "<i8"), ("max_ts", "<i8"), ("file_size", "<u8"),
+    ("col_off", "<u8", (len(COLUMNS),)), ("dict_off", "<u8"), ("footer_off", "<u8"),
+    ("reserved", "u1", (128,)),
+])
+
+BLOCK = np.dtype([("min_ts", "<i8"), ("max_ts", "<i8"), ("first", "<u8"), ("rows", "<u8")])
+
+SEG_HDR = np.dtype([("magic", "<u4"), ("version", "<u4"), ("nsegments", "<u8"), ("reserved", "u1", (48,))])
+
+SEGMENT = np.dtype([
+    ("trading_day", "<i4"), ("reserved", "<u4"),
+    ("gap", "<f8"), ("ratio", "<f8"), ("cum_gap", "<f8"), ("cum_ratio", "<f8"),
+    ("symbol", "S32"),
+])
+
+ADJUST = ("none", "forward", "forward_ratio", "backward", "backward_ratio")
+ADJUST_ALIAS = {"difference": "forward", "ratio": "forward_ratio"}
+
+
+class ColFile:
+    def __init__(self, path):
+        self.path = path
+        self._mm = np.memmap(path, dtype=np.uint8, mode="r")
+        hdr = np.frombuffer(self._mm, dtype=HDR, count=1)[0]
+        if hdr["magic"] != COL_MAGIC or hdr["version"] != COL_VERSION or hdr["file_size"] != len(self._mm):
+            raise ValueError(f"{path} is not a column file of version {COL_VERSION}")
+
+        self.header = hdr
+        self.nrows = int(hdr["nrows"])
+        self.exchange = hdr["exchange"].decode()
+        self.product = hdr["product"].decode()
+        for i, (name, dtype) in enumerate(COLUMNS):
+            col = np.frombuffer(self._mm, dtype=dtype, count=self.nrows, offset=int(hdr["col_off"][i]))
+            setattr(self, name, col)
+
+        self.symbols = np.frombuffer(self._mm, dtype="S32", count=int(hdr["ninstruments"]),
+                                     offset=int(hdr["dict_off"]))
+        self.blocks = np.frombuffer(self._mm, dtype=BLOCK, count=int(hdr["nblocks"]),
+                                    offset=int(hdr["footer_off"]))
+
+    def code(self, symbol):
+        """code of the symbol in the instrument column, -1 if not in the file"""
+        i = np.searchsorted(self.symbols, symbol.encode())
+        return int(i) if i < len(self.symbols) and self.symbols[i] == symbol.encode() else -1
+
+    def range(self, start, end):
+        """rows [first, last) whose timestamp, ns since epoch, is in [start, end]"""
+        b = self.blocks
+        sel = np.nonzero((b["max_ts"] >= start) & (b["min_ts"] <= end))[0]
+        if len(sel) == 0:
+            return 0, 0
+        lo, hi = int(b["first"][sel[0]]), int(b["first"][sel[-1]] + b["rows"][sel[-1]])
+        ts = self.timestamp[lo:hi]
+        return lo + int(np.searchsorted(ts, start, "left")), lo + int(np.searchsorted(ts, end, "right"))
+
+    def continuous(self, seg, adjust="backward"):
+        """the bars of the majors of the segments, adjusted when read"""
+        k = np.searchsorted(seg.segments["trading_day"], self.trading_day, "right") - 1
+        codes = np.array([self.code(s.decode()) for s in seg.segments["symbol"]], dtype=np.int64)
+        mask = k >= 0
+        mask[mask] = self.instrument[mask] == codes[k[mask]]
+        return Continuous(self, seg, np.nonzero(mask)[0], adjust)
+
+    def to_frame(self, first=0, last=None):
+        """the rows as a DataFrame in the layout of the CSV files"""
+        import pandas as pd
+
+        s = slice(first, self.nrows if last is None else last)
+        df = pd.DataFrame({name: getattr(self, name)[s] for name, _ in COLUMNS if name != "instrument"})
+        df.insert(0, "contract", self.symbols.astype(str)[self.instrument[s]])
+        df.insert(1, "datetime", pd.to_datetime(df["timestamp"], utc=True).dt.tz_convert("Asia/Shanghai"))
+        return df.rename(columns={"oi": "open_interest"})
+
+
+class SegFile:
+    """the segments of a continuous series, see colstore.h"""
+
+    def __init__(self, path):
+        self.path = path
+        self._mm = np.memmap(path, dtype=np.uint8, mode="r")
+        hdr = np.frombuffer(self._mm, dtype=SEG_HDR, count=1)[0]
+        n = int(hdr["nsegments"])
+        if hdr["magic"] != COL_SEG_MAGIC or hdr["version"] != COL_SEG_VERSION or \
+                SEG_HDR.itemsize + n * SEGMENT.itemsize > len(self._mm):
+            raise ValueError(f"{path} is not a segment file of version {COL_SEG_VERSION}")
+        self.segments = np.frombuffer(self._mm, dtype=SEGMENT, count=n, offset=SEG_HDR.itemsize)
+
+    def factors(self, trading_day, adjust="backward"):
+        """a and b of every day, the adjusted price is raw * a + b"""
+        adjust = ADJUST_ALIAS.get(adjust, adjust)
+        if adjust not in ADJUST:
+            raise ValueError(f"unknown adjust method {adjust}")
+        seg = self.segments
+        k = np.maximum(np.searchsorted(seg["trading_day"], trading_day, "right") - 1, 0)
+        a, b = np.ones(len(k)), np.zeros(len(k))
+        if len(seg) == 0 or adjust == "none":
+            return a, b
+        if adjust == "forward":
+            b = -seg["cum_gap"][k]
+        elif adjust == "forward_ratio":
+            a = 1 / seg["cum_ratio"][k]
+        elif adjust == "backward":
+            b = seg["cum_gap"][-1] - seg["cum_gap"][k]
+        else:
+            a = seg["cum_ratio"][-1] / seg["cum_ratio"][k]
+        return a, b
+
+
+class Continuous:
+    """the majors of a ColFile by the segments; the raw prices stay in the
+    mapped file and are adjusted on every access"""
+
+    def __init__(self, f, seg, rows, adjust):
+        self.file = f
+        self.rows = rows
+        self.trading_day = f.trading_day[rows]
+        self.a, self.b = seg.factors(self.trading_day, adjust)
+
+    def __len__(self):
+        return len(self.rows)
+
+    def __getattr__(self, name):
+        if name in ("open", "high", "low", "close"):
+            return getattr(self.file, name)[self.rows] * self.a + self.b
+        if name == "contract":
+            return self.file.symbols.astype(str)[self.file.instrument[self.rows]]
+        if name in ("timestamp", "volume", "oi", "amount"):
+            return getattr(self.file, name)[self.rows]
+        raise AttributeError(name)
+
+    def to_frame(self):
+        import pandas as pd
+
+        names = ("timestamp", "trading_day", "contract", "open", "high", "low", "close", "volume", "oi", "amount")
+        return pd.DataFrame({name: getattr(self, name) for name in names})
+
+
+def store_path(root, exchange, product, bar_type):
+    return os.path.join(root, exchange, f"{product}.{bar_type}{COL_SUFFIX}")
+
+
+def open_store(root, exchange, product, bar_type="day"):
+    return ColFile(store_path(root, exchange, product, bar_type))
@@ -0,0 +1,277 @@
+/*
+ * csv2col.c
+ *
+ * The program converts the per-contract CSV files of the clean and merge
+ * scripts into the columnar bar file of their product, so the backtests map
+ * the history instead of parsing it.
+ *
+ *	csv2col -o store -e shfe -p cu -t day cu2501.csv cu2502.csv
+ *
+ * The columns are found by the names of the header line: contract, day or
+ * date, open, high, low, close, volume, open_interest or oi, amount.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include "colstore.h"
+#include "parse.h"
+
+#define FIELDS_MAX	64
+#define LINE_MAX_LEN	4096
+
+enum field {
+	F_CONTRACT = 0,
+	F_DATE,
+	F_TRADING_DAY,
+	F_OPEN,
+	F_HIGH,
+	F_LOW,
+	F_CLOSE,
+	F_VOLUME,
+	F_OI,
+	F_AMOUNT,
+	F_MAX
+};
+
+static const char *const field_names[F_MAX][4] = {
+	[F_CONTRACT] = { "contract", "symbol", "instrument", NULL },
+	[F_DATE] = { "day", "date", "datetime", NULL },
+	[F_TRADING_DAY] = { "trading_day", NULL },
+	[F_OPEN] = { "open", NULL },
+	[F_HIGH] = { "high", NULL },
+	[F_LOW] = { "low", NULL },
+	[F_CLOSE] = { "close", NULL },
+	[F_VOLUME] = { "volume", "vol", NULL },
+	[F_OI] = { "open_interest", "oi", NULL },
+	[F_AMOUNT] = { "amount", "turnover", NULL },
+};
+
+static int
+split(char *line, char **fields)
+{
+	int n = 0;
+	char *p = line;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	while (n < FIELDS_MAX) {
+		fields[n++] = p;
+		if ((p = strchr(p, ',')) == NULL) {
+			break;
+		}
+		*p++ = '\0';
+	}
+
+	return n;
+}
+
+/*
+ * parse_date - YYYYMMDD, YYYY-MM-DD or YYYY/MM/DD with an optional time
+ * HH:MM[:SS]; returns the day and the seconds of the day in *sec, -1 if none.
+ */
+static int64_t
+parse_date(const char *s, int32_t *sec)
+{
+	char digits[9];
+	int n = 0, h = 0, m = 0, x = 0;
+
+	while (isspace((unsigned char)*s)) {
+		s++;
+	}
+	while (*s != '\0' && n < 8) {
+		if (isdigit((unsigned char)*s)) {
+			digits[n++] = *s;
+		} else if (*s != '-' && *s != '/') {
+			break;
+		}
+		s++;
+	}
+	if (n != 8) {
+		return -1;
+	}
+	digits[8] = '\0';
+
+	*sec = -1;
+	if ((*s == ' ' || *s == 'T') && sscanf(s + 1, "%d:%d:%d", &h, &m, &x) >= 2) {
+		*sec = h * 3600 + m * 60 + x;
+	}
+
+	return parse_8digits(digits);
+}
+
+static int
+import(col_writer_t *w, const char *path, int bar_type)
+{
+	char line[LINE_MAX_LEN], *fields[FIELDS_MAX];
+	int map[F_MAX], nf, f, k, i, lineno = 1;
+	uint64_t rows = 0, bad = 0;
+	struct col_row row;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (fgets(line, sizeof(line), fp) == NULL) {
+		fclose(fp);
+		return 0;
+	}
+
+	nf = split(line, fields);
+	for (f = 0; f < F_MAX; f++) {
+		map[f] = -1;
+		for (i = 0; i < nf && map[f] < 0; i++) {
+			for (k = 0; field_names[f][k] != NULL; k++) {
+				if (strcasecmp(fields[i], field_names[f][k]) == 0) {
+					map[f] = i;
+					break;
+				}
+			}
+		}
+	}
+
+	if (map[F_CONTRACT] < 0 || map[F_DATE] < 0 || map[F_CLOSE] < 0) {
+		fprintf(stderr, "%s has no contract, day or close column\n", path);
+		fclose(fp);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		int64_t day;
+		int32_t sec;
+
+		lineno++;
+		nf = split(line, fields);
+		for (f = 0; f < F_MAX; f++) {
+			if (map[f] >= nf) {
+				break;
+			}
+		}
+		if (f < F_MAX || (day = parse_date(fields[map[F_DATE]], &sec)) < 0 ||
+		    fields[map[F_CONTRACT]][0] == '\0') {
+			bad++;
+			continue;
+		}
+
+		/* a daily bar ends with the close of its trading day */
+		if (sec < 0 || bar_type >= BAR_T_DAY) {
+			sec = 15 * 3600;
+		}
+
+		memset(&row, 0, sizeof(row));
+		row.timestamp = (int64_t)cn_timestamp((uint32_t)day, (uint32_t)sec, 0);
+		row.trading_day = map[F_TRADING_DAY] >= 0 ? atoi(fields[map[F_TRADING_DAY]]) : (int32_t)day;
+		row.symbol = fields[map[F_CONTRACT]];
+		row.close = strtod(fields[map[F_CLOSE]], NULL);
+		row.open = map[F_OPEN] >= 0 ? strtod(fields[map[F_OPEN]], NULL) : row.close;
+		row.high = map[F_HIGH] >= 0 ? strtod(fields[map[F_HIGH]], NULL) : row.close;
+		row.low = map[F_LOW] >= 0 ? strtod(fields[map[F_LOW]], NULL) : row.close;
+		row.volume = map[F_VOLUME] >= 0 ? (int64_t)strtod(fields[map[F_VOLUME]], NULL) : 0;
+		row.oi = map[F_OI] >= 0 ? (int64_t)strtod(fields[map[F_OI]], NULL) : 0;
+		row.amount = map[F_AMOUNT] >= 0 ? strtod(fields[map[F_AMOUNT]], NULL) : 0;
+
+		if (col_writer_add(w, &row) != 0) {
+			fclose(fp);
+			return -1;
+		}
+		rows++;
+	}
+	fclose(fp);
+
+	if (bad > 0) {
+		fprintf(stderr, "%s: %lu malformed lines skipped\n", path, bad);
+	}
+
+	return 0;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -o root -e exchange -p product [-t type] [-a] file.csv ...\n"
+		"  -o root      directory of the store\n"
+		"  -e exchange  exchange of the product, e.g. shfe\n"
+		"  -p product   product, e.g. cu\n"
+		"  -t type      bar type of the files (default day)\n"
+		"  -a           append to the existing file instead of replacing it\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *root = NULL, *exchange = NULL, *product = NULL;
+	char path[4096], dir[4096];
+	int bar_type = BAR_T_DAY, append = 0, opt, i;
+	col_writer_t *w;
+
+	while ((opt = getopt(argc, argv, "o:e:p:t:a")) != -1) {
+		switch (opt) {
+		case 'o':
+			root = optarg;
+			break;
+		case 'e':
+			exchange = optarg;
+			break;
+		case 'p':
+			product = optarg;
+			break;
+		case 't':
+			if ((bar_type = bar_type_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown bar type %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'a':
+			append = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || exchange == NULL || product == NULL || optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	snprintf(dir, sizeof(dir), "%s/%s", root, exchange);
+	if ((mkdir(root, 0755) != 0 && errno != EEXIST) || (mkdir(dir, 0755) != 0 && errno != EEXIST) ||
+	    col_path(path, sizeof(path), root, exchange, product, bar_type) != 0) {
+		fprintf(stderr, "cannot make the store directory %s\n", dir);
+		return 1;
+	}
+
+	if ((w = col_writer_create(exchange, product, bar_type)) == NULL) {
+		return 1;
+	}
+
+	if (append && col_writer_load(w, path) != 0) {
+		col_writer_free(w);
+		return 1;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (import(w, argv[i], bar_type) != 0) {
+			col_writer_free(w);
+			return 1;
+		}
+	}
+
+	if (col_writer_write(w, path) != 0) {
+		col_writer_free(w);
+		return 1;
+	}
+	col_writer_free(w);
+
+	return 0;
+}
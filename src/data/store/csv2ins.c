@@ -0,0 +1,263 @@
+/*
+ * csv2ins.c
+ *
+ * The program builds the instrument master from CSV files, the instrument
+ * lists of the exchanges or of CTP, or only the bar files, whose contract
+ * column alone gives the symbol and the product.
+ *
+ *	csv2ins -o instruments.jins -a -e shfe shfe_instruments.csv cu2501.csv
+ *	csv2ins -l instruments.jins
+ *
+ * The columns are found by the names of the header line: contract or symbol,
+ * product, exchange, multiplier, tick_size, expiry. A line of a symbol added
+ * before updates the fields it has, the id stays.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include "instrument.h"
+
+#define FIELDS_MAX	64
+#define LINE_MAX_LEN	4096
+
+enum field {
+	F_SYMBOL = 0,
+	F_PRODUCT,
+	F_EXCHANGE,
+	F_MULTIPLIER,
+	F_TICK_SIZE,
+	F_EXPIRY,
+	F_MAX
+};
+
+static const char *const field_names[F_MAX][5] = {
+	[F_SYMBOL] = { "contract", "symbol", "instrument", "instrumentid", NULL },
+	[F_PRODUCT] = { "product", "productid", NULL },
+	[F_EXCHANGE] = { "exchange", "exchangeid", NULL },
+	[F_MULTIPLIER] = { "multiplier", "volume_multiple", "volumemultiple", NULL },
+	[F_TICK_SIZE] = { "tick_size", "price_tick", "pricetick", NULL },
+	[F_EXPIRY] = { "expiry", "expire_date", "expiredate", "last_trade_date", NULL },
+};
+
+static int
+split(char *line, char **fields)
+{
+	int n = 0;
+	char *p = line;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	while (n < FIELDS_MAX) {
+		fields[n++] = p;
+		if ((p = strchr(p, ',')) == NULL) {
+			break;
+		}
+		*p++ = '\0';
+	}
+
+	return n;
+}
+
+/*
+ * parse_day - YYYYMMDD, YYYY-MM-DD or YYYY/MM/DD, 0 if none.
+ */
+static int32_t
+parse_day(const char *s)
+{
+	int32_t day = 0;
+	int n = 0;
+
+	for (; *s != '\0' && n < 8; s++) {
+		if (isdigit((unsigned char)*s)) {
+			day = day * 10 + (*s - '0');
+			n++;
+		} else if (*s != '-' && *s != '/') {
+			break;
+		}
+	}
+
+	return n == 8 ? day : 0;
+}
+
+static int
+import(ins_builder_t *b, const char *path, int exchange)
+{
+	char line[LINE_MAX_LEN], *fields[FIELDS_MAX];
+	int map[F_MAX], nf, f, k, i;
+	uint64_t bad = 0;
+	struct ins_spec spec;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (fgets(line, sizeof(line), fp) == NULL) {
+		fclose(fp);
+		return 0;
+	}
+
+	nf = split(line, fields);
+	for (f = 0; f < F_MAX; f++) {
+		map[f] = -1;
+		for (i = 0; i < nf && map[f] < 0; i++) {
+			for (k = 0; field_names[f][k] != NULL; k++) {
+				if (strcasecmp(fields[i], field_names[f][k]) == 0) {
+					map[f] = i;
+					break;
+				}
+			}
+		}
+	}
+
+	if (map[F_SYMBOL] < 0) {
+		fprintf(stderr, "%s has no contract column\n", path);
+		fclose(fp);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		nf = split(line, fields);
+		for (f = 0; f < F_MAX; f++) {
+			if (map[f] >= nf) {
+				break;
+			}
+		}
+		if (f < F_MAX || fields[map[F_SYMBOL]][0] == '\0') {
+			bad++;
+			continue;
+		}
+
+		memset(&spec, 0, sizeof(spec));
+		spec.symbol = fields[map[F_SYMBOL]];
+		spec.product = map[F_PRODUCT] >= 0 && fields[map[F_PRODUCT]][0] != '\0' ? fields[map[F_PRODUCT]] : NULL;
+		spec.exchange = map[F_EXCHANGE] >= 0 ? ins_exchange_parse(fields[map[F_EXCHANGE]]) : -1;
+		if (spec.exchange < 0) {
+			spec.exchange = exchange;
+		}
+		spec.multiplier = map[F_MULTIPLIER] >= 0 ? strtod(fields[map[F_MULTIPLIER]], NULL) : 0;
+		spec.tick_size = map[F_TICK_SIZE] >= 0 ? strtod(fields[map[F_TICK_SIZE]], NULL) : 0;
+		spec.expiry = map[F_EXPIRY] >= 0 ? parse_day(fields[map[F_EXPIRY]]) : 0;
+
+		if (ins_builder_add(b, &spec) == 0) {
+			bad++;
+		}
+	}
+	fclose(fp);
+
+	if (bad > 0) {
+		fprintf(stderr, "%s: %lu malformed lines skipped\n", path, bad);
+	}
+
+	return 0;
+}
+
+static int
+list(const char *path)
+{
+	const struct ins_rec *r;
+	ins_table_t t;
+	uint32_t i;
+
+	if (ins_open(&t, path) != 0) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	printf("id,symbol,product,exchange,multiplier,tick_size,expiry\n");
+	for (i = 0; i < t.ninstruments; i++) {
+		r = &t.recs[i];
+		printf("%u,%s,%s,%s,%g,%g,%d\n", r->id, r->symbol, ins_product_name(&t, r->product),
+		       r->exchange < INS_EX_MAX ? ins_exchange_names[r->exchange] : "",
+		       r->multiplier, r->tick_size, r->expiry);
+	}
+	ins_close(&t);
+
+	return 0;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -o master [-a] [-e exchange] file.csv ...\n"
+		"       %s -l master\n"
+		"  -o master    instrument master written, e.g. instruments%s\n"
+		"  -a           add to the existing master, keeping its ids\n"
+		"  -e exchange  exchange of the lines without one, e.g. shfe\n"
+		"  -l master    list the master as CSV\n",
+		prog, prog, INS_SUFFIX);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *path = NULL, *listed = NULL;
+	int exchange = INS_EX_NONE, append = 0, opt, i;
+	ins_builder_t *b;
+
+	while ((opt = getopt(argc, argv, "o:ae:l:")) != -1) {
+		switch (opt) {
+		case 'o':
+			path = optarg;
+			break;
+		case 'a':
+			append = 1;
+			break;
+		case 'e':
+			if ((exchange = ins_exchange_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown exchange %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			listed = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (listed != NULL) {
+		return list(listed) == 0 ? 0 : 1;
+	}
+
+	if (path == NULL || optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((b = ins_builder_create()) == NULL) {
+		return 1;
+	}
+
+	/* a master not there yet is started anew */
+	if (append && ins_builder_load(b, path) < -1) {
+		fprintf(stderr, "cannot load %s\n", path);
+		ins_builder_free(b);
+		return 1;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (import(b, argv[i], exchange) != 0) {
+			ins_builder_free(b);
+			return 1;
+		}
+	}
+
+	if (ins_builder_write(b, path) != 0) {
+		ins_builder_free(b);
+		return 1;
+	}
+	ins_builder_free(b);
+
+	return 0;
+}
@@ -0,0 +1,531 @@
+/*
+ * instrument.c
+ *
+ * The functions are used to build the instrument master and to map it for
+ * the lookups.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "instrument.h"
+
+#define ALIGN_UP(x, a)	(((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+#define HASH_MIN	1024
+
+const char *const ins_exchange_names[INS_EX_MAX] = {
+	[INS_EX_NONE] = "",
+	[INS_EX_SHFE] = "shfe",
+	[INS_EX_INE] = "ine",
+	[INS_EX_DCE] = "dce",
+	[INS_EX_CZCE] = "czce",
+	[INS_EX_CFFEX] = "cffex",
+	[INS_EX_GFEX] = "gfex",
+};
+
+struct ins_builder
+{
+	struct ins_rec *recs;
+	uint32_t nrecs;
+	uint32_t cap;
+	uint32_t *hash;			/* id of the symbol, 0 if empty */
+	uint32_t hash_size;
+
+	struct ins_product products[INS_PRODUCT_MAX];
+	uint32_t nproducts;
+};
+
+int
+ins_exchange_parse(const char *name)
+{
+	int i;
+
+	for (i = INS_EX_NONE + 1; i < INS_EX_MAX; i++) {
+		if (strcasecmp(name, ins_exchange_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+size_t
+ins_product_code(char *dst, size_t len, const char *symbol)
+{
+	size_t n = 0;
+
+	while (isalpha((unsigned char)symbol[n]) && n + 1 < len) {
+		dst[n] = symbol[n];
+		n++;
+	}
+	if (len > 0) {
+		dst[n] = '\0';
+	}
+
+	return n;
+}
+
+int
+ins_open(ins_table_t *t, const char *path)
+{
+	const struct ins_hdr *hdr;
+	const uint8_t *base;
+	struct stat st;
+	uint32_t i;
+	void *p;
+	int fd;
+
+	memset(t, 0, sizeof(*t));
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct ins_hdr)) {
+		close(fd);
+		return -2;
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return -2;
+	}
+
+	base = p;
+	hdr = p;
+	if (hdr->magic != INS_MAGIC || hdr->version != INS_VERSION ||
+	    hdr->file_size != (uint64_t)st.st_size) {
+		fprintf(stderr, "%s is not an instrument master of version %d\n", path, INS_VERSION);
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	/* every section must lie in the file, every id in its table */
+	if (hdr->rec_off + (uint64_t)hdr->ninstruments * sizeof(struct ins_rec) > hdr->file_size ||
+	    hdr->index_off + (uint64_t)hdr->ninstruments * sizeof(uint32_t) > hdr->file_size ||
+	    hdr->product_off + (uint64_t)hdr->nproducts * sizeof(struct ins_product) > hdr->file_size ||
+	    hdr->product_index_off + (uint64_t)hdr->nproducts * sizeof(uint32_t) > hdr->file_size ||
+	    hdr->rec_off % INS_ALIGN != 0 || hdr->index_off % INS_ALIGN != 0 ||
+	    hdr->product_off % INS_ALIGN != 0 || hdr->product_index_off % INS_ALIGN != 0) {
+		munmap(p, (size_t)st.st_size);
+		return -3;
+	}
+
+	t->hdr = hdr;
+	t->size = (size_t)st.st_size;
+	t->ninstruments = hdr->ninstruments;
+	t->nproducts = hdr->nproducts;
+	t->recs = (const struct ins_rec *)(base + hdr->rec_off);
+	t->index = (const uint32_t *)(base + hdr->index_off);
+	t->products = (const struct ins_product *)(base + hdr->product_off);
+	t->product_index = (const uint32_t *)(base + hdr->product_index_off);
+
+	for (i = 0; i < t->ninstruments; i++) {
+		if (t->index[i] - 1 >= t->ninstruments || t->recs[i].product > t->nproducts) {
+			ins_close(t);
+			return -3;
+		}
+	}
+	for (i = 0; i < t->nproducts; i++) {
+		if (t->product_index[i] - 1 >= t->nproducts) {
+			ins_close(t);
+			return -3;
+		}
+	}
+
+	return 0;
+}
+
+void
+ins_close(ins_table_t *t)
+{
+	if (t->hdr != NULL) {
+		munmap((void *)t->hdr, t->size);
+	}
+	memset(t, 0, sizeof(*t));
+}
+
+uint32_t
+ins_lookup(const ins_table_t *t, const char *symbol)
+{
+	uint32_t lo = 0, hi = t->ninstruments;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2, id = t->index[mid];
+		int c = strncmp(t->recs[id - 1].symbol, symbol, INS_SYMBOL_LEN);
+
+		if (c == 0) {
+			return id;
+		}
+		if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return 0;
+}
+
+uint32_t
+ins_product_lookup(const ins_table_t *t, const char *product)
+{
+	uint32_t lo = 0, hi = t->nproducts;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2, id = t->product_index[mid];
+		int c = strncmp(t->products[id - 1].product, product, INS_PRODUCT_LEN);
+
+		if (c == 0) {
+			return id;
+		}
+		if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return 0;
+}
+
+ins_builder_t *
+ins_builder_create(void)
+{
+	return calloc(1, sizeof(struct ins_builder));
+}
+
+void
+ins_builder_free(ins_builder_t *b)
+{
+	if (b == NULL) {
+		return;
+	}
+
+	free(b->recs);
+	free(b->hash);
+	free(b);
+}
+
+static uint32_t
+hash_symbol(const char *s)
+{
+	uint32_t h = 2166136261U;
+
+	while (*s != '\0') {
+		h ^= (uint8_t)*s++;
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static int
+grow(ins_builder_t *b)
+{
+	uint32_t size = b->hash_size ? b->hash_size * 2 : HASH_MIN, i, j;
+	uint32_t *hash;
+	void *p;
+
+	if ((p = realloc(b->recs, (size_t)(size / 2) * sizeof(*b->recs))) == NULL) {
+		return -1;
+	}
+	b->recs = p;
+	b->cap = size / 2;
+
+	if ((hash = calloc(size, sizeof(*hash))) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < b->nrecs; i++) {
+		j = hash_symbol(b->recs[i].symbol) & (size - 1);
+		while (hash[j] != 0) {
+			j = (j + 1) & (size - 1);
+		}
+		hash[j] = i + 1;
+	}
+
+	free(b->hash);
+	b->hash = hash;
+	b->hash_size = size;
+
+	return 0;
+}
+
+/*
+ * product_id - the id of the product, added if new; there are a few hundred
+ * products and it is only asked for a new instrument.
+ */
+static uint16_t
+product_id(ins_builder_t *b, const char *product, int exchange)
+{
+	struct ins_product *p;
+	uint32_t i;
+
+	if (product[0] == '\0') {
+		return 0;
+	}
+
+	for (i = 0; i < b->nproducts; i++) {
+		if (strncmp(b->products[i].product, product, INS_PRODUCT_LEN) == 0) {
+			if (b->products[i].exchange == INS_EX_NONE) {
+				b->products[i].exchange = (uint8_t)exchange;
+			}
+			return (uint16_t)(i + 1);
+		}
+	}
+
+	if (b->nproducts >= INS_PRODUCT_MAX) {
+		return 0;
+	}
+
+	p = &b->products[b->nproducts++];
+	memset(p, 0, sizeof(*p));
+	snprintf(p->product, sizeof(p->product), "%s", product);
+	p->id = (uint16_t)b->nproducts;
+	p->exchange = (uint8_t)exchange;
+
+	return p->id;
+}
+
+uint32_t
+ins_builder_add(ins_builder_t *b, const struct ins_spec *spec)
+{
+	char product[INS_PRODUCT_LEN];
+	struct ins_rec *r;
+	uint32_t i, id;
+	int exchange = spec->exchange > INS_EX_NONE && spec->exchange < INS_EX_MAX ? spec->exchange : INS_EX_NONE;
+
+	if (spec->symbol == NULL || spec->symbol[0] == '\0' || strlen(spec->symbol) >= INS_SYMBOL_LEN) {
+		return 0;
+	}
+
+	if (b->nrecs >= b->cap && grow(b) != 0) {
+		return 0;
+	}
+
+	i = hash_symbol(spec->symbol) & (b->hash_size - 1);
+	while ((id = b->hash[i]) != 0) {
+		if (strcmp(b->recs[id - 1].symbol, spec->symbol) == 0) {
+			break;
+		}
+		i = (i + 1) & (b->hash_size - 1);
+	}
+
+	if (id == 0) {
+		if (spec->product != NULL) {
+			snprintf(product, sizeof(product), "%s", spec->product);
+		} else {
+			ins_product_code(product, sizeof(product), spec->symbol);
+		}
+
+		r = &b->recs[b->nrecs];
+		memset(r, 0, sizeof(*r));
+		strcpy(r->symbol, spec->symbol);
+		r->id = id = ++b->nrecs;
+		r->product = product_id(b, product, exchange);
+		b->hash[i] = id;
+	}
+
+	/* the fields known now replace those of before, an exchange stays */
+	r = &b->recs[id - 1];
+	if (exchange != INS_EX_NONE && r->exchange == INS_EX_NONE) {
+		r->exchange = (uint8_t)exchange;
+		if (r->product != 0 && b->products[r->product - 1].exchange == INS_EX_NONE) {
+			b->products[r->product - 1].exchange = (uint8_t)exchange;
+		}
+	}
+	if (spec->multiplier > 0) {
+		r->multiplier = spec->multiplier;
+	}
+	if (spec->tick_size > 0) {
+		r->tick_size = spec->tick_size;
+	}
+	if (spec->expiry > 0) {
+		r->expiry = spec->expiry;
+	}
+
+	return id;
+}
+
+int
+ins_builder_load(ins_builder_t *b, const char *path)
+{
+	const struct ins_rec *r;
+	ins_table_t t;
+	uint32_t i;
+	int ret;
+
+	if (b->nrecs != 0 || b->nproducts != 0) {
+		return -1;
+	}
+
+	if ((ret = ins_open(&t, path)) != 0) {
+		return ret;
+	}
+
+	/* the products first, so the adds find them with their ids */
+	memcpy(b->products, t.products, (size_t)t.nproducts * sizeof(*t.products));
+	b->nproducts = t.nproducts;
+
+	for (i = 0; i < t.ninstruments; i++) {
+		r = &t.recs[i];
+		struct ins_spec spec = {
+			.symbol = r->symbol,
+			.product = ins_product_name(&t, r->product),
+			.exchange = r->exchange,
+			.multiplier = r->multiplier,
+			.tick_size = r->tick_size,
+			.expiry = r->expiry,
+		};
+
+		if (ins_builder_add(b, &spec) != i + 1) {
+			ins_close(&t);
+			return -3;
+		}
+	}
+
+	ins_close(&t);
+
+	return 0;
+}
+
+static int
+cmp_symbol(const void *a, const void *b, void *arg)
+{
+	const struct ins_rec *recs = arg;
+
+	return strcmp(recs[*(const uint32_t *)a - 1].symbol, recs[*(const uint32_t *)b - 1].symbol);
+}
+
+static int
+cmp_product(const void *a, const void *b, void *arg)
+{
+	const struct ins_product *products = arg;
+
+	return strncmp(products[*(const uint32_t *)a - 1].product, products[*(const uint32_t *)b - 1].product,
+		       INS_PRODUCT_LEN);
+}
+
+static int
+write_pad(FILE *fp, uint64_t *off)
+{
+	static const uint8_t zero[INS_ALIGN];
+	uint64_t pad = ALIGN_UP(*off, INS_ALIGN) - *off;
+
+	if (pad > 0 && fwrite(zero, 1, pad, fp) != pad) {
+		return -1;
+	}
+	*off += pad;
+
+	return 0;
+}
+
+int
+ins_builder_write(ins_builder_t *b, const char *path)
+{
+	uint32_t *index = NULL, *pindex = NULL, i;
+	struct ins_hdr hdr;
+	char tmp[4096];
+	FILE *fp = NULL;
+	uint64_t off;
+	int ret = -2;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid()) >= (int)sizeof(tmp)) {
+		return -1;
+	}
+
+	index = malloc((b->nrecs ? b->nrecs : 1) * sizeof(*index));
+	pindex = malloc((b->nproducts ? b->nproducts : 1) * sizeof(*pindex));
+	if (index == NULL || pindex == NULL) {
+		goto out;
+	}
+
+	for (i = 0; i < b->nrecs; i++) {
+		index[i] = i + 1;
+	}
+	qsort_r(index, b->nrecs, sizeof(*index), cmp_symbol, b->recs);
+	for (i = 0; i < b->nproducts; i++) {
+		pindex[i] = i + 1;
+	}
+	qsort_r(pindex, b->nproducts, sizeof(*pindex), cmp_product, b->products);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = INS_MAGIC;
+	hdr.version = INS_VERSION;
+	hdr.ninstruments = b->nrecs;
+	hdr.nproducts = b->nproducts;
+	hdr.rec_off = off = ALIGN_UP(sizeof(hdr), INS_ALIGN);
+	off = ALIGN_UP(off + (uint64_t)b->nrecs * sizeof(struct ins_rec), INS_ALIGN);
+	hdr.index_off = off;
+	off = ALIGN_UP(off + (uint64_t)b->nrecs * sizeof(uint32_t), INS_ALIGN);
+	hdr.product_off = off;
+	off = ALIGN_UP(off + (uint64_t)b->nproducts * sizeof(struct ins_product), INS_ALIGN);
+	hdr.product_index_off = off;
+	hdr.file_size = off + (uint64_t)b->nproducts * sizeof(uint32_t);
+
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		fprintf(stderr, "cannot create %s: %s\n", tmp, strerror(errno));
+		goto out;
+	}
+
+	off = 0;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+		goto out;
+	}
+	off += sizeof(hdr);
+
+	if (write_pad(fp, &off) != 0 || fwrite(b->recs, sizeof(*b->recs), b->nrecs, fp) != b->nrecs) {
+		goto out;
+	}
+	off += (uint64_t)b->nrecs * sizeof(*b->recs);
+
+	if (write_pad(fp, &off) != 0 || fwrite(index, sizeof(*index), b->nrecs, fp) != b->nrecs) {
+		goto out;
+	}
+	off += (uint64_t)b->nrecs * sizeof(*index);
+
+	if (write_pad(fp, &off) != 0 ||
+	    fwrite(b->products, sizeof(*b->products), b->nproducts, fp) != b->nproducts) {
+		goto out;
+	}
+	off += (uint64_t)b->nproducts * sizeof(*b->products);
+
+	if (write_pad(fp, &off) != 0 || fwrite(pindex, sizeof(*pindex), b->nproducts, fp) != b->nproducts ||
+	    fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+		goto out;
+	}
+
+	if (fclose(fp) != 0) {
+		fp = NULL;
+		goto out;
+	}
+	fp = NULL;
+
+	if (rename(tmp, path) != 0) {
+		fprintf(stderr, "cannot rename %s to %s: %s\n", tmp, path, strerror(errno));
+		goto out;
+	}
+	ret = 0;
+
+out:
+	if (fp != NULL) {
+		fclose(fp);
+	}
+	if (ret != 0) {
+		unlink(tmp);
+	}
+	free(pindex);
+	free(index);
+
+	return ret;
+}
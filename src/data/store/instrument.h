@@ -0,0 +1,192 @@
+/*
+ * instrument.h
+ *
+ * The file contains the definition of the instrument master and the
+ * functions' prototype for building and mapping it.
+ *
+ * The master maps the symbol of every instrument to a dense id from 1 and
+ * holds what the symbol alone does not tell: the product, the exchange, the
+ * multiplier, the tick size and the expiry. The product is parsed from the
+ * symbol once, when the instrument is first added; the readers look it up
+ * by id. Ids never change, a rebuild keeps the ids of the file it loads and
+ * gives the new instruments the next ones, so ids kept elsewhere stay valid.
+ *
+ *	header         struct ins_hdr, the offsets of everything below
+ *	instruments    struct ins_rec in id order, the id of the n-th is n + 1
+ *	index          uint32_t ids of the instruments sorted by symbol
+ *	products       struct ins_product in id order
+ *	product index  uint32_t ids of the products sorted by name
+ *
+ * The lookups are binary searches on the index, so the file is mapped and
+ * used in place, from C or as numpy arrays (instrument.py).
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define INS_MAGIC	0x534e494aU	/* "JINS" */
+#define INS_VERSION	1
+#define INS_ALIGN	64
+#define INS_SYMBOL_LEN	32
+#define INS_PRODUCT_LEN	8
+#define INS_PRODUCT_MAX	65535
+#define INS_SUFFIX	".jins"
+
+enum ins_exchange {
+	INS_EX_NONE = 0,
+	INS_EX_SHFE,
+	INS_EX_INE,
+	INS_EX_DCE,
+	INS_EX_CZCE,
+	INS_EX_CFFEX,
+	INS_EX_GFEX,
+	INS_EX_MAX
+};
+
+extern const char *const ins_exchange_names[INS_EX_MAX];
+
+struct ins_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ninstruments;
+	uint32_t nproducts;
+	uint64_t file_size;
+	uint64_t rec_off;
+	uint64_t index_off;
+	uint64_t product_off;
+	uint64_t product_index_off;
+	uint8_t reserved[8];
+};
+
+_Static_assert(sizeof(struct ins_hdr) == 64, "ins_hdr is part of the file format");
+
+struct ins_rec
+{
+	char symbol[INS_SYMBOL_LEN];
+	uint32_t id;
+	uint16_t product;		/* id of the product, 0 if none */
+	uint8_t exchange;		/* enum ins_exchange */
+	uint8_t reserved;
+	double multiplier;		/* notional of a price unit of a lot, 0 unknown */
+	double tick_size;		/* 0 unknown */
+	int32_t expiry;			/* last trading day, YYYYMMDD, 0 unknown */
+	uint32_t reserved2;
+};
+
+_Static_assert(sizeof(struct ins_rec) == 64, "ins_rec is part of the file format");
+
+struct ins_product
+{
+	char product[INS_PRODUCT_LEN];
+	uint16_t id;
+	uint8_t exchange;
+	uint8_t reserved[5];
+};
+
+_Static_assert(sizeof(struct ins_product) == 16, "ins_product is part of the file format");
+
+/*
+ * ins_table - a mapped master; the arrays point into the mapping.
+ */
+typedef struct ins_table
+{
+	const struct ins_hdr *hdr;
+	size_t size;
+	uint32_t ninstruments;
+	uint32_t nproducts;
+
+	const struct ins_rec *recs;
+	const uint32_t *index;
+	const struct ins_product *products;
+	const uint32_t *product_index;
+} ins_table_t;
+
+int ins_open(ins_table_t *t, const char *path);
+void ins_close(ins_table_t *t);
+
+/*
+ * ins_lookup - the id of the symbol, 0 if not in the master.
+ */
+uint32_t ins_lookup(const ins_table_t *t, const char *symbol);
+
+/*
+ * ins_get - the instrument of the id, NULL if none.
+ */
+static inline const struct ins_rec *
+ins_get(const ins_table_t *t, uint32_t id)
+{
+	return id - 1 < t->ninstruments ? &t->recs[id - 1] : NULL;
+}
+
+/*
+ * ins_product_lookup - the id of the product, 0 if not in the master.
+ */
+uint32_t ins_product_lookup(const ins_table_t *t, const char *product);
+
+/*
+ * ins_product_name - the name of the product of the id, "" if none.
+ */
+static inline const char *
+ins_product_name(const ins_table_t *t, uint32_t id)
+{
+	return id - 1 < t->nproducts ? t->products[id - 1].product : "";
+}
+
+/*
+ * ins_product_code - the product code of a symbol, its leading letters, e.g.
+ * cu of cu2505 and SR of SR505C6000. Returns the length, 0 if none.
+ */
+size_t ins_product_code(char *dst, size_t len, const char *symbol);
+
+/*
+ * ins_exchange_parse - the enum ins_exchange of a name, in any case, -1 if
+ * unknown.
+ */
+int ins_exchange_parse(const char *name);
+
+/*
+ * ins_spec - an instrument given to the builder; a NULL product is parsed
+ * from the symbol, zero fields are unknown.
+ */
+struct ins_spec
+{
+	const char *symbol;
+	const char *product;
+	int exchange;
+	double multiplier;
+	double tick_size;
+	int32_t expiry;
+};
+
+typedef struct ins_builder ins_builder_t;
+
+ins_builder_t *ins_builder_create(void);
+void ins_builder_free(ins_builder_t *b);
+
+/*
+ * ins_builder_load - add the instruments of an existing master with their
+ * ids; call it before adding any other.
+ */
+int ins_builder_load(ins_builder_t *b, const char *path);
+
+/*
+ * ins_builder_add - add an instrument, or update the known fields of one
+ * added before, whose id, product and exchange stay. Returns the id, 0 on
+ * error.
+ */
+uint32_t ins_builder_add(ins_builder_t *b, const struct ins_spec *spec);
+
+/*
+ * ins_builder_write - write the master, aside and renamed, so readers
+ * mapping the old one are not hurt.
+ */
+int ins_builder_write(ins_builder_t *b, const char *path);
+
+#endif		/* __INSTRUMENT_H__ */
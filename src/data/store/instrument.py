@@ -0,0 +1,120 @@
+"""
+instrument.py
+
+Map the instrument master written by csv2ins as numpy arrays, so the scripts
+look the product of a contract up instead of parsing it with a regex.
+
+    import instrument
+    ins = instrument.load("instruments.jins")
+    df["instrument"] = ins.id(df["contract"])
+    df["product"] = ins.product(df["contract"])
+    df["multiplier"] = ins.field(df["contract"], "multiplier")
+
+instrument.products() works without a master too, from the leading letters
+of the symbols, the rule csv2ins parses the product with.
+
+Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+"""
+
+import os
+import re
+import numpy as np
+
+INS_MAGIC = 0x534E494A
+INS_VERSION = 1
+INS_SUFFIX = ".jins"
+INS_ENV = "JUPITER_INSTRUMENTS"
+
+EXCHANGES = ("", "shfe", "ine", "dce", "czce", "cffex", "gfex")
+
+HDR = np.dtype([
+    ("magic", "<u4"), ("version", "<u4"), ("ninstruments", "<u4"), ("nproducts", "<u4"),
+    ("file_size", "<u8"), ("rec_off", "<u8"), ("index_off", "<u8"),
+    ("product_off", "<u8"), ("product_index_off", "<u8"), ("reserved", "u1", (8,)),
+])
+
+REC = np.dtype([
+    ("symbol", "S32"), ("id", "<u4"), ("product", "<u2"), ("exchange", "u1"), ("reserved", "u1"),
+    ("multiplier", "<f8"), ("tick_size", "<f8"), ("expiry", "<i4"), ("reserved2", "<u4"),
+])
+
+PRODUCT = np.dtype([("product", "S8"), ("id", "<u2"), ("exchange", "u1"), ("reserved", "u1", (5,))])
+
+_PRODUCT_RE = re.compile(r"^[A-Za-z]+")
+
+
+class Instruments:
+    def __init__(self, path):
+        self.path = path
+        self._mm = np.memmap(path, dtype=np.uint8, mode="r")
+        hdr = np.frombuffer(self._mm, dtype=HDR, count=1)[0]
+        if hdr["magic"] != INS_MAGIC or hdr["version"] != INS_VERSION or hdr["file_size"] != len(self._mm):
+            raise ValueError(f"{path} is not an instrument master of version {INS_VERSION}")
+
+        n, m = int(hdr["ninstruments"]), int(hdr["nproducts"])
+        self.header = hdr
+        self.records = np.frombuffer(self._mm, dtype=REC, count=n, offset=int(hdr["rec_off"]))
+        self.index = np.frombuffer(self._mm, dtype="<u4", count=n, offset=int(hdr["index_off"]))
+        self.products = np.frombuffer(self._mm, dtype=PRODUCT, count=m, offset=int(hdr["product_off"]))
+        self._sorted = self.records["symbol"][self.index - 1]
+        # the name of product id k at k, "" at 0
+        self._names = np.concatenate([[""], self.products["product"].astype(str)]).astype(object)
+
+    def __len__(self):
+        return len(self.records)
+
+    def id(self, symbols):
+        """ids of the symbols, 0 for those not in the master"""
+        s = np.asarray(symbols, dtype=str).astype("S32").reshape(-1)
+        if len(self._sorted) == 0:
+            return np.zeros(len(s), dtype=np.uint32)
+        i = np.minimum(np.searchsorted(self._sorted, s), len(self._sorted) - 1)
+        return np.where(self._sorted[i] == s, self.index[i], 0).astype(np.uint32)
+
+    def field(self, symbols, name):
+        """a field of the records of the symbols, 0 for those not in the master"""
+        ids = self.id(symbols)
+        if len(self.records) == 0:
+            return np.zeros(len(ids), dtype=REC[name])
+        return np.where(ids > 0, self.records[name][np.maximum(ids.astype(np.int64) - 1, 0)], 0)
+
+    def product_id(self, symbols):
+        """product ids of the symbols, 0 for those not in the master"""
+        return self.field(symbols, "product")
+
+    def product(self, symbols):
+        """product codes of the symbols, "" for those not in the master"""
+        return self._names[self.product_id(symbols)]
+
+    def exchange(self, symbols):
+        return np.array(EXCHANGES, dtype=object)[self.field(symbols, "exchange")]
+
+    def lookup_product(self, product):
+        """id of the product, 0 if not in the master"""
+        hit = np.nonzero(self.products["product"] == product.encode())[0]
+        return int(hit[0]) + 1 if len(hit) else 0
+
+
+def load(path=None):
+    """the master of the path, or of $JUPITER_INSTRUMENTS; None if there is none"""
+    path = path or os.environ.get(INS_ENV)
+    if not path or not os.path.exists(path):
+        return None
+    return Instruments(path)
+
+
+def product_code(symbol):
+    """product code of one symbol by its leading letters, None if it has none"""
+    m = _PRODUCT_RE.match(symbol)
+    return m.group(0) if m else None
+
+
+def products(symbols, master=None):
+    """product codes of the symbols, from the master where it has them and
+    from the leading letters of the rest, None if neither; every distinct
+    symbol is resolved once"""
+    uniq, inverse = np.unique(np.asarray(symbols, dtype=str).reshape(-1), return_inverse=True)
+    out = master.product(uniq) if master is not None else np.full(len(uniq), "", dtype=object)
+    for k in np.nonzero(out == "")[0]:
+        out[k] = product_code(uniq[k])
+    return out[inverse]
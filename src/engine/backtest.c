@@ -0,0 +1,185 @@
+/*
+ * backtest.c
+ *
+ * The program runs the cross-sectional strategy over the bars of the column
+ * store and writes the daily pnl as CSV, the signals optionally.
+ *
+ *	backtest -r store -t day -s 0.1 -n 5 -v 1000 -o 500 -a 100000 > pnl.csv
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "engine.h"
+#include "colstore.h"
+
+static double
+elapsed(const struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static int
+write_signals(const char *path, const eng_panel_t *p, const struct eng_result *r)
+{
+	size_t i, n = r->nsignals < r->signals_cap ? r->nsignals : r->signals_cap;
+	FILE *fp;
+
+	if ((fp = fopen(path, "w")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	fprintf(fp, "date,exchange,product,position,return,price,quantity,close_date\n");
+	for (i = 0; i < n; i++) {
+		const struct eng_signal *s = &r->signals[i];
+
+		fprintf(fp, "%d,%s,%s,%s,%.6f,%.4f,%.0f,%d\n",
+			p->trading_day[s->date], p->exchange[s->product], p->product[s->product],
+			s->direction == ENG_LONG ? "long" : "short", s->ret, s->price, s->quantity,
+			p->trading_day[s->close_date]);
+	}
+
+	return fclose(fp);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root [-e exchanges] [-p products] [-t type] [-s strength_pct]\n"
+		"       [-n ref_days] [-v vol_threshold] [-o oi_threshold] [-a trade_amount]\n"
+		"       [-H hold_days] [-f fee_rate] [-S signals.csv]\n"
+		"  -r root      root directory of the column store\n"
+		"  -e, -p       comma separated exchanges and products, all by default\n"
+		"  -t type      bar type of the files, day by default\n"
+		"  -S file      write the signals to the file\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct eng_params par = { 0.1, 5, 1000, 500, 100000, ENG_HOLD_DAYS, 0 };
+	const char *root = NULL, *exchanges = NULL, *products = NULL, *signals = NULL;
+	struct eng_result r;
+	struct timespec t0;
+	eng_panel_t *p;
+	eng_work_t *w;
+	double cum = 0, load;
+	int type = BAR_T_DAY, opt, rc = 1;
+	uint32_t d;
+
+	while ((opt = getopt(argc, argv, "r:e:p:t:s:n:v:o:a:H:f:S:")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'e':
+			exchanges = optarg;
+			break;
+		case 'p':
+			products = optarg;
+			break;
+		case 't':
+			if ((type = bar_type_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown bar type %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 's':
+			par.strength_pct = atof(optarg);
+			break;
+		case 'n':
+			par.ref_days = atoi(optarg);
+			break;
+		case 'v':
+			par.vol_threshold = atof(optarg);
+			break;
+		case 'o':
+			par.oi_threshold = atof(optarg);
+			break;
+		case 'a':
+			par.trade_amount = atof(optarg);
+			break;
+		case 'H':
+			par.hold_days = atoi(optarg);
+			break;
+		case 'f':
+			par.fee_rate = atof(optarg);
+			break;
+		case 'S':
+			signals = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || par.ref_days <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if ((p = eng_panel_load(root, type, exchanges, products)) == NULL) {
+		return 1;
+	}
+	load = elapsed(&t0);
+
+	memset(&r, 0, sizeof(r));
+	r.pnl = malloc(p->ndates * sizeof(*r.pnl));
+	r.fee = malloc(p->ndates * sizeof(*r.fee));
+	r.nlong = malloc(p->ndates * sizeof(*r.nlong));
+	r.nshort = malloc(p->ndates * sizeof(*r.nshort));
+	if (signals != NULL) {
+		r.signals_cap = (size_t)p->ndates * p->nproducts * 2;
+		r.signals = malloc(r.signals_cap * sizeof(*r.signals));
+	}
+	w = eng_work_create(p);
+
+	if (r.pnl == NULL || r.fee == NULL || r.nlong == NULL || r.nshort == NULL || w == NULL ||
+	    (signals != NULL && r.signals == NULL)) {
+		fprintf(stderr, "out of memory\n");
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (eng_run(p, &par, w, &r) != 0) {
+		fprintf(stderr, "cannot run the backtest\n");
+		goto out;
+	}
+
+	fprintf(stderr, "%u dates x %u products loaded in %.3fs, run in %.3fs\n",
+		p->ndates, p->nproducts, load, elapsed(&t0));
+	fprintf(stderr, "signals %zu pnl %.2f fee %.2f max_drawdown %.2f sharpe %.3f win_rate %.3f\n",
+		r.nsignals, r.total_pnl, r.total_fee, r.max_drawdown, r.sharpe, r.win_rate);
+
+	printf("date,pnl,fee,cum_pnl,long,short\n");
+	for (d = 0; d < p->ndates; d++) {
+		cum += r.pnl[d];
+		printf("%d,%.2f,%.2f,%.2f,%d,%d\n", p->trading_day[d], r.pnl[d], r.fee[d], cum,
+		       r.nlong[d], r.nshort[d]);
+	}
+
+	rc = signals != NULL && write_signals(signals, p, &r) != 0;
+
+out:
+	eng_work_free(w);
+	free(r.pnl);
+	free(r.fee);
+	free(r.nlong);
+	free(r.nshort);
+	free(r.signals);
+	eng_panel_free(p);
+
+	return rc;
+}
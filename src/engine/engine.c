@@ -0,0 +1,379 @@
+/*
+ * engine.c
+ *
+ * The functions are used to run the cross-sectional strategy over a panel
+ * in one pass of its dates: the returns of the date are filtered and the
+ * lowest and the highest selected by rank.c, the positions opened at the
+ * close, and the positions held are marked to the close and closed
+ * hold_days dates later, as cross-sectional.py and match_signals.py do
+ * with DataFrames.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "engine.h"
+#include "rank.h"
+
+#define TRADING_DAYS	252
+
+/*
+ * position - an open position; the positions opened on a date are closed
+ * on the same date, so they live in a ring of hold_days + 1 dates.
+ */
+struct position
+{
+	uint32_t date;
+	uint32_t product;
+	int32_t direction;
+	double price;
+	double quantity;
+};
+
+struct eng_work
+{
+	uint32_t ndates;
+	uint32_t nproducts;
+	double *ret;			/* [date * nproducts + product], for eng_run() */
+	double *quantity;		/* [product], net lots held */
+	double *mark;			/* [product], last close */
+	double *prev;			/* [product], close the pnl was marked to */
+	xs_rank_t *rank;
+	uint64_t *mask;			/* [words], products passing the thresholds */
+	uint64_t *oi_mask;
+	uint32_t *lo;			/* [product], the lowest selected */
+	uint32_t *hi;
+
+	struct position *ring;		/* [(hold + 1) * 2 * nproducts] */
+	uint32_t *nring;		/* [hold + 1], positions opened on the date */
+	int hold;
+};
+
+eng_work_t *
+eng_work_create(const eng_panel_t *p)
+{
+	size_t np = p->nproducts ? p->nproducts : 1;
+	eng_work_t *w;
+
+	if ((w = calloc(1, sizeof(*w))) == NULL) {
+		return NULL;
+	}
+
+	w->ndates = p->ndates;
+	w->nproducts = p->nproducts;
+	w->quantity = malloc(np * sizeof(*w->quantity));
+	w->mark = malloc(np * sizeof(*w->mark));
+	w->prev = malloc(np * sizeof(*w->prev));
+	w->rank = xs_rank_create(p->nproducts);
+	w->mask = malloc(XS_WORDS(np) * sizeof(*w->mask));
+	w->oi_mask = malloc(XS_WORDS(np) * sizeof(*w->oi_mask));
+	w->lo = malloc(np * sizeof(*w->lo));
+	w->hi = malloc(np * sizeof(*w->hi));
+	if (w->quantity == NULL || w->mark == NULL || w->prev == NULL || w->rank == NULL ||
+	    w->mask == NULL || w->oi_mask == NULL || w->lo == NULL || w->hi == NULL) {
+		eng_work_free(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+void
+eng_work_free(eng_work_t *w)
+{
+	if (w == NULL) {
+		return;
+	}
+
+	free(w->ret);
+	free(w->quantity);
+	free(w->mark);
+	free(w->prev);
+	xs_rank_free(w->rank);
+	free(w->mask);
+	free(w->oi_mask);
+	free(w->lo);
+	free(w->hi);
+	free(w->ring);
+	free(w->nring);
+	free(w);
+}
+
+static int
+reserve_ring(eng_work_t *w, int hold)
+{
+	struct position *ring;
+	uint32_t *nring;
+
+	if (hold <= w->hold && w->ring != NULL) {
+		return 0;
+	}
+
+	ring = realloc(w->ring, (size_t)(hold + 1) * 2 * (w->nproducts ? w->nproducts : 1) * sizeof(*ring));
+	if (ring == NULL) {
+		return -1;
+	}
+	w->ring = ring;
+
+	if ((nring = realloc(w->nring, (size_t)(hold + 1) * sizeof(*nring))) == NULL) {
+		return -1;
+	}
+	w->nring = nring;
+	w->hold = hold;
+
+	return 0;
+}
+
+int
+eng_returns(const eng_panel_t *p, int ref_days, double *ret)
+{
+	uint32_t *rows, d, i, n;
+
+	if (ref_days <= 0) {
+		return -1;
+	}
+	if ((rows = malloc((p->ndates ? p->ndates : 1) * sizeof(*rows))) == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < p->nproducts; i++) {
+		/* the dates of the product's bars, as groupby('product').shift() sees them */
+		for (d = 0, n = 0; d < p->ndates; d++) {
+			size_t at = ENG_AT(p, d, i);
+			double close = p->close[at];
+
+			ret[at] = NAN;
+			if (isnan(close)) {
+				continue;
+			}
+			if (n >= (uint32_t)ref_days) {
+				ret[at] = close / p->close[ENG_AT(p, rows[n - ref_days], i)] - 1;
+			}
+			rows[n++] = d;
+		}
+	}
+	free(rows);
+
+	return 0;
+}
+
+/*
+ * close_positions - close the positions opened on the date at the marks.
+ */
+static void
+close_positions(eng_work_t *w, uint32_t slot, double fee_rate, double *fee,
+		size_t *closed, size_t *wins)
+{
+	uint32_t k;
+
+	for (k = 0; k < w->nring[slot]; k++) {
+		const struct position *pos = &w->ring[(size_t)slot * 2 * w->nproducts + k];
+		double mark = w->mark[pos->product];
+
+		w->quantity[pos->product] -= pos->direction * pos->quantity;
+		*fee += pos->quantity * mark * fee_rate;
+		if (pos->direction * (mark - pos->price) * pos->quantity > 0) {
+			(*wins)++;
+		}
+		(*closed)++;
+	}
+	w->nring[slot] = 0;
+}
+
+static void
+open_position(eng_work_t *w, struct eng_result *r, uint32_t slot, uint32_t date,
+	      uint32_t product, double ret, int32_t direction, int32_t close_date,
+	      const struct eng_params *par, double price, double *fee)
+{
+	struct position *pos = &w->ring[(size_t)slot * 2 * w->nproducts + w->nring[slot]++];
+
+	pos->date = date;
+	pos->product = product;
+	pos->direction = direction;
+	pos->price = price;
+	pos->quantity = floor(par->trade_amount / price);
+
+	w->quantity[product] += direction * pos->quantity;
+	*fee += pos->quantity * price * par->fee_rate;
+
+	if (r->signals != NULL && r->nsignals < r->signals_cap) {
+		struct eng_signal *s = &r->signals[r->nsignals];
+
+		s->date = date;
+		s->product = product;
+		s->direction = direction;
+		s->close_date = close_date;
+		s->ret = ret;
+		s->price = price;
+		s->quantity = pos->quantity;
+	}
+	r->nsignals++;
+}
+
+void
+eng_stats(const double *daily, uint32_t first, uint32_t ndates, double *total,
+	  double *max_drawdown, double *sharpe)
+{
+	double cum = 0, peak = 0, mean, var = 0;
+	uint32_t d, n = ndates > first ? ndates - first : 0;
+
+	*max_drawdown = 0;
+	for (d = first; d < ndates; d++) {
+		cum += daily[d];
+		if (cum > peak) {
+			peak = cum;
+		}
+		if (peak - cum > *max_drawdown) {
+			*max_drawdown = peak - cum;
+		}
+	}
+	*total = cum;
+
+	*sharpe = 0;
+	if (n > 1) {
+		mean = cum / n;
+		for (d = first; d < ndates; d++) {
+			var += (daily[d] - mean) * (daily[d] - mean);
+		}
+		var /= n - 1;
+		if (var > 0) {
+			*sharpe = mean / sqrt(var) * sqrt(TRADING_DAYS);
+		}
+	}
+}
+
+/*
+ * summarize - the summary of the daily pnl from the first date traded.
+ */
+static void
+summarize(struct eng_result *r, const double *daily, uint32_t first, uint32_t ndates,
+	  size_t closed, size_t wins)
+{
+	eng_stats(daily, first, ndates, &r->total_pnl, &r->max_drawdown, &r->sharpe);
+	r->win_rate = closed ? (double)wins / closed : 0;
+}
+
+int
+eng_run_returns(const eng_panel_t *p, const double *ret, const struct eng_params *par,
+		eng_work_t *w, struct eng_result *r)
+{
+	int hold = par->hold_days > 0 ? par->hold_days : ENG_HOLD_DAYS;
+	uint32_t np = p->nproducts, d, i, first = p->ndates;
+	size_t closed = 0, wins = 0;
+	double *daily;
+
+	if (w->nproducts != np || w->ndates != p->ndates || reserve_ring(w, hold) != 0) {
+		return -1;
+	}
+	/* the daily pnl is kept for the summary even if the caller wants none */
+	daily = r->pnl;
+	if (daily == NULL && (daily = malloc((p->ndates ? p->ndates : 1) * sizeof(*daily))) == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < np; i++) {
+		w->quantity[i] = 0;
+		w->mark[i] = w->prev[i] = NAN;
+	}
+	memset(w->nring, 0, (size_t)(hold + 1) * sizeof(*w->nring));
+	r->nsignals = 0;
+	r->total_fee = 0;
+
+	for (d = 0; d < p->ndates; d++) {
+		const double *row = p->close + ENG_AT(p, d, 0);
+		const double *vol = p->volume + ENG_AT(p, d, 0);
+		const double *oi = p->oi + ENG_AT(p, d, 0);
+		const double *rt = ret + ENG_AT(p, d, 0);
+		uint32_t slot = d % (uint32_t)(hold + 1), m, n, k;
+		int32_t close_date = d + hold < p->ndates ? (int32_t)(d + hold) : (int32_t)p->ndates - 1;
+		double pnl = 0, fee = 0;
+		int32_t nlong = 0, nshort = 0;
+
+		/* mark the lots held to the close, a product without a bar keeps its mark */
+		for (i = 0; i < np; i++) {
+			if (!isnan(row[i])) {
+				w->mark[i] = row[i];
+			}
+			if (w->quantity[i] != 0) {
+				pnl += w->quantity[i] * (w->mark[i] - w->prev[i]);
+			}
+			w->prev[i] = w->mark[i];
+		}
+
+		/* the positions opened hold dates ago, whose slot is the next one */
+		if (d >= (uint32_t)hold) {
+			close_positions(w, (d + 1) % (uint32_t)(hold + 1), par->fee_rate, &fee, &closed, &wins);
+		}
+
+		/* the thresholds as masks, the returns not NaN are the valid of the ranking */
+		xs_rank_load(w->rank, rt);
+		xs_mask_ge(w->mask, vol, par->vol_threshold, np);
+		xs_mask_ge(w->oi_mask, oi, par->oi_threshold, np);
+		xs_mask_and(w->mask, w->oi_mask, w->rank->nwords);
+		xs_mask_gt(w->oi_mask, row, 0, np);
+		xs_mask_and(w->mask, w->oi_mask, w->rank->nwords);
+
+		if ((n = xs_rank_select(w->rank, w->mask, par->strength_pct, w->lo, w->hi, &m)) > 0) {
+			for (k = 0; k < n; k++) {
+				uint32_t lo = w->lo[k], hi = w->hi[k];
+
+				open_position(w, r, slot, d, lo, rt[lo], ENG_LONG, close_date, par, row[lo], &fee);
+				open_position(w, r, slot, d, hi, rt[hi], ENG_SHORT, close_date, par, row[hi], &fee);
+			}
+			if (first == p->ndates) {
+				first = d;
+			}
+		}
+
+		/* what is still open is closed on the last date */
+		if (d + 1 == p->ndates) {
+			for (k = 0; k <= (uint32_t)hold; k++) {
+				close_positions(w, k, par->fee_rate, &fee, &closed, &wins);
+			}
+		}
+
+		for (i = 0; i < np; i++) {
+			nlong += w->quantity[i] > 0;
+			nshort += w->quantity[i] < 0;
+		}
+
+		daily[d] = pnl - fee;
+		r->total_fee += fee;
+		if (r->fee != NULL) {
+			r->fee[d] = fee;
+		}
+		if (r->nlong != NULL) {
+			r->nlong[d] = nlong;
+		}
+		if (r->nshort != NULL) {
+			r->nshort[d] = nshort;
+		}
+	}
+
+	summarize(r, daily, first, p->ndates, closed, wins);
+
+	if (daily != r->pnl) {
+		free(daily);
+	}
+
+	return 0;
+}
+
+int
+eng_run(const eng_panel_t *p, const struct eng_params *par, eng_work_t *w, struct eng_result *r)
+{
+	size_t n = (size_t)p->ndates * p->nproducts;
+
+	if (w->ret == NULL && (w->ret = malloc((n ? n : 1) * sizeof(*w->ret))) == NULL) {
+		return -1;
+	}
+
+	if (eng_returns(p, par->ref_days, w->ret) != 0) {
+		return -1;
+	}
+
+	return eng_run_returns(p, w->ret, par, w, r);
+}
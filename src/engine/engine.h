@@ -0,0 +1,163 @@
+/*
+ * engine.h
+ *
+ * The header file contains the definition of the cross-sectional backtest
+ * engine and the functions' prototype.
+ *
+ * The bars of the products are loaded into a panel, dense matrices of
+ * [date x product] stored date-major, so the cross-section of a date is one
+ * contiguous row. A missing bar is NaN. The engine runs the strategy of
+ * cross-sectional.py followed by match_signals.py over the panel:
+ *
+ *	return   close / close ref_days bars of the product earlier - 1
+ *	filter   volume >= vol_threshold and oi >= oi_threshold
+ *	select   n = max(int(m * strength_pct), 1) of the m filtered products,
+ *		 long the n lowest returns, short the n highest
+ *	hold     trade_amount // close lots, closed hold_days dates later
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define ENG_NAME_LEN	16
+#define ENG_HOLD_DAYS	10		/* holding of match_signals.py */
+
+/*
+ * eng_panel - the bars of the products of one bar type. The prices of a
+ * product are the volume-weighted index of its contracts, the volume and
+ * the open interest the totals, as compute_product_index.py computes them.
+ */
+typedef struct eng_panel
+{
+	uint32_t ndates;
+	uint32_t nproducts;
+
+	int64_t *timestamp;		/* [date], ns since epoch of the end of the bar */
+	int32_t *trading_day;		/* [date], YYYYMMDD */
+	char (*exchange)[ENG_NAME_LEN];	/* [product] */
+	char (*product)[ENG_NAME_LEN];	/* [product] */
+
+	double *open;			/* [date * nproducts + product] */
+	double *high;
+	double *low;
+	double *close;
+	double *volume;
+	double *oi;
+} eng_panel_t;
+
+#define ENG_AT(p, d, i)	((size_t)(d) * (p)->nproducts + (i))
+
+/*
+ * eng_panel_create - an empty panel of the size, the values NaN.
+ */
+eng_panel_t *eng_panel_create(uint32_t ndates, uint32_t nproducts);
+void eng_panel_free(eng_panel_t *p);
+
+/*
+ * eng_panel_load - load the <root>/<exchange>/<product>.<bar_type>.jcol files
+ * of the column store. exchanges and products are comma separated lists,
+ * NULL for all of them.
+ */
+eng_panel_t *eng_panel_load(const char *root, int bar_type, const char *exchanges,
+			    const char *products);
+
+/*
+ * eng_panel_find - the column of the product, -1 if not in the panel.
+ */
+int eng_panel_find(const eng_panel_t *p, const char *product);
+
+struct eng_params
+{
+	double strength_pct;		/* fraction of the filtered products on each side */
+	int ref_days;			/* bars of the return */
+	double vol_threshold;
+	double oi_threshold;
+	double trade_amount;		/* amount of every position */
+	int hold_days;			/* dates a position is held, 0 for ENG_HOLD_DAYS */
+	double fee_rate;		/* fee of the amount traded, on open and on close */
+};
+
+/* direction of a signal */
+#define ENG_LONG	1
+#define ENG_SHORT	(-1)
+
+/*
+ * eng_signal - a position opened at the close of a date, like a row of the
+ * DataFrame of cross_section_strategy().
+ */
+struct eng_signal
+{
+	uint32_t date;			/* row of the panel */
+	uint32_t product;		/* column of the panel */
+	int32_t direction;		/* ENG_LONG or ENG_SHORT */
+	int32_t close_date;		/* row the position is closed at */
+	double ret;			/* return it was selected by */
+	double price;			/* open price */
+	double quantity;		/* lots, trade_amount // price */
+};
+
+/*
+ * eng_result - what a run gives back. The arrays are given by the caller
+ * and can be NULL, so a sweep keeps only the summary. signals holds up to
+ * signals_cap signals, nsignals counts all of them.
+ */
+struct eng_result
+{
+	double *pnl;			/* [date], marked to the close, net of fees */
+	double *fee;			/* [date] */
+	int32_t *nlong;			/* [date], products held long */
+	int32_t *nshort;		/* [date] */
+	struct eng_signal *signals;
+	size_t signals_cap;
+
+	/* summary */
+	size_t nsignals;
+	double total_pnl;
+	double total_fee;
+	double max_drawdown;		/* of the cumulated pnl */
+	double sharpe;			/* mean / std of the daily pnl, times sqrt(252) */
+	double win_rate;		/* of the closed positions */
+};
+
+/*
+ * eng_work - the scratch of a run, sized by the panel; a thread reuses it
+ * for all of its runs.
+ */
+typedef struct eng_work eng_work_t;
+
+eng_work_t *eng_work_create(const eng_panel_t *p);
+void eng_work_free(eng_work_t *w);
+
+/*
+ * eng_returns - ret[date * nproducts + product] of ref_days bars of the
+ * product, skipping the dates it has no bar, NaN for the first ref_days.
+ */
+int eng_returns(const eng_panel_t *p, int ref_days, double *ret);
+
+/*
+ * eng_run_returns - run with the returns of eng_returns(), which are shared
+ * by all runs of the same ref_days.
+ */
+int eng_run_returns(const eng_panel_t *p, const double *ret, const struct eng_params *par,
+		    eng_work_t *w, struct eng_result *r);
+
+/*
+ * eng_run - the returns and the run together.
+ */
+int eng_run(const eng_panel_t *p, const struct eng_params *par, eng_work_t *w,
+	    struct eng_result *r);
+
+/*
+ * eng_stats - the total, the max drawdown of the cumulated and the sharpe of
+ * the daily pnl of the dates from first.
+ */
+void eng_stats(const double *daily, uint32_t first, uint32_t ndates, double *total,
+	       double *max_drawdown, double *sharpe);
+
+#endif		/* __ENGINE_H__ */
@@ -0,0 +1,526 @@
+"""
+engine.py
+
+Run the cross-sectional backtest engine of libengine.so from Python. The
+panel is loaded from the column store, or filled from a DataFrame in the
+layout cross_section_strategy() takes; its matrices are numpy views of the
+engine's memory, so nothing is copied back and forth.
+
+    import engine
+    panel = engine.Panel.load("store", "day")
+    res = engine.backtest(panel, strength_pct=0.1, ref_days=5, vol_threshold=1000,
+                          oi_threshold=500, trade_amount=100000)
+    res.summary["sharpe"], res.daily, res.signals
+
+The library is looked for in $JUPITER_ENGINE_LIB, next to this file and in
+build/ under it.
+
+Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+"""
+
+import ctypes
+import os
+import numpy as np
+
+ENG_NAME_LEN = 16
+ENG_HOLD_DAYS = 10
+BAR_TYPES = ["1min", "5min", "15min", "30min", "hour", "day", "week", "month", "year"]
+
+c_double_p = ctypes.POINTER(ctypes.c_double)
+c_int32_p = ctypes.POINTER(ctypes.c_int32)
+
+
+class _Panel(ctypes.Structure):
+    _fields_ = [
+        ("ndates", ctypes.c_uint32), ("nproducts", ctypes.c_uint32),
+        ("timestamp", ctypes.POINTER(ctypes.c_int64)), ("trading_day", c_int32_p),
+        ("exchange", ctypes.POINTER(ctypes.c_char * ENG_NAME_LEN)),
+        ("product", ctypes.POINTER(ctypes.c_char * ENG_NAME_LEN)),
+        ("open", c_double_p), ("high", c_double_p), ("low", c_double_p), ("close", c_double_p),
+        ("volume", c_double_p), ("oi", c_double_p),
+    ]
+
+
+class _Params(ctypes.Structure):
+    _fields_ = [
+        ("strength_pct", ctypes.c_double), ("ref_days", ctypes.c_int),
+        ("vol_threshold", ctypes.c_double), ("oi_threshold", ctypes.c_double),
+        ("trade_amount", ctypes.c_double), ("hold_days", ctypes.c_int),
+        ("fee_rate", ctypes.c_double),
+    ]
+
+
+SIGNAL = np.dtype([
+    ("date", "<u4"), ("product", "<u4"), ("direction", "<i4"), ("close_date", "<i4"),
+    ("ret", "<f8"), ("price", "<f8"), ("quantity", "<f8"),
+])
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [
+        ("pnl", c_double_p), ("fee", c_double_p), ("nlong", c_int32_p), ("nshort", c_int32_p),
+        ("signals", ctypes.c_void_p), ("signals_cap", ctypes.c_size_t),
+        ("nsignals", ctypes.c_size_t), ("total_pnl", ctypes.c_double),
+        ("total_fee", ctypes.c_double), ("max_drawdown", ctypes.c_double),
+        ("sharpe", ctypes.c_double), ("win_rate", ctypes.c_double),
+    ]
+
+
+PF_MAGIC = 0x4C504E4A
+PF_MATRICES = ["long_pnl", "short_pnl", "close_pnl", "turnover", "long_lots", "short_lots"]
+PF_HDR = np.dtype([
+    ("magic", "<u4"), ("version", "<u4"), ("ndates", "<u4"), ("nproducts", "<u4"),
+    ("ncurve", "<u4"), ("nmatrix", "<u4"), ("day_size", "<u4"), ("product_size", "<u4"),
+    ("first_day", "<i4"), ("last_day", "<i4"), ("fee_rate", "<f8"), ("reserved", "u1", (16,)),
+])
+PF_SUMMARY = np.dtype([
+    ("npositions", "<u8"), ("skipped", "<u8"), ("total_pnl", "<f8"), ("total_fee", "<f8"),
+    ("turnover", "<f8"), ("max_drawdown", "<f8"), ("sharpe", "<f8"), ("win_rate", "<f8"),
+])
+PF_DAY = np.dtype([
+    ("date", "<i4"), ("long", "<i4"), ("short", "<i4"), ("opened", "<i4"),
+    ("pnl", "<f8"), ("long_pnl", "<f8"), ("short_pnl", "<f8"), ("close_pnl", "<f8"),
+    ("fee", "<f8"), ("turnover", "<f8"), ("long_value", "<f8"), ("short_value", "<f8"),
+    ("cum_pnl", "<f8"), ("drawdown", "<f8"),
+])
+PF_PRODUCT = np.dtype([
+    ("exchange", "S%d" % ENG_NAME_LEN), ("product", "S%d" % ENG_NAME_LEN),
+    ("npositions", "<u4"), ("wins", "<u4"), ("days_held", "<u4"), ("reserved", "<u4"),
+    ("pnl", "<f8"), ("long_pnl", "<f8"), ("short_pnl", "<f8"), ("close_pnl", "<f8"),
+    ("fee", "<f8"), ("turnover", "<f8"),
+])
+PF_CURVE = np.dtype([
+    ("day", "<u4"), ("n", "<u4"), ("mean_ret", "<f8"), ("hit_rate", "<f8"), ("mean_pnl", "<f8"),
+])
+
+
+class _PfResult(ctypes.Structure):
+    _fields_ = [
+        ("summary", ctypes.c_uint8 * PF_SUMMARY.itemsize), ("days", ctypes.c_void_p),
+        ("products", ctypes.c_void_p), ("curve", ctypes.c_void_p),
+        ("curve_cap", ctypes.c_uint32), ("ncurve", ctypes.c_uint32),
+        ("matrix", c_double_p * len(PF_MATRICES)),
+    ]
+
+
+def _load_library():
+    here = os.path.dirname(os.path.abspath(__file__))
+    paths = [os.environ.get("JUPITER_ENGINE_LIB", "")]
+    paths += [os.path.join(here, d, "libengine.so") for d in ("", "build")]
+    for path in paths:
+        if path and os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            break
+    else:
+        raise OSError("libengine.so not found, build src/engine or set JUPITER_ENGINE_LIB")
+
+    lib.eng_panel_create.restype = ctypes.POINTER(_Panel)
+    lib.eng_panel_create.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.eng_panel_load.restype = ctypes.POINTER(_Panel)
+    lib.eng_panel_load.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_char_p]
+    lib.eng_panel_free.argtypes = [ctypes.POINTER(_Panel)]
+    lib.eng_work_create.restype = ctypes.c_void_p
+    lib.eng_work_create.argtypes = [ctypes.POINTER(_Panel)]
+    lib.eng_work_free.argtypes = [ctypes.c_void_p]
+    lib.eng_run.argtypes = [ctypes.POINTER(_Panel), ctypes.POINTER(_Params), ctypes.c_void_p,
+                            ctypes.POINTER(_Result)]
+    lib.eng_run_returns.argtypes = [ctypes.POINTER(_Panel), c_double_p, ctypes.POINTER(_Params),
+                                    ctypes.c_void_p, ctypes.POINTER(_Result)]
+    lib.pf_run.argtypes = [ctypes.POINTER(_Panel), ctypes.c_void_p, ctypes.c_size_t, ctypes.c_double,
+                           ctypes.POINTER(_PfResult)]
+    lib.pf_write.argtypes = [ctypes.c_char_p, ctypes.POINTER(_Panel), ctypes.c_double,
+                             ctypes.POINTER(_PfResult)]
+    lib.fac_graph_create.restype = ctypes.c_void_p
+    lib.fac_graph_create.argtypes = [ctypes.POINTER(_Panel)]
+    lib.fac_graph_free.argtypes = [ctypes.c_void_p]
+    lib.fac_graph_groups.argtypes = [ctypes.c_void_p, c_int32_p, ctypes.c_uint32]
+    lib.fac_node.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                             ctypes.c_int, ctypes.c_double]
+    lib.fac_eval.restype = c_double_p
+    lib.fac_eval.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    return lib
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        _lib = _load_library()
+    return _lib
+
+
+class Panel:
+    """[date x product] matrices of the engine, open ... oi as numpy views"""
+
+    def __init__(self, ptr):
+        if not ptr:
+            raise ValueError("cannot create the panel")
+        self._ptr = ptr
+        p = ptr.contents
+        self.ndates, self.nproducts = p.ndates, p.nproducts
+        shape = (self.ndates, self.nproducts)
+        self.timestamp = np.ctypeslib.as_array(p.timestamp, shape=(max(self.ndates, 1),))[:self.ndates]
+        self.trading_day = np.ctypeslib.as_array(p.trading_day, shape=(max(self.ndates, 1),))[:self.ndates]
+        for name in ("open", "high", "low", "close", "volume", "oi"):
+            flat = np.ctypeslib.as_array(getattr(p, name), shape=(max(self.ndates * self.nproducts, 1),))
+            setattr(self, name, flat[:self.ndates * self.nproducts].reshape(shape))
+
+    @property
+    def products(self):
+        p = self._ptr.contents
+        return [p.product[i].value.decode() for i in range(self.nproducts)]
+
+    @property
+    def exchanges(self):
+        p = self._ptr.contents
+        return [p.exchange[i].value.decode() for i in range(self.nproducts)]
+
+    @classmethod
+    def load(cls, root, bar_type="day", exchanges=None, products=None):
+        """the panel of the column store; exchanges and products are lists, None for all"""
+        join = lambda v: ",".join(v).encode() if v else None
+        return cls(_library().eng_panel_load(root.encode(), BAR_TYPES.index(bar_type),
+                                             join(exchanges), join(products)))
+
+    @classmethod
+    def from_frame(cls, df, close="close", volume="volume_index", oi="oi_index"):
+        """the panel of a DataFrame with 'product', 'date' and the columns given"""
+        dates = np.sort(df["date"].unique())
+        products = np.sort(df["product"].unique())
+        panel = cls(_library().eng_panel_create(len(dates), len(products)))
+
+        p = panel._ptr.contents
+        for i, name in enumerate(products):
+            p.product[i].value = str(name).encode()[:ENG_NAME_LEN - 1]
+            if "exchange" in df:
+                exch = df.loc[df["product"] == name, "exchange"].iloc[0]
+                p.exchange[i].value = str(exch).encode()[:ENG_NAME_LEN - 1]
+
+        d = np.searchsorted(dates, df["date"].to_numpy())
+        j = np.searchsorted(products, df["product"].to_numpy())
+        panel.trading_day[:] = [int(str(x).replace("-", "")[:8]) for x in dates]
+        for name, col in (("close", close), ("volume", volume), ("oi", oi),
+                          ("open", "open"), ("high", "high"), ("low", "low")):
+            if col in df:
+                getattr(panel, name)[d, j] = df[col].to_numpy(dtype=np.float64)
+        return panel
+
+    def close_panel(self):
+        if self._ptr:
+            _library().eng_panel_free(self._ptr)
+            self._ptr = None
+
+    def __del__(self):
+        if _lib is not None:
+            self.close_panel()
+
+
+class Result:
+    """the daily pnl, the signals and the summary of a run"""
+
+    def __init__(self, panel, res, pnl, fee, nlong, nshort, signals):
+        n = min(res.nsignals, res.signals_cap)
+        self.summary = {name: getattr(res, name) for name in
+                        ("nsignals", "total_pnl", "total_fee", "max_drawdown", "sharpe", "win_rate")}
+        self.daily = {"date": panel.trading_day.copy(), "pnl": pnl, "fee": fee,
+                      "cum_pnl": np.cumsum(pnl), "long": nlong, "short": nshort}
+        self.signals = signals[:n] if signals is not None else None
+        self._panel = panel
+
+    def signal_frame(self):
+        """the signals like the DataFrame of cross_section_strategy()"""
+        import pandas as pd
+
+        s = self.signals
+        products = np.array(self._panel.products)
+        td = self._panel.trading_day
+        return pd.DataFrame({
+            "date": td[s["date"]], "product": products[s["product"]],
+            "position": np.where(s["direction"] > 0, "long", "short"),
+            "return": s["ret"], "price": s["price"], "quantity": s["quantity"],
+            "close_date": td[s["close_date"]],
+        })
+
+    def daily_frame(self):
+        import pandas as pd
+
+        return pd.DataFrame(self.daily)
+
+
+def backtest(panel, strength_pct, ref_days, vol_threshold, oi_threshold, trade_amount,
+             hold_days=ENG_HOLD_DAYS, fee_rate=0.0, signals=True, factor=None):
+    """run the strategy of cross_section_strategy() and match_signals.py over the panel,
+    ranking by the factor, a [date x product] matrix, instead of the returns if given"""
+    lib = _library()
+    nd, npd = panel.ndates, panel.nproducts
+    pnl = np.zeros(nd)
+    fee = np.zeros(nd)
+    nlong = np.zeros(nd, dtype=np.int32)
+    nshort = np.zeros(nd, dtype=np.int32)
+    sig = np.zeros(nd * npd * 2, dtype=SIGNAL) if signals else None
+
+    res = _Result()
+    res.pnl = pnl.ctypes.data_as(c_double_p)
+    res.fee = fee.ctypes.data_as(c_double_p)
+    res.nlong = nlong.ctypes.data_as(c_int32_p)
+    res.nshort = nshort.ctypes.data_as(c_int32_p)
+    if sig is not None:
+        res.signals = sig.ctypes.data
+        res.signals_cap = len(sig)
+
+    par = _Params(strength_pct, ref_days, vol_threshold, oi_threshold, trade_amount, hold_days, fee_rate)
+    work = lib.eng_work_create(panel._ptr)
+    if not work:
+        raise MemoryError("cannot create the work of the engine")
+    try:
+        if factor is not None:
+            factor = np.ascontiguousarray(factor, dtype=np.float64)
+            if factor.shape != (nd, npd):
+                raise ValueError("the factor is not of the shape of the panel")
+            rc = lib.eng_run_returns(panel._ptr, factor.ctypes.data_as(c_double_p), ctypes.byref(par),
+                                     work, ctypes.byref(res))
+        else:
+            rc = lib.eng_run(panel._ptr, ctypes.byref(par), work, ctypes.byref(res))
+        if rc != 0:
+            raise ValueError("cannot run the backtest")
+    finally:
+        lib.eng_work_free(work)
+
+    return Result(panel, res, pnl, fee, nlong, nshort, sig)
+
+
+FAC_FIELDS = ["open", "high", "low", "close", "volume", "oi"]
+FAC_OPS = ["field", "ret", "sum", "mean", "std", "max", "min", "drawdown", "zscore",
+           "winsorize", "neutralize", "add", "sub", "mul", "div", "scale"]
+
+
+class Factors:
+    """a lazy factor graph of the panel; a node is an int, eval() computes it
+
+        f = engine.Factors(panel)
+        mom = f.ret(f.field("close"), 20)
+        score = f.zscore(f.winsorize(f.div(mom, f.std(f.ret(f.field("close"), 1), 20)), 0.05))
+        res = engine.backtest(panel, 0.1, 20, 1000, 500, 100000, factor=f.eval(score))
+    """
+
+    def __init__(self, panel):
+        self._panel = panel
+        self._ptr = _library().fac_graph_create(panel._ptr)
+        if not self._ptr:
+            raise MemoryError("cannot create the factor graph")
+
+    def _node(self, op, a=-1, b=-1, window=0, arg=0.0):
+        node = _library().fac_node(self._ptr, FAC_OPS.index(op), a, b, window, arg)
+        if node < 0:
+            raise ValueError(f"bad factor node {op}")
+        return node
+
+    def field(self, name):
+        return self._node("field", arg=FAC_FIELDS.index(name))
+
+    def ret(self, a, window):
+        return self._node("ret", a, window=window)
+
+    def sum(self, a, window):
+        return self._node("sum", a, window=window)
+
+    def mean(self, a, window):
+        return self._node("mean", a, window=window)
+
+    def std(self, a, window):
+        return self._node("std", a, window=window)
+
+    def max(self, a, window):
+        return self._node("max", a, window=window)
+
+    def min(self, a, window):
+        return self._node("min", a, window=window)
+
+    def drawdown(self, a, window):
+        return self._node("drawdown", a, window=window)
+
+    def zscore(self, a):
+        return self._node("zscore", a)
+
+    def winsorize(self, a, pct):
+        return self._node("winsorize", a, arg=pct)
+
+    def neutralize(self, a, groups):
+        """groups: the group of every product of the panel, negative for none"""
+        g = np.ascontiguousarray(groups, dtype=np.int32)
+        _library().fac_graph_groups(self._ptr, g.ctypes.data_as(c_int32_p), int(g.max()) + 1)
+        return self._node("neutralize", a)
+
+    def add(self, a, b):
+        return self._node("add", a, b)
+
+    def sub(self, a, b):
+        return self._node("sub", a, b)
+
+    def mul(self, a, b):
+        return self._node("mul", a, b)
+
+    def div(self, a, b):
+        return self._node("div", a, b)
+
+    def scale(self, a, k):
+        return self._node("scale", a, arg=k)
+
+    def eval(self, node):
+        """the [date x product] matrix of the node, a view valid while the graph lives"""
+        ptr = _library().fac_eval(self._ptr, node)
+        if not ptr:
+            raise ValueError("cannot compute the factor")
+        n = self._panel.ndates * self._panel.nproducts
+        return np.ctypeslib.as_array(ptr, shape=(max(n, 1),))[:n].reshape(
+            self._panel.ndates, self._panel.nproducts)
+
+    def __del__(self):
+        if _lib is not None and self._ptr:
+            _lib.fac_graph_free(self._ptr)
+            self._ptr = None
+
+
+SWEEP_MAGIC = 0x5057534A
+SWEEP_PARAMS = ["strength_pct", "ref_days", "vol_threshold", "oi_threshold",
+                "trade_amount", "hold_days", "fee_rate"]
+SWEEP_HDR = np.dtype([
+    ("magic", "<u4"), ("version", "<u4"), ("rec_size", "<u4"), ("ndates", "<u4"),
+    ("nproducts", "<u4"), ("first_day", "<i4"), ("last_day", "<i4"), ("reserved0", "<u4"),
+    ("ncombos", "<u8"), ("nrecs", "<u8"), ("reserved", "u1", (16,)),
+])
+SWEEP_REC = np.dtype([("combo", "<u8")] + [(name, "<f8") for name in SWEEP_PARAMS] + [
+    ("nsignals", "<u8"), ("total_pnl", "<f8"), ("total_fee", "<f8"),
+    ("max_drawdown", "<f8"), ("sharpe", "<f8"), ("win_rate", "<f8"),
+])
+
+
+def read_sweep(path):
+    """the records of the result table of optimize, also while it still runs"""
+    mm = np.memmap(path, dtype=np.uint8, mode="r")
+    hdr = np.frombuffer(mm, dtype=SWEEP_HDR, count=1)[0]
+    if hdr["magic"] != SWEEP_MAGIC or hdr["rec_size"] != SWEEP_REC.itemsize:
+        raise ValueError(f"{path} is not a sweep table")
+    n = (len(mm) - SWEEP_HDR.itemsize) // SWEEP_REC.itemsize
+    return np.frombuffer(mm, dtype=SWEEP_REC, count=n, offset=SWEEP_HDR.itemsize)
+
+
+class Portfolio:
+    """the daily pnl of a book of positions: summary, days, products, the response
+    curve and the [date x product] matrices of PF_MATRICES"""
+
+    def __init__(self, summary, days, products, curve, matrices):
+        self.summary = {name: summary[name].item() for name in PF_SUMMARY.names}
+        self.days, self.products, self.curve, self.matrices = days, products, curve, matrices
+
+    def day_frame(self):
+        import pandas as pd
+
+        return pd.DataFrame({name: self.days[name] for name in PF_DAY.names})
+
+    def product_frame(self):
+        import pandas as pd
+
+        df = pd.DataFrame({name: self.products[name] for name in PF_PRODUCT.names if name != "reserved"})
+        for name in ("exchange", "product"):
+            df[name] = df[name].str.decode("ascii")
+        return df
+
+    def curve_frame(self):
+        import pandas as pd
+
+        return pd.DataFrame({name: self.curve[name] for name in PF_CURVE.names})
+
+
+def signals_from_frame(panel, df, amount=100000.0, hold_days=ENG_HOLD_DAYS):
+    """the signals of a DataFrame with 'date', 'product', 'position' and optionally
+    'amount', 'price', 'quantity' and 'close_date', like signals.csv; the rows not in
+    the panel are dropped"""
+    import pandas as pd
+
+    td = panel.trading_day
+    day = lambda col: pd.to_datetime(df[col].astype(str)).dt.strftime("%Y%m%d").astype(np.int32).to_numpy()
+    row = lambda days: np.searchsorted(td, days, side="right") - 1
+    cols = {name.upper(): i for i, name in enumerate(panel.products)}
+
+    d = row(day("date"))
+    j = df["product"].astype(str).str.upper().map(cols).fillna(-1).astype(np.int64).to_numpy()
+    ok = (d >= 0) & (j >= 0)
+    ok[ok] &= td[d[ok]] == day("date")[ok]
+
+    amt = df["amount"].to_numpy(dtype=np.float64) if "amount" in df else np.full(len(df), amount)
+    if "price" in df:
+        price = df["price"].to_numpy(dtype=np.float64)
+    else:
+        price = np.where(ok, panel.close[np.where(ok, d, 0), np.where(ok, j, 0)], np.nan)
+    quantity = df["quantity"].to_numpy(dtype=np.float64) if "quantity" in df else np.floor(amt / price)
+    if "close_date" in df:
+        close = row(day("close_date"))
+    else:
+        close = np.minimum(d + (hold_days if hold_days > 0 else ENG_HOLD_DAYS), panel.ndates - 1)
+    ok &= (price > 0) & (close >= d)
+
+    s = np.zeros(int(ok.sum()), dtype=SIGNAL)
+    s["date"], s["product"], s["close_date"] = d[ok], j[ok], close[ok]
+    s["direction"] = np.where(df["position"].str.lower().to_numpy()[ok] == "long", 1, -1)
+    s["price"], s["quantity"] = price[ok], quantity[ok]
+    return s
+
+
+def portfolio(panel, signals, fee_rate=0.0, output=None, **kwargs):
+    """the daily pnl of the signals, a SIGNAL array like Result.signals or a DataFrame
+    for signals_from_frame(), written to the result file output if given"""
+    lib = _library()
+    nd, npd = panel.ndates, panel.nproducts
+    if not isinstance(signals, np.ndarray):
+        n = len(signals)
+        signals = signals_from_frame(panel, signals, **kwargs)
+        skipped = n - len(signals)
+    else:
+        skipped = 0
+    signals = np.ascontiguousarray(signals, dtype=SIGNAL)
+
+    summary = np.zeros(1, dtype=PF_SUMMARY)
+    days = np.zeros(max(nd, 1), dtype=PF_DAY)
+    products = np.zeros(max(npd, 1), dtype=PF_PRODUCT)
+    curve = np.zeros(max(nd, 1), dtype=PF_CURVE)
+    matrices = {name: np.zeros((nd, npd)) for name in PF_MATRICES}
+
+    res = _PfResult()
+    res.days, res.products, res.curve = days.ctypes.data, products.ctypes.data, curve.ctypes.data
+    res.curve_cap = len(curve)
+    for i, name in enumerate(PF_MATRICES):
+        res.matrix[i] = matrices[name].ctypes.data_as(c_double_p)
+
+    if lib.pf_run(panel._ptr, signals.ctypes.data, len(signals), fee_rate, ctypes.byref(res)) != 0:
+        raise ValueError("cannot run the portfolio")
+    ctypes.memmove(summary.ctypes.data, ctypes.addressof(res.summary), PF_SUMMARY.itemsize)
+    summary["skipped"] += skipped
+    ctypes.memmove(ctypes.addressof(res.summary), summary.ctypes.data, PF_SUMMARY.itemsize)
+    if output is not None and lib.pf_write(output.encode(), panel._ptr, fee_rate, ctypes.byref(res)) != 0:
+        raise OSError(f"cannot write {output}")
+
+    return Portfolio(summary[0], days[:nd], products[:npd], curve[:min(res.ncurve, len(curve))], matrices)
+
+
+def read_portfolio(path):
+    """the result file of pnl or portfolio(output=...), the arrays are views of the file"""
+    mm = np.memmap(path, dtype=np.uint8, mode="r")
+    hdr = np.frombuffer(mm, dtype=PF_HDR, count=1)[0]
+    if hdr["magic"] != PF_MAGIC or hdr["day_size"] != PF_DAY.itemsize or \
+            hdr["product_size"] != PF_PRODUCT.itemsize or hdr["nmatrix"] != len(PF_MATRICES):
+        raise ValueError(f"{path} is not a portfolio result")
+
+    nd, npd, off = int(hdr["ndates"]), int(hdr["nproducts"]), PF_HDR.itemsize
+    arrays = []
+    for dtype, n in ((PF_SUMMARY, 1), (PF_DAY, nd), (PF_PRODUCT, npd), (PF_CURVE, int(hdr["ncurve"]))):
+        arrays.append(np.frombuffer(mm, dtype=dtype, count=n, offset=off))
+        off += dtype.itemsize * n
+    matrices = {}
+    for name in PF_MATRICES:
+        matrices[name] = np.frombuffer(mm, dtype="<f8", count=nd * npd, offset=off).reshape(nd, npd)
+        off += 8 * nd * npd
+
+    return Portfolio(arrays[0][0], arrays[1], arrays[2], arrays[3], matrices)
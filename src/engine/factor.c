@@ -0,0 +1,678 @@
+/*
+ * factor.c
+ *
+ * The functions are used to compute the factors of a panel: the rolling
+ * kernels along the dates, the cross-sectional kernels along the products
+ * of a date, and the lazy graph composing them.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "factor.h"
+
+#define NODE_MAX	4096
+
+enum { MOM_SUM, MOM_MEAN, MOM_STD };
+
+/*
+ * roll_moments - the rolling sum, mean or std. Every product keeps the sum
+ * and the sum of squares of its values less the first of them in the
+ * window, which keeps the variance from cancelling on large prices. The
+ * loops are branch-free over the products, so they vectorize.
+ */
+static void
+roll_moments(const double *restrict x, double *restrict out, uint32_t ndates, uint32_t n,
+	     int window, int min_periods, int kind)
+{
+	double *s, *q, *k, *c;
+	uint32_t t, i;
+
+	if (window < 1) {
+		window = 1;
+	}
+	s = calloc(n ? n : 1, sizeof(*s));
+	q = calloc(n ? n : 1, sizeof(*q));
+	k = calloc(n ? n : 1, sizeof(*k));
+	c = calloc(n ? n : 1, sizeof(*c));
+	if (s == NULL || q == NULL || k == NULL || c == NULL) {
+		for (i = 0; i < (size_t)ndates * n; i++) {
+			out[i] = NAN;
+		}
+		goto out;
+	}
+
+	for (t = 0; t < ndates; t++) {
+		const double *restrict xv = x + (size_t)t * n;
+		const double *restrict xo = t >= (uint32_t)window ? x + (size_t)(t - window) * n : NULL;
+		double *restrict ov = out + (size_t)t * n;
+
+		if (xo != NULL) {
+			for (i = 0; i < n; i++) {
+				int valid = xo[i] == xo[i];
+				double d = valid ? xo[i] - k[i] : 0;
+
+				s[i] -= d;
+				q[i] -= d * d;
+				c[i] -= valid;
+			}
+		}
+
+		for (i = 0; i < n; i++) {
+			int valid = xv[i] == xv[i];
+			int reset = valid && c[i] == 0;
+			double d;
+
+			k[i] = reset ? xv[i] : k[i];
+			s[i] = reset ? 0 : s[i];
+			q[i] = reset ? 0 : q[i];
+			d = valid ? xv[i] - k[i] : 0;
+			s[i] += d;
+			q[i] += d * d;
+			c[i] += valid;
+		}
+
+		switch (kind) {
+		case MOM_SUM:
+			for (i = 0; i < n; i++) {
+				ov[i] = c[i] >= min_periods && c[i] > 0 ? s[i] + c[i] * k[i] : NAN;
+			}
+			break;
+		case MOM_MEAN:
+			for (i = 0; i < n; i++) {
+				ov[i] = c[i] >= min_periods && c[i] > 0 ? s[i] / c[i] + k[i] : NAN;
+			}
+			break;
+		default:
+			for (i = 0; i < n; i++) {
+				double var = (q[i] - s[i] * s[i] / c[i]) / (c[i] - 1);
+
+				ov[i] = c[i] >= min_periods && c[i] > 1 ? sqrt(var > 0 ? var : 0) : NAN;
+			}
+			break;
+		}
+	}
+
+out:
+	free(s);
+	free(q);
+	free(k);
+	free(c);
+}
+
+void
+fac_roll_sum(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	roll_moments(x, out, ndates, n, window, min_periods, MOM_SUM);
+}
+
+void
+fac_roll_mean(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	roll_moments(x, out, ndates, n, window, min_periods, MOM_MEAN);
+}
+
+void
+fac_roll_std(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	roll_moments(x, out, ndates, n, window, min_periods, MOM_STD);
+}
+
+/*
+ * roll_extreme - the rolling max (sign 1) or min (sign -1) by a monotonic
+ * deque of the dates of every product, amortized O(1) a step.
+ */
+static void
+roll_extreme(const double *x, double *out, uint32_t ndates, uint32_t n, int window,
+	     int min_periods, double sign)
+{
+	uint32_t *dq, head, tail, t, i, cap;
+	int count;
+
+	if (window < 1) {
+		window = 1;
+	}
+	cap = (uint32_t)window + 1;
+	if ((dq = malloc(cap * sizeof(*dq))) == NULL) {
+		for (i = 0; i < (size_t)ndates * n; i++) {
+			out[i] = NAN;
+		}
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		head = tail = 0;
+		count = 0;
+
+		for (t = 0; t < ndates; t++) {
+			double v = x[(size_t)t * n + i];
+
+			if (t >= (uint32_t)window) {
+				double o = x[(size_t)(t - window) * n + i];
+
+				count -= o == o;
+				if (head != tail && dq[head % cap] == t - window) {
+					head++;
+				}
+			}
+
+			if (v == v) {
+				while (head != tail && sign * x[(size_t)dq[(tail - 1) % cap] * n + i] <= sign * v) {
+					tail--;
+				}
+				dq[tail++ % cap] = t;
+				count++;
+			}
+
+			out[(size_t)t * n + i] = count >= min_periods && head != tail ?
+						 x[(size_t)dq[head % cap] * n + i] : NAN;
+		}
+	}
+	free(dq);
+}
+
+void
+fac_roll_max(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	roll_extreme(x, out, ndates, n, window, min_periods, 1);
+}
+
+void
+fac_roll_min(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	roll_extreme(x, out, ndates, n, window, min_periods, -1);
+}
+
+void
+fac_drawdown(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods)
+{
+	size_t i, total = (size_t)ndates * n;
+
+	roll_extreme(x, out, ndates, n, window, min_periods, 1);
+	for (i = 0; i < total; i++) {
+		out[i] = x[i] / out[i] - 1;
+	}
+}
+
+void
+fac_zscore(const double *restrict x, double *restrict out, uint32_t ndates, uint32_t n)
+{
+	uint32_t t, i;
+
+	for (t = 0; t < ndates; t++) {
+		const double *restrict xv = x + (size_t)t * n;
+		double *restrict ov = out + (size_t)t * n;
+		double sum = 0, var = 0, cnt = 0, mean, sd;
+
+		for (i = 0; i < n; i++) {
+			int valid = xv[i] == xv[i];
+
+			sum += valid ? xv[i] : 0;
+			cnt += valid;
+		}
+		mean = cnt > 0 ? sum / cnt : 0;
+		for (i = 0; i < n; i++) {
+			double d = xv[i] == xv[i] ? xv[i] - mean : 0;
+
+			var += d * d;
+		}
+		sd = cnt > 1 ? sqrt(var / (cnt - 1)) : NAN;
+
+		for (i = 0; i < n; i++) {
+			ov[i] = sd > 0 ? (xv[i] - mean) / sd : sd == 0 && xv[i] == xv[i] ? 0 : NAN;
+		}
+	}
+}
+
+static inline void
+swap_double(double *a, double *b)
+{
+	double t = *a;
+
+	*a = *b;
+	*b = t;
+}
+
+/*
+ * nth_double - reorder v[0, n) so that v[k] is the k-th smallest and those
+ * before it are not greater.
+ */
+static void
+nth_double(double *v, uint32_t n, uint32_t k)
+{
+	int64_t lo = 0, hi = (int64_t)n - 1;
+
+	while (lo < hi) {
+		double pivot = v[lo + (hi - lo) / 2];
+		int64_t i = lo, j = hi;
+
+		while (i <= j) {
+			while (v[i] < pivot) {
+				i++;
+			}
+			while (v[j] > pivot) {
+				j--;
+			}
+			if (i <= j) {
+				swap_double(&v[i++], &v[j--]);
+			}
+		}
+
+		/* [lo, j] are not greater than the pivot, [i, hi] not less, between equal */
+		if ((int64_t)k <= j) {
+			hi = j;
+		} else if ((int64_t)k >= i) {
+			lo = i;
+		} else {
+			return;
+		}
+	}
+}
+
+/*
+ * quantile - the linear quantile of v[0, m), which is reordered.
+ */
+static double
+quantile(double *v, uint32_t m, double q)
+{
+	double pos = q * (m - 1), lo, hi;
+	uint32_t k = (uint32_t)pos, i;
+
+	nth_double(v, m, k);
+	lo = v[k];
+	if (k + 1 >= m || pos == k) {
+		return lo;
+	}
+
+	hi = v[k + 1];
+	for (i = k + 2; i < m; i++) {
+		hi = v[i] < hi ? v[i] : hi;
+	}
+
+	return lo + (pos - k) * (hi - lo);
+}
+
+void
+fac_winsorize(const double *x, double *out, uint32_t ndates, uint32_t n, double pct)
+{
+	double *tmp, lower, upper;
+	uint32_t t, i, m;
+
+	if (pct < 0) {
+		pct = 0;
+	} else if (pct > 0.5) {
+		pct = 0.5;
+	}
+
+	if ((tmp = malloc((n ? n : 1) * sizeof(*tmp))) == NULL) {
+		for (i = 0; i < (size_t)ndates * n; i++) {
+			out[i] = NAN;
+		}
+		return;
+	}
+
+	for (t = 0; t < ndates; t++) {
+		const double *xv = x + (size_t)t * n;
+		double *ov = out + (size_t)t * n;
+
+		for (i = 0, m = 0; i < n; i++) {
+			if (xv[i] == xv[i]) {
+				tmp[m++] = xv[i];
+			}
+		}
+		if (m == 0) {
+			memcpy(ov, xv, n * sizeof(*ov));
+			continue;
+		}
+
+		lower = quantile(tmp, m, pct);
+		upper = quantile(tmp, m, 1 - pct);
+		for (i = 0; i < n; i++) {
+			ov[i] = xv[i] < lower ? lower : xv[i] > upper ? upper : xv[i];
+		}
+	}
+	free(tmp);
+}
+
+void
+fac_neutralize(const double *x, double *out, uint32_t ndates, uint32_t n,
+	       const int32_t *group, uint32_t ngroups)
+{
+	double *sum, *cnt;
+	uint32_t t, i;
+
+	sum = malloc((ngroups ? ngroups : 1) * sizeof(*sum));
+	cnt = malloc((ngroups ? ngroups : 1) * sizeof(*cnt));
+	if (sum == NULL || cnt == NULL) {
+		for (i = 0; i < (size_t)ndates * n; i++) {
+			out[i] = NAN;
+		}
+		goto out;
+	}
+
+	for (t = 0; t < ndates; t++) {
+		const double *xv = x + (size_t)t * n;
+		double *ov = out + (size_t)t * n;
+
+		memset(sum, 0, ngroups * sizeof(*sum));
+		memset(cnt, 0, ngroups * sizeof(*cnt));
+		for (i = 0; i < n; i++) {
+			if (group[i] >= 0 && (uint32_t)group[i] < ngroups && xv[i] == xv[i]) {
+				sum[group[i]] += xv[i];
+				cnt[group[i]]++;
+			}
+		}
+		for (i = 0; i < n; i++) {
+			ov[i] = group[i] >= 0 && (uint32_t)group[i] < ngroups ?
+				xv[i] - sum[group[i]] / cnt[group[i]] : NAN;
+		}
+	}
+
+out:
+	free(sum);
+	free(cnt);
+}
+
+struct node
+{
+	int op;
+	int a;
+	int b;
+	int window;
+	double arg;
+	double *out;			/* owned, NULL until computed */
+	const double *value;		/* the matrix once computed */
+};
+
+struct fac_graph
+{
+	const eng_panel_t *panel;
+	struct node *nodes;
+	int n;
+	int cap;
+	int computed;
+	int32_t *group;
+	uint32_t ngroups;
+};
+
+fac_graph_t *
+fac_graph_create(const eng_panel_t *p)
+{
+	fac_graph_t *g;
+
+	if ((g = calloc(1, sizeof(*g))) == NULL) {
+		return NULL;
+	}
+	g->panel = p;
+
+	return g;
+}
+
+void
+fac_graph_reset(fac_graph_t *g)
+{
+	int i;
+
+	for (i = 0; i < g->n; i++) {
+		free(g->nodes[i].out);
+		g->nodes[i].out = NULL;
+		g->nodes[i].value = NULL;
+	}
+	g->computed = 0;
+}
+
+void
+fac_graph_free(fac_graph_t *g)
+{
+	if (g == NULL) {
+		return;
+	}
+
+	fac_graph_reset(g);
+	free(g->nodes);
+	free(g->group);
+	free(g);
+}
+
+int
+fac_graph_groups(fac_graph_t *g, const int32_t *group, uint32_t ngroups)
+{
+	size_t n = g->panel->nproducts;
+	int32_t *copy;
+	int i;
+
+	if ((copy = malloc((n ? n : 1) * sizeof(*copy))) == NULL) {
+		return -1;
+	}
+	memcpy(copy, group, n * sizeof(*copy));
+	free(g->group);
+	g->group = copy;
+	g->ngroups = ngroups;
+
+	/* the neutralized nodes are stale */
+	for (i = 0; i < g->n; i++) {
+		if (g->nodes[i].op == FAC_OP_NEUTRALIZE && g->nodes[i].value != NULL) {
+			fac_graph_reset(g);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static int
+arity(int op)
+{
+	switch (op) {
+	case FAC_OP_FIELD:
+		return 0;
+	case FAC_OP_ADD:
+	case FAC_OP_SUB:
+	case FAC_OP_MUL:
+	case FAC_OP_DIV:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+int
+fac_node(fac_graph_t *g, int op, int a, int b, int window, double arg)
+{
+	struct node *nd;
+	int i, k = op >= 0 && op < FAC_OP_MAX_ ? arity(op) : -1;
+
+	if (k < 0 || (op == FAC_OP_FIELD && (arg < 0 || arg >= FAC_NFIELD)) ||
+	    (k >= 1 && (a < 0 || a >= g->n)) || (k == 2 && (b < 0 || b >= g->n))) {
+		return -1;
+	}
+	if (k < 2) {
+		b = -1;
+	}
+	if (k < 1) {
+		a = -1;
+	}
+	if (op < FAC_OP_RETURN || op > FAC_OP_DRAWDOWN) {
+		window = 0;
+	} else if (window < 1) {
+		return -1;
+	}
+
+	/* a node of the same op over the same nodes is shared */
+	for (i = 0; i < g->n; i++) {
+		nd = &g->nodes[i];
+		if (nd->op == op && nd->a == a && nd->b == b && nd->window == window && nd->arg == arg) {
+			return i;
+		}
+	}
+
+	if (g->n == g->cap) {
+		int cap = g->cap ? g->cap * 2 : 64;
+
+		if (cap > NODE_MAX || (nd = realloc(g->nodes, (size_t)cap * sizeof(*nd))) == NULL) {
+			return -1;
+		}
+		g->nodes = nd;
+		g->cap = cap;
+	}
+
+	nd = &g->nodes[g->n];
+	memset(nd, 0, sizeof(*nd));
+	nd->op = op;
+	nd->a = a;
+	nd->b = b;
+	nd->window = window;
+	nd->arg = arg;
+
+	return g->n++;
+}
+
+static const double *
+field(const eng_panel_t *p, int f)
+{
+	switch (f) {
+	case FAC_OPEN:
+		return p->open;
+	case FAC_HIGH:
+		return p->high;
+	case FAC_LOW:
+		return p->low;
+	case FAC_CLOSE:
+		return p->close;
+	case FAC_VOLUME:
+		return p->volume;
+	default:
+		return p->oi;
+	}
+}
+
+static void
+arith(int op, const double *restrict a, const double *restrict b, double arg,
+      double *restrict out, size_t n)
+{
+	size_t i;
+
+	switch (op) {
+	case FAC_OP_ADD:
+		for (i = 0; i < n; i++) {
+			out[i] = a[i] + b[i];
+		}
+		break;
+	case FAC_OP_SUB:
+		for (i = 0; i < n; i++) {
+			out[i] = a[i] - b[i];
+		}
+		break;
+	case FAC_OP_MUL:
+		for (i = 0; i < n; i++) {
+			out[i] = a[i] * b[i];
+		}
+		break;
+	case FAC_OP_DIV:
+		for (i = 0; i < n; i++) {
+			out[i] = a[i] / b[i];
+		}
+		break;
+	default:
+		for (i = 0; i < n; i++) {
+			out[i] = a[i] * arg;
+		}
+		break;
+	}
+}
+
+const double *
+fac_eval(fac_graph_t *g, int id)
+{
+	const eng_panel_t *p = g->panel;
+	size_t total = (size_t)p->ndates * p->nproducts;
+	const double *a = NULL, *b = NULL;
+	struct node *nd;
+	double *out;
+
+	if (id < 0 || id >= g->n) {
+		return NULL;
+	}
+	nd = &g->nodes[id];
+	if (nd->value != NULL) {
+		return nd->value;
+	}
+
+	if (nd->op == FAC_OP_FIELD) {
+		/* the fields are the panel's, not copied */
+		nd->value = field(p, (int)nd->arg);
+		return nd->value;
+	}
+
+	/* the nodes are created after their inputs, so the recursion ends */
+	if ((nd->a >= 0 && (a = fac_eval(g, nd->a)) == NULL) ||
+	    (nd->b >= 0 && (b = fac_eval(g, nd->b)) == NULL)) {
+		return NULL;
+	}
+	if (nd->op == FAC_OP_NEUTRALIZE && g->group == NULL) {
+		fprintf(stderr, "no groups to neutralize by\n");
+		return NULL;
+	}
+
+	/* the inputs may have grown the nodes */
+	nd = &g->nodes[id];
+	if ((out = malloc((total ? total : 1) * sizeof(*out))) == NULL) {
+		return NULL;
+	}
+
+	switch (nd->op) {
+	case FAC_OP_RETURN:
+		{
+			eng_panel_t view = *p;
+
+			view.close = (double *)a;
+			eng_returns(&view, nd->window, out);
+		}
+		break;
+	case FAC_OP_SUM:
+		fac_roll_sum(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_MEAN:
+		fac_roll_mean(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_STD:
+		fac_roll_std(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_MAX:
+		fac_roll_max(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_MIN:
+		fac_roll_min(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_DRAWDOWN:
+		fac_drawdown(a, out, p->ndates, p->nproducts, nd->window, nd->window);
+		break;
+	case FAC_OP_ZSCORE:
+		fac_zscore(a, out, p->ndates, p->nproducts);
+		break;
+	case FAC_OP_WINSORIZE:
+		fac_winsorize(a, out, p->ndates, p->nproducts, nd->arg);
+		break;
+	case FAC_OP_NEUTRALIZE:
+		fac_neutralize(a, out, p->ndates, p->nproducts, g->group, g->ngroups);
+		break;
+	default:
+		arith(nd->op, a, b, nd->arg, out, total);
+		break;
+	}
+
+	nd->out = out;
+	nd->value = out;
+	g->computed++;
+
+	return out;
+}
+
+int
+fac_graph_computed(const fac_graph_t *g)
+{
+	return g->computed;
+}
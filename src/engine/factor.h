@@ -0,0 +1,127 @@
+/*
+ * factor.h
+ *
+ * The header file contains the definition of the factor library and the
+ * functions' prototype.
+ *
+ * The kernels work on the date-major [date x product] matrices of a panel.
+ * The rolling kernels run along the dates with the state of every product
+ * side by side, so the inner loop is over the contiguous products and is
+ * vectorized by the compiler; sum, mean and std are O(1) per step, max, min
+ * and drawdown amortized O(1). The cross-sectional kernels work on one date
+ * row at a time. NaN is a missing value everywhere:
+ *
+ *	rolling     sum, mean, std of window dates, max, min, drawdown from
+ *		    the rolling max, NaN until min_periods values are in it
+ *	cross       z-score, percentile winsorize, neutralize by group
+ *
+ * A factor graph builds composite factors lazily: its nodes are the fields
+ * of the panel, the kernels and the arithmetic of other nodes, the same
+ * node is created once, and evaluating a node computes only the nodes it
+ * depends on, each once. A factor ranks the cross-section as well as the
+ * returns do, through eng_run_returns().
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __FACTOR_H__
+#define __FACTOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "engine.h"
+
+void fac_roll_sum(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+void fac_roll_mean(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+void fac_roll_std(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+void fac_roll_max(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+void fac_roll_min(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+
+/*
+ * fac_drawdown - x / (rolling max of x) - 1, zero or negative.
+ */
+void fac_drawdown(const double *x, double *out, uint32_t ndates, uint32_t n, int window, int min_periods);
+
+/*
+ * fac_zscore - (x - mean) / std of every date row, std with ddof 1 as pandas.
+ */
+void fac_zscore(const double *x, double *out, uint32_t ndates, uint32_t n);
+
+/*
+ * fac_winsorize - clip every date row to its pct and 1 - pct quantiles,
+ * interpolated linearly as pandas quantile().
+ */
+void fac_winsorize(const double *x, double *out, uint32_t ndates, uint32_t n, double pct);
+
+/*
+ * fac_neutralize - x less the mean of its group on every date row; group[]
+ * is the group of every product, 0 .. ngroups - 1, negative for none.
+ */
+void fac_neutralize(const double *x, double *out, uint32_t ndates, uint32_t n,
+		    const int32_t *group, uint32_t ngroups);
+
+enum fac_field {
+	FAC_OPEN = 0,
+	FAC_HIGH,
+	FAC_LOW,
+	FAC_CLOSE,
+	FAC_VOLUME,
+	FAC_OI,
+	FAC_NFIELD
+};
+
+enum fac_op {
+	FAC_OP_FIELD = 0,	/* arg: enum fac_field */
+	FAC_OP_RETURN,		/* window: bars of the product, as eng_returns() */
+	FAC_OP_SUM,		/* window */
+	FAC_OP_MEAN,
+	FAC_OP_STD,
+	FAC_OP_MAX,
+	FAC_OP_MIN,
+	FAC_OP_DRAWDOWN,
+	FAC_OP_ZSCORE,
+	FAC_OP_WINSORIZE,	/* arg: pct */
+	FAC_OP_NEUTRALIZE,	/* the groups of fac_graph_groups() */
+	FAC_OP_ADD,		/* a + b */
+	FAC_OP_SUB,
+	FAC_OP_MUL,
+	FAC_OP_DIV,
+	FAC_OP_SCALE,		/* a * arg */
+	FAC_OP_MAX_
+};
+
+typedef struct fac_graph fac_graph_t;
+
+fac_graph_t *fac_graph_create(const eng_panel_t *p);
+void fac_graph_free(fac_graph_t *g);
+
+/*
+ * fac_graph_groups - the groups of the products for FAC_OP_NEUTRALIZE.
+ */
+int fac_graph_groups(fac_graph_t *g, const int32_t *group, uint32_t ngroups);
+
+/*
+ * fac_node - the node of the op over the nodes a and b (-1 if unused),
+ * the existing one if it was created before. Returns the node, -1 on error.
+ * The rolling ops use window as min_periods, as pandas rolling() does.
+ */
+int fac_node(fac_graph_t *g, int op, int a, int b, int window, double arg);
+
+/*
+ * fac_eval - the matrix of the node, computed with what it depends on if
+ * not yet; it lives until the graph is freed or reset.
+ */
+const double *fac_eval(fac_graph_t *g, int node);
+
+/*
+ * fac_graph_reset - free the matrices computed, keeping the nodes, if the
+ * panel changed.
+ */
+void fac_graph_reset(fac_graph_t *g);
+
+/*
+ * fac_graph_computed - the nodes computed so far.
+ */
+int fac_graph_computed(const fac_graph_t *g);
+
+#endif		/* __FACTOR_H__ */
@@ -0,0 +1,211 @@
+/*
+ * optimize.c
+ *
+ * The program sweeps the parameters of the cross-sectional strategy over
+ * the bars of the column store, by grid or random search, writes the result
+ * table and prints the best combinations by sharpe.
+ *
+ *	optimize -r store -s 0.05:0.3:0.05 -n 1:20:1 -v 0,500,1000 -o 0,500 \
+ *		 -a 100000 -w sweep.jswp
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <getopt.h>
+#include "sweep.h"
+#include "colstore.h"
+
+#define TOP_MAX		100
+
+struct top
+{
+	pthread_mutex_t lock;
+	struct sweep_rec rec[TOP_MAX];
+	int n;
+	int k;
+	FILE *csv;
+};
+
+static void
+print_rec(FILE *fp, const struct sweep_rec *rec)
+{
+	fprintf(fp, "%lu,%.4f,%.0f,%.0f,%.0f,%.0f,%.0f,%.6f,%lu,%.2f,%.2f,%.2f,%.4f,%.4f\n",
+		rec->combo, rec->param[0], rec->param[1], rec->param[2], rec->param[3],
+		rec->param[4], rec->param[5], rec->param[6], rec->nsignals, rec->total_pnl,
+		rec->total_fee, rec->max_drawdown, rec->sharpe, rec->win_rate);
+}
+
+/*
+ * on_result - keep the k best by sharpe, sorted descending, and stream the
+ * records as CSV if asked.
+ */
+static void
+on_result(const struct sweep_rec *rec, void *arg)
+{
+	struct top *top = arg;
+	int i;
+
+	pthread_mutex_lock(&top->lock);
+
+	if (top->csv != NULL) {
+		print_rec(top->csv, rec);
+	}
+
+	if (top->n < top->k || (top->n > 0 && rec->sharpe > top->rec[top->n - 1].sharpe)) {
+		i = top->n < top->k ? top->n++ : top->n - 1;
+		while (i > 0 && top->rec[i - 1].sharpe < rec->sharpe) {
+			top->rec[i] = top->rec[i - 1];
+			i--;
+		}
+		top->rec[i] = *rec;
+	}
+
+	pthread_mutex_unlock(&top->lock);
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root [-e exchanges] [-p products] [-t type] [-s strength_pct]\n"
+		"       [-n ref_days] [-v vol_threshold] [-o oi_threshold] [-a trade_amount]\n"
+		"       [-H hold_days] [-f fee_rate] [-R samples] [-x seed] [-j threads]\n"
+		"       [-w table] [-c] [-k top]\n"
+		"  every parameter is a list \"a,b,c\" or a range \"lo:hi:step\"\n"
+		"  -R samples   random search of the samples between the least and the\n"
+		"               greatest values, instead of the grid\n"
+		"  -j threads   threads of the sweep, all the cores by default\n"
+		"  -w table     the result table\n"
+		"  -c           stream the results as CSV to stdout\n"
+		"  -k top       print the best by sharpe, 10 by default\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const char *const defaults[SWEEP_NPARAM] = {
+		"0.1", "5", "1000", "500", "100000", "10", "0",
+	};
+	static const char opts[SWEEP_NPARAM] = { 's', 'n', 'v', 'o', 'a', 'H', 'f' };
+	const char *root = NULL, *exchanges = NULL, *products = NULL;
+	const char *spec[SWEEP_NPARAM];
+	double *values[SWEEP_NPARAM] = { NULL };
+	struct sweep_conf conf;
+	struct sweep_stats st;
+	struct top top;
+	eng_panel_t *p;
+	int type = BAR_T_DAY, opt, i, n, rc = 1;
+
+	memcpy(spec, defaults, sizeof(spec));
+	memset(&conf, 0, sizeof(conf));
+	memset(&top, 0, sizeof(top));
+	pthread_mutex_init(&top.lock, NULL);
+	top.k = 10;
+
+	while ((opt = getopt(argc, argv, "r:e:p:t:s:n:v:o:a:H:f:R:x:j:w:ck:")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'e':
+			exchanges = optarg;
+			break;
+		case 'p':
+			products = optarg;
+			break;
+		case 't':
+			if ((type = bar_type_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown bar type %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'R':
+			conf.nsamples = strtoul(optarg, NULL, 10);
+			break;
+		case 'x':
+			conf.seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'j':
+			conf.threads = atoi(optarg);
+			break;
+		case 'w':
+			conf.output = optarg;
+			break;
+		case 'c':
+			top.csv = stdout;
+			break;
+		case 'k':
+			top.k = atoi(optarg);
+			top.k = top.k < 0 ? 0 : top.k > TOP_MAX ? TOP_MAX : top.k;
+			break;
+		default:
+			for (i = 0; i < SWEEP_NPARAM; i++) {
+				if (opt == opts[i]) {
+					spec[i] = optarg;
+					break;
+				}
+			}
+			if (i == SWEEP_NPARAM) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+	}
+
+	if (root == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < SWEEP_NPARAM; i++) {
+		if ((n = sweep_parse(spec[i], &values[i])) <= 0) {
+			fprintf(stderr, "bad values %s of %s\n", spec[i], sweep_param_names[i]);
+			goto out;
+		}
+		conf.values[i] = values[i];
+		conf.nvalues[i] = (size_t)n;
+	}
+	for (i = 0; i < (int)conf.nvalues[SWEEP_REF_DAYS]; i++) {
+		if (values[SWEEP_REF_DAYS][i] < 1) {
+			fprintf(stderr, "ref_days must be 1 or more\n");
+			goto out;
+		}
+	}
+
+	if ((p = eng_panel_load(root, type, exchanges, products)) == NULL) {
+		goto out;
+	}
+
+	conf.on_result = on_result;
+	conf.arg = &top;
+	if (top.csv != NULL) {
+		printf("combo");
+		for (i = 0; i < SWEEP_NPARAM; i++) {
+			printf(",%s", sweep_param_names[i]);
+		}
+		printf(",signals,pnl,fee,max_drawdown,sharpe,win_rate\n");
+	}
+
+	rc = sweep_run(p, &conf, &st) != 0;
+
+	fprintf(stderr, "%u dates x %u products, %lu of %lu combinations in %.3fs, "
+		"%lu failed, %lu returns, %lu steals\n",
+		p->ndates, p->nproducts, st.done, st.ncombos, st.seconds, st.failed,
+		st.returns, st.steals);
+	for (i = 0; i < top.n; i++) {
+		print_rec(stderr, &top.rec[i]);
+	}
+
+	eng_panel_free(p);
+out:
+	for (i = 0; i < SWEEP_NPARAM; i++) {
+		free(values[i]);
+	}
+
+	return rc;
+}
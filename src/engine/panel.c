@@ -0,0 +1,405 @@
+/*
+ * panel.c
+ *
+ * The functions are used to load the column store into the dense panel the
+ * engine runs over. The contracts of a product are folded bar by bar into
+ * its index, then the bars of all products are aligned on the union of
+ * their timestamps.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <dirent.h>
+#include "engine.h"
+#include "colstore.h"
+
+/*
+ * series - the index bars of one product before the alignment.
+ */
+struct series
+{
+	char exchange[ENG_NAME_LEN];
+	char product[ENG_NAME_LEN];
+	size_t n;
+	int64_t *timestamp;
+	int32_t *trading_day;
+	double *val[6];			/* open, high, low, close, volume, oi */
+};
+
+enum { V_OPEN, V_HIGH, V_LOW, V_CLOSE, V_VOLUME, V_OI };
+
+eng_panel_t *
+eng_panel_create(uint32_t ndates, uint32_t nproducts)
+{
+	size_t n = (size_t)ndates * nproducts, i;
+	eng_panel_t *p;
+
+	if ((p = calloc(1, sizeof(*p))) == NULL) {
+		return NULL;
+	}
+
+	p->ndates = ndates;
+	p->nproducts = nproducts;
+	p->timestamp = calloc(ndates ? ndates : 1, sizeof(*p->timestamp));
+	p->trading_day = calloc(ndates ? ndates : 1, sizeof(*p->trading_day));
+	p->exchange = calloc(nproducts ? nproducts : 1, sizeof(*p->exchange));
+	p->product = calloc(nproducts ? nproducts : 1, sizeof(*p->product));
+	p->open = malloc((n ? n : 1) * sizeof(double));
+	p->high = malloc((n ? n : 1) * sizeof(double));
+	p->low = malloc((n ? n : 1) * sizeof(double));
+	p->close = malloc((n ? n : 1) * sizeof(double));
+	p->volume = malloc((n ? n : 1) * sizeof(double));
+	p->oi = malloc((n ? n : 1) * sizeof(double));
+
+	if (p->timestamp == NULL || p->trading_day == NULL || p->exchange == NULL ||
+	    p->product == NULL || p->open == NULL || p->high == NULL || p->low == NULL ||
+	    p->close == NULL || p->volume == NULL || p->oi == NULL) {
+		eng_panel_free(p);
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++) {
+		p->open[i] = p->high[i] = p->low[i] = p->close[i] = NAN;
+		p->volume[i] = p->oi[i] = NAN;
+	}
+
+	return p;
+}
+
+void
+eng_panel_free(eng_panel_t *p)
+{
+	if (p == NULL) {
+		return;
+	}
+
+	free(p->timestamp);
+	free(p->trading_day);
+	free(p->exchange);
+	free(p->product);
+	free(p->open);
+	free(p->high);
+	free(p->low);
+	free(p->close);
+	free(p->volume);
+	free(p->oi);
+	free(p);
+}
+
+int
+eng_panel_find(const eng_panel_t *p, const char *product)
+{
+	uint32_t i;
+
+	for (i = 0; i < p->nproducts; i++) {
+		if (strcasecmp(p->product[i], product) == 0) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * in_list - whether the name is one of the comma separated list, NULL being
+ * all names.
+ */
+static int
+in_list(const char *list, const char *name)
+{
+	size_t len = strlen(name);
+	const char *p = list, *end;
+
+	if (list == NULL) {
+		return 1;
+	}
+
+	while (*p != '\0') {
+		end = strchr(p, ',');
+		if (end == NULL) {
+			end = p + strlen(p);
+		}
+		if ((size_t)(end - p) == len && strncasecmp(p, name, len) == 0) {
+			return 1;
+		}
+		p = *end == ',' ? end + 1 : end;
+	}
+
+	return 0;
+}
+
+static void
+series_free(struct series *s)
+{
+	int i;
+
+	free(s->timestamp);
+	free(s->trading_day);
+	for (i = 0; i < 6; i++) {
+		free(s->val[i]);
+	}
+}
+
+/*
+ * weighted - Σ(w_i * p_i) / Σw_i over the contracts priced, NaN if their
+ * weights add up to nothing.
+ */
+static inline double
+weighted(double sum, double weight)
+{
+	return weight > 0 ? sum / weight : NAN;
+}
+
+/*
+ * fold_file - the index bars of the contracts of one file, one bar for all
+ * the contracts ending at the same timestamp.
+ */
+static int
+fold_file(const col_file_t *f, struct series *s)
+{
+	uint64_t row = 0, end;
+	size_t n = 0;
+	int i;
+
+	s->timestamp = malloc((f->nrows ? f->nrows : 1) * sizeof(*s->timestamp));
+	s->trading_day = malloc((f->nrows ? f->nrows : 1) * sizeof(*s->trading_day));
+	for (i = 0; i < 6; i++) {
+		s->val[i] = malloc((f->nrows ? f->nrows : 1) * sizeof(double));
+	}
+	if (s->timestamp == NULL || s->trading_day == NULL || s->val[V_OPEN] == NULL ||
+	    s->val[V_HIGH] == NULL || s->val[V_LOW] == NULL || s->val[V_CLOSE] == NULL ||
+	    s->val[V_VOLUME] == NULL || s->val[V_OI] == NULL) {
+		return -1;
+	}
+
+	while (row < f->nrows) {
+		double sum[4] = { 0 }, weight[4] = { 0 }, volume = 0, oi = 0;
+		const double *px[4] = { f->open, f->high, f->low, f->close };
+
+		for (end = row; end < f->nrows && f->timestamp[end] == f->timestamp[row]; end++) {
+			double v = (double)f->volume[end];
+
+			volume += v;
+			oi += (double)f->oi[end];
+			for (i = 0; i < 4; i++) {
+				if (!isnan(px[i][end])) {
+					sum[i] += v * px[i][end];
+					weight[i] += v;
+				}
+			}
+		}
+
+		s->timestamp[n] = f->timestamp[row];
+		s->trading_day[n] = f->trading_day[row];
+		for (i = 0; i < 4; i++) {
+			s->val[i][n] = weighted(sum[i], weight[i]);
+		}
+		s->val[V_VOLUME][n] = volume;
+		s->val[V_OI][n] = oi;
+		n++;
+
+		row = end;
+	}
+	s->n = n;
+
+	return 0;
+}
+
+static int
+cmp_series(const void *a, const void *b)
+{
+	const struct series *x = a, *y = b;
+	int c = strcmp(x->exchange, y->exchange);
+
+	return c != 0 ? c : strcmp(x->product, y->product);
+}
+
+static int
+cmp_ts(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * load_exchange - append the series of the products of the exchange.
+ */
+static int
+load_exchange(const char *root, const char *exchange, int bar_type, const char *products,
+	      struct series **list, size_t *n, size_t *cap)
+{
+	char dir[4096], path[4096 + 256], suffix[64];
+	struct dirent *de;
+	struct series *s;
+	col_file_t f;
+	size_t len, slen;
+	DIR *dp;
+
+	snprintf(dir, sizeof(dir), "%s/%s", root, exchange);
+	slen = (size_t)snprintf(suffix, sizeof(suffix), ".%s%s", bar_type_names[bar_type], COL_SUFFIX);
+
+	if ((dp = opendir(dir)) == NULL) {
+		fprintf(stderr, "cannot open %s\n", dir);
+		return -1;
+	}
+
+	while ((de = readdir(dp)) != NULL) {
+		char product[ENG_NAME_LEN];
+
+		len = strlen(de->d_name);
+		if (len <= slen || len - slen >= ENG_NAME_LEN ||
+		    strcmp(de->d_name + len - slen, suffix) != 0) {
+			continue;
+		}
+		memcpy(product, de->d_name, len - slen);
+		product[len - slen] = '\0';
+		if (!in_list(products, product)) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (col_open(&f, path) != 0) {
+			fprintf(stderr, "cannot map %s\n", path);
+			continue;
+		}
+
+		if (*n == *cap) {
+			*cap = *cap ? *cap * 2 : 64;
+			if ((s = realloc(*list, *cap * sizeof(*s))) == NULL) {
+				col_close(&f);
+				closedir(dp);
+				return -1;
+			}
+			*list = s;
+		}
+
+		s = &(*list)[*n];
+		memset(s, 0, sizeof(*s));
+		snprintf(s->exchange, sizeof(s->exchange), "%s", exchange);
+		snprintf(s->product, sizeof(s->product), "%s", product);
+		if (fold_file(&f, s) != 0) {
+			series_free(s);
+			col_close(&f);
+			closedir(dp);
+			return -1;
+		}
+		col_close(&f);
+		(*n)++;
+	}
+	closedir(dp);
+
+	return 0;
+}
+
+/*
+ * align - the panel of the series on the union of their timestamps.
+ */
+static eng_panel_t *
+align(struct series *list, size_t n)
+{
+	size_t total = 0, ndates = 0, i, j, k;
+	int64_t *ts;
+	eng_panel_t *p;
+
+	for (i = 0; i < n; i++) {
+		total += list[i].n;
+	}
+	if ((ts = malloc((total ? total : 1) * sizeof(*ts))) == NULL) {
+		return NULL;
+	}
+	for (i = 0, k = 0; i < n; i++) {
+		memcpy(ts + k, list[i].timestamp, list[i].n * sizeof(*ts));
+		k += list[i].n;
+	}
+	qsort(ts, total, sizeof(*ts), cmp_ts);
+	for (i = 0; i < total; i++) {
+		if (ndates == 0 || ts[ndates - 1] != ts[i]) {
+			ts[ndates++] = ts[i];
+		}
+	}
+
+	if ((p = eng_panel_create((uint32_t)ndates, (uint32_t)n)) == NULL) {
+		free(ts);
+		return NULL;
+	}
+	memcpy(p->timestamp, ts, ndates * sizeof(*ts));
+	free(ts);
+
+	for (i = 0; i < n; i++) {
+		const struct series *s = &list[i];
+
+		memcpy(p->exchange[i], s->exchange, ENG_NAME_LEN);
+		memcpy(p->product[i], s->product, ENG_NAME_LEN);
+
+		/* both are ascending, so one walk places the series */
+		for (j = 0, k = 0; j < s->n; j++) {
+			size_t at;
+
+			while (p->timestamp[k] < s->timestamp[j]) {
+				k++;
+			}
+			at = ENG_AT(p, k, i);
+			p->trading_day[k] = s->trading_day[j];
+			p->open[at] = s->val[V_OPEN][j];
+			p->high[at] = s->val[V_HIGH][j];
+			p->low[at] = s->val[V_LOW][j];
+			p->close[at] = s->val[V_CLOSE][j];
+			p->volume[at] = s->val[V_VOLUME][j];
+			p->oi[at] = s->val[V_OI][j];
+		}
+	}
+
+	return p;
+}
+
+eng_panel_t *
+eng_panel_load(const char *root, int bar_type, const char *exchanges, const char *products)
+{
+	struct series *list = NULL;
+	size_t n = 0, cap = 0, i;
+	eng_panel_t *p = NULL;
+	struct dirent *de;
+	DIR *dp;
+	int rc = 0;
+
+	if ((unsigned int)bar_type >= BAR_T_MAX) {
+		return NULL;
+	}
+
+	if ((dp = opendir(root)) == NULL) {
+		fprintf(stderr, "cannot open store %s\n", root);
+		return NULL;
+	}
+	while (rc == 0 && (de = readdir(dp)) != NULL) {
+		if (de->d_name[0] == '.' || !in_list(exchanges, de->d_name)) {
+			continue;
+		}
+		if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN) {
+			continue;
+		}
+		rc = load_exchange(root, de->d_name, bar_type, products, &list, &n, &cap);
+	}
+	closedir(dp);
+
+	if (rc == 0) {
+		if (n == 0) {
+			fprintf(stderr, "no %s bars in %s\n", bar_type_names[bar_type], root);
+		} else {
+			qsort(list, n, sizeof(*list), cmp_series);
+			p = align(list, n);
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		series_free(&list[i]);
+	}
+	free(list);
+
+	return p;
+}
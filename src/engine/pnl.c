@@ -0,0 +1,345 @@
+/*
+ * pnl.c
+ *
+ * The program computes the daily pnl of the signals of a CSV file over the
+ * bars of the column store and writes the result file of portfolio.h, which
+ * the scripts of src/report read.
+ *
+ *	pnl -r store -t day -f 0.0001 -o pnl.jpnl signals.csv
+ *
+ * The columns are found by the header: date, product and position (long or
+ * short) are needed, amount, quantity, price and close_date are taken if
+ * there, so both signals.csv of cross-sectional.py and the signals of
+ * backtest -S are read. A position of an amount is amount // close lots,
+ * held hold_days dates.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include "portfolio.h"
+#include "colstore.h"
+
+#define CSV_LINE_MAX	4096
+#define FIELDS_MAX	64
+
+enum column {
+	SIG_DATE = 0,
+	SIG_PRODUCT,
+	SIG_POSITION,
+	SIG_AMOUNT,
+	SIG_QUANTITY,
+	SIG_PRICE,
+	SIG_CLOSE_DATE,
+	SIG_NCOLUMN
+};
+
+static const char *const column_names[SIG_NCOLUMN] = {
+	"date", "product", "position", "amount", "quantity", "price", "close_date"
+};
+
+static double
+elapsed(const struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static int
+split(char *line, char **fields)
+{
+	int n = 0;
+	char *s;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	for (s = line; n < FIELDS_MAX; s++) {
+		fields[n++] = s;
+		if ((s = strchr(s, ',')) == NULL) {
+			break;
+		}
+		*s = '\0';
+	}
+
+	return n;
+}
+
+/*
+ * parse_day - YYYYMMDD of "2025-01-02", "20250102" or "2025-01-02 00:00:00".
+ */
+static int32_t
+parse_day(const char *s)
+{
+	int32_t day = 0;
+	int n = 0;
+
+	for (; *s != '\0' && n < 8; s++) {
+		if (*s >= '0' && *s <= '9') {
+			day = day * 10 + (*s - '0');
+			n++;
+		} else if (*s != '-' && *s != '/') {
+			break;
+		}
+	}
+
+	return n == 8 ? day : -1;
+}
+
+/*
+ * find_date - the last row of the trading day, its close, -1 if none.
+ */
+static int64_t
+find_date(const eng_panel_t *p, int32_t day)
+{
+	uint32_t lo = 0, hi = p->ndates;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (p->trading_day[mid] <= day) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo > 0 && p->trading_day[lo - 1] == day ? (int64_t)lo - 1 : -1;
+}
+
+static struct eng_signal *
+read_signals(const char *path, const eng_panel_t *p, double amount, int hold, size_t *count,
+	     size_t *skipped)
+{
+	int col[SIG_NCOLUMN], nf, c, k;
+	char line[CSV_LINE_MAX], *f[FIELDS_MAX];
+	struct eng_signal *s = NULL, *t;
+	size_t n = 0, cap = 0, lineno = 1;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return NULL;
+	}
+	if (fgets(line, sizeof(line), fp) == NULL) {
+		fprintf(stderr, "%s is empty\n", path);
+		goto fail;
+	}
+
+	nf = split(line, f);
+	for (c = 0; c < SIG_NCOLUMN; c++) {
+		for (col[c] = -1, k = 0; k < nf; k++) {
+			if (strcasecmp(f[k], column_names[c]) == 0) {
+				col[c] = k;
+			}
+		}
+	}
+	if (col[SIG_DATE] < 0 || col[SIG_PRODUCT] < 0 || col[SIG_POSITION] < 0) {
+		fprintf(stderr, "%s has no date, product or position column\n", path);
+		goto fail;
+	}
+
+	*skipped = 0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		struct eng_signal sg;
+		double amt = amount;
+		int64_t date, close_date;
+		int product, direction;
+
+		lineno++;
+		if ((nf = split(line, f)) <= col[SIG_DATE] || nf <= col[SIG_PRODUCT] ||
+		    nf <= col[SIG_POSITION]) {
+			continue;
+		}
+		if (strcasecmp(f[col[SIG_POSITION]], "long") == 0) {
+			direction = ENG_LONG;
+		} else if (strcasecmp(f[col[SIG_POSITION]], "short") == 0) {
+			direction = ENG_SHORT;
+		} else {
+			fprintf(stderr, "%s:%zu: unknown position %s\n", path, lineno, f[col[SIG_POSITION]]);
+			goto fail;
+		}
+
+		date = find_date(p, parse_day(f[col[SIG_DATE]]));
+		product = eng_panel_find(p, f[col[SIG_PRODUCT]]);
+		if (col[SIG_AMOUNT] >= 0 && col[SIG_AMOUNT] < nf) {
+			amt = atof(f[col[SIG_AMOUNT]]);
+		}
+		if (date < 0 || product < 0 ||
+		    pf_position(p, (uint32_t)date, (uint32_t)product, direction, amt, hold, &sg) != 0) {
+			(*skipped)++;
+			continue;
+		}
+
+		/* what the file says over what the panel gives */
+		if (col[SIG_PRICE] >= 0 && col[SIG_PRICE] < nf) {
+			sg.price = atof(f[col[SIG_PRICE]]);
+			sg.quantity = floor(amt / sg.price);
+		}
+		if (col[SIG_QUANTITY] >= 0 && col[SIG_QUANTITY] < nf) {
+			sg.quantity = atof(f[col[SIG_QUANTITY]]);
+		}
+		if (col[SIG_CLOSE_DATE] >= 0 && col[SIG_CLOSE_DATE] < nf) {
+			if ((close_date = find_date(p, parse_day(f[col[SIG_CLOSE_DATE]]))) < date) {
+				(*skipped)++;
+				continue;
+			}
+			sg.close_date = (int32_t)close_date;
+		}
+
+		if (n == cap) {
+			cap = cap ? cap * 2 : 4096;
+			if ((t = realloc(s, cap * sizeof(*s))) == NULL) {
+				fprintf(stderr, "out of memory\n");
+				goto fail;
+			}
+			s = t;
+		}
+		s[n++] = sg;
+	}
+
+	fclose(fp);
+	*count = n;
+	if (s == NULL) {
+		s = malloc(sizeof(*s));
+	}
+	return s;
+
+fail:
+	fclose(fp);
+	free(s);
+	return NULL;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root -o output [-e exchanges] [-p products] [-t type]\n"
+		"       [-a trade_amount] [-H hold_days] [-f fee_rate] signals.csv\n"
+		"  -r root      root directory of the column store\n"
+		"  -o output    the result file\n"
+		"  -e, -p       comma separated exchanges and products, all by default\n"
+		"  -t type      bar type of the files, day by default\n"
+		"  -a amount    amount of a signal without an amount column, 100000 by default\n"
+		"  -H days      dates a position is held without a close_date column\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *root = NULL, *exchanges = NULL, *products = NULL, *output = NULL;
+	double amount = 100000, fee_rate = 0, load;
+	struct eng_signal *s = NULL;
+	size_t n = 0, skipped = 0;
+	struct pf_result r;
+	struct timespec t0;
+	int type = BAR_T_DAY, hold = ENG_HOLD_DAYS, opt, m, rc = 1;
+	size_t cells;
+	eng_panel_t *p;
+
+	while ((opt = getopt(argc, argv, "r:o:e:p:t:a:H:f:")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'e':
+			exchanges = optarg;
+			break;
+		case 'p':
+			products = optarg;
+			break;
+		case 't':
+			if ((type = bar_type_parse(optarg)) < 0) {
+				fprintf(stderr, "unknown bar type %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'a':
+			amount = atof(optarg);
+			break;
+		case 'H':
+			hold = atoi(optarg);
+			break;
+		case 'f':
+			fee_rate = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || output == NULL || optind + 1 != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if ((p = eng_panel_load(root, type, exchanges, products)) == NULL) {
+		return 1;
+	}
+	if ((s = read_signals(argv[optind], p, amount, hold, &n, &skipped)) == NULL) {
+		eng_panel_free(p);
+		return 1;
+	}
+	load = elapsed(&t0);
+
+	memset(&r, 0, sizeof(r));
+	cells = (size_t)p->ndates * p->nproducts;
+	r.days = malloc((p->ndates ? p->ndates : 1) * sizeof(*r.days));
+	r.products = malloc((p->nproducts ? p->nproducts : 1) * sizeof(*r.products));
+	r.curve_cap = p->ndates ? p->ndates : 1;
+	r.curve = malloc(r.curve_cap * sizeof(*r.curve));
+	for (m = 0; m < PF_NMATRIX; m++) {
+		r.matrix[m] = malloc((cells ? cells : 1) * sizeof(double));
+	}
+	if (r.days == NULL || r.products == NULL || r.curve == NULL) {
+		fprintf(stderr, "out of memory\n");
+		goto out;
+	}
+	for (m = 0; m < PF_NMATRIX; m++) {
+		if (r.matrix[m] == NULL) {
+			fprintf(stderr, "out of memory\n");
+			goto out;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (pf_run(p, s, n, fee_rate, &r) != 0) {
+		goto out;
+	}
+	r.summary.skipped += skipped;
+
+	fprintf(stderr, "%u dates x %u products and %zu signals loaded in %.3fs, run in %.3fs\n",
+		p->ndates, p->nproducts, n + skipped, load, elapsed(&t0));
+	fprintf(stderr, "positions %lu skipped %lu pnl %.2f fee %.2f turnover %.2f max_drawdown %.2f "
+		"sharpe %.3f win_rate %.3f\n",
+		(unsigned long)r.summary.npositions, (unsigned long)r.summary.skipped,
+		r.summary.total_pnl, r.summary.total_fee, r.summary.turnover,
+		r.summary.max_drawdown, r.summary.sharpe, r.summary.win_rate);
+
+	rc = pf_write(output, p, fee_rate, &r) != 0;
+
+out:
+	for (m = 0; m < PF_NMATRIX; m++) {
+		free(r.matrix[m]);
+	}
+	free(r.days);
+	free(r.products);
+	free(r.curve);
+	free(s);
+	eng_panel_free(p);
+
+	return rc;
+}
@@ -0,0 +1,313 @@
+/*
+ * portfolio.c
+ *
+ * The functions are used to compute the daily pnl of a book of positions
+ * over a panel: the positions go into the difference matrices, one pass of
+ * the dates sums them into the lots held, marks them and sums the dates and
+ * the products, and the result is written to the file of portfolio.h.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "portfolio.h"
+
+const char *const pf_matrix_names[PF_NMATRIX] = {
+	"long_pnl", "short_pnl", "close_pnl", "turnover", "long_lots", "short_lots"
+};
+
+int
+pf_position(const eng_panel_t *p, uint32_t date, uint32_t product, int32_t direction,
+	    double amount, int hold, struct eng_signal *s)
+{
+	uint32_t h = hold > 0 ? (uint32_t)hold : ENG_HOLD_DAYS;
+	double price;
+
+	if (date >= p->ndates || product >= p->nproducts) {
+		return -1;
+	}
+	price = p->close[ENG_AT(p, date, product)];
+	if (isnan(price) || price <= 0) {
+		return -1;
+	}
+
+	s->date = date;
+	s->product = product;
+	s->direction = direction > 0 ? ENG_LONG : ENG_SHORT;
+	s->close_date = date + h < p->ndates ? (int32_t)(date + h) : (int32_t)p->ndates - 1;
+	s->ret = 0;
+	s->price = price;
+	s->quantity = floor(amount / price);
+
+	return 0;
+}
+
+/*
+ * fill_marks - the last close of every cell, 0 before the first bar of the
+ * product, so a difference of marks times no lots is always 0.
+ */
+static void
+fill_marks(const eng_panel_t *p, double *mark)
+{
+	uint32_t d, i, np = p->nproducts;
+
+	for (d = 0; d < p->ndates; d++) {
+		const double *close = p->close + ENG_AT(p, d, 0);
+		double *m = mark + ENG_AT(p, d, 0);
+
+		const double *prev = d > 0 ? m - np : NULL;
+
+		for (i = 0; i < np; i++) {
+			m[i] = !isnan(close[i]) ? close[i] : prev != NULL ? prev[i] : 0;
+		}
+	}
+}
+
+/*
+ * add_curve - the marks of the position's dates into the response curve.
+ */
+static void
+add_curve(const eng_panel_t *p, const double *mark, const struct eng_signal *s, double dir,
+	  struct pf_result *r)
+{
+	uint32_t k, span = (uint32_t)s->close_date - s->date + 1;
+
+	if (span > r->ncurve) {
+		r->ncurve = span;
+	}
+	if (r->curve == NULL) {
+		return;
+	}
+
+	for (k = 0; k < span && k < r->curve_cap; k++) {
+		double ret = dir * (mark[ENG_AT(p, s->date + k, s->product)] / s->price - 1);
+		struct pf_curve *c = &r->curve[k];
+
+		c->n++;
+		c->mean_ret += ret;
+		c->hit_rate += ret > 0;
+		c->mean_pnl += ret * s->price * s->quantity;
+	}
+}
+
+int
+pf_run(const eng_panel_t *p, const struct eng_signal *s, size_t n, double fee_rate,
+       struct pf_result *r)
+{
+	uint32_t nd = p->ndates, np = p->nproducts, d, i, first = nd;
+	size_t cells = (size_t)nd * np, k, nbuf = 3, wins = 0;
+	double *buf, *mark, *cnet, *cgross, *daily, *zero, *mx[PF_NMATRIX], *next;
+	struct pf_summary *sum = &r->summary;
+	double cum = 0, peak = 0;
+	int m, rc = -1;
+
+	for (m = 0; m < PF_NMATRIX; m++) {
+		nbuf += r->matrix[m] == NULL;
+	}
+	/* the matrices not kept, the marks, the lots closed, the daily pnl and a row of 0 */
+	if ((buf = calloc(cells * nbuf + nd + np + 1, sizeof(*buf))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+	next = buf;
+	mark = next, next += cells;
+	cnet = next, next += cells;
+	cgross = next, next += cells;
+	for (m = 0; m < PF_NMATRIX; m++) {
+		if ((mx[m] = r->matrix[m]) == NULL) {
+			mx[m] = next, next += cells;
+		} else {
+			memset(mx[m], 0, cells * sizeof(*mx[m]));
+		}
+	}
+	daily = next, next += nd;
+	zero = next;
+
+	memset(sum, 0, sizeof(*sum));
+	memset(r->days, 0, nd * sizeof(*r->days));
+	memset(r->products, 0, np * sizeof(*r->products));
+	if (r->curve != NULL) {
+		memset(r->curve, 0, r->curve_cap * sizeof(*r->curve));
+	}
+	r->ncurve = 0;
+	for (i = 0; i < np; i++) {
+		memcpy(r->products[i].exchange, p->exchange[i], ENG_NAME_LEN);
+		memcpy(r->products[i].product, p->product[i], ENG_NAME_LEN);
+	}
+
+	fill_marks(p, mark);
+
+	/* the intervals into the difference matrices, the lots closed on the close date */
+	for (k = 0; k < n; k++) {
+		const struct eng_signal *sg = &s[k];
+		double dir = sg->direction > 0 ? 1 : -1, q = sg->quantity, adj;
+		size_t o, c;
+
+		if (sg->date >= nd || sg->product >= np || sg->close_date < (int32_t)sg->date ||
+		    sg->close_date >= (int32_t)nd) {
+			fprintf(stderr, "position %zu is off the panel\n", k);
+			goto out;
+		}
+		o = ENG_AT(p, sg->date, sg->product);
+		c = ENG_AT(p, sg->close_date, sg->product);
+		if (!(sg->price > 0) || !(q > 0) || mark[o] <= 0) {
+			sum->skipped++;
+			continue;
+		}
+
+		adj = dir * q * (mark[o] - sg->price);
+		mx[dir > 0 ? PF_LONG_LOTS : PF_SHORT_LOTS][o] += q;
+		mx[dir > 0 ? PF_LONG_LOTS : PF_SHORT_LOTS][c] -= q;
+		mx[dir > 0 ? PF_LONG_PNL : PF_SHORT_PNL][o] += adj;
+		mx[PF_TURNOVER][o] += q * sg->price;
+		cgross[c] += q;
+		if (c != o) {
+			cnet[c] += dir * q;
+		} else {
+			mx[PF_CLOSE_PNL][o] += adj;
+		}
+
+		r->days[sg->date].opened++;
+		r->products[sg->product].npositions++;
+		if (dir * (mark[c] - sg->price) > 0) {
+			r->products[sg->product].wins++;
+			wins++;
+		}
+		sum->npositions++;
+		if (sg->date < first) {
+			first = sg->date;
+		}
+		add_curve(p, mark, sg, dir, r);
+	}
+
+	/* one pass of the dates: lots held, marked pnl, turnover and fees */
+	for (d = 0; d < nd; d++) {
+		const double *mk = mark + ENG_AT(p, d, 0), *cn = cnet + ENG_AT(p, d, 0);
+		const double *cg = cgross + ENG_AT(p, d, 0);
+		double *lpnl = mx[PF_LONG_PNL] + ENG_AT(p, d, 0), *spnl = mx[PF_SHORT_PNL] + ENG_AT(p, d, 0);
+		double *cpnl = mx[PF_CLOSE_PNL] + ENG_AT(p, d, 0), *tov = mx[PF_TURNOVER] + ENG_AT(p, d, 0);
+		double *lots = mx[PF_LONG_LOTS] + ENG_AT(p, d, 0), *shorts = mx[PF_SHORT_LOTS] + ENG_AT(p, d, 0);
+		const double *pm = d > 0 ? mk - np : zero, *pl = d > 0 ? lots - np : zero;
+		const double *ps = d > 0 ? shorts - np : zero;
+		struct pf_day *day = &r->days[d];
+
+		for (i = 0; i < np; i++) {
+			double dm = mk[i] - pm[i], held_l = pl[i], held_s = ps[i];
+			struct pf_product *pr = &r->products[i];
+			double fee;
+
+			lpnl[i] += held_l * dm;
+			spnl[i] -= held_s * dm;
+			cpnl[i] += cn[i] * dm;
+			tov[i] += cg[i] * mk[i];
+			lots[i] += held_l;
+			shorts[i] += held_s;
+			fee = tov[i] * fee_rate;
+
+			day->long_pnl += lpnl[i];
+			day->short_pnl += spnl[i];
+			day->close_pnl += cpnl[i];
+			day->turnover += tov[i];
+			day->nlong += lots[i] > 0;
+			day->nshort += shorts[i] > 0;
+			day->long_value += lots[i] * mk[i];
+			day->short_value += shorts[i] * mk[i];
+
+			pr->long_pnl += lpnl[i];
+			pr->short_pnl += spnl[i];
+			pr->close_pnl += cpnl[i];
+			pr->fee += fee;
+			pr->turnover += tov[i];
+			pr->days_held += lots[i] > 0 || shorts[i] > 0;
+		}
+
+		day->trading_day = p->trading_day[d];
+		day->fee = day->turnover * fee_rate;
+		day->pnl = day->long_pnl + day->short_pnl - day->fee;
+		daily[d] = day->pnl;
+		sum->total_fee += day->fee;
+		sum->turnover += day->turnover;
+	}
+
+	for (d = first; d < nd; d++) {
+		cum += daily[d];
+		if (cum > peak) {
+			peak = cum;
+		}
+		r->days[d].cum_pnl = cum;
+		r->days[d].drawdown = peak - cum;
+	}
+	for (i = 0; i < np; i++) {
+		r->products[i].pnl = r->products[i].long_pnl + r->products[i].short_pnl - r->products[i].fee;
+	}
+	eng_stats(daily, first, nd, &sum->total_pnl, &sum->max_drawdown, &sum->sharpe);
+	sum->win_rate = sum->npositions ? (double)wins / sum->npositions : 0;
+
+	for (k = 0; r->curve != NULL && k < r->ncurve && k < r->curve_cap; k++) {
+		struct pf_curve *c = &r->curve[k];
+
+		c->day = (uint32_t)k;
+		if (c->n > 0) {
+			c->mean_ret /= c->n;
+			c->hit_rate /= c->n;
+			c->mean_pnl /= c->n;
+		}
+	}
+	rc = 0;
+
+out:
+	free(buf);
+	return rc;
+}
+
+int
+pf_write(const char *path, const eng_panel_t *p, double fee_rate, const struct pf_result *r)
+{
+	size_t cells = (size_t)p->ndates * p->nproducts;
+	struct pf_hdr hdr;
+	FILE *fp;
+	int m, ok;
+
+	for (m = 0; m < PF_NMATRIX; m++) {
+		if (r->matrix[m] == NULL) {
+			fprintf(stderr, "the result keeps no %s\n", pf_matrix_names[m]);
+			return -1;
+		}
+	}
+	if ((fp = fopen(path, "wb")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = PF_MAGIC;
+	hdr.version = PF_VERSION;
+	hdr.ndates = p->ndates;
+	hdr.nproducts = p->nproducts;
+	hdr.ncurve = r->curve == NULL ? 0 : r->ncurve < r->curve_cap ? r->ncurve : r->curve_cap;
+	hdr.nmatrix = PF_NMATRIX;
+	hdr.day_size = sizeof(struct pf_day);
+	hdr.product_size = sizeof(struct pf_product);
+	hdr.first_day = p->ndates ? p->trading_day[0] : 0;
+	hdr.last_day = p->ndates ? p->trading_day[p->ndates - 1] : 0;
+	hdr.fee_rate = fee_rate;
+
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+	     fwrite(&r->summary, sizeof(r->summary), 1, fp) == 1 &&
+	     fwrite(r->days, sizeof(*r->days), p->ndates, fp) == p->ndates &&
+	     fwrite(r->products, sizeof(*r->products), p->nproducts, fp) == p->nproducts &&
+	     fwrite(r->curve, sizeof(*r->curve), hdr.ncurve, fp) == hdr.ncurve;
+	for (m = 0; ok && m < PF_NMATRIX; m++) {
+		ok = fwrite(r->matrix[m], sizeof(double), cells, fp) == cells;
+	}
+
+	if (fclose(fp) != 0 || !ok) {
+		fprintf(stderr, "cannot write %s\n", path);
+		return -1;
+	}
+
+	return 0;
+}
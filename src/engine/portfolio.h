@@ -0,0 +1,178 @@
+/*
+ * portfolio.h
+ *
+ * The header file contains the definition of the daily pnl of a book of
+ * positions over a panel, the result file it is written to and the
+ * functions' prototype.
+ *
+ * A position is an interval of the rows of a product, the eng_signal of the
+ * engine: opened at its price on the date, marked to the close of the panel
+ * and closed at the close of close_date. The positions are added into
+ * difference matrices of [date x product], the lots opened minus the lots
+ * closed, so one pass of the dates sums them into the lots held and marks
+ * them, however many positions there are:
+ *
+ *	pnl        lots held on the date before * (mark - mark the date before),
+ *		   plus lots * (mark - price) on the date opened
+ *	turnover   lots * price opened plus lots * mark closed, fee_rate of it
+ *
+ * The mark is the last close, a product without a bar keeps its mark. The
+ * result file holds all of it:
+ *
+ *	header    struct pf_hdr
+ *	summary   struct pf_summary
+ *	days      struct pf_day [ndates]
+ *	products  struct pf_product [nproducts]
+ *	curve     struct pf_curve [ncurve]
+ *	matrices  double [PF_NMATRIX][ndates * nproducts], date-major
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __PORTFOLIO_H__
+#define __PORTFOLIO_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "engine.h"
+
+#define PF_MAGIC	0x4c504e4aU	/* "JPNL" */
+#define PF_VERSION	1
+
+/* the [date x product] matrices of a result */
+enum pf_matrix {
+	PF_LONG_PNL = 0,		/* marked pnl of the long lots, before fees */
+	PF_SHORT_PNL,
+	PF_CLOSE_PNL,			/* the part of the positions closed on the date */
+	PF_TURNOVER,			/* amount traded */
+	PF_LONG_LOTS,			/* lots held at the close */
+	PF_SHORT_LOTS,
+	PF_NMATRIX
+};
+
+extern const char *const pf_matrix_names[PF_NMATRIX];
+
+struct pf_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ndates;
+	uint32_t nproducts;
+	uint32_t ncurve;
+	uint32_t nmatrix;
+	uint32_t day_size;
+	uint32_t product_size;
+	int32_t first_day;		/* trading days of the panel */
+	int32_t last_day;
+	double fee_rate;
+	uint8_t reserved[16];
+};
+
+_Static_assert(sizeof(struct pf_hdr) == 64, "pf_hdr is part of the file format");
+
+struct pf_summary
+{
+	uint64_t npositions;
+	uint64_t skipped;		/* signals without a price */
+	double total_pnl;		/* net of fees */
+	double total_fee;
+	double turnover;
+	double max_drawdown;		/* of the cumulated pnl */
+	double sharpe;			/* mean / std of the daily pnl, times sqrt(252) */
+	double win_rate;		/* of the positions */
+};
+
+_Static_assert(sizeof(struct pf_summary) == 64, "pf_summary is part of the file format");
+
+struct pf_day
+{
+	int32_t trading_day;
+	int32_t nlong;			/* products held long */
+	int32_t nshort;
+	int32_t opened;			/* positions opened */
+	double pnl;			/* net of fees */
+	double long_pnl;
+	double short_pnl;
+	double close_pnl;
+	double fee;
+	double turnover;
+	double long_value;		/* lots held * mark */
+	double short_value;
+	double cum_pnl;
+	double drawdown;		/* from the peak of cum_pnl */
+};
+
+_Static_assert(sizeof(struct pf_day) == 96, "pf_day is part of the file format");
+
+struct pf_product
+{
+	char exchange[ENG_NAME_LEN];
+	char product[ENG_NAME_LEN];
+	uint32_t npositions;
+	uint32_t wins;
+	uint32_t days_held;
+	uint32_t reserved;
+	double pnl;			/* net of fees */
+	double long_pnl;
+	double short_pnl;
+	double close_pnl;
+	double fee;
+	double turnover;
+};
+
+_Static_assert(sizeof(struct pf_product) == 96, "pf_product is part of the file format");
+
+/*
+ * pf_curve - the response of the positions day dates after they are opened,
+ * of those still held.
+ */
+struct pf_curve
+{
+	uint32_t day;
+	uint32_t n;
+	double mean_ret;		/* direction * (mark / price - 1) */
+	double hit_rate;		/* of mean_ret > 0 */
+	double mean_pnl;
+};
+
+_Static_assert(sizeof(struct pf_curve) == 32, "pf_curve is part of the file format");
+
+/*
+ * pf_result - what pf_run() gives back. days and products are sized by the
+ * panel, curve holds up to curve_cap dates, ncurve is the longest holding
+ * plus one. A matrix may be NULL, when it is not kept.
+ */
+struct pf_result
+{
+	struct pf_summary summary;
+	struct pf_day *days;
+	struct pf_product *products;
+	struct pf_curve *curve;
+	uint32_t curve_cap;
+	uint32_t ncurve;
+	double *matrix[PF_NMATRIX];
+};
+
+/*
+ * pf_position - the signal of amount on the product opened at the close of
+ * the date and held hold dates, 0 for ENG_HOLD_DAYS, as match_signals.py
+ * takes them. Returns 0, -1 if the product has no bar on the date.
+ */
+int pf_position(const eng_panel_t *p, uint32_t date, uint32_t product, int32_t direction,
+		double amount, int hold, struct eng_signal *s);
+
+/*
+ * pf_run - the daily pnl of the positions. The signals of a position with
+ * no price or lots are counted as skipped. Returns 0, -1 if a position is
+ * off the panel or out of memory.
+ */
+int pf_run(const eng_panel_t *p, const struct eng_signal *s, size_t n, double fee_rate,
+	   struct pf_result *r);
+
+/*
+ * pf_write - the result file of a result with all of its matrices.
+ */
+int pf_write(const char *path, const eng_panel_t *p, double fee_rate, const struct pf_result *r);
+
+#endif		/* __PORTFOLIO_H__ */
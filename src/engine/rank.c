@@ -0,0 +1,245 @@
+/*
+ * rank.c
+ *
+ * The functions are used to select the lowest and the highest returns of
+ * the cross-section by quickselect over the products a mask lets through.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rank.h"
+
+#define SMALL	16		/* ranges sorted by insertion */
+
+xs_rank_t *
+xs_rank_create(uint32_t n)
+{
+	xs_rank_t *r;
+	uint32_t i;
+
+	if ((r = calloc(1, sizeof(*r))) == NULL) {
+		return NULL;
+	}
+
+	r->n = n;
+	r->nwords = XS_WORDS(n);
+	r->value = malloc((n ? n : 1) * sizeof(*r->value));
+	r->valid = calloc(r->nwords ? r->nwords : 1, sizeof(*r->valid));
+	r->scratch = malloc((n ? n : 1) * sizeof(*r->scratch));
+	if (r->value == NULL || r->valid == NULL || r->scratch == NULL) {
+		xs_rank_free(r);
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++) {
+		r->value[i] = NAN;
+	}
+
+	return r;
+}
+
+void
+xs_rank_free(xs_rank_t *r)
+{
+	if (r == NULL) {
+		return;
+	}
+
+	free(r->value);
+	free(r->valid);
+	free(r->scratch);
+	free(r);
+}
+
+void
+xs_rank_load(xs_rank_t *r, const double *value)
+{
+	uint32_t w, i;
+
+	memcpy(r->value, value, r->n * sizeof(*value));
+	for (w = 0; w < r->nwords; w++) {
+		uint32_t base = w * 64, end = base + 64 < r->n ? base + 64 : r->n;
+		uint64_t bits = 0;
+
+		for (i = base; i < end; i++) {
+			bits |= (uint64_t)(value[i] == value[i]) << (i - base);
+		}
+		r->valid[w] = bits;
+	}
+}
+
+void
+xs_mask_ge(uint64_t *mask, const double *value, double threshold, uint32_t n)
+{
+	uint32_t w, i;
+
+	for (w = 0; w < XS_WORDS(n); w++) {
+		uint32_t base = w * 64, end = base + 64 < n ? base + 64 : n;
+		uint64_t bits = 0;
+
+		for (i = base; i < end; i++) {
+			bits |= (uint64_t)(value[i] >= threshold) << (i - base);
+		}
+		mask[w] = bits;
+	}
+}
+
+void
+xs_mask_gt(uint64_t *mask, const double *value, double threshold, uint32_t n)
+{
+	uint32_t w, i;
+
+	for (w = 0; w < XS_WORDS(n); w++) {
+		uint32_t base = w * 64, end = base + 64 < n ? base + 64 : n;
+		uint64_t bits = 0;
+
+		for (i = base; i < end; i++) {
+			bits |= (uint64_t)(value[i] > threshold) << (i - base);
+		}
+		mask[w] = bits;
+	}
+}
+
+/* the order of the ranking: by value, then by index */
+static inline int
+before(const double *v, uint32_t a, uint32_t b)
+{
+	return v[a] < v[b] || (v[a] == v[b] && a < b);
+}
+
+static void
+insertion_sort(const double *v, uint32_t *idx, uint32_t n)
+{
+	uint32_t i, j, x;
+
+	for (i = 1; i < n; i++) {
+		x = idx[i];
+		for (j = i; j > 0 && before(v, x, idx[j - 1]); j--) {
+			idx[j] = idx[j - 1];
+		}
+		idx[j] = x;
+	}
+}
+
+static int
+cmp_index(const void *a, const void *b, void *arg)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return before(arg, x, y) ? -1 : before(arg, y, x);
+}
+
+static void
+sort_index(const double *v, uint32_t *idx, uint32_t n)
+{
+	if (n <= SMALL) {
+		insertion_sort(v, idx, n);
+	} else {
+		qsort_r(idx, n, sizeof(*idx), cmp_index, (void *)v);
+	}
+}
+
+static inline void
+swap(uint32_t *a, uint32_t *b)
+{
+	uint32_t t = *a;
+
+	*a = *b;
+	*b = t;
+}
+
+/*
+ * select_nth - reorder idx[0, n) so that idx[k] is the k-th and those before
+ * it are not after it, as std::nth_element.
+ */
+static void
+select_nth(const double *v, uint32_t *idx, uint32_t n, uint32_t k)
+{
+	uint32_t lo = 0, hi = n;
+
+	while (hi - lo > SMALL) {
+		uint32_t mid = lo + (hi - lo) / 2, i, j, pivot;
+
+		/* median of three into lo */
+		if (before(v, idx[mid], idx[lo])) {
+			swap(&idx[mid], &idx[lo]);
+		}
+		if (before(v, idx[hi - 1], idx[lo])) {
+			swap(&idx[hi - 1], &idx[lo]);
+		}
+		if (before(v, idx[hi - 1], idx[mid])) {
+			swap(&idx[hi - 1], &idx[mid]);
+		}
+		swap(&idx[lo], &idx[mid]);
+		pivot = idx[lo];
+
+		/* the order is total, so no element equals the pivot but itself */
+		for (i = lo + 1, j = hi - 1;;) {
+			while (i <= j && before(v, idx[i], pivot)) {
+				i++;
+			}
+			while (i <= j && before(v, pivot, idx[j])) {
+				j--;
+			}
+			if (i >= j) {
+				break;
+			}
+			swap(&idx[i++], &idx[j--]);
+		}
+		swap(&idx[lo], &idx[j]);
+
+		if (j == k) {
+			return;
+		}
+		if (k < j) {
+			hi = j;
+		} else {
+			lo = j + 1;
+		}
+	}
+
+	insertion_sort(v, idx + lo, hi - lo);
+}
+
+uint32_t
+xs_rank_select(xs_rank_t *r, const uint64_t *mask, double pct, uint32_t *lo, uint32_t *hi,
+	       uint32_t *m)
+{
+	uint32_t *idx = r->scratch, w, n = 0, k;
+	double x;
+
+	for (w = 0; w < r->nwords; w++) {
+		uint64_t bits = r->valid[w] & (mask != NULL ? mask[w] : ~0ULL);
+
+		while (bits != 0) {
+			idx[n++] = w * 64 + (uint32_t)__builtin_ctzll(bits);
+			bits &= bits - 1;
+		}
+	}
+
+	*m = n;
+	if (n == 0) {
+		return 0;
+	}
+
+	x = n * pct;
+	k = x < 1 ? 1 : x >= n ? n : (uint32_t)x;
+
+	if (k < n) {
+		select_nth(r->value, idx, n, k);
+	}
+	memcpy(lo, idx, k * sizeof(*lo));
+	sort_index(r->value, lo, k);
+
+	if (k < n) {
+		select_nth(r->value, idx, n, n - k);
+	}
+	memcpy(hi, idx + n - k, k * sizeof(*hi));
+	sort_index(r->value, hi, k);
+
+	return k;
+}
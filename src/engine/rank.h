@@ -0,0 +1,91 @@
+/*
+ * rank.h
+ *
+ * The header file contains the definition of the cross-sectional ranking
+ * and the functions' prototype.
+ *
+ * The ranking keeps the latest return of every product of the universe,
+ * updated one product at a time as its bars come, and selects the lowest
+ * and the highest of the products a filter lets through. The filters are
+ * bitmasks of the universe, a bit per product, so the thresholds are a
+ * compare per product and an AND per 64 of them. The selection is partial,
+ * a quickselect of the k-th, so a selection is O(n) instead of the sort of
+ * the universe, and only the 2k selected are sorted.
+ *
+ * The products are ordered by return and then by index, the same order as
+ * a full sort, so the selection is the same.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __RANK_H__
+#define __RANK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define XS_WORDS(n)	(((n) + 63) / 64)
+
+typedef struct xs_rank
+{
+	uint32_t n;			/* products of the universe */
+	uint32_t nwords;		/* of a mask */
+	double *value;			/* [n], the latest return */
+	uint64_t *valid;		/* products with a return, not NaN */
+	uint32_t *scratch;		/* [n] */
+} xs_rank_t;
+
+xs_rank_t *xs_rank_create(uint32_t n);
+void xs_rank_free(xs_rank_t *r);
+
+/*
+ * xs_rank_set - the return of one product, NaN for none.
+ */
+static inline void
+xs_rank_set(xs_rank_t *r, uint32_t i, double value)
+{
+	uint64_t bit = 1ULL << (i & 63);
+
+	r->value[i] = value;
+	if (value == value) {
+		r->valid[i >> 6] |= bit;
+	} else {
+		r->valid[i >> 6] &= ~bit;
+	}
+}
+
+/*
+ * xs_rank_load - the returns of all the products, as of a bar of a panel.
+ */
+void xs_rank_load(xs_rank_t *r, const double *value);
+
+/*
+ * xs_mask_ge - mask of the values >= threshold, NaN never is.
+ */
+void xs_mask_ge(uint64_t *mask, const double *value, double threshold, uint32_t n);
+
+/*
+ * xs_mask_gt - mask of the values > threshold.
+ */
+void xs_mask_gt(uint64_t *mask, const double *value, double threshold, uint32_t n);
+
+static inline void
+xs_mask_and(uint64_t *dst, const uint64_t *src, uint32_t nwords)
+{
+	uint32_t i;
+
+	for (i = 0; i < nwords; i++) {
+		dst[i] &= src[i];
+	}
+}
+
+/*
+ * xs_rank_select - the products of the mask with a return ranked, n of
+ * them the lowest into lo[] and n the highest into hi[], both ascending,
+ * where n = max(int(m * pct), 1) and m is the products ranked, as head(n)
+ * and tail(n) of the sorted returns. Returns n, *m is set to m.
+ */
+uint32_t xs_rank_select(xs_rank_t *r, const uint64_t *mask, double pct, uint32_t *lo,
+			uint32_t *hi, uint32_t *m);
+
+#endif		/* __RANK_H__ */
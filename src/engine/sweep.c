@@ -0,0 +1,581 @@
+/*
+ * sweep.c
+ *
+ * The functions are used to sweep the parameters of the backtest engine
+ * over all the cores: the combinations ordered by ref_days, the ranges of
+ * them a thread steals from the others, the returns of a ref_days shared
+ * by its combinations and the records streamed into the result table.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "sweep.h"
+
+#define THREAD_MAX	256
+#define FLUSH_RECS	256		/* records a thread buffers before writing */
+
+#define RANGE(h, t)	(((uint64_t)(h) << 32) | (uint32_t)(t))
+#define RANGE_HEAD(r)	((uint32_t)((r) >> 32))
+#define RANGE_TAIL(r)	((uint32_t)(r))
+
+const char *const sweep_param_names[SWEEP_NPARAM] = {
+	"strength_pct", "ref_days", "vol_threshold", "oi_threshold",
+	"trade_amount", "hold_days", "fee_rate",
+};
+
+struct combo
+{
+	double param[SWEEP_NPARAM];
+	uint32_t slot;			/* of its ref_days */
+};
+
+/*
+ * ref_slot - the returns of one ref_days, computed by the first thread that
+ * needs them and freed by the one that runs its last combination.
+ */
+struct ref_slot
+{
+	pthread_mutex_t lock;
+	int ref_days;
+	int failed;
+	double *ret;
+	_Atomic uint64_t left;
+};
+
+/*
+ * queue - the combinations [head, tail) a thread has left; the owner takes
+ * the head, a thief half of the tail, both by one CAS of the pair.
+ */
+struct queue
+{
+	_Atomic uint64_t range;
+} __attribute__((aligned(64)));
+
+struct sweep
+{
+	const eng_panel_t *panel;
+	const struct sweep_conf *conf;
+	struct combo *combos;
+	uint64_t ncombos;
+	struct ref_slot *slots;
+	size_t nslots;
+	struct queue *queues;
+	int nthreads;
+
+	pthread_mutex_t out_lock;
+	FILE *out;
+	uint64_t nrecs;
+
+	_Atomic uint64_t done;
+	_Atomic uint64_t failed;
+	_Atomic uint64_t steals;
+	_Atomic uint64_t returns;
+};
+
+struct worker
+{
+	struct sweep *sw;
+	int id;
+	pthread_t thread;
+	struct sweep_rec buf[FLUSH_RECS];
+	size_t nbuf;
+};
+
+int
+sweep_parse(const char *s, double **values)
+{
+	double lo, hi, step, *v;
+	char *end;
+	size_t n = 0, cap = 16, i;
+
+	*values = NULL;
+
+	if (strchr(s, ':') != NULL) {
+		lo = strtod(s, &end);
+		if (*end != ':') {
+			return -1;
+		}
+		hi = strtod(end + 1, &end);
+		if (*end != ':') {
+			return -1;
+		}
+		step = strtod(end + 1, &end);
+		if (*end != '\0' || step <= 0 || hi < lo) {
+			return -1;
+		}
+
+		n = (size_t)floor((hi - lo) / step + 1e-9) + 1;
+		if ((v = malloc(n * sizeof(*v))) == NULL) {
+			return -1;
+		}
+		for (i = 0; i < n; i++) {
+			v[i] = lo + (double)i * step;
+		}
+		*values = v;
+		return (int)n;
+	}
+
+	if ((v = malloc(cap * sizeof(*v))) == NULL) {
+		return -1;
+	}
+	for (;;) {
+		if (n == cap) {
+			double *nv = realloc(v, (cap *= 2) * sizeof(*v));
+
+			if (nv == NULL) {
+				free(v);
+				return -1;
+			}
+			v = nv;
+		}
+		v[n++] = strtod(s, &end);
+		if (end == s || (*end != ',' && *end != '\0')) {
+			free(v);
+			return -1;
+		}
+		if (*end == '\0') {
+			break;
+		}
+		s = end + 1;
+	}
+	*values = v;
+
+	return (int)n;
+}
+
+static inline uint64_t
+xorshift(uint64_t *s)
+{
+	uint64_t x = *s;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*s = x;
+
+	return x * 2685821657736338717ULL;
+}
+
+static int
+cmp_combo(const void *a, const void *b)
+{
+	const struct combo *x = a, *y = b;
+
+	return x->param[SWEEP_REF_DAYS] < y->param[SWEEP_REF_DAYS] ? -1 :
+	       x->param[SWEEP_REF_DAYS] > y->param[SWEEP_REF_DAYS];
+}
+
+/*
+ * build_combos - the grid with ref_days the outermost, or the samples
+ * ordered by ref_days, so the combinations of a ref_days are together.
+ */
+static int
+build_combos(struct sweep *sw)
+{
+	const struct sweep_conf *conf = sw->conf;
+	uint64_t n = 1, i;
+	int k;
+
+	for (k = 0; k < SWEEP_NPARAM; k++) {
+		if (conf->nvalues[k] == 0 || conf->values[k] == NULL) {
+			fprintf(stderr, "no values of %s\n", sweep_param_names[k]);
+			return -1;
+		}
+		n *= conf->nvalues[k];
+	}
+	if (conf->nsamples > 0) {
+		n = conf->nsamples;
+	}
+	if (n == 0 || n >= UINT32_MAX) {
+		fprintf(stderr, "%lu combinations are too many\n", n);
+		return -1;
+	}
+
+	if ((sw->combos = malloc(n * sizeof(*sw->combos))) == NULL) {
+		return -1;
+	}
+	sw->ncombos = n;
+
+	if (conf->nsamples == 0) {
+		static const int order[SWEEP_NPARAM] = {
+			SWEEP_REF_DAYS, SWEEP_HOLD_DAYS, SWEEP_STRENGTH_PCT, SWEEP_VOL_THRESHOLD,
+			SWEEP_OI_THRESHOLD, SWEEP_TRADE_AMOUNT, SWEEP_FEE_RATE,
+		};
+
+		for (i = 0; i < n; i++) {
+			uint64_t r = i;
+
+			/* mixed radix, the last of order the fastest */
+			for (k = SWEEP_NPARAM - 1; k >= 0; k--) {
+				int j = order[k];
+
+				sw->combos[i].param[j] = conf->values[j][r % conf->nvalues[j]];
+				r /= conf->nvalues[j];
+			}
+		}
+		return 0;
+	}
+
+	{
+		uint64_t seed = conf->seed ? conf->seed : 0x9e3779b97f4a7c15ULL;
+		double lo[SWEEP_NPARAM], hi[SWEEP_NPARAM];
+		size_t m;
+
+		for (k = 0; k < SWEEP_NPARAM; k++) {
+			lo[k] = hi[k] = conf->values[k][0];
+			for (m = 1; m < conf->nvalues[k]; m++) {
+				lo[k] = fmin(lo[k], conf->values[k][m]);
+				hi[k] = fmax(hi[k], conf->values[k][m]);
+			}
+		}
+
+		for (i = 0; i < n; i++) {
+			for (k = 0; k < SWEEP_NPARAM; k++) {
+				double u = (double)(xorshift(&seed) >> 11) / (double)(1ULL << 53);
+
+				sw->combos[i].param[k] = lo[k] + u * (hi[k] - lo[k]);
+			}
+			/* the integers are drawn among the integers */
+			sw->combos[i].param[SWEEP_REF_DAYS] = round(sw->combos[i].param[SWEEP_REF_DAYS]);
+			sw->combos[i].param[SWEEP_HOLD_DAYS] = round(sw->combos[i].param[SWEEP_HOLD_DAYS]);
+		}
+		qsort(sw->combos, n, sizeof(*sw->combos), cmp_combo);
+	}
+
+	return 0;
+}
+
+static int
+build_slots(struct sweep *sw)
+{
+	uint64_t i;
+	size_t n = 0;
+
+	/* the combinations are ordered by ref_days, a slot per run of them */
+	for (i = 0; i < sw->ncombos; i++) {
+		if (i == 0 || sw->combos[i].param[SWEEP_REF_DAYS] != sw->combos[i - 1].param[SWEEP_REF_DAYS]) {
+			n++;
+		}
+	}
+	if ((sw->slots = calloc(n, sizeof(*sw->slots))) == NULL) {
+		return -1;
+	}
+
+	for (i = 0, n = 0; i < sw->ncombos; i++) {
+		if (i == 0 || sw->combos[i].param[SWEEP_REF_DAYS] != sw->combos[i - 1].param[SWEEP_REF_DAYS]) {
+			struct ref_slot *s = &sw->slots[n++];
+
+			pthread_mutex_init(&s->lock, NULL);
+			s->ref_days = (int)sw->combos[i].param[SWEEP_REF_DAYS];
+		}
+		sw->combos[i].slot = (uint32_t)(n - 1);
+		atomic_fetch_add_explicit(&sw->slots[n - 1].left, 1, memory_order_relaxed);
+	}
+	sw->nslots = n;
+
+	return 0;
+}
+
+static const double *
+slot_returns(struct sweep *sw, struct ref_slot *s)
+{
+	const eng_panel_t *p = sw->panel;
+	size_t n = (size_t)p->ndates * p->nproducts;
+	const double *ret;
+
+	pthread_mutex_lock(&s->lock);
+	if (s->ret == NULL && !s->failed) {
+		if ((s->ret = malloc((n ? n : 1) * sizeof(*s->ret))) == NULL ||
+		    eng_returns(p, s->ref_days, s->ret) != 0) {
+			free(s->ret);
+			s->ret = NULL;
+			s->failed = 1;
+		} else {
+			atomic_fetch_add_explicit(&sw->returns, 1, memory_order_relaxed);
+		}
+	}
+	ret = s->ret;
+	pthread_mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static void
+slot_done(struct ref_slot *s)
+{
+	if (atomic_fetch_sub_explicit(&s->left, 1, memory_order_acq_rel) == 1) {
+		pthread_mutex_lock(&s->lock);
+		free(s->ret);
+		s->ret = NULL;
+		pthread_mutex_unlock(&s->lock);
+	}
+}
+
+static int
+pop(struct queue *q, uint32_t *combo)
+{
+	uint64_t r = atomic_load_explicit(&q->range, memory_order_acquire);
+
+	while (RANGE_HEAD(r) < RANGE_TAIL(r)) {
+		if (atomic_compare_exchange_weak_explicit(&q->range, &r, RANGE(RANGE_HEAD(r) + 1, RANGE_TAIL(r)),
+							  memory_order_acq_rel, memory_order_acquire)) {
+			*combo = RANGE_HEAD(r);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * steal - move half of the range of another thread to the own queue, which
+ * is empty, so no thief takes from it meanwhile.
+ */
+static int
+steal(struct sweep *sw, int id)
+{
+	int i;
+
+	for (i = 1; i < sw->nthreads; i++) {
+		struct queue *victim = &sw->queues[(id + i) % sw->nthreads];
+		uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+
+		while (RANGE_HEAD(r) < RANGE_TAIL(r)) {
+			uint32_t h = RANGE_HEAD(r), t = RANGE_TAIL(r), k = (t - h + 1) / 2;
+
+			if (atomic_compare_exchange_weak_explicit(&victim->range, &r, RANGE(h, t - k),
+								  memory_order_acq_rel, memory_order_acquire)) {
+				atomic_store_explicit(&sw->queues[id].range, RANGE(t - k, t), memory_order_release);
+				atomic_fetch_add_explicit(&sw->steals, 1, memory_order_relaxed);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void
+flush(struct worker *wk)
+{
+	struct sweep *sw = wk->sw;
+
+	if (wk->nbuf == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&sw->out_lock);
+	if (sw->out != NULL && fwrite(wk->buf, sizeof(wk->buf[0]), wk->nbuf, sw->out) == wk->nbuf) {
+		sw->nrecs += wk->nbuf;
+	}
+	pthread_mutex_unlock(&sw->out_lock);
+
+	wk->nbuf = 0;
+}
+
+static void
+run_combo(struct worker *wk, eng_work_t *work, uint32_t i)
+{
+	struct sweep *sw = wk->sw;
+	const struct combo *c = &sw->combos[i];
+	struct ref_slot *s = &sw->slots[c->slot];
+	struct sweep_rec *rec = &wk->buf[wk->nbuf];
+	struct eng_result r;
+	struct eng_params par;
+	const double *ret;
+
+	par.strength_pct = c->param[SWEEP_STRENGTH_PCT];
+	par.ref_days = (int)c->param[SWEEP_REF_DAYS];
+	par.vol_threshold = c->param[SWEEP_VOL_THRESHOLD];
+	par.oi_threshold = c->param[SWEEP_OI_THRESHOLD];
+	par.trade_amount = c->param[SWEEP_TRADE_AMOUNT];
+	par.hold_days = (int)c->param[SWEEP_HOLD_DAYS];
+	par.fee_rate = c->param[SWEEP_FEE_RATE];
+	memset(&r, 0, sizeof(r));
+
+	if ((ret = slot_returns(sw, s)) == NULL || eng_run_returns(sw->panel, ret, &par, work, &r) != 0) {
+		atomic_fetch_add_explicit(&sw->failed, 1, memory_order_relaxed);
+		slot_done(s);
+		return;
+	}
+	slot_done(s);
+
+	rec->combo = i;
+	memcpy(rec->param, c->param, sizeof(rec->param));
+	rec->nsignals = r.nsignals;
+	rec->total_pnl = r.total_pnl;
+	rec->total_fee = r.total_fee;
+	rec->max_drawdown = r.max_drawdown;
+	rec->sharpe = r.sharpe;
+	rec->win_rate = r.win_rate;
+
+	if (sw->conf->on_result != NULL) {
+		sw->conf->on_result(rec, sw->conf->arg);
+	}
+	if (++wk->nbuf == FLUSH_RECS) {
+		flush(wk);
+	}
+	atomic_fetch_add_explicit(&sw->done, 1, memory_order_relaxed);
+}
+
+static void *
+worker_thread(void *arg)
+{
+	struct worker *wk = arg;
+	struct sweep *sw = wk->sw;
+	eng_work_t *work;
+	uint32_t i;
+
+	if ((work = eng_work_create(sw->panel)) == NULL) {
+		return NULL;
+	}
+
+	for (;;) {
+		while (pop(&sw->queues[wk->id], &i)) {
+			run_combo(wk, work, i);
+		}
+		if (!steal(sw, wk->id)) {
+			break;
+		}
+	}
+
+	flush(wk);
+	eng_work_free(work);
+
+	return NULL;
+}
+
+static int
+write_header(struct sweep *sw)
+{
+	const eng_panel_t *p = sw->panel;
+	struct sweep_hdr hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = SWEEP_MAGIC;
+	hdr.version = SWEEP_VERSION;
+	hdr.rec_size = sizeof(struct sweep_rec);
+	hdr.ndates = p->ndates;
+	hdr.nproducts = p->nproducts;
+	hdr.first_day = p->ndates ? p->trading_day[0] : 0;
+	hdr.last_day = p->ndates ? p->trading_day[p->ndates - 1] : 0;
+	hdr.ncombos = sw->ncombos;
+	hdr.nrecs = sw->nrecs;
+
+	return fseek(sw->out, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, sw->out) == 1 ? 0 : -1;
+}
+
+static double
+now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int
+sweep_run(const eng_panel_t *p, const struct sweep_conf *conf, struct sweep_stats *st)
+{
+	struct worker *workers = NULL;
+	struct sweep sw;
+	double t0 = now_seconds();
+	uint64_t per;
+	int i, started = 0, rc = -1;
+
+	memset(&sw, 0, sizeof(sw));
+	sw.panel = p;
+	sw.conf = conf;
+	pthread_mutex_init(&sw.out_lock, NULL);
+
+	sw.nthreads = conf->threads > 0 ? conf->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (sw.nthreads < 1) {
+		sw.nthreads = 1;
+	} else if (sw.nthreads > THREAD_MAX) {
+		sw.nthreads = THREAD_MAX;
+	}
+
+	if (build_combos(&sw) != 0 || build_slots(&sw) != 0) {
+		goto out;
+	}
+	if ((uint64_t)sw.nthreads > sw.ncombos) {
+		sw.nthreads = (int)sw.ncombos;
+	}
+
+	if (conf->output != NULL) {
+		if ((sw.out = fopen(conf->output, "w+b")) == NULL) {
+			fprintf(stderr, "cannot open %s\n", conf->output);
+			goto out;
+		}
+		if (write_header(&sw) != 0) {
+			goto out;
+		}
+	}
+
+	if ((sw.queues = aligned_alloc(64, (size_t)sw.nthreads * sizeof(*sw.queues))) == NULL ||
+	    (workers = calloc((size_t)sw.nthreads, sizeof(*workers))) == NULL) {
+		goto out;
+	}
+
+	/* contiguous shares first, so each thread starts on its own ref_days */
+	per = (sw.ncombos + (uint64_t)sw.nthreads - 1) / (uint64_t)sw.nthreads;
+	for (i = 0; i < sw.nthreads; i++) {
+		uint64_t h = per * (uint64_t)i, t = h + per;
+
+		h = h < sw.ncombos ? h : sw.ncombos;
+		t = t < sw.ncombos ? t : sw.ncombos;
+		atomic_init(&sw.queues[i].range, RANGE(h, t));
+	}
+
+	for (i = 0; i < sw.nthreads; i++) {
+		workers[i].sw = &sw;
+		workers[i].id = i;
+		if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) != 0) {
+			/* the queue of the thread is stolen by the others */
+			fprintf(stderr, "cannot start sweep thread %d\n", i);
+			break;
+		}
+		started++;
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+
+	rc = started > 0 && atomic_load(&sw.done) == sw.ncombos ? 0 : -1;
+	if (sw.out != NULL && write_header(&sw) != 0) {
+		rc = -1;
+	}
+
+out:
+	if (st != NULL) {
+		st->ncombos = sw.ncombos;
+		st->done = atomic_load(&sw.done);
+		st->failed = atomic_load(&sw.failed);
+		st->steals = atomic_load(&sw.steals);
+		st->returns = atomic_load(&sw.returns);
+		st->seconds = now_seconds() - t0;
+	}
+
+	if (sw.out != NULL && fclose(sw.out) != 0) {
+		rc = -1;
+	}
+	for (i = 0; i < (int)sw.nslots; i++) {
+		free(sw.slots[i].ret);
+		pthread_mutex_destroy(&sw.slots[i].lock);
+	}
+	free(sw.slots);
+	free(sw.combos);
+	free(sw.queues);
+	free(workers);
+	pthread_mutex_destroy(&sw.out_lock);
+
+	return rc;
+}
@@ -0,0 +1,118 @@
+/*
+ * sweep.h
+ *
+ * The header file contains the definition of the parameter sweep over the
+ * backtest engine and the functions' prototype.
+ *
+ * The combinations of a grid, or the samples of a random search, are run by
+ * a pool of threads over one read-only panel. The combinations are ordered
+ * by ref_days and handed out in ranges a thread steals half of when its own
+ * runs out, so the threads mostly run the same ref_days, whose returns are
+ * computed once and freed when its last combination is done.
+ *
+ * The results stream into a table of fixed records:
+ *
+ *	header   struct sweep_hdr
+ *	records  struct sweep_rec, in the order they are done
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "engine.h"
+
+#define SWEEP_MAGIC	0x5057534aU	/* "JSWP" */
+#define SWEEP_VERSION	1
+
+/* the parameters of struct eng_params, in its order */
+enum sweep_param {
+	SWEEP_STRENGTH_PCT = 0,
+	SWEEP_REF_DAYS,
+	SWEEP_VOL_THRESHOLD,
+	SWEEP_OI_THRESHOLD,
+	SWEEP_TRADE_AMOUNT,
+	SWEEP_HOLD_DAYS,
+	SWEEP_FEE_RATE,
+	SWEEP_NPARAM
+};
+
+extern const char *const sweep_param_names[SWEEP_NPARAM];
+
+struct sweep_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t rec_size;
+	uint32_t ndates;
+	uint32_t nproducts;
+	int32_t first_day;		/* trading days of the panel */
+	int32_t last_day;
+	uint32_t reserved0;
+	uint64_t ncombos;		/* combinations of the sweep */
+	uint64_t nrecs;			/* records written, set at the end */
+	uint8_t reserved[16];
+};
+
+_Static_assert(sizeof(struct sweep_hdr) == 64, "sweep_hdr is part of the file format");
+
+struct sweep_rec
+{
+	uint64_t combo;			/* index of the combination */
+	double param[SWEEP_NPARAM];
+	uint64_t nsignals;
+	double total_pnl;
+	double total_fee;
+	double max_drawdown;
+	double sharpe;
+	double win_rate;
+};
+
+_Static_assert(sizeof(struct sweep_rec) == 112, "sweep_rec is part of the file format");
+
+typedef void (*sweep_cb_t)(const struct sweep_rec *rec, void *arg);
+
+/*
+ * sweep_conf - the values of every parameter. The grid is the product of
+ * them; a random search draws nsamples combinations uniformly between the
+ * least and the greatest value of every parameter instead.
+ */
+struct sweep_conf
+{
+	const double *values[SWEEP_NPARAM];
+	size_t nvalues[SWEEP_NPARAM];
+	size_t nsamples;		/* 0 for the grid */
+	uint64_t seed;
+
+	int threads;			/* 0 for all the cores */
+	const char *output;		/* the result table, NULL for none */
+	sweep_cb_t on_result;		/* called from the threads, may be NULL */
+	void *arg;
+};
+
+struct sweep_stats
+{
+	uint64_t ncombos;
+	uint64_t done;
+	uint64_t failed;
+	uint64_t steals;		/* ranges taken from other threads */
+	uint64_t returns;		/* returns computed, one per ref_days */
+	double seconds;
+};
+
+/*
+ * sweep_run - run every combination over the panel, returns 0 if all ran.
+ */
+int sweep_run(const eng_panel_t *p, const struct sweep_conf *conf, struct sweep_stats *st);
+
+/*
+ * sweep_parse - the values of "a,b,c" or "lo:hi:step", returns the count,
+ * -1 if malformed. *values is malloc()ed.
+ */
+int sweep_parse(const char *s, double **values);
+
+#endif		/* __SWEEP_H__ */
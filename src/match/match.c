@@ -0,0 +1,522 @@
+/*
+ * match.c
+ *
+ * The functions are used to fill the orders of a backtest on the bars or
+ * against the simulated book of the ticks, and to keep the positions.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "match.h"
+#include "arena.h"
+
+#define POLL_BATCH	256
+#define ORDERS_MIN	8		/* open orders an instrument has room for at first */
+
+const char *const mt_model_names[MT_MODEL_MAX] = {
+	[MT_FILL_OPEN] = "open",
+	[MT_FILL_CLOSE] = "close",
+	[MT_FILL_VWAP] = "vwap",
+	[MT_FILL_BOOK] = "book",
+};
+
+/*
+ * mt_rest - an open order; px is the limit in the fixed point of the ticks.
+ */
+struct mt_rest
+{
+	struct mt_order o;
+	int64_t px;
+	int64_t leaves;			/* -1 until sized by the amount */
+	int64_t queue;			/* book: lots ahead of it at its price */
+	uint64_t arrive_ts;		/* book: when it reaches the book */
+	int resting;			/* book: arrived and rests at its price */
+};
+
+struct mt_inst
+{
+	struct mt_rest *orders;
+	uint32_t norders;
+	uint32_t cap;
+	int64_t prev_volume;		/* book: volume of the last tick */
+	int have_tick;
+	int traded;
+	struct mt_position pos;
+};
+
+struct mt_engine
+{
+	struct mt_conf conf;
+	double multiplier;
+	struct mt_stats stats;
+	arena_t arena;			/* the instruments and their orders */
+	pool_t inst_pool;
+	struct mt_inst *insts[TICK_INSTRUMENT_MAX];
+};
+
+int
+mt_model_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < MT_MODEL_MAX; i++) {
+		if (strcmp(name, mt_model_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+mt_engine_t *
+mt_create(const struct mt_conf *conf)
+{
+	mt_engine_t *eng;
+	size_t n;
+
+	if ((unsigned int)conf->model >= MT_MODEL_MAX || conf->on_fill == NULL) {
+		fprintf(stderr, "bad matching conf\n");
+		return NULL;
+	}
+
+	if ((eng = calloc(1, sizeof(*eng))) == NULL) {
+		return NULL;
+	}
+
+	eng->conf = *conf;
+	eng->multiplier = conf->multiplier > 0 ? conf->multiplier : 1;
+
+	/* the instruments expected and their first orders, prefaulted now */
+	n = conf->instruments > 0 ? conf->instruments : ARENA_INSTRUMENTS;
+	n = n < TICK_INSTRUMENT_MAX ? n : TICK_INSTRUMENT_MAX;
+	if (arena_init(&eng->arena, n * (sizeof(struct mt_inst) + ORDERS_MIN * sizeof(struct mt_rest) + 2 * ARENA_ALIGN)) != 0 ||
+	    pool_init(&eng->inst_pool, &eng->arena, sizeof(struct mt_inst), n) != 0) {
+		mt_destroy(eng);
+		return NULL;
+	}
+
+	return eng;
+}
+
+void
+mt_destroy(mt_engine_t *eng)
+{
+	if (eng == NULL) {
+		return;
+	}
+
+	arena_free(&eng->arena);
+	free(eng);
+}
+
+static struct mt_inst *
+inst_get(mt_engine_t *eng, uint32_t id)
+{
+	struct mt_inst *inst = eng->insts[id];
+
+	if (inst == NULL && (inst = pool_get(&eng->inst_pool)) != NULL) {
+		memset(inst, 0, sizeof(*inst));
+		inst->pos.mark = NAN;
+		eng->insts[id] = inst;
+	}
+
+	return inst;
+}
+
+int
+mt_submit(mt_engine_t *eng, const struct mt_order *order)
+{
+	struct mt_inst *inst;
+	struct mt_rest *r;
+
+	eng->stats.orders++;
+	if (order->instrument == 0 || order->instrument >= TICK_INSTRUMENT_MAX ||
+	    (order->side != MT_BUY && order->side != MT_SELL) || order->qty < 0 || order->price < 0 ||
+	    (order->qty == 0 && !(order->amount > 0)) || (inst = inst_get(eng, order->instrument)) == NULL) {
+		eng->stats.rejected++;
+		return -1;
+	}
+
+	/* the old orders are left in the arena, they go with the engine */
+	if (inst->norders == inst->cap) {
+		uint32_t cap = inst->cap ? inst->cap * 2 : ORDERS_MIN;
+
+		if ((r = arena_alloc(&eng->arena, cap * sizeof(*r))) == NULL) {
+			eng->stats.rejected++;
+			return -1;
+		}
+		if (inst->norders > 0) {
+			memcpy(r, inst->orders, inst->norders * sizeof(*r));
+		}
+		inst->orders = r;
+		inst->cap = cap;
+	}
+
+	r = &inst->orders[inst->norders++];
+	memset(r, 0, sizeof(*r));
+	r->o = *order;
+	r->px = order->price > 0 ? tick_px(order->price) : 0;
+	r->leaves = order->qty > 0 ? order->qty : -1;
+	r->arrive_ts = order->ts + eng->conf.latency_ns;
+
+	return 0;
+}
+
+static void
+remove_order(struct mt_inst *inst, uint32_t i)
+{
+	memmove(&inst->orders[i], &inst->orders[i + 1], (inst->norders - i - 1) * sizeof(*inst->orders));
+	inst->norders--;
+}
+
+int
+mt_cancel(mt_engine_t *eng, uint32_t instrument, uint64_t id)
+{
+	struct mt_inst *inst = instrument < TICK_INSTRUMENT_MAX ? eng->insts[instrument] : NULL;
+	uint32_t i;
+
+	for (i = 0; inst != NULL && i < inst->norders; i++) {
+		if (inst->orders[i].o.id == id) {
+			remove_order(inst, i);
+			eng->stats.cancelled++;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * size_order - the lots of an order sized by its amount at the price; an
+ * order too small for a lot is cancelled. Returns 0 if it has lots.
+ */
+static int
+size_order(mt_engine_t *eng, struct mt_rest *r, double price)
+{
+	if (r->leaves >= 0) {
+		return r->leaves > 0 ? 0 : -1;
+	}
+	if (!(price > 0)) {
+		return -1;
+	}
+
+	r->leaves = (int64_t)floor(r->o.amount / (price * eng->multiplier));
+	if (r->leaves <= 0) {
+		r->leaves = 0;
+		eng->stats.cancelled++;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+fill(mt_engine_t *eng, struct mt_inst *inst, struct mt_rest *r, int64_t qty, double price,
+     int liquidity, uint64_t ts)
+{
+	struct mt_position *pos = &inst->pos;
+	struct mt_fill f;
+	int64_t q = pos->qty, s = r->o.side * qty, closed;
+	double notional = (double)qty * price * eng->multiplier;
+
+	r->leaves -= qty;
+
+	f.order_id = r->o.id;
+	f.ts = ts;
+	f.instrument = r->o.instrument;
+	f.side = r->o.side;
+	f.qty = qty;
+	f.leaves = r->leaves;
+	f.price = price;
+	f.fee = notional * eng->conf.fee_rate + (double)qty * eng->conf.fee_per_lot;
+	f.liquidity = liquidity;
+
+	/* the average cost of the open lots, realized on the lots closed */
+	if (q == 0 || (q > 0) == (s > 0)) {
+		pos->cost = (pos->cost * (double)llabs(q) + price * (double)qty) / (double)(llabs(q) + qty);
+	} else {
+		closed = llabs(q) < qty ? llabs(q) : qty;
+		pos->realized += (double)closed * (price - pos->cost) * (q > 0 ? 1 : -1) * eng->multiplier;
+		if (llabs(q) < qty) {
+			pos->cost = price;
+		} else if (llabs(q) == qty) {
+			pos->cost = 0;
+		}
+	}
+	pos->qty = q + s;
+	pos->fee += f.fee;
+	inst->traded = 1;
+
+	eng->stats.fills++;
+	eng->stats.filled += (uint64_t)qty;
+	eng->conf.on_fill(&f, eng->conf.arg);
+}
+
+/* drop the orders filled or cancelled */
+static void
+compact(struct mt_inst *inst)
+{
+	uint32_t i, n = 0;
+
+	for (i = 0; i < inst->norders; i++) {
+		if (inst->orders[i].leaves != 0) {
+			inst->orders[n++] = inst->orders[i];
+		}
+	}
+	inst->norders = n;
+}
+
+void
+mt_bar(mt_engine_t *eng, uint32_t instrument, const struct mt_bar *bar)
+{
+	struct mt_inst *inst = instrument < TICK_INSTRUMENT_MAX ? eng->insts[instrument] : NULL;
+	double ref, price, limit, slip = eng->conf.slippage;
+	struct mt_rest *r;
+	uint32_t i;
+	int maker;
+
+	eng->stats.events++;
+	if (inst == NULL) {
+		return;
+	}
+	if (isfinite(bar->close)) {
+		inst->pos.mark = bar->close;
+	}
+	if (eng->conf.model == MT_FILL_BOOK || inst->norders == 0) {
+		return;
+	}
+
+	switch (eng->conf.model) {
+	case MT_FILL_OPEN:
+		ref = bar->open;
+		break;
+	case MT_FILL_VWAP:
+		ref = bar->volume > 0 && bar->amount > 0 ?
+			bar->amount / ((double)bar->volume * eng->multiplier) : bar->close;
+		break;
+	default:
+		ref = bar->close;
+		break;
+	}
+	if (!(ref > 0)) {
+		return;
+	}
+
+	for (i = 0; i < inst->norders; i++) {
+		r = &inst->orders[i];
+		if (r->o.ts > bar->ts) {
+			continue;
+		}
+
+		price = ref + r->o.side * slip;
+		maker = 0;
+		if (r->px != 0) {
+			limit = r->o.price;
+			if (r->o.side == MT_BUY ? bar->low > limit : bar->high < limit) {
+				continue;
+			}
+			if (r->o.side == MT_BUY ? price > limit : price < limit) {
+				price = limit;
+				maker = 1;
+			}
+		}
+
+		if (size_order(eng, r, price) == 0) {
+			fill(eng, inst, r, r->leaves, price, maker ? MT_MAKER : MT_TAKER, bar->ts);
+		}
+	}
+	compact(inst);
+}
+
+/*
+ * take - fill the order from the opposite levels it crosses, what is left
+ * of them in avail; the taken price is the average of the levels.
+ */
+static void
+take(mt_engine_t *eng, struct mt_inst *inst, struct mt_rest *r, const tick_rec_t *t, int64_t *avail)
+{
+	const int64_t *opp = r->o.side == MT_BUY ? t->ask : t->bid;
+	int64_t got = 0, q;
+	double notional = 0, price;
+	int k;
+
+	for (k = 0; k < t->level && k < TICK_DEPTH && r->leaves - got > 0; k++) {
+		if (avail[k] <= 0 || opp[k] <= 0) {
+			continue;
+		}
+		if (r->px != 0 && (r->o.side == MT_BUY ? opp[k] > r->px : opp[k] < r->px)) {
+			break;
+		}
+		q = r->leaves - got < avail[k] ? r->leaves - got : avail[k];
+		avail[k] -= q;
+		got += q;
+		notional += (double)q * tick_px_double(opp[k]);
+	}
+	if (got == 0) {
+		return;
+	}
+
+	price = notional / (double)got + r->o.side * eng->conf.slippage;
+	if (r->px != 0 && (r->o.side == MT_BUY ? price > r->o.price : price < r->o.price)) {
+		price = r->o.price;
+	}
+	fill(eng, inst, r, got, price, MT_TAKER, t->timestamp);
+}
+
+/* the volume shown at the price on the side of the order, -1 if not seen */
+static int64_t
+shown(const struct mt_rest *r, const tick_rec_t *t)
+{
+	const int64_t *same = r->o.side == MT_BUY ? t->bid : t->ask;
+	const int32_t *vol = r->o.side == MT_BUY ? t->bid_vol : t->ask_vol;
+	int k, n = t->level < TICK_DEPTH ? t->level : TICK_DEPTH;
+
+	for (k = 0; k < n; k++) {
+		if (vol[k] > 0 && same[k] == r->px) {
+			return vol[k];
+		}
+	}
+
+	/* a price better than the best is a level of its own */
+	if (n == 0 || vol[0] <= 0 || (r->o.side == MT_BUY ? r->px > same[0] : r->px < same[0])) {
+		return 0;
+	}
+
+	return -1;
+}
+
+static void
+book_tick(mt_engine_t *eng, struct mt_inst *inst, const tick_rec_t *t)
+{
+	int64_t avail_bid[TICK_DEPTH], avail_ask[TICK_DEPTH], dv, q, lv;
+	const int32_t *opp_vol;
+	const int64_t *opp;
+	struct mt_rest *r;
+	uint32_t i;
+	int k;
+
+	dv = inst->have_tick && t->volume > inst->prev_volume ? t->volume - inst->prev_volume : 0;
+	for (k = 0; k < TICK_DEPTH; k++) {
+		avail_bid[k] = t->bid_vol[k];
+		avail_ask[k] = t->ask_vol[k];
+	}
+
+	for (i = 0; i < inst->norders; i++) {
+		r = &inst->orders[i];
+		if (t->timestamp < r->arrive_ts) {
+			continue;
+		}
+
+		opp = r->o.side == MT_BUY ? t->ask : t->bid;
+		opp_vol = r->o.side == MT_BUY ? t->ask_vol : t->bid_vol;
+
+		if (!r->resting) {
+			double ref = r->px != 0 ? r->o.price :
+				     opp_vol[0] > 0 ? tick_px_double(opp[0]) : tick_px_double(t->last);
+
+			if (size_order(eng, r, ref) != 0) {
+				continue;
+			}
+			take(eng, inst, r, t, r->o.side == MT_BUY ? avail_ask : avail_bid);
+
+			/* a limit order rests behind the volume shown at its price */
+			if (r->px != 0 && r->leaves > 0) {
+				lv = shown(r, t);
+				r->queue = lv > 0 ? lv : 0;
+				r->resting = 1;
+			}
+			continue;
+		}
+
+		/* the book or a trade went through the price */
+		if ((opp_vol[0] > 0 && (r->o.side == MT_BUY ? opp[0] <= r->px : opp[0] >= r->px)) ||
+		    (dv > 0 && t->last > 0 && (r->o.side == MT_BUY ? t->last < r->px : t->last > r->px))) {
+			fill(eng, inst, r, r->leaves, r->o.price, MT_MAKER, t->timestamp);
+			continue;
+		}
+
+		/* the volume traded at the price goes through the queue first */
+		if (dv > 0 && t->last == r->px) {
+			q = r->queue - dv;
+			if (q < 0) {
+				fill(eng, inst, r, -q < r->leaves ? -q : r->leaves, r->o.price, MT_MAKER,
+				     t->timestamp);
+				q = 0;
+			}
+			r->queue = q;
+		}
+
+		/* a smaller level was cancelled ahead of it */
+		if ((lv = shown(r, t)) >= 0 && lv < r->queue) {
+			r->queue = lv;
+		}
+	}
+	compact(inst);
+}
+
+void
+mt_tick(mt_engine_t *eng, const tick_rec_t *tick)
+{
+	struct mt_inst *inst = tick->instrument < TICK_INSTRUMENT_MAX ? eng->insts[tick->instrument] : NULL;
+
+	eng->stats.events++;
+	if (inst == NULL) {
+		return;
+	}
+
+	if (eng->conf.model == MT_FILL_BOOK && inst->norders != 0) {
+		book_tick(eng, inst, tick);
+	}
+	if (tick->last > 0) {
+		inst->pos.mark = tick_px_double(tick->last);
+	}
+	inst->prev_volume = tick->volume;
+	inst->have_tick = 1;
+}
+
+size_t
+mt_poll(mt_engine_t *eng, ring_reader_t *rd, size_t max)
+{
+	tick_rec_t batch[POLL_BATCH];
+	size_t done = 0, n, i;
+
+	while (done < max) {
+		n = ring_read(rd, batch, max - done < POLL_BATCH ? max - done : POLL_BATCH);
+		if (n == 0) {
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			mt_tick(eng, &batch[i]);
+		}
+		done += n;
+	}
+
+	return done;
+}
+
+const struct mt_position *
+mt_position(const mt_engine_t *eng, uint32_t instrument)
+{
+	const struct mt_inst *inst = instrument < TICK_INSTRUMENT_MAX ? eng->insts[instrument] : NULL;
+
+	return inst != NULL && inst->traded ? &inst->pos : NULL;
+}
+
+size_t
+mt_open_orders(const mt_engine_t *eng, uint32_t instrument)
+{
+	const struct mt_inst *inst = instrument < TICK_INSTRUMENT_MAX ? eng->insts[instrument] : NULL;
+
+	return inst != NULL ? inst->norders : 0;
+}
+
+void
+mt_stats(const mt_engine_t *eng, struct mt_stats *st)
+{
+	*st = eng->stats;
+	st->grows = eng->arena.stats.grows;
+}
@@ -0,0 +1,172 @@
+/*
+ * match.h
+ *
+ * The header file contains the definition of the matching engine and the
+ * functions' prototype.
+ *
+ * The engine fills the orders of a backtest against the market data as it
+ * comes, bars or ticks, with the instruments found by their interned id in
+ * O(1). The bar models fill the pending orders of an instrument on its next
+ * bar; the book model simulates them against the depth of its ticks:
+ *
+ *	open, close  the price of the bar, a limit order only if the bar
+ *	             reached it and no worse than it
+ *	vwap         amount / (volume * multiplier) of the bar, close without
+ *	             amount
+ *	book         an order reaches the book latency_ns after it was sent,
+ *	             takes the opposite levels it crosses, and a limit order
+ *	             rests behind the volume shown at its price. The volume
+ *	             traded at the price moves it up the queue, a smaller level
+ *	             means cancels ahead of it, and a trade or quote through
+ *	             the price fills it whole
+ *
+ * Slippage moves the taken price against the order, fees are a rate of the
+ * notional and a sum per lot. Positions are kept per instrument with the
+ * average cost, marked to the last price.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#ifndef __MATCH_H__
+#define __MATCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tick.h"
+#include "ring.h"
+
+#define MT_BUY		1
+#define MT_SELL		-1
+
+enum mt_model {
+	MT_FILL_OPEN = 0,
+	MT_FILL_CLOSE,
+	MT_FILL_VWAP,
+	MT_FILL_BOOK,
+	MT_MODEL_MAX
+};
+
+extern const char *const mt_model_names[MT_MODEL_MAX];
+
+int mt_model_parse(const char *name);
+
+/* liquidity of a fill */
+#define MT_TAKER	0
+#define MT_MAKER	1
+
+struct mt_order
+{
+	uint64_t id;
+	uint64_t ts;			/* ns since epoch it was sent */
+	uint32_t instrument;		/* interned id of the market data */
+	int32_t side;			/* MT_BUY or MT_SELL */
+	int64_t qty;			/* lots, 0 to size it by amount */
+	double amount;			/* notional to size the order at its fill */
+	double price;			/* limit, 0 for a market order */
+};
+
+struct mt_fill
+{
+	uint64_t order_id;
+	uint64_t ts;
+	uint32_t instrument;
+	int32_t side;
+	int64_t qty;
+	int64_t leaves;			/* lots of the order still open */
+	double price;
+	double fee;
+	int liquidity;			/* MT_TAKER or MT_MAKER */
+};
+
+typedef void (*mt_fill_cb_t)(const struct mt_fill *fill, void *arg);
+
+struct mt_conf
+{
+	int model;			/* enum mt_model */
+	double slippage;		/* price units against the taker */
+	double fee_rate;		/* of the notional */
+	double fee_per_lot;
+	double multiplier;		/* notional of a price unit of a lot, 0 for 1 */
+	uint64_t latency_ns;		/* book: from sending to reaching the book */
+	mt_fill_cb_t on_fill;
+	void *arg;
+	uint32_t instruments;		/* expected, their state is made at create, 0 for ARENA_INSTRUMENTS */
+};
+
+struct mt_bar
+{
+	uint64_t ts;			/* ns since epoch of the end of the bar */
+	double open;
+	double high;
+	double low;
+	double close;
+	int64_t volume;
+	double amount;
+};
+
+struct mt_position
+{
+	int64_t qty;			/* signed lots */
+	double cost;			/* average price of the open lots */
+	double realized;
+	double fee;
+	double mark;			/* last price, NaN before the first */
+};
+
+struct mt_stats
+{
+	uint64_t events;		/* ticks and bars */
+	uint64_t orders;
+	uint64_t fills;
+	uint64_t filled;		/* lots */
+	uint64_t cancelled;
+	uint64_t rejected;
+	uint64_t grows;			/* memory added beyond the expected instruments and orders */
+};
+
+typedef struct mt_engine mt_engine_t;
+
+mt_engine_t *mt_create(const struct mt_conf *conf);
+void mt_destroy(mt_engine_t *eng);
+
+/*
+ * mt_submit - add the order, filled by the next events of its instrument.
+ * Returns 0, -1 if rejected.
+ */
+int mt_submit(mt_engine_t *eng, const struct mt_order *order);
+
+/*
+ * mt_cancel - cancel what is left of the order. Returns 0, -1 if it is not
+ * open.
+ */
+int mt_cancel(mt_engine_t *eng, uint32_t instrument, uint64_t id);
+
+/*
+ * mt_tick - an event of the book model; the marks of the other models.
+ */
+void mt_tick(mt_engine_t *eng, const tick_rec_t *tick);
+
+/*
+ * mt_bar - an event of the bar models; the mark of the book model.
+ */
+void mt_bar(mt_engine_t *eng, uint32_t instrument, const struct mt_bar *bar);
+
+/*
+ * mt_poll - mt_tick() the ticks of the ring reader, up to max. Returns the
+ * ticks.
+ */
+size_t mt_poll(mt_engine_t *eng, ring_reader_t *rd, size_t max);
+
+/*
+ * mt_position - the position of the instrument, NULL if it never traded.
+ */
+const struct mt_position *mt_position(const mt_engine_t *eng, uint32_t instrument);
+
+/*
+ * mt_open_orders - the orders of the instrument still open.
+ */
+size_t mt_open_orders(const mt_engine_t *eng, uint32_t instrument);
+
+void mt_stats(const mt_engine_t *eng, struct mt_stats *st);
+
+#endif		/* __MATCH_H__ */
@@ -0,0 +1,593 @@
+/*
+ * match_bar.c
+ *
+ * The program backtests the signals of match_signals.py on the daily bars of
+ * the column store with the matching engine: a signal opens a position in
+ * the major of its product on its day, held for a number of trading days and
+ * closed in the same contract.
+ *
+ *	match_bar -r store -e shfe -d majors -s signals.csv -H 10 -o pnl.csv > fills.csv
+ *
+ * The signals have the columns date, product, position (long or short) and
+ * amount, the notional opened. The majors are the .jseg files written by
+ * select_major. The close and vwap models fill on the bar of the day, the
+ * open model on the open of the next one. The daily file has the position
+ * and the change of the equity of every product, marked to the close.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <getopt.h>
+#include "match.h"
+#include "colstore.h"
+#include "bar.h"
+
+#define LINE_MAX_LEN	1024
+#define PRODUCT_MAX	64
+
+struct product
+{
+	char name[COL_NAME_LEN];
+	col_file_t f;
+	col_seg_file_t seg;
+	uint64_t *major;		/* the rows of the majors, by day */
+	uint64_t nmajor;
+	uint64_t cur;			/* the next row of major */
+	uint64_t row;			/* the next row of the file */
+	uint32_t *ids;			/* interned id of a code of the dict, 0 unused */
+	double equity;			/* of the last day reported */
+	double fee;
+};
+
+struct trade
+{
+	uint32_t product;
+	int32_t side;
+	int32_t open_day;		/* index of days */
+	int32_t close_day;
+	uint32_t instrument;
+	double amount;
+	int64_t qty;			/* lots opened */
+};
+
+struct day
+{
+	int32_t trading_day;
+	int64_t ts;			/* the earliest bar of the day */
+};
+
+struct backtest
+{
+	struct product products[PRODUCT_MAX];
+	uint32_t nproducts;
+	struct trade *trades;
+	size_t ntrades;
+	struct day *days;
+	size_t ndays;
+	int model;
+	double multiplier;
+	int32_t today;
+};
+
+static int
+cmp_day(const void *a, const void *b)
+{
+	const struct day *x = a, *y = b;
+
+	if (x->trading_day != y->trading_day) {
+		return x->trading_day < y->trading_day ? -1 : 1;
+	}
+	return x->ts < y->ts ? -1 : x->ts > y->ts;
+}
+
+static int
+cmp_trade(const void *a, const void *b)
+{
+	const struct trade *x = a, *y = b;
+
+	return x->open_day < y->open_day ? -1 : x->open_day > y->open_day;
+}
+
+static void
+on_fill(const struct mt_fill *f, void *arg)
+{
+	struct backtest *bt = arg;
+	struct trade *t = &bt->trades[(f->order_id - 1) / 2];
+	int open = f->order_id % 2 == 1;
+
+	if (open) {
+		t->qty += f->qty;
+	}
+	printf("%d,%s,%s,%s,%s,%ld,%.4f,%.4f\n", bt->today, bt->products[t->product].name,
+	       tick_symbol(f->instrument), open ? "open" : "close", f->side == MT_BUY ? "buy" : "sell",
+	       (long)f->qty, f->price, f->fee);
+}
+
+static int32_t
+parse_day(const char *s)
+{
+	int32_t v = 0, n = 0;
+
+	for (; *s != '\0' && n < 8; s++) {
+		if (isdigit((unsigned char)*s)) {
+			v = v * 10 + (*s - '0');
+			n++;
+		}
+	}
+
+	return n == 8 ? v : 0;
+}
+
+static int
+find_product(struct backtest *bt, const char *name, const char *root, const char *exchange,
+	     const char *majors)
+{
+	char path[4096];
+	struct product *p;
+	uint32_t i;
+
+	for (i = 0; i < bt->nproducts; i++) {
+		if (strcmp(bt->products[i].name, name) == 0) {
+			return (int)i;
+		}
+	}
+	if (bt->nproducts == PRODUCT_MAX) {
+		fprintf(stderr, "more than %d products\n", PRODUCT_MAX);
+		return -1;
+	}
+
+	p = &bt->products[bt->nproducts];
+	memset(p, 0, sizeof(*p));
+	snprintf(p->name, sizeof(p->name), "%s", name);
+
+	if (col_path(path, sizeof(path), root, exchange, name, BAR_T_DAY) != 0 || col_open(&p->f, path) != 0) {
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s/%s_%s%s", majors, exchange, name, COL_SEG_SUFFIX);
+	if (col_seg_open(&p->seg, path) != 0) {
+		col_close(&p->f);
+		return -1;
+	}
+	if ((p->major = malloc((p->f.nrows + 1) * sizeof(*p->major))) == NULL ||
+	    (p->ids = calloc(p->f.hdr->ninstruments + 1, sizeof(*p->ids))) == NULL) {
+		free(p->major);
+		col_seg_close(&p->seg);
+		col_close(&p->f);
+		return -1;
+	}
+	p->nmajor = col_seg_rows(&p->f, p->seg.segments, p->seg.nsegments, p->major);
+
+	return (int)bt->nproducts++;
+}
+
+/* the trading days with a major of a product, the earliest bar of each */
+static int
+load_days(struct backtest *bt)
+{
+	struct product *p;
+	size_t n = 0, i, j;
+	uint32_t k;
+
+	for (k = 0; k < bt->nproducts; k++) {
+		n += bt->products[k].nmajor;
+	}
+	if ((bt->days = malloc((n + 1) * sizeof(*bt->days))) == NULL) {
+		return -1;
+	}
+	for (k = 0, n = 0; k < bt->nproducts; k++) {
+		p = &bt->products[k];
+		for (i = 0; i < p->nmajor; i++) {
+			bt->days[n].trading_day = p->f.trading_day[p->major[i]];
+			bt->days[n++].ts = p->f.timestamp[p->major[i]];
+		}
+	}
+	qsort(bt->days, n, sizeof(*bt->days), cmp_day);
+
+	for (i = 0, j = 0; i < n; i++) {
+		if (j == 0 || bt->days[j - 1].trading_day != bt->days[i].trading_day) {
+			bt->days[j++] = bt->days[i];
+		}
+	}
+	bt->ndays = j;
+
+	return 0;
+}
+
+static int32_t
+day_index(const struct backtest *bt, int32_t day)
+{
+	size_t lo = 0, hi = bt->ndays, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (bt->days[mid].trading_day < day) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo < bt->ndays && bt->days[lo].trading_day == day ? (int32_t)lo : -1;
+}
+
+struct signal
+{
+	int32_t day;
+	int32_t side;
+	double amount;
+	char product[COL_NAME_LEN];
+};
+
+static int
+load_signals(struct backtest *bt, const char *path, const char *root, const char *exchange,
+	     const char *majors, int32_t hold)
+{
+	char line[LINE_MAX_LEN], *f[4], *p;
+	struct signal *sig = NULL, *v;
+	size_t cap = 0, n = 0, bad = 0, skipped = 0, lineno = 0, i;
+	struct trade *t;
+	FILE *fp;
+	int k, prod;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (lineno++ == 0 && strncmp(line, "date", 4) == 0) {
+			continue;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+		for (k = 0, p = line; k < 4 && p != NULL; k++) {
+			f[k] = p;
+			if ((p = strchr(p, ',')) != NULL) {
+				*p++ = '\0';
+			}
+		}
+		if (k < 4) {
+			bad++;
+			continue;
+		}
+		for (p = f[1]; *p != '\0'; p++) {
+			*p = (char)tolower((unsigned char)*p);
+		}
+		for (p = f[2]; *p != '\0'; p++) {
+			*p = (char)tolower((unsigned char)*p);
+		}
+		if (parse_day(f[0]) == 0 || f[1][0] == '\0' || strlen(f[1]) >= COL_NAME_LEN ||
+		    (strcmp(f[2], "long") != 0 && strcmp(f[2], "short") != 0) || !(atof(f[3]) > 0)) {
+			bad++;
+			continue;
+		}
+
+		if (n == cap) {
+			cap = cap ? cap * 2 : 1024;
+			if ((v = realloc(sig, cap * sizeof(*v))) == NULL) {
+				free(sig);
+				fclose(fp);
+				return -1;
+			}
+			sig = v;
+		}
+		v = &sig[n++];
+		v->day = parse_day(f[0]);
+		v->side = strcmp(f[2], "long") == 0 ? MT_BUY : MT_SELL;
+		v->amount = atof(f[3]);
+		snprintf(v->product, sizeof(v->product), "%s", f[1]);
+	}
+	fclose(fp);
+
+	/* the products first, then the days are known */
+	for (i = 0; i < n; i++) {
+		if (find_product(bt, sig[i].product, root, exchange, majors) < 0) {
+			fprintf(stderr, "no bars or majors of %s\n", sig[i].product);
+			free(sig);
+			return -1;
+		}
+	}
+	if (load_days(bt) != 0 || (bt->trades = calloc(n + 1, sizeof(*bt->trades))) == NULL) {
+		free(sig);
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		if ((k = day_index(bt, sig[i].day)) < 0) {
+			skipped++;
+			continue;
+		}
+		prod = find_product(bt, sig[i].product, root, exchange, majors);
+		t = &bt->trades[bt->ntrades++];
+		t->product = (uint32_t)prod;
+		t->side = sig[i].side;
+		t->open_day = k;
+		t->close_day = (size_t)k + (size_t)hold < bt->ndays ? k + hold : (int32_t)bt->ndays - 1;
+		t->amount = sig[i].amount;
+	}
+	free(sig);
+
+	if (bad > 0 || skipped > 0) {
+		fprintf(stderr, "%s: %zu malformed lines, %zu signals not on a trading day\n", path, bad, skipped);
+	}
+	qsort(bt->trades, bt->ntrades, sizeof(*bt->trades), cmp_trade);
+
+	return 0;
+}
+
+/* the row of the major of the product on the day, -1 if it has none */
+static int64_t
+major_of(struct product *p, int32_t day)
+{
+	while (p->cur < p->nmajor && p->f.trading_day[p->major[p->cur]] < day) {
+		p->cur++;
+	}
+
+	return p->cur < p->nmajor && p->f.trading_day[p->major[p->cur]] == day ? (int64_t)p->major[p->cur] : -1;
+}
+
+static void
+submit(struct backtest *bt, mt_engine_t *eng, size_t i, int close, int64_t ts)
+{
+	struct trade *t = &bt->trades[i];
+	struct mt_order o;
+
+	memset(&o, 0, sizeof(o));
+	o.id = i * 2 + (close ? 2 : 1);
+	o.ts = (uint64_t)ts + (bt->model == MT_FILL_OPEN ? 1 : 0);
+	o.instrument = t->instrument;
+	o.side = close ? -t->side : t->side;
+	o.qty = close ? t->qty : 0;
+	o.amount = t->amount;
+	mt_submit(eng, &o);
+}
+
+static void
+report(struct backtest *bt, const mt_engine_t *eng, FILE *out)
+{
+	const struct mt_position *pos;
+	double equity, fee, mult = bt->multiplier;
+	int64_t lng, shrt;
+	struct product *p;
+	uint32_t k, c;
+
+	for (k = 0; k < bt->nproducts; k++) {
+		p = &bt->products[k];
+		equity = fee = 0;
+		lng = shrt = 0;
+		for (c = 0; c < p->f.hdr->ninstruments; c++) {
+			if (p->ids[c] == 0 || (pos = mt_position(eng, p->ids[c])) == NULL) {
+				continue;
+			}
+			if (pos->qty > 0) {
+				lng += pos->qty;
+			} else {
+				shrt -= pos->qty;
+			}
+			equity += pos->realized - pos->fee;
+			if (pos->qty != 0) {
+				equity += (double)pos->qty * (pos->mark - pos->cost) * mult;
+			}
+			fee += pos->fee;
+		}
+		if (out != NULL && (lng != 0 || shrt != 0 || equity != p->equity)) {
+			fprintf(out, "%d,%s,%ld,%ld,%.2f,%.2f,%.2f\n", bt->today, p->name, (long)lng,
+				(long)shrt, fee - p->fee, equity - p->equity, equity);
+		}
+		p->equity = equity;
+		p->fee = fee;
+	}
+}
+
+static double
+elapsed(const struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+run(struct backtest *bt, mt_engine_t *eng, FILE *out)
+{
+	size_t d, open = 0, close = 0;
+	struct product *p;
+	struct mt_bar bar;
+	struct trade *t;
+	int64_t row;
+	uint32_t k, code;
+
+	for (d = 0; d < bt->ndays; d++) {
+		bt->today = bt->days[d].trading_day;
+
+		for (; open < bt->ntrades && bt->trades[open].open_day == (int32_t)d; open++) {
+			t = &bt->trades[open];
+			p = &bt->products[t->product];
+			if ((row = major_of(p, bt->today)) < 0) {
+				continue;
+			}
+			code = p->f.instrument[row];
+			if (p->ids[code] == 0) {
+				p->ids[code] = tick_intern(p->f.symbols[code], strlen(p->f.symbols[code]));
+			}
+			t->instrument = p->ids[code];
+			submit(bt, eng, open, 0, bt->days[d].ts);
+		}
+		/* the hold is the same for all, so the closes are in order too */
+		for (; close < bt->ntrades && bt->trades[close].close_day == (int32_t)d; close++) {
+			t = &bt->trades[close];
+			if (t->qty > 0) {
+				submit(bt, eng, close, 1, bt->days[d].ts);
+			} else if (t->instrument != 0) {
+				/* an open too small for a lot or not yet filled */
+				mt_cancel(eng, t->instrument, close * 2 + 1);
+			}
+		}
+
+		/* the bars of the day of the contracts traded */
+		for (k = 0; k < bt->nproducts; k++) {
+			p = &bt->products[k];
+			while (p->row < p->f.nrows && p->f.trading_day[p->row] < bt->today) {
+				p->row++;
+			}
+			for (; p->row < p->f.nrows && p->f.trading_day[p->row] == bt->today; p->row++) {
+				if (p->ids[p->f.instrument[p->row]] == 0) {
+					continue;
+				}
+				bar.ts = (uint64_t)p->f.timestamp[p->row];
+				bar.open = p->f.open[p->row];
+				bar.high = p->f.high[p->row];
+				bar.low = p->f.low[p->row];
+				bar.close = p->f.close[p->row];
+				bar.volume = p->f.volume[p->row];
+				bar.amount = p->f.amount[p->row];
+				mt_bar(eng, p->ids[p->f.instrument[p->row]], &bar);
+			}
+		}
+
+		report(bt, eng, out);
+	}
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -r root -e exchange -d majors -s signals.csv [-H days] [-x model]\n"
+		"          [-S slippage] [-f fee_rate] [-F fee_per_lot] [-m multiplier] [-o daily.csv]\n"
+		"  -r dir       root of the column store\n"
+		"  -e name      exchange\n"
+		"  -d dir       directory of the .jseg files of select_major\n"
+		"  -s file      signals: date,product,position,amount\n"
+		"  -H days      trading days a position is held (default 10)\n"
+		"  -x model     open, close or vwap (default close)\n"
+		"  -S price     slippage of the fill price (default 0)\n"
+		"  -f rate      fee rate of the notional (default 0)\n"
+		"  -F fee       fee per lot (default 0)\n"
+		"  -m value     contract multiplier (default 1)\n"
+		"  -o file      daily position and pnl of the products\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *root = NULL, *exchange = NULL, *majors = NULL, *signals = NULL, *daily = NULL;
+	static struct backtest bt;
+	const struct mt_position *pos;
+	struct mt_conf conf;
+	struct mt_stats st;
+	struct timespec t0;
+	mt_engine_t *eng;
+	int32_t hold = 10;
+	double equity = 0;
+	FILE *out = NULL;
+	uint32_t k, c;
+	int opt;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.model = MT_FILL_CLOSE;
+	conf.on_fill = on_fill;
+	conf.arg = &bt;
+
+	while ((opt = getopt(argc, argv, "r:e:d:s:H:x:S:f:F:m:o:")) != -1) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'e':
+			exchange = optarg;
+			break;
+		case 'd':
+			majors = optarg;
+			break;
+		case 's':
+			signals = optarg;
+			break;
+		case 'H':
+			hold = atoi(optarg);
+			break;
+		case 'x':
+			if ((conf.model = mt_model_parse(optarg)) < 0 || conf.model == MT_FILL_BOOK) {
+				fprintf(stderr, "unknown bar fill model %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'S':
+			conf.slippage = atof(optarg);
+			break;
+		case 'f':
+			conf.fee_rate = atof(optarg);
+			break;
+		case 'F':
+			conf.fee_per_lot = atof(optarg);
+			break;
+		case 'm':
+			conf.multiplier = atof(optarg);
+			break;
+		case 'o':
+			daily = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (root == NULL || exchange == NULL || majors == NULL || signals == NULL || hold < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	bt.model = conf.model;
+	bt.multiplier = conf.multiplier > 0 ? conf.multiplier : 1;
+	if (load_signals(&bt, signals, root, exchange, majors, hold) != 0 || (eng = mt_create(&conf)) == NULL) {
+		return 1;
+	}
+	if (daily != NULL) {
+		if ((out = fopen(daily, "w")) == NULL) {
+			fprintf(stderr, "cannot create %s\n", daily);
+			mt_destroy(eng);
+			return 1;
+		}
+		fprintf(out, "date,product,long_qty,short_qty,fee,pnl,equity\n");
+	}
+
+	printf("date,product,contract,kind,side,qty,price,fee\n");
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	run(&bt, eng, out);
+
+	for (k = 0; k < bt.nproducts; k++) {
+		equity += bt.products[k].equity;
+		for (c = 0; c < bt.products[k].f.hdr->ninstruments; c++) {
+			if (bt.products[k].ids[c] != 0 && (pos = mt_position(eng, bt.products[k].ids[c])) != NULL &&
+			    pos->qty != 0) {
+				fprintf(stderr, "%s: position %ld left open\n", tick_symbol(bt.products[k].ids[c]),
+					(long)pos->qty);
+			}
+		}
+	}
+	mt_stats(eng, &st);
+	fprintf(stderr, "%zu trades over %zu days, %lu fills, %lu lots, equity %.2f in %.3fs\n",
+		bt.ntrades, bt.ndays, (unsigned long)st.fills, (unsigned long)st.filled, equity, elapsed(&t0));
+
+	if (out != NULL && fclose(out) != 0) {
+		fprintf(stderr, "cannot write %s\n", daily);
+	}
+	mt_destroy(eng);
+	for (k = 0; k < bt.nproducts; k++) {
+		free(bt.products[k].major);
+		free(bt.products[k].ids);
+		col_seg_close(&bt.products[k].seg);
+		col_close(&bt.products[k].f);
+	}
+	free(bt.days);
+	free(bt.trades);
+
+	return 0;
+}
@@ -1,17 +1,21 @@
 import pandas as pd
 import numpy as np
-import re
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'data', 'store'))
+import instrument
+
+# 合约表（$JUPITER_INSTRUMENTS），没有时按合约代码的字母部分
+INSTRUMENTS = instrument.load()
 
 # 读取数据
 signals_df = pd.read_csv('strategy_result.csv', parse_dates=['date'])
 main_contracts_df = pd.read_csv('all_majors.csv', parse_dates=['date'])
 
-# 提取产品名函数
-def extract_product(contract_code):
-    match = re.match(r'([a-zA-Z]+)', contract_code)
-    return match.group(1).upper() if match else None
-
-main_contracts_df['product'] = main_contracts_df['contract'].apply(extract_product)
+# 提取产品名
+main_contracts_df['product'] = pd.Series(instrument.products(main_contracts_df['contract'], INSTRUMENTS),
+                                         index=main_contracts_df.index).str.upper()
 signals_df['product'] = signals_df['product'].str.upper()
 
 # 匹配开仓日合约价格
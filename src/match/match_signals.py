@@ -1,103 +1,56 @@
 import pandas as pd
 import numpy as np
-import re
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'data', 'store'))
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'engine'))
+import instrument
+import engine
+
+# 合约表（$JUPITER_INSTRUMENTS），没有时按合约代码的字母部分
+INSTRUMENTS = instrument.load()
+
+# 持仓交易日数
+HOLD_DAYS = 10
 
 # 读取数据
 signals_df = pd.read_csv('signals.csv', parse_dates=['date'])
 main_df = pd.read_csv('main_contracts.csv', parse_dates=['date'])
 
 # 提取产品名
-main_df['product'] = main_df['contract'].str.extract('([a-zA-Z]+)').iloc[:,0].str.upper()
+main_df['product'] = pd.Series(instrument.products(main_df['contract'], INSTRUMENTS),
+                               index=main_df.index).str.upper()
 signals_df['product'] = signals_df['product'].str.upper()
 
-# 交易日历
-trading_days = sorted(main_df['date'].unique())
-
-positions = []  # 存放所有仓位信息
-
-# 初始化每日盈亏记录
-daily_pnl_records = []
-
-for idx, signal in signals_df.iterrows():
-    open_date = signal['date']
-    product = signal['product']
-    position = signal['position'].lower()
-    amount = signal['amount']
-
-    # 获取开仓信息
-    open_row = main_df[(main_df['date'] == open_date) & main_df['contract'].str.startswith(product.lower())]
-    if open_row.empty:
-        continue
-
-    open_contract = open_row['contract'].iloc[0]
-    open_price = open_row['close'].iloc[0]
-    open_quantity = int(amount // open_price)
-
-    # 找到平仓日
-    open_idx = trading_days.index(open_date)
-    close_date = trading_days[open_idx + 10] if open_idx + 10 < len(trading_days) else trading_days[-1]
-
-    positions.append({
-        'open_date': open_date,
-        'product': product,
-        'position': position,
-        'open_contract': open_contract,
-        'open_price': open_price,
-        'quantity': open_quantity,
-        'close_date': close_date
-    })
-
-# 每日盈亏跟踪
-for day in trading_days:
-    daily_positions = [pos for pos in positions if pos['open_date'] <= day <= pos['close_date']]
-
-    daily_summary = {}
-
-    for pos in daily_positions:
-        day_row = main_df[(main_df['date']==day) & (main_df['contract'].str.startswith(pos['open_contract'][:2]))]
-        if day_row.empty:
-            continue
-
-        day_contract = day_row['contract'].iloc[0]
-        day_settlement = day_row['settlement'].iloc[0]
-
-        direction = 1 if pos['position'] == 'long' else -1
-        pnl = direction * (day_settlement - pos['open_price']) * pos['quantity']
-
-        key = (day, pos['product'])
-
-        if key not in daily_summary:
-            daily_summary[key] = {'total_pnl':0, 'holding_pnl':0, 'closing_pnl':0, 'long_pnl':0, 'short_pnl':0, 'total_quantity':0}
-
-        daily_summary[key]['total_quantity'] += pos['quantity']
-
-        if day < pos['close_date']:
-            daily_summary[key]['holding_pnl'] += pnl
-        else:
-            daily_summary[key]['closing_pnl'] += pnl
-
-        if pos['position'] == 'long':
-            daily_summary[key]['long_pnl'] += pnl
-        else:
-            daily_summary[key]['short_pnl'] += pnl
-
-        daily_summary[key]['total_pnl'] += pnl
-
-    for (date, product), vals in daily_summary.items():
-        daily_pnl_records.append({
-            'date': date,
-            'product': product,
-            'total_profit': vals['total_pnl'],
-            'holding_profit': vals['holding_pnl'],
-            'closing_profit': vals['closing_pnl'],
-            'long_profit': vals['long_pnl'],
-            'short_profit': vals['short_pnl'],
-            'profit_per_unit': vals['total_pnl'] / vals['total_quantity'] if vals['total_quantity'] else 0
-        })
-
-# 汇总数据
-daily_pnl_df = pd.DataFrame(daily_pnl_records)
+# 每个品种每日一个主力合约，收盘价开仓，按结算价盯市
+main_df = main_df.drop_duplicates(['date', 'product'])
+panel = engine.Panel.from_frame(main_df, close='settlement')
+open_df = main_df[['date', 'product', 'close']].rename(columns={'close': 'price'})
+signals_df = signals_df.merge(open_df, on=['date', 'product'], how='left')
+
+# 仓位是 [日期 × 品种] 矩阵上的区间，一次遍历算出逐日盈亏，结果文件供 src/report 读取
+pf = engine.portfolio(panel, signals_df, hold_days=HOLD_DAYS, output='daily_pnl.jpnl')
+
+# 每日每品种的盈亏：当日相对前一日的盯市盈亏，平仓盈亏是当日平仓的仓位的部分
+m = pf.matrices
+held = m['long_lots'] + m['short_lots']
+units = np.vstack([np.zeros_like(held[:1]), held[:-1]])
+units = np.where(units > 0, units, held)
+total = m['long_pnl'] + m['short_pnl']
+d, j = np.nonzero((units > 0) | (m['turnover'] != 0))
+
+daily_pnl_df = pd.DataFrame({
+    'date': pd.to_datetime(pf.days['date'][d].astype(str)),
+    'product': np.array(panel.products)[j],
+    'total_profit': total[d, j],
+    'holding_profit': total[d, j] - m['close_pnl'][d, j],
+    'closing_profit': m['close_pnl'][d, j],
+    'long_profit': m['long_pnl'][d, j],
+    'short_profit': m['short_pnl'][d, j],
+    'profit_per_unit': np.divide(total[d, j], units[d, j], out=np.zeros(len(d)), where=units[d, j] > 0),
+})
 daily_pnl_df.to_csv('daily_pnl_tracking.csv', index=False)
 
+print(pf.summary)
 print(daily_pnl_df.head(20))
-
@@ -0,0 +1,442 @@
+/*
+ * match_tick.c
+ *
+ * The program fills the orders of a file against the ticks of tick files or
+ * of a tick bus with the matching engine, and writes the fills as CSV.
+ *
+ *	match_tick -O orders.csv -n symbols.txt ticks.jtck ... > fills.csv
+ *	match_tick -O orders.csv -b shfe -r -L 500 > fills.csv
+ *
+ * The orders have the columns ts, symbol, side, qty and price: ts in ns
+ * since epoch or YYYY-MM-DD HH:MM:SS[.mmm] China Standard Time, side buy
+ * or sell, price 0 or empty for a market order. The tick files are the
+ * tick_frame records of tick.h, their instrument ids the lines of the
+ * symbols file from 1.
+ *
+ * Copyright(C) by Shenzhen Jupiter Fund Management Co. Ltd. 2025-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "match.h"
+#include "arena.h"
+#include "bus.h"
+#include "lat.h"
+#include "parse.h"
+
+#define LINE_MAX_LEN	1024
+#define BATCH		256
+
+struct order_line
+{
+	struct mt_order o;
+	char symbol[TICK_SYMBOL_LEN];
+};
+
+struct orders
+{
+	struct order_line *v;
+	size_t n, next;
+};
+
+static volatile sig_atomic_t running = 1;
+static tick_bus_t *bus;
+
+static void
+on_signal(int sig)
+{
+	(void)sig;
+	running = 0;
+}
+
+static double
+elapsed(const struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+print_fill(const struct mt_fill *f, void *arg)
+{
+	(void)arg;
+	printf("%lu,%lu,%s,%s,%ld,%ld,%.4f,%.4f,%s\n", (unsigned long)f->ts, (unsigned long)f->order_id,
+	       tick_symbol(f->instrument), f->side == MT_BUY ? "buy" : "sell", (long)f->qty,
+	       (long)f->leaves, f->price, f->fee, f->liquidity == MT_MAKER ? "maker" : "taker");
+}
+
+/* ns since epoch of a number or of YYYY-MM-DD HH:MM:SS[.mmm] in China time */
+static uint64_t
+parse_ts(const char *s)
+{
+	unsigned int y, mo, d, h, mi, sec, ms = 0;
+	char frac[4] = "000";
+
+	if (sscanf(s, "%4u-%2u-%2u %2u:%2u:%2u.%3[0-9]", &y, &mo, &d, &h, &mi, &sec, frac) >= 6) {
+		ms = (unsigned int)(frac[0] - '0') * 100 + (unsigned int)((frac[1] ? frac[1] : '0') - '0') * 10 +
+		     (unsigned int)((frac[1] && frac[2] ? frac[2] : '0') - '0');
+		return cn_timestamp(y * 10000 + mo * 100 + d, h * 3600 + mi * 60 + sec, ms);
+	}
+
+	return strtoull(s, NULL, 10);
+}
+
+static int
+cmp_order(const void *a, const void *b)
+{
+	const struct order_line *x = a, *y = b;
+
+	if (x->o.ts != y->o.ts) {
+		return x->o.ts < y->o.ts ? -1 : 1;
+	}
+	return x->o.id < y->o.id ? -1 : x->o.id > y->o.id;
+}
+
+static int
+load_orders(const char *path, struct orders *ol)
+{
+	char line[LINE_MAX_LEN], *f[6], *p;
+	size_t cap = 0, lineno = 0, bad = 0;
+	struct order_line *v;
+	FILE *fp;
+	int n;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (lineno++ == 0 && strncmp(line, "ts", 2) == 0) {
+			continue;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+		for (n = 0, p = line; n < 6 && p != NULL; n++) {
+			f[n] = p;
+			if ((p = strchr(p, ',')) != NULL) {
+				*p++ = '\0';
+			}
+		}
+		if (n < 4 || (strcmp(f[2], "buy") != 0 && strcmp(f[2], "sell") != 0)) {
+			bad++;
+			continue;
+		}
+
+		if (ol->n == cap) {
+			cap = cap ? cap * 2 : 1024;
+			if ((v = realloc(ol->v, cap * sizeof(*v))) == NULL) {
+				fclose(fp);
+				return -1;
+			}
+			ol->v = v;
+		}
+		v = &ol->v[ol->n++];
+		memset(v, 0, sizeof(*v));
+		v->o.id = ol->n;
+		v->o.ts = parse_ts(f[0]);
+		v->o.side = strcmp(f[2], "buy") == 0 ? MT_BUY : MT_SELL;
+		v->o.qty = strtoll(f[3], NULL, 10);
+		v->o.price = n > 4 ? strtod(f[4], NULL) : 0;
+		snprintf(v->symbol, sizeof(v->symbol), "%s", f[1]);
+	}
+	fclose(fp);
+
+	if (bad > 0) {
+		fprintf(stderr, "%s: %zu malformed lines skipped\n", path, bad);
+	}
+	qsort(ol->v, ol->n, sizeof(*ol->v), cmp_order);
+
+	return 0;
+}
+
+/* intern the symbols in the order of the ids of the feed */
+static int
+load_symbols(const char *path)
+{
+	char line[LINE_MAX_LEN];
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		tick_intern(line, strlen(line));
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+static void
+sync_bus_symbols(void)
+{
+	uint32_t id;
+	const char *s;
+
+	if (bus == NULL) {
+		return;
+	}
+	for (id = tick_instruments() + 1; (s = bus_symbol(bus, id)) != NULL; id++) {
+		tick_intern(s, strlen(s));
+	}
+}
+
+/* submit the orders sent up to ts */
+static void
+submit_until(mt_engine_t *eng, struct orders *ol, uint64_t ts)
+{
+	struct order_line *v;
+
+	while (ol->next < ol->n && ol->v[ol->next].o.ts <= ts) {
+		v = &ol->v[ol->next++];
+		if ((v->o.instrument = tick_lookup(v->symbol, strlen(v->symbol))) == 0) {
+			sync_bus_symbols();
+			v->o.instrument = tick_lookup(v->symbol, strlen(v->symbol));
+		}
+		if (mt_submit(eng, &v->o) != 0) {
+			fprintf(stderr, "order %lu of %s rejected\n", (unsigned long)v->o.id, v->symbol);
+		}
+	}
+}
+
+static void
+feed(mt_engine_t *eng, struct orders *ol, const tick_rec_t *t, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		submit_until(eng, ol, t[i].timestamp);
+		mt_tick(eng, &t[i]);
+	}
+}
+
+static int
+replay_file(mt_engine_t *eng, struct orders *ol, const char *path)
+{
+	static tick_rec_t batch[BATCH];
+	const uint8_t *base;
+	tick_frame_t fr;
+	struct stat st;
+	size_t off = 0, flen, i, n;
+	void *p;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "cannot open %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "cannot map %s\n", path);
+		return -1;
+	}
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	base = p;
+
+	/* the records of a frame are copied aligned, the frames are not */
+	while (running && off + sizeof(fr) <= (size_t)st.st_size) {
+		memcpy(&fr, base + off, sizeof(fr));
+		flen = sizeof(fr) + (size_t)fr.count * sizeof(tick_rec_t);
+		if (fr.magic != TICK_MAGIC || fr.version != TICK_VERSION || off + flen > (size_t)st.st_size) {
+			fprintf(stderr, "%s: bad frame at %zu\n", path, off);
+			break;
+		}
+		for (i = 0; i < fr.count; i += n) {
+			n = fr.count - i < BATCH ? fr.count - i : BATCH;
+			memcpy(batch, base + off + sizeof(fr) + i * sizeof(tick_rec_t), n * sizeof(tick_rec_t));
+			feed(eng, ol, batch, n);
+		}
+		off += flen;
+	}
+	munmap(p, (size_t)st.st_size);
+
+	return 0;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -O orders.csv (-n symbols tick_file ... | -b bus [-w wait] [-r])\n"
+		"          [-L latency_us] [-S slippage] [-f fee_rate] [-F fee_per_lot] [-m multiplier]\n"
+		"  -O file      orders: ts,symbol,side,qty,price\n"
+		"  -n file      symbols of the instrument ids of the tick files, one a line\n"
+		"  -b bus       name of the tick bus in /dev/shm\n"
+		"  -r           replay the ticks retained by the bus first\n"
+		"  -w wait      for the ticks of the bus: spin, yield, futex or sleep (default sleep)\n"
+		"  -L us        latency from sending an order to the book (default 0)\n"
+		"  -S price     slippage of the taken price (default 0)\n"
+		"  -f rate      fee rate of the notional (default 0)\n"
+		"  -F fee       fee per lot (default 0)\n"
+		"  -m value     contract multiplier (default 1)\n"
+		"  -N count     instruments to make room for at startup (default the symbols, 1024 at least)\n",
+		prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *orders_path = NULL, *symbols = NULL, *bus_name = NULL;
+	static tick_rec_t batch[BATCH];
+	struct orders ol = { NULL, 0, 0 };
+	const struct mt_position *pos;
+	struct mt_conf conf;
+	struct mt_stats st;
+	struct timespec t0;
+	ring_reader_t rd;
+	tick_bus_t tb;
+	lat_page_t lat;
+	uint64_t t_read;
+	mt_engine_t *eng;
+	int replay = 0, wait = BUS_WAIT_SLEEP, rc = 0, opt, i;
+	uint32_t id;
+	double secs;
+	size_t n;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.model = MT_FILL_BOOK;
+	conf.on_fill = print_fill;
+
+	while ((opt = getopt(argc, argv, "O:n:b:rw:L:S:f:F:m:N:")) != -1) {
+		switch (opt) {
+		case 'O':
+			orders_path = optarg;
+			break;
+		case 'n':
+			symbols = optarg;
+			break;
+		case 'b':
+			bus_name = optarg;
+			break;
+		case 'r':
+			replay = 1;
+			break;
+		case 'w':
+			if ((wait = bus_wait_parse(optarg)) < BUS_WAIT_SLEEP) {
+				fprintf(stderr, "unknown wait %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'L':
+			conf.latency_ns = strtoull(optarg, NULL, 10) * 1000;
+			break;
+		case 'S':
+			conf.slippage = atof(optarg);
+			break;
+		case 'f':
+			conf.fee_rate = atof(optarg);
+			break;
+		case 'F':
+			conf.fee_per_lot = atof(optarg);
+			break;
+		case 'm':
+			conf.multiplier = atof(optarg);
+			break;
+		case 'N':
+			conf.instruments = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (orders_path == NULL || (bus_name == NULL) == (optind >= argc) ||
+	    (bus_name == NULL && symbols == NULL)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (load_orders(orders_path, &ol) != 0 || (symbols != NULL && load_symbols(symbols) != 0)) {
+		free(ol.v);
+		return 1;
+	}
+	if (conf.instruments == 0) {
+		conf.instruments = tick_instruments() > ARENA_INSTRUMENTS ? tick_instruments() : ARENA_INSTRUMENTS;
+	}
+	if ((eng = mt_create(&conf)) == NULL) {
+		free(ol.v);
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	printf("ts,order_id,symbol,side,qty,leaves,price,fee,liquidity\n");
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	if (bus_name != NULL) {
+		if (bus_open(&tb, bus_name, wait == RING_WAIT_FUTEX ? BUS_O_RDWR : 0) != 0 || bus_reader(&tb, &rd, replay ? BUS_R_REPLAY : 0) != 0) {
+			fprintf(stderr, "cannot open tick bus %s\n", bus_name);
+			mt_destroy(eng);
+			free(ol.v);
+			return 1;
+		}
+		bus = &tb;
+		sync_bus_symbols();
+
+		/* the matcher is the strategy stage of the latencies of the bus */
+		memset(&lat, 0, sizeof(lat));
+		if (lat_open(&lat, bus_name) == 0) {
+			lat_attach(&lat, "match_tick");
+		}
+		while (running) {
+			if ((n = ring_read(&rd, batch, BATCH)) == 0) {
+				fflush(stdout);
+				bus_idle(&rd, wait);
+				continue;
+			}
+			t_read = lat_now();
+			feed(eng, &ol, batch, n);
+			lat_consumed(batch, n, LAT_S_STRATEGY, t_read, lat_now());
+		}
+		lat_close(&lat);
+		ring_reader_fini(&rd);
+		bus_close(&tb);
+	} else {
+		for (i = optind; i < argc && running; i++) {
+			if (replay_file(eng, &ol, argv[i]) != 0) {
+				rc = 1;
+			}
+		}
+	}
+
+	secs = elapsed(&t0);
+	mt_stats(eng, &st);
+	fprintf(stderr, "events %lu orders %lu fills %lu lots %lu cancelled %lu rejected %lu grows %lu "
+		"in %.3fs, %.0f events/s\n", (unsigned long)st.events, (unsigned long)st.orders,
+		(unsigned long)st.fills, (unsigned long)st.filled, (unsigned long)st.cancelled,
+		(unsigned long)st.rejected, (unsigned long)st.grows, secs, secs > 0 ? (double)st.events / secs : 0);
+
+	for (id = 1; id <= tick_instruments(); id++) {
+		if ((pos = mt_position(eng, id)) != NULL) {
+			fprintf(stderr, "%s: position %ld cost %.4f mark %.4f realized %.2f fee %.2f\n",
+				tick_symbol(id), (long)pos->qty, pos->cost, pos->mark, pos->realized, pos->fee);
+		}
+	}
+
+	mt_destroy(eng);
+	free(ol.v);
+
+	return rc;
+}
@@ -0,0 +1,24 @@
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'engine'))
+import engine
+
+# 盈亏结果文件（engine 的 pnl 或 match_signals.py 生成）
+path = sys.argv[1] if len(sys.argv) > 1 else 'daily_pnl.jpnl'
+output = sys.argv[2] if len(sys.argv) > 2 else 'daily_profit.csv'
+
+pf = engine.read_portfolio(path)
+daily_df = pf.day_frame()
+daily_df.to_csv(output, index=False)
+
+# 按月汇总
+monthly_df = daily_df.groupby(daily_df['date'] // 100).agg(
+    pnl=('pnl', 'sum'), fee=('fee', 'sum'), turnover=('turnover', 'sum'),
+    drawdown=('drawdown', 'max'))
+
+s = pf.summary
+print(f"持仓 {s['npositions']} 跳过 {s['skipped']} 总盈亏 {s['total_pnl']:.2f} "
+      f"手续费 {s['total_fee']:.2f} 成交额 {s['turnover']:.2f} 最大回撤 {s['max_drawdown']:.2f} "
+      f"夏普比率 {s['sharpe']:.3f} 胜率 {s['win_rate']:.3f}")
+print(monthly_df)
@@ -0,0 +1,22 @@
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'engine'))
+import engine
+
+# 盈亏结果文件（engine 的 pnl 或 match_signals.py 生成）
+path = sys.argv[1] if len(sys.argv) > 1 else 'daily_pnl.jpnl'
+output = sys.argv[2] if len(sys.argv) > 2 else 'product_profit.csv'
+
+pf = engine.read_portfolio(path)
+product_df = pf.product_frame()
+product_df = product_df[product_df['npositions'] > 0].copy()
+
+# 各品种的胜率和盈亏占比
+product_df['win_rate'] = product_df['wins'] / product_df['npositions']
+product_df['share'] = product_df['pnl'] / product_df['pnl'].abs().sum()
+product_df = product_df.sort_values('pnl', ascending=False)
+product_df.to_csv(output, index=False)
+
+print(product_df[['exchange', 'product', 'npositions', 'win_rate', 'pnl', 'long_pnl',
+                  'short_pnl', 'fee', 'turnover', 'share']].to_string(index=False))
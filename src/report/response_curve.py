@@ -0,0 +1,26 @@
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'engine'))
+import engine
+
+# 盈亏结果文件（engine 的 pnl 或 match_signals.py 生成）
+path = sys.argv[1] if len(sys.argv) > 1 else 'daily_pnl.jpnl'
+output = sys.argv[2] if len(sys.argv) > 2 else 'response_curve.csv'
+
+# 开仓后第 day 个交易日仍持有的仓位的平均收益率、上涨比例和平均盈亏
+pf = engine.read_portfolio(path)
+curve_df = pf.curve_frame()
+curve_df.to_csv(output, index=False)
+
+print(curve_df.to_string(index=False))
+
+if len(sys.argv) > 3:
+    import matplotlib.pyplot as plt
+
+    fig, ax = plt.subplots(figsize=(8, 4))
+    ax.plot(curve_df['day'], curve_df['mean_ret'], marker='o')
+    ax.axhline(0, color='gray', linewidth=0.5)
+    ax.set_xlabel('days after open')
+    ax.set_ylabel('mean return')
+    fig.savefig(sys.argv[3], bbox_inches='tight')